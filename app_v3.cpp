@@ -7,10 +7,16 @@
 #include "text_renderer_gl.h"
 #include "math_utils.h"
 #include "debug.h"
+#include "profiler.h"
+#include "normal_map_gen.h"
 #include <GLFW/glfw3.h>
 #include <cstdio>
+#include <memory>
+#include <unordered_set>
 #include <cmath>
 #include <algorithm>
+#include <chrono>
+#include <thread>
 
 // GLFW callbacks
 static void glfw_framebuffer_size_callback(GLFWwindow* win, int w, int h) {
@@ -45,8 +51,19 @@ CubeApp::CubeApp()
     , m_height(720)
     , m_renderer(nullptr)
     , m_shader(0)
+    , m_updateThreads(-1)
+    , m_hotReload(false)
+    , m_nextWatchTime(0.0)
+    , m_lowLatency(false)
+    , m_allowTearing(false)
+    , m_inputSampleTime(0.0)
+    , m_pipelined(false)
+    , m_gpuCulling(false)
+    , m_viewportWidth(0)
+    , m_viewportHeight(0)
     , m_proceduralNormalMap(0)
     , m_useNormalMapping(false)
+    , m_packedVertices(false)
     , m_arrowUpPressed(false)
     , m_arrowDownPressed(false)
     , m_arrowLeftPressed(false)
@@ -56,13 +73,24 @@ CubeApp::CubeApp()
     , m_lastFrameTime(0.0)
     , m_startTime(0.0)
     , m_deltaTime(0.0f)
+    , m_physicsAccumulator(0.0f)
+    , m_physicsAlpha(0.0f)
+    , m_interpCameraID(0)
     , m_debugMode(false)
     , m_strictValidation(false)
     , m_showStats(false)
+    , m_showProfiler(false)
+    , m_profileFrames(0)
+    , m_headless(false)
+    , m_timeScale(0.0f)
+    , m_simDuration(60.0f)
+    , m_traceInterval(0.0f)
+    , m_simTick(0)
+    , m_replaying(false)
+    , m_replayMismatches(0)
     , m_textRenderer(nullptr)
 {
     // Initialize environment
-    m_environment.groundMesh = 0;
     m_environment.runwayMesh = 0;
     m_environment.groundTexture = 0;
     m_environment.runwayTexture = 0;
@@ -73,6 +101,7 @@ CubeApp::CubeApp()
     
     m_cameraPos = {0, 20, 80};
     m_cameraTarget = {0, 0, 0};
+    m_prevCameraTarget = {0, 0, 0};
     
     // Create scene manager
     m_sceneManager = new SceneManager(m_entityRegistry, m_modelRegistry);
@@ -93,10 +122,53 @@ CubeApp::~CubeApp() {
 void CubeApp::printStats() const {
     m_stats.print();
     m_textureCache.printStats();
+    m_terrain.printStats();
 }
 
 // ==================== INITIALIZATION ====================
 bool CubeApp::initialize(RendererAPI api, const char* sceneFile) {
+    // Behavior updates are scheduled across cores unless asked to stay serial
+    if (m_updateThreads != 0 && !m_jobSystem) {
+        m_jobSystem.reset(new JobSystem(m_updateThreads > 0 ? (unsigned)m_updateThreads : 0));
+        m_entityRegistry.setJobSystem(m_jobSystem.get());
+        LOG_INFO("Behavior updates on %u job threads", m_jobSystem->getWorkerCount());
+    }
+    
+    if (m_headless) {
+        LOG_INFO("Headless mode: no window or renderer");
+    } else {
+        if (!initializeGraphics(api)) return false;
+        m_startTime = glfwGetTime();
+        m_lastFrameTime = m_startTime;
+    }
+    
+    // Load scene from JSON
+    if (sceneFile) {
+        if (!loadInitialScene(sceneFile)) return false;
+    } else {
+        printf("WARNING: No scene file specified!\n");
+    }
+    
+    if (!m_tracePath.empty() &&
+        !m_trace.open(m_tracePath, SimTrace::formatForPath(m_tracePath), m_entityRegistry.getStorage(), PHYSICS_STEP)) {
+        LOG_ERROR("Failed to open trace file: %s", m_tracePath.c_str());
+        return false;
+    }
+    if (!startFlightRecording()) return false;
+    
+    LOG_INFO("===========================================");
+    LOG_INFO("Flight Simulator Ready!");
+    if (!m_headless) {
+        LOG_INFO("Controls: Arrows=pitch/roll, Del/PgDn=rudder, +/-=throttle");
+        LOG_INFO("          O=OSD, I=detail, G=ground, N=normals, ESC=quit");
+    }
+    LOG_INFO("===========================================");
+    
+    return true;
+}
+
+// Window, renderer, text renderer, shader and default textures
+bool CubeApp::initializeGraphics(RendererAPI api) {
     LOG_DEBUG("Initializing GLFW...");
     
     if (!glfwInit()) {
@@ -142,6 +214,8 @@ bool CubeApp::initialize(RendererAPI api, const char* sceneFile) {
         return false;
     }
 
+    m_renderer->setLowLatency(m_lowLatency);
+    m_renderer->setAllowTearing(m_allowTearing);
     if (!m_renderer->initialize(m_window)) {
         LOG_ERROR("Failed to initialize renderer");
         delete m_renderer;
@@ -150,10 +224,23 @@ bool CubeApp::initialize(RendererAPI api, const char* sceneFile) {
         glfwTerminate();
         return false;
     }
+    if (m_allowTearing) m_renderer->setVSync(false);
+    if (m_lowLatency || m_allowTearing) {
+        LOG_INFO("Presentation: %s, %s", m_lowLatency ? "low latency" : "default queue",
+                 m_allowTearing ? "vsync off with tearing" : "vsync");
+    }
+    if (m_framePacer.isLimiting()) LOG_INFO("Frame limit: %.1f fps", m_framePacer.getTargetFps());
+    if (m_gpuCulling) {
+        m_gpuCulling = m_renderer->supportsGpuCulling();
+        LOG_INFO("GPU culling: %s", m_gpuCulling ? "enabled" : "not supported by this renderer, culling on the CPU");
+    }
     
-    // Initialize texture cache
+    // Initialize texture cache (budget/stream mode may already be set from the command line)
     m_textureCache.setRenderer(m_renderer);
-    LOG_DEBUG("Texture cache initialized");
+    LOG_DEBUG("Texture cache initialized (budget %llu MB, %s)",
+              (unsigned long long)(m_textureCache.getBudget() / (1024 * 1024)),
+              m_textureCache.getStreamMode() == TextureCache::StreamMode::MipTailFirst
+                  ? "mip-tail-first streaming" : "immediate loads");
     
     // Initialize text renderer
     printf("=== TEXT RENDERER INITIALIZATION ===\n");
@@ -186,208 +273,150 @@ bool CubeApp::initialize(RendererAPI api, const char* sceneFile) {
     m_renderer->setCulling(false);
     
     // Create simple procedural normal map (flat blue = no bumps)
-    std::vector<unsigned char> normalMapData(256 * 256 * 4);
-    for (int i = 0; i < 256 * 256; i++) {
-        normalMapData[i * 4 + 0] = 128;  // R = 0.5 (x)
-        normalMapData[i * 4 + 1] = 128;  // G = 0.5 (y)
-        normalMapData[i * 4 + 2] = 255;  // B = 1.0 (z pointing up)
-        normalMapData[i * 4 + 3] = 255;  // A = 1.0
-    }
-    
+    std::vector<uint8_t> normalMapData = generateFlatNormalMap(256, 256);
     m_proceduralNormalMap = m_renderer->createTextureFromData(
         normalMapData.data(), 256, 256, 4);
     
     if (m_proceduralNormalMap) {
         LOG_INFO("Procedural normal map created");
     }
+    
+    return true;
+}
 
-    m_startTime = glfwGetTime();
-    m_lastFrameTime = m_startTime;
+// Build entities, cameras and controllers from a SceneConfigV2 file
+bool CubeApp::loadInitialScene(const char* sceneFile) {
+    SceneConfigV2 scene;
+    printf("DEBUG: Attempting to load scene file: %s\n", sceneFile);
     
-    // Load scene from JSON
-    if (sceneFile) {
-        SceneConfigV2 scene;
-        printf("DEBUG: Attempting to load scene file: %s\n", sceneFile);
+    if (SceneLoaderV2::loadScene(sceneFile, scene)) {
+        LOG_INFO("Loading scene: %s", scene.name.c_str());
         
-        if (SceneLoaderV2::loadScene(sceneFile, scene)) {
-            LOG_INFO("Loading scene: %s", scene.name.c_str());
-            
-            printf("DEBUG: Scene loaded, models count: %zu\n", scene.models.size());
-            printf("DEBUG: Entities count: %zu\n", scene.entities.size());
+        printf("DEBUG: Scene loaded, models count: %zu\n", scene.models.size());
+        printf("DEBUG: Entities count: %zu\n", scene.entities.size());
+        
+        // Import models and decode textures in parallel; applyScene then hits the registry
+        preloadSceneAssets(scene);
+        
+        // Apply scene to registries
+        if (SceneLoaderV2::applyScene(scene, m_modelRegistry, m_entityRegistry)) {
+            LOG_INFO("Scene loaded successfully");
+            LOG_INFO("  Entities: %zu", m_entityRegistry.getEntityCount());
+            LOG_INFO("  Behaviors: %zu", m_entityRegistry.getBehaviorCount());
+            LOG_INFO("  Models: %zu", m_modelRegistry.getModelCount());
             
-            // Apply scene to registries
-            if (SceneLoaderV2::applyScene(scene, m_modelRegistry, m_entityRegistry)) {
-                LOG_INFO("Scene loaded successfully");
-                LOG_INFO("  Entities: %zu", m_entityRegistry.getEntityCount());
-                LOG_INFO("  Behaviors: %zu", m_entityRegistry.getBehaviorCount());
-                LOG_INFO("  Models: %zu", m_modelRegistry.getModelCount());
-                
-                // Create mesh/texture handles for all models
-                printf("DEBUG: Creating render data for models...\n");
-                for (const auto& [key, filepath] : scene.models) {
-                    printf("DEBUG: Loading model '%s' from '%s'\n", key.c_str(), filepath.c_str());
-                    const Model* model = m_modelRegistry.getModel(key);
-                    if (model) {
-                        printf("DEBUG: Model has %zu meshes\n", model->meshes.size());
-                        createModelRenderData(model);
-                        printf("DEBUG: Render data created for '%s'\n", key.c_str());
-                    } else {
-                        printf("ERROR: Model '%s' not found in registry!\n", key.c_str());
-                    }
-                }
-                
-                // Store scene file for reloading
-                m_sceneFilePath = sceneFile;
-                m_sceneManager->setSceneFilePath(sceneFile);
-                
-                // Create cameras from scene
-                printf("DEBUG: Creating cameras from scene...\n");
-                for (const auto& camConfig : scene.cameras) {
-                    CameraEntity* camera = m_entityRegistry.createCameraEntity(camConfig.name);
-                    camera->setPosition(camConfig.position);
-                    camera->setFOV(camConfig.fov);
-                    
-                    // Find target entity
-                    EntityID targetID = 0;
-                    if (!camConfig.targetEntity.empty()) {
-                        Entity* target = m_entityRegistry.findEntityByName(camConfig.targetEntity);
-                        if (target) {
-                            targetID = target->getID();
-                            printf("DEBUG: Camera '%s' targets entity '%s' (ID: %u)\n", camConfig.name.c_str(), camConfig.targetEntity.c_str(), targetID);
-                        } else {
-                            printf("WARNING: Target entity '%s' not found for camera '%s'\n", camConfig.targetEntity.c_str(), camConfig.name.c_str());
-                        }
-                    }
-                    
-                    // Attach camera behavior
-                    if (camConfig.type == "chase" && targetID != 0) {
-                        auto* behavior = new ChaseCameraTargetBehavior(&m_entityRegistry, targetID);
-                        if (camConfig.behaviorParams.contains("distance"))
-                            behavior->setDistance(camConfig.behaviorParams["distance"].get<float>());
-                        if (camConfig.behaviorParams.contains("height"))
-                            behavior->setHeight(camConfig.behaviorParams["height"].get<float>());
-                        if (camConfig.behaviorParams.contains("smoothness"))
-                            behavior->setSmoothness(camConfig.behaviorParams["smoothness"].get<float>());
-                        
-                        behavior->attach(camera);
-                        behavior->initialize();
-                        m_entityRegistry.addBehaviorManual(camera->getID(), behavior);
-                        printf("DEBUG: Created chase camera: %s\n", camConfig.name.c_str());
-                        
-                    } else if (camConfig.type == "orbit" && targetID != 0) {
-                        auto* behavior = new OrbitCameraTargetBehavior(&m_entityRegistry, targetID);
-                        if (camConfig.behaviorParams.contains("distance"))
-                            behavior->setDistance(camConfig.behaviorParams["distance"].get<float>());
-                        if (camConfig.behaviorParams.contains("yaw"))
-                            behavior->setYaw(camConfig.behaviorParams["yaw"].get<float>());
-                        if (camConfig.behaviorParams.contains("pitch"))
-                            behavior->setPitch(camConfig.behaviorParams["pitch"].get<float>());
-                        if (camConfig.behaviorParams.contains("autoRotate"))
-                            behavior->setAutoRotate(camConfig.behaviorParams["autoRotate"].get<bool>());
-                        if (camConfig.behaviorParams.contains("rotationSpeed"))
-                            behavior->setRotationSpeed(camConfig.behaviorParams["rotationSpeed"].get<float>());
-                        
-                        behavior->attach(camera);
-                        behavior->initialize();
-                        m_entityRegistry.addBehaviorManual(camera->getID(), behavior);
-                        printf("DEBUG: Created orbit camera: %s\n", camConfig.name.c_str());
-                        
-                    } else if (camConfig.type == "stationary") {
-                        camera->setTarget(camConfig.target);
-                        printf("DEBUG: Created stationary camera: %s\n", camConfig.name.c_str());
-                    }
-                    
-                    m_sceneManager->addCamera(camera->getID());
+            // Create mesh/texture handles for all models
+            printf("DEBUG: Creating render data for models...\n");
+            for (const auto& [key, filepath] : scene.models) {
+                if (!m_renderer) break;  // Headless: no GPU handles
+                printf("DEBUG: Loading model '%s' from '%s'\n", key.c_str(), filepath.c_str());
+                const Model* model = m_modelRegistry.getModel(key);
+                if (model) {
+                    printf("DEBUG: Model has %zu meshes\n", model->meshes.size());
+                    createModelRenderData(model);
+                    printf("DEBUG: Render data created for '%s'\n", key.c_str());
+                } else {
+                    printf("ERROR: Model '%s' not found in registry!\n", key.c_str());
                 }
-                
-                // Register controllable entities
-                printf("DEBUG: Registering controllable entities...\n");
-                for (const auto& entityConfig : scene.entities) {
-                    if (entityConfig.controllable) {
-                        Entity* entity = m_entityRegistry.findEntityByName(entityConfig.name);
-                        if (entity) {
-                            m_sceneManager->addControllable(entity->getID());
-                            printf("DEBUG: Registered controllable: %s (type: %s)\n", entityConfig.name.c_str(), entityConfig.controllerType.c_str());
-                        }
+            }
+            
+            // Store scene file for reloading
+            m_sceneFilePath = sceneFile;
+            m_sceneManager->setSceneFilePath(sceneFile);
+            
+            // Create cameras from scene
+            printf("DEBUG: Creating cameras from scene...\n");
+            for (const auto& camConfig : scene.cameras) {
+                m_sceneManager->addCamera(createSceneCamera(camConfig)->getID());
+            }
+            
+            // Register controllable entities
+            printf("DEBUG: Registering controllable entities...\n");
+            for (const auto& entityConfig : scene.entities) {
+                if (entityConfig.controllable) {
+                    Entity* entity = m_entityRegistry.findEntityByName(entityConfig.name);
+                    if (entity) {
+                        m_sceneManager->addControllable(entity->getID());
+                        printf("DEBUG: Registered controllable: %s (type: %s)\n", entityConfig.name.c_str(), entityConfig.controllerType.c_str());
                     }
                 }
-                
-                // Create input controller
-                if (m_sceneManager->getCurrentControllable()) {
-                    auto* controller = new AircraftInputController(&m_entityRegistry);
-                    m_sceneManager->setInputController(controller);
-                    printf("DEBUG: Created aircraft input controller\n");
-                }
-                
-                // Initialize camera from scene manager
-                CameraEntity* activeCamera = m_sceneManager->getActiveCamera();
-                if (activeCamera) {
-                    m_cameraPos = activeCamera->getPosition();
-                    m_cameraTarget = activeCamera->getTarget();
-                    printf("DEBUG: Active camera: %s\n", activeCamera->getName().c_str());
-                }
-                
-                printf("DEBUG: Scene Manager: %zu cameras, %zu controllables\n", m_sceneManager->getCameraCount(), m_sceneManager->getControllableCount());
-                
-                // Create ground if specified
-                if (scene.ground.enabled) {
-                    printf("DEBUG: Creating ground plane...\n");
-                    createGroundPlane(scene.ground);
-                    printf("DEBUG: Ground mesh: %u, texture: %u\n", 
-                           m_environment.groundMesh, m_environment.groundTexture);
-                    printf("DEBUG: Runway mesh: %u, texture: %u\n",
-                           m_environment.runwayMesh, m_environment.runwayTexture);
-                }
-                
-                // Setup lighting
-                if (!scene.lights.empty()) {
-                    m_environment.lightDirection = scene.lights[0].direction;
-                    m_environment.lightColor = scene.lights[0].color;
-                    printf("DEBUG: Light direction: (%.2f, %.2f, %.2f)\n",
-                           m_environment.lightDirection.x,
-                           m_environment.lightDirection.y,
-                           m_environment.lightDirection.z);
-                }
-                
-                // Debug: List all entities
-                printf("DEBUG: Entities in registry:\n");
-                const auto& entities = m_entityRegistry.getAllEntities();
-                for (const auto& [id, entity] : entities) {
-                    printf("  - Entity ID %u: '%s' at (%.1f, %.1f, %.1f)\n",
-                           id, entity->getName().c_str(),
-                           entity->getPosition().x,
-                           entity->getPosition().y,
-                           entity->getPosition().z);
-                    printf("    Model: %p, Visible: %d\n", 
-                           (void*)entity->getModel(), entity->isVisible());
-                }
-                
-            } else {
-                LOG_ERROR("Failed to apply scene");
-                printf("ERROR: Scene application failed!\n");
-                return false;
             }
+            
+            // Create input controller
+            if (m_sceneManager->getCurrentControllable()) {
+                auto* controller = new AircraftInputController(&m_entityRegistry);
+                m_sceneManager->setInputController(controller);
+                printf("DEBUG: Created aircraft input controller\n");
+            }
+            
+            // Initialize camera from scene manager
+            CameraEntity* activeCamera = m_sceneManager->getActiveCamera();
+            if (activeCamera) {
+                m_cameraPos = activeCamera->getPosition();
+                m_cameraTarget = activeCamera->getTarget();
+                printf("DEBUG: Active camera: %s\n", activeCamera->getName().c_str());
+            }
+            resetSimulationClock();
+            
+            printf("DEBUG: Scene Manager: %zu cameras, %zu controllables\n", m_sceneManager->getCameraCount(), m_sceneManager->getControllableCount());
+            
+            // Create ground if specified
+            if (scene.ground.enabled && m_renderer) {
+                printf("DEBUG: Creating ground plane...\n");
+                createGroundPlane(scene.ground);
+                printf("DEBUG: Terrain: %s, texture: %u\n",
+                       m_terrain.isActive() ? "active" : "none", m_environment.groundTexture);
+                printf("DEBUG: Runway mesh: %u, texture: %u\n",
+                       m_environment.runwayMesh, m_environment.runwayTexture);
+            }
+            
+            // Setup lighting
+            if (!scene.lights.empty()) {
+                m_environment.lightDirection = scene.lights[0].direction;
+                m_environment.lightColor = scene.lights[0].color;
+                printf("DEBUG: Light direction: (%.2f, %.2f, %.2f)\n",
+                       m_environment.lightDirection.x,
+                       m_environment.lightDirection.y,
+                       m_environment.lightDirection.z);
+            }
+            
+            // Debug: List all entities
+            printf("DEBUG: Entities in registry:\n");
+            const auto& entities = m_entityRegistry.getAllEntities();
+            for (const auto& [id, entity] : entities) {
+                printf("  - Entity ID %u: '%s' at (%.1f, %.1f, %.1f)\n",
+                       id, entity->getName().c_str(),
+                       entity->getPosition().x,
+                       entity->getPosition().y,
+                       entity->getPosition().z);
+                printf("    Model: %p, Visible: %d\n", 
+                       (void*)entity->getModel(), entity->isVisible());
+            }
+            
+            // Kept for diffing on reload
+            m_scene = std::move(scene);
+            watchSceneFiles();
+            
         } else {
-            LOG_ERROR("Failed to load scene file: %s", sceneFile);
-            printf("ERROR: Could not load scene file '%s'\n", sceneFile);
-            printf("Make sure the file exists in the working directory!\n");
+            LOG_ERROR("Failed to apply scene");
+            printf("ERROR: Scene application failed!\n");
             return false;
         }
     } else {
-        printf("WARNING: No scene file specified!\n");
+        LOG_ERROR("Failed to load scene file: %s", sceneFile);
+        printf("ERROR: Could not load scene file '%s'\n", sceneFile);
+        printf("Make sure the file exists in the working directory!\n");
+        return false;
     }
     
-    LOG_INFO("===========================================");
-    LOG_INFO("Flight Simulator Ready!");
-    LOG_INFO("Controls: Arrows=pitch/roll, Del/PgDn=rudder, +/-=throttle");
-    LOG_INFO("          O=OSD, I=detail, G=ground, N=normals, ESC=quit");
-    LOG_INFO("===========================================");
-    
     return true;
 }
 
 // ==================== SHUTDOWN ====================
 void CubeApp::shutdown() {
+    stopRenderThread();        // The renderer is torn down on this thread
+    Profiler::stopCapture();   // Keep a capture cut short by exit
+    
     // Cleanup scene manager
     if (m_sceneManager) {
         delete m_sceneManager;
@@ -401,33 +430,46 @@ void CubeApp::shutdown() {
         m_textRenderer = nullptr;
     }
     
+    m_trace.close();
+    if (m_recorder.isOpen()) {
+        m_recorder.close();
+        LOG_INFO("Flight recording: %llu steps (%llu dropped), %.1f MB",
+                 (unsigned long long)m_recorder.getRecordedTicks(),
+                 (unsigned long long)m_recorder.getDroppedTicks(),
+                 m_recorder.getBytesWritten() / (1024.0 * 1024.0));
+    }
+    if (!m_replayPath.empty()) {
+        LOG_INFO("Flight replay: %llu of %llu steps diverged from the recording",
+                 (unsigned long long)m_replayMismatches, (unsigned long long)m_replay.getLastTick());
+    }
+    
     // Cleanup entities (this also cleans up behaviors)
     m_entityRegistry.clear();
+    m_entityRegistry.setJobSystem(nullptr);
+    m_jobSystem.reset();
     
     // Cleanup models
     m_modelRegistry.clear();
     
     if (m_renderer) {
         // Destroy model meshes/textures
-        for (auto& pair : m_modelMeshHandles) {
-            for (uint32_t handle : pair.second) {
+        for (auto& pair : m_modelRenderData) {
+            for (uint32_t handle : pair.second.meshHandles) {
                 if (handle) m_renderer->destroyMesh(handle);
             }
-        }
-        for (auto& pair : m_modelTextureHandles) {
-            for (uint32_t handle : pair.second) {
-                if (handle) m_renderer->destroyTexture(handle);
+            for (uint32_t handle : pair.second.textureHandles) {
+                if (handle) m_textureCache.release(handle);
             }
         }
-        m_modelMeshHandles.clear();
-        m_modelTextureHandles.clear();
+        m_modelRenderData.clear();
         
         // Destroy environment resources
-        if (m_environment.groundMesh) m_renderer->destroyMesh(m_environment.groundMesh);
+        m_terrain.clear();
         if (m_environment.runwayMesh) m_renderer->destroyMesh(m_environment.runwayMesh);
-        if (m_environment.groundTexture) m_renderer->destroyTexture(m_environment.groundTexture);
-        if (m_environment.runwayTexture) m_renderer->destroyTexture(m_environment.runwayTexture);
+        if (m_environment.groundTexture) m_textureCache.release(m_environment.groundTexture);
+        if (m_environment.runwayTexture) m_textureCache.release(m_environment.runwayTexture);
         if (m_proceduralNormalMap) m_renderer->destroyTexture(m_proceduralNormalMap);
+        m_textureCache.clear();  // Destroys every cached texture
         
         if (m_shader) m_renderer->destroyShader(m_shader);
         
@@ -446,61 +488,309 @@ void CubeApp::shutdown() {
 
 // ==================== MAIN LOOP ====================
 void CubeApp::run() {
+    if (m_headless) {
+        runHeadless();
+        return;
+    }
+    if (!m_profileTracePath.empty()) Profiler::startCapture(m_profileTracePath, m_profileFrames);
+    if (m_pipelined && m_lowLatency) {
+        LOG_INFO("Low latency: serial frame loop, pipelining would add a frame of latency");
+    } else if (m_pipelined) {
+        startRenderThread();
+    }
     while (!glfwWindowShouldClose(m_window)) {
-        double frameStart = glfwGetTime();
+        // Close the profiler's previous frame; its length is the frame time
+        Profiler::beginFrame();
+        const ProfileFrameSummary& lastFrame = Profiler::getLastFrame();
+        if (lastFrame.frame > 0) m_stats.updateFrameTime(lastFrame.frameMs / 1000.0);
         
-        glfwPollEvents();
+        // Wait before polling rather than after, so the input is as fresh
+        // as possible when the frame is recorded
+        {
+            PROFILE_ZONE("Frame Wait");
+            double waitStart = glfwGetTime();
+            m_renderer->waitForFrameSlot();
+            m_framePacer.wait();
+            m_stats.frameWaitTime = glfwGetTime() - waitStart;
+        }
+        {
+            PROFILE_ZONE("Events");
+            glfwPollEvents();
+        }
 
         double currentTime = glfwGetTime();
+        m_inputSampleTime = currentTime;
+        if (m_hotReload && currentTime >= m_nextWatchTime) {
+            m_nextWatchTime = currentTime + WATCH_INTERVAL;
+            if (m_fileWatcher.anyChanged()) {
+                PROFILE_ZONE("Hot Reload");
+                pauseRenderThread();
+                reloadScene();
+                resumeRenderThread();
+            }
+        }
         float deltaTime = (float)(currentTime - m_lastFrameTime);
         m_lastFrameTime = currentTime;
         m_deltaTime = deltaTime;
 
-        update(deltaTime);
-        render();
+        {
+            PROFILE_ZONE("Update");
+            update(deltaTime);
+        }
+        {
+            PROFILE_ZONE("Render");
+            render();
+        }
+    }
+    stopRenderThread();
+}
 
-        if (m_showStats) {
-            m_stats.frameTime = (float)(glfwGetTime() - frameStart) * 1000.0f;
-            m_stats.fps = 1.0f / deltaTime;
+// Fixed steps with no window or events, either unthrottled or paced to
+// m_timeScale x real time. Every update() advances exactly one
+// PHYSICS_STEP, so results don't depend on the pace.
+void CubeApp::runHeadless() {
+    using Clock = std::chrono::steady_clock;
+    const uint64_t totalSteps = (uint64_t)std::llround((double)m_simDuration / PHYSICS_STEP);
+    const uint64_t traceEvery = m_traceInterval > 0.0f
+        ? (uint64_t)(std::max)(1LL, std::llround((double)m_traceInterval / PHYSICS_STEP)) : 1;
+    const EntityStorage& storage = m_entityRegistry.getStorage();
+    
+    if (m_timeScale > 0.0f) {
+        LOG_INFO("Headless: %.1f s in %llu steps at %.2fx real time",
+                 m_simDuration, (unsigned long long)totalSteps, m_timeScale);
+    } else {
+        LOG_INFO("Headless: %.1f s in %llu steps, unthrottled", m_simDuration, (unsigned long long)totalSteps);
+    }
+    
+    if (!m_profileTracePath.empty()) Profiler::startCapture(m_profileTracePath, m_profileFrames);
+    Clock::time_point start = Clock::now();
+    m_trace.writeFrame(0.0, storage);
+    for (uint64_t step = 1; step <= totalSteps; step++) {
+        Profiler::beginFrame();   // One profiler frame per step
+        {
+            PROFILE_ZONE("Update");
+            update(PHYSICS_STEP);
+        }
+        
+        double simTime = (double)step * PHYSICS_STEP;
+        if (step % traceEvery == 0) m_trace.writeFrame(simTime, storage);
+        
+        if (m_timeScale > 0.0f) {
+            std::chrono::duration<double> wallTime(simTime / m_timeScale);
+            std::this_thread::sleep_until(start + std::chrono::duration_cast<Clock::duration>(wallTime));
         }
     }
+    
+    double wallSeconds = std::chrono::duration<double>(Clock::now() - start).count();
+    LOG_INFO("Headless run done: %.1f s simulated in %.2f s (%.1fx real time), %llu trace samples",
+             totalSteps * PHYSICS_STEP, wallSeconds,
+             wallSeconds > 0.0 ? totalSteps * PHYSICS_STEP / wallSeconds : 0.0,
+             (unsigned long long)m_trace.getFrameCount());
 }
 
 // ==================== UPDATE ====================
 void CubeApp::update(float deltaTime) {
-    // Update all entities and their behaviors
-    m_entityRegistry.update(deltaTime);
-    
-    // Update input controller
+    // Input is sampled once per frame and held for every step below
     if (m_sceneManager && m_sceneManager->getInputController()) {
         m_sceneManager->getInputController()->update(deltaTime);
     }
     
-    // Update camera from scene manager
     CameraEntity* activeCamera = m_sceneManager ? m_sceneManager->getActiveCamera() : nullptr;
+    if (activeCamera && activeCamera->getID() != m_interpCameraID) {
+        m_interpCameraID = activeCamera->getID();
+        m_prevCameraTarget = activeCamera->getTarget();
+    }
+    
+    // Simulate in fixed steps, whatever the frame rate
+    EntityStorage& storage = m_entityRegistry.getStorage();
+    m_physicsAccumulator += deltaTime;
+    uint32_t steps = 0;
+    while (m_physicsAccumulator >= PHYSICS_STEP && steps < MAX_PHYSICS_STEPS) {
+        storage.savePreviousTransforms();
+        if (activeCamera) m_prevCameraTarget = activeCamera->getTarget();
+        
+        m_simTick++;
+        if (m_replaying) applyReplayTick(m_simTick);
+        
+        // Update all entities and their behaviors
+        m_entityRegistry.update(PHYSICS_STEP);
+        
+        recordFlightTick(m_simTick);
+        if (m_replaying) verifyReplayTick(m_simTick);
+        m_physicsAccumulator -= PHYSICS_STEP;
+        steps++;
+    }
+    if (m_physicsAccumulator >= PHYSICS_STEP) {
+        // Hit the step cap: drop whole steps rather than catch up later
+        m_physicsAccumulator = std::fmod(m_physicsAccumulator, PHYSICS_STEP);
+    }
+    m_physicsAlpha = m_physicsAccumulator / PHYSICS_STEP;
+    
+    // World matrices at this blend between steps; entities that did not
+    // move keep the ones they have
+    {
+        PROFILE_ZONE("Transforms");
+        storage.updateWorldTransforms(m_physicsAlpha);
+    }
+    
+    // Camera at the same blend as the entities it sees (and riding on its
+    // parent, if it has one)
     if (activeCamera) {
-        m_cameraPos = activeCamera->getPosition();
-        m_cameraTarget = activeCamera->getTarget();
+        uint32_t index = storage.indexOf(activeCamera->getID());
+        if (index != EntityStorage::INVALID_INDEX) {
+            const Mat4& world = storage.worldMatrices()[index];
+            m_cameraPos = { world.m[12], world.m[13], world.m[14] };
+        }
+        m_cameraTarget = v3_lerp(m_prevCameraTarget, activeCamera->getTarget(), m_physicsAlpha);
+    }
+}
+
+// Call after placing entities directly (scene load), so the first frames
+// don't interpolate from stale transforms
+void CubeApp::resetSimulationClock() {
+    m_entityRegistry.getStorage().savePreviousTransforms();
+    m_physicsAccumulator = 0.0f;
+    m_physicsAlpha = 0.0f;
+    m_interpCameraID = 0;
+}
+
+// ==================== FLIGHT RECORDING ====================
+// Step 0 is the state the scene starts in: a recording writes it, a replay
+// restores it, and step N then runs on the controls recorded for step N
+bool CubeApp::startFlightRecording() {
+    m_simTick = 0;
+    if (!m_recordPath.empty()) {
+        if (!m_recorder.open(m_recordPath, PHYSICS_STEP)) {
+            LOG_ERROR("Failed to open flight recording: %s", m_recordPath.c_str());
+            return false;
+        }
+        recordFlightTick(0);
+    }
+    if (!m_replayPath.empty()) {
+        if (!m_replay.open(m_replayPath)) {
+            LOG_ERROR("Failed to open flight replay: %s", m_replayPath.c_str());
+            return false;
+        }
+        if (m_replay.getStep() != (double)PHYSICS_STEP) {
+            LOG_WARNING("Flight replay was recorded at a %.4f s step, running at %.4f s",
+                        m_replay.getStep(), (double)PHYSICS_STEP);
+        }
+        m_replaying = true;
+        m_replayMismatches = 0;
+        applyReplayTick(0);
+        LOG_INFO("Replaying %llu steps from %s", (unsigned long long)m_replay.getLastTick(),
+                 m_replayPath.c_str());
+    }
+    return true;
+}
+
+// Every aircraft after step 'tick'. Simulation thread; no allocations.
+void CubeApp::recordFlightTick(uint64_t tick) {
+    if (!m_recorder.isOpen()) return;
+    PROFILE_ZONE("Flight Recorder");
+    m_recorder.beginTick(tick);
+    for (Behavior* behavior : m_entityRegistry.getBehaviorPool<FlightDynamicsBehavior>()) {
+        auto* flight = static_cast<FlightDynamicsBehavior*>(behavior);
+        if (!flight->getEntity()) continue;
+        FlightDynamics& dynamics = flight->getFlightDynamics();
+        m_recorder.record(flight->getEntity()->getID(), dynamics.getState(), dynamics.getControlInputs());
+    }
+    m_recorder.endTick();
+}
+
+// Before step 'tick': its recorded controls, over whatever the input
+// controller set. Steps dropped while recording keep the previous controls.
+void CubeApp::applyReplayTick(uint64_t tick) {
+    if (tick > m_replay.getLastTick()) {
+        m_replaying = false;
+        LOG_INFO("Flight replay finished after %llu steps, %llu diverged",
+                 (unsigned long long)m_replay.getLastTick(), (unsigned long long)m_replayMismatches);
+        return;
+    }
+    uint32_t count = 0;
+    const FlightSample* samples = m_replay.findTick(tick, count);
+    if (!samples) return;
+    for (Behavior* behavior : m_entityRegistry.getBehaviorPool<FlightDynamicsBehavior>()) {
+        auto* flight = static_cast<FlightDynamicsBehavior*>(behavior);
+        if (!flight->getEntity()) continue;
+        const FlightSample* sample = FlightReplay::findSample(samples, count, flight->getEntity()->getID());
+        if (!sample) continue;
+        FlightDynamics& dynamics = flight->getFlightDynamics();
+        if (tick == 0) sample->applyState(dynamics.getState());
+        dynamics.setControlInputs(sample->controls());
+    }
+}
+
+// After step 'tick': the states should match the recording bit for bit
+void CubeApp::verifyReplayTick(uint64_t tick) {
+    uint32_t count = 0;
+    const FlightSample* samples = m_replay.findTick(tick, count);
+    if (!samples) return;
+    for (Behavior* behavior : m_entityRegistry.getBehaviorPool<FlightDynamicsBehavior>()) {
+        auto* flight = static_cast<FlightDynamicsBehavior*>(behavior);
+        if (!flight->getEntity()) continue;
+        EntityID id = flight->getEntity()->getID();
+        const FlightSample* sample = FlightReplay::findSample(samples, count, id);
+        FlightDynamics& dynamics = flight->getFlightDynamics();
+        if (!sample || sample->sameState(FlightSample::capture(id, dynamics.getState(), dynamics.getControlInputs()))) {
+            continue;
+        }
+        if (m_replayMismatches++ == 0) {
+            LOG_WARNING("Flight replay diverged at step %llu (entity %u)", (unsigned long long)tick, id);
+        }
+        break;
     }
 }
 
 // ==================== RENDER ====================
+// Serial: build the frame and draw it. Pipelined: hand the frame to the
+// render thread, which is still drawing the previous one; the wait is for
+// the one before that, so simulation and drawing overlap by a frame.
 void CubeApp::render() {
-    static int frameCount = 0;
     static bool debugOnce = true;
     
     if (debugOnce) {
         printf("\n=== FIRST RENDER DEBUG ===\n");
         printf("Camera pos: (%.1f, %.1f, %.1f)\n", m_cameraPos.x, m_cameraPos.y, m_cameraPos.z);
         printf("Camera target: (%.1f, %.1f, %.1f)\n", m_cameraTarget.x, m_cameraTarget.y, m_cameraTarget.z);
-        printf("Ground mesh: %u, visible: %d\n", m_environment.groundMesh, m_environment.showGround);
+        printf("Terrain: %s, visible: %d\n", m_terrain.isActive() ? "active" : "none", m_environment.showGround);
         printf("Entities count: %zu\n", m_entityRegistry.getEntityCount());
+        printf("Frame loop: %s\n", m_renderThread.joinable() ? "pipelined (render thread)" : "serial");
         debugOnce = false;
     }
     
-    m_renderer->beginFrame();
+    if (m_renderThread.joinable()) {
+        FrameSnapshot* frame;
+        {
+            PROFILE_ZONE("Wait Render");
+            frame = &m_pipeline.beginWrite();
+        }
+        buildFrame(*frame);
+        m_pipeline.publish();
+    } else {
+        buildFrame(m_serialFrame);
+        drawFrame(m_serialFrame);
+    }
+}
+
+// ==================== BUILD FRAME ====================
+// Everything the renderer needs for one frame, read from the simulation:
+// camera, ground, the sorted draw packets and the overlay text. Stats and
+// GPU timings are those drawFrame() left in this slot the last time it
+// drew it.
+void CubeApp::buildFrame(FrameSnapshot& frame) {
+    m_stats.reset();
+    m_stats.drawCalls = frame.stateStats.drawCalls;
+    m_stats.triangles = (uint32_t)frame.stateStats.triangles;
+    m_stats.stateBinds = frame.stateStats.totalIssued();
+    m_stats.stateBindsSkipped = frame.stateStats.totalSkipped();
+    if (frame.inputLatency > 0.0) m_stats.updateLatency(frame.inputLatency);
+    Profiler::addGpuFrame(frame.gpuTiming);
+    frame.inputTime = m_inputSampleTime;
     
     // Setup view/projection matrices using working mat4 functions
+    frame.width = m_width;
+    frame.height = m_height;
     float aspect = (float)m_width / (float)m_height;
     Vec3 worldUp = {0, 1, 0};
     
@@ -508,257 +798,489 @@ void CubeApp::render() {
     Mat4 proj = mat4_perspectiveRH_NO(75.0f * 3.14159265359f / 180.0f, aspect, 0.1f, 10000.0f);
     Mat4 viewProj = mat4_mul(proj, view);
     
-    if (frameCount == 0) {
-        printf("Using mat4 functions - Camera working correctly\n");
-        frameCount++;
+    // Per-draw constants: the ground is drawn in world space, so its MVP is
+    // the view-projection, which is also what the instanced draws expect.
+    // useTexture / instanced / packedVertex are filled in by each draw call.
+    // No normal map is bound to unit 1 yet, so normal mapping stays off
+    // (m_useNormalMapping is not wired to the shader).
+    frame.constants = {};
+    frame.constants.mvp = viewProj;
+    frame.constants.world = mat4_identity();
+    frame.constants.lightDir = m_environment.lightDirection;
+    frame.constants.useNormalMap = 0.0f;
+    
+    frame.showTerrain = m_environment.showGround && m_terrain.isActive();
+    frame.cameraPos = m_cameraPos;
+    frame.runwayMesh = m_environment.showGround ? m_environment.runwayMesh : 0;
+    frame.runwayTexture = m_environment.runwayTexture;
+    
+    // Draw all entities: queue one packet per mesh, sort by state; the
+    // renderer submits each run of identical mesh + texture as one
+    // instanced draw
+    frame.queue.clear();
+    Frustum frustum = Frustum::fromViewProj(viewProj);
+    frame.frustum = frustum;
+    float projScale = proj.m[5];  // 1 / tan(fovY / 2)
+    const EntityStorage& storage = m_entityRegistry.getStorage();
+    const uint8_t* flags = storage.flags();
+    const Model* const* models = storage.models();
+    const Mat4* worlds = storage.worldMatrices();   // Blended by update()
+    {
+        PROFILE_ZONE("Build Queue");
+        for (uint32_t i = 0, n = storage.size(); i < n; i++) {
+            if ((flags[i] & EntityStorage::FLAG_VISIBLE) && models[i]) {
+                renderEntity(frame.queue, models[i], worlds[i], frustum, projScale);
+            }
+        }
+        frame.queue.sort();
+    }
+    
+    // Overlay text, formatted here so the render side never reads
+    // simulation or profiler state
+    frame.showOsd = false;
+    frame.showProfiler = m_textRenderer && m_showProfiler;
+    Entity* player = m_textRenderer && m_osd.isEnabled() ? getPlayerEntity() : nullptr;
+    auto* flight = player ? m_entityRegistry.getBehavior<FlightDynamicsBehavior>(player->getID()) : nullptr;
+    if (flight) {
+        frame.osdLines = m_osd.generateOSDLines(flight->getState(), flight->getControlInputs());
+        frame.showOsd = true;
     }
+    if (frame.showProfiler) formatProfilerOverlay(frame.stateStats, frame.profilerLines);
+}
+
+// ==================== DRAW FRAME ====================
+// Issues one FrameSnapshot to the renderer; the only place per-frame
+// renderer calls are made, so it can run on the render thread
+void CubeApp::drawFrame(FrameSnapshot& frame) {
+    if (frame.width != m_viewportWidth || frame.height != m_viewportHeight) {
+        m_viewportWidth = frame.width;
+        m_viewportHeight = frame.height;
+        m_renderer->setViewport(frame.width, frame.height);
+    }
+    
+    // Streamed texture uploads and budget enforcement happen between frames
+    m_textureCache.update();
     
-    // Set lighting uniforms
+    m_renderer->beginFrame();
+    m_renderer->beginGpuZone("Scene");
     m_renderer->useShader(m_shader);
-    m_renderer->setUniformVec3(m_shader, "uLightDir", m_environment.lightDirection);
-    m_renderer->setUniformVec3(m_shader, "uLightColor", m_environment.lightColor);
-    m_renderer->setUniformInt(m_shader, "uUseNormalMapping", m_useNormalMapping ? 1 : 0);
+    m_renderer->setDrawConstants(m_shader, frame.constants);
     
-    // Draw ground
-    if (m_environment.showGround && m_environment.groundMesh) {
-        Mat4 groundWorld = mat4_identity();
-        
-        m_renderer->setUniformMat4(m_shader, "uMVP", viewProj);
-        m_renderer->setUniformMat4(m_shader, "uWorld", groundWorld);
-        m_renderer->setUniformInt(m_shader, "uUseTexture", m_environment.groundTexture ? 1 : 0);
-        m_renderer->drawMesh(m_environment.groundMesh, m_environment.groundTexture);
-        
-        // Draw runway
-        if (m_environment.runwayMesh) {
-            m_renderer->setUniformInt(m_shader, "uUseTexture", m_environment.runwayTexture ? 1 : 0);
-            m_renderer->drawMesh(m_environment.runwayMesh, m_environment.runwayTexture);
-        }
+    // Draw ground: the terrain chunks around the camera, then the runway
+    if (frame.showTerrain) {
+        PROFILE_ZONE("Terrain");
+        m_terrain.update(frame.cameraPos, frame.frustum);
+        m_terrain.draw();
+    }
+    if (frame.runwayMesh) {
+        m_textureCache.markUsed(frame.runwayTexture);
+        m_renderer->drawMesh(frame.runwayMesh, frame.runwayTexture);
     }
     
-    // Draw all entities
-    const auto& entities = m_entityRegistry.getAllEntities();
-    for (const auto& [id, entity] : entities) {
-        if (entity->isVisible() && entity->getModel()) {
-            renderEntity(entity, viewProj);
+    {
+        PROFILE_ZONE("Submit");
+        // One batch, so backends that record on several threads can split it
+        m_submitDraws.clear();
+        for (const RenderQueue::Run& run : frame.queue.getRuns()) {
+            if (run.textureHandle) m_textureCache.markUsed(run.textureHandle);
+            m_submitDraws.push_back({ run.meshHandle, run.textureHandle,
+                                      frame.queue.getInstances(run), run.instanceCount });
+        }
+        if (m_gpuCulling) {
+            m_renderer->drawInstancedCulled(m_submitDraws.data(), (uint32_t)m_submitDraws.size(),
+                                            frame.frustum);
+        } else {
+            m_renderer->drawInstancedBatch(m_submitDraws.data(), (uint32_t)m_submitDraws.size(),
+                                           m_jobSystem.get());
         }
     }
+    m_renderer->endGpuZone();
     
-    // Render OSD
-    if (m_osd.isEnabled() && m_textRenderer) {
-        Entity* player = getPlayerEntity();
-        if (player) {
-            auto* flight = m_entityRegistry.getBehavior<FlightDynamicsBehavior>(player->getID());
-            if (flight) {
-                const AircraftState& state = flight->getState();
-                const ControlInputs& controls = flight->getControlInputs();
-                
-                auto osdLines = m_osd.generateOSDLines(state, controls);
-                
-                m_textRenderer->beginText(m_width, m_height);
-                
-                float y = 0.02f;
-                float lineHeight = 0.04f;
-                
-                for (const auto& line : osdLines) {
-                    TextColor color = TextColor::Green();
-                    
-                    if (line.find("===") != std::string::npos || 
-                        line.find("---") != std::string::npos) {
-                        color = TextColor::Cyan();
-                    } else if (line.find("CLIMBING") != std::string::npos) {
-                        color = TextColor::Green();
-                    } else if (line.find("DESCENDING") != std::string::npos) {
-                        color = TextColor::Yellow();
-                    }
-                    
-                    m_textRenderer->renderText(line.c_str(), {0.02f, y}, color, 2.5f);
-                    y += lineHeight;
-                }
-                
-                m_textRenderer->endText();
-            }
-        }
+    renderTextOverlays(frame);
+    
+    {
+        PROFILE_ZONE("Present");   // Includes the vsync wait
+        m_renderer->endFrame();
     }
     
-    m_renderer->endFrame();
+    // Read back by buildFrame() when this slot is filled again
+    frame.stateStats = m_renderer->getStateStats();
+    frame.gpuTiming = m_renderer->getGpuTiming();
+    frame.inputLatency = glfwGetTime() - frame.inputTime;
+}
+
+// ==================== RENDER THREAD ====================
+// Pipelined mode: the renderer (and GL context) belongs to this thread
+// from run() until the loop ends, except while the main thread holds it
+// through pauseRenderThread()
+void CubeApp::renderThreadMain() {
+    m_renderer->makeCurrent(true);
+    for (;;) {
+        FrameSnapshot* frame = nullptr;
+        FramePipeline<FrameSnapshot>::Event event = m_pipeline.wait(frame);
+        if (event == FramePipeline<FrameSnapshot>::Event::Stop) break;
+        if (event == FramePipeline<FrameSnapshot>::Event::Pause) {
+            m_renderer->makeCurrent(false);
+            m_pipeline.parked();
+            m_renderer->makeCurrent(true);
+            continue;
+        }
+        {
+            PROFILE_ZONE("Draw Frame");
+            drawFrame(*frame);
+        }
+        m_pipeline.endRead();
+    }
+    m_renderer->makeCurrent(false);
+}
+
+void CubeApp::startRenderThread() {
+    if (m_renderThread.joinable() || !m_renderer) return;
+    m_renderer->makeCurrent(false);
+    m_pipeline.reset();
+    m_renderThread = std::thread(&CubeApp::renderThreadMain, this);
+    LOG_INFO("Pipelined frames: simulation on the main thread, drawing on a render thread");
+}
+
+// Draws what was already published, then gives the renderer back to the
+// calling thread
+void CubeApp::stopRenderThread() {
+    if (!m_renderThread.joinable()) return;
+    m_pipeline.pause();
+    m_pipeline.stop();
+    m_renderThread.join();
+    m_renderer->makeCurrent(true);
+}
+
+// Main-thread renderer work (scene reload) between pauseRenderThread() and
+// resumeRenderThread(); no-ops in serial mode
+void CubeApp::pauseRenderThread() {
+    if (!m_renderThread.joinable()) return;
+    m_pipeline.pause();
+    m_renderer->makeCurrent(true);
+}
+
+void CubeApp::resumeRenderThread() {
+    if (!m_renderThread.joinable()) return;
+    m_renderer->makeCurrent(false);
+    m_pipeline.resume();
 }
 
 // ==================== RENDER ENTITY ====================
-void CubeApp::renderEntity(const Entity* entity, const Mat4& viewProj) {
-    const Model* model = entity->getModel();
+// Culls the entity against the frustum, picks an LOD by projected size and
+// queues one packet per visible mesh; buildFrame() sorts them. With GPU
+// culling the frustum tests are left to the renderer.
+void CubeApp::renderEntity(RenderQueue& queue, const Model* model, const Mat4& world, const Frustum& frustum,
+                           float projScale) {
     if (!model) return;
+    const Model* base = model;
+    
+    Vec3 center;
+    float radius;
+    mat4_transformSphere(world, model->boundsCenter, model->boundsRadius, center, radius);
+    FrustumTest test = m_gpuCulling ? FrustumTest::Inside : frustum.testSphere(center, radius);
+    if (test == FrustumTest::Outside) {
+        m_stats.meshesCulled += (uint32_t)model->meshes.size();
+        return;
+    }
     
-    // Get mesh and texture handles
-    auto meshIt = m_modelMeshHandles.find(model);
-    auto texIt = m_modelTextureHandles.find(model);
-    if (meshIt == m_modelMeshHandles.end()) return;
+    // Fraction of the viewport height covered by the bounding sphere
+    float depth = v3_length(v3_sub(center, m_cameraPos));
+    if (depth > radius) {
+        float screenSize = radius * projScale / depth;
+        if (screenSize * (float)m_height < MIN_PROJECTED_PIXELS) {
+            m_stats.meshesCulled += (uint32_t)model->meshes.size();
+            return;
+        }
+        for (const ModelLod& lod : base->lods) {
+            if (screenSize < lod.screenSize) model = lod.model;
+        }
+    }
     
-    // Get entity transform
-    Mat4 world = entity->getTransformMatrix();
-    Mat4 mvp = mat4_mul(viewProj, world);
+    auto it = m_modelRenderData.find(model);
+    if (it == m_modelRenderData.end()) return;
+    const ModelRenderData& data = it->second;
+    bool isLod = model != base;
+    
+    Vec4 tint = {1.0f, 1.0f, 1.0f, 1.0f};
+    
+    for (size_t i = 0; i < data.meshHandles.size(); i++) {
+        // Only a straddling model needs its meshes tested one by one
+        if (test == FrustumTest::Intersects && data.meshHandles.size() > 1) {
+            const ModelMesh& mesh = model->meshes[i];
+            Vec3 meshCenter;
+            float meshRadius;
+            mat4_transformSphere(world, mesh.boundsCenter, mesh.boundsRadius, meshCenter, meshRadius);
+            if (frustum.testSphere(meshCenter, meshRadius) == FrustumTest::Outside) {
+                m_stats.meshesCulled++;
+                continue;
+            }
+        }
+        queue.add(m_shader, data.meshHandles[i], data.textureHandles[i], depth, world, tint);
+        m_stats.meshesDrawn++;
+        if (isLod) m_stats.lodMeshesDrawn++;
+    }
+}
+
+// ==================== TEXT OVERLAYS ====================
+// Flight OSD on the left, profiler on the right, in one text pass
+void CubeApp::renderTextOverlays(const FrameSnapshot& frame) {
+    if (!m_textRenderer || !(frame.showOsd || frame.showProfiler)) return;
+    PROFILE_ZONE("Text");
+    m_renderer->beginGpuZone("Text");
+    m_textRenderer->beginText(frame.width, frame.height);
+    
+    if (frame.showOsd) {
+        float y = 0.02f;
+        float lineHeight = 0.04f;
+        
+        for (const OSDLineBuffer::Line& line : frame.osdLines) {
+            m_textRenderer->renderText(line.text, {0.02f, y}, line.color, 2.5f);
+            y += lineHeight;
+        }
+    }
     
-    // Set uniforms
-    m_renderer->setUniformMat4(m_shader, "uMVP", mvp);
-    m_renderer->setUniformMat4(m_shader, "uWorld", world);
+    if (frame.showProfiler) {
+        float y = 0.02f;
+        for (const OSDLineBuffer::Line& line : frame.profilerLines) {
+            m_textRenderer->renderText(line.text, {0.62f, y}, line.color, 1.5f);
+            y += 0.03f;
+        }
+    }
     
-    // Draw all meshes
-    const auto& meshHandles = meshIt->second;
-    const auto& texHandles = (texIt != m_modelTextureHandles.end()) 
-                             ? texIt->second 
-                             : std::vector<uint32_t>();
+    m_textRenderer->endText();
+    m_renderer->invalidateStateCache();  // Text is drawn with raw GL calls
+    m_renderer->endGpuZone();
+}
+
+// Last frame's CPU zones, the newest resolved GPU frame and the renderer's
+// counters; formatted without allocating
+void CubeApp::formatProfilerOverlay(const RenderStateStats& counters, OSDLineBuffer& out) const {
+    const ProfileFrameSummary& cpu = Profiler::getLastFrame();
+    const GpuFrameTiming& gpu = Profiler::getLastGpuFrame();
+    const TextColor valueColor = TextColor::White();
+    
+    out.clear();
+    out.line("=== PROFILER ===", TextColor::Cyan());
+    out.beginLine(valueColor);
+    out.append("FRAME "); out.appendFixed((float)cpu.frameMs, 6, 2);
+    out.append(" ms  GPU "); out.appendFixed((float)gpu.frameMs, 6, 2);
+    out.append(" ms");
+    
+    out.beginLine(valueColor);
+    out.append("DRAWS "); out.appendFixed((float)counters.drawCalls, 0, 0);
+    out.append("  INST "); out.appendFixed((float)counters.instances, 0, 0);
+    out.append("  TRIS "); out.appendFixed((float)counters.triangles / 1000.0f, 0, 1);
+    out.append("K");
+    
+    out.beginLine(valueColor);
+    out.append("LATENCY "); out.appendFixed((float)(m_stats.inputLatency * 1000.0), 6, 2);
+    out.append(" ms  WAIT "); out.appendFixed((float)(m_stats.frameWaitTime * 1000.0), 6, 2);
+    out.append(" ms");
+    
+    out.beginLine(valueColor);
+    out.append("BINDS "); out.appendFixed((float)counters.totalIssued(), 0, 0);
+    out.append("  SKIPPED "); out.appendFixed((float)counters.totalSkipped(), 0, 0);
+    
+    out.line("--- CPU ---", TextColor::Cyan());
+    for (uint32_t i = 0; i < cpu.zoneCount; i++) {
+        const ProfileZoneSummary& zone = cpu.zones[i];
+        out.beginLine(zone.mainThread ? valueColor : TextColor::Yellow());   // Yellow: worker threads
+        for (uint32_t d = 0; d < zone.depth && d < 4; d++) out.append("  ");
+        out.append(zone.name);
+        out.padTo(18);
+        out.appendFixed((float)zone.ms, 6, 2);
+        if (zone.calls > 1) {
+            out.append(" x");
+            out.appendFixed((float)zone.calls, 0, 0);
+        }
+    }
+    if (cpu.droppedEvents) {
+        out.beginLine(TextColor::Red());
+        out.append("DROPPED "); out.appendFixed((float)cpu.droppedEvents, 0, 0);
+    }
     
-    for (size_t i = 0; i < meshHandles.size(); i++) {
-        uint32_t texHandle = (i < texHandles.size()) ? texHandles[i] : 0;
-        m_renderer->setUniformInt(m_shader, "uUseTexture", texHandle ? 1 : 0);
-        m_renderer->drawMesh(meshHandles[i], texHandle);
+    out.line("--- GPU ---", TextColor::Cyan());
+    for (uint32_t i = 0; i < gpu.zoneCount; i++) {
+        const GpuZoneTiming& zone = gpu.zones[i];
+        out.beginLine(valueColor);
+        for (uint32_t d = 0; d < zone.depth && d < 4; d++) out.append("  ");
+        out.append(zone.name);
+        out.padTo(18);
+        out.appendFixed((float)zone.durationMs, 6, 2);
     }
 }
 
 // ==================== GET PLAYER ENTITY ====================
+// Cached by the scene manager; no per-frame scan over entities
 Entity* CubeApp::getPlayerEntity() {
-    // Find first user-controlled entity
-    const auto& entities = m_entityRegistry.getAllEntities();
-    for (const auto& [id, entity] : entities) {
-        auto* flight = m_entityRegistry.getBehavior<FlightDynamicsBehavior>(id);
-        if (flight && flight->isUserControlled()) {
-            return entity;
-        }
-    }
-    return nullptr;
+    return m_sceneManager ? m_sceneManager->getPlayerEntity() : nullptr;
 }
 
 // ==================== CREATE MODEL RENDER DATA ====================
 void CubeApp::createModelRenderData(const Model* model) {
     if (!model) return;
     
-    std::vector<uint32_t> meshHandles;
-    std::vector<uint32_t> texHandles;
+    ModelRenderData data;
     
     for (const auto& mesh : model->meshes) {
-        // Convert ModelVertex to Vertex
-        std::vector<Vertex> vertices;
-        vertices.reserve(mesh.vertices.size());
-        
-        for (const auto& mv : mesh.vertices) {
-            Vertex v;
-            v.px = mv.px;
-            v.py = mv.py;
-            v.pz = mv.pz;
-            v.nx = mv.nx;
-            v.ny = mv.ny;
-            v.nz = mv.nz;
-            v.r = 1.0f;  // Default white
-            v.g = 1.0f;
-            v.b = 1.0f;
-            v.a = 1.0f;
-            v.u = mv.u;
-            v.v = mv.v;
-            v.tx = mv.tx;
-            v.ty = mv.ty;
-            v.tz = mv.tz;
-            v.bx = mv.bx;
-            v.by = mv.by;
-            v.bz = mv.bz;
-            vertices.push_back(v);
+        // Baked meshes are already in renderer layout; Assimp meshes are expanded
+        std::vector<Vertex> converted;
+        const Vertex* vertices = mesh.bakedVertices;
+        uint32_t vertexCount = mesh.vertexCount();
+        if (!vertices) {
+            converted.reserve(mesh.vertices.size());
+            for (const auto& mv : mesh.vertices) {
+                converted.push_back(modelVertexToVertex(mv));
+            }
+            vertices = converted.data();
         }
         
-        // Convert uint32_t indices to uint16_t
-        std::vector<uint16_t> indices16;
-        indices16.reserve(mesh.indices.size());
-        for (uint32_t idx : mesh.indices) {
-            indices16.push_back((uint16_t)idx);
+        // Indices stay 32-bit; the renderer narrows them when the mesh fits in 16 bits
+        uint32_t meshHandle;
+        if (m_packedVertices) {
+            std::vector<PackedVertex> packedVertices(vertexCount);
+            for (uint32_t i = 0; i < vertexCount; i++) {
+                packedVertices[i] = packVertex(vertices[i]);
+            }
+            meshHandle = m_renderer->createMesh(packedVertices.data(), vertexCount,
+                                                mesh.indexData(), mesh.indexCount());
+        } else {
+            meshHandle = m_renderer->createMesh(vertices, vertexCount,
+                                                mesh.indexData(), mesh.indexCount());
         }
         
-        // Create mesh
-        uint32_t meshHandle = m_renderer->createMesh(
-            vertices.data(), 
-            (uint32_t)vertices.size(),
-            indices16.data(), 
-            (uint32_t)indices16.size()
-        );
-        meshHandles.push_back(meshHandle);
-        
         // Create texture if available
         uint32_t texHandle = 0;
         if (!mesh.texturePath.empty()) {
-            texHandle = m_renderer->createTexture(mesh.texturePath.c_str());
+            texHandle = m_textureCache.acquire(mesh.texturePath.c_str());
+        }
+        
+        data.meshHandles.push_back(meshHandle);
+        data.textureHandles.push_back(texHandle);
+        data.indexCounts.push_back(mesh.indexCount());
+    }
+    
+    m_modelRenderData[model] = std::move(data);
+}
+
+// ==================== PARALLEL ASSET PRELOAD ====================
+// Models are imported (or their .cubemesh mapped) on the AssetLoader workers,
+// then registered here; each new texture they reference is decoded on a worker
+// and uploaded here. Everything ends up in the registry / texture cache, so
+// the serial applyScene() + createModelRenderData() that follow only hit caches.
+void CubeApp::preloadSceneAssets(const SceneConfigV2& scene) {
+    // Not glfwGetTime(): headless runs never initialize GLFW
+    auto start = std::chrono::steady_clock::now();
+    
+    // Texture paths already queued; only touched on this thread (finish callbacks
+    // run inside m_assetLoader.wait() below)
+    std::unordered_set<std::string> queuedTextures;
+    auto queueTexture = [this, &queuedTextures](const std::string& path) {
+        if (!m_renderer || path.empty() || m_textureCache.isLoaded(path.c_str())) return;
+        if (!queuedTextures.insert(path).second) return;
+        auto image = std::make_shared<TextureCache::DecodedImage>();
+        m_assetLoader.submit(
+            [image, path] { *image = TextureCache::decodeFile(path); },
+            [this, image] {
+                if (!image->ok) {
+                    LOG_WARNING("Preload: failed to decode texture %s", image->path.c_str());
+                    return;
+                }
+                m_textureCache.insertDecoded(std::move(*image));
+            });
+    };
+    
+    // A model's textures in one job, inserted together so same-size ones
+    // can share a texture array
+    auto queueTextureGroup = [this, &queuedTextures](const Model& model) {
+        std::vector<std::string> paths;
+        for (const ModelMesh& mesh : model.meshes) {
+            const std::string& path = mesh.texturePath;
+            if (!m_renderer || path.empty() || m_textureCache.isLoaded(path.c_str())) continue;
+            if (queuedTextures.insert(path).second) paths.push_back(path);
         }
-        texHandles.push_back(texHandle);
+        if (paths.empty()) return;
+        auto images = std::make_shared<std::vector<TextureCache::DecodedImage>>();
+        m_assetLoader.submit(
+            [images, paths] {
+                for (const std::string& path : paths) images->push_back(TextureCache::decodeFile(path));
+            },
+            [this, images] {
+                for (const TextureCache::DecodedImage& image : *images) {
+                    if (!image.ok) LOG_WARNING("Preload: failed to decode texture %s", image.path.c_str());
+                }
+                m_textureCache.insertDecodedGroup(std::move(*images));
+            });
+    };
+    
+    if (scene.ground.enabled) {
+        queueTexture(scene.ground.texturePath);
+        if (scene.ground.hasRunway) queueTexture(scene.ground.runwayTexturePath);
+    }
+    
+    // One job per source file; other keys naming the same file get a copy
+    std::unordered_map<std::string, std::vector<std::string>> keysByPath;
+    for (const auto& [key, filepath] : scene.models) {
+        if (!m_modelRegistry.hasModel(key)) keysByPath[filepath].push_back(key);
+    }
+    
+    bool useMeshCache = m_modelRegistry.getUseMeshCache();
+    for (const auto& [filepath, keys] : keysByPath) {
+        auto model = std::make_shared<std::unique_ptr<Model>>();
+        std::string path = filepath;
+        std::vector<std::string> modelKeys = keys;
+        m_assetLoader.submit(
+            [model, path, useMeshCache] {
+                auto loaded = std::make_unique<Model>();
+                if (ModelRegistry::loadModelFile(path, *loaded, useMeshCache)) {
+                    *model = std::move(loaded);
+                }
+            },
+            [this, model, path, modelKeys, &queueTexture, &queueTextureGroup] {
+                if (!*model) {
+                    LOG_WARNING("Preload: failed to load model %s", path.c_str());
+                    return;
+                }
+                if (m_textureCache.getPacking()) {
+                    queueTextureGroup(**model);
+                } else {
+                    for (const ModelMesh& mesh : (*model)->meshes) {
+                        queueTexture(mesh.texturePath);
+                    }
+                }
+                for (size_t i = 1; i < modelKeys.size(); i++) {
+                    m_modelRegistry.adoptModel(modelKeys[i], path, new Model(**model));
+                }
+                m_modelRegistry.adoptModel(modelKeys[0], path, model->release());
+            });
     }
     
-    m_modelMeshHandles[model] = meshHandles;
-    m_modelTextureHandles[model] = texHandles;
+    m_assetLoader.wait([](uint32_t completed, uint32_t submitted) {
+        LOG_INFO("Loading assets: %u / %u", completed, submitted);
+    });
+    
+    LOG_INFO("Scene assets preloaded in %.0f ms (%zu model files, %zu textures, %u workers)",
+             std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count(),
+             keysByPath.size(), queuedTextures.size(),
+             m_assetLoader.getWorkerCount());
 }
 
 // ==================== CREATE GROUND PLANE ====================
 void CubeApp::createGroundPlane(const SceneConfigV2::GroundConfig& groundConfig) {
-    LOG_INFO("Creating ground plane%s...", groundConfig.hasRunway ? " with runway" : "");
-    
-    std::vector<Vertex> groundVertices;
-    std::vector<uint16_t> groundIndices;
-    
-    const float groundY = 0.0f;
-    float surfSize = groundConfig.size;
-    
-    // Ground surface vertices
-    Vertex sv0, sv1, sv2, sv3;
-    
-    sv0.px = -surfSize; sv0.py = groundY; sv0.pz = -surfSize;
-    sv1.px = -surfSize; sv1.py = groundY; sv1.pz =  surfSize;
-    sv2.px =  surfSize; sv2.py = groundY; sv2.pz =  surfSize;
-    sv3.px =  surfSize; sv3.py = groundY; sv3.pz = -surfSize;
-    
-    sv0.nx = sv1.nx = sv2.nx = sv3.nx = 0.0f;
-    sv0.ny = sv1.ny = sv2.ny = sv3.ny = 1.0f;
-    sv0.nz = sv1.nz = sv2.nz = sv3.nz = 0.0f;
-    
-    float gr = groundConfig.color[0];
-    float gg = groundConfig.color[1];
-    float gb = groundConfig.color[2];
-    float ga = groundConfig.color[3];
-    sv0.r = sv1.r = sv2.r = sv3.r = gr;
-    sv0.g = sv1.g = sv2.g = sv3.g = gg;
-    sv0.b = sv1.b = sv2.b = sv3.b = gb;
-    sv0.a = sv1.a = sv2.a = sv3.a = ga;
-    
-    float texRepeat = surfSize / 500.0f;
-    sv0.u = 0.0f;       sv0.v = 0.0f;
-    sv1.u = 0.0f;       sv1.v = texRepeat;
-    sv2.u = texRepeat;  sv2.v = texRepeat;
-    sv3.u = texRepeat;  sv3.v = 0.0f;
-    
-    sv0.tx = sv1.tx = sv2.tx = sv3.tx = 1.0f;
-    sv0.ty = sv1.ty = sv2.ty = sv3.ty = 0.0f;
-    sv0.tz = sv1.tz = sv2.tz = sv3.tz = 0.0f;
-    sv0.bx = sv1.bx = sv2.bx = sv3.bx = 0.0f;
-    sv0.by = sv1.by = sv2.by = sv3.by = 0.0f;
-    sv0.bz = sv1.bz = sv2.bz = sv3.bz = 1.0f;
-    
-    groundVertices.push_back(sv0);
-    groundVertices.push_back(sv1);
-    groundVertices.push_back(sv2);
-    groundVertices.push_back(sv3);
-    
-    groundIndices.push_back(0);
-    groundIndices.push_back(1);
-    groundIndices.push_back(2);
-    groundIndices.push_back(0);
-    groundIndices.push_back(2);
-    groundIndices.push_back(3);
-    
-    m_environment.groundMesh = m_renderer->createMesh(
-        groundVertices.data(), (uint32_t)groundVertices.size(),
-        groundIndices.data(), (uint32_t)groundIndices.size()
-    );
+    LOG_INFO("Creating terrain%s...", groundConfig.hasRunway ? " with runway" : "");
     
     if (!groundConfig.texturePath.empty()) {
         printf("DEBUG: Loading ground texture: %s\n", groundConfig.texturePath.c_str());
-        m_environment.groundTexture = m_renderer->createTexture(groundConfig.texturePath.c_str());
+        m_environment.groundTexture = m_textureCache.acquire(groundConfig.texturePath.c_str());
         printf("DEBUG: Ground texture handle: %u\n", m_environment.groundTexture);
     } else {
         m_environment.groundTexture = 0;
     }
     
+    // Chunks stream in around the camera from the first frame on
+    m_terrain.initialize(m_renderer, &m_textureCache, groundConfig, m_environment.groundTexture);
+    
     // Create runway if needed
     if (groundConfig.hasRunway) {
         std::vector<Vertex> runwayVertices;
@@ -821,7 +1343,7 @@ void CubeApp::createGroundPlane(const SceneConfigV2::GroundConfig& groundConfig)
         
         if (!groundConfig.runwayTexturePath.empty()) {
             printf("DEBUG: Loading runway texture: %s\n", groundConfig.runwayTexturePath.c_str());
-            m_environment.runwayTexture = m_renderer->createTexture(groundConfig.runwayTexturePath.c_str());
+            m_environment.runwayTexture = m_textureCache.acquire(groundConfig.runwayTexturePath.c_str());
             printf("DEBUG: Runway texture handle: %u\n", m_environment.runwayTexture);
         } else {
             m_environment.runwayTexture = 0;
@@ -830,7 +1352,7 @@ void CubeApp::createGroundPlane(const SceneConfigV2::GroundConfig& groundConfig)
         LOG_INFO("  Runway: %.0fm × %.0fm", groundConfig.runwayWidth, groundConfig.runwayLength);
     }
     
-    LOG_INFO("Ground created: %.0fm×%.0fm", surfSize * 2.0f, surfSize * 2.0f);
+    LOG_INFO("Ground created: %.0fm×%.0fm", groundConfig.size * 2.0f, groundConfig.size * 2.0f);
 }
 
 // ==================== INPUT HANDLING ====================
@@ -861,7 +1383,9 @@ void CubeApp::onKey(int key, int scancode, int action, int mods) {
     
     // Scene reload (R)
     if (key == GLFW_KEY_R && action == GLFW_PRESS) {
+        pauseRenderThread();   // Reloading creates and destroys GPU resources
         reloadScene();
+        resumeRenderThread();
     }
     
     // Toggle ground
@@ -882,6 +1406,12 @@ void CubeApp::onKey(int key, int scancode, int action, int mods) {
         LOG_INFO("OSD mode: %s", m_osd.isDetailedMode() ? "DETAILED" : "SIMPLE");
     }
     
+    // Toggle profiler overlay
+    if (key == GLFW_KEY_P && action == GLFW_PRESS) {
+        m_showProfiler = !m_showProfiler;
+        LOG_INFO("Profiler overlay: %s", m_showProfiler ? "ENABLED" : "DISABLED");
+    }
+    
     // Toggle normal mapping
     if (key == GLFW_KEY_N && action == GLFW_PRESS) {
         m_useNormalMapping = !m_useNormalMapping;
@@ -898,10 +1428,10 @@ void CubeApp::onKey(int key, int scancode, int action, int mods) {
     }
 }
 
+// The renderer picks the new size up with the next frame (drawFrame())
 void CubeApp::onFramebufferSize(int width, int height) {
     m_width = width;
     m_height = height;
-    m_renderer->setViewport(width, height);
 }
 
 void CubeApp::onMouseButton(int button, int action, int mods) {
@@ -950,153 +1480,310 @@ void CubeApp::onScroll(double xoffset, double yoffset) {
 }
 
 // ==================== SCENE RELOADING ====================
+// Entity and camera keys that are applied in place on reload; a change to
+// any other key (behaviors, their parameters, parent, ...) recreates it
+static bool needsRecreate(json before, json after, std::initializer_list<const char*> inPlaceKeys) {
+    for (const char* key : inPlaceKeys) {
+        if (before.is_object()) before.erase(key);
+        if (after.is_object()) after.erase(key);
+    }
+    return before != after;
+}
+
+// Diffs the scene file against the scene last applied (m_scene) rather
+// than rebuilding it:
+//  - models stay loaded unless their path or file changed; changed texture
+//    files (m_fileWatcher) are reloaded and rebound where they are used
+//  - entities and cameras are matched by name. Unchanged ones are left
+//    alone, simulation state and all; transform, visibility and model
+//    changes are applied in place; anything else recreates them, along
+//    with the cameras targeting a recreated entity
+//  - the ground is rebuilt only when its config or textures changed
+// A scene file that fails to parse leaves the current scene running.
 bool CubeApp::reloadScene() {
     if (m_sceneFilePath.empty()) {
         LOG_WARNING("No scene file to reload");
         return false;
     }
     
+    auto start = std::chrono::steady_clock::now();
     LOG_INFO("Reloading scene: %s", m_sceneFilePath.c_str());
     
-    // Clear scene manager
-    m_sceneManager->clear();
+    SceneConfigV2 scene;
+    if (!SceneLoaderV2::loadScene(m_sceneFilePath.c_str(), scene)) {
+        LOG_ERROR("Failed to reload scene file; keeping the current scene");
+        // Wait for the next save rather than retrying this one
+        m_fileWatcher.untrack(m_sceneFilePath);
+        m_fileWatcher.track(m_sceneFilePath);
+        return false;
+    }
+    
+    std::unordered_set<std::string> changed;
+    for (std::string& path : m_fileWatcher.poll()) changed.insert(std::move(path));
     
-    // Destroy render data
-    for (auto& pair : m_modelMeshHandles) {
-        for (uint32_t handle : pair.second) {
-            if (handle) m_renderer->destroyMesh(handle);
-        }
+    // Changed textures load again on their next acquire
+    for (const std::string& path : changed) m_textureCache.invalidate(path.c_str());
+    
+    // ---- Models ----
+    uint32_t modelsUnloaded = 0;
+    for (const auto& [key, oldPath] : m_scene.models) {
+        auto it = scene.models.find(key);
+        if (it != scene.models.end() && it->second == oldPath && !changed.count(oldPath)) continue;
+        const Model* model = m_modelRegistry.getModel(key);
+        if (!model) continue;
+        destroyModelRenderData(model);
+        m_modelRegistry.unregisterModel(key);   // Also unlinks it from other models' LODs
+        modelsUnloaded++;
     }
-    for (auto& pair : m_modelTextureHandles) {
-        for (uint32_t handle : pair.second) {
-            if (handle) m_renderer->destroyTexture(handle);
+    
+    uint32_t texturesRebound = 0;
+    for (auto& [model, data] : m_modelRenderData) {
+        for (size_t i = 0; i < model->meshes.size() && i < data.textureHandles.size(); i++) {
+            const std::string& path = model->meshes[i].texturePath;
+            if (!data.textureHandles[i] || !changed.count(path)) continue;
+            m_textureCache.release(data.textureHandles[i]);
+            data.textureHandles[i] = m_textureCache.acquire(path.c_str());
+            texturesRebound++;
         }
     }
-    m_modelMeshHandles.clear();
-    m_modelTextureHandles.clear();
-    
-    // Destroy environment
-    if (m_environment.groundMesh) m_renderer->destroyMesh(m_environment.groundMesh);
-    if (m_environment.runwayMesh) m_renderer->destroyMesh(m_environment.runwayMesh);
-    if (m_environment.groundTexture) m_renderer->destroyTexture(m_environment.groundTexture);
-    if (m_environment.runwayTexture) m_renderer->destroyTexture(m_environment.runwayTexture);
-    m_environment.groundMesh = 0;
-    m_environment.runwayMesh = 0;
-    m_environment.groundTexture = 0;
-    m_environment.runwayTexture = 0;
-    
-    // Clear registries
-    m_entityRegistry.clear();
-    m_modelRegistry.clear();
     
-    // Reload scene file
-    SceneConfigV2 scene;
-    if (!SceneLoaderV2::loadScene(m_sceneFilePath.c_str(), scene)) {
-        LOG_ERROR("Failed to reload scene file");
-        return false;
+    // Loads only the models and textures not resident any more (or yet)
+    size_t modelsBefore = m_modelRegistry.getModelCount();
+    preloadSceneAssets(scene);
+    for (const auto& [key, filepath] : scene.models) {
+        if (!m_modelRegistry.registerModel(key, filepath)) {
+            LOG_WARNING("Failed to load model '%s' from '%s'", key.c_str(), filepath.c_str());
+        }
     }
+    size_t modelsLoaded = m_modelRegistry.getModelCount() - modelsBefore;
     
-    // Apply scene to registries
-    if (!SceneLoaderV2::applyScene(scene, m_modelRegistry, m_entityRegistry)) {
-        LOG_ERROR("Failed to apply scene");
-        return false;
+    for (const auto& [key, lods] : m_scene.modelLods) {
+        if (!scene.modelLods.count(key)) m_modelRegistry.setModelLods(key, {});
+    }
+    for (const auto& [key, lods] : scene.modelLods) {
+        std::vector<std::pair<std::string, float>> levels;
+        for (const auto& lod : lods) {
+            levels.push_back({lod.modelKey, lod.screenSize});
+        }
+        m_modelRegistry.setModelLods(key, levels);
     }
     
-    // Create mesh/texture handles for all models
     for (const auto& [key, filepath] : scene.models) {
         const Model* model = m_modelRegistry.getModel(key);
-        if (model) {
-            createModelRenderData(model);
-        }
+        if (model && !m_modelRenderData.count(model)) createModelRenderData(model);
     }
     
-    // Create cameras from scene
-    for (const auto& camConfig : scene.cameras) {
-        CameraEntity* camera = m_entityRegistry.createCameraEntity(camConfig.name);
-        camera->setPosition(camConfig.position);
-        camera->setFOV(camConfig.fov);
-        
-        // Find target entity
-        EntityID targetID = 0;
-        if (!camConfig.targetEntity.empty()) {
-            Entity* target = m_entityRegistry.findEntityByName(camConfig.targetEntity);
-            if (target) {
-                targetID = target->getID();
+    // ---- Entities ----
+    std::unordered_map<std::string, const SceneConfigV2::EntityConfig*> oldEntities;
+    for (const auto& config : m_scene.entities) oldEntities[config.name] = &config;
+    std::unordered_set<std::string> newEntities;
+    for (const auto& config : scene.entities) newEntities.insert(config.name);
+    
+    std::unordered_set<std::string> recreated;   // Removed or new IDs
+    uint32_t entitiesUpdated = 0;
+    uint32_t entitiesRemoved = 0;
+    for (const auto& config : m_scene.entities) {
+        if (newEntities.count(config.name)) continue;
+        destroySceneEntity(m_entityRegistry.findEntityByName(config.name));
+        recreated.insert(config.name);
+        entitiesRemoved++;
+    }
+    
+    uint32_t entitiesCreated = 0;
+    for (const auto& config : scene.entities) {
+        Entity* entity = m_entityRegistry.findEntityByName(config.name);
+        const Model* model = m_modelRegistry.getModel(config.modelKey);
+        auto old = oldEntities.find(config.name);
+        if (entity && old != oldEntities.end() &&
+            !needsRecreate(old->second->source, config.source,
+                           { "position", "rotation", "scale", "visible", "model" })) {
+            if (old->second->source != config.source) {
+                entity->setPosition(config.position);
+                entity->setRotation(config.rotation);
+                entity->setScale(config.scale);
+                entity->setVisible(config.visible);
+                entitiesUpdated++;
             }
+            entity->setModel(model);   // Its model may have been reloaded
+            continue;
         }
         
-        // Attach camera behavior
-        if (camConfig.type == "chase" && targetID != 0) {
-            auto* behavior = new ChaseCameraTargetBehavior(&m_entityRegistry, targetID);
-            if (camConfig.behaviorParams.contains("distance"))
-                behavior->setDistance(camConfig.behaviorParams["distance"].get<float>());
-            if (camConfig.behaviorParams.contains("height"))
-                behavior->setHeight(camConfig.behaviorParams["height"].get<float>());
-            if (camConfig.behaviorParams.contains("smoothness"))
-                behavior->setSmoothness(camConfig.behaviorParams["smoothness"].get<float>());
-            
-            behavior->attach(camera);
-            behavior->initialize();
-            m_entityRegistry.addBehaviorManual(camera->getID(), behavior);
-            
-        } else if (camConfig.type == "orbit" && targetID != 0) {
-            auto* behavior = new OrbitCameraTargetBehavior(&m_entityRegistry, targetID);
-            if (camConfig.behaviorParams.contains("distance"))
-                behavior->setDistance(camConfig.behaviorParams["distance"].get<float>());
-            if (camConfig.behaviorParams.contains("yaw"))
-                behavior->setYaw(camConfig.behaviorParams["yaw"].get<float>());
-            if (camConfig.behaviorParams.contains("pitch"))
-                behavior->setPitch(camConfig.behaviorParams["pitch"].get<float>());
-            if (camConfig.behaviorParams.contains("autoRotate"))
-                behavior->setAutoRotate(camConfig.behaviorParams["autoRotate"].get<bool>());
-            if (camConfig.behaviorParams.contains("rotationSpeed"))
-                behavior->setRotationSpeed(camConfig.behaviorParams["rotationSpeed"].get<float>());
-            
-            behavior->attach(camera);
-            behavior->initialize();
-            m_entityRegistry.addBehaviorManual(camera->getID(), behavior);
-            
-        } else if (camConfig.type == "stationary") {
-            camera->setTarget(camConfig.target);
-        }
-        
-        m_sceneManager->addCamera(camera->getID());
+        destroySceneEntity(entity);
+        entity = SceneLoaderV2::createEntity(config, m_modelRegistry, m_entityRegistry);
+        if (config.controllable) m_sceneManager->addControllable(entity->getID());
+        recreated.insert(config.name);
+        entitiesCreated++;
+    }
+    SceneLoaderV2::attachParents(scene, m_entityRegistry);
+    
+    // ---- Cameras ----
+    std::unordered_map<std::string, const SceneConfigV2::CameraConfig*> oldCameras;
+    for (const auto& camConfig : m_scene.cameras) oldCameras[camConfig.name] = &camConfig;
+    std::unordered_set<std::string> newCameras;
+    for (const auto& camConfig : scene.cameras) newCameras.insert(camConfig.name);
+    
+    CameraEntity* activeBefore = m_sceneManager->getActiveCamera();
+    EntityID activeBeforeID = activeBefore ? activeBefore->getID() : 0;
+    for (const auto& camConfig : m_scene.cameras) {
+        if (!newCameras.count(camConfig.name)) destroySceneEntity(m_entityRegistry.findEntityByName(camConfig.name));
     }
     
-    // Register controllable entities
-    for (const auto& entityConfig : scene.entities) {
-        if (entityConfig.controllable) {
-            Entity* entity = m_entityRegistry.findEntityByName(entityConfig.name);
-            if (entity) {
-                m_sceneManager->addControllable(entity->getID());
+    uint32_t camerasRecreated = 0;
+    for (const auto& camConfig : scene.cameras) {
+        auto* camera = dynamic_cast<CameraEntity*>(m_entityRegistry.findEntityByName(camConfig.name));
+        auto old = oldCameras.find(camConfig.name);
+        if (camera && old != oldCameras.end() && !recreated.count(camConfig.targetEntity) &&
+            !needsRecreate(old->second->source, camConfig.source, { "position", "target", "fov" })) {
+            if (old->second->source != camConfig.source) {
+                camera->setPosition(camConfig.position);
+                camera->setFOV(camConfig.fov);
+                if (camConfig.type == "stationary") camera->setTarget(camConfig.target);
             }
+            continue;
         }
+        
+        destroySceneEntity(camera);
+        m_sceneManager->addCamera(createSceneCamera(camConfig)->getID());
+        camerasRecreated++;
     }
     
-    // Create input controller
-    if (m_sceneManager->getCurrentControllable()) {
-        auto* controller = new AircraftInputController(&m_entityRegistry);
-        m_sceneManager->setInputController(controller);
+    if (m_sceneManager->getCurrentControllable() && !m_sceneManager->getInputController()) {
+        m_sceneManager->setInputController(new AircraftInputController(&m_entityRegistry));
     }
+    m_sceneManager->invalidatePlayer();
     
-    // Initialize camera
+    // A new active camera starts where it is instead of easing over
     CameraEntity* activeCamera = m_sceneManager->getActiveCamera();
-    if (activeCamera) {
+    if (activeCamera && activeCamera->getID() != activeBeforeID) {
         m_cameraPos = activeCamera->getPosition();
         m_cameraTarget = activeCamera->getTarget();
     }
+    if (entitiesCreated + entitiesUpdated + entitiesRemoved + camerasRecreated > 0) {
+        resetSimulationClock();
+    }
     
-    // Create ground if specified
-    if (scene.ground.enabled) {
-        createGroundPlane(scene.ground);
+    // ---- Environment ----
+    bool groundChanged = scene.ground.source != m_scene.ground.source ||
+                         changed.count(scene.ground.texturePath) ||
+                         changed.count(scene.ground.runwayTexturePath);
+    if (groundChanged) {
+        destroyGround();
+        if (scene.ground.enabled) createGroundPlane(scene.ground);
     }
     
-    // Setup lighting
     if (!scene.lights.empty()) {
         m_environment.lightDirection = scene.lights[0].direction;
         m_environment.lightColor = scene.lights[0].color;
     }
     
-    LOG_INFO("Scene reloaded successfully");
+    m_scene = std::move(scene);
+    watchSceneFiles();
+    
+    LOG_INFO("Scene reloaded in %.1f ms: %zu models loaded (%u unloaded), %u textures rebound, "
+             "entities %u created / %u updated / %u removed, %u cameras recreated%s",
+             std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count(),
+             modelsLoaded, modelsUnloaded, texturesRebound,
+             entitiesCreated, entitiesUpdated, entitiesRemoved, camerasRecreated,
+             groundChanged ? ", ground rebuilt" : "");
     return true;
 }
+
+// Unregisters it from the scene manager first, so nothing keeps its ID
+void CubeApp::destroySceneEntity(Entity* entity) {
+    if (!entity) return;
+    EntityID id = entity->getID();
+    m_sceneManager->removeControllable(id);
+    m_sceneManager->removeCamera(id);
+    m_entityRegistry.destroyEntity(id);
+}
+
+CameraEntity* CubeApp::createSceneCamera(const SceneConfigV2::CameraConfig& camConfig) {
+    CameraEntity* camera = m_entityRegistry.createCameraEntity(camConfig.name);
+    camera->setPosition(camConfig.position);
+    camera->setFOV(camConfig.fov);
+    
+    // Find target entity
+    EntityID targetID = 0;
+    if (!camConfig.targetEntity.empty()) {
+        Entity* target = m_entityRegistry.findEntityByName(camConfig.targetEntity);
+        if (target) {
+            targetID = target->getID();
+        } else {
+            printf("WARNING: Target entity '%s' not found for camera '%s'\n", camConfig.targetEntity.c_str(), camConfig.name.c_str());
+        }
+    }
+    
+    // Attach camera behavior
+    if (camConfig.type == "chase" && targetID != 0) {
+        auto* behavior = new ChaseCameraTargetBehavior(&m_entityRegistry, targetID);
+        if (camConfig.behaviorParams.contains("distance"))
+            behavior->setDistance(camConfig.behaviorParams["distance"].get<float>());
+        if (camConfig.behaviorParams.contains("height"))
+            behavior->setHeight(camConfig.behaviorParams["height"].get<float>());
+        if (camConfig.behaviorParams.contains("smoothness"))
+            behavior->setSmoothness(camConfig.behaviorParams["smoothness"].get<float>());
+        
+        behavior->attach(camera);
+        behavior->initialize();
+        m_entityRegistry.addBehaviorManual(camera->getID(), behavior);
+        
+    } else if (camConfig.type == "orbit" && targetID != 0) {
+        auto* behavior = new OrbitCameraTargetBehavior(&m_entityRegistry, targetID);
+        if (camConfig.behaviorParams.contains("distance"))
+            behavior->setDistance(camConfig.behaviorParams["distance"].get<float>());
+        if (camConfig.behaviorParams.contains("yaw"))
+            behavior->setYaw(camConfig.behaviorParams["yaw"].get<float>());
+        if (camConfig.behaviorParams.contains("pitch"))
+            behavior->setPitch(camConfig.behaviorParams["pitch"].get<float>());
+        if (camConfig.behaviorParams.contains("autoRotate"))
+            behavior->setAutoRotate(camConfig.behaviorParams["autoRotate"].get<bool>());
+        if (camConfig.behaviorParams.contains("rotationSpeed"))
+            behavior->setRotationSpeed(camConfig.behaviorParams["rotationSpeed"].get<float>());
+        
+        behavior->attach(camera);
+        behavior->initialize();
+        m_entityRegistry.addBehaviorManual(camera->getID(), behavior);
+        
+    } else if (camConfig.type == "stationary") {
+        camera->setTarget(camConfig.target);
+    }
+    return camera;
+}
+
+void CubeApp::destroyModelRenderData(const Model* model) {
+    auto it = m_modelRenderData.find(model);
+    if (it == m_modelRenderData.end()) return;
+    for (uint32_t handle : it->second.meshHandles) {
+        if (handle) m_renderer->destroyMesh(handle);
+    }
+    for (uint32_t handle : it->second.textureHandles) {
+        if (handle) m_textureCache.release(handle);
+    }
+    m_modelRenderData.erase(it);
+}
+
+void CubeApp::destroyGround() {
+    m_terrain.clear();
+    if (m_environment.runwayMesh) m_renderer->destroyMesh(m_environment.runwayMesh);
+    if (m_environment.groundTexture) m_textureCache.release(m_environment.groundTexture);
+    if (m_environment.runwayTexture) m_textureCache.release(m_environment.runwayTexture);
+    m_environment.runwayMesh = 0;
+    m_environment.groundTexture = 0;
+    m_environment.runwayTexture = 0;
+}
+
+// Everything m_scene was built from: the scene file, model files and the
+// textures of models and ground
+void CubeApp::watchSceneFiles() {
+    m_fileWatcher.track(m_sceneFilePath);
+    for (const auto& [key, filepath] : m_scene.models) {
+        m_fileWatcher.track(filepath);
+        const Model* model = m_modelRegistry.getModel(key);
+        if (!model) continue;
+        for (const ModelMesh& mesh : model->meshes) m_fileWatcher.track(mesh.texturePath);
+    }
+    if (m_scene.ground.enabled) {
+        m_fileWatcher.track(m_scene.ground.texturePath);
+        if (m_scene.ground.hasRunway) m_fileWatcher.track(m_scene.ground.runwayTexturePath);
+    }
+}
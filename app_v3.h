@@ -6,6 +6,7 @@
 #include "model.h"
 #include "debug.h"
 #include "texture_cache.h"
+#include "asset_loader.h"
 #include "entity_registry.h"
 #include "model_registry.h"
 #include "scene_loader_v2.h"
@@ -15,8 +16,20 @@
 #include "aircraft_input_controller.h"
 #include "osd.h"
 #include "text_renderer.h"
+#include "scene.h"
+#include "render_queue.h"
+#include "job_system.h"
+#include "sim_trace.h"
+#include "flight_recorder.h"
+#include "profiler.h"
+#include "frame_pipeline.h"
+#include "terrain.h"
+#include "file_watcher.h"
+#include "frame_pacer.h"
 #include <vector>
 #include <unordered_map>
+#include <memory>
+#include <thread>
 
 // Forward declarations
 struct GLFWwindow;
@@ -45,14 +58,128 @@ public:
     void setDebugMode(bool enabled) { m_debugMode = enabled; }
     void setStrictValidation(bool enabled) { m_strictValidation = enabled; }
     void setShowStats(bool enabled) { m_showStats = enabled; }
+    
+    // Texture residency (call before initialize)
+    void setTextureBudgetMB(uint32_t megabytes) { m_textureCache.setBudget((uint64_t)megabytes * 1024 * 1024); }
+    void setTextureStreaming(bool enabled) {
+        m_textureCache.setStreamMode(enabled ? TextureCache::StreamMode::MipTailFirst
+                                             : TextureCache::StreamMode::Immediate);
+    }
+    // Pack each model's same-size textures into texture arrays (call before initialize)
+    void setTexturePacking(bool enabled) { m_textureCache.setPacking(enabled); }
+    // Upload model meshes as PackedVertex (call before initialize)
+    void setPackedVertices(bool enabled) { m_packedVertices = enabled; }
+    // Behavior update threads: -1 = one per core, 0 = serial (call before initialize)
+    void setUpdateThreads(int threads) { m_updateThreads = threads; }
+    // Load models from / bake them to .cubemesh files (call before initialize)
+    void setMeshCache(bool enabled) { m_modelRegistry.setUseMeshCache(enabled); }
+    
+    // Headless runs: no window, renderer or input; run() steps the
+    // simulation for 'duration' simulated seconds and returns (call before initialize)
+    void setHeadless(bool enabled) { m_headless = enabled; }
+    // Simulated seconds per wall-clock second; 0 = as fast as possible
+    void setTimeScale(float scale) { m_timeScale = scale; }
+    void setSimDuration(float seconds) { m_simDuration = seconds; }
+    // Write entity state every 'interval' simulated seconds (0 = every step);
+    // ".csv" paths get CSV, others the SimTrace binary format
+    void setTraceFile(const std::string& path, float interval = 0.0f) {
+        m_tracePath = path;
+        m_traceInterval = interval;
+    }
+    // Record every aircraft's state and controls per physics step, or feed
+    // a recording's controls back in (same scene) and check the states
+    // still match (call before initialize)
+    void setFlightRecording(const std::string& path) { m_recordPath = path; }
+    void setFlightReplay(const std::string& path) { m_replayPath = path; }
+    // Profiler overlay (toggled with P) and Chrome trace capture of the
+    // first 'frames' frames after startup (call before run)
+    void setShowProfiler(bool enabled) { m_showProfiler = enabled; }
+    void setProfileCapture(const std::string& path, uint32_t frames) {
+        m_profileTracePath = path;
+        m_profileFrames = frames;
+    }
+    // Draw on a render thread while the main thread simulates the next
+    // frame (call before run)
+    void setPipelined(bool enabled) { m_pipelined = enabled; }
+    // Frustum-cull instances on the GPU where the renderer supports it; the
+    // CPU keeps LOD and small-object culling (call before initialize)
+    void setGpuCulling(bool enabled) { m_gpuCulling = enabled; }
+    // Reload the scene when it or an asset it uses changes on disk
+    void setHotReload(bool enabled) { m_hotReload = enabled; }
+    // Input-to-display latency over throughput: one frame queued for
+    // display, input polled once the swap chain can take the frame, and the
+    // serial frame loop even if pipelining is requested (call before
+    // initialize)
+    void setLowLatency(bool enabled) { m_lowLatency = enabled; }
+    // Present without vsync and let the frame tear, so a variable-refresh
+    // display follows the frame rate (call before initialize)
+    void setAllowTearing(bool enabled) { m_allowTearing = enabled; }
+    // Start frames at most 'fps' times a second (0 = unlimited)
+    void setFpsLimit(double fps) { m_framePacer.setTargetFps(fps); }
     void printStats() const;
 
 private:
+    // One frame as the renderer needs it, built by the simulation side and
+    // drawn by drawFrame(), possibly on the render thread while the next one
+    // is built. Nothing in it points back into simulation state.
+    struct FrameSnapshot {
+        int width = 0;
+        int height = 0;
+        DrawConstants constants = {};   // mvp holds the view-projection
+        bool showTerrain = false;
+        Vec3 cameraPos = {};            // Terrain LOD and streaming centre
+        uint32_t runwayMesh = 0;        // 0 = hidden
+        uint32_t runwayTexture = 0;
+        RenderQueue queue;              // Sorted draw packets
+        Frustum frustum;                // For GPU culling
+        bool showOsd = false;
+        bool showProfiler = false;
+        OSDLineBuffer osdLines;
+        OSDLineBuffer profilerLines;
+        
+        double inputTime = 0.0;         // glfwGetTime() when the frame's events were polled
+        
+        // Written by drawFrame() after presenting, read back by buildFrame()
+        // when the slot comes round again
+        RenderStateStats stateStats = {};
+        GpuFrameTiming gpuTiming = {};
+        double inputLatency = 0.0;      // inputTime to Present() returning; 0 until drawn
+    };
+
+    static constexpr float MIN_PROJECTED_PIXELS = 1.0f;  // Entities smaller than this on screen are culled
+    static constexpr float PHYSICS_STEP = 1.0f / 120.0f;  // Fixed simulation step (seconds)
+    static constexpr uint32_t MAX_PHYSICS_STEPS = 8;      // Per frame; longer hitches slow the sim down
+    static constexpr double WATCH_INTERVAL = 0.25;        // Seconds between hot reload file checks
+    
+    bool initializeGraphics(RendererAPI api);
+    bool loadInitialScene(const char* sceneFile);
     void update(float deltaTime);
     void render();
+    void buildFrame(FrameSnapshot& frame);
+    void drawFrame(FrameSnapshot& frame);
+    void renderThreadMain();
+    void startRenderThread();
+    void stopRenderThread();
+    void pauseRenderThread();
+    void resumeRenderThread();
+    void runHeadless();
     void createGroundPlane(const SceneConfigV2::GroundConfig& groundConfig);
     void createModelRenderData(const Model* model);
-    void renderEntity(const Entity* entity, const Mat4& viewProj);
+    void destroyModelRenderData(const Model* model);
+    void destroyGround();
+    CameraEntity* createSceneCamera(const SceneConfigV2::CameraConfig& camConfig);
+    void destroySceneEntity(Entity* entity);
+    void watchSceneFiles();
+    void preloadSceneAssets(const SceneConfigV2& scene);
+    void resetSimulationClock();
+    bool startFlightRecording();
+    void recordFlightTick(uint64_t tick);
+    void applyReplayTick(uint64_t tick);
+    void verifyReplayTick(uint64_t tick);
+    void renderEntity(RenderQueue& queue, const Model* model, const Mat4& world, const Frustum& frustum,
+                      float projScale);
+    void renderTextOverlays(const FrameSnapshot& frame);
+    void formatProfilerOverlay(const RenderStateStats& counters, OSDLineBuffer& out) const;
     Entity* getPlayerEntity();
     bool loadSceneFile(const char* filepath);
     bool reloadScene();
@@ -66,24 +193,52 @@ private:
     // Renderer
     IRenderer* m_renderer;
     TextureCache m_textureCache;
+    AssetLoader m_assetLoader;      // Parallel model import / texture decode
     uint32_t m_shader;
     
     // ECS - Entity Component System
     ModelRegistry m_modelRegistry;
     EntityRegistry m_entityRegistry;
+    std::unique_ptr<JobSystem> m_jobSystem;   // Parallel behavior updates and draw recording
+    int m_updateThreads;
     SceneManager* m_sceneManager;
     std::string m_sceneFilePath;
+    SceneConfigV2 m_scene;          // As last applied; reloads are diffed against it
+    FileWatcher m_fileWatcher;      // Scene file and the assets it uses
+    bool m_hotReload;
+    double m_nextWatchTime;
     
-    // Mesh handles per model (for rendering)
-    std::unordered_map<const Model*, std::vector<uint32_t>> m_modelMeshHandles;
-    std::unordered_map<const Model*, std::vector<uint32_t>> m_modelTextureHandles;
+    // Frame pacing
+    bool m_lowLatency;
+    bool m_allowTearing;
+    FramePacer m_framePacer;        // Optional CPU frame limiter
+    double m_inputSampleTime;       // glfwGetTime() after this frame's glfwPollEvents()
+    
+    // GPU handles per model, parallel arrays indexed by mesh
+    struct ModelRenderData {
+        std::vector<uint32_t> meshHandles;
+        std::vector<uint32_t> textureHandles;
+        std::vector<uint32_t> indexCounts;
+    };
+    std::unordered_map<const Model*, ModelRenderData> m_modelRenderData;
+    
+    // Frames being built and drawn. Serial mode uses m_serialFrame; pipelined
+    // mode passes the two slots of m_pipeline to m_renderThread.
+    FrameSnapshot m_serialFrame;
+    FramePipeline<FrameSnapshot> m_pipeline;
+    std::thread m_renderThread;
+    bool m_pipelined;
+    bool m_gpuCulling;              // Requested, then whether the renderer does it
+    int m_viewportWidth;            // Size last given to the renderer (render side)
+    int m_viewportHeight;
+    std::vector<InstancedDraw> m_submitDraws;   // Queue runs of the frame being drawn (render side)
+    Terrain m_terrain;                          // Updated and drawn on the render side
     
     // Scene environment
     struct SceneEnvironment {
-        // Ground
-        uint32_t groundMesh;
+        // Ground: m_terrain, plus the runway drawn over it
         uint32_t runwayMesh;
-        uint32_t groundTexture;
+        uint32_t groundTexture;         // Repeated over the terrain without texture tiles
         uint32_t runwayTexture;
         bool showGround;
         
@@ -98,6 +253,7 @@ private:
     // Procedural normal map for testing
     uint32_t m_proceduralNormalMap;
     bool m_useNormalMapping;
+    bool m_packedVertices;
 
     // Camera state (driven by behaviors or manual)
     Vec3 m_cameraPos;
@@ -124,6 +280,10 @@ private:
     double m_lastFrameTime;
     double m_startTime;
     float m_deltaTime;
+    float m_physicsAccumulator;     // Unsimulated time, < PHYSICS_STEP after update()
+    float m_physicsAlpha;           // Render blend between the last two steps
+    EntityID m_interpCameraID;      // Camera m_prevCameraTarget belongs to
+    Vec3 m_prevCameraTarget;
     
     // Debug and stats
     bool m_debugMode;
@@ -131,6 +291,28 @@ private:
     bool m_showStats;
     PerformanceStats m_stats;
     
+    // Profiling
+    bool m_showProfiler;
+    std::string m_profileTracePath;
+    uint32_t m_profileFrames;
+    
+    // Headless runs
+    bool m_headless;
+    float m_timeScale;
+    float m_simDuration;
+    float m_traceInterval;
+    std::string m_tracePath;
+    SimTrace m_trace;
+    
+    // Flight recording / replay
+    uint64_t m_simTick;             // Physics steps since the scene was loaded
+    std::string m_recordPath;
+    FlightRecorder m_recorder;
+    std::string m_replayPath;
+    FlightReplay m_replay;
+    bool m_replaying;
+    uint64_t m_replayMismatches;    // Steps whose states differed from the recording
+    
     // On-Screen Display
     FlightOSD m_osd;
     ITextRenderer* m_textRenderer;
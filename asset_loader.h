@@ -0,0 +1,152 @@
+// asset_loader.h - Worker pool for parsing/decoding assets off the render thread
+#ifndef ASSET_LOADER_H
+#define ASSET_LOADER_H
+
+#include <cstdint>
+#include <deque>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <algorithm>
+
+// ==================== Asset Loader ====================
+// Each job is split in two: 'work' runs on a worker thread and must not touch
+// the renderer or any registry; 'finish' runs later on the thread that calls
+// pump()/wait() (the render thread) and does the GPU upload / registration.
+// Jobs may be submitted from workers and from finish callbacks; wait() keeps
+// going until the whole batch, including jobs added on the way, is done.
+class AssetLoader {
+public:
+    using Job = std::function<void()>;
+    using ProgressCallback = std::function<void(uint32_t completed, uint32_t submitted)>;
+
+    // 0 = one worker per hardware thread, leaving one for the render thread
+    explicit AssetLoader(unsigned workerCount = 0)
+        : m_workerCount(workerCount)
+        , m_stop(false)
+        , m_submitted(0)
+        , m_completed(0)
+    {
+        if (m_workerCount == 0) {
+            unsigned hw = std::thread::hardware_concurrency();
+            m_workerCount = (std::max)(1u, hw > 1 ? hw - 1 : 1u);
+        }
+    }
+
+    ~AssetLoader() {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_stop = true;
+        }
+        m_workCv.notify_all();
+        for (std::thread& t : m_workers) t.join();
+    }
+
+    AssetLoader(const AssetLoader&) = delete;
+    AssetLoader& operator=(const AssetLoader&) = delete;
+
+    // Workers start on the first submit, so an idle loader costs nothing
+    void submit(Job work, Job finish = nullptr) {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if (m_workers.empty()) {
+                for (unsigned i = 0; i < m_workerCount; i++) {
+                    m_workers.emplace_back(&AssetLoader::workerLoop, this);
+                }
+            }
+            m_queue.push_back({ std::move(work), std::move(finish) });
+            m_submitted++;
+        }
+        m_workCv.notify_one();
+    }
+
+    // Run up to 'maxJobs' finish callbacks of completed jobs on this thread
+    uint32_t pump(uint32_t maxJobs = UINT32_MAX) {
+        uint32_t ran = 0;
+        while (ran < maxJobs) {
+            Job finish;
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                if (m_finished.empty()) break;
+                finish = std::move(m_finished.front());
+                m_finished.pop_front();
+            }
+            if (finish) finish();
+            ran++;
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_completed++;
+        }
+        return ran;
+    }
+
+    // Block until every submitted job has finished, running finish callbacks
+    // here as they arrive. Counters reset afterwards so progress is per batch.
+    void wait(const ProgressCallback& progress = nullptr) {
+        for (;;) {
+            {
+                std::unique_lock<std::mutex> lock(m_mutex);
+                m_doneCv.wait(lock, [this] {
+                    return !m_finished.empty() || m_completed == m_submitted;
+                });
+                if (m_finished.empty() && m_completed == m_submitted) {
+                    m_submitted = 0;
+                    m_completed = 0;
+                    return;
+                }
+            }
+            if (pump() > 0 && progress) {
+                uint32_t completed, submitted;
+                {
+                    std::lock_guard<std::mutex> lock(m_mutex);
+                    completed = m_completed;
+                    submitted = m_submitted;
+                }
+                progress(completed, submitted);
+            }
+        }
+    }
+
+    unsigned getWorkerCount() const { return m_workerCount; }
+
+private:
+    struct Task {
+        Job work;
+        Job finish;
+    };
+
+    void workerLoop() {
+        for (;;) {
+            Task task;
+            {
+                std::unique_lock<std::mutex> lock(m_mutex);
+                m_workCv.wait(lock, [this] { return m_stop || !m_queue.empty(); });
+                if (m_stop) return;
+                task = std::move(m_queue.front());
+                m_queue.pop_front();
+            }
+
+            if (task.work) task.work();
+
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                m_finished.push_back(std::move(task.finish));
+            }
+            m_doneCv.notify_one();
+        }
+    }
+
+    unsigned m_workerCount;
+    std::vector<std::thread> m_workers;
+    std::mutex m_mutex;
+    std::condition_variable m_workCv;
+    std::condition_variable m_doneCv;
+    std::deque<Task> m_queue;
+    std::deque<Job> m_finished;   // Finish callbacks waiting for pump()
+    bool m_stop;
+    uint32_t m_submitted;
+    uint32_t m_completed;
+};
+
+#endif // ASSET_LOADER_H
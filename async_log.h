@@ -0,0 +1,396 @@
+// async_log.h - Lock-free deferred-format logging backend for DebugManager
+#ifndef ASYNC_LOG_H
+#define ASYNC_LOG_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <thread>
+#include <type_traits>
+#include <vector>
+#include <algorithm>
+
+// ==================== Log Record ====================
+// One log call as captured on the calling thread: the format pointer, the
+// arguments as raw values and a copy of any string arguments. Nothing is
+// formatted until the log thread gets to it, so the caller pays for a few
+// stores instead of a vsnprintf and a locked write.
+//
+// The format is read later on another thread, so it must be a string
+// literal (as it is for every LOG_* call). String arguments are copied and
+// may be temporaries; they are cut short when the record's text runs out.
+static const uint32_t LOG_MAX_ARGS   = 16;
+static const uint32_t LOG_TEXT_BYTES = 128;
+
+enum class LogArgType : uint8_t { Int, UInt, Double, Pointer, String };
+
+struct LogRecord {
+    const char* format;
+    int64_t timeUs;                  // Since DebugManager::initialize
+    uint8_t level;
+    uint8_t argCount;
+    uint8_t textUsed;
+    LogArgType types[LOG_MAX_ARGS];
+    uint64_t values[LOG_MAX_ARGS];   // Integers, double bits, pointers, or offsets into text
+    char text[LOG_TEXT_BYTES];
+};
+
+// ==================== Argument Capture ====================
+namespace LogCapture {
+
+inline void store(LogRecord& record, LogArgType type, uint64_t value) {
+    if (record.argCount >= LOG_MAX_ARGS) return;
+    record.types[record.argCount] = type;
+    record.values[record.argCount] = value;
+    record.argCount++;
+}
+
+inline void storeString(LogRecord& record, const char* text) {
+    if (!text) text = "(null)";
+    size_t room = LOG_TEXT_BYTES - record.textUsed;
+    if (room == 0) {
+        store(record, LogArgType::String, LOG_TEXT_BYTES);   // Reads as ""
+        return;
+    }
+    size_t length = (std::min)(std::strlen(text), room - 1);
+    std::memcpy(record.text + record.textUsed, text, length);
+    record.text[record.textUsed + length] = '\0';
+    store(record, LogArgType::String, record.textUsed);
+    record.textUsed = (uint8_t)(record.textUsed + length + 1);
+}
+
+template <typename T>
+void capture(LogRecord& record, const T& arg) {
+    using U = std::decay_t<T>;
+    if constexpr (std::is_same_v<U, char*> || std::is_same_v<U, const char*>) {
+        storeString(record, arg);
+    } else if constexpr (std::is_floating_point_v<U>) {
+        double value = (double)arg;
+        uint64_t bits;
+        std::memcpy(&bits, &value, sizeof(bits));
+        store(record, LogArgType::Double, bits);
+    } else if constexpr (std::is_enum_v<U>) {
+        store(record, LogArgType::Int, (uint64_t)(int64_t)arg);
+    } else if constexpr (std::is_integral_v<U> && std::is_signed_v<U>) {
+        store(record, LogArgType::Int, (uint64_t)(int64_t)arg);
+    } else if constexpr (std::is_integral_v<U>) {
+        store(record, LogArgType::UInt, (uint64_t)arg);
+    } else if constexpr (std::is_pointer_v<U> || std::is_null_pointer_v<U>) {
+        store(record, LogArgType::Pointer, (uint64_t)(uintptr_t)arg);
+    } else {
+        static_assert(std::is_pointer_v<U>, "LOG_* arguments must be numbers, enums, pointers or C strings");
+    }
+}
+
+template <typename... Args>
+void fill(LogRecord& record, uint8_t level, int64_t timeUs, const char* format, const Args&... args) {
+    record.format = format;
+    record.timeUs = timeUs;
+    record.level = level;
+    record.argCount = 0;
+    record.textUsed = 0;
+    (capture(record, args), ...);
+}
+
+} // namespace LogCapture
+
+// ==================== Record Formatting ====================
+// printf semantics over the captured values. Each conversion is handed to
+// snprintf on its own, with the length modifier replaced by the one that
+// matches the captured type, so a %d given a double or a missing argument
+// prints something sensible instead of reading garbage.
+inline size_t formatLogRecord(const LogRecord& record, char* out, size_t outSize) {
+    if (outSize == 0) return 0;
+    size_t used = 0;
+    uint32_t nextArg = 0;
+    auto append = [&](const char* text, size_t length) {
+        size_t room = outSize - 1 - used;
+        if (length > room) length = room;
+        std::memcpy(out + used, text, length);
+        used += length;
+    };
+    auto argInt = [&](uint32_t i) -> int64_t {
+        if (i >= record.argCount) return 0;
+        if (record.types[i] == LogArgType::Double) {
+            double value;
+            std::memcpy(&value, &record.values[i], sizeof(value));
+            return (int64_t)value;
+        }
+        return (int64_t)record.values[i];
+    };
+    auto argDouble = [&](uint32_t i) -> double {
+        if (i >= record.argCount) return 0.0;
+        switch (record.types[i]) {
+            case LogArgType::Double: {
+                double value;
+                std::memcpy(&value, &record.values[i], sizeof(value));
+                return value;
+            }
+            case LogArgType::Int: return (double)(int64_t)record.values[i];
+            default:              return (double)record.values[i];
+        }
+    };
+
+    const char* p = record.format ? record.format : "";
+    while (*p && used + 1 < outSize) {
+        const char* start = std::strchr(p, '%');
+        if (!start) {
+            append(p, std::strlen(p));
+            break;
+        }
+        append(p, (size_t)(start - p));
+        p = start + 1;
+        if (*p == '%') {
+            append("%", 1);
+            p++;
+            continue;
+        }
+
+        // %[flags][width][.precision][length]conversion, '*' resolved
+        char spec[48] = "%";
+        size_t specLength = 1;
+        auto specAdd = [&](const char* text, size_t length) {
+            if (specLength + length >= sizeof(spec) - 4) return;
+            std::memcpy(spec + specLength, text, length);
+            specLength += length;
+            spec[specLength] = '\0';
+        };
+        while (*p && std::strchr("-+ #0", *p)) specAdd(p++, 1);
+        for (int field = 0; field < 2; field++) {
+            if (field == 1) {
+                if (*p != '.') break;
+                specAdd(p++, 1);
+            }
+            if (*p == '*') {
+                char number[24];
+                int length = std::snprintf(number, sizeof(number), "%d", (int)argInt(nextArg++));
+                specAdd(number, (size_t)length);
+                p++;
+            } else {
+                while (*p >= '0' && *p <= '9') specAdd(p++, 1);
+            }
+        }
+        while (*p && std::strchr("hljztL", *p)) p++;
+        char conversion = *p;
+        if (!conversion) break;
+        p++;
+
+        char piece[512];
+        int length = 0;
+        uint32_t arg = nextArg++;
+        switch (conversion) {
+            case 'd': case 'i':
+                specAdd("ll", 2); specAdd(&conversion, 1);
+                length = std::snprintf(piece, sizeof(piece), spec, (long long)argInt(arg));
+                break;
+            case 'u': case 'x': case 'X': case 'o':
+                specAdd("ll", 2); specAdd(&conversion, 1);
+                length = std::snprintf(piece, sizeof(piece), spec, (unsigned long long)argInt(arg));
+                break;
+            case 'c':
+                specAdd(&conversion, 1);
+                length = std::snprintf(piece, sizeof(piece), spec, (int)argInt(arg));
+                break;
+            case 'f': case 'F': case 'e': case 'E': case 'g': case 'G': case 'a': case 'A':
+                specAdd(&conversion, 1);
+                length = std::snprintf(piece, sizeof(piece), spec, argDouble(arg));
+                break;
+            case 's': {
+                const char* text = "(null)";
+                if (arg < record.argCount && record.types[arg] == LogArgType::String) {
+                    text = record.values[arg] < LOG_TEXT_BYTES ? record.text + record.values[arg] : "";
+                }
+                specAdd("s", 1);
+                length = std::snprintf(piece, sizeof(piece), spec, text);
+                break;
+            }
+            case 'p':
+                specAdd("p", 1);
+                length = std::snprintf(piece, sizeof(piece), spec,
+                                       (void*)(uintptr_t)(arg < record.argCount ? record.values[arg] : 0));
+                break;
+            default:   // Unknown (or %n): dropped
+                break;
+        }
+        if (length > 0) append(piece, (std::min)((size_t)length, sizeof(piece) - 1));
+    }
+    out[used] = '\0';
+    return used;
+}
+
+// ==================== Log Ring ====================
+// Bounded multi-producer, single-consumer queue of LogRecords (Vyukov's
+// bounded queue with the dequeue side simplified for one consumer). Each
+// cell carries a sequence number: producers claim a position with one CAS
+// and publish the cell by advancing its sequence; the consumer takes cells
+// strictly in order. A full ring rejects the record rather than wait.
+class LogRing {
+public:
+    explicit LogRing(uint32_t capacity = 4096) {
+        uint32_t size = 1;
+        while (size < capacity) size <<= 1;
+        m_cells = std::vector<Cell>(size);
+        m_mask = size - 1;
+        for (uint32_t i = 0; i < size; i++) m_cells[i].sequence.store(i, std::memory_order_relaxed);
+    }
+
+    LogRing(const LogRing&) = delete;
+    LogRing& operator=(const LogRing&) = delete;
+
+    // Producers. fill(LogRecord&) runs on the claimed cell; false when full.
+    template <typename Fill>
+    bool tryPush(Fill&& fill) {
+        size_t pos = m_enqueuePos.load(std::memory_order_relaxed);
+        Cell* cell;
+        for (;;) {
+            cell = &m_cells[pos & m_mask];
+            size_t sequence = cell->sequence.load(std::memory_order_acquire);
+            intptr_t difference = (intptr_t)sequence - (intptr_t)pos;
+            if (difference == 0) {
+                if (m_enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) break;
+            } else if (difference < 0) {
+                return false;
+            } else {
+                pos = m_enqueuePos.load(std::memory_order_relaxed);
+            }
+        }
+        fill(cell->record);
+        cell->sequence.store(pos + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer. The oldest published record, or nullptr; pop() releases it.
+    const LogRecord* front() const {
+        const Cell& cell = m_cells[m_dequeuePos & m_mask];
+        size_t sequence = cell.sequence.load(std::memory_order_acquire);
+        return sequence == m_dequeuePos + 1 ? &cell.record : nullptr;
+    }
+
+    void pop() {
+        Cell& cell = m_cells[m_dequeuePos & m_mask];
+        cell.sequence.store(m_dequeuePos + m_mask + 1, std::memory_order_release);
+        m_dequeuePos++;
+        m_consumed.store(m_dequeuePos, std::memory_order_release);
+    }
+
+    // Positions claimed by producers / released by the consumer so far
+    size_t claimed() const { return m_enqueuePos.load(std::memory_order_acquire); }
+    size_t consumed() const { return m_consumed.load(std::memory_order_acquire); }
+    uint32_t capacity() const { return m_mask + 1; }
+
+private:
+    struct Cell {
+        std::atomic<size_t> sequence{ 0 };
+        LogRecord record;
+    };
+
+    std::vector<Cell> m_cells;
+    size_t m_mask = 0;
+    alignas(64) std::atomic<size_t> m_enqueuePos{ 0 };
+    alignas(64) size_t m_dequeuePos = 0;
+    std::atomic<size_t> m_consumed{ 0 };
+};
+
+// ==================== Async Logger ====================
+// The log thread: drains the ring, formats each record and hands the line
+// to the sink, flushing the sink's streams once per batch instead of once
+// per line. On a full ring push() drops the record, counted and reported in
+// the output when there is room again, unless it is told not to drop: then
+// it yields until the log thread frees a cell (errors and warnings are
+// worth the wait).
+class AsyncLogger {
+public:
+    // level, time since start (us), formatted message
+    using Sink = void (*)(uint8_t level, int64_t timeUs, const char* message);
+    using FlushSink = void (*)();
+
+    static constexpr std::chrono::milliseconds IDLE_WAIT{ 2 };
+
+    AsyncLogger() = default;
+    ~AsyncLogger() { stop(); }
+
+    AsyncLogger(const AsyncLogger&) = delete;
+    AsyncLogger& operator=(const AsyncLogger&) = delete;
+
+    void start(Sink sink, FlushSink flush) {
+        if (m_running.load(std::memory_order_acquire)) return;
+        m_sink = sink;
+        m_flush = flush;
+        m_stop.store(false, std::memory_order_relaxed);
+        m_running.store(true, std::memory_order_release);
+        m_thread = std::thread([this] { threadMain(); });
+    }
+
+    // Writes out everything logged before the call, then ends the thread
+    void stop() {
+        if (!m_running.load(std::memory_order_acquire)) return;
+        m_running.store(false, std::memory_order_release);
+        m_stop.store(true, std::memory_order_release);
+        if (m_thread.joinable()) m_thread.join();
+    }
+
+    bool isRunning() const { return m_running.load(std::memory_order_acquire); }
+
+    template <typename... Args>
+    bool push(bool mayDrop, uint8_t level, int64_t timeUs, const char* format, const Args&... args) {
+        auto fill = [&](LogRecord& record) { LogCapture::fill(record, level, timeUs, format, args...); };
+        while (!m_ring.tryPush(fill)) {
+            if (mayDrop || !isRunning()) {
+                m_dropped.fetch_add(1, std::memory_order_relaxed);
+                return false;
+            }
+            std::this_thread::yield();
+        }
+        return true;
+    }
+
+    // Blocks until every record pushed before the call has been written
+    void flush() const {
+        size_t target = m_ring.claimed();
+        while (isRunning() && m_ring.consumed() < target) std::this_thread::sleep_for(IDLE_WAIT / 2);
+    }
+
+    uint64_t getDroppedCount() const { return m_droppedTotal.load(std::memory_order_relaxed); }
+
+private:
+    void threadMain() {
+        char line[4096];
+        int64_t lastTimeUs = 0;
+        for (;;) {
+            // Read before draining, so the final pass sees every record
+            // pushed before stop()
+            bool stopping = m_stop.load(std::memory_order_acquire);
+            uint32_t written = 0;
+            while (const LogRecord* record = m_ring.front()) {
+                formatLogRecord(*record, line, sizeof(line));
+                m_sink(record->level, record->timeUs, line);
+                lastTimeUs = record->timeUs;
+                m_ring.pop();
+                written++;
+            }
+            uint32_t dropped = m_dropped.exchange(0, std::memory_order_relaxed);
+            if (dropped) {
+                m_droppedTotal.fetch_add(dropped, std::memory_order_relaxed);
+                std::snprintf(line, sizeof(line), "Log ring full: %u messages dropped", dropped);
+                m_sink(1, lastTimeUs, line);   // As a warning
+                written++;
+            }
+            if (written && m_flush) m_flush();
+            if (stopping) break;
+            if (!written) std::this_thread::sleep_for(IDLE_WAIT);
+        }
+    }
+
+    LogRing m_ring;
+    std::thread m_thread;
+    Sink m_sink = nullptr;
+    FlushSink m_flush = nullptr;
+    std::atomic<bool> m_running{ false };
+    std::atomic<bool> m_stop{ false };
+    std::atomic<uint32_t> m_dropped{ 0 };
+    std::atomic<uint64_t> m_droppedTotal{ 0 };
+};
+
+#endif // ASYNC_LOG_H
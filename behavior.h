@@ -3,10 +3,54 @@
 #define BEHAVIOR_H
 
 #include <string>
+#include <cstdint>
+#include <atomic>
 
 // Forward declaration
 class Entity;
 
+// ==================== Behavior Type IDs ====================
+// Small dense integer per concrete behavior type, assigned on first use.
+// Used to index per-type pools and to replace dynamic_cast in lookups.
+typedef uint32_t BehaviorTypeID;
+
+static const BehaviorTypeID INVALID_BEHAVIOR_TYPE = 0xFFFFFFFFu;
+
+inline BehaviorTypeID nextBehaviorTypeID() {
+    static std::atomic<BehaviorTypeID> counter{0};
+    return counter.fetch_add(1, std::memory_order_relaxed);
+}
+
+template<typename T>
+BehaviorTypeID behaviorTypeID() {
+    static const BehaviorTypeID id = nextBehaviorTypeID();
+    return id;
+}
+
+// ==================== Behavior Access ====================
+// What a behavior type touches during update(), so the registry can run
+// independent types (and independent entities of one type) in parallel.
+enum BehaviorComponent : uint32_t {
+    COMPONENT_TRANSFORM = 1u << 0,   // Position, rotation, scale
+    COMPONENT_VELOCITY  = 1u << 1,   // Linear and angular velocity
+    COMPONENT_CAMERA    = 1u << 2,   // CameraEntity target / parameters
+    COMPONENT_ALL       = 0xFFFFFFFFu
+};
+
+// Update phases run in order; within a phase, types are ordered by access
+enum class BehaviorPhase : uint8_t {
+    Simulation = 0,   // Physics and AI
+    Camera = 1        // Follows whatever the simulation produced
+};
+
+struct BehaviorAccess {
+    uint32_t reads;          // BehaviorComponent mask (any entity)
+    uint32_t writes;         // BehaviorComponent mask
+    bool crossEntity;        // Reads or writes entities other than its own
+    bool mainThread;         // Must run on the thread calling update()
+    BehaviorPhase phase;
+};
+
 // ==================== Behavior Base Class ====================
 // Behaviors control how entities behave and respond to input
 class Behavior {
@@ -15,6 +59,8 @@ public:
         : m_name(name)
         , m_entity(nullptr)
         , m_enabled(true)
+        , m_typeID(INVALID_BEHAVIOR_TYPE)
+        , m_poolIndex(0)
     {}
     
     virtual ~Behavior() = default;
@@ -28,10 +74,17 @@ public:
     virtual void update(float deltaTime) = 0;  // Pure virtual - must implement
     virtual void shutdown() {}
     
+    // Same for every instance of a type. The default is fully serial: types
+    // must opt in to parallel updates by declaring what they touch.
+    virtual BehaviorAccess getAccess() const {
+        return { COMPONENT_ALL, COMPONENT_ALL, true, true, BehaviorPhase::Simulation };
+    }
+    
     // Getters
     const std::string& getName() const { return m_name; }
     Entity* getEntity() const { return m_entity; }
     bool isEnabled() const { return m_enabled; }
+    BehaviorTypeID getTypeID() const { return m_typeID; }  // Set when added to a registry
     
     // Setters
     void setEnabled(bool enabled) { m_enabled = enabled; }
@@ -40,6 +93,11 @@ protected:
     std::string m_name;
     Entity* m_entity;
     bool m_enabled;
+    
+private:
+    friend class EntityRegistry;
+    BehaviorTypeID m_typeID;
+    uint32_t m_poolIndex;   // Position in the registry's pool for m_typeID
 };
 
 #endif // BEHAVIOR_H
@@ -0,0 +1,127 @@
+// behavior_scheduler.h - Orders and parallelizes behavior updates by declared access
+#ifndef BEHAVIOR_SCHEDULER_H
+#define BEHAVIOR_SCHEDULER_H
+
+#include "behavior.h"
+#include "job_system.h"
+#include "profiler.h"
+#include <vector>
+#include <algorithm>
+
+// ==================== Behavior Scheduler ====================
+// Splits one update into stages using each type's BehaviorAccess:
+//  - types run in phase order, then in type-ID order
+//  - a type goes into the first stage after every earlier type it
+//    conflicts with (one writes what the other reads or writes)
+//  - types in a stage run concurrently; a type that touches only its own
+//    entity is also split into chunks of entities
+// Stages run one after another, so e.g. cameras see finished physics.
+// Behaviors must not create or destroy entities or behaviors while running
+// on a worker.
+class BehaviorScheduler {
+public:
+    static constexpr uint32_t ENTITY_GRAIN = 64;   // Behaviors per parallel chunk
+
+    void run(const std::vector<std::vector<Behavior*>>& pools, float deltaTime, JobSystem* jobs) {
+        buildOrder(pools);
+
+        if (!jobs) {
+            for (const TypeSlot& slot : m_order) {
+                updateRange(pools[slot.type], 0, (uint32_t)pools[slot.type].size(), deltaTime);
+            }
+            return;
+        }
+
+        size_t first = 0;
+        while (first < m_order.size()) {
+            uint32_t stage = m_order[first].stage;
+            size_t last = first;
+            while (last < m_order.size() && m_order[last].stage == stage) last++;
+
+            // Main-thread types first, then everything else on the pool
+            m_items.clear();
+            for (size_t k = first; k < last; k++) {
+                const TypeSlot& slot = m_order[k];
+                const std::vector<Behavior*>& pool = pools[slot.type];
+                uint32_t count = (uint32_t)pool.size();
+                if (slot.access.mainThread) {
+                    updateRange(pool, 0, count, deltaTime);
+                } else if (slot.access.crossEntity) {
+                    m_items.push_back({ slot.type, 0, count });
+                } else {
+                    for (uint32_t begin = 0; begin < count; begin += ENTITY_GRAIN) {
+                        m_items.push_back({ slot.type, begin, (std::min)(count, begin + ENTITY_GRAIN) });
+                    }
+                }
+            }
+            jobs->parallelFor((uint32_t)m_items.size(), 1, [&](uint32_t begin, uint32_t end) {
+                PROFILE_ZONE("Behavior Job");
+                for (uint32_t i = begin; i < end; i++) {
+                    const WorkItem& item = m_items[i];
+                    updateRange(pools[item.type], item.begin, item.end, deltaTime);
+                }
+            });
+            first = last;
+        }
+    }
+
+    // Number of stages in the last run (for stats / debugging)
+    uint32_t getStageCount() const { return m_order.empty() ? 0 : m_order.back().stage + 1; }
+
+private:
+    struct TypeSlot {
+        BehaviorTypeID type;
+        BehaviorAccess access;
+        uint32_t stage;
+    };
+
+    struct WorkItem {
+        BehaviorTypeID type;
+        uint32_t begin;
+        uint32_t end;
+    };
+
+    static bool conflicts(const BehaviorAccess& a, const BehaviorAccess& b) {
+        return (a.writes & (b.reads | b.writes)) != 0 || (b.writes & a.reads) != 0;
+    }
+
+    static void updateRange(const std::vector<Behavior*>& pool, uint32_t begin, uint32_t end, float deltaTime) {
+        for (uint32_t i = begin; i < end && i < pool.size(); i++) {
+            Behavior* behavior = pool[i];
+            if (behavior->isEnabled()) {
+                behavior->update(deltaTime);
+            }
+        }
+    }
+
+    void buildOrder(const std::vector<std::vector<Behavior*>>& pools) {
+        m_order.clear();
+        for (BehaviorTypeID type = 0; type < (BehaviorTypeID)pools.size(); type++) {
+            if (pools[type].empty()) continue;
+            m_order.push_back({ type, pools[type].front()->getAccess(), 0 });
+        }
+        std::stable_sort(m_order.begin(), m_order.end(), [](const TypeSlot& a, const TypeSlot& b) {
+            return a.access.phase < b.access.phase;
+        });
+
+        for (size_t k = 0; k < m_order.size(); k++) {
+            uint32_t stage = 0;
+            for (size_t j = 0; j < k; j++) {
+                const TypeSlot& earlier = m_order[j];
+                if (earlier.access.phase != m_order[k].access.phase ||
+                    conflicts(earlier.access, m_order[k].access)) {
+                    stage = (std::max)(stage, earlier.stage + 1);
+                }
+            }
+            m_order[k].stage = stage;
+        }
+        std::stable_sort(m_order.begin(), m_order.end(), [](const TypeSlot& a, const TypeSlot& b) {
+            return a.stage < b.stage;
+        });
+    }
+
+    std::vector<TypeSlot> m_order;   // Reused every update
+    std::vector<WorkItem> m_items;
+};
+
+#endif // BEHAVIOR_SCHEDULER_H
@@ -0,0 +1,253 @@
+// bench.h - Timing harness and result files for cube_bench
+#ifndef BENCH_H
+#define BENCH_H
+
+#include "math_simd.h"
+#include <nlohmann/json.hpp>
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+// ==================== Optimization Barrier ====================
+// Makes 'value' observable so the compiler cannot drop the work that
+// produced it
+template <typename T>
+inline void benchKeep(const T& value) {
+#if defined(_MSC_VER)
+    static volatile const void* sink;
+    sink = &value;
+    _ReadWriteBarrier();
+#else
+    asm volatile("" : : "g"(&value) : "memory");
+#endif
+}
+
+// ==================== Bench Result ====================
+struct BenchResult {
+    std::string name;              // "group/what/size", unique per run
+    std::string group;             // "micro" or "scenario"
+    uint64_t iterations = 0;       // Per sample
+    uint32_t samples = 0;
+    double nsPerOp = 0.0;          // Median sample; what --compare checks
+    double minNsPerOp = 0.0;
+    double maxNsPerOp = 0.0;
+    double itemsPerOp = 1.0;       // Entities, pixels, ... handled per op
+    std::vector<std::pair<std::string, double>> metrics;   // Extra per-result numbers
+};
+
+// ==================== Bench Runner ====================
+// run() calibrates an iteration count so one sample takes about
+// minTime / samples, then times 'samples' samples of it and reports the
+// median. A body is called as body(iterations) and must do its operation
+// that many times; setup belongs outside the body.
+class BenchRunner {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    void setMinTime(double seconds) { m_minTime = seconds; }
+    void setSamples(uint32_t samples) { m_samples = (std::max)(samples, 1u); }
+    void setFilter(const std::string& filter) { m_filter = filter; }
+    void setListOnly(bool listOnly) { m_listOnly = listOnly; }
+
+    // Names containing the filter run; listing prints them instead
+    bool selected(const std::string& name) const {
+        if (!m_filter.empty() && name.find(m_filter) == std::string::npos) return false;
+        if (m_listOnly) {
+            std::printf("%s\n", name.c_str());
+            return false;
+        }
+        return true;
+    }
+
+    template <typename Body>
+    void run(const std::string& name, double itemsPerOp, Body&& body) {
+        if (!selected(name)) return;
+
+        const double target = m_minTime / m_samples;
+        uint64_t iterations = 1;
+        for (;;) {
+            double seconds = timeIterations(body, iterations);
+            if (seconds >= target || iterations >= MAX_ITERATIONS) break;
+            // Aim a little past the target; never grow more than 100x a step
+            double scale = seconds > 0.0 ? target / seconds * 1.2 : 100.0;
+            scale = (std::min)((std::max)(scale, 2.0), 100.0);
+            iterations = (std::min)((uint64_t)(iterations * scale), MAX_ITERATIONS);
+        }
+
+        std::vector<double> perOp(m_samples);
+        for (double& ns : perOp) ns = timeIterations(body, iterations) * 1e9 / (double)iterations;
+        std::sort(perOp.begin(), perOp.end());
+
+        BenchResult result;
+        result.name = name;
+        result.group = "micro";
+        result.iterations = iterations;
+        result.samples = m_samples;
+        result.nsPerOp = perOp[perOp.size() / 2];
+        result.minNsPerOp = perOp.front();
+        result.maxNsPerOp = perOp.back();
+        result.itemsPerOp = itemsPerOp;
+        add(result);
+    }
+
+    // Runs f inside a body without counting its time, for upkeep the
+    // measured operation needs between iterations (draining a queue)
+    template <typename F>
+    void untimed(F&& f) {
+        Clock::time_point start = Clock::now();
+        f();
+        m_untimed += Clock::now() - start;
+    }
+
+    // For results measured by the caller (scenarios)
+    void add(const BenchResult& result) {
+        printResult(result);
+        m_results.push_back(result);
+    }
+
+    const std::vector<BenchResult>& getResults() const { return m_results; }
+
+    bool writeJson(const std::string& path) const {
+        nlohmann::json root;
+        root["version"] = 1;
+        root["build"] = buildInfo();
+        nlohmann::json& results = root["results"];
+        results = nlohmann::json::array();
+        for (const BenchResult& r : m_results) {
+            nlohmann::json entry;
+            entry["name"] = r.name;
+            entry["group"] = r.group;
+            entry["iterations"] = r.iterations;
+            entry["samples"] = r.samples;
+            entry["ns_per_op"] = r.nsPerOp;
+            entry["min_ns_per_op"] = r.minNsPerOp;
+            entry["max_ns_per_op"] = r.maxNsPerOp;
+            entry["items_per_op"] = r.itemsPerOp;
+            nlohmann::json metrics = nlohmann::json::object();
+            for (const auto& metric : r.metrics) metrics[metric.first] = metric.second;
+            entry["metrics"] = metrics;
+            results.push_back(entry);
+        }
+
+        std::ofstream file(path);
+        if (!file) {
+            std::fprintf(stderr, "cube_bench: cannot write %s\n", path.c_str());
+            return false;
+        }
+        file << root.dump(2) << "\n";
+        return (bool)file;
+    }
+
+    // Compares against an earlier writeJson() file by name. Returns the
+    // number of results slower than the baseline by more than
+    // 'thresholdPercent', or -1 if the baseline cannot be read.
+    int compare(const std::string& baselinePath, double thresholdPercent) const {
+        std::ifstream file(baselinePath);
+        nlohmann::json baseline = nlohmann::json::parse(file, nullptr, false);
+        if (!file || baseline.is_discarded() || !baseline.contains("results")) {
+            std::fprintf(stderr, "cube_bench: cannot read baseline %s\n", baselinePath.c_str());
+            return -1;
+        }
+
+        std::printf("\n%-44s %12s %12s %9s\n", "Compared to baseline", "baseline", "now", "change");
+        int regressions = 0;
+        for (const BenchResult& r : m_results) {
+            const nlohmann::json* match = nullptr;
+            for (const nlohmann::json& entry : baseline["results"]) {
+                if (entry.value("name", std::string()) == r.name) {
+                    match = &entry;
+                    break;
+                }
+            }
+            if (!match) continue;
+            double before = match->value("ns_per_op", 0.0);
+            if (before <= 0.0) continue;
+            double change = (r.nsPerOp - before) / before * 100.0;
+            bool regressed = change > thresholdPercent;
+            if (regressed) regressions++;
+            std::printf("%-44s %12s %12s %+8.1f%%%s\n", r.name.c_str(),
+                        formatNs(before).c_str(), formatNs(r.nsPerOp).c_str(), change,
+                        regressed ? "  REGRESSION" : "");
+        }
+        return regressions;
+    }
+
+    static void printHeader() {
+        std::printf("%-44s %12s %12s %14s\n", "Benchmark", "median", "min", "items/s");
+    }
+
+    static std::string formatNs(double ns) {
+        char text[32];
+        if (ns < 1e3) std::snprintf(text, sizeof(text), "%.1f ns", ns);
+        else if (ns < 1e6) std::snprintf(text, sizeof(text), "%.2f us", ns / 1e3);
+        else if (ns < 1e9) std::snprintf(text, sizeof(text), "%.2f ms", ns / 1e6);
+        else std::snprintf(text, sizeof(text), "%.2f s", ns / 1e9);
+        return text;
+    }
+
+    static nlohmann::json buildInfo() {
+        nlohmann::json info;
+#if defined(_MSC_VER)
+        info["compiler"] = "msvc " + std::to_string(_MSC_VER);
+#elif defined(__clang__)
+        info["compiler"] = std::string("clang ") + __clang_version__;
+#elif defined(__GNUC__)
+        info["compiler"] = std::string("gcc ") + __VERSION__;
+#else
+        info["compiler"] = "unknown";
+#endif
+#ifdef NDEBUG
+        info["config"] = "Release";
+#else
+        info["config"] = "Debug";
+#endif
+        info["hardware_threads"] = std::thread::hardware_concurrency();
+        info["math_simd"] = mathSimdName();
+        return info;
+    }
+
+private:
+    static constexpr uint64_t MAX_ITERATIONS = 1ull << 32;
+
+    template <typename Body>
+    double timeIterations(Body& body, uint64_t iterations) {
+        m_untimed = Clock::duration::zero();
+        Clock::time_point start = Clock::now();
+        body(iterations);
+        return std::chrono::duration<double>(Clock::now() - start - m_untimed).count();
+    }
+
+    static void printResult(const BenchResult& r) {
+        double itemsPerSecond = r.nsPerOp > 0.0 ? r.itemsPerOp * 1e9 / r.nsPerOp : 0.0;
+        char rate[32];
+        if (itemsPerSecond >= 1e9) std::snprintf(rate, sizeof(rate), "%.2f G", itemsPerSecond / 1e9);
+        else if (itemsPerSecond >= 1e6) std::snprintf(rate, sizeof(rate), "%.2f M", itemsPerSecond / 1e6);
+        else if (itemsPerSecond >= 1e3) std::snprintf(rate, sizeof(rate), "%.2f K", itemsPerSecond / 1e3);
+        else std::snprintf(rate, sizeof(rate), "%.1f", itemsPerSecond);
+        std::printf("%-44s %12s %12s %14s\n", r.name.c_str(),
+                    formatNs(r.nsPerOp).c_str(), formatNs(r.minNsPerOp).c_str(), rate);
+        for (const auto& metric : r.metrics) {
+            std::printf("    %-40s %12.3f\n", metric.first.c_str(), metric.second);
+        }
+        std::fflush(stdout);
+    }
+
+    double m_minTime = 0.5;
+    uint32_t m_samples = 9;
+    std::string m_filter;
+    bool m_listOnly = false;
+    Clock::duration m_untimed{};     // untimed() time in the current sample
+    std::vector<BenchResult> m_results;
+};
+
+#endif // BENCH_H
@@ -37,11 +37,13 @@ public:
         idealPos.y = targetPos.y + m_height;
         idealPos.z = targetPos.z + m_distance * cosf(yaw);
         
-        // Smooth interpolation
+        // Smooth interpolation; m_smoothness is the per-frame factor at 60 Hz,
+        // rescaled so the lag is the same at any step size
+        float s = powf(m_smoothness, deltaTime * 60.0f);
         Vec3 currentPos = m_entity->getPosition();
-        currentPos.x = currentPos.x * m_smoothness + idealPos.x * (1.0f - m_smoothness);
-        currentPos.y = currentPos.y * m_smoothness + idealPos.y * (1.0f - m_smoothness);
-        currentPos.z = currentPos.z * m_smoothness + idealPos.z * (1.0f - m_smoothness);
+        currentPos.x = currentPos.x * s + idealPos.x * (1.0f - s);
+        currentPos.y = currentPos.y * s + idealPos.y * (1.0f - s);
+        currentPos.z = currentPos.z * s + idealPos.z * (1.0f - s);
         m_entity->setPosition(currentPos);
         
         // Look at target (slightly ahead)
@@ -56,6 +58,11 @@ public:
         }
     }
     
+    // Reads the target entity and moves its own camera entity
+    BehaviorAccess getAccess() const override {
+        return { COMPONENT_TRANSFORM, COMPONENT_TRANSFORM | COMPONENT_CAMERA, true, false, BehaviorPhase::Camera };
+    }
+    
     void setDistance(float distance) { m_distance = distance; }
     void setHeight(float height) { m_height = height; }
     void setSmoothness(float smoothness) { m_smoothness = smoothness; }
@@ -109,6 +116,11 @@ public:
         }
     }
     
+    // Reads the target entity and moves its own camera entity
+    BehaviorAccess getAccess() const override {
+        return { COMPONENT_TRANSFORM, COMPONENT_TRANSFORM | COMPONENT_CAMERA, true, false, BehaviorPhase::Camera };
+    }
+    
     void rotate(float deltaYaw, float deltaPitch) {
         m_yaw += deltaYaw;
         m_pitch += deltaPitch;
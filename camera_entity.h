@@ -8,8 +8,8 @@
 // Camera is now an entity that can have position, rotation, and behaviors
 class CameraEntity : public Entity {
 public:
-    CameraEntity(EntityID id, const std::string& name)
-        : Entity(id, name)
+    CameraEntity(EntityID id, const std::string& name, EntityStorage* storage = nullptr)
+        : Entity(id, name, storage)
         , m_fov(75.0f)
         , m_nearPlane(0.1f)
         , m_farPlane(10000.0f)
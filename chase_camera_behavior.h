@@ -44,10 +44,12 @@ public:
         idealPos.y = entityPos.y + m_height;
         idealPos.z = entityPos.z + m_distance * cosf(yaw);
         
-        // Smooth interpolation
-        m_cameraPosition.x = m_cameraPosition.x * m_smoothness + idealPos.x * (1.0f - m_smoothness);
-        m_cameraPosition.y = m_cameraPosition.y * m_smoothness + idealPos.y * (1.0f - m_smoothness);
-        m_cameraPosition.z = m_cameraPosition.z * m_smoothness + idealPos.z * (1.0f - m_smoothness);
+        // Smooth interpolation; m_smoothness is the per-frame factor at 60 Hz,
+        // rescaled so the lag is the same at any step size
+        float s = powf(m_smoothness, deltaTime * 60.0f);
+        m_cameraPosition.x = m_cameraPosition.x * s + idealPos.x * (1.0f - s);
+        m_cameraPosition.y = m_cameraPosition.y * s + idealPos.y * (1.0f - s);
+        m_cameraPosition.z = m_cameraPosition.z * s + idealPos.z * (1.0f - s);
         
         // Look at entity (with slight offset forward)
         Vec3 targetOffset;
@@ -60,6 +62,11 @@ public:
         m_cameraTarget.z = entityPos.z + targetOffset.z;
     }
     
+    // Reads its own entity only; the camera pose is private state
+    BehaviorAccess getAccess() const override {
+        return { COMPONENT_TRANSFORM, 0, false, false, BehaviorPhase::Camera };
+    }
+    
     // Getters
     Vec3 getCameraPosition() const { return m_cameraPosition; }
     Vec3 getCameraTarget() const { return m_cameraTarget; }
@@ -0,0 +1,720 @@
+// cube_bench.cpp - Micro and scenario benchmarks for the engine hot paths
+//
+// Micro benchmarks time one function in a loop on synthetic data; scenario
+// benchmarks fly a fixed camera path over a synthetic instanced Scene on a
+// real renderer. Results print as a table and, with --json, are written in
+// a form --compare can check later runs against.
+#include "bench.h"
+#include "math_utils.h"
+#include "renderer.h"
+#include "scene.h"
+#include "entity.h"
+#include "entity_registry.h"
+#include "behavior.h"
+#include "job_system.h"
+#include "flight_dynamics.h"
+#include "flight_recorder.h"
+#include "dds_loader.h"
+#include "normal_map_gen.h"
+#include "profiler.h"
+#include <GLFW/glfw3.h>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// ==================== Synthetic Data ====================
+// Same sequence on every run and platform
+class BenchRandom {
+public:
+    explicit BenchRandom(uint32_t seed) : m_state(seed ? seed : 1u) {}
+
+    uint32_t next() {
+        m_state ^= m_state << 13;
+        m_state ^= m_state >> 17;
+        m_state ^= m_state << 5;
+        return m_state;
+    }
+
+    float uniform(float lo, float hi) { return lo + (hi - lo) * (float)(next() >> 8) * (1.0f / 16777216.0f); }
+
+private:
+    uint32_t m_state;
+};
+
+static Mat4 randomTransform(BenchRandom& random) {
+    Vec3 position = { random.uniform(-50, 50), random.uniform(-50, 50), random.uniform(-50, 50) };
+    Vec3 rotation = { random.uniform(-3, 3), random.uniform(-3, 3), random.uniform(-3, 3) };
+    Vec3 scale = { random.uniform(0.5f, 2), random.uniform(0.5f, 2), random.uniform(0.5f, 2) };
+    return Entity::composeTransform(position, rotation, scale);
+}
+
+// Unit cube, four vertices per face so normals and UVs are per face
+static void buildCubeModel(Model& model) {
+    static const float faces[6][3][3] = {
+        // normal          tangent          bitangent (normal x tangent)
+        { { 1, 0, 0 },  { 0, 0, -1 }, { 0, 1, 0 } },
+        { { -1, 0, 0 }, { 0, 0, 1 },  { 0, 1, 0 } },
+        { { 0, 1, 0 },  { 1, 0, 0 },  { 0, 0, -1 } },
+        { { 0, -1, 0 }, { 1, 0, 0 },  { 0, 0, 1 } },
+        { { 0, 0, 1 },  { 1, 0, 0 },  { 0, 1, 0 } },
+        { { 0, 0, -1 }, { -1, 0, 0 }, { 0, 1, 0 } },
+    };
+    static const float corners[4][2] = { { -1, -1 }, { 1, -1 }, { 1, 1 }, { -1, 1 } };
+
+    model.clear();
+    model.meshes.resize(1);
+    ModelMesh& mesh = model.meshes[0];
+    for (const auto& face : faces) {
+        const float* n = face[0];
+        const float* t = face[1];
+        const float* b = face[2];
+        uint32_t base = (uint32_t)mesh.vertices.size();
+        for (const auto& c : corners) {
+            ModelVertex v;
+            v.px = 0.5f * (n[0] + c[0] * t[0] + c[1] * b[0]);
+            v.py = 0.5f * (n[1] + c[0] * t[1] + c[1] * b[1]);
+            v.pz = 0.5f * (n[2] + c[0] * t[2] + c[1] * b[2]);
+            v.nx = n[0]; v.ny = n[1]; v.nz = n[2];
+            v.u = c[0] * 0.5f + 0.5f;
+            v.v = c[1] * 0.5f + 0.5f;
+            v.tx = t[0]; v.ty = t[1]; v.tz = t[2];
+            v.bx = b[0]; v.by = b[1]; v.bz = b[2];
+            mesh.vertices.push_back(v);
+        }
+        const uint32_t quad[6] = { 0, 1, 2, 0, 2, 3 };
+        for (uint32_t i : quad) mesh.indices.push_back(base + i);
+    }
+    model.computeBounds();
+}
+
+// Block-compressed image of random blocks (decode cost does not depend on content)
+static void buildDDSImage(DDSImage& image, CompressedFormat format, int size) {
+    image.format = format;
+    image.width = size;
+    image.height = size;
+    uint32_t rowPitch = (uint32_t)((size + 3) / 4) * DDSLoader::BlockSize(format);
+    uint32_t rows = (uint32_t)((size + 3) / 4);
+    image.data.resize((size_t)rowPitch * rows);
+    BenchRandom random(0xDD5u);
+    for (uint8_t& byte : image.data) byte = (uint8_t)random.next();
+
+    CompressedMip mip;
+    mip.data = image.data.data();
+    mip.size = rowPitch * rows;
+    mip.rowPitch = rowPitch;
+    mip.rows = rows;
+    mip.width = size;
+    mip.height = size;
+    image.mips.assign(1, mip);
+}
+
+// Integrates its entity's rotation: the cheapest useful behavior, so the
+// registry and scheduler overhead dominates
+class BenchSpinBehavior : public Behavior {
+public:
+    BenchSpinBehavior() : Behavior("BenchSpin") {}
+
+    void update(float deltaTime) override {
+        Vec3 rotation = m_entity->getRotation();
+        Vec3 rate = m_entity->getAngularVelocity();
+        m_entity->setRotation({ rotation.x + rate.x * deltaTime, rotation.y + rate.y * deltaTime,
+                                rotation.z + rate.z * deltaTime });
+    }
+
+    BehaviorAccess getAccess() const override {
+        return { COMPONENT_VELOCITY, COMPONENT_TRANSFORM, false, false, BehaviorPhase::Simulation };
+    }
+};
+
+// ==================== Micro Benchmarks ====================
+static void benchMath(BenchRunner& runner) {
+    static const uint32_t COUNT = 256;   // Fits in L1 with the outputs
+    std::vector<Mat4> a(COUNT), b(COUNT), out(COUNT);
+    BenchRandom random(1);
+    for (uint32_t i = 0; i < COUNT; i++) {
+        a[i] = randomTransform(random);
+        b[i] = randomTransform(random);
+    }
+
+    runner.run("math/mat4_mul", 1.0, [&](uint64_t iterations) {
+        for (uint64_t i = 0; i < iterations; i++) {
+            uint32_t k = (uint32_t)i & (COUNT - 1);
+            out[k] = mat4_mul(a[k], b[(k + 1) & (COUNT - 1)]);
+            benchKeep(out[k]);
+        }
+    });
+
+    runner.run("math/mat4_transpose", 1.0, [&](uint64_t iterations) {
+        for (uint64_t i = 0; i < iterations; i++) {
+            uint32_t k = (uint32_t)i & (COUNT - 1);
+            out[k] = mat4_transpose(a[k]);
+            benchKeep(out[k]);
+        }
+    });
+
+    // View-projection times every world matrix, as for per-entity MVPs
+    static const uint32_t BATCH = 1024;
+    std::vector<Mat4> worlds(BATCH), mvps(BATCH);
+    for (Mat4& world : worlds) world = randomTransform(random);
+    Mat4 viewProj = mat4_mul(mat4_perspectiveRH_NO(1.3f, 16.0f / 9.0f, 0.1f, 10000.0f),
+                             mat4_lookAtRH({ 30, 20, 30 }, { 0, 0, 0 }, { 0, 1, 0 }));
+    runner.run("math/mat4_mul_batch_1k", BATCH, [&](uint64_t iterations) {
+        for (uint64_t i = 0; i < iterations; i++) {
+            mat4_mulBatch(viewProj, worlds.data(), mvps.data(), BATCH);
+            benchKeep(mvps[0]);
+        }
+    });
+
+    Frustum frustum = Frustum::fromViewProj(viewProj);
+    std::vector<Vec4> spheres(COUNT);
+    for (Vec4& sphere : spheres) {
+        sphere = { random.uniform(-80, 80), random.uniform(-80, 80), random.uniform(-80, 80), random.uniform(0.5f, 5) };
+    }
+    runner.run("math/frustum_test_sphere", 1.0, [&](uint64_t iterations) {
+        for (uint64_t i = 0; i < iterations; i++) {
+            const Vec4& sphere = spheres[i & (COUNT - 1)];
+            FrustumTest test = frustum.testSphere({ sphere.x, sphere.y, sphere.z }, sphere.w);
+            benchKeep(test);
+        }
+    });
+
+    std::vector<Vec3> positions(COUNT), rotations(COUNT), scales(COUNT);
+    for (uint32_t i = 0; i < COUNT; i++) {
+        positions[i] = { random.uniform(-50, 50), random.uniform(-50, 50), random.uniform(-50, 50) };
+        rotations[i] = { random.uniform(-3, 3), random.uniform(-3, 3), random.uniform(-3, 3) };
+        scales[i] = { 1, 1, 1 };
+    }
+    runner.run("math/compose_transform", 1.0, [&](uint64_t iterations) {
+        for (uint64_t i = 0; i < iterations; i++) {
+            uint32_t k = (uint32_t)i & (COUNT - 1);
+            out[k] = Entity::composeTransform(positions[k], rotations[k], scales[k]);
+            benchKeep(out[k]);
+        }
+    });
+}
+
+static void benchEntities(BenchRunner& runner) {
+    static const uint32_t TRANSFORM_ENTITIES = 1024;
+    {
+        EntityRegistry registry;
+        std::vector<Entity*> entities;
+        BenchRandom random(2);
+        for (uint32_t i = 0; i < TRANSFORM_ENTITIES; i++) {
+            Entity* entity = registry.createEntity("bench");
+            entity->setPosition({ random.uniform(-50, 50), random.uniform(-50, 50), random.uniform(-50, 50) });
+            entity->setRotation({ random.uniform(-3, 3), random.uniform(-3, 3), random.uniform(-3, 3) });
+            entities.push_back(entity);
+        }
+        // Settled, as scenery is after its first frame: reads the cached matrix
+        registry.getStorage().savePreviousTransforms();
+        registry.getStorage().updateWorldTransforms(1.0f);
+        runner.run("entity/get_transform_matrix", 1.0, [&](uint64_t iterations) {
+            for (uint64_t i = 0; i < iterations; i++) {
+                Mat4 world = entities[i & (TRANSFORM_ENTITIES - 1)]->getTransformMatrix();
+                benchKeep(world);
+            }
+        });
+    }
+
+    // 10k entities, every fourth one riding on the entity before it. Static:
+    // nothing changed since the last pass. Moving: every root moved this
+    // step, so the whole hierarchy is blended again.
+    {
+        static const uint32_t HIERARCHY_ENTITIES = 10000;
+        EntityRegistry registry;
+        EntityStorage& storage = registry.getStorage();
+        std::vector<Entity*> roots;
+        BenchRandom random(4);
+        Entity* previous = nullptr;
+        for (uint32_t i = 0; i < HIERARCHY_ENTITIES; i++) {
+            Entity* entity = registry.createEntity("bench");
+            entity->setPosition({ random.uniform(-50, 50), random.uniform(-50, 50), random.uniform(-50, 50) });
+            entity->setRotation({ random.uniform(-3, 3), random.uniform(-3, 3), random.uniform(-3, 3) });
+            if (i % 4 == 3) entity->setParent(previous);
+            else roots.push_back(entity);
+            previous = entity;
+        }
+        storage.savePreviousTransforms();
+        storage.updateWorldTransforms(1.0f);
+
+        runner.run("entity/update_world_transforms_static/10k", HIERARCHY_ENTITIES, [&](uint64_t iterations) {
+            for (uint64_t i = 0; i < iterations; i++) benchKeep(storage.updateWorldTransforms(0.5f));
+        });
+        for (Entity* root : roots) root->setPosition(v3_add(root->getPosition(), { 0.1f, 0.0f, 0.0f }));
+        runner.run("entity/update_world_transforms_moving/10k", HIERARCHY_ENTITIES, [&](uint64_t iterations) {
+            for (uint64_t i = 0; i < iterations; i++) benchKeep(storage.updateWorldTransforms(0.5f));
+        });
+    }
+
+    // Serial, then on the job system the app uses by default
+    std::unique_ptr<JobSystem> jobs(new JobSystem());
+    const uint32_t counts[] = { 1000, 10000, 100000 };
+    for (uint32_t count : counts) {
+        std::string size = count >= 1000 ? std::to_string(count / 1000) + "k" : std::to_string(count);
+        std::string serialName = "ecs/registry_update/" + size;
+        std::string parallelName = "ecs/registry_update_mt/" + size;
+        if (!runner.selected(serialName) && !runner.selected(parallelName)) continue;
+
+        EntityRegistry registry;
+        BenchRandom random(3);
+        for (uint32_t i = 0; i < count; i++) {
+            Entity* entity = registry.createEntity("bench");
+            entity->setAngularVelocity({ random.uniform(-1, 1), random.uniform(-1, 1), random.uniform(-1, 1) });
+            registry.addBehavior<BenchSpinBehavior>(entity->getID());
+        }
+
+        runner.run(serialName, count, [&](uint64_t iterations) {
+            for (uint64_t i = 0; i < iterations; i++) registry.update(1.0f / 120.0f);
+        });
+        registry.setJobSystem(jobs.get());
+        runner.run(parallelName, count, [&](uint64_t iterations) {
+            for (uint64_t i = 0; i < iterations; i++) registry.update(1.0f / 120.0f);
+        });
+        registry.setJobSystem(nullptr);
+    }
+}
+
+static void benchFlightDynamics(BenchRunner& runner) {
+    static const uint64_t STEPS_PER_FLIGHT = 1200;   // Restart every 10 simulated seconds
+    FlightDynamics dynamics;
+    auto restart = [&]() {
+        dynamics.initialize({ 0.0f, 500.0f, 0.0f }, 0.0f);
+        dynamics.getControlInputs().throttle = 0.7f;
+        dynamics.getControlInputs().elevator = 0.1f;
+        dynamics.getControlInputs().aileron = 0.05f;
+    };
+    restart();
+    runner.run("physics/flight_dynamics_update", 1.0, [&](uint64_t iterations) {
+        for (uint64_t i = 0; i < iterations; i++) {
+            if (i % STEPS_PER_FLIGHT == 0) restart();
+            dynamics.update(1.0f / 120.0f);
+            benchKeep(dynamics.getState());
+        }
+    });
+
+    // Simulation-thread cost of recording one step of a fleet. The writer
+    // thread encodes far slower than the steps are recorded here, so the
+    // ring is drained outside the timed region whenever it could not take
+    // another step; otherwise most steps would be dropped, which skips the
+    // stores being measured.
+    static const uint32_t RECORDED_AIRCRAFT = 500;
+    static const char* RECORDING_FILE = "bench_flight_recording.bin";
+    if (runner.selected("physics/flight_recorder_tick_500")) {
+        std::vector<AircraftState> states(RECORDED_AIRCRAFT, dynamics.getState());
+        ControlInputs controls = dynamics.getControlInputs();
+        FlightRecorder recorder;
+        if (recorder.open(RECORDING_FILE, 1.0 / 120.0)) {
+            const uint64_t ticksPerDrain = (std::min)((uint64_t)FlightRecorder::TICK_CAPACITY,
+                (uint64_t)FlightRecorder::DEFAULT_SAMPLE_CAPACITY / RECORDED_AIRCRAFT);
+            uint64_t tick = 0;
+            runner.run("physics/flight_recorder_tick_500", RECORDED_AIRCRAFT, [&](uint64_t iterations) {
+                for (uint64_t i = 0; i < iterations; i++) {
+                    if (tick % ticksPerDrain == 0) runner.untimed([&] { recorder.flush(); });
+                    recorder.beginTick(tick++);
+                    for (uint32_t a = 0; a < RECORDED_AIRCRAFT; a++) recorder.record(a + 1, states[a], controls);
+                    recorder.endTick();
+                }
+            });
+            if (recorder.getDroppedTicks() != 0) {
+                std::fprintf(stderr, "physics/flight_recorder_tick_500: %llu of %llu steps dropped\n",
+                             (unsigned long long)recorder.getDroppedTicks(), (unsigned long long)tick);
+            }
+            recorder.close();
+            std::remove(RECORDING_FILE);
+        }
+    }
+}
+
+static void benchTextures(BenchRunner& runner) {
+    static const int DDS_SIZE = 1024;
+    const struct { CompressedFormat format; const char* name; } formats[] = {
+        { CompressedFormat::BC1, "texture/dds_decode_bc1_1024" },
+        { CompressedFormat::BC2, "texture/dds_decode_bc2_1024" },
+        { CompressedFormat::BC3, "texture/dds_decode_bc3_1024" },
+    };
+    for (const auto& entry : formats) {
+        if (!runner.selected(entry.name)) continue;
+        DDSImage image;
+        buildDDSImage(image, entry.format, DDS_SIZE);
+        runner.run(entry.name, (double)DDS_SIZE * DDS_SIZE, [&](uint64_t iterations) {
+            for (uint64_t i = 0; i < iterations; i++) {
+                unsigned char* rgba = DDSLoader::Decompress(image, 0);
+                benchKeep(rgba[0]);
+                delete[] rgba;
+            }
+        });
+    }
+
+    // Serial, then split by row over the job system
+    std::unique_ptr<JobSystem> jobs(new JobSystem());
+    const int sizes[] = { 256, 1024, 2048 };
+    for (int size : sizes) {
+        for (JobSystem* pool : { (JobSystem*)nullptr, jobs.get() }) {
+            std::string suffix = std::string(pool ? "_mt_" : "_") + std::to_string(size);
+            runner.run("texture/rivet_normal_map" + suffix, (double)size * size, [&](uint64_t iterations) {
+                for (uint64_t i = 0; i < iterations; i++) {
+                    std::vector<uint8_t> data = generateRivetNormalMap(size, size, pool);
+                    benchKeep(data[0]);
+                }
+            });
+            runner.run("texture/procedural_normal_map" + suffix, (double)size * size, [&](uint64_t iterations) {
+                for (uint64_t i = 0; i < iterations; i++) {
+                    std::vector<uint8_t> data = generateProceduralNormalMap(size, size, pool);
+                    benchKeep(data[0]);
+                }
+            });
+        }
+    }
+
+    // A repeat launch: the map comes from the shader cache directory
+    static const int CACHED_SIZE = 2048;
+    if (runner.selected("texture/normal_map_cache_load_2048")) {
+        benchKeep(cachedRivetNormalMap(CACHED_SIZE, CACHED_SIZE, jobs.get())[0]);   // Fill the cache
+        runner.run("texture/normal_map_cache_load_2048", (double)CACHED_SIZE * CACHED_SIZE, [&](uint64_t iterations) {
+            for (uint64_t i = 0; i < iterations; i++) {
+                std::vector<uint8_t> data = cachedRivetNormalMap(CACHED_SIZE, CACHED_SIZE, jobs.get());
+                benchKeep(data[0]);
+            }
+        });
+    }
+}
+
+// ==================== Scenario Benchmarks ====================
+struct ScenarioOptions {
+    std::vector<RendererAPI> apis;
+    std::vector<uint32_t> instanceCounts;
+    uint32_t frames = 600;        // Measured, one camera orbit
+    uint32_t warmupFrames = 60;   // Let drivers, caches and GPU timers settle
+    bool vsync = false;
+    int width = 1280;
+    int height = 720;
+};
+
+static const char* apiName(RendererAPI api) {
+    switch (api) {
+        case RendererAPI::OpenGL: return "gl";
+        case RendererAPI::Direct3D11: return "d3d11";
+        case RendererAPI::Direct3D12: return "d3d12";
+    }
+    return "unknown";
+}
+
+static std::string scenarioName(RendererAPI api, uint32_t instances) {
+    return std::string("scenario/") + apiName(api) + "/instances_" + std::to_string(instances);
+}
+
+static double percentile(std::vector<double> values, double p) {
+    if (values.empty()) return 0.0;
+    std::sort(values.begin(), values.end());
+    size_t index = (size_t)(p * (double)(values.size() - 1) + 0.5);
+    return values[(std::min)(index, values.size() - 1)];
+}
+
+// Instances on a square grid, the camera orbiting it once over the measured
+// frames at a height that keeps part of the grid outside the frustum
+static bool runScenario(BenchRunner& runner, RendererAPI api, uint32_t instances, const ScenarioOptions& options) {
+    std::string name = scenarioName(api, instances);
+
+    glfwDefaultWindowHints();
+    if (api == RendererAPI::OpenGL) {
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+        glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+        glfwWindowHint(GLFW_DEPTH_BITS, 24);
+    } else {
+        glfwWindowHint(GLFW_CLIENT_API, GLFW_NO_API);
+    }
+    glfwWindowHint(GLFW_RESIZABLE, GLFW_FALSE);
+    GLFWwindow* window = glfwCreateWindow(options.width, options.height, "cube_bench", nullptr, nullptr);
+    if (!window) {
+        std::fprintf(stderr, "cube_bench: cannot create a window for %s\n", name.c_str());
+        return false;
+    }
+    if (api == RendererAPI::OpenGL) glfwMakeContextCurrent(window);
+
+    IRenderer* renderer = createRenderer(api);
+    if (!renderer || !renderer->initialize(window)) {
+        std::fprintf(stderr, "cube_bench: %s renderer is not available\n", apiName(api));
+        delete renderer;
+        glfwDestroyWindow(window);
+        return false;
+    }
+    renderer->setVSync(options.vsync);
+    int fbWidth, fbHeight;
+    glfwGetFramebufferSize(window, &fbWidth, &fbHeight);
+    renderer->setViewport(fbWidth, fbHeight);
+    renderer->setClearColor(0.2f, 0.3f, 0.4f, 1.0f);
+
+    uint32_t shader = renderer->createShader(OPENGL_VERTEX_SHADER, OPENGL_FRAGMENT_SHADER);
+    renderer->useShader(shader);
+    renderer->setUniformInt(shader, "uTexture", 0);
+    renderer->setUniformInt(shader, "uNormalMap", 1);
+    renderer->setDepthTest(true);
+    renderer->setCulling(false);
+
+    Model cube;
+    buildCubeModel(cube);
+    std::vector<Vertex> vertices;
+    for (const ModelVertex& v : cube.meshes[0].vertices) vertices.push_back(modelVertexToVertex(v));
+    uint32_t mesh = renderer->createMesh(vertices.data(), (uint32_t)vertices.size(),
+                                         cube.meshes[0].indices.data(), (uint32_t)cube.meshes[0].indices.size());
+
+    static const int CHECKER_SIZE = 64;
+    std::vector<uint8_t> checker(CHECKER_SIZE * CHECKER_SIZE * 4);
+    for (int y = 0; y < CHECKER_SIZE; y++) {
+        for (int x = 0; x < CHECKER_SIZE; x++) {
+            uint8_t value = ((x / 8 + y / 8) & 1) ? 230 : 60;
+            uint8_t* texel = &checker[(y * CHECKER_SIZE + x) * 4];
+            texel[0] = texel[1] = texel[2] = value;
+            texel[3] = 255;
+        }
+    }
+    uint32_t texture = renderer->createTextureFromData(checker.data(), CHECKER_SIZE, CHECKER_SIZE, 4);
+
+    std::unordered_map<const Model*, std::vector<uint32_t>> meshHandles = { { &cube, { mesh } } };
+    std::unordered_map<const Model*, std::vector<uint32_t>> textureHandles = { { &cube, { texture } } };
+
+    const float spacing = 3.0f;
+    uint32_t side = (uint32_t)std::ceil(std::sqrt((double)instances));
+    float extent = side * spacing;
+    Scene scene;
+    BenchRandom random(4);
+    for (uint32_t i = 0; i < instances; i++) {
+        SceneObject object;
+        object.model = &cube;
+        Vec3 position = { (i % side) * spacing - extent * 0.5f, random.uniform(0.0f, 2.0f),
+                          (i / side) * spacing - extent * 0.5f };
+        Vec3 rotation = { random.uniform(-3, 3), random.uniform(-3, 3), random.uniform(-3, 3) };
+        object.transform = Entity::composeTransform(position, rotation, { 1, 1, 1 });
+        object.colorTint = { random.uniform(0.5f, 1), random.uniform(0.5f, 1), random.uniform(0.5f, 1), 1.0f };
+        scene.addObject(object);
+    }
+
+    std::vector<double> frameMs;
+    std::vector<double> gpuMs;
+    frameMs.reserve(options.frames);
+    uint64_t lastGpuFrame = 0;
+    double drawCalls = 0.0, triangles = 0.0, visible = 0.0;
+    const float radius = extent * 0.6f + 20.0f;
+    const float height = extent * 0.2f + 10.0f;
+    const float aspect = fbHeight > 0 ? (float)fbWidth / (float)fbHeight : 1.0f;
+    const Mat4 proj = mat4_perspectiveRH_NO(75.0f * 3.14159265f / 180.0f, aspect, 0.1f, 10000.0f);
+
+    BenchRunner::Clock::time_point previous = BenchRunner::Clock::now();
+    uint32_t totalFrames = options.warmupFrames + options.frames;
+    for (uint32_t frame = 0; frame < totalFrames && !glfwWindowShouldClose(window); frame++) {
+        float angle = 6.2831853f * (float)frame / (float)options.frames;
+        Vec3 eye = { radius * std::cos(angle), height, radius * std::sin(angle) };
+        Mat4 viewProj = mat4_mul(proj, mat4_lookAtRH(eye, { 0, 0, 0 }, { 0, 1, 0 }));
+        Frustum frustum = Frustum::fromViewProj(viewProj);
+
+        renderer->beginFrame();
+        DrawConstants constants = {};
+        constants.mvp = viewProj;
+        constants.world = mat4_identity();
+        constants.lightDir = v3_norm({ 0.3f, 1.0f, 0.5f });
+        renderer->useShader(shader);
+        renderer->setDrawConstants(shader, constants);
+        renderer->beginGpuZone("Scene");
+        scene.render(renderer, meshHandles, textureHandles, &frustum);
+        renderer->endGpuZone();
+        renderer->endFrame();
+        glfwPollEvents();
+
+        // Start to start, so presentation and GPU backpressure are included
+        BenchRunner::Clock::time_point now = BenchRunner::Clock::now();
+        double ms = std::chrono::duration<double, std::milli>(now - previous).count();
+        previous = now;
+        if (frame < options.warmupFrames) continue;
+
+        frameMs.push_back(ms);
+        const GpuFrameTiming& gpu = renderer->getGpuTiming();
+        if (gpu.frame != lastGpuFrame && gpu.frameMs > 0.0) {
+            gpuMs.push_back(gpu.frameMs);
+            lastGpuFrame = gpu.frame;
+        }
+        const RenderStateStats& stats = renderer->getStateStats();
+        drawCalls += stats.drawCalls;
+        triangles += (double)stats.triangles;
+        visible += scene.getRenderStats().instancesDrawn;
+    }
+
+    renderer->destroyTexture(texture);
+    renderer->destroyMesh(mesh);
+    renderer->destroyShader(shader);
+    renderer->shutdown();
+    delete renderer;
+    glfwDestroyWindow(window);
+
+    if (frameMs.empty()) {
+        std::fprintf(stderr, "cube_bench: %s was interrupted\n", name.c_str());
+        return false;
+    }
+
+    double frames = (double)frameMs.size();
+    BenchResult result;
+    result.name = name;
+    result.group = "scenario";
+    result.iterations = frameMs.size();
+    result.samples = (uint32_t)frameMs.size();
+    result.nsPerOp = percentile(frameMs, 0.5) * 1e6;
+    result.minNsPerOp = percentile(frameMs, 0.0) * 1e6;
+    result.maxNsPerOp = percentile(frameMs, 1.0) * 1e6;
+    result.itemsPerOp = instances;
+    result.metrics = {
+        { "frame_ms_p95", percentile(frameMs, 0.95) },
+        { "frame_ms_p99", percentile(frameMs, 0.99) },
+        { "gpu_ms_median", percentile(gpuMs, 0.5) },
+        { "draw_calls", drawCalls / frames },
+        { "triangles", triangles / frames },
+        { "visible_instances", visible / frames },
+    };
+    runner.add(result);
+    return true;
+}
+
+// ==================== Main ====================
+static bool parseApi(const char* text, std::vector<RendererAPI>& apis) {
+    if (strcmp(text, "gl") == 0 || strcmp(text, "opengl") == 0) apis.push_back(RendererAPI::OpenGL);
+    else if (strcmp(text, "d3d11") == 0) apis.push_back(RendererAPI::Direct3D11);
+    else if (strcmp(text, "d3d12") == 0) apis.push_back(RendererAPI::Direct3D12);
+    else if (strcmp(text, "all") == 0) {
+        apis.push_back(RendererAPI::OpenGL);
+#ifdef _WIN32
+        apis.push_back(RendererAPI::Direct3D11);
+        apis.push_back(RendererAPI::Direct3D12);
+#endif
+    } else {
+        return false;
+    }
+    return true;
+}
+
+static void printUsage(const char* program) {
+    printf("Usage: %s [options]\n", program);
+    printf("Options:\n");
+    printf("  --filter <text>    Only run benchmarks whose name contains <text>\n");
+    printf("  --list             Print benchmark names and exit\n");
+    printf("  --micro            Micro benchmarks only\n");
+    printf("  --scenario         Scenario benchmarks only\n");
+    printf("  --min-time <s>     Time per micro benchmark (default 0.5)\n");
+    printf("  --samples <n>      Samples per micro benchmark; the median is reported (default 9)\n");
+    printf("  --api <name>       Scenario renderer: gl, d3d11, d3d12 or all (default all; repeatable)\n");
+    printf("  --instances <n>    Scenario instance count (default 1000, 10000, 100000; repeatable)\n");
+    printf("  --frames <n>       Measured frames per scenario (default 600)\n");
+    printf("  --vsync            Keep vsync on in scenarios\n");
+    printf("  --json <file>      Write results as JSON\n");
+    printf("  --compare <file>   Compare with an earlier --json file; exit 2 on regressions\n");
+    printf("  --threshold <pct>  Slowdown counted as a regression (default 10)\n");
+    printf("  --help             Show this help\n");
+}
+
+int main(int argc, char** argv) {
+    BenchRunner runner;
+    ScenarioOptions scenario;
+    bool runMicro = true;
+    bool runScenarios = true;
+    bool listOnly = false;
+    const char* jsonFile = nullptr;
+    const char* baselineFile = nullptr;
+    double threshold = 10.0;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--filter") == 0 && i + 1 < argc) {
+            runner.setFilter(argv[++i]);
+        } else if (strcmp(argv[i], "--list") == 0) {
+            listOnly = true;
+        } else if (strcmp(argv[i], "--micro") == 0) {
+            runScenarios = false;
+        } else if (strcmp(argv[i], "--scenario") == 0) {
+            runMicro = false;
+        } else if (strcmp(argv[i], "--min-time") == 0 && i + 1 < argc) {
+            runner.setMinTime(atof(argv[++i]));
+        } else if (strcmp(argv[i], "--samples") == 0 && i + 1 < argc) {
+            runner.setSamples((uint32_t)atoi(argv[++i]));
+        } else if (strcmp(argv[i], "--api") == 0 && i + 1 < argc) {
+            if (!parseApi(argv[++i], scenario.apis)) {
+                fprintf(stderr, "Unknown renderer: %s\n", argv[i]);
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--instances") == 0 && i + 1 < argc) {
+            scenario.instanceCounts.push_back((uint32_t)atoi(argv[++i]));
+        } else if (strcmp(argv[i], "--frames") == 0 && i + 1 < argc) {
+            scenario.frames = (uint32_t)(std::max)(atoi(argv[++i]), 1);
+        } else if (strcmp(argv[i], "--vsync") == 0) {
+            scenario.vsync = true;
+        } else if (strcmp(argv[i], "--json") == 0 && i + 1 < argc) {
+            jsonFile = argv[++i];
+        } else if (strcmp(argv[i], "--compare") == 0 && i + 1 < argc) {
+            baselineFile = argv[++i];
+        } else if (strcmp(argv[i], "--threshold") == 0 && i + 1 < argc) {
+            threshold = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--help") == 0) {
+            printUsage(argv[0]);
+            return 0;
+        } else {
+            fprintf(stderr, "Unknown option: %s (see --help)\n", argv[i]);
+            return 1;
+        }
+    }
+    if (scenario.apis.empty()) parseApi("all", scenario.apis);
+    if (scenario.instanceCounts.empty()) scenario.instanceCounts = { 1000, 10000, 100000 };
+
+    runner.setListOnly(listOnly);
+    if (!listOnly) {
+#ifndef NDEBUG
+        printf("Warning: debug build, timings are not representative\n\n");
+#endif
+        BenchRunner::printHeader();
+    }
+
+    // Zones are only recorded by the app; keep their cost out of the numbers
+    Profiler::setEnabled(false);
+
+    if (runMicro) {
+        benchMath(runner);
+        benchEntities(runner);
+        benchFlightDynamics(runner);
+        benchTextures(runner);
+    }
+
+    // GLFW only comes up if a scenario is selected, so filtered runs work
+    // on machines without a display
+    bool scenariosOk = true;
+    if (runScenarios) {
+        std::vector<std::pair<RendererAPI, uint32_t>> selected;
+        for (RendererAPI api : scenario.apis) {
+            for (uint32_t instances : scenario.instanceCounts) {
+                if (runner.selected(scenarioName(api, instances))) selected.push_back({ api, instances });
+            }
+        }
+        if (!selected.empty()) {
+            if (glfwInit()) {
+                for (const auto& entry : selected) {
+                    scenariosOk = runScenario(runner, entry.first, entry.second, scenario) && scenariosOk;
+                }
+                glfwTerminate();
+            } else {
+                fprintf(stderr, "cube_bench: cannot initialize GLFW, skipping scenarios\n");
+                scenariosOk = false;
+            }
+        }
+    }
+    if (listOnly) return 0;
+
+    if (jsonFile && !runner.writeJson(jsonFile)) return 1;
+    if (baselineFile) {
+        int regressions = runner.compare(baselineFile, threshold);
+        if (regressions < 0) return 1;
+        if (regressions > 0) {
+            printf("\n%d benchmark(s) regressed by more than %.1f%%\n", regressions, threshold);
+            return 2;
+        }
+    }
+    return scenariosOk ? 0 : 1;
+}
@@ -2,9 +2,11 @@
 #ifndef DDS_LOADER_H
 #define DDS_LOADER_H
 
+#include "renderer.h"
 #include <cstdint>
 #include <cstdio>
 #include <cstring>
+#include <vector>
 
 // DDS file structures
 #pragma pack(push, 1)
@@ -35,12 +37,20 @@ struct DDS_HEADER {
     uint32_t dwCaps4;
     uint32_t dwReserved2;
 };
+struct DDS_HEADER_DXT10 {
+    uint32_t dxgiFormat;
+    uint32_t resourceDimension;
+    uint32_t miscFlag;
+    uint32_t arraySize;
+    uint32_t miscFlags2;
+};
 #pragma pack(pop)
 
 #define DDS_MAGIC 0x20534444  // "DDS "
 #define DDPF_FOURCC 0x00000004
 #define DDPF_RGB    0x00000040
 #define DDPF_RGBA   0x00000041
+#define DDSD_MIPMAPCOUNT 0x00020000
 
 #define MAKEFOURCC(ch0, ch1, ch2, ch3) \
     ((uint32_t)(uint8_t)(ch0) | ((uint32_t)(uint8_t)(ch1) << 8) | \
@@ -50,13 +60,155 @@ struct DDS_HEADER {
 #define FOURCC_DXT1 MAKEFOURCC('D','X','T','1')
 #define FOURCC_DXT3 MAKEFOURCC('D','X','T','3')
 #define FOURCC_DXT5 MAKEFOURCC('D','X','T','5')
+#define FOURCC_DX10 MAKEFOURCC('D','X','1','0')
+
+// DXGI_FORMAT values used by DX10-header DDS files
+#define DDS_DXGI_BC1_UNORM       71
+#define DDS_DXGI_BC1_UNORM_SRGB  72
+#define DDS_DXGI_BC2_UNORM       74
+#define DDS_DXGI_BC2_UNORM_SRGB  75
+#define DDS_DXGI_BC3_UNORM       77
+#define DDS_DXGI_BC3_UNORM_SRGB  78
+
+// Block-compressed DDS kept in its on-disk form; mips point into data
+struct DDSImage {
+    CompressedFormat format;
+    int width;
+    int height;
+    std::vector<uint8_t> data;
+    std::vector<CompressedMip> mips;
+};
 
 class DDSLoader {
 public:
+    // Load a BC1/BC2/BC3 DDS (legacy FourCC or DX10 header) with its full
+    // mip chain, without decompressing. Returns false for other formats.
+    static bool LoadCompressed(const char* filepath, DDSImage& image) {
+        FILE* f = fopen(filepath, "rb");
+        if (!f) {
+            std::fprintf(stderr, "Failed to open DDS file: %s\n", filepath);
+            return false;
+        }
+
+        uint32_t magic = 0;
+        DDS_HEADER header;
+        if (fread(&magic, sizeof(uint32_t), 1, f) != 1 || magic != DDS_MAGIC ||
+            fread(&header, sizeof(DDS_HEADER), 1, f) != 1) {
+            std::fprintf(stderr, "Invalid DDS file (bad header): %s\n", filepath);
+            fclose(f);
+            return false;
+        }
+
+        if (!(header.ddspf.dwFlags & DDPF_FOURCC)) {
+            fclose(f);
+            return false;
+        }
+
+        uint32_t fourCC = header.ddspf.dwFourCC;
+        if (fourCC == FOURCC_DXT1) {
+            image.format = CompressedFormat::BC1;
+        } else if (fourCC == FOURCC_DXT3) {
+            image.format = CompressedFormat::BC2;
+        } else if (fourCC == FOURCC_DXT5) {
+            image.format = CompressedFormat::BC3;
+        } else if (fourCC == FOURCC_DX10) {
+            DDS_HEADER_DXT10 dx10;
+            if (fread(&dx10, sizeof(dx10), 1, f) != 1) {
+                fclose(f);
+                return false;
+            }
+            switch (dx10.dxgiFormat) {
+                case DDS_DXGI_BC1_UNORM: case DDS_DXGI_BC1_UNORM_SRGB: image.format = CompressedFormat::BC1; break;
+                case DDS_DXGI_BC2_UNORM: case DDS_DXGI_BC2_UNORM_SRGB: image.format = CompressedFormat::BC2; break;
+                case DDS_DXGI_BC3_UNORM: case DDS_DXGI_BC3_UNORM_SRGB: image.format = CompressedFormat::BC3; break;
+                default:
+                    fclose(f);
+                    return false;
+            }
+        } else {
+            fclose(f);
+            return false;
+        }
+
+        image.width = (int)header.dwWidth;
+        image.height = (int)header.dwHeight;
+        uint32_t mipCount = (header.dwFlags & DDSD_MIPMAPCOUNT) && header.dwMipMapCount > 0
+                            ? header.dwMipMapCount : 1;
+        uint32_t blockSize = BlockSize(image.format);
+
+        // Level sizes first, then one read for the whole chain
+        struct Level { uint32_t offset, size, rowPitch, rows; int w, h; };
+        std::vector<Level> levels;
+        uint32_t total = 0;
+        int w = image.width, h = image.height;
+        for (uint32_t i = 0; i < mipCount; i++) {
+            Level level;
+            level.rowPitch = (uint32_t)((w + 3) / 4) * blockSize;
+            level.rows = (uint32_t)((h + 3) / 4);
+            level.size = level.rowPitch * level.rows;
+            level.offset = total;
+            level.w = w;
+            level.h = h;
+            levels.push_back(level);
+            total += level.size;
+            if (w == 1 && h == 1) break;
+            w = (w > 1) ? w / 2 : 1;
+            h = (h > 1) ? h / 2 : 1;
+        }
+
+        image.data.resize(total);
+        size_t got = fread(image.data.data(), 1, total, f);
+        fclose(f);
+        if (got < levels[0].size) {
+            std::fprintf(stderr, "Truncated DDS file: %s\n", filepath);
+            return false;
+        }
+
+        // Keep whatever complete levels the file actually contains
+        image.mips.clear();
+        for (const Level& level : levels) {
+            if (level.offset + level.size > got) break;
+            CompressedMip mip;
+            mip.data = image.data.data() + level.offset;
+            mip.size = level.size;
+            mip.rowPitch = level.rowPitch;
+            mip.rows = level.rows;
+            mip.width = level.w;
+            mip.height = level.h;
+            image.mips.push_back(mip);
+        }
+        return true;
+    }
+
+    static uint32_t BlockSize(CompressedFormat format) {
+        return (format == CompressedFormat::BC1) ? 8 : 16;
+    }
+
+    // CPU fallback: decode one level of a compressed image to RGBA8 (delete[] the result)
+    static unsigned char* Decompress(const DDSImage& image, size_t level = 0) {
+        if (level >= image.mips.size()) return nullptr;
+        const CompressedMip& mip = image.mips[level];
+        unsigned char* rgba = new unsigned char[(size_t)mip.width * mip.height * 4];
+        switch (image.format) {
+            case CompressedFormat::BC1: DecompressDXT1(mip.data, rgba, mip.width, mip.height); break;
+            case CompressedFormat::BC2: DecompressDXT3(mip.data, rgba, mip.width, mip.height); break;
+            case CompressedFormat::BC3: DecompressDXT5(mip.data, rgba, mip.width, mip.height); break;
+        }
+        return rgba;
+    }
+
     // Load DDS file and return RGBA8 data (decompressed if needed)
     // Returns nullptr on failure
     // width, height, and channels are set on success
     static unsigned char* Load(const char* filepath, int* width, int* height, int* channels) {
+        DDSImage image;
+        if (LoadCompressed(filepath, image)) {
+            *width = image.width;
+            *height = image.height;
+            *channels = 4;
+            return Decompress(image, 0);
+        }
+
         FILE* f = fopen(filepath, "rb");
         if (!f) {
             std::fprintf(stderr, "Failed to open DDS file: %s\n", filepath);
@@ -79,42 +231,7 @@ public:
         *width = header.dwWidth;
         *height = header.dwHeight;
 
-        // Check format
-        bool isDXT1 = (header.ddspf.dwFlags & DDPF_FOURCC) && (header.ddspf.dwFourCC == FOURCC_DXT1);
-        bool isDXT3 = (header.ddspf.dwFlags & DDPF_FOURCC) && (header.ddspf.dwFourCC == FOURCC_DXT3);
-        bool isDXT5 = (header.ddspf.dwFlags & DDPF_FOURCC) && (header.ddspf.dwFourCC == FOURCC_DXT5);
-
-        if (isDXT1 || isDXT3 || isDXT5) {
-            // Compressed format - decompress to RGBA8
-            *channels = 4;
-            
-            // Calculate compressed size
-            int blockSize = (isDXT1) ? 8 : 16;
-            int numBlocksWide = (*width + 3) / 4;
-            int numBlocksHigh = (*height + 3) / 4;
-            int compressedSize = numBlocksWide * numBlocksHigh * blockSize;
-
-            // Read compressed data
-            unsigned char* compressedData = new unsigned char[compressedSize];
-            fread(compressedData, 1, compressedSize, f);
-            fclose(f);
-
-            // Decompress
-            unsigned char* rgba = new unsigned char[(*width) * (*height) * 4];
-            
-            if (isDXT1) {
-                DecompressDXT1(compressedData, rgba, *width, *height);
-            } else if (isDXT5) {
-                DecompressDXT5(compressedData, rgba, *width, *height);
-            } else {
-                // DXT3 - for now, treat like DXT5 (similar structure)
-                DecompressDXT5(compressedData, rgba, *width, *height);
-            }
-
-            delete[] compressedData;
-            return rgba;
-            
-        } else if (header.ddspf.dwFlags & DDPF_RGB) {
+        if (header.ddspf.dwFlags & DDPF_RGB) {
             // Uncompressed RGB/RGBA
             int bpp = header.ddspf.dwRGBBitCount / 8;
             *channels = bpp;
@@ -186,6 +303,52 @@ private:
         }
     }
 
+    // DXT3 decompression: explicit 4-bit alpha, then a 4-color DXT1-style block
+    static void DecompressDXT3(const unsigned char* src, unsigned char* dst, int width, int height) {
+        int numBlocksWide = (width + 3) / 4;
+        int numBlocksHigh = (height + 3) / 4;
+
+        for (int by = 0; by < numBlocksHigh; by++) {
+            for (int bx = 0; bx < numBlocksWide; bx++) {
+                const unsigned char* block = src + (by * numBlocksWide + bx) * 16;
+
+                // Alpha block (8 bytes, 4 bits per texel)
+                uint64_t aBits = 0;
+                for (int i = 0; i < 8; i++) aBits |= (uint64_t)block[i] << (8 * i);
+
+                // Color block (8 bytes) - always 4-color mode
+                uint16_t c0 = block[8] | (block[9] << 8);
+                uint16_t c1 = block[10] | (block[11] << 8);
+                uint32_t bits = block[12] | (block[13] << 8) | (block[14] << 16) | (block[15] << 24);
+
+                uint32_t colors[4];
+                colors[0] = RGB565ToRGBA8(c0, 255);
+                colors[1] = RGB565ToRGBA8(c1, 255);
+                colors[2] = BlendRGBA(colors[0], colors[1], 2, 1);
+                colors[3] = BlendRGBA(colors[0], colors[1], 1, 2);
+
+                for (int py = 0; py < 4; py++) {
+                    for (int px = 0; px < 4; px++) {
+                        int x = bx * 4 + px;
+                        int y = by * 4 + py;
+                        if (x < width && y < height) {
+                            int pixelIndex = py * 4 + px;
+                            int colorIndex = (bits >> (pixelIndex * 2)) & 0x3;
+                            uint8_t alpha = (uint8_t)(((aBits >> (pixelIndex * 4)) & 0xF) * 17);
+
+                            uint32_t color = colors[colorIndex];
+                            int offset = (y * width + x) * 4;
+                            dst[offset + 0] = (color >> 0) & 0xFF;
+                            dst[offset + 1] = (color >> 8) & 0xFF;
+                            dst[offset + 2] = (color >> 16) & 0xFF;
+                            dst[offset + 3] = alpha;
+                        }
+                    }
+                }
+            }
+        }
+    }
+
     // Simple DXT5 decompression (with alpha)
     static void DecompressDXT5(const unsigned char* src, unsigned char* dst, int width, int height) {
         int numBlocksWide = (width + 3) / 4;
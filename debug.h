@@ -7,9 +7,15 @@
 #endif
 
 #include <cstdio>
-#include <cstdarg>
 #include <chrono>
 #include <string>
+#include "async_log.h"
+#include "renderer.h"   // Vertex, for MeshValidator
+
+// <windows.h> defines ERROR, which would turn LogLevel::ERROR into a
+// syntax error in the D3D backends; LOG_ERROR still cannot be used there
+#pragma push_macro("ERROR")
+#undef ERROR
 
 // ==================== Debug Levels ====================
 enum class LogLevel {
@@ -21,6 +27,10 @@ enum class LogLevel {
 };
 
 // ==================== Debug Manager ====================
+// Log calls capture their arguments into a lock-free ring (async_log.h) and
+// return; a log thread formats the records and writes stdout and the log
+// file. Before initialize() and after shutdown() calls are formatted and
+// written on the calling thread instead.
 class DebugManager {
 private:
     static bool s_enabled;
@@ -28,6 +38,7 @@ private:
     static FILE* s_logFile;
     static bool s_showTimestamp;
     static std::chrono::high_resolution_clock::time_point s_startTime;
+    static AsyncLogger s_asyncLogger;
 
 public:
     static void initialize(bool enabled = false, LogLevel level = LogLevel::INFO) {
@@ -41,10 +52,12 @@ public:
                 fprintf(s_logFile, "=== Debug Log Started ===\n");
                 fflush(s_logFile);
             }
+            s_asyncLogger.start(writeLine, flushStreams);
         }
     }
 
     static void shutdown() {
+        s_asyncLogger.stop();
         if (s_logFile) {
             fprintf(s_logFile, "=== Debug Log Ended ===\n");
             fclose(s_logFile);
@@ -55,42 +68,65 @@ public:
     static void setEnabled(bool enabled) { s_enabled = enabled; }
     static bool isEnabled() { return s_enabled; }
     static void setLogLevel(LogLevel level) { s_logLevel = level; }
+    // For skipping work that only feeds a log call
+    static bool isLogged(LogLevel level) { return s_enabled && level <= s_logLevel; }
     static void enableTimestamps(bool enable) { s_showTimestamp = enable; }
 
-    static void log(LogLevel level, const char* format, ...) {
+    // Does not block while the log thread runs: on a full ring INFO and
+    // below are dropped (the log reports how many), errors and warnings
+    // wait for room
+    template <typename... Args>
+    static void log(LogLevel level, const char* format, const Args&... args) {
         if (!s_enabled || level > s_logLevel) return;
 
+        auto now = std::chrono::high_resolution_clock::now();
+        int64_t timeUs = std::chrono::duration_cast<std::chrono::microseconds>(now - s_startTime).count();
+        if (s_asyncLogger.isRunning()) {
+            s_asyncLogger.push(level > LogLevel::WARNING, (uint8_t)level, timeUs, format, args...);
+            return;
+        }
+
+        LogRecord record;
+        LogCapture::fill(record, (uint8_t)level, timeUs, format, args...);
         char buffer[4096];
-        va_list args;
-        va_start(args, format);
-        vsnprintf(buffer, sizeof(buffer), format, args);
-        va_end(args);
+        formatLogRecord(record, buffer, sizeof(buffer));
+        writeLine((uint8_t)level, timeUs, buffer);
+        flushStreams();
+    }
+
+    // Waits until everything logged so far is written (e.g. before a crash
+    // report or exit)
+    static void flush() { s_asyncLogger.flush(); }
+    static uint64_t getDroppedCount() { return s_asyncLogger.getDroppedCount(); }
 
+private:
+    // Runs on the log thread while it is started
+    static void writeLine(uint8_t levelValue, int64_t timeUs, const char* message) {
+        LogLevel level = (LogLevel)levelValue;
         const char* levelStr = getLevelString(level);
         const char* colorCode = getColorCode(level);
+        long long elapsed = (long long)(timeUs / 1000);
         
         if (s_showTimestamp) {
-            auto now = std::chrono::high_resolution_clock::now();
-            auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(now - s_startTime).count();
-            fprintf(stdout, "%s[%6lld ms] [%s]%s %s\n", colorCode, elapsed, levelStr, "\033[0m", buffer);
+            fprintf(stdout, "%s[%6lld ms] [%s]%s %s\n", colorCode, elapsed, levelStr, "\033[0m", message);
         } else {
-            fprintf(stdout, "%s[%s]%s %s\n", colorCode, levelStr, "\033[0m", buffer);
+            fprintf(stdout, "%s[%s]%s %s\n", colorCode, levelStr, "\033[0m", message);
         }
-        fflush(stdout);
 
         if (s_logFile) {
             if (s_showTimestamp) {
-                auto now = std::chrono::high_resolution_clock::now();
-                auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(now - s_startTime).count();
-                fprintf(s_logFile, "[%6lld ms] [%s] %s\n", elapsed, levelStr, buffer);
+                fprintf(s_logFile, "[%6lld ms] [%s] %s\n", elapsed, levelStr, message);
             } else {
-                fprintf(s_logFile, "[%s] %s\n", levelStr, buffer);
+                fprintf(s_logFile, "[%s] %s\n", levelStr, message);
             }
-            fflush(s_logFile);
         }
     }
 
-private:
+    static void flushStreams() {
+        fflush(stdout);
+        if (s_logFile) fflush(s_logFile);
+    }
+
     static const char* getLevelString(LogLevel level) {
         switch (level) {
             case LogLevel::ERROR:   return "ERROR";
@@ -118,11 +154,29 @@ private:
 // Note: If you don't want a separate .cpp file, see alternative below
 
 // ==================== Convenience Macros ====================
+// Levels above CUBE_LOG_MAX_LEVEL (a LogLevel value) compile to nothing,
+// arguments included. Release builds keep up to INFO unless told otherwise.
+#ifndef CUBE_LOG_MAX_LEVEL
+#ifdef NDEBUG
+#define CUBE_LOG_MAX_LEVEL 2
+#else
+#define CUBE_LOG_MAX_LEVEL 4
+#endif
+#endif
+
 #define LOG_ERROR(...)   DebugManager::log(LogLevel::ERROR, __VA_ARGS__)
 #define LOG_WARNING(...) DebugManager::log(LogLevel::WARNING, __VA_ARGS__)
 #define LOG_INFO(...)    DebugManager::log(LogLevel::INFO, __VA_ARGS__)
+#if CUBE_LOG_MAX_LEVEL >= 3
 #define LOG_DEBUG(...)   DebugManager::log(LogLevel::DEBUG, __VA_ARGS__)
+#else
+#define LOG_DEBUG(...)   ((void)0)
+#endif
+#if CUBE_LOG_MAX_LEVEL >= 4
 #define LOG_TRACE(...)   DebugManager::log(LogLevel::TRACE, __VA_ARGS__)
+#else
+#define LOG_TRACE(...)   ((void)0)
+#endif
 
 // ==================== Static Member Storage ====================
 // Implementation detail: These are defined inline to avoid needing a separate .cpp file
@@ -132,6 +186,7 @@ inline LogLevel DebugManager::s_logLevel = LogLevel::INFO;
 inline FILE* DebugManager::s_logFile = nullptr;
 inline bool DebugManager::s_showTimestamp = true;
 inline std::chrono::high_resolution_clock::time_point DebugManager::s_startTime = {};
+inline AsyncLogger DebugManager::s_asyncLogger;
 
 
 // ==================== Performance Counters ====================
@@ -143,10 +198,23 @@ struct PerformanceStats {
     double maxFrameTime = 0.0;
     double avgFrameTime = 0.0;
     
+    // Input latency: events polled to the frame's Present() returning. The
+    // display's queue and scan-out come on top; low-latency mode keeps the
+    // queue to one frame.
+    double inputLatency = 0.0;
+    double minInputLatency = 999999.0;
+    double maxInputLatency = 0.0;
+    double avgInputLatency = 0.0;
+    double frameWaitTime = 0.0;    // Blocked on the swap chain and frame limiter before polling
+    
     // Rendering stats
     uint32_t drawCalls = 0;
     uint32_t triangles = 0;
     uint32_t meshesDrawn = 0;
+    uint32_t meshesCulled = 0;     // Outside the frustum or below a pixel
+    uint32_t lodMeshesDrawn = 0;   // Drawn from a lower-detail model
+    uint32_t stateBinds = 0;       // Renderer binds issued last frame
+    uint32_t stateBindsSkipped = 0; // Binds filtered as redundant
     
     // Resource stats
     uint32_t texturesLoaded = 0;
@@ -157,11 +225,15 @@ struct PerformanceStats {
     // Frame counter for averaging
     uint32_t frameCount = 0;
     double totalFrameTime = 0.0;
+    uint32_t latencyCount = 0;
+    double totalInputLatency = 0.0;
     
     void reset() {
         drawCalls = 0;
         triangles = 0;
         meshesDrawn = 0;
+        meshesCulled = 0;
+        lodMeshesDrawn = 0;
         frameCount++;
     }
     
@@ -176,14 +248,29 @@ struct PerformanceStats {
         avgFrameTime = totalFrameTime / frameCount;
     }
     
+    void updateLatency(double latency) {
+        inputLatency = latency;
+        if (latency < minInputLatency) minInputLatency = latency;
+        if (latency > maxInputLatency) maxInputLatency = latency;
+        
+        latencyCount++;
+        totalInputLatency += latency;
+        avgInputLatency = totalInputLatency / latencyCount;
+    }
+    
     void print() const {
         printf("\n=== Performance Stats ===\n");
         printf("FPS:           %.1f (%.2f ms/frame)\n", fps, frameTime * 1000.0);
         printf("Frame Time:    Avg: %.2f ms, Min: %.2f ms, Max: %.2f ms\n",
                avgFrameTime * 1000.0, minFrameTime * 1000.0, maxFrameTime * 1000.0);
+        if (latencyCount > 0) {
+            printf("Input Latency: Avg: %.2f ms, Min: %.2f ms, Max: %.2f ms\n",
+                   avgInputLatency * 1000.0, minInputLatency * 1000.0, maxInputLatency * 1000.0);
+        }
         printf("Draw Calls:    %u\n", drawCalls);
         printf("Triangles:     %u (%.1fK)\n", triangles, triangles / 1000.0f);
-        printf("Meshes Drawn:  %u\n", meshesDrawn);
+        printf("Meshes Drawn:  %u (%u LOD, %u culled)\n", meshesDrawn, lodMeshesDrawn, meshesCulled);
+        printf("State Binds:   %u (%u redundant skipped)\n", stateBinds, stateBindsSkipped);
         printf("Textures:      %u (%.1f MB)\n", texturesLoaded, textureMemoryKB / 1024.0f);
         printf("Mesh Memory:   %.1f MB\n", meshMemoryKB / 1024.0f);
         printf("Total Frames:  %u\n", frameCount);
@@ -312,4 +399,6 @@ public:
     }
 };
 
+#pragma pop_macro("ERROR")
+
 #endif // DEBUG_H
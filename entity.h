@@ -3,63 +3,84 @@
 #define ENTITY_H
 
 #include "math_utils.h"
+#include "entity_storage.h"
 #include <string>
 #include <cstdint>
+#include <memory>
 
 // Forward declarations
 class Behavior;
 struct Model;  // Model is a struct, not a class
 
-// Unique entity ID
-typedef uint32_t EntityID;
-
 // ==================== Entity Base Class ====================
-// Represents any object in the game world
+// Represents any object in the game world. Transform, physics and render
+// state live in an EntityStorage (the registry's, so passes over all
+// entities stream through SoA arrays); an Entity created on its own gets a
+// private one-entry storage so the accessors behave the same.
 class Entity {
 public:
-    Entity(EntityID id, const std::string& name)
+    Entity(EntityID id, const std::string& name, EntityStorage* storage = nullptr)
         : m_id(id)
         , m_name(name)
-        , m_position({0, 0, 0})
-        , m_rotation({0, 0, 0})  // Euler angles (pitch, yaw, roll) in radians
-        , m_scale({1, 1, 1})
-        , m_velocity({0, 0, 0})
-        , m_angularVelocity({0, 0, 0})
-        , m_model(nullptr)
-        , m_visible(true)
-        , m_active(true)
-    {}
-    
-    virtual ~Entity() = default;
+        , m_storage(storage)
+    {
+        if (!m_storage) {
+            m_ownedStorage.reset(new EntityStorage());
+            m_storage = m_ownedStorage.get();
+        }
+        m_storage->add(id, this);
+    }
+    
+    virtual ~Entity() {
+        m_storage->remove(m_id);
+    }
+    
+    Entity(const Entity&) = delete;
+    Entity& operator=(const Entity&) = delete;
     
     // Getters
     EntityID getID() const { return m_id; }
     const std::string& getName() const { return m_name; }
     
-    Vec3 getPosition() const { return m_position; }
-    Vec3 getRotation() const { return m_rotation; }
-    Vec3 getScale() const { return m_scale; }
-    Vec3 getVelocity() const { return m_velocity; }
-    Vec3 getAngularVelocity() const { return m_angularVelocity; }
+    Vec3 getPosition() const { return m_storage->positions()[index()]; }
+    Vec3 getRotation() const { return m_storage->rotations()[index()]; }
+    Vec3 getScale() const { return m_storage->scales()[index()]; }
+    Vec3 getVelocity() const { return m_storage->velocities()[index()]; }
+    Vec3 getAngularVelocity() const { return m_storage->angularVelocities()[index()]; }
     
-    const Model* getModel() const { return m_model; }
-    bool isVisible() const { return m_visible; }
-    bool isActive() const { return m_active; }
+    const Model* getModel() const { return m_storage->models()[index()]; }
+    bool isVisible() const { return (m_storage->flags()[index()] & EntityStorage::FLAG_VISIBLE) != 0; }
+    bool isActive() const { return (m_storage->flags()[index()] & EntityStorage::FLAG_ACTIVE) != 0; }
     
     // Setters
-    void setPosition(const Vec3& pos) { m_position = pos; }
-    void setRotation(const Vec3& rot) { m_rotation = rot; }
-    void setScale(const Vec3& scale) { m_scale = scale; }
-    void setVelocity(const Vec3& vel) { m_velocity = vel; }
-    void setAngularVelocity(const Vec3& angVel) { m_angularVelocity = angVel; }
+    void setPosition(const Vec3& pos) { setPose(m_storage->positions(), pos); }
+    void setRotation(const Vec3& rot) { setPose(m_storage->rotations(), rot); }
+    void setScale(const Vec3& scale) { setPose(m_storage->scales(), scale); }
+    void setVelocity(const Vec3& vel) { m_storage->velocities()[index()] = vel; }
+    void setAngularVelocity(const Vec3& angVel) { m_storage->angularVelocities()[index()] = angVel; }
+    
+    void setModel(const Model* model) { m_storage->models()[index()] = model; }
+    void setVisible(bool visible) { setFlag(EntityStorage::FLAG_VISIBLE, visible); }
+    void setActive(bool active) { setFlag(EntityStorage::FLAG_ACTIVE, active); }
     
-    void setModel(const Model* model) { m_model = model; }
-    void setVisible(bool visible) { m_visible = visible; }
-    void setActive(bool active) { m_active = active; }
+    // Attach to another entity in the same storage: position, rotation and
+    // scale are then relative to it. nullptr detaches. Fails (returns false)
+    // for an entity elsewhere or one that would make a cycle.
+    bool setParent(const Entity* parent);
+    EntityID getParentID() const { return m_storage->getParent(index()); }
     
-    // Transform matrix for rendering
+    // Local-to-world matrix at the current pose, through all parents
     Mat4 getTransformMatrix() const;
     
+    // World matrix as of the last EntityStorage::updateWorldTransforms()
+    // (interpolated between steps; what rendering uses)
+    const Mat4& getWorldMatrix() const { return m_storage->worldMatrices()[index()]; }
+    
+    // T * R * S with YXZ Euler angles (yaw * pitch * roll)
+    static Mat4 composeTransform(const Vec3& position, const Vec3& rotation, const Vec3& scale) {
+        return EntityStorage::composeTransform(position, rotation, scale);
+    }
+    
     // Update (can be overridden)
     virtual void update(float deltaTime) { (void)deltaTime; }
     
@@ -67,19 +88,23 @@ protected:
     EntityID m_id;
     std::string m_name;
     
-    // Transform
-    Vec3 m_position;
-    Vec3 m_rotation;      // Euler angles in radians
-    Vec3 m_scale;
+private:
+    uint32_t index() const { return m_storage->indexOf(m_id); }
+    
+    // Writes one pose component and marks the cached matrices stale
+    void setPose(Vec3* values, const Vec3& value) {
+        uint32_t i = index();
+        values[i] = value;
+        m_storage->markTransformChanged(i);
+    }
     
-    // Physics
-    Vec3 m_velocity;
-    Vec3 m_angularVelocity;
+    void setFlag(uint8_t flag, bool enabled) {
+        uint8_t& flags = m_storage->flags()[index()];
+        flags = enabled ? (uint8_t)(flags | flag) : (uint8_t)(flags & ~flag);
+    }
     
-    // Rendering
-    const Model* m_model;
-    bool m_visible;
-    bool m_active;
+    EntityStorage* m_storage;
+    std::unique_ptr<EntityStorage> m_ownedStorage;  // Only for entities outside a registry
 };
 
 #endif // ENTITY_H
@@ -5,16 +5,20 @@
 #include "entity.h"
 #include "camera_entity.h"
 #include "behavior.h"
+#include "behavior_scheduler.h"
+#include "profiler.h"
 #include <unordered_map>
 #include <vector>
 #include <memory>
 #include <string>
 
 // ==================== Entity Registry ====================
-// Manages all entities and their behaviors
+// Manages all entities and their behaviors. Entity state lives in one
+// EntityStorage; Entity objects are a facade over it for code that works
+// on one entity at a time, while per-frame passes use getStorage().
 class EntityRegistry {
 public:
-    EntityRegistry() : m_nextEntityID(1) {}
+    EntityRegistry() : m_nextEntityID(1), m_jobs(nullptr) {}
     
     ~EntityRegistry() {
         clear();
@@ -23,7 +27,7 @@ public:
     // Entity management
     Entity* createEntity(const std::string& name) {
         EntityID id = m_nextEntityID++;
-        Entity* entity = new Entity(id, name);
+        Entity* entity = new Entity(id, name, &m_storage);
         m_entities[id] = entity;
         return entity;
     }
@@ -31,7 +35,7 @@ public:
     // Camera entity management
     CameraEntity* createCameraEntity(const std::string& name) {
         EntityID id = m_nextEntityID++;
-        CameraEntity* camera = new CameraEntity(id, name);
+        CameraEntity* camera = new CameraEntity(id, name, &m_storage);
         m_entities[id] = camera;
         return camera;
     }
@@ -49,8 +53,8 @@ public:
     }
     
     Entity* getEntity(EntityID id) {
-        auto it = m_entities.find(id);
-        return (it != m_entities.end()) ? it->second : nullptr;
+        uint32_t index = m_storage.indexOf(id);
+        return (index != EntityStorage::INVALID_INDEX) ? m_storage.entities()[index] : nullptr;
     }
     
     Entity* findEntityByName(const std::string& name) {
@@ -62,7 +66,8 @@ public:
         return nullptr;
     }
     
-    // Behavior management
+    // Behavior management. Lookups match the exact type a behavior was added
+    // as (its BehaviorTypeID), without RTTI.
     template<typename T>
     T* addBehavior(EntityID entityID) {
         T* behavior = new T();
@@ -70,15 +75,17 @@ public:
         if (entity) {
             behavior->attach(entity);
             behavior->initialize();
-            m_behaviors[entityID].push_back(behavior);
+            insertBehavior(entityID, behavior, behaviorTypeID<T>());
         }
         return behavior;
     }
     
-    // Add already-created behavior (for behaviors with constructor parameters)
-    void addBehaviorManual(EntityID entityID, Behavior* behavior) {
+    // Add already-created behavior (for behaviors with constructor parameters).
+    // T is the static type of the pointer, so pass it as the concrete type.
+    template<typename T>
+    void addBehaviorManual(EntityID entityID, T* behavior) {
         if (behavior) {
-            m_behaviors[entityID].push_back(behavior);
+            insertBehavior(entityID, behavior, behaviorTypeID<T>());
         }
     }
     
@@ -86,6 +93,7 @@ public:
         auto it = m_behaviors.find(entityID);
         if (it != m_behaviors.end()) {
             for (Behavior* behavior : it->second) {
+                removeFromPool(behavior);
                 behavior->shutdown();
                 behavior->detach();
                 delete behavior;
@@ -98,9 +106,9 @@ public:
     T* getBehavior(EntityID entityID) {
         auto it = m_behaviors.find(entityID);
         if (it != m_behaviors.end()) {
+            BehaviorTypeID type = behaviorTypeID<T>();
             for (Behavior* behavior : it->second) {
-                T* typed = dynamic_cast<T*>(behavior);
-                if (typed) return typed;
+                if (behavior->m_typeID == type) return static_cast<T*>(behavior);
             }
         }
         return nullptr;
@@ -110,12 +118,14 @@ public:
     void removeBehavior(EntityID entityID) {
         auto it = m_behaviors.find(entityID);
         if (it != m_behaviors.end()) {
+            BehaviorTypeID type = behaviorTypeID<T>();
             for (auto behaviorIt = it->second.begin(); behaviorIt != it->second.end(); ++behaviorIt) {
-                T* typed = dynamic_cast<T*>(*behaviorIt);
-                if (typed) {
-                    typed->shutdown();
-                    typed->detach();
-                    delete typed;
+                Behavior* behavior = *behaviorIt;
+                if (behavior->m_typeID == type) {
+                    removeFromPool(behavior);
+                    behavior->shutdown();
+                    behavior->detach();
+                    delete behavior;
                     it->second.erase(behaviorIt);
                     return;
                 }
@@ -131,30 +141,50 @@ public:
         return {};
     }
     
+    // Every behavior of type T, packed (order changes when one is removed).
+    // Elements are Behavior*; static_cast them to T*.
+    template<typename T>
+    const std::vector<Behavior*>& getBehaviorPool() const {
+        static const std::vector<Behavior*> empty;
+        BehaviorTypeID type = behaviorTypeID<T>();
+        return type < m_pools.size() ? m_pools[type] : empty;
+    }
+    
     // Update all entities and behaviors
     void update(float deltaTime) {
-        // Update all entities
-        for (auto& pair : m_entities) {
-            if (pair.second->isActive()) {
-                pair.second->update(deltaTime);
-            }
-        }
-        
-        // Update all behaviors
-        for (auto& pair : m_behaviors) {
-            for (Behavior* behavior : pair.second) {
-                if (behavior->isEnabled()) {
-                    behavior->update(deltaTime);
+        // Update all entities (flags are checked in the dense array, so
+        // inactive entities cost no pointer chase)
+        {
+            PROFILE_ZONE("Entities");
+            const uint8_t* flags = m_storage.flags();
+            Entity* const* entities = m_storage.entities();
+            for (uint32_t i = 0, n = m_storage.size(); i < n; i++) {
+                if (flags[i] & EntityStorage::FLAG_ACTIVE) {
+                    entities[i]->update(deltaTime);
                 }
             }
         }
+        
+        // Update all behaviors, one type at a time, in the order (and with
+        // the parallelism) their declared access allows
+        PROFILE_ZONE("Behaviors");
+        m_scheduler.run(m_pools, deltaTime, m_jobs);
     }
     
-    // Get all entities
+    // Get all entities (by ID; prefer getStorage() for passes over everything)
     const std::unordered_map<EntityID, Entity*>& getAllEntities() const {
         return m_entities;
     }
     
+    // Run behavior updates on a job system (nullptr = serial on the calling thread)
+    void setJobSystem(JobSystem* jobs) { m_jobs = jobs; }
+    JobSystem* getJobSystem() const { return m_jobs; }
+    uint32_t getUpdateStageCount() const { return m_scheduler.getStageCount(); }
+    
+    // Dense SoA state of all entities
+    EntityStorage& getStorage() { return m_storage; }
+    const EntityStorage& getStorage() const { return m_storage; }
+    
     // Clear everything
     void clear() {
         // Clean up behaviors first
@@ -166,12 +196,16 @@ public:
             }
         }
         m_behaviors.clear();
+        for (auto& pool : m_pools) {
+            pool.clear();
+        }
         
         // Clean up entities
         for (auto& pair : m_entities) {
             delete pair.second;
         }
         m_entities.clear();
+        m_storage.clear();
         
         m_nextEntityID = 1;
     }
@@ -187,9 +221,32 @@ public:
     }
     
 private:
+    void insertBehavior(EntityID entityID, Behavior* behavior, BehaviorTypeID type) {
+        if (type >= m_pools.size()) m_pools.resize((size_t)type + 1);
+        behavior->m_typeID = type;
+        behavior->m_poolIndex = (uint32_t)m_pools[type].size();
+        m_pools[type].push_back(behavior);
+        m_behaviors[entityID].push_back(behavior);
+    }
+    
+    // Swap-and-pop; the moved behavior learns its new index
+    void removeFromPool(Behavior* behavior) {
+        if (behavior->m_typeID >= m_pools.size()) return;
+        std::vector<Behavior*>& pool = m_pools[behavior->m_typeID];
+        uint32_t index = behavior->m_poolIndex;
+        if (index >= pool.size() || pool[index] != behavior) return;
+        pool[index] = pool.back();
+        pool[index]->m_poolIndex = index;
+        pool.pop_back();
+    }
+    
     EntityID m_nextEntityID;
+    EntityStorage m_storage;   // Declared before m_entities: entities remove themselves on delete
     std::unordered_map<EntityID, Entity*> m_entities;
-    std::unordered_map<EntityID, std::vector<Behavior*>> m_behaviors;
+    std::unordered_map<EntityID, std::vector<Behavior*>> m_behaviors;   // Owning, per entity
+    std::vector<std::vector<Behavior*>> m_pools;                         // By BehaviorTypeID
+    BehaviorScheduler m_scheduler;
+    JobSystem* m_jobs;
 };
 
 #endif // ENTITY_REGISTRY_H
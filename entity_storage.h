@@ -0,0 +1,426 @@
+// entity_storage.h - Contiguous SoA storage for entity hot data
+#ifndef ENTITY_STORAGE_H
+#define ENTITY_STORAGE_H
+
+#include "math_utils.h"
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+class Entity;
+struct Model;
+
+// Unique entity ID
+typedef uint32_t EntityID;
+
+// ==================== Entity Storage ====================
+// Sparse set over EntityIDs. The sparse array maps an ID to a dense index;
+// the dense arrays hold one entry per live entity with no holes, so a pass
+// over all entities reads each array front to back. Removal swaps the last
+// entry into the hole, so dense indices are only stable until the next
+// remove(); keep EntityIDs, not indices.
+//
+// Position, rotation and scale are relative to the entity's parent (or the
+// world, for roots). updateWorldTransforms() turns them into world matrices
+// in one pass over the entities sorted parents-first, and only touches an
+// entity whose pose changed, whose last step moved it (it is interpolated
+// each frame until the next step), or whose parent's matrix changed, so
+// static scenery costs nothing once its matrices are cached.
+class EntityStorage {
+public:
+    static constexpr uint32_t INVALID_INDEX = 0xFFFFFFFFu;
+    static constexpr EntityID NO_PARENT = 0xFFFFFFFFu;
+
+    enum Flags : uint8_t {
+        FLAG_VISIBLE       = 1 << 0,
+        FLAG_ACTIVE        = 1 << 1,
+        FLAG_MOVED         = 1 << 2,   // Pose set since the last savePreviousTransforms()
+        FLAG_LOCAL_STALE   = 1 << 3,   // localMatrices() entry is out of date
+        FLAG_WORLD_CHANGED = 1 << 4,   // World matrix rewritten by the latest pass
+    };
+    static constexpr uint8_t TRANSFORM_FLAGS = FLAG_MOVED | FLAG_LOCAL_STALE | FLAG_WORLD_CHANGED;
+
+    uint32_t add(EntityID id, Entity* entity) {
+        if (id >= m_sparse.size()) m_sparse.resize((size_t)id + 1, INVALID_INDEX);
+        if (m_sparse[id] != INVALID_INDEX) return m_sparse[id];
+
+        uint32_t index = (uint32_t)m_ids.size();
+        m_sparse[id] = index;
+        m_ids.push_back(id);
+        m_entities.push_back(entity);
+        m_positions.push_back({0, 0, 0});
+        m_rotations.push_back({0, 0, 0});
+        m_prevPositions.push_back({0, 0, 0});
+        m_prevRotations.push_back({0, 0, 0});
+        m_scales.push_back({1, 1, 1});
+        m_velocities.push_back({0, 0, 0});
+        m_angularVelocities.push_back({0, 0, 0});
+        m_models.push_back(nullptr);
+        m_flags.push_back(FLAG_VISIBLE | FLAG_ACTIVE | FLAG_LOCAL_STALE);
+        m_parents.push_back(NO_PARENT);
+        m_firstChildren.push_back(NO_PARENT);
+        m_nextSiblings.push_back(NO_PARENT);
+        m_prevSiblings.push_back(NO_PARENT);
+        m_localMatrices.push_back(mat4_identity());
+        m_worldMatrices.push_back(mat4_identity());
+        m_orderDirty = true;
+        m_transformsDirty.store(true, std::memory_order_relaxed);
+        return index;
+    }
+
+    // Children of a removed entity become roots, keeping their local pose
+    void remove(EntityID id) {
+        uint32_t index = indexOf(id);
+        if (index == INVALID_INDEX) return;
+        while (m_firstChildren[index] != NO_PARENT) setParentAt(indexOf(m_firstChildren[index]), NO_PARENT);
+        setParentAt(index, NO_PARENT);
+
+        uint32_t last = (uint32_t)m_ids.size() - 1;
+        if (index != last) {
+            m_ids[index] = m_ids[last];
+            m_entities[index] = m_entities[last];
+            m_positions[index] = m_positions[last];
+            m_rotations[index] = m_rotations[last];
+            m_prevPositions[index] = m_prevPositions[last];
+            m_prevRotations[index] = m_prevRotations[last];
+            m_scales[index] = m_scales[last];
+            m_velocities[index] = m_velocities[last];
+            m_angularVelocities[index] = m_angularVelocities[last];
+            m_models[index] = m_models[last];
+            m_flags[index] = m_flags[last];
+            m_parents[index] = m_parents[last];
+            m_firstChildren[index] = m_firstChildren[last];
+            m_nextSiblings[index] = m_nextSiblings[last];
+            m_prevSiblings[index] = m_prevSiblings[last];
+            m_localMatrices[index] = m_localMatrices[last];
+            m_worldMatrices[index] = m_worldMatrices[last];
+            m_sparse[m_ids[index]] = index;
+        }
+        m_ids.pop_back();
+        m_entities.pop_back();
+        m_positions.pop_back();
+        m_rotations.pop_back();
+        m_prevPositions.pop_back();
+        m_prevRotations.pop_back();
+        m_scales.pop_back();
+        m_velocities.pop_back();
+        m_angularVelocities.pop_back();
+        m_models.pop_back();
+        m_flags.pop_back();
+        m_parents.pop_back();
+        m_firstChildren.pop_back();
+        m_nextSiblings.pop_back();
+        m_prevSiblings.pop_back();
+        m_localMatrices.pop_back();
+        m_worldMatrices.pop_back();
+        m_sparse[id] = INVALID_INDEX;
+        m_orderDirty = true;
+    }
+
+    void clear() {
+        m_sparse.clear();
+        m_ids.clear();
+        m_entities.clear();
+        m_positions.clear();
+        m_rotations.clear();
+        m_prevPositions.clear();
+        m_prevRotations.clear();
+        m_scales.clear();
+        m_velocities.clear();
+        m_angularVelocities.clear();
+        m_models.clear();
+        m_flags.clear();
+        m_parents.clear();
+        m_firstChildren.clear();
+        m_nextSiblings.clear();
+        m_prevSiblings.clear();
+        m_localMatrices.clear();
+        m_worldMatrices.clear();
+        m_order.clear();
+        m_orderDirty = false;
+        m_transformsDirty.store(false, std::memory_order_relaxed);
+    }
+
+    void reserve(size_t count) {
+        m_ids.reserve(count);
+        m_entities.reserve(count);
+        m_positions.reserve(count);
+        m_rotations.reserve(count);
+        m_prevPositions.reserve(count);
+        m_prevRotations.reserve(count);
+        m_scales.reserve(count);
+        m_velocities.reserve(count);
+        m_angularVelocities.reserve(count);
+        m_models.reserve(count);
+        m_flags.reserve(count);
+        m_parents.reserve(count);
+        m_firstChildren.reserve(count);
+        m_nextSiblings.reserve(count);
+        m_prevSiblings.reserve(count);
+        m_localMatrices.reserve(count);
+        m_worldMatrices.reserve(count);
+    }
+
+    // Snapshot position/rotation before a fixed simulation step, so rendering
+    // can interpolate between the last two steps. Call again after placing
+    // entities directly (scene load) so nothing interpolates from the origin.
+    void savePreviousTransforms() {
+        m_prevPositions = m_positions;
+        m_prevRotations = m_rotations;
+        // Entities that moved still need one pass at their final pose
+        for (uint8_t& flags : m_flags) flags &= (uint8_t)~FLAG_MOVED;
+    }
+
+    // Call after changing positions(), rotations() or scales() through the
+    // arrays; the Entity setters do it themselves. Safe to call for
+    // different entities from several threads at once.
+    void markTransformChanged(uint32_t index) {
+        m_flags[index] |= FLAG_MOVED | FLAG_LOCAL_STALE;
+        if (!m_transformsDirty.load(std::memory_order_relaxed)) {
+            m_transformsDirty.store(true, std::memory_order_relaxed);
+        }
+    }
+
+    // ==================== Transform Hierarchy ====================
+    // Attaches 'index' to the entity 'parent' (NO_PARENT detaches). Its pose
+    // is kept as is, now read relative to the parent. Refuses a parent that
+    // does not exist or that would make a cycle.
+    bool setParent(uint32_t index, EntityID parent) {
+        if (parent != NO_PARENT) {
+            uint32_t ancestor = indexOf(parent);
+            if (ancestor == INVALID_INDEX) return false;
+            // Walk up from the new parent; meeting 'index' means a cycle
+            for (uint32_t depth = 0; ancestor != INVALID_INDEX; depth++) {
+                if (ancestor == index || depth > size()) return false;
+                ancestor = m_parents[ancestor] == NO_PARENT ? INVALID_INDEX : indexOf(m_parents[ancestor]);
+            }
+        }
+        setParentAt(index, parent);
+        return true;
+    }
+
+    EntityID getParent(uint32_t index) const { return m_parents[index]; }
+
+    // Matrix from the entity's current (not interpolated) pose to world
+    // space. Does not write the caches, so behaviors may call it while
+    // others run in parallel.
+    Mat4 currentWorldMatrix(uint32_t index) const {
+        Mat4 world = currentLocalMatrix(index);
+        for (uint32_t depth = 0; m_parents[index] != NO_PARENT && depth < size(); depth++) {
+            index = indexOf(m_parents[index]);
+            if (index == INVALID_INDEX) break;
+            world = mat4_mul(currentLocalMatrix(index), world);
+        }
+        return world;
+    }
+
+    // Rewrites worldMatrices() for entities whose transform changed, with
+    // moving entities blended 'alpha' of the way from their previous pose
+    // (as savePreviousTransforms() left it) to the current one. Returns the
+    // number of world matrices written; 0 without any work when nothing
+    // changed since the last pass.
+    uint32_t updateWorldTransforms(float alpha) {
+        if (!m_transformsDirty.load(std::memory_order_relaxed)) return 0;
+        m_transformsDirty.store(false, std::memory_order_relaxed);
+        if (m_orderDirty) rebuildOrder();
+
+        uint32_t updated = 0;
+        bool moving = false;
+        for (const TransformNode& node : m_order) {
+            uint32_t i = node.index;
+            uint8_t flags = m_flags[i] & (uint8_t)~FLAG_WORLD_CHANGED;
+            bool parentChanged = node.parent != INVALID_INDEX && (m_flags[node.parent] & FLAG_WORLD_CHANGED);
+            if (!(flags & (FLAG_MOVED | FLAG_LOCAL_STALE)) && !parentChanged) {
+                m_flags[i] = flags;
+                continue;
+            }
+
+            Mat4 local;
+            if (flags & FLAG_MOVED) {
+                // Between two steps: blend the pose, leave the cache stale
+                local = composeTransform(v3_lerp(m_prevPositions[i], m_positions[i], alpha),
+                                         v3_angleLerp(m_prevRotations[i], m_rotations[i], alpha),
+                                         m_scales[i]);
+                moving = true;
+            } else {
+                if (flags & FLAG_LOCAL_STALE) {
+                    m_localMatrices[i] = composeTransform(m_positions[i], m_rotations[i], m_scales[i]);
+                    flags &= (uint8_t)~FLAG_LOCAL_STALE;
+                }
+                local = m_localMatrices[i];
+            }
+            m_worldMatrices[i] = node.parent != INVALID_INDEX ? mat4_mul(m_worldMatrices[node.parent], local) : local;
+            m_flags[i] = flags | FLAG_WORLD_CHANGED;
+            updated++;
+        }
+        // Moving entities are blended again next frame
+        if (moving) m_transformsDirty.store(true, std::memory_order_relaxed);
+        return updated;
+    }
+
+    // T * R * S with YXZ Euler angles (yaw * pitch * roll)
+    static Mat4 composeTransform(const Vec3& position, const Vec3& rotation, const Vec3& scale) {
+        float cosY = std::cos(rotation.y);  // yaw
+        float sinY = std::sin(rotation.y);
+        float cosP = std::cos(rotation.x);  // pitch
+        float sinP = std::sin(rotation.x);
+        float cosR = std::cos(rotation.z);  // roll
+        float sinR = std::sin(rotation.z);
+
+        Mat4 mat;
+        mat.m[0] = (cosY * cosR + sinY * sinP * sinR) * scale.x;
+        mat.m[1] = cosP * sinR * scale.x;
+        mat.m[2] = (-sinY * cosR + cosY * sinP * sinR) * scale.x;
+        mat.m[3] = 0.0f;
+
+        mat.m[4] = (-cosY * sinR + sinY * sinP * cosR) * scale.y;
+        mat.m[5] = cosP * cosR * scale.y;
+        mat.m[6] = (sinY * sinR + cosY * sinP * cosR) * scale.y;
+        mat.m[7] = 0.0f;
+
+        mat.m[8] = sinY * cosP * scale.z;
+        mat.m[9] = -sinP * scale.z;
+        mat.m[10] = cosY * cosP * scale.z;
+        mat.m[11] = 0.0f;
+
+        mat.m[12] = position.x;
+        mat.m[13] = position.y;
+        mat.m[14] = position.z;
+        mat.m[15] = 1.0f;
+        return mat;
+    }
+
+    uint32_t indexOf(EntityID id) const {
+        return id < m_sparse.size() ? m_sparse[id] : INVALID_INDEX;
+    }
+    bool contains(EntityID id) const { return indexOf(id) != INVALID_INDEX; }
+    uint32_t size() const { return (uint32_t)m_ids.size(); }
+
+    // Dense arrays, all size() long and indexed alike
+    const EntityID* ids() const { return m_ids.data(); }
+    Entity* const* entities() const { return m_entities.data(); }
+    Vec3* positions() { return m_positions.data(); }
+    const Vec3* positions() const { return m_positions.data(); }
+    Vec3* rotations() { return m_rotations.data(); }
+    const Vec3* rotations() const { return m_rotations.data(); }
+    const Vec3* previousPositions() const { return m_prevPositions.data(); }
+    const Vec3* previousRotations() const { return m_prevRotations.data(); }
+    Vec3* scales() { return m_scales.data(); }
+    const Vec3* scales() const { return m_scales.data(); }
+    Vec3* velocities() { return m_velocities.data(); }
+    const Vec3* velocities() const { return m_velocities.data(); }
+    Vec3* angularVelocities() { return m_angularVelocities.data(); }
+    const Vec3* angularVelocities() const { return m_angularVelocities.data(); }
+    const Model** models() { return m_models.data(); }
+    const Model* const* models() const { return m_models.data(); }
+    uint8_t* flags() { return m_flags.data(); }
+    const uint8_t* flags() const { return m_flags.data(); }
+    // Pose relative to the parent, as of the last pass that settled it
+    const Mat4* localMatrices() const { return m_localMatrices.data(); }
+    // World matrices as of the last updateWorldTransforms()
+    const Mat4* worldMatrices() const { return m_worldMatrices.data(); }
+
+private:
+    // Dense index of an entity and of its parent (INVALID_INDEX for roots)
+    struct TransformNode {
+        uint32_t index;
+        uint32_t parent;
+    };
+
+    Mat4 currentLocalMatrix(uint32_t index) const {
+        if (!(m_flags[index] & FLAG_LOCAL_STALE)) return m_localMatrices[index];
+        return composeTransform(m_positions[index], m_rotations[index], m_scales[index]);
+    }
+
+    // Also moves the entity from its old parent's child list to the new one's
+    void setParentAt(uint32_t index, EntityID parent) {
+        EntityID oldParent = m_parents[index];
+        if (oldParent == parent) return;
+        if (oldParent != NO_PARENT) {
+            EntityID prev = m_prevSiblings[index];
+            EntityID next = m_nextSiblings[index];
+            if (prev != NO_PARENT) {
+                m_nextSiblings[indexOf(prev)] = next;
+            } else {
+                m_firstChildren[indexOf(oldParent)] = next;
+            }
+            if (next != NO_PARENT) m_prevSiblings[indexOf(next)] = prev;
+            m_prevSiblings[index] = NO_PARENT;
+            m_nextSiblings[index] = NO_PARENT;
+        }
+        if (parent != NO_PARENT) {
+            uint32_t parentIndex = indexOf(parent);
+            EntityID head = m_firstChildren[parentIndex];
+            m_nextSiblings[index] = head;
+            if (head != NO_PARENT) m_prevSiblings[indexOf(head)] = m_ids[index];
+            m_firstChildren[parentIndex] = m_ids[index];
+        }
+        m_parents[index] = parent;
+        m_flags[index] |= FLAG_LOCAL_STALE;
+        m_orderDirty = true;
+        m_transformsDirty.store(true, std::memory_order_relaxed);
+    }
+
+    // Parents before children: sort by depth in the hierarchy (a counting
+    // sort, so entities of one depth stay in dense order)
+    void rebuildOrder() {
+        const uint32_t count = size();
+        std::vector<uint32_t> depths(count, INVALID_INDEX);
+        uint32_t maxDepth = 0;
+        std::vector<uint32_t> chain;
+        for (uint32_t i = 0; i < count; i++) {
+            // Climb until an entity whose depth is known (or a root)
+            uint32_t at = i;
+            chain.clear();
+            while (at != INVALID_INDEX && depths[at] == INVALID_INDEX) {
+                chain.push_back(at);
+                at = m_parents[at] == NO_PARENT ? INVALID_INDEX : indexOf(m_parents[at]);
+            }
+            uint32_t depth = at == INVALID_INDEX ? 0 : depths[at] + 1;
+            for (size_t k = chain.size(); k-- > 0; depth++) depths[chain[k]] = depth;
+            maxDepth = (std::max)(maxDepth, depth);
+        }
+
+        std::vector<uint32_t> starts((size_t)maxDepth + 1, 0);
+        for (uint32_t i = 0; i < count; i++) starts[depths[i]]++;
+        uint32_t offset = 0;
+        for (uint32_t& start : starts) {
+            uint32_t n = start;
+            start = offset;
+            offset += n;
+        }
+        m_order.resize(count);
+        for (uint32_t i = 0; i < count; i++) {
+            uint32_t parent = m_parents[i] == NO_PARENT ? INVALID_INDEX : indexOf(m_parents[i]);
+            m_order[starts[depths[i]]++] = { i, parent };
+        }
+        m_orderDirty = false;
+    }
+
+    std::vector<uint32_t> m_sparse;     // EntityID -> dense index
+    std::vector<EntityID> m_ids;
+    std::vector<Entity*> m_entities;    // Facade objects (names, virtual update)
+    std::vector<Vec3> m_positions;
+    std::vector<Vec3> m_rotations;      // Euler angles in radians
+    std::vector<Vec3> m_prevPositions;  // As of the last savePreviousTransforms()
+    std::vector<Vec3> m_prevRotations;
+    std::vector<Vec3> m_scales;
+    std::vector<Vec3> m_velocities;
+    std::vector<Vec3> m_angularVelocities;
+    std::vector<const Model*> m_models;
+    std::vector<uint8_t> m_flags;
+    std::vector<EntityID> m_parents;    // NO_PARENT for roots
+    // Children as a doubly linked list of EntityIDs (NO_PARENT ends it), so
+    // remove() detaches just the actual children
+    std::vector<EntityID> m_firstChildren;
+    std::vector<EntityID> m_nextSiblings;
+    std::vector<EntityID> m_prevSiblings;
+    std::vector<Mat4> m_localMatrices;
+    std::vector<Mat4> m_worldMatrices;
+    std::vector<TransformNode> m_order; // Parents first; rebuilt when the hierarchy changes
+    bool m_orderDirty = false;
+    std::atomic<bool> m_transformsDirty{false};
+};
+
+#endif // ENTITY_STORAGE_H
@@ -0,0 +1,77 @@
+// file_watcher.h - Modification-time polling for hot reload
+#ifndef FILE_WATCHER_H
+#define FILE_WATCHER_H
+
+#include <filesystem>
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <system_error>
+
+// ==================== File Watcher ====================
+// Remembers a modification time per tracked path and reports the paths
+// whose time differs since they were tracked or last polled. A file that
+// disappears counts as changed once; when it comes back it changes again.
+// Polling only stats the files, so calling it a few times a second is cheap.
+class FileWatcher {
+public:
+    // Start watching 'path' at its current time. Paths already tracked keep
+    // their recorded time, so a change is not lost by tracking it again.
+    void track(const std::string& path) {
+        if (path.empty() || m_files.count(path)) return;
+        m_files[path] = stamp(path);
+    }
+
+    bool isTracked(const std::string& path) const { return m_files.count(path) != 0; }
+
+    // Changed since track()/poll(), without consuming the change
+    bool hasChanged(const std::string& path) const {
+        auto it = m_files.find(path);
+        return it != m_files.end() && !(stamp(path) == it->second);
+    }
+
+    bool anyChanged() const {
+        for (const auto& [path, recorded] : m_files) {
+            if (!(stamp(path) == recorded)) return true;
+        }
+        return false;
+    }
+
+    // Changed paths; their recorded times move on to the current ones
+    std::vector<std::string> poll() {
+        std::vector<std::string> changed;
+        for (auto& [path, recorded] : m_files) {
+            Stamp current = stamp(path);
+            if (current == recorded) continue;
+            recorded = current;
+            changed.push_back(path);
+        }
+        return changed;
+    }
+
+    void untrack(const std::string& path) { m_files.erase(path); }
+    void clear() { m_files.clear(); }
+    size_t getTrackedCount() const { return m_files.size(); }
+
+private:
+    struct Stamp {
+        bool exists = false;
+        std::filesystem::file_time_type time;
+
+        bool operator==(const Stamp& other) const {
+            return exists == other.exists && (!exists || time == other.time);
+        }
+    };
+
+    static Stamp stamp(const std::string& path) {
+        Stamp result;
+        std::error_code ec;
+        result.time = std::filesystem::last_write_time(path, ec);
+        result.exists = !ec;
+        return result;
+    }
+
+    std::unordered_map<std::string, Stamp> m_files;
+};
+
+#endif // FILE_WATCHER_H
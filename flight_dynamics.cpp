@@ -4,6 +4,7 @@
 #include "debug.h"
 #include <cmath>
 #include <algorithm>
+#include <atomic>
 
 // Helper functions
 static float clamp(float v, float min, float max) {
@@ -73,12 +74,16 @@ void FlightDynamics::update(float deltaTime) {
 }
 
 void FlightDynamics::computeForces(Vec3& force, Vec3& torque) {
-    // Debug: Log at entry
-    static int frameCount = 0;
-    if (++frameCount % 60 == 0 && (m_controls.elevator != 0 || m_controls.aileron != 0 || m_controls.rudder != 0)) {
+#if CUBE_LOG_MAX_LEVEL >= 3
+    // Debug: Log at entry. Atomic: aircraft may update on several job
+    // threads at once, so the shared counter is only touched when logging.
+    static std::atomic<int> frameCount(0);
+    if (DebugManager::isLogged(LogLevel::DEBUG) && ++frameCount % 60 == 0 &&
+        (m_controls.elevator != 0 || m_controls.aileron != 0 || m_controls.rudder != 0)) {
         LOG_DEBUG("computeForces: controls(e=%.2f a=%.2f r=%.2f)",
                  m_controls.elevator, m_controls.aileron, m_controls.rudder);
     }
+#endif
     
     // ==================== FORCES (Newtons) ====================
     
@@ -163,10 +168,9 @@ void FlightDynamics::integrateState(float dt, const Vec3& force, const Vec3& tor
     float Izz = m_params.mass * m_params.wingspan * m_params.wingspan * 0.0010f;  // Yaw - slightly heavier
     
     // Debug: Log inertia values once
-    static bool logged = false;
-    if (!logged) {
+    static std::atomic<bool> logged(false);
+    if (!logged.exchange(true)) {
         LOG_INFO("Moments of inertia: Ixx=%.1f Iyy=%.1f Izz=%.1f kg⋅m²", Ixx, Iyy, Izz);
-        logged = true;
     }
     
     // Debug: Log torques if any control input
@@ -322,10 +326,12 @@ Vec3 FlightDynamics::bodyToWorld(const Vec3& bodyVec) const {
 Vec3 FlightDynamics::worldToBody(const Vec3& worldVec) const {
     // Rotate vector from world frame to body frame
     // Apply inverse: Roll^-1 * Pitch^-1 * Yaw^-1
+    // (cos(-a) = cos(a), sin(-a) = -sin(a): the same sin/cos as bodyToWorld,
+    // which lets AircraftBatch share them and still match bit for bit)
     
     // Yaw inverse
-    float cosY = std::cos(-m_state.yaw);
-    float sinY = std::sin(-m_state.yaw);
+    float cosY = std::cos(m_state.yaw);
+    float sinY = -std::sin(m_state.yaw);
     Vec3 afterYaw = {
         worldVec.x * cosY - worldVec.z * sinY,
         worldVec.y,
@@ -333,8 +339,8 @@ Vec3 FlightDynamics::worldToBody(const Vec3& worldVec) const {
     };
     
     // Pitch inverse
-    float cosP = std::cos(-m_state.pitch);
-    float sinP = std::sin(-m_state.pitch);
+    float cosP = std::cos(m_state.pitch);
+    float sinP = -std::sin(m_state.pitch);
     Vec3 afterPitch = {
         afterYaw.x,
         afterYaw.y * cosP - afterYaw.z * sinP,
@@ -342,8 +348,8 @@ Vec3 FlightDynamics::worldToBody(const Vec3& worldVec) const {
     };
     
     // Roll inverse
-    float cosR = std::cos(-m_state.roll);
-    float sinR = std::sin(-m_state.roll);
+    float cosR = std::cos(m_state.roll);
+    float sinR = -std::sin(m_state.roll);
     Vec3 afterRoll = {
         afterPitch.x * cosR - afterPitch.y * sinR,
         afterPitch.x * sinR + afterPitch.y * cosR,
@@ -153,7 +153,8 @@ private:
     Vec3 m_initialPosition;
     float m_initialHeading;
     
-    // Constants
+public:
+    // Constants (shared with AircraftBatch)
     static constexpr float GRAVITY = 9.81f;        // m/s²
     static constexpr float AIR_DENSITY = 1.225f;   // kg/m³ at sea level
 };
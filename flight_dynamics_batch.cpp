@@ -0,0 +1,313 @@
+// flight_dynamics_batch.cpp - SIMD kernel for AircraftBatch
+#include "flight_dynamics_batch.h"
+#include <cmath>
+
+#if defined(__AVX__)
+#define FLIGHT_BATCH_AVX
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define FLIGHT_BATCH_SSE2
+#include <emmintrin.h>
+#elif defined(__aarch64__) || defined(_M_ARM64)
+// AArch64 only: 32-bit NEON has no correctly rounded divide / sqrt
+#define FLIGHT_BATCH_NEON
+#include <arm_neon.h>
+#endif
+
+namespace {
+
+// ==================== Lane Types ====================
+// Floats: one value per aircraft. Masks: per-lane results of a compare.
+// Only the operations the model uses, each an exact IEEE op per lane.
+
+#if defined(FLIGHT_BATCH_AVX)
+
+constexpr uint32_t LANES = 8;
+struct Floats { __m256 v; };
+struct Mask { __m256 v; };
+inline Floats load(const float* p) { return { _mm256_loadu_ps(p) }; }
+inline void store(float* p, Floats a) { _mm256_storeu_ps(p, a.v); }
+inline Floats splat(float s) { return { _mm256_set1_ps(s) }; }
+inline Floats operator+(Floats a, Floats b) { return { _mm256_add_ps(a.v, b.v) }; }
+inline Floats operator-(Floats a, Floats b) { return { _mm256_sub_ps(a.v, b.v) }; }
+inline Floats operator*(Floats a, Floats b) { return { _mm256_mul_ps(a.v, b.v) }; }
+inline Floats operator/(Floats a, Floats b) { return { _mm256_div_ps(a.v, b.v) }; }
+inline Floats operator-(Floats a) { return { _mm256_xor_ps(a.v, _mm256_set1_ps(-0.0f)) }; }
+inline Floats sqrtLanes(Floats a) { return { _mm256_sqrt_ps(a.v) }; }
+inline Mask operator<(Floats a, Floats b) { return { _mm256_cmp_ps(a.v, b.v, _CMP_LT_OQ) }; }
+inline Mask operator&(Mask a, Mask b) { return { _mm256_and_ps(a.v, b.v) }; }
+inline Floats select(Mask m, Floats a, Floats b) { return { _mm256_blendv_ps(b.v, a.v, m.v) }; }
+inline bool any(Mask m) { return _mm256_movemask_ps(m.v) != 0; }
+
+#elif defined(FLIGHT_BATCH_SSE2)
+
+constexpr uint32_t LANES = 4;
+struct Floats { __m128 v; };
+struct Mask { __m128 v; };
+inline Floats load(const float* p) { return { _mm_loadu_ps(p) }; }
+inline void store(float* p, Floats a) { _mm_storeu_ps(p, a.v); }
+inline Floats splat(float s) { return { _mm_set1_ps(s) }; }
+inline Floats operator+(Floats a, Floats b) { return { _mm_add_ps(a.v, b.v) }; }
+inline Floats operator-(Floats a, Floats b) { return { _mm_sub_ps(a.v, b.v) }; }
+inline Floats operator*(Floats a, Floats b) { return { _mm_mul_ps(a.v, b.v) }; }
+inline Floats operator/(Floats a, Floats b) { return { _mm_div_ps(a.v, b.v) }; }
+inline Floats operator-(Floats a) { return { _mm_xor_ps(a.v, _mm_set1_ps(-0.0f)) }; }
+inline Floats sqrtLanes(Floats a) { return { _mm_sqrt_ps(a.v) }; }
+inline Mask operator<(Floats a, Floats b) { return { _mm_cmplt_ps(a.v, b.v) }; }
+inline Mask operator&(Mask a, Mask b) { return { _mm_and_ps(a.v, b.v) }; }
+inline Floats select(Mask m, Floats a, Floats b) {
+    return { _mm_or_ps(_mm_and_ps(m.v, a.v), _mm_andnot_ps(m.v, b.v)) };
+}
+inline bool any(Mask m) { return _mm_movemask_ps(m.v) != 0; }
+
+#elif defined(FLIGHT_BATCH_NEON)
+
+constexpr uint32_t LANES = 4;
+struct Floats { float32x4_t v; };
+struct Mask { uint32x4_t v; };
+inline Floats load(const float* p) { return { vld1q_f32(p) }; }
+inline void store(float* p, Floats a) { vst1q_f32(p, a.v); }
+inline Floats splat(float s) { return { vdupq_n_f32(s) }; }
+inline Floats operator+(Floats a, Floats b) { return { vaddq_f32(a.v, b.v) }; }
+inline Floats operator-(Floats a, Floats b) { return { vsubq_f32(a.v, b.v) }; }
+inline Floats operator*(Floats a, Floats b) { return { vmulq_f32(a.v, b.v) }; }
+inline Floats operator/(Floats a, Floats b) { return { vdivq_f32(a.v, b.v) }; }
+inline Floats operator-(Floats a) { return { vnegq_f32(a.v) }; }
+inline Floats sqrtLanes(Floats a) { return { vsqrtq_f32(a.v) }; }
+inline Mask operator<(Floats a, Floats b) { return { vcltq_f32(a.v, b.v) }; }
+inline Mask operator&(Mask a, Mask b) { return { vandq_u32(a.v, b.v) }; }
+inline Floats select(Mask m, Floats a, Floats b) { return { vbslq_f32(m.v, a.v, b.v) }; }
+inline bool any(Mask m) { return vmaxvq_u32(m.v) != 0; }
+
+#else
+
+constexpr uint32_t LANES = 1;
+struct Floats { float v; };
+struct Mask { bool v; };
+inline Floats load(const float* p) { return { *p }; }
+inline void store(float* p, Floats a) { *p = a.v; }
+inline Floats splat(float s) { return { s }; }
+inline Floats operator+(Floats a, Floats b) { return { a.v + b.v }; }
+inline Floats operator-(Floats a, Floats b) { return { a.v - b.v }; }
+inline Floats operator*(Floats a, Floats b) { return { a.v * b.v }; }
+inline Floats operator/(Floats a, Floats b) { return { a.v / b.v }; }
+inline Floats operator-(Floats a) { return { -a.v }; }
+inline Floats sqrtLanes(Floats a) { return { std::sqrt(a.v) }; }
+inline Mask operator<(Floats a, Floats b) { return { a.v < b.v }; }
+inline Mask operator&(Mask a, Mask b) { return { a.v && b.v }; }
+inline Floats select(Mask m, Floats a, Floats b) { return m.v ? a : b; }
+inline bool any(Mask m) { return m.v; }
+
+#endif
+
+static_assert(AircraftBatch::PADDING % LANES == 0, "batch padding must be whole lanes");
+
+inline Floats operator*(Floats a, float b) { return a * splat(b); }
+inline Floats operator+(float a, Floats b) { return splat(a) + b; }
+inline Mask operator<(Floats a, float b) { return a < splat(b); }
+inline Mask operator<(float a, Floats b) { return splat(a) < b; }
+inline Mask operator>(Floats a, float b) { return splat(b) < a; }
+
+// Same as clamp() in flight_dynamics.cpp: max(lo, min(hi, v)) with
+// std::min/max's tie and NaN behaviour
+inline Floats clampLanes(Floats v, float lo, float hi) {
+    Floats m = select(v < hi, v, splat(hi));
+    return select(lo < m, m, splat(lo));
+}
+
+// ==================== Rotations ====================
+
+struct SinCos {
+    Floats sinP, cosP, sinY, cosY, sinR, cosR;
+};
+
+// Scalar libm per lane: a vector polynomial would be faster but would
+// no longer match FlightDynamics exactly
+inline SinCos sinCosLanes(const float* pitch, const float* yaw, const float* roll) {
+    float s[3][LANES], c[3][LANES];
+    for (uint32_t k = 0; k < LANES; k++) {
+        s[0][k] = std::sin(pitch[k]); c[0][k] = std::cos(pitch[k]);
+        s[1][k] = std::sin(yaw[k]);   c[1][k] = std::cos(yaw[k]);
+        s[2][k] = std::sin(roll[k]);  c[2][k] = std::cos(roll[k]);
+    }
+    return { load(s[0]), load(c[0]), load(s[1]), load(c[1]), load(s[2]), load(c[2]) };
+}
+
+// FlightDynamics::bodyToWorld: Yaw * Pitch * Roll
+inline void bodyToWorld(const SinCos& r, Floats& x, Floats& y, Floats& z) {
+    Floats rollX = x * r.cosR - y * r.sinR;
+    Floats rollY = x * r.sinR + y * r.cosR;
+    Floats pitchY = rollY * r.cosP - z * r.sinP;
+    Floats pitchZ = rollY * r.sinP + z * r.cosP;
+    x = rollX * r.cosY - pitchZ * r.sinY;
+    y = pitchY;
+    z = rollX * r.sinY + pitchZ * r.cosY;
+}
+
+// FlightDynamics::worldToBody: Roll^-1 * Pitch^-1 * Yaw^-1
+inline void worldToBody(const SinCos& r, Floats& x, Floats& y, Floats& z) {
+    Floats sinY = -r.sinY, sinP = -r.sinP, sinR = -r.sinR;
+    Floats yawX = x * r.cosY - z * sinY;
+    Floats yawZ = x * sinY + z * r.cosY;
+    Floats pitchY = y * r.cosP - yawZ * sinP;
+    Floats pitchZ = y * sinP + yawZ * r.cosP;
+    x = yawX * r.cosR - pitchY * sinR;
+    y = yawX * sinR + pitchY * r.cosR;
+    z = pitchZ;
+}
+
+inline Floats wrapAngle(Floats a) {
+    const float PI = 3.14159265359f;
+    Mask m;
+    while (any(m = a > PI)) a = select(m, a - splat(2.0f * PI), a);
+    while (any(m = a < -PI)) a = select(m, a + splat(2.0f * PI), a);
+    return a;
+}
+
+// ==================== Kernel ====================
+// One FlightDynamics::update (computeForces + integrateState + ground
+// constraint) for the LANES aircraft starting at 'i'. Expressions are
+// kept in the scalar code's order, zero terms included.
+
+void stepLanes(AircraftBatch& b, uint32_t i, float dt) {
+    const float GRAVITY = FlightDynamics::GRAVITY;
+    const float AIR_DENSITY = FlightDynamics::AIR_DENSITY;
+    const Floats zero = splat(0.0f);
+
+    Floats posX = load(&b.posX[i]), posY = load(&b.posY[i]), posZ = load(&b.posZ[i]);
+    Floats pitch = load(&b.pitch[i]), yaw = load(&b.yaw[i]), roll = load(&b.roll[i]);
+    Floats velX = load(&b.velX[i]), velY = load(&b.velY[i]), velZ = load(&b.velZ[i]);
+    Floats speed = load(&b.speed[i]);
+    Floats pitchRate = load(&b.pitchRate[i]), yawRate = load(&b.yawRate[i]), rollRate = load(&b.rollRate[i]);
+    Floats elevator = load(&b.elevator[i]);
+    Floats mass = load(&b.mass[i]), wingArea = load(&b.wingArea[i]), wingspan = load(&b.wingspan[i]);
+
+    // ---------- computeForces ----------
+    Floats thrust = load(&b.throttle[i]) * load(&b.maxThrust[i]);
+
+    Floats gravityX = zero, gravityY = -mass * GRAVITY, gravityZ = zero;
+    SinCos before = sinCosLanes(&b.pitch[i], &b.yaw[i], &b.roll[i]);
+    worldToBody(before, gravityX, gravityY, gravityZ);
+
+    Floats q = splat(0.5f * AIR_DENSITY) * speed * speed;
+
+    Floats angleOfAttack = pitch + elevator * 0.3f;
+    Floats liftCoeff = load(&b.liftCoeff[i]) * (1.0f + angleOfAttack * 3.0f);
+    liftCoeff = clampLanes(liftCoeff, -0.5f, 1.5f);
+    Floats lift = q * wingArea * liftCoeff;
+
+    Floats dragCoeff = load(&b.dragCoeff[i]) * (1.0f + angleOfAttack * angleOfAttack * 5.0f);
+    Floats drag = q * wingArea * dragCoeff;
+
+    // Lanes at or below 0.1 m/s divide by ~0 here; select() drops them
+    Mask moving = speed > 0.1f;
+    Floats dragX = select(moving, -(velX / speed) * drag, zero);
+    Floats dragY = select(moving, -(velY / speed) * drag, zero);
+    Floats dragZ = select(moving, -(velZ / speed) * drag, zero);
+
+    Floats forceX = zero + (gravityX + (zero + dragX));
+    Floats forceY = zero + (gravityY + (lift + dragY));
+    Floats forceZ = -thrust + (gravityZ + (zero + dragZ));
+
+    Floats controlPower = clampLanes(q * 0.03f, 5.0f, 150.0f);
+    Floats pitchMoment = -elevator * load(&b.elevatorPower[i]) * controlPower;
+    Floats rollMoment = load(&b.aileron[i]) * load(&b.aileronPower[i]) * controlPower;
+    Floats yawMoment = load(&b.rudder[i]) * load(&b.rudderPower[i]) * controlPower;
+
+    Floats dampingFactor = q * 0.001f;
+    pitchMoment = pitchMoment - pitchRate * load(&b.pitchStability[i]) * dampingFactor;
+    rollMoment = rollMoment - rollRate * load(&b.rollStability[i]) * dampingFactor;
+    yawMoment = yawMoment - yawRate * load(&b.yawStability[i]) * dampingFactor;
+
+    // ---------- integrateState ----------
+    Floats Ixx = mass * wingspan * wingspan * 0.0008f;
+    Floats Iyy = mass * 12.0f * 12.0f * 0.0008f;
+    Floats Izz = mass * wingspan * wingspan * 0.0010f;
+
+    pitchRate = pitchRate + pitchMoment / Iyy * dt;
+    yawRate = yawRate + yawMoment / Izz * dt;
+    rollRate = rollRate + rollMoment / Ixx * dt;
+
+    pitchRate = clampLanes(pitchRate, -4.0f, 4.0f);
+    yawRate = clampLanes(yawRate, -3.0f, 3.0f);
+    rollRate = clampLanes(rollRate, -6.0f, 6.0f);
+
+    pitch = wrapAngle(pitch + pitchRate * dt);
+    yaw = wrapAngle(yaw + yawRate * dt);
+    roll = wrapAngle(roll + rollRate * dt);
+
+    float angles[3][LANES];
+    store(angles[0], pitch);
+    store(angles[1], yaw);
+    store(angles[2], roll);
+    SinCos after = sinCosLanes(angles[0], angles[1], angles[2]);
+
+    bodyToWorld(after, forceX, forceY, forceZ);
+    Floats accelX = forceX / mass, accelY = forceY / mass, accelZ = forceZ / mass;
+
+    Floats worldX = velX, worldY = velY, worldZ = velZ;
+    bodyToWorld(after, worldX, worldY, worldZ);
+    worldX = worldX + accelX * dt;
+    worldY = worldY + accelY * dt;
+    worldZ = worldZ + accelZ * dt;
+
+    velX = worldX; velY = worldY; velZ = worldZ;
+    worldToBody(after, velX, velY, velZ);
+
+    posX = posX + worldX * dt;
+    posY = posY + worldY * dt;
+    posZ = posZ + worldZ * dt;
+
+    Floats lengthSq = worldX * worldX + worldY * worldY + worldZ * worldZ;
+    speed = sqrtLanes(lengthSq);
+
+    // Minimum flying speed: same direction, 20 m/s (v3_norm + v3_scale)
+    Mask slow = speed < 20.0f;
+    if (any(slow)) {
+        Mask rescale = slow & (speed > 0.1f);
+        Floats length = sqrtLanes(select(1e-20f < lengthSq, lengthSq, splat(1e-20f)));
+        Floats minX = worldX / length * 20.0f;
+        Floats minY = worldY / length * 20.0f;
+        Floats minZ = worldZ / length * 20.0f;
+        worldToBody(after, minX, minY, minZ);
+        velX = select(rescale, minX, velX);
+        velY = select(rescale, minY, velY);
+        velZ = select(rescale, minZ, velZ);
+        speed = select(slow, splat(20.0f), speed);
+    }
+
+    // ---------- ground constraint ----------
+    Mask grounded = posY < 2.0f;
+    posY = select(grounded, splat(2.0f), posY);
+    Mask sinking = grounded & (velY < 0.0f);
+    velY = select(sinking, zero, velY);
+    velX = select(sinking, velX * 0.95f, velX);
+    velZ = select(sinking, velZ * 0.95f, velZ);
+
+    store(&b.posX[i], posX); store(&b.posY[i], posY); store(&b.posZ[i], posZ);
+    store(&b.pitch[i], pitch); store(&b.yaw[i], yaw); store(&b.roll[i], roll);
+    store(&b.velX[i], velX); store(&b.velY[i], velY); store(&b.velZ[i], velZ);
+    store(&b.speed[i], speed);
+    store(&b.pitchRate[i], pitchRate); store(&b.yawRate[i], yawRate); store(&b.rollRate[i], rollRate);
+}
+
+} // namespace
+
+void AircraftBatch::update(float deltaTime) {
+    if (deltaTime <= 0.0f || deltaTime > 1.0f) return;  // Sanity check
+    for (uint32_t i = 0; i < m_count; i += LANES) {
+        stepLanes(*this, i, deltaTime);
+    }
+}
+
+const char* AircraftBatch::getSimdName() {
+#if defined(FLIGHT_BATCH_AVX)
+    return "AVX";
+#elif defined(FLIGHT_BATCH_SSE2)
+    return "SSE2";
+#elif defined(FLIGHT_BATCH_NEON)
+    return "NEON";
+#else
+    return "scalar";
+#endif
+}
@@ -0,0 +1,145 @@
+// flight_dynamics_batch.h - SoA flight dynamics stepping many aircraft per call
+#ifndef FLIGHT_DYNAMICS_BATCH_H
+#define FLIGHT_DYNAMICS_BATCH_H
+
+#include "flight_dynamics.h"
+#include <cstdint>
+#include <vector>
+#include <initializer_list>
+
+// ==================== Aircraft Batch ====================
+// The FlightDynamics model with one array per field, so update() advances
+// several aircraft per instruction (8 with AVX, 4 with SSE2 or NEON, else 1).
+// Every lane does the same float operations in the same order as
+// FlightDynamics::update and uses the same libm sin/cos, so results are
+// identical to stepping each aircraft on its own (as long as neither
+// build contracts into FMA, which C++17 without extensions doesn't).
+//
+// Arrays are public for bulk access and padded to a multiple of PADDING;
+// entries past size() hold copies of a real aircraft so they stay finite;
+// they are simulated but never read back.
+class AircraftBatch {
+public:
+    static constexpr uint32_t PADDING = 8;   // Widest SIMD lane count
+
+    uint32_t add(const AircraftState& state, const ControlInputs& controls,
+                 const AircraftParams& params = AircraftParams()) {
+        uint32_t index = m_count++;
+        if (index >= (uint32_t)mass.size()) {
+            resizeFields(index + PADDING);
+            for (uint32_t i = index; i < index + PADDING; i++) setRow(i, state, controls, params);
+        } else {
+            setRow(index, state, controls, params);
+        }
+        return index;
+    }
+
+    void clear() {
+        m_count = 0;
+        resizeFields(0);
+    }
+
+    void reserve(size_t count) {
+        size_t padded = (count + PADDING - 1) / PADDING * PADDING;
+        forEachField([padded](std::vector<float>& field) { field.reserve(padded); });
+    }
+
+    uint32_t size() const { return m_count; }
+
+    // Advance every aircraft by deltaTime; like FlightDynamics::update,
+    // steps outside (0, 1] s are ignored
+    void update(float deltaTime);
+
+    AircraftState getState(uint32_t index) const {
+        AircraftState s;
+        s.position = { posX[index], posY[index], posZ[index] };
+        s.pitch = pitch[index];
+        s.yaw = yaw[index];
+        s.roll = roll[index];
+        s.velocity = { velX[index], velY[index], velZ[index] };
+        s.speed = speed[index];
+        s.pitchRate = pitchRate[index];
+        s.yawRate = yawRate[index];
+        s.rollRate = rollRate[index];
+        return s;
+    }
+
+    void setState(uint32_t index, const AircraftState& s) {
+        posX[index] = s.position.x; posY[index] = s.position.y; posZ[index] = s.position.z;
+        pitch[index] = s.pitch; yaw[index] = s.yaw; roll[index] = s.roll;
+        velX[index] = s.velocity.x; velY[index] = s.velocity.y; velZ[index] = s.velocity.z;
+        speed[index] = s.speed;
+        pitchRate[index] = s.pitchRate; yawRate[index] = s.yawRate; rollRate[index] = s.rollRate;
+    }
+
+    void setControls(uint32_t index, const ControlInputs& c) {
+        elevator[index] = c.elevator;
+        aileron[index] = c.aileron;
+        rudder[index] = c.rudder;
+        throttle[index] = c.throttle;
+    }
+
+    void setParams(uint32_t index, const AircraftParams& p) {
+        mass[index] = p.mass;
+        wingArea[index] = p.wingArea;
+        wingspan[index] = p.wingspan;
+        liftCoeff[index] = p.liftCoeff;
+        dragCoeff[index] = p.dragCoeff;
+        elevatorPower[index] = p.elevatorPower;
+        aileronPower[index] = p.aileronPower;
+        rudderPower[index] = p.rudderPower;
+        maxThrust[index] = p.maxThrust;
+        pitchStability[index] = p.pitchStability;
+        rollStability[index] = p.rollStability;
+        yawStability[index] = p.yawStability;
+    }
+
+    // Instruction set update() was built for ("AVX", "SSE2", "NEON", "scalar")
+    static const char* getSimdName();
+
+    // State (same units and frames as AircraftState)
+    std::vector<float> posX, posY, posZ;
+    std::vector<float> pitch, yaw, roll;
+    std::vector<float> velX, velY, velZ;         // Body frame
+    std::vector<float> speed;
+    std::vector<float> pitchRate, yawRate, rollRate;
+
+    // Controls
+    std::vector<float> elevator, aileron, rudder, throttle;
+
+    // Parameters (sideForceCoeff is unused by the model and not stored)
+    std::vector<float> mass, wingArea, wingspan;
+    std::vector<float> liftCoeff, dragCoeff;
+    std::vector<float> elevatorPower, aileronPower, rudderPower;
+    std::vector<float> maxThrust;
+    std::vector<float> pitchStability, rollStability, yawStability;
+
+private:
+    void setRow(uint32_t index, const AircraftState& state, const ControlInputs& controls,
+                const AircraftParams& params) {
+        setState(index, state);
+        setControls(index, controls);
+        setParams(index, params);
+    }
+
+    void resizeFields(size_t count) {
+        forEachField([count](std::vector<float>& field) { field.resize(count); });
+    }
+
+    template <typename Func>
+    void forEachField(Func func) {
+        for (std::vector<float>* field : {
+                 &posX, &posY, &posZ, &pitch, &yaw, &roll, &velX, &velY, &velZ, &speed,
+                 &pitchRate, &yawRate, &rollRate,
+                 &elevator, &aileron, &rudder, &throttle,
+                 &mass, &wingArea, &wingspan, &liftCoeff, &dragCoeff,
+                 &elevatorPower, &aileronPower, &rudderPower, &maxThrust,
+                 &pitchStability, &rollStability, &yawStability }) {
+            func(*field);
+        }
+    }
+
+    uint32_t m_count = 0;
+};
+
+#endif // FLIGHT_DYNAMICS_BATCH_H
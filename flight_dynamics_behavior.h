@@ -4,6 +4,7 @@
 
 #include "behavior.h"
 #include "flight_dynamics.h"
+#include "debug.h"
 
 // ==================== Flight Dynamics Behavior ====================
 // Controls an entity using realistic flight physics
@@ -37,9 +38,8 @@ public:
             // Set initial throttle for stable cruise flight
             m_flightDynamics.getControlInputs().throttle = 0.7f;
             
-            printf("DEBUG: Flight initialized at (%.1f, %.1f, %.1f)\n", pos.x, pos.y, pos.z);
-            printf("       Heading %.1f deg, velocity (%.1f, %.1f, %.1f)\n",
-                   heading * 57.2958f, state.velocity.x, state.velocity.y, state.velocity.z);
+            LOG_DEBUG("Flight initialized at (%.1f, %.1f, %.1f), heading %.1f deg, velocity (%.1f, %.1f, %.1f)",
+                      pos.x, pos.y, pos.z, heading * 57.2958f, state.velocity.x, state.velocity.y, state.velocity.z);
         }
     }
     
@@ -57,6 +57,11 @@ public:
         m_entity->setAngularVelocity({state.pitchRate, state.yawRate, state.rollRate});
     }
     
+    // Writes only its own entity, so entities update in parallel
+    BehaviorAccess getAccess() const override {
+        return { 0, COMPONENT_TRANSFORM | COMPONENT_VELOCITY, false, false, BehaviorPhase::Simulation };
+    }
+    
     // Control interface
     void setControlInputs(const ControlInputs& inputs) {
         m_flightDynamics.setControlInputs(inputs);
@@ -0,0 +1,477 @@
+// flight_recorder.h - Per-step flight state/input recording and deterministic replay
+#ifndef FLIGHT_RECORDER_H
+#define FLIGHT_RECORDER_H
+
+#include "flight_dynamics.h"
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+// ==================== Flight Sample ====================
+// One aircraft at the end of one physics step: its AircraftState (without
+// the accelerations, which each step recomputes) and the ControlInputs the
+// step ran with. Together with the state the step started from, that is
+// everything FlightDynamics::update reads, so feeding the controls back in
+// reproduces the states bit for bit.
+static const uint32_t FLIGHT_SAMPLE_FIELDS = 17;
+
+struct FlightSample {
+    uint32_t id;                              // EntityID
+    float    values[FLIGHT_SAMPLE_FIELDS];    // See the FIELD_* indices
+
+    enum Field : uint32_t {
+        FIELD_POSITION   = 0,    // x, y, z (world)
+        FIELD_ROTATION   = 3,    // pitch, yaw, roll
+        FIELD_VELOCITY   = 6,    // x, y, z (body frame)
+        FIELD_SPEED      = 9,
+        FIELD_RATES      = 10,   // pitch, yaw, roll rate
+        FIELD_CONTROLS   = 13,   // elevator, aileron, rudder, throttle
+    };
+
+    static FlightSample capture(uint32_t id, const AircraftState& s, const ControlInputs& c) {
+        return { id, { s.position.x, s.position.y, s.position.z, s.pitch, s.yaw, s.roll,
+                       s.velocity.x, s.velocity.y, s.velocity.z, s.speed,
+                       s.pitchRate, s.yawRate, s.rollRate,
+                       c.elevator, c.aileron, c.rudder, c.throttle } };
+    }
+
+    void applyState(AircraftState& s) const {
+        s.position = { values[0], values[1], values[2] };
+        s.pitch = values[3];
+        s.yaw = values[4];
+        s.roll = values[5];
+        s.velocity = { values[6], values[7], values[8] };
+        s.speed = values[9];
+        s.pitchRate = values[10];
+        s.yawRate = values[11];
+        s.rollRate = values[12];
+    }
+
+    ControlInputs controls() const {
+        ControlInputs c;
+        c.elevator = values[13];
+        c.aileron = values[14];
+        c.rudder = values[15];
+        c.throttle = values[16];
+        return c;
+    }
+
+    // Bitwise, so a replay that drifts by one ulp shows up
+    bool sameState(const FlightSample& other) const {
+        return std::memcmp(values, other.values, FIELD_CONTROLS * sizeof(float)) == 0;
+    }
+};
+
+// ==================== Recording Format ====================
+// Little-endian:
+//   FlightRecordingHeader
+//   chunks: FlightRecordingChunk, then byteSize bytes of encoded steps
+//
+// A chunk holds up to TICKS_PER_CHUNK steps and decodes on its own. Each
+// step is varint(tick - previous tick in the chunk; firstTick for the
+// first), varint(sample count), then per sample varint(zigzag(id -
+// previous id in the step)) and one varint per field: the float's bits
+// XORed with the same field of the same id's previous sample in the chunk
+// (0 for its first). Smoothly changing values keep their sign, exponent
+// and high mantissa bits from step to step, so most fields take one to
+// three bytes; held controls take one.
+static const char     FLIGHTREC_MAGIC[8] = { 'C', 'U', 'B', 'E', 'F', 'R', 'E', 'C' };
+static const uint32_t FLIGHTREC_VERSION  = 1;
+
+struct FlightRecordingHeader {
+    char     magic[8];
+    uint32_t version;
+    uint32_t fieldCount;     // FLIGHT_SAMPLE_FIELDS
+    double   step;           // Simulation step in seconds
+};
+
+struct FlightRecordingChunk {
+    uint64_t firstTick;
+    uint32_t tickCount;
+    uint32_t byteSize;       // Encoded steps that follow
+};
+
+static_assert(sizeof(FlightRecordingHeader) == 24, "FlightRecordingHeader is part of the file format");
+static_assert(sizeof(FlightRecordingChunk) == 16, "FlightRecordingChunk is part of the file format");
+
+namespace FlightRecordingCodec {
+
+inline void putVarint(std::vector<uint8_t>& out, uint64_t value) {
+    while (value >= 0x80) {
+        out.push_back((uint8_t)(value | 0x80));
+        value >>= 7;
+    }
+    out.push_back((uint8_t)value);
+}
+
+// False on a truncated or overlong value
+inline bool getVarint(const uint8_t*& p, const uint8_t* end, uint64_t& value) {
+    value = 0;
+    for (uint32_t shift = 0; shift < 64; shift += 7) {
+        if (p == end) return false;
+        uint8_t byte = *p++;
+        value |= (uint64_t)(byte & 0x7F) << shift;
+        if (!(byte & 0x80)) return true;
+    }
+    return false;
+}
+
+inline uint64_t zigzag(int64_t value) { return ((uint64_t)value << 1) ^ (uint64_t)(value >> 63); }
+inline int64_t unzigzag(uint64_t value) { return (int64_t)(value >> 1) ^ -(int64_t)(value & 1); }
+
+// Previous field bits per entity, reset at every chunk
+using History = std::unordered_map<uint32_t, std::array<uint32_t, FLIGHT_SAMPLE_FIELDS>>;
+
+} // namespace FlightRecordingCodec
+
+// ==================== Flight Recorder ====================
+// The simulation thread copies each step's samples into a preallocated
+// single-producer, single-consumer ring; a writer thread encodes them into
+// chunks and writes those out. Recording a step is a few plain stores per
+// aircraft and two atomic operations, with no allocation or locking. If the
+// writer falls behind and the ring fills up, whole steps are dropped
+// (counted, and visible as tick gaps in the file) instead of stalling the
+// simulation.
+class FlightRecorder {
+public:
+    static constexpr uint32_t DEFAULT_SAMPLE_CAPACITY = 1u << 17;   // ~2 s of 500 aircraft at 120 Hz
+    static constexpr uint32_t TICK_CAPACITY = 1024;                 // Steps in the ring
+    static constexpr uint32_t TICKS_PER_CHUNK = 120;
+    static constexpr std::chrono::milliseconds IDLE_WAIT{ 5 };
+
+    FlightRecorder() = default;
+    ~FlightRecorder() { close(); }
+    FlightRecorder(const FlightRecorder&) = delete;
+    FlightRecorder& operator=(const FlightRecorder&) = delete;
+
+    // Allocates the ring (rounded up to a power of two) and starts the writer
+    bool open(const std::string& path, double step, uint32_t sampleCapacity = DEFAULT_SAMPLE_CAPACITY) {
+        close();
+        m_file = std::fopen(path.c_str(), "wb");
+        if (!m_file) {
+            std::fprintf(stderr, "FlightRecorder: cannot write %s\n", path.c_str());
+            return false;
+        }
+        FlightRecordingHeader header = {};
+        std::memcpy(header.magic, FLIGHTREC_MAGIC, sizeof(header.magic));
+        header.version = FLIGHTREC_VERSION;
+        header.fieldCount = FLIGHT_SAMPLE_FIELDS;
+        header.step = step;
+        if (std::fwrite(&header, sizeof(header), 1, m_file) != 1) {
+            std::fprintf(stderr, "FlightRecorder: write to %s failed\n", path.c_str());
+            std::fclose(m_file);
+            m_file = nullptr;
+            return false;
+        }
+
+        uint32_t size = 1;
+        while (size < sampleCapacity) size <<= 1;
+        m_samples.assign(size, FlightSample());
+        m_sampleMask = size - 1;
+        m_ticks.assign(TICK_CAPACITY, TickEntry());
+        m_path = path;
+        m_writePos = m_tickStart = m_consumedSamplesSeen = 0;
+        m_tickWritePos = m_consumedTicksSeen = 0;
+        m_tickOpen = m_tickOverflow = false;
+        m_recordedTicks = m_droppedTicks = 0;
+        m_publishedTicks.store(0, std::memory_order_relaxed);
+        m_consumedTicks.store(0, std::memory_order_relaxed);
+        m_consumedSamples.store(0, std::memory_order_relaxed);
+        m_bytesWritten.store(sizeof(header), std::memory_order_relaxed);
+        m_writeFailed.store(false, std::memory_order_relaxed);
+        m_stop.store(false, std::memory_order_relaxed);
+        m_thread = std::thread([this] { threadMain(); });
+        return true;
+    }
+
+    // Writes out every step ended before the call; returns false if any
+    // write since open() failed
+    bool close() {
+        if (!m_file) return true;
+        m_stop.store(true, std::memory_order_release);
+        if (m_thread.joinable()) m_thread.join();
+        bool ok = !m_writeFailed.load(std::memory_order_relaxed) && !std::ferror(m_file);
+        ok = (std::fclose(m_file) == 0) && ok;
+        m_file = nullptr;
+        if (!ok) std::fprintf(stderr, "FlightRecorder: write to %s failed\n", m_path.c_str());
+        m_samples = std::vector<FlightSample>();
+        m_ticks = std::vector<TickEntry>();
+        return ok;
+    }
+
+    bool isOpen() const { return m_file != nullptr; }
+
+    // ---- Simulation thread ----
+    // beginTick, record() per aircraft, endTick. Ticks must increase.
+    void beginTick(uint64_t tick) {
+        m_tick = tick;
+        m_tickStart = m_writePos;
+        m_tickOpen = m_file != nullptr;
+        m_tickOverflow = false;
+    }
+
+    void record(uint32_t id, const AircraftState& state, const ControlInputs& controls) {
+        if (!m_tickOpen || m_tickOverflow) return;
+        if (m_writePos - m_consumedSamplesSeen > m_sampleMask) {
+            m_consumedSamplesSeen = m_consumedSamples.load(std::memory_order_acquire);
+            if (m_writePos - m_consumedSamplesSeen > m_sampleMask) {
+                m_tickOverflow = true;
+                return;
+            }
+        }
+        m_samples[m_writePos & m_sampleMask] = FlightSample::capture(id, state, controls);
+        m_writePos++;
+    }
+
+    void endTick() {
+        if (!m_tickOpen) return;
+        m_tickOpen = false;
+        if (!m_tickOverflow && m_tickWritePos - m_consumedTicksSeen >= TICK_CAPACITY) {
+            m_consumedTicksSeen = m_consumedTicks.load(std::memory_order_acquire);
+        }
+        if (m_tickOverflow || m_tickWritePos - m_consumedTicksSeen >= TICK_CAPACITY) {
+            m_writePos = m_tickStart;
+            m_droppedTicks++;
+            return;
+        }
+        m_ticks[m_tickWritePos % TICK_CAPACITY] = { m_tick, m_tickStart, (uint32_t)(m_writePos - m_tickStart) };
+        m_tickWritePos++;
+        m_publishedTicks.store(m_tickWritePos, std::memory_order_release);
+        m_recordedTicks++;
+    }
+
+    // Blocks until the writer has encoded every step ended before the
+    // call, so the whole ring is free again
+    void flush() {
+        if (!m_file) return;
+        while (m_consumedTicks.load(std::memory_order_acquire) < m_tickWritePos) {
+            std::this_thread::sleep_for(IDLE_WAIT / 2);
+        }
+        m_consumedTicksSeen = m_tickWritePos;
+        m_consumedSamplesSeen = m_writePos;
+    }
+
+    uint64_t getRecordedTicks() const { return m_recordedTicks; }
+    uint64_t getDroppedTicks() const { return m_droppedTicks; }
+    uint64_t getBytesWritten() const { return m_bytesWritten.load(std::memory_order_relaxed); }
+
+private:
+    struct TickEntry {
+        uint64_t tick = 0;
+        uint64_t firstSample = 0;   // Ring position
+        uint32_t count = 0;
+    };
+
+    void threadMain() {
+        using namespace FlightRecordingCodec;
+        std::vector<uint8_t> chunk;
+        chunk.reserve(1 << 20);
+        History history;
+        FlightRecordingChunk header = {};
+        uint64_t previousTick = 0;
+        uint64_t consumed = 0;
+
+        for (;;) {
+            // Read before draining, so the final pass sees every step ended
+            // before close()
+            bool stopping = m_stop.load(std::memory_order_acquire);
+            uint64_t published = m_publishedTicks.load(std::memory_order_acquire);
+            bool drained = consumed < published;
+            for (; consumed < published; consumed++) {
+                const TickEntry& entry = m_ticks[consumed % TICK_CAPACITY];
+                if (header.tickCount == 0) {
+                    header.firstTick = previousTick = entry.tick;
+                    history.clear();
+                }
+                putVarint(chunk, entry.tick - previousTick);
+                putVarint(chunk, entry.count);
+                previousTick = entry.tick;
+
+                uint32_t previousId = 0;
+                for (uint32_t i = 0; i < entry.count; i++) {
+                    const FlightSample& sample = m_samples[(entry.firstSample + i) & m_sampleMask];
+                    putVarint(chunk, zigzag((int64_t)sample.id - (int64_t)previousId));
+                    previousId = sample.id;
+                    auto inserted = history.try_emplace(sample.id);
+                    if (inserted.second) inserted.first->second.fill(0);
+                    std::array<uint32_t, FLIGHT_SAMPLE_FIELDS>& previous = inserted.first->second;
+                    for (uint32_t field = 0; field < FLIGHT_SAMPLE_FIELDS; field++) {
+                        uint32_t bits;
+                        std::memcpy(&bits, &sample.values[field], sizeof(bits));
+                        putVarint(chunk, bits ^ previous[field]);
+                        previous[field] = bits;
+                    }
+                }
+                m_consumedSamples.store(entry.firstSample + entry.count, std::memory_order_release);
+                m_consumedTicks.store(consumed + 1, std::memory_order_release);
+
+                if (++header.tickCount == TICKS_PER_CHUNK) writeChunk(header, chunk);
+            }
+            if (stopping) break;
+            if (!drained) std::this_thread::sleep_for(IDLE_WAIT);
+        }
+        writeChunk(header, chunk);
+        std::fflush(m_file);
+    }
+
+    void writeChunk(FlightRecordingChunk& header, std::vector<uint8_t>& chunk) {
+        if (header.tickCount == 0) return;
+        header.byteSize = (uint32_t)chunk.size();
+        bool ok = std::fwrite(&header, sizeof(header), 1, m_file) == 1 &&
+                  std::fwrite(chunk.data(), 1, chunk.size(), m_file) == chunk.size();
+        if (!ok) m_writeFailed.store(true, std::memory_order_relaxed);
+        m_bytesWritten.fetch_add(sizeof(header) + chunk.size(), std::memory_order_relaxed);
+        header.tickCount = 0;
+        chunk.clear();
+    }
+
+    FILE* m_file = nullptr;
+    std::string m_path;
+    std::thread m_thread;
+    std::vector<FlightSample> m_samples;   // Ring, indexed by position & m_sampleMask
+    uint64_t m_sampleMask = 0;
+    std::vector<TickEntry> m_ticks;        // Ring, indexed by position % TICK_CAPACITY
+
+    // Simulation thread only
+    uint64_t m_tick = 0;
+    uint64_t m_writePos = 0;
+    uint64_t m_tickStart = 0;
+    uint64_t m_tickWritePos = 0;
+    uint64_t m_consumedSamplesSeen = 0;    // Cached m_consumedSamples
+    uint64_t m_consumedTicksSeen = 0;      // Cached m_consumedTicks
+    bool m_tickOpen = false;
+    bool m_tickOverflow = false;
+    uint64_t m_recordedTicks = 0;
+    uint64_t m_droppedTicks = 0;
+
+    alignas(64) std::atomic<uint64_t> m_publishedTicks{ 0 };
+    alignas(64) std::atomic<uint64_t> m_consumedTicks{ 0 };
+    std::atomic<uint64_t> m_consumedSamples{ 0 };
+    std::atomic<uint64_t> m_bytesWritten{ 0 };
+    std::atomic<bool> m_writeFailed{ false };
+    std::atomic<bool> m_stop{ false };
+};
+
+// ==================== Flight Replay ====================
+// A recording decoded into memory, looked up by tick. Each step's samples
+// are sorted by id.
+class FlightReplay {
+public:
+    bool open(const std::string& path) {
+        using namespace FlightRecordingCodec;
+        m_samples.clear();
+        m_ticks.clear();
+
+        FILE* file = std::fopen(path.c_str(), "rb");
+        if (!file) {
+            std::fprintf(stderr, "FlightReplay: cannot read %s\n", path.c_str());
+            return false;
+        }
+        FlightRecordingHeader header;
+        bool ok = std::fread(&header, sizeof(header), 1, file) == 1 &&
+                  std::memcmp(header.magic, FLIGHTREC_MAGIC, sizeof(header.magic)) == 0 &&
+                  header.version == FLIGHTREC_VERSION && header.fieldCount == FLIGHT_SAMPLE_FIELDS;
+        if (!ok) {
+            std::fprintf(stderr, "FlightReplay: %s is not a flight recording\n", path.c_str());
+            std::fclose(file);
+            return false;
+        }
+        m_step = header.step;
+
+        std::vector<uint8_t> payload;
+        History history;
+        FlightRecordingChunk chunk;
+        while (ok && std::fread(&chunk, sizeof(chunk), 1, file) == 1) {
+            payload.resize(chunk.byteSize);
+            ok = std::fread(payload.data(), 1, payload.size(), file) == payload.size() &&
+                 decodeChunk(chunk, payload.data(), payload.data() + payload.size(), history);
+        }
+        std::fclose(file);
+        if (!ok) {
+            // A recording cut short (crash, full disk) still replays up to the damage
+            std::fprintf(stderr, "FlightReplay: %s is damaged after tick %llu\n", path.c_str(),
+                         (unsigned long long)(m_ticks.empty() ? 0 : m_ticks.back().tick));
+        }
+        return !m_ticks.empty();
+    }
+
+    double getStep() const { return m_step; }
+    uint64_t getLastTick() const { return m_ticks.empty() ? 0 : m_ticks.back().tick; }
+
+    // Samples of 'tick', or nullptr (count 0) if it was not recorded
+    const FlightSample* findTick(uint64_t tick, uint32_t& count) const {
+        auto it = std::lower_bound(m_ticks.begin(), m_ticks.end(), tick,
+                                   [](const TickRange& range, uint64_t t) { return range.tick < t; });
+        if (it == m_ticks.end() || it->tick != tick) {
+            count = 0;
+            return nullptr;
+        }
+        count = it->count;
+        return m_samples.data() + it->first;
+    }
+
+    static const FlightSample* findSample(const FlightSample* samples, uint32_t count, uint32_t id) {
+        const FlightSample* end = samples + count;
+        const FlightSample* it = std::lower_bound(samples, end, id,
+                                                  [](const FlightSample& s, uint32_t i) { return s.id < i; });
+        return (it != end && it->id == id) ? it : nullptr;
+    }
+
+private:
+    struct TickRange {
+        uint64_t tick;
+        size_t first;
+        uint32_t count;
+    };
+
+    bool decodeChunk(const FlightRecordingChunk& chunk, const uint8_t* p, const uint8_t* end,
+                     FlightRecordingCodec::History& history) {
+        using namespace FlightRecordingCodec;
+        history.clear();
+        uint64_t tick = chunk.firstTick;
+        for (uint32_t t = 0; t < chunk.tickCount; t++) {
+            uint64_t tickDelta, count;
+            if (!getVarint(p, end, tickDelta) || !getVarint(p, end, count)) return false;
+            tick += tickDelta;
+            if (count > (uint64_t)(end - p)) return false;   // Each sample takes bytes
+
+            TickRange range = { tick, m_samples.size(), (uint32_t)count };
+            int64_t id = 0;
+            for (uint64_t i = 0; i < count; i++) {
+                uint64_t value;
+                if (!getVarint(p, end, value)) return false;
+                id += unzigzag(value);
+                FlightSample sample;
+                sample.id = (uint32_t)id;
+                auto inserted = history.try_emplace(sample.id);
+                if (inserted.second) inserted.first->second.fill(0);
+                std::array<uint32_t, FLIGHT_SAMPLE_FIELDS>& previous = inserted.first->second;
+                for (uint32_t field = 0; field < FLIGHT_SAMPLE_FIELDS; field++) {
+                    if (!getVarint(p, end, value)) return false;
+                    previous[field] ^= (uint32_t)value;
+                    std::memcpy(&sample.values[field], &previous[field], sizeof(float));
+                }
+                m_samples.push_back(sample);
+            }
+            std::sort(m_samples.begin() + range.first, m_samples.end(),
+                      [](const FlightSample& a, const FlightSample& b) { return a.id < b.id; });
+            if (!m_ticks.empty() && tick <= m_ticks.back().tick) return false;
+            m_ticks.push_back(range);
+        }
+        return p == end;
+    }
+
+    double m_step = 0.0;
+    std::vector<FlightSample> m_samples;
+    std::vector<TickRange> m_ticks;
+};
+
+#endif // FLIGHT_RECORDER_H
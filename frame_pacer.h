@@ -0,0 +1,57 @@
+// frame_pacer.h - CPU frame rate limiter for the main loop
+#ifndef FRAME_PACER_H
+#define FRAME_PACER_H
+
+#include <chrono>
+#include <thread>
+
+// ==================== Frame Pacer ====================
+// Holds the loop to a target rate by waiting at the start of each frame,
+// before input is sampled, so a limited frame is late to start rather than
+// late to display. The wait sleeps until shortly before the deadline and
+// spins the rest, since sleeps overshoot by up to a scheduler tick.
+//
+// Deadlines advance by exactly one interval, so the average rate holds even
+// though single waits jitter; a frame that runs over by more than an
+// interval restarts the schedule instead of racing to catch up.
+class FramePacer {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    // 0 = unlimited
+    void setTargetFps(double fps) {
+        m_targetFps = fps > 0.0 ? fps : 0.0;
+        m_started = false;
+    }
+    double getTargetFps() const { return m_targetFps; }
+    bool isLimiting() const { return m_targetFps > 0.0; }
+
+    // Seconds spent waiting
+    double wait() {
+        if (!isLimiting()) return 0.0;
+        Clock::time_point now = Clock::now();
+        Clock::duration interval = std::chrono::duration_cast<Clock::duration>(
+            std::chrono::duration<double>(1.0 / m_targetFps));
+        if (!m_started || now > m_deadline + interval) {
+            m_started = true;
+            m_deadline = now + interval;
+            return 0.0;
+        }
+
+        Clock::time_point start = now;
+        if (m_deadline - now > SPIN_MARGIN) std::this_thread::sleep_until(m_deadline - SPIN_MARGIN);
+        while (Clock::now() < m_deadline) std::this_thread::yield();
+        now = Clock::now();
+        m_deadline += interval;
+        return std::chrono::duration<double>(now - start).count();
+    }
+
+private:
+    static constexpr std::chrono::microseconds SPIN_MARGIN{ 1500 };
+
+    double m_targetFps = 0.0;
+    bool m_started = false;
+    Clock::time_point m_deadline;
+};
+
+#endif // FRAME_PACER_H
@@ -0,0 +1,131 @@
+// frame_pipeline.h - Double-buffered frame hand-off between simulation and render threads
+#ifndef FRAME_PIPELINE_H
+#define FRAME_PIPELINE_H
+
+#include <cstdint>
+#include <mutex>
+#include <condition_variable>
+
+// ==================== Frame Pipeline ====================
+// Two Frame slots passed back and forth between one producer (simulation)
+// and one consumer (render) thread. The producer fills a slot between
+// beginWrite() and publish(), the consumer draws it between wait() and
+// endRead(); slots are used strictly in turn, so the producer can fill
+// frame N+1 while frame N is drawn, but never gets further ahead than that.
+// A slot is only touched by one side at a time and keeps what the other
+// side left in it, so the consumer can hand results back in the slot too.
+//
+// pause() is for producer work that needs the consumer's resources (e.g.
+// the renderer during a scene reload): the consumer draws every published
+// frame, gets Event::Pause from wait(), lets its resources go and calls
+// parked(), which returns once the producer calls resume().
+template <typename Frame>
+class FramePipeline {
+public:
+    enum class Event {
+        Draw,     // 'frame' is ready to draw; call endRead() when done
+        Pause,    // Release resources, then call parked()
+        Stop,     // Exit the consumer loop
+    };
+
+    FramePipeline() = default;
+    FramePipeline(const FramePipeline&) = delete;
+    FramePipeline& operator=(const FramePipeline&) = delete;
+
+    // ---- Producer ----
+
+    // Next slot to fill; blocks while the consumer is still drawing it
+    Frame& beginWrite() {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_cv.wait(lock, [this] { return m_state[m_write] == SlotState::Free || m_stop; });
+        return m_slots[m_write];
+    }
+
+    void publish() {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_state[m_write] = SlotState::Ready;
+            m_write ^= 1;
+        }
+        m_cv.notify_all();
+    }
+
+    // Returns once every published frame is drawn and the consumer is parked
+    void pause() {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_pauseRequested = true;
+        m_cv.notify_all();
+        m_cv.wait(lock, [this] { return m_parked || m_stop; });
+    }
+
+    void resume() {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_pauseRequested = false;
+        }
+        m_cv.notify_all();
+    }
+
+    void stop() {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_stop = true;
+        }
+        m_cv.notify_all();
+    }
+
+    // Back to two free slots, for a pipeline that is started again
+    void reset() {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_state[0] = m_state[1] = SlotState::Free;
+        m_write = m_read = 0;
+        m_pauseRequested = m_parked = m_stop = false;
+    }
+
+    // ---- Consumer ----
+
+    Event wait(Frame*& frame) {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_cv.wait(lock, [this] { return m_stop || m_state[m_read] == SlotState::Ready || m_pauseRequested; });
+        if (m_stop) return Event::Stop;
+        if (m_state[m_read] == SlotState::Ready) {
+            m_state[m_read] = SlotState::Drawing;
+            frame = &m_slots[m_read];
+            return Event::Draw;
+        }
+        return Event::Pause;
+    }
+
+    void endRead() {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_state[m_read] = SlotState::Free;
+            m_read ^= 1;
+        }
+        m_cv.notify_all();
+    }
+
+    // Blocks until resume() (or stop())
+    void parked() {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_parked = true;
+        m_cv.notify_all();
+        m_cv.wait(lock, [this] { return !m_pauseRequested || m_stop; });
+        m_parked = false;
+    }
+
+private:
+    enum class SlotState : uint8_t { Free, Ready, Drawing };
+
+    Frame m_slots[2];
+    SlotState m_state[2] = { SlotState::Free, SlotState::Free };
+    uint32_t m_write = 0;
+    uint32_t m_read = 0;
+    bool m_pauseRequested = false;
+    bool m_parked = false;
+    bool m_stop = false;
+    std::mutex m_mutex;
+    std::condition_variable m_cv;
+};
+
+#endif // FRAME_PIPELINE_H
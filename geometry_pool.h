@@ -0,0 +1,204 @@
+// geometry_pool.h - Mesh sub-allocation from large shared vertex/index buffers
+#ifndef GEOMETRY_POOL_H
+#define GEOMETRY_POOL_H
+
+#include <cstdint>
+#include <iterator>
+#include <map>
+#include <vector>
+#include <algorithm>
+
+// ==================== Range Allocator ====================
+// Offsets in [0, capacity), in whatever unit the caller counts (vertices,
+// indices). Free space is a list of ranges sorted by offset; allocation is
+// first fit, and freeing merges the range with its free neighbours, so the
+// list never holds two adjacent ranges and an emptied allocator is a single
+// range again.
+class RangeAllocator {
+public:
+    static constexpr uint32_t INVALID = ~0u;
+
+    explicit RangeAllocator(uint32_t capacity = 0) { reset(capacity); }
+
+    void reset(uint32_t capacity) {
+        m_capacity = capacity;
+        m_used = 0;
+        m_free.clear();
+        if (capacity > 0) m_free[0] = capacity;
+    }
+
+    // Offset of 'size' free units, or INVALID
+    uint32_t allocate(uint32_t size) {
+        if (size == 0) return INVALID;
+        for (auto it = m_free.begin(); it != m_free.end(); ++it) {
+            if (it->second < size) continue;
+            uint32_t offset = it->first;
+            uint32_t remaining = it->second - size;
+            m_free.erase(it);
+            if (remaining > 0) m_free[offset + size] = remaining;
+            m_used += size;
+            return offset;
+        }
+        return INVALID;
+    }
+
+    void free(uint32_t offset, uint32_t size) {
+        if (size == 0) return;
+        m_used -= size;
+        auto next = m_free.lower_bound(offset);
+        if (next != m_free.end() && offset + size == next->first) {
+            size += next->second;
+            next = m_free.erase(next);
+        }
+        if (next != m_free.begin()) {
+            auto prev = std::prev(next);
+            if (prev->first + prev->second == offset) {
+                prev->second += size;
+                return;
+            }
+        }
+        m_free[offset] = size;
+    }
+
+    uint32_t capacity() const { return m_capacity; }
+    uint32_t used() const { return m_used; }
+    size_t freeRangeCount() const { return m_free.size(); }
+
+    uint32_t largestFree() const {
+        uint32_t largest = 0;
+        for (const auto& range : m_free) largest = (std::max)(largest, range.second);
+        return largest;
+    }
+
+private:
+    uint32_t m_capacity = 0;
+    uint32_t m_used = 0;
+    std::map<uint32_t, uint32_t> m_free;   // Offset -> size
+};
+
+// Default block sizes
+static const uint64_t GEOMETRY_VERTEX_BLOCK_BYTES = 16ull * 1024 * 1024;
+static const uint64_t GEOMETRY_INDEX_BLOCK_BYTES  = 8ull * 1024 * 1024;
+
+// ==================== Geometry Pool ====================
+// Bookkeeping for blocks of one vertex buffer plus one index buffer each;
+// the backend owns the API buffers and keeps them in an array parallel to
+// the pool's blocks. A block holds one vertex layout (identified by its
+// stride) and one index size, so every mesh in it can be drawn with the
+// same buffer bindings at (baseVertex, firstIndex). Meshes too large for a
+// standard block get a block of their own size.
+//
+// Nothing moves once allocated: freeing merges the space with its free
+// neighbours and the block keeps its buffers for the next mesh, so handing
+// out a range never needs a GPU copy.
+struct GeometryRange {
+    uint32_t block = ~0u;         // Pool block holding the data
+    uint32_t baseVertex = 0;      // Into the block's vertex buffer
+    uint32_t vertexCount = 0;
+    uint32_t firstIndex = 0;      // Into the block's index buffer
+    uint32_t indexCount = 0;
+
+    bool valid() const { return block != ~0u; }
+};
+
+class GeometryPool {
+public:
+    struct Block {
+        uint32_t vertexStride;    // Bytes
+        uint32_t indexSize;       // 2 or 4 bytes
+        RangeAllocator vertices;
+        RangeAllocator indices;
+        uint32_t meshCount;
+    };
+
+    struct Stats {
+        uint32_t blocks = 0;
+        uint32_t meshes = 0;
+        uint64_t capacityBytes = 0;   // Vertex + index buffers of every block
+        uint64_t usedBytes = 0;
+        uint32_t freeRanges = 0;      // Vertex free list lengths; one per block when unfragmented
+    };
+
+    GeometryPool(uint64_t vertexBlockBytes, uint64_t indexBlockBytes)
+        : m_vertexBlockBytes(vertexBlockBytes)
+        , m_indexBlockBytes(indexBlockBytes)
+    {}
+
+    // Room for a mesh (both counts non-zero) in the first block of its
+    // format that fits. When none does, a block is appended and 'newBlock'
+    // is set: the caller creates its buffers (block(range.block) gives the
+    // capacities) before uploading.
+    GeometryRange allocate(uint32_t vertexStride, uint32_t indexSize,
+                           uint32_t vertexCount, uint32_t indexCount, bool& newBlock) {
+        newBlock = false;
+        GeometryRange range;
+        range.vertexCount = vertexCount;
+        range.indexCount = indexCount;
+        for (uint32_t b = 0; b < (uint32_t)m_blocks.size(); b++) {
+            if (tryAllocate(b, vertexStride, indexSize, range)) return range;
+        }
+
+        Block block;
+        block.vertexStride = vertexStride;
+        block.indexSize = indexSize;
+        block.vertices.reset((std::max)((uint32_t)(m_vertexBlockBytes / vertexStride), vertexCount));
+        block.indices.reset((std::max)((uint32_t)(m_indexBlockBytes / indexSize), indexCount));
+        block.meshCount = 0;
+        m_blocks.push_back(block);
+        newBlock = true;
+        tryAllocate((uint32_t)m_blocks.size() - 1, vertexStride, indexSize, range);
+        return range;
+    }
+
+    void free(const GeometryRange& range) {
+        if (!range.valid() || range.block >= m_blocks.size()) return;
+        Block& block = m_blocks[range.block];
+        block.vertices.free(range.baseVertex, range.vertexCount);
+        block.indices.free(range.firstIndex, range.indexCount);
+        block.meshCount--;
+    }
+
+    // Forget every block; the caller has released their buffers
+    void clear() { m_blocks.clear(); }
+
+    const Block& block(uint32_t index) const { return m_blocks[index]; }
+    uint32_t blockCount() const { return (uint32_t)m_blocks.size(); }
+
+    Stats getStats() const {
+        Stats stats;
+        stats.blocks = (uint32_t)m_blocks.size();
+        for (const Block& block : m_blocks) {
+            stats.meshes += block.meshCount;
+            stats.capacityBytes += (uint64_t)block.vertices.capacity() * block.vertexStride +
+                                   (uint64_t)block.indices.capacity() * block.indexSize;
+            stats.usedBytes += (uint64_t)block.vertices.used() * block.vertexStride +
+                               (uint64_t)block.indices.used() * block.indexSize;
+            stats.freeRanges += (uint32_t)block.vertices.freeRangeCount();
+        }
+        return stats;
+    }
+
+private:
+    bool tryAllocate(uint32_t index, uint32_t vertexStride, uint32_t indexSize, GeometryRange& range) {
+        Block& block = m_blocks[index];
+        if (block.vertexStride != vertexStride || block.indexSize != indexSize) return false;
+        uint32_t baseVertex = block.vertices.allocate(range.vertexCount);
+        if (baseVertex == RangeAllocator::INVALID) return false;
+        uint32_t firstIndex = block.indices.allocate(range.indexCount);
+        if (firstIndex == RangeAllocator::INVALID) {
+            block.vertices.free(baseVertex, range.vertexCount);
+            return false;
+        }
+        range.block = index;
+        range.baseVertex = baseVertex;
+        range.firstIndex = firstIndex;
+        block.meshCount++;
+        return true;
+    }
+
+    uint64_t m_vertexBlockBytes;
+    uint64_t m_indexBlockBytes;
+    std::vector<Block> m_blocks;
+};
+
+#endif // GEOMETRY_POOL_H
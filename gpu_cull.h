@@ -0,0 +1,139 @@
+// gpu_cull.h - CPU side of GPU instance culling: pass inputs and indirect draw arguments
+#ifndef GPU_CULL_H
+#define GPU_CULL_H
+
+#include "renderer.h"
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+#include <algorithm>
+
+// ==================== Mesh Bounds ====================
+// Bounding sphere (xyz = center, w = radius) around the centre of the
+// vertices' box. Both vertex formats start with the float position.
+inline Vec4 computeMeshBounds(const void* vertices, uint32_t vertexCount, size_t stride) {
+    if (vertexCount == 0) return { 0.0f, 0.0f, 0.0f, 0.0f };
+    const uint8_t* bytes = (const uint8_t*)vertices;
+    float pos[3];
+    float lo[3], hi[3];
+    std::memcpy(lo, bytes, sizeof(lo));
+    std::memcpy(hi, bytes, sizeof(hi));
+    for (uint32_t i = 1; i < vertexCount; i++) {
+        std::memcpy(pos, bytes + i * stride, sizeof(pos));
+        for (int a = 0; a < 3; a++) {
+            lo[a] = (std::min)(lo[a], pos[a]);
+            hi[a] = (std::max)(hi[a], pos[a]);
+        }
+    }
+
+    Vec4 bounds = { (lo[0] + hi[0]) * 0.5f, (lo[1] + hi[1]) * 0.5f, (lo[2] + hi[2]) * 0.5f, 0.0f };
+    float radiusSq = 0.0f;
+    for (uint32_t i = 0; i < vertexCount; i++) {
+        std::memcpy(pos, bytes + i * stride, sizeof(pos));
+        float dx = pos[0] - bounds.x, dy = pos[1] - bounds.y, dz = pos[2] - bounds.z;
+        radiusSq = (std::max)(radiusSq, dx * dx + dy * dy + dz * dz);
+    }
+    bounds.w = std::sqrt(radiusSq);
+    return bounds;
+}
+
+// ==================== Indirect Draw Arguments ====================
+// The layout of both GL's DrawElementsIndirectCommand and
+// D3D12_DRAW_INDEXED_ARGUMENTS
+struct IndirectDrawArgs {
+    uint32_t indexCount;
+    uint32_t instanceCount;   // 0 until the cull pass counts the visible instances
+    uint32_t firstIndex;
+    int32_t  baseVertex;
+    uint32_t firstInstance;   // Into the visible-instance buffer
+};
+static_assert(sizeof(IndirectDrawArgs) == 20, "IndirectDrawArgs must match the API indirect argument layouts");
+
+// ==================== GPU Cull Batch ====================
+// Inputs of one cull pass, built from an InstancedDraw batch. The pass runs
+// one thread per instance: it transforms bounds[drawIds[i]] by the
+// instance's world matrix, tests it against the frustum planes and, if any
+// part is inside, appends the instance to its draw's range of the visible
+// buffer (args[d].firstInstance + an atomic add on args[d].instanceCount).
+// Each draw's range is as long as its unculled instance count, so the
+// visible buffer has the size of getInstances().
+//
+// Consecutive draws whose meshes share a group key (backend-defined: same
+// buffers and vertex format) and texture form a Group, submitted as one
+// indirect multi-draw. Visible instances within a draw come out in no
+// particular order.
+class GpuCullBatch {
+public:
+    // What the batch needs to know about a mesh
+    struct MeshInfo {
+        uint32_t indexCount;
+        uint32_t firstIndex;
+        int32_t  baseVertex;
+        Vec4     bounds;       // Local bounding sphere
+        uint64_t groupKey;     // Equal for meshes one multi-draw can cover
+    };
+
+    struct Group {
+        uint32_t firstDraw;    // Into getArgs()
+        uint32_t drawCount;
+        uint32_t meshHandle;   // First draw's mesh; its buffers and format serve the whole group
+        uint32_t textureHandle;
+        uint32_t instances;    // Before culling
+        uint64_t triangles;    // Before culling
+    };
+
+    // lookup(meshHandle, MeshInfo&) returns false for meshes that cannot be
+    // drawn (unknown, still uploading); their draws are left out
+    template <typename Lookup>
+    void build(const InstancedDraw* draws, uint32_t drawCount, Lookup&& lookup) {
+        m_instances.clear();
+        m_drawIds.clear();
+        m_bounds.clear();
+        m_args.clear();
+        m_groups.clear();
+
+        uint64_t lastKey = 0;
+        for (uint32_t i = 0; i < drawCount; i++) {
+            const InstancedDraw& draw = draws[i];
+            MeshInfo info;
+            if (draw.instanceCount == 0 || !draw.instances || !lookup(draw.meshHandle, info)) continue;
+
+            uint32_t drawIndex = (uint32_t)m_args.size();
+            uint32_t firstInstance = (uint32_t)m_instances.size();
+            m_args.push_back({ info.indexCount, 0, info.firstIndex, info.baseVertex, firstInstance });
+            m_bounds.push_back(info.bounds);
+            m_instances.insert(m_instances.end(), draw.instances, draw.instances + draw.instanceCount);
+            m_drawIds.insert(m_drawIds.end(), draw.instanceCount, drawIndex);
+
+            uint64_t triangles = (uint64_t)(info.indexCount / 3) * draw.instanceCount;
+            if (!m_groups.empty() && lastKey == info.groupKey &&
+                m_groups.back().textureHandle == draw.textureHandle) {
+                Group& group = m_groups.back();
+                group.drawCount++;
+                group.instances += draw.instanceCount;
+                group.triangles += triangles;
+            } else {
+                m_groups.push_back({ drawIndex, 1, draw.meshHandle, draw.textureHandle,
+                                     draw.instanceCount, triangles });
+            }
+            lastKey = info.groupKey;
+        }
+    }
+
+    uint32_t instanceCount() const { return (uint32_t)m_instances.size(); }
+    const std::vector<InstanceData>& getInstances() const { return m_instances; }
+    const std::vector<uint32_t>& getDrawIds() const { return m_drawIds; }
+    const std::vector<Vec4>& getBounds() const { return m_bounds; }
+    const std::vector<IndirectDrawArgs>& getArgs() const { return m_args; }
+    const std::vector<Group>& getGroups() const { return m_groups; }
+
+private:
+    std::vector<InstanceData> m_instances;
+    std::vector<uint32_t> m_drawIds;
+    std::vector<Vec4> m_bounds;
+    std::vector<IndirectDrawArgs> m_args;
+    std::vector<Group> m_groups;
+};
+
+#endif // GPU_CULL_H
@@ -0,0 +1,159 @@
+// gpu_timer.h - Timestamp query bookkeeping shared by the renderer backends
+#ifndef GPU_TIMER_H
+#define GPU_TIMER_H
+
+#include "renderer.h"
+#include <cstdint>
+
+// ==================== GPU Timer Ring ====================
+// Assigns timestamp query indices for beginFrame/endFrame and each GPU
+// zone, and turns the raw ticks back into a GpuFrameTiming once a frame's
+// queries have resolved. The backend owns QUERY_COUNT query objects (or a
+// query heap of that size), issues a timestamp into whichever index a call
+// returns, and polls oldestPending() at the start of each frame:
+//
+//   int slot;
+//   while ((slot = ring.oldestPending()) >= 0 && <slot's queries are done>)
+//       ring.resolve(slot, readTicks, ticksPerSecond);
+//
+// Each frame uses one slot of STAMPS_PER_FRAME consecutive queries: stamp 0
+// at frame start, stamp 1 at frame end, then a begin/end pair per zone.
+// A slot still pending when its turn comes round again (the GPU is more
+// than FRAMES frames behind) is overwritten and that frame goes untimed.
+class GpuTimerRing {
+public:
+    static constexpr uint32_t FRAMES = 4;
+    static constexpr uint32_t STAMPS_PER_FRAME = 2 + 2 * MAX_GPU_ZONES;
+    static constexpr uint32_t QUERY_COUNT = FRAMES * STAMPS_PER_FRAME;
+    static constexpr uint32_t NO_QUERY = ~0u;          // Nothing to issue
+    static constexpr uint32_t MAX_DEPTH = 8;
+
+    static uint32_t query(uint32_t slot, uint32_t stamp) { return slot * STAMPS_PER_FRAME + stamp; }
+
+    // Query for the frame-start timestamp
+    uint32_t beginFrame() {
+        m_frame++;
+        m_slot = (uint32_t)(m_frame % FRAMES);
+        Slot& s = m_slots[m_slot];
+        s.frame = m_frame;
+        s.pending = false;
+        s.zoneCount = 0;
+        s.stampCount = 2;
+        m_depth = 0;
+        m_open = true;
+        return query(m_slot, 0);
+    }
+
+    uint32_t beginZone(const char* name) {
+        if (!m_open) return NO_QUERY;
+        uint32_t depth = m_depth++;
+        if (depth >= MAX_DEPTH) return NO_QUERY;
+        Slot& s = m_slots[m_slot];
+        if (s.zoneCount >= MAX_GPU_ZONES) {
+            m_stack[depth] = NO_ZONE;
+            return NO_QUERY;
+        }
+        Zone& zone = s.zones[s.zoneCount];
+        zone.name = name;
+        zone.beginStamp = s.stampCount++;
+        zone.endStamp = 1;   // Frame end, unless endZone() comes first
+        zone.depth = depth;
+        m_stack[depth] = s.zoneCount++;
+        return query(m_slot, zone.beginStamp);
+    }
+
+    uint32_t endZone() {
+        if (!m_open || m_depth == 0) return NO_QUERY;
+        uint32_t depth = --m_depth;
+        if (depth >= MAX_DEPTH || m_stack[depth] == NO_ZONE) return NO_QUERY;
+        Slot& s = m_slots[m_slot];
+        Zone& zone = s.zones[m_stack[depth]];
+        zone.endStamp = s.stampCount++;
+        return query(m_slot, zone.endStamp);
+    }
+
+    // Query for the frame-end timestamp; zones left open end with it
+    uint32_t endFrame() {
+        if (!m_open) return NO_QUERY;
+        m_open = false;
+        m_slots[m_slot].pending = true;
+        return query(m_slot, 1);
+    }
+
+    // Slot recorded this frame, and how many of its queries were used
+    uint32_t currentSlot() const { return m_slot; }
+    uint32_t stampCount(uint32_t slot) const { return m_slots[slot].stampCount; }
+
+    // Pending slot with the oldest frame, or -1
+    int oldestPending() const {
+        int oldest = -1;
+        for (uint32_t i = 0; i < FRAMES; i++) {
+            if (!m_slots[i].pending) continue;
+            if (oldest < 0 || m_slots[i].frame < m_slots[oldest].frame) oldest = (int)i;
+        }
+        return oldest;
+    }
+
+    // read(queryIndex) returns that query's raw tick value
+    template <typename ReadTicks>
+    void resolve(uint32_t slot, ReadTicks read, double ticksPerSecond) {
+        Slot& s = m_slots[slot];
+        s.pending = false;
+        if (ticksPerSecond <= 0.0) return;
+        const double msPerTick = 1000.0 / ticksPerSecond;
+
+        uint64_t start = read(query(slot, 0));
+        uint64_t end = read(query(slot, 1));
+        m_latest.frame = s.frame;
+        m_latest.frameMs = ticksToMs(start, end, msPerTick);
+        m_latest.zoneCount = s.zoneCount;
+        for (uint32_t i = 0; i < s.zoneCount; i++) {
+            const Zone& zone = s.zones[i];
+            uint64_t zoneBegin = read(query(slot, zone.beginStamp));
+            uint64_t zoneEnd = read(query(slot, zone.endStamp));
+            GpuZoneTiming& timing = m_latest.zones[i];
+            timing.name = zone.name;
+            timing.startMs = ticksToMs(start, zoneBegin, msPerTick);
+            timing.durationMs = ticksToMs(zoneBegin, zoneEnd, msPerTick);
+            timing.depth = zone.depth;
+        }
+    }
+
+    // Drop a pending frame whose results are unusable (e.g. D3D11 disjoint)
+    void discard(uint32_t slot) { m_slots[slot].pending = false; }
+
+    const GpuFrameTiming& getLatest() const { return m_latest; }
+
+private:
+    static constexpr uint32_t NO_ZONE = ~0u;
+
+    struct Zone {
+        const char* name;
+        uint32_t beginStamp;
+        uint32_t endStamp;
+        uint32_t depth;
+    };
+
+    struct Slot {
+        uint64_t frame = 0;
+        bool pending = false;
+        uint32_t zoneCount = 0;
+        uint32_t stampCount = 0;
+        Zone zones[MAX_GPU_ZONES];
+    };
+
+    // Counters can run backwards across a disjoint event; clamp to zero
+    static double ticksToMs(uint64_t from, uint64_t to, double msPerTick) {
+        return to > from ? (double)(to - from) * msPerTick : 0.0;
+    }
+
+    Slot m_slots[FRAMES];
+    uint64_t m_frame = 0;
+    uint32_t m_slot = 0;
+    uint32_t m_depth = 0;
+    uint32_t m_stack[MAX_DEPTH] = {};
+    bool m_open = false;
+    GpuFrameTiming m_latest;
+};
+
+#endif // GPU_TIMER_H
@@ -0,0 +1,172 @@
+// job_system.h - Work-stealing thread pool for per-frame parallel loops
+#ifndef JOB_SYSTEM_H
+#define JOB_SYSTEM_H
+
+#include <cstdint>
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <algorithm>
+
+// ==================== Job System ====================
+// Each worker owns a deque: it pops its own newest job and, when that runs
+// dry, steals the oldest job from another worker. parallelFor() spreads
+// chunks round-robin over the deques and the calling thread steals too
+// until its batch is done, so a frame never just sleeps on the pool.
+// Unlike AssetLoader this is meant for short, frame-bound work.
+class JobSystem {
+public:
+    using RangeFunc = std::function<void(uint32_t begin, uint32_t end)>;
+
+    // 0 = one worker per hardware thread, leaving one for the caller
+    explicit JobSystem(unsigned workerCount = 0)
+        : m_stop(false)
+        , m_queued(0)
+        , m_nextQueue(0)
+    {
+        if (workerCount == 0) {
+            unsigned hw = std::thread::hardware_concurrency();
+            workerCount = hw > 1 ? hw - 1 : 1;
+        }
+        m_queues.reserve(workerCount);
+        for (unsigned i = 0; i < workerCount; i++) {
+            m_queues.emplace_back(new Queue());
+        }
+        for (unsigned i = 0; i < workerCount; i++) {
+            m_workers.emplace_back(&JobSystem::workerLoop, this, i);
+        }
+    }
+
+    ~JobSystem() {
+        {
+            std::lock_guard<std::mutex> lock(m_sleepMutex);
+            m_stop = true;
+        }
+        m_sleepCv.notify_all();
+        for (std::thread& t : m_workers) t.join();
+    }
+
+    JobSystem(const JobSystem&) = delete;
+    JobSystem& operator=(const JobSystem&) = delete;
+
+    // Call func(begin, end) over [0, count) in chunks of at most 'grain'
+    // items; returns once every chunk has run. func must be safe to call
+    // concurrently on disjoint ranges. Several threads may call it at once,
+    // but it is not reentrant from inside a job.
+    void parallelFor(uint32_t count, uint32_t grain, const RangeFunc& func) {
+        if (count == 0) return;
+        grain = (std::max)(1u, grain);
+        if (count <= grain || m_workers.empty()) {
+            func(0, count);
+            return;
+        }
+
+        std::atomic<uint32_t> pending(0);
+        uint32_t chunks = (count + grain - 1) / grain;
+        pending.store(chunks, std::memory_order_relaxed);
+
+        // Count first (under the sleep lock, so no wakeup is lost) so that
+        // pops never take m_queued below zero
+        {
+            std::lock_guard<std::mutex> lock(m_sleepMutex);
+            m_queued.fetch_add(chunks, std::memory_order_release);
+        }
+        for (uint32_t c = 0; c < chunks; c++) {
+            uint32_t begin = c * grain;
+            uint32_t end = (std::min)(count, begin + grain);
+            Queue& q = *m_queues[m_nextQueue.fetch_add(1, std::memory_order_relaxed) % m_queues.size()];
+            std::lock_guard<std::mutex> lock(q.mutex);
+            q.jobs.push_back({ &func, begin, end, &pending });
+        }
+        m_sleepCv.notify_all();
+
+        // Help until our batch is done; pending reaches 0 only after the
+        // last chunk returned, so 'func' and 'pending' outlive every job
+        Job job;
+        while (pending.load(std::memory_order_acquire) != 0) {
+            if (steal((size_t)-1, job)) {
+                execute(job);
+            } else {
+                std::this_thread::yield();
+            }
+        }
+    }
+
+    unsigned getWorkerCount() const { return (unsigned)m_workers.size(); }
+
+private:
+    struct Job {
+        const RangeFunc* func;
+        uint32_t begin;
+        uint32_t end;
+        std::atomic<uint32_t>* pending;
+    };
+
+    struct Queue {
+        std::mutex mutex;
+        std::deque<Job> jobs;
+    };
+
+    static void execute(const Job& job) {
+        (*job.func)(job.begin, job.end);
+        job.pending->fetch_sub(1, std::memory_order_acq_rel);
+    }
+
+    // Own queue from the back, others from the front
+    bool popOwn(size_t index, Job& out) {
+        Queue& q = *m_queues[index];
+        std::lock_guard<std::mutex> lock(q.mutex);
+        if (q.jobs.empty()) return false;
+        out = q.jobs.back();
+        q.jobs.pop_back();
+        m_queued.fetch_sub(1, std::memory_order_relaxed);
+        return true;
+    }
+
+    bool steal(size_t self, Job& out) {
+        size_t n = m_queues.size();
+        size_t start = (self == (size_t)-1) ? 0 : self + 1;
+        for (size_t k = 0; k < n; k++) {
+            size_t index = (start + k) % n;
+            if (index == self) continue;
+            Queue& q = *m_queues[index];
+            std::lock_guard<std::mutex> lock(q.mutex);
+            if (q.jobs.empty()) continue;
+            out = q.jobs.front();
+            q.jobs.pop_front();
+            m_queued.fetch_sub(1, std::memory_order_relaxed);
+            return true;
+        }
+        return false;
+    }
+
+    void workerLoop(size_t index) {
+        Job job;
+        for (;;) {
+            if (popOwn(index, job) || steal(index, job)) {
+                execute(job);
+                continue;
+            }
+            std::unique_lock<std::mutex> lock(m_sleepMutex);
+            m_sleepCv.wait(lock, [this] {
+                return m_stop || m_queued.load(std::memory_order_acquire) > 0;
+            });
+            if (m_stop) return;
+        }
+    }
+
+    std::vector<std::unique_ptr<Queue>> m_queues;   // One per worker
+    std::vector<std::thread> m_workers;
+    std::mutex m_sleepMutex;
+    std::condition_variable m_sleepCv;
+    bool m_stop;
+    std::atomic<uint32_t> m_queued;   // Jobs sitting in any queue
+    std::atomic<uint32_t> m_nextQueue; // Round-robin; shared by concurrent callers
+};
+
+#endif // JOB_SYSTEM_H
@@ -1,13 +1,39 @@
 // main_v3.cpp - Entry point with ECS system
 #include "app_v3.h"
 #include "debug.h"
+#include "mesh_cache.h"
+#include "shader_cache.h"
 #include <cstdio>
+#include <cstdlib>
 
 int main(int argc, char** argv) {
     // Parse command line arguments
     RendererAPI api = RendererAPI::OpenGL;  // Default
     const char* sceneFile = "scene_flight_v2.json";  // Default scene
     std::string sceneFilePath;  // For constructing path with .json
+    uint32_t textureBudgetMB = 0;  // 0 = unlimited
+    bool streamTextures = false;
+    bool packTextures = false;
+    bool packedVertices = false;
+    bool useMeshCache = true;
+    int updateThreads = -1;  // One per core
+    bool pipelined = false;
+    bool gpuCulling = false;
+    bool hotReload = false;
+    bool lowLatency = false;
+    bool allowTearing = false;
+    double fpsLimit = 0.0;  // Unlimited
+    int logLevel = -1;  // Logging off
+    bool headless = false;
+    float timeScale = 0.0f;  // As fast as possible
+    float duration = 60.0f;
+    const char* traceFile = nullptr;
+    const char* recordFile = nullptr;
+    const char* replayFile = nullptr;
+    float traceInterval = 0.0f;  // Every step
+    bool showProfiler = false;
+    const char* profileTrace = nullptr;
+    uint32_t profileFrames = 300;
     
     for (int i = 1; i < argc; i++) {
         if (strcmp(argv[i], "--d3d11") == 0) {
@@ -29,6 +55,64 @@ int main(int argc, char** argv) {
                 sceneFilePath = sceneStr + ".json";
             }
             sceneFile = sceneFilePath.c_str();
+        } else if (strcmp(argv[i], "--texture-budget") == 0 && i + 1 < argc) {
+            textureBudgetMB = (uint32_t)atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--stream-textures") == 0) {
+            streamTextures = true;
+        } else if (strcmp(argv[i], "--pack-textures") == 0) {
+            packTextures = true;
+        } else if (strcmp(argv[i], "--packed-vertices") == 0) {
+            packedVertices = true;
+        } else if (strcmp(argv[i], "--update-threads") == 0 && i + 1 < argc) {
+            updateThreads = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--pipelined") == 0) {
+            pipelined = true;
+        } else if (strcmp(argv[i], "--gpu-culling") == 0) {
+            gpuCulling = true;
+        } else if (strcmp(argv[i], "--hot-reload") == 0) {
+            hotReload = true;
+        } else if (strcmp(argv[i], "--low-latency") == 0) {
+            lowLatency = true;
+        } else if (strcmp(argv[i], "--allow-tearing") == 0) {
+            allowTearing = true;
+        } else if (strcmp(argv[i], "--fps-limit") == 0 && i + 1 < argc) {
+            fpsLimit = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--log") == 0 && i + 1 < argc) {
+            const char* levels[] = { "error", "warning", "info", "debug", "trace" };
+            const char* name = argv[++i];
+            for (int level = 0; level < 5; level++) {
+                if (strcmp(name, levels[level]) == 0) logLevel = level;
+            }
+            if (logLevel < 0) printf("Unknown log level '%s', logging stays off\n", name);
+        } else if (strcmp(argv[i], "--headless") == 0) {
+            headless = true;
+        } else if (strcmp(argv[i], "--time-scale") == 0 && i + 1 < argc) {
+            timeScale = (float)atof(argv[++i]);
+        } else if (strcmp(argv[i], "--duration") == 0 && i + 1 < argc) {
+            duration = (float)atof(argv[++i]);
+        } else if (strcmp(argv[i], "--trace") == 0 && i + 1 < argc) {
+            traceFile = argv[++i];
+        } else if (strcmp(argv[i], "--trace-interval") == 0 && i + 1 < argc) {
+            traceInterval = (float)atof(argv[++i]);
+        } else if (strcmp(argv[i], "--record") == 0 && i + 1 < argc) {
+            recordFile = argv[++i];
+        } else if (strcmp(argv[i], "--replay") == 0 && i + 1 < argc) {
+            replayFile = argv[++i];
+        } else if (strcmp(argv[i], "--profile") == 0) {
+            showProfiler = true;
+        } else if (strcmp(argv[i], "--profile-trace") == 0 && i + 1 < argc) {
+            profileTrace = argv[++i];
+        } else if (strcmp(argv[i], "--profile-frames") == 0 && i + 1 < argc) {
+            profileFrames = (uint32_t)atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--no-mesh-cache") == 0) {
+            useMeshCache = false;
+        } else if (strcmp(argv[i], "--no-shader-cache") == 0) {
+            ShaderCache::setEnabled(false);
+        } else if (strcmp(argv[i], "--shader-cache") == 0 && i + 1 < argc) {
+            ShaderCache::setDirectory(argv[++i]);
+        } else if (strcmp(argv[i], "--bake-model") == 0 && i + 1 < argc) {
+            // Offline bake: write <model>.cubemesh and exit
+            return MeshCache::bakeFile(argv[++i]) ? 0 : 1;
         } else if (strcmp(argv[i], "--help") == 0) {
             printf("Usage: %s [options]\n", argv[0]);
             printf("Options:\n");
@@ -38,6 +122,32 @@ int main(int argc, char** argv) {
             printf("  --scene <name>     Load scene file (.json extension optional)\n");
             printf("                     Examples: --scene scene_flight_v2\n");
             printf("                               --scene scene_orbit_v2.json\n");
+            printf("  --texture-budget <MB>  Texture memory budget (LRU eviction, default unlimited)\n");
+            printf("  --stream-textures  Load textures mip-tail first, full res in background\n");
+            printf("  --pack-textures    Pack each model's same-size textures into texture arrays\n");
+            printf("  --packed-vertices  Upload models in the compact 32-byte vertex format\n");
+            printf("  --update-threads <n>  Worker threads for behavior updates (0 = serial)\n");
+            printf("  --pipelined        Draw frame N on a render thread while frame N+1 simulates\n");
+            printf("  --gpu-culling      Frustum-cull instances in a compute pass (GL 4.3 / D3D12)\n");
+            printf("  --hot-reload       Apply scene and asset file changes while running\n");
+            printf("  --low-latency      Queue one frame for display and poll input just before drawing\n");
+            printf("  --allow-tearing    Present without vsync, tearing allowed (variable refresh)\n");
+            printf("  --fps-limit <n>    Cap the frame rate with a CPU limiter (default unlimited)\n");
+            printf("  --log <level>      Log error|warning|info|debug|trace to stdout and debug_log.txt\n");
+            printf("  --headless         Simulate without a window or GPU, then exit\n");
+            printf("  --duration <s>     Simulated seconds for --headless (default 60)\n");
+            printf("  --time-scale <x>   Headless pace vs real time (default 0 = as fast as possible)\n");
+            printf("  --trace <file>     Write entity state per step (.csv = CSV, else binary)\n");
+            printf("  --trace-interval <s>  Simulated seconds between trace samples (default every step)\n");
+            printf("  --record <file>    Record every aircraft's state and controls per physics step\n");
+            printf("  --replay <file>    Fly a --record file's controls again (same scene) and check it matches\n");
+            printf("  --profile          Show the CPU/GPU profiler overlay\n");
+            printf("  --profile-trace <file>  Write a Chrome trace (chrome://tracing, Perfetto)\n");
+            printf("  --profile-frames <n>  Frames to capture for --profile-trace (default 300)\n");
+            printf("  --no-mesh-cache    Always import models with Assimp, skip .cubemesh files\n");
+            printf("  --bake-model <file>  Write <file>.cubemesh and exit\n");
+            printf("  --no-shader-cache  Compile D3D shaders and pipelines every start\n");
+            printf("  --shader-cache <dir>  Shader/pipeline cache directory (default shader_cache)\n");
             printf("  --help             Show this help\n");
             printf("\n");
             printf("Controls:\n");
@@ -48,6 +158,7 @@ int main(int argc, char** argv) {
             printf("  I                  Toggle OSD detail mode\n");
             printf("  G                  Toggle ground\n");
             printf("  N                  Toggle normal mapping\n");
+            printf("  P                  Toggle profiler overlay\n");
             printf("  ESC                Exit\n");
             return 0;
         }
@@ -57,17 +168,41 @@ int main(int argc, char** argv) {
     printf("  Flight Simulator - Entity System Demo\n");
     printf("===========================================\n");
     printf("Renderer: %s\n", 
+           headless ? "none (headless)" :
            api == RendererAPI::OpenGL ? "OpenGL" :
            api == RendererAPI::Direct3D11 ? "Direct3D 11" :
            "Direct3D 12");
     printf("Scene: %s\n", sceneFile);
     printf("===========================================\n\n");
     
+    if (logLevel >= 0) DebugManager::initialize(true, (LogLevel)logLevel);
+    
     // Create and initialize application
     CubeApp app;
+    app.setTextureBudgetMB(textureBudgetMB);
+    app.setTextureStreaming(streamTextures);
+    app.setTexturePacking(packTextures);
+    app.setPackedVertices(packedVertices);
+    app.setMeshCache(useMeshCache);
+    app.setUpdateThreads(updateThreads);
+    app.setPipelined(pipelined);
+    app.setHotReload(hotReload);
+    app.setLowLatency(lowLatency);
+    app.setAllowTearing(allowTearing);
+    app.setFpsLimit(fpsLimit);
+    app.setGpuCulling(gpuCulling);
+    app.setHeadless(headless);
+    app.setTimeScale(timeScale);
+    app.setSimDuration(duration);
+    if (traceFile) app.setTraceFile(traceFile, traceInterval);
+    if (recordFile) app.setFlightRecording(recordFile);
+    if (replayFile) app.setFlightReplay(replayFile);
+    app.setShowProfiler(showProfiler);
+    if (profileTrace) app.setProfileCapture(profileTrace, profileFrames);
     
     if (!app.initialize(api, sceneFile)) {
         LOG_ERROR("Failed to initialize application");
+        DebugManager::shutdown();
         return 1;
     }
     
@@ -76,6 +211,7 @@ int main(int argc, char** argv) {
     
     // Cleanup
     app.shutdown();
+    DebugManager::shutdown();
     
     printf("\nGoodbye!\n");
     return 0;
@@ -0,0 +1,137 @@
+// math_simd.h - Four-wide float vectors backing the math_utils.h functions
+#ifndef MATH_SIMD_H
+#define MATH_SIMD_H
+
+#include <cmath>
+#include <cstdint>
+
+// One instruction set is picked at compile time, the widest the target
+// allows; define CUBE_MATH_NO_SIMD to force the scalar path (e.g. to check
+// results against it). AVX only widens the batched functions; single
+// matrix operations are already one SSE register per column.
+#if !defined(CUBE_MATH_NO_SIMD) && \
+    (defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+#define CUBE_MATH_SSE
+#include <emmintrin.h>
+#if defined(__AVX__)
+#define CUBE_MATH_AVX
+#include <immintrin.h>
+#endif
+#elif !defined(CUBE_MATH_NO_SIMD) && (defined(__aarch64__) || defined(_M_ARM64))
+#define CUBE_MATH_NEON
+#include <arm_neon.h>
+#else
+#define CUBE_MATH_SCALAR
+#endif
+
+// ==================== Float4 ====================
+// x, y, z, w in one register. Loads and stores marked 'a' need 16-byte
+// aligned addresses (Vec4, and Mat4 columns); the others take any address.
+
+#if defined(CUBE_MATH_SSE)
+
+typedef __m128 Float4;
+inline Float4 f4_load(const float* p) { return _mm_load_ps(p); }
+inline Float4 f4_loadu(const float* p) { return _mm_loadu_ps(p); }
+inline void f4_store(float* p, Float4 v) { _mm_store_ps(p, v); }
+inline void f4_storeu(float* p, Float4 v) { _mm_storeu_ps(p, v); }
+inline Float4 f4_set(float x, float y, float z, float w) { return _mm_setr_ps(x, y, z, w); }
+inline Float4 f4_splat(float s) { return _mm_set1_ps(s); }
+inline Float4 f4_add(Float4 a, Float4 b) { return _mm_add_ps(a, b); }
+inline Float4 f4_sub(Float4 a, Float4 b) { return _mm_sub_ps(a, b); }
+inline Float4 f4_mul(Float4 a, Float4 b) { return _mm_mul_ps(a, b); }
+inline Float4 f4_madd(Float4 a, Float4 b, Float4 c) { return _mm_add_ps(_mm_mul_ps(a, b), c); }   // a*b + c
+inline Float4 f4_div(Float4 a, Float4 b) { return _mm_div_ps(a, b); }
+inline Float4 f4_sqrt(Float4 a) { return _mm_sqrt_ps(a); }
+inline Float4 f4_max(Float4 a, Float4 b) { return _mm_max_ps(a, b); }
+inline Float4 f4_neg(Float4 a) { return _mm_xor_ps(a, _mm_set1_ps(-0.0f)); }
+template <int Lane> inline Float4 f4_broadcast(Float4 v) { return _mm_shuffle_ps(v, v, _MM_SHUFFLE(Lane, Lane, Lane, Lane)); }
+inline float f4_x(Float4 v) { return _mm_cvtss_f32(v); }
+// Bit i set when lane i of a < b
+inline int f4_lessMask(Float4 a, Float4 b) { return _mm_movemask_ps(_mm_cmplt_ps(a, b)); }
+inline void f4_transpose(Float4& r0, Float4& r1, Float4& r2, Float4& r3) { _MM_TRANSPOSE4_PS(r0, r1, r2, r3); }
+
+#elif defined(CUBE_MATH_NEON)
+
+typedef float32x4_t Float4;
+inline Float4 f4_load(const float* p) { return vld1q_f32(p); }
+inline Float4 f4_loadu(const float* p) { return vld1q_f32(p); }
+inline void f4_store(float* p, Float4 v) { vst1q_f32(p, v); }
+inline void f4_storeu(float* p, Float4 v) { vst1q_f32(p, v); }
+inline Float4 f4_set(float x, float y, float z, float w) { float v[4] = { x, y, z, w }; return vld1q_f32(v); }
+inline Float4 f4_splat(float s) { return vdupq_n_f32(s); }
+inline Float4 f4_add(Float4 a, Float4 b) { return vaddq_f32(a, b); }
+inline Float4 f4_sub(Float4 a, Float4 b) { return vsubq_f32(a, b); }
+inline Float4 f4_mul(Float4 a, Float4 b) { return vmulq_f32(a, b); }
+// Separate multiply and add, like the other paths (vfmaq would round once)
+inline Float4 f4_madd(Float4 a, Float4 b, Float4 c) { return vaddq_f32(vmulq_f32(a, b), c); }
+inline Float4 f4_div(Float4 a, Float4 b) { return vdivq_f32(a, b); }
+inline Float4 f4_sqrt(Float4 a) { return vsqrtq_f32(a); }
+inline Float4 f4_max(Float4 a, Float4 b) { return vmaxq_f32(a, b); }
+inline Float4 f4_neg(Float4 a) { return vnegq_f32(a); }
+template <int Lane> inline Float4 f4_broadcast(Float4 v) { return vdupq_laneq_f32(v, Lane); }
+inline float f4_x(Float4 v) { return vgetq_lane_f32(v, 0); }
+inline int f4_lessMask(Float4 a, Float4 b) {
+    static const uint32_t bits[4] = { 1, 2, 4, 8 };
+    return (int)vaddvq_u32(vandq_u32(vcltq_f32(a, b), vld1q_u32(bits)));
+}
+inline void f4_transpose(Float4& r0, Float4& r1, Float4& r2, Float4& r3) {
+    float32x4_t t0 = vzip1q_f32(r0, r2), t1 = vzip2q_f32(r0, r2);
+    float32x4_t t2 = vzip1q_f32(r1, r3), t3 = vzip2q_f32(r1, r3);
+    r0 = vzip1q_f32(t0, t2);
+    r1 = vzip2q_f32(t0, t2);
+    r2 = vzip1q_f32(t1, t3);
+    r3 = vzip2q_f32(t1, t3);
+}
+
+#else
+
+struct Float4 { float v[4]; };
+inline Float4 f4_load(const float* p) { return { { p[0], p[1], p[2], p[3] } }; }
+inline Float4 f4_loadu(const float* p) { return f4_load(p); }
+inline void f4_store(float* p, Float4 a) { p[0] = a.v[0]; p[1] = a.v[1]; p[2] = a.v[2]; p[3] = a.v[3]; }
+inline void f4_storeu(float* p, Float4 a) { f4_store(p, a); }
+inline Float4 f4_set(float x, float y, float z, float w) { return { { x, y, z, w } }; }
+inline Float4 f4_splat(float s) { return { { s, s, s, s } }; }
+inline Float4 f4_add(Float4 a, Float4 b) { return { { a.v[0] + b.v[0], a.v[1] + b.v[1], a.v[2] + b.v[2], a.v[3] + b.v[3] } }; }
+inline Float4 f4_sub(Float4 a, Float4 b) { return { { a.v[0] - b.v[0], a.v[1] - b.v[1], a.v[2] - b.v[2], a.v[3] - b.v[3] } }; }
+inline Float4 f4_mul(Float4 a, Float4 b) { return { { a.v[0] * b.v[0], a.v[1] * b.v[1], a.v[2] * b.v[2], a.v[3] * b.v[3] } }; }
+inline Float4 f4_madd(Float4 a, Float4 b, Float4 c) { return f4_add(f4_mul(a, b), c); }
+inline Float4 f4_div(Float4 a, Float4 b) { return { { a.v[0] / b.v[0], a.v[1] / b.v[1], a.v[2] / b.v[2], a.v[3] / b.v[3] } }; }
+inline Float4 f4_sqrt(Float4 a) {
+    return { { std::sqrt(a.v[0]), std::sqrt(a.v[1]), std::sqrt(a.v[2]), std::sqrt(a.v[3]) } };
+}
+inline Float4 f4_max(Float4 a, Float4 b) {
+    return { { a.v[0] > b.v[0] ? a.v[0] : b.v[0], a.v[1] > b.v[1] ? a.v[1] : b.v[1],
+               a.v[2] > b.v[2] ? a.v[2] : b.v[2], a.v[3] > b.v[3] ? a.v[3] : b.v[3] } };
+}
+inline Float4 f4_neg(Float4 a) { return { { -a.v[0], -a.v[1], -a.v[2], -a.v[3] } }; }
+template <int Lane> inline Float4 f4_broadcast(Float4 a) { return f4_splat(a.v[Lane]); }
+inline float f4_x(Float4 a) { return a.v[0]; }
+inline int f4_lessMask(Float4 a, Float4 b) {
+    return (a.v[0] < b.v[0] ? 1 : 0) | (a.v[1] < b.v[1] ? 2 : 0) | (a.v[2] < b.v[2] ? 4 : 0) | (a.v[3] < b.v[3] ? 8 : 0);
+}
+inline void f4_transpose(Float4& r0, Float4& r1, Float4& r2, Float4& r3) {
+    Float4 t0 = r0, t1 = r1, t2 = r2, t3 = r3;
+    r0 = { { t0.v[0], t1.v[0], t2.v[0], t3.v[0] } };
+    r1 = { { t0.v[1], t1.v[1], t2.v[1], t3.v[1] } };
+    r2 = { { t0.v[2], t1.v[2], t2.v[2], t3.v[2] } };
+    r3 = { { t0.v[3], t1.v[3], t2.v[3], t3.v[3] } };
+}
+
+#endif
+
+// Instruction set the math functions were built for
+inline const char* mathSimdName() {
+#if defined(CUBE_MATH_AVX)
+    return "AVX";
+#elif defined(CUBE_MATH_SSE)
+    return "SSE2";
+#elif defined(CUBE_MATH_NEON)
+    return "NEON";
+#else
+    return "scalar";
+#endif
+}
+
+#endif // MATH_SIMD_H
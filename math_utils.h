@@ -3,7 +3,10 @@
 #define MATH_UTILS_H
 
 #include <cmath>
+#include <cstdint>
+#include <cstring>
 #include <algorithm>
+#include "math_simd.h"
 
 // ==================== Vector Types ====================
 
@@ -11,13 +14,15 @@ struct Vec3 {
     float x, y, z;
 };
 
-struct Vec4 {
+// Aligned so it loads as one Float4
+struct alignas(16) Vec4 {
     float x, y, z, w;
 };
 
 // ==================== Matrix Type ====================
 
-struct Mat4 {
+// Each column is an aligned Float4 (m + 4 * column)
+struct alignas(16) Mat4 {
     float m[16]; // column-major
 };
 
@@ -51,6 +56,23 @@ inline float v3_length(Vec3 v) {
     return std::sqrt(v3_dot(v, v));
 }
 
+inline Vec3 v3_lerp(Vec3 a, Vec3 b, float t) {
+    return { a.x + (b.x - a.x) * t, a.y + (b.y - a.y) * t, a.z + (b.z - a.z) * t };
+}
+
+// Interpolate angles in radians along the shorter way around
+inline float angle_lerp(float a, float b, float t) {
+    const float PI = 3.14159265359f;
+    float d = std::fmod(b - a, 2.0f * PI);
+    if (d > PI) d -= 2.0f * PI;
+    if (d < -PI) d += 2.0f * PI;
+    return a + d * t;
+}
+
+inline Vec3 v3_angleLerp(Vec3 a, Vec3 b, float t) {
+    return { angle_lerp(a.x, b.x, t), angle_lerp(a.y, b.y, t), angle_lerp(a.z, b.z, t) };
+}
+
 inline Vec3 v3_norm(Vec3 v) {
     float len = std::sqrt((std::max)(1e-20f, v3_dot(v, v)));
     return { v.x / len, v.y / len, v.z / len };
@@ -64,19 +86,76 @@ inline Mat4 mat4_identity() {
     return r;
 }
 
+// Column c of a*b is a's columns weighted by b's column c. Sums run in the
+// same order on every instruction set, so all paths give identical results.
+inline Float4 mat4_mulColumn(Float4 a0, Float4 a1, Float4 a2, Float4 a3, Float4 bc) {
+    Float4 r = f4_mul(a0, f4_broadcast<0>(bc));
+    r = f4_madd(a1, f4_broadcast<1>(bc), r);
+    r = f4_madd(a2, f4_broadcast<2>(bc), r);
+    return f4_madd(a3, f4_broadcast<3>(bc), r);
+}
+
 inline Mat4 mat4_mul(const Mat4& a, const Mat4& b) {
-    Mat4 r{};
-    for (int c = 0; c < 4; ++c)
-    for (int row = 0; row < 4; ++row) {
-        r.m[c * 4 + row] =
-            a.m[0 * 4 + row] * b.m[c * 4 + 0] +
-            a.m[1 * 4 + row] * b.m[c * 4 + 1] +
-            a.m[2 * 4 + row] * b.m[c * 4 + 2] +
-            a.m[3 * 4 + row] * b.m[c * 4 + 3];
+    Float4 a0 = f4_load(a.m), a1 = f4_load(a.m + 4), a2 = f4_load(a.m + 8), a3 = f4_load(a.m + 12);
+    Mat4 r;
+    for (int c = 0; c < 4; ++c) {
+        f4_store(r.m + c * 4, mat4_mulColumn(a0, a1, a2, a3, f4_load(b.m + c * 4)));
     }
     return r;
 }
 
+// out[i] = a * b[i], e.g. view-projection times N world matrices. out may be b.
+inline void mat4_mulBatch(const Mat4& a, const Mat4* b, Mat4* out, uint32_t count) {
+#if defined(CUBE_MATH_AVX)
+    // Two columns per register: a's columns repeated in both halves
+    __m256 a0 = _mm256_broadcast_ps((const __m128*)a.m);
+    __m256 a1 = _mm256_broadcast_ps((const __m128*)(a.m + 4));
+    __m256 a2 = _mm256_broadcast_ps((const __m128*)(a.m + 8));
+    __m256 a3 = _mm256_broadcast_ps((const __m128*)(a.m + 12));
+    for (uint32_t i = 0; i < count; i++) {
+        for (int half = 0; half < 16; half += 8) {
+            __m256 bc = _mm256_loadu_ps(b[i].m + half);   // Mat4 is only 16-byte aligned
+            __m256 r = _mm256_mul_ps(a0, _mm256_permute_ps(bc, 0x00));
+            r = _mm256_add_ps(_mm256_mul_ps(a1, _mm256_permute_ps(bc, 0x55)), r);
+            r = _mm256_add_ps(_mm256_mul_ps(a2, _mm256_permute_ps(bc, 0xAA)), r);
+            r = _mm256_add_ps(_mm256_mul_ps(a3, _mm256_permute_ps(bc, 0xFF)), r);
+            _mm256_storeu_ps(out[i].m + half, r);
+        }
+    }
+#else
+    Float4 a0 = f4_load(a.m), a1 = f4_load(a.m + 4), a2 = f4_load(a.m + 8), a3 = f4_load(a.m + 12);
+    for (uint32_t i = 0; i < count; i++) {
+        for (int c = 0; c < 4; ++c) {
+            f4_store(out[i].m + c * 4, mat4_mulColumn(a0, a1, a2, a3, f4_load(b[i].m + c * 4)));
+        }
+    }
+#endif
+}
+
+inline Vec4 mat4_mulVec4(const Mat4& a, Vec4 v) {
+    Vec4 r;
+    f4_store(&r.x, mat4_mulColumn(f4_load(a.m), f4_load(a.m + 4), f4_load(a.m + 8), f4_load(a.m + 12),
+                                  f4_load(&v.x)));
+    return r;
+}
+
+// Row-major copy of a column-major matrix (what HLSL cbuffers read by default)
+inline Mat4 mat4_transpose(const Mat4& a) {
+    Float4 c0 = f4_load(a.m), c1 = f4_load(a.m + 4), c2 = f4_load(a.m + 8), c3 = f4_load(a.m + 12);
+    f4_transpose(c0, c1, c2, c3);
+    Mat4 r;
+    f4_store(r.m, c0);
+    f4_store(r.m + 4, c1);
+    f4_store(r.m + 8, c2);
+    f4_store(r.m + 12, c3);
+    return r;
+}
+
+// out[i] = transpose(in[i]); out may be in
+inline void mat4_transposeBatch(const Mat4* in, Mat4* out, uint32_t count) {
+    for (uint32_t i = 0; i < count; i++) out[i] = mat4_transpose(in[i]);
+}
+
 inline Mat4 mat4_translate(float x, float y, float z) {
     Mat4 r = mat4_identity();
     r.m[12] = x;
@@ -145,4 +224,143 @@ inline Mat4 mat4_perspectiveRH_NO(float fovyRadians, float aspect, float zNear,
     return r;
 }
 
+// ==================== Frustum ====================
+
+enum class FrustumTest { Outside, Intersects, Inside };
+
+// Six planes (left, right, bottom, top, near, far) extracted from a
+// view-projection matrix with -1..1 clip depth, normals pointing inward.
+// testSphere() reads the SoA copy, four planes per Float4; the two padding
+// planes are always far in front of any sphere.
+struct Frustum {
+    Vec4 planes[6];
+    alignas(16) float planeX[8];
+    alignas(16) float planeY[8];
+    alignas(16) float planeZ[8];
+    alignas(16) float planeW[8];
+
+    static Frustum fromViewProj(const Mat4& vp) {
+        // Row i of the column-major matrix is m[i], m[4+i], m[8+i], m[12+i]
+        auto row = [&](int i) { return Vec4{ vp.m[i], vp.m[4 + i], vp.m[8 + i], vp.m[12 + i] }; };
+        Vec4 r0 = row(0), r1 = row(1), r2 = row(2), r3 = row(3);
+
+        Frustum f;
+        f.planes[0] = { r3.x + r0.x, r3.y + r0.y, r3.z + r0.z, r3.w + r0.w };
+        f.planes[1] = { r3.x - r0.x, r3.y - r0.y, r3.z - r0.z, r3.w - r0.w };
+        f.planes[2] = { r3.x + r1.x, r3.y + r1.y, r3.z + r1.z, r3.w + r1.w };
+        f.planes[3] = { r3.x - r1.x, r3.y - r1.y, r3.z - r1.z, r3.w - r1.w };
+        f.planes[4] = { r3.x + r2.x, r3.y + r2.y, r3.z + r2.z, r3.w + r2.w };
+        f.planes[5] = { r3.x - r2.x, r3.y - r2.y, r3.z - r2.z, r3.w - r2.w };
+        for (Vec4& p : f.planes) {
+            float len = std::sqrt(p.x * p.x + p.y * p.y + p.z * p.z);
+            if (len > 0.0f) { p.x /= len; p.y /= len; p.z /= len; p.w /= len; }
+        }
+        for (int i = 0; i < 8; i++) {
+            const Vec4 p = i < 6 ? f.planes[i] : Vec4{ 0.0f, 0.0f, 0.0f, 1e30f };
+            f.planeX[i] = p.x;
+            f.planeY[i] = p.y;
+            f.planeZ[i] = p.z;
+            f.planeW[i] = p.w;
+        }
+        return f;
+    }
+
+    FrustumTest testSphere(Vec3 center, float radius) const {
+        Float4 cx = f4_splat(center.x), cy = f4_splat(center.y), cz = f4_splat(center.z);
+        Float4 r = f4_splat(radius), negR = f4_splat(-radius);
+        int outside = 0, straddles = 0;
+        for (int i = 0; i < 8; i += 4) {
+            // x*cx + y*cy + z*cz + w, summed in that order
+            Float4 d = f4_mul(f4_load(planeX + i), cx);
+            d = f4_madd(f4_load(planeY + i), cy, d);
+            d = f4_madd(f4_load(planeZ + i), cz, d);
+            d = f4_add(d, f4_load(planeW + i));
+            outside |= f4_lessMask(d, negR);
+            straddles |= f4_lessMask(d, r);
+        }
+        if (outside) return FrustumTest::Outside;
+        return straddles ? FrustumTest::Intersects : FrustumTest::Inside;
+    }
+};
+
+// Transform a bounding sphere by an affine world matrix. The radius grows by
+// the largest axis scale, so the result stays conservative under non-uniform scale.
+inline void mat4_transformSphere(const Mat4& world, Vec3 center, float radius,
+                                 Vec3& outCenter, float& outRadius) {
+    Float4 c0 = f4_load(world.m), c1 = f4_load(world.m + 4), c2 = f4_load(world.m + 8);
+    Float4 p = f4_mul(c0, f4_splat(center.x));
+    p = f4_madd(c1, f4_splat(center.y), p);
+    p = f4_madd(c2, f4_splat(center.z), p);
+    p = f4_add(p, f4_load(world.m + 12));
+
+    // Squared column lengths: transposing puts each column's x, y and z
+    // terms in separate registers, so one add sums all three columns
+    Float4 q0 = f4_mul(c0, c0), q1 = f4_mul(c1, c1), q2 = f4_mul(c2, c2), q3 = f4_splat(0.0f);
+    f4_transpose(q0, q1, q2, q3);
+    alignas(16) float s[4];
+    f4_store(s, f4_add(f4_add(q0, q1), q2));
+
+    alignas(16) float c[4];
+    f4_store(c, p);
+    outCenter = { c[0], c[1], c[2] };
+    outRadius = radius * std::sqrt((std::max)(s[0], (std::max)(s[1], s[2])));
+}
+
+// ==================== Vertex Packing ====================
+
+// Octahedral encoding of a unit vector into two values in [-1, 1]
+inline void v3_octEncode(Vec3 n, float& outX, float& outY) {
+    float l1 = std::fabs(n.x) + std::fabs(n.y) + std::fabs(n.z);
+    if (l1 < 1e-20f) { outX = 0.0f; outY = 0.0f; return; }
+    float x = n.x / l1;
+    float y = n.y / l1;
+    if (n.z < 0.0f) {
+        // Fold the lower hemisphere over the diagonals
+        float fx = (1.0f - std::fabs(y)) * (x >= 0.0f ? 1.0f : -1.0f);
+        float fy = (1.0f - std::fabs(x)) * (y >= 0.0f ? 1.0f : -1.0f);
+        x = fx;
+        y = fy;
+    }
+    outX = x;
+    outY = y;
+}
+
+// [-1, 1] float -> signed normalized 16-bit
+inline int16_t packSnorm16(float v) {
+    v = (std::max)(-1.0f, (std::min)(1.0f, v));
+    return (int16_t)std::lround(v * 32767.0f);
+}
+
+// IEEE 754 single -> half, round to nearest even; overflows clamp to infinity
+inline uint16_t floatToHalf(float f) {
+    uint32_t x;
+    std::memcpy(&x, &f, sizeof(x));
+    uint32_t sign = (x >> 16) & 0x8000u;
+    uint32_t mant = x & 0x007FFFFFu;
+    int32_t exp = (int32_t)((x >> 23) & 0xFFu);
+
+    if (exp == 0xFF) {  // Inf / NaN
+        return (uint16_t)(sign | 0x7C00u | (mant ? 0x200u : 0u));
+    }
+    exp = exp - 127 + 15;
+    if (exp >= 0x1F) {
+        return (uint16_t)(sign | 0x7C00u);
+    }
+    if (exp <= 0) {
+        if (exp < -10) return (uint16_t)sign;  // Too small: signed zero
+        // Denormal half
+        mant |= 0x00800000u;
+        uint32_t shift = (uint32_t)(14 - exp);
+        uint32_t half = mant >> shift;
+        uint32_t rem = mant & ((1u << shift) - 1u);
+        uint32_t halfway = 1u << (shift - 1);
+        if (rem > halfway || (rem == halfway && (half & 1u))) half++;
+        return (uint16_t)(sign | half);
+    }
+    uint32_t half = ((uint32_t)exp << 10) | (mant >> 13);
+    uint32_t rem = mant & 0x1FFFu;
+    if (rem > 0x1000u || (rem == 0x1000u && (half & 1u))) half++;  // May carry into the exponent, which is correct
+    return (uint16_t)(sign | half);
+}
+
 #endif // MATH_UTILS_H
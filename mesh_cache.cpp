@@ -0,0 +1,279 @@
+// mesh_cache.cpp - .cubemesh baking and memory-mapped loading
+#include "mesh_cache.h"
+#include <cstdio>
+#include <cstring>
+#include <vector>
+#include <filesystem>
+#include <system_error>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace fs = std::filesystem;
+
+// ==================== Mapped File ====================
+
+#ifdef _WIN32
+bool MappedFile::open(const std::string& path) {
+    close();
+    HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+                              OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE) return false;
+
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(file, &size) || size.QuadPart == 0) {
+        CloseHandle(file);
+        return false;
+    }
+    HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (!mapping) {
+        CloseHandle(file);
+        return false;
+    }
+    void* view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    if (!view) {
+        CloseHandle(mapping);
+        CloseHandle(file);
+        return false;
+    }
+    m_file = file;
+    m_mapping = mapping;
+    m_data = (const uint8_t*)view;
+    m_size = (size_t)size.QuadPart;
+    return true;
+}
+
+void MappedFile::close() {
+    if (m_data) UnmapViewOfFile(m_data);
+    if (m_mapping) CloseHandle((HANDLE)m_mapping);
+    if (m_file) CloseHandle((HANDLE)m_file);
+    m_data = nullptr;
+    m_mapping = nullptr;
+    m_file = nullptr;
+    m_size = 0;
+}
+#else
+bool MappedFile::open(const std::string& path) {
+    close();
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) return false;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size == 0) {
+        ::close(fd);
+        return false;
+    }
+    void* view = mmap(nullptr, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (view == MAP_FAILED) {
+        ::close(fd);
+        return false;
+    }
+    m_fd = fd;
+    m_data = (const uint8_t*)view;
+    m_size = (size_t)st.st_size;
+    return true;
+}
+
+void MappedFile::close() {
+    if (m_data) munmap((void*)m_data, m_size);
+    if (m_fd >= 0) ::close(m_fd);
+    m_data = nullptr;
+    m_fd = -1;
+    m_size = 0;
+}
+#endif
+
+// ==================== Mesh Cache ====================
+
+static uint64_t AlignUp(uint64_t v, uint64_t a) { return (v + a - 1) & ~(a - 1); }
+
+static bool RangeInFile(uint64_t offset, uint64_t bytes, size_t fileSize) {
+    return offset <= fileSize && bytes <= fileSize - offset;
+}
+
+bool MeshCache::isFresh(const std::string& sourcePath) {
+    std::error_code ec;
+    fs::path cache = cachePath(sourcePath);
+    if (!fs::exists(cache, ec)) return false;
+    if (!fs::exists(sourcePath, ec)) return true;
+
+    auto cacheTime = fs::last_write_time(cache, ec);
+    if (ec) return false;
+    auto sourceTime = fs::last_write_time(sourcePath, ec);
+    if (ec) return false;
+    return cacheTime >= sourceTime;
+}
+
+bool MeshCache::load(const std::string& sourcePath, Model& outModel) {
+    if (!isFresh(sourcePath)) return false;
+
+    std::string path = cachePath(sourcePath);
+    auto file = std::make_shared<MappedFile>();
+    if (!file->open(path)) return false;
+
+    const uint8_t* base = file->data();
+    size_t fileSize = file->size();
+    if (fileSize < sizeof(CubeMeshHeader)) {
+        std::fprintf(stderr, "MeshCache: %s is truncated\n", path.c_str());
+        return false;
+    }
+
+    CubeMeshHeader header;
+    std::memcpy(&header, base, sizeof(header));
+    if (std::memcmp(header.magic, CUBEMESH_MAGIC, sizeof(header.magic)) != 0 ||
+        header.version != CUBEMESH_VERSION || header.vertexStride != sizeof(Vertex)) {
+        std::printf("MeshCache: %s has an old format, rebaking\n", path.c_str());
+        return false;
+    }
+
+    std::error_code ec;
+    uint64_t sourceSize = fs::file_size(sourcePath, ec);
+    if (!ec && sourceSize != header.sourceSize) return false;
+
+    if (!RangeInFile(sizeof(CubeMeshHeader), (uint64_t)header.meshCount * sizeof(CubeMeshRecord), fileSize)) {
+        std::fprintf(stderr, "MeshCache: %s is truncated\n", path.c_str());
+        return false;
+    }
+    const CubeMeshRecord* records = (const CubeMeshRecord*)(base + sizeof(CubeMeshHeader));
+
+    Model model;
+    size_t slash = sourcePath.find_last_of("/\\");
+    model.directory = (slash != std::string::npos) ? sourcePath.substr(0, slash + 1) : "";
+    model.meshes.resize(header.meshCount);
+
+    for (uint32_t i = 0; i < header.meshCount; i++) {
+        const CubeMeshRecord& r = records[i];
+        if (!RangeInFile(r.vertexOffset, (uint64_t)r.vertexCount * sizeof(Vertex), fileSize) ||
+            !RangeInFile(r.indexOffset, (uint64_t)r.indexCount * sizeof(uint32_t), fileSize) ||
+            !RangeInFile(r.texturePathOffset, r.texturePathLength, fileSize) ||
+            !RangeInFile(r.normalMapPathOffset, r.normalMapPathLength, fileSize) ||
+            (r.vertexOffset % alignof(Vertex)) != 0 || (r.indexOffset % alignof(uint32_t)) != 0) {
+            std::fprintf(stderr, "MeshCache: %s mesh %u is out of range\n", path.c_str(), i);
+            return false;
+        }
+
+        ModelMesh& mesh = model.meshes[i];
+        mesh.rendererMeshHandle = 0;
+        mesh.rendererTextureHandle = 0;
+        mesh.rendererNormalMapHandle = 0;
+        mesh.bakedVertices = (const Vertex*)(base + r.vertexOffset);
+        mesh.bakedIndices = (const uint32_t*)(base + r.indexOffset);
+        mesh.bakedVertexCount = r.vertexCount;
+        mesh.bakedIndexCount = r.indexCount;
+        mesh.texturePath.assign((const char*)base + r.texturePathOffset, r.texturePathLength);
+        mesh.normalMapPath.assign((const char*)base + r.normalMapPathOffset, r.normalMapPathLength);
+    }
+
+    model.mapping = std::move(file);
+    outModel = std::move(model);
+    std::printf("Loaded baked model: %s (%u meshes)\n", path.c_str(), header.meshCount);
+    return true;
+}
+
+bool MeshCache::bake(const std::string& sourcePath, const Model& model) {
+    // Lay out records, then blobs, then the string table
+    std::vector<CubeMeshRecord> records(model.meshes.size());
+    uint64_t offset = sizeof(CubeMeshHeader) + records.size() * sizeof(CubeMeshRecord);
+    for (size_t i = 0; i < model.meshes.size(); i++) {
+        const ModelMesh& mesh = model.meshes[i];
+        CubeMeshRecord& r = records[i];
+        r.vertexCount = mesh.vertexCount();
+        r.indexCount = mesh.indexCount();
+        r.vertexOffset = offset = AlignUp(offset, 16);
+        offset += (uint64_t)r.vertexCount * sizeof(Vertex);
+        r.indexOffset = offset = AlignUp(offset, 16);
+        offset += (uint64_t)r.indexCount * sizeof(uint32_t);
+    }
+    std::string strings;
+    for (size_t i = 0; i < model.meshes.size(); i++) {
+        const ModelMesh& mesh = model.meshes[i];
+        CubeMeshRecord& r = records[i];
+        r.texturePathOffset = (uint32_t)(offset + strings.size());
+        r.texturePathLength = (uint32_t)mesh.texturePath.size();
+        strings += mesh.texturePath;
+        r.normalMapPathOffset = (uint32_t)(offset + strings.size());
+        r.normalMapPathLength = (uint32_t)mesh.normalMapPath.size();
+        strings += mesh.normalMapPath;
+    }
+    if (offset + strings.size() > UINT32_MAX) {
+        std::fprintf(stderr, "MeshCache: %s is too large to bake\n", sourcePath.c_str());
+        return false;
+    }
+
+    CubeMeshHeader header = {};
+    std::memcpy(header.magic, CUBEMESH_MAGIC, sizeof(header.magic));
+    header.version = CUBEMESH_VERSION;
+    header.vertexStride = sizeof(Vertex);
+    header.meshCount = (uint32_t)records.size();
+    std::error_code ec;
+    header.sourceSize = fs::file_size(sourcePath, ec);
+    if (ec) header.sourceSize = 0;
+
+    // Write to a temporary file and rename, so a crash never leaves a torn cache
+    std::string path = cachePath(sourcePath);
+    std::string tmpPath = path + ".tmp";
+    FILE* f = std::fopen(tmpPath.c_str(), "wb");
+    if (!f) {
+        std::fprintf(stderr, "MeshCache: cannot write %s\n", tmpPath.c_str());
+        return false;
+    }
+
+    bool ok = std::fwrite(&header, sizeof(header), 1, f) == 1;
+    if (ok && !records.empty())
+        ok = std::fwrite(records.data(), sizeof(CubeMeshRecord), records.size(), f) == records.size();
+
+    uint64_t written = sizeof(CubeMeshHeader) + records.size() * sizeof(CubeMeshRecord);
+    static const uint8_t zeros[16] = {};
+    std::vector<Vertex> converted;
+    for (size_t i = 0; ok && i < model.meshes.size(); i++) {
+        const ModelMesh& mesh = model.meshes[i];
+        const CubeMeshRecord& r = records[i];
+
+        const Vertex* vertices = mesh.bakedVertices;
+        if (!vertices) {
+            converted.clear();
+            converted.reserve(mesh.vertices.size());
+            for (const auto& mv : mesh.vertices) converted.push_back(modelVertexToVertex(mv));
+            vertices = converted.data();
+        }
+
+        ok = std::fwrite(zeros, 1, (size_t)(r.vertexOffset - written), f) == r.vertexOffset - written;
+        if (ok && r.vertexCount)
+            ok = std::fwrite(vertices, sizeof(Vertex), r.vertexCount, f) == r.vertexCount;
+        written = r.vertexOffset + (uint64_t)r.vertexCount * sizeof(Vertex);
+
+        if (ok) ok = std::fwrite(zeros, 1, (size_t)(r.indexOffset - written), f) == r.indexOffset - written;
+        if (ok && r.indexCount)
+            ok = std::fwrite(mesh.indexData(), sizeof(uint32_t), r.indexCount, f) == r.indexCount;
+        written = r.indexOffset + (uint64_t)r.indexCount * sizeof(uint32_t);
+    }
+    if (ok && !strings.empty())
+        ok = std::fwrite(strings.data(), 1, strings.size(), f) == strings.size();
+    ok = (std::fclose(f) == 0) && ok;
+
+    if (ok) {
+        fs::rename(tmpPath, path, ec);
+        ok = !ec;
+    }
+    if (!ok) {
+        std::fprintf(stderr, "MeshCache: failed to write %s\n", path.c_str());
+        fs::remove(tmpPath, ec);
+        return false;
+    }
+    std::printf("Baked model: %s\n", path.c_str());
+    return true;
+}
+
+bool MeshCache::bakeFile(const std::string& sourcePath) {
+    Model model;
+    if (!ModelLoader::LoadXFile(sourcePath.c_str(), model)) return false;
+    return bake(sourcePath, model);
+}
@@ -0,0 +1,93 @@
+// mesh_cache.h - Pre-baked binary model cache (.cubemesh)
+#ifndef MESH_CACHE_H
+#define MESH_CACHE_H
+
+#include "model.h"
+#include <cstdint>
+#include <cstddef>
+#include <string>
+
+// ==================== Mapped File ====================
+// Read-only memory mapping of a whole file
+class MappedFile {
+public:
+    MappedFile() = default;
+    ~MappedFile() { close(); }
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    bool open(const std::string& path);
+    void close();
+
+    const uint8_t* data() const { return m_data; }
+    size_t size() const { return m_size; }
+
+private:
+    const uint8_t* m_data = nullptr;
+    size_t m_size = 0;
+#ifdef _WIN32
+    void* m_file = nullptr;     // HANDLE
+    void* m_mapping = nullptr;  // HANDLE
+#else
+    int m_fd = -1;
+#endif
+};
+
+// ==================== .cubemesh Format ====================
+// Little-endian, all offsets from the start of the file:
+//
+//   CubeMeshHeader
+//   CubeMeshRecord[meshCount]
+//   per mesh: Vertex[vertexCount], uint32_t[indexCount]   (16-byte aligned)
+//   string table (texture / normal map paths, not NUL-terminated)
+//
+// Vertex blobs are in renderer layout and index blobs are uint32_t, so a
+// mapped file is handed to IRenderer::createMesh without conversion.
+static const char     CUBEMESH_MAGIC[8] = { 'C', 'U', 'B', 'E', 'M', 'E', 'S', 'H' };
+static const uint32_t CUBEMESH_VERSION  = 1;
+
+struct CubeMeshHeader {
+    char     magic[8];
+    uint32_t version;
+    uint32_t vertexStride;   // sizeof(Vertex) at bake time
+    uint32_t meshCount;
+    uint32_t reserved;
+    uint64_t sourceSize;     // Byte size of the source model when baked
+};
+
+struct CubeMeshRecord {
+    uint64_t vertexOffset;
+    uint64_t indexOffset;
+    uint32_t vertexCount;
+    uint32_t indexCount;
+    uint32_t texturePathOffset;
+    uint32_t texturePathLength;
+    uint32_t normalMapPathOffset;
+    uint32_t normalMapPathLength;
+};
+
+static_assert(sizeof(CubeMeshHeader) == 32, "CubeMeshHeader is part of the file format");
+static_assert(sizeof(CubeMeshRecord) == 40, "CubeMeshRecord is part of the file format");
+
+// ==================== Mesh Cache ====================
+class MeshCache {
+public:
+    // "<source>.cubemesh", next to the source model
+    static std::string cachePath(const std::string& sourcePath) { return sourcePath + ".cubemesh"; }
+
+    // True if the cache exists and is not older than the source. A cache
+    // without its source is accepted so baked files can ship on their own.
+    static bool isFresh(const std::string& sourcePath);
+
+    // Map a fresh cache and point outModel's meshes into it (zero-copy).
+    // Returns false if the cache is missing, stale or malformed.
+    static bool load(const std::string& sourcePath, Model& outModel);
+
+    // Write outModel (as returned by ModelLoader) to the cache file
+    static bool bake(const std::string& sourcePath, const Model& model);
+
+    // Offline bake: import with Assimp and write the cache
+    static bool bakeFile(const std::string& sourcePath);
+};
+
+#endif // MESH_CACHE_H
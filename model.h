@@ -5,6 +5,9 @@
 #include "renderer.h"
 #include <string>
 #include <vector>
+#include <memory>
+
+class MappedFile;
 
 // ==================== Model Data Structures ====================
 
@@ -24,18 +27,119 @@ struct ModelMesh {
     uint32_t rendererMeshHandle;
     uint32_t rendererTextureHandle;
     uint32_t rendererNormalMapHandle;  // Handle to normal map texture
+
+    // Zero-copy view into a mapped .cubemesh (see mesh_cache.h); when set,
+    // vertices/indices are empty and the data is already in renderer layout
+    const Vertex* bakedVertices = nullptr;
+    const uint32_t* bakedIndices = nullptr;
+    uint32_t bakedVertexCount = 0;
+    uint32_t bakedIndexCount = 0;
+
+    // Object-space bounds, filled by Model::computeBounds()
+    Vec3 boundsMin = {0, 0, 0};
+    Vec3 boundsMax = {0, 0, 0};
+    Vec3 boundsCenter = {0, 0, 0};
+    float boundsRadius = 0.0f;
+
+    uint32_t vertexCount() const { return bakedVertices ? bakedVertexCount : (uint32_t)vertices.size(); }
+    uint32_t indexCount() const { return bakedIndices ? bakedIndexCount : (uint32_t)indices.size(); }
+    const uint32_t* indexData() const { return bakedIndices ? bakedIndices : indices.data(); }
+};
+
+struct Model;
+
+// Lower-detail stand-in, used once the model covers less than 'screenSize'
+// of the viewport height
+struct ModelLod {
+    const Model* model;
+    float screenSize;
 };
 
 struct Model {
     std::vector<ModelMesh> meshes;
     std::string directory;
+    std::shared_ptr<const MappedFile> mapping;  // Keeps baked mesh views alive
+    
+    // Bounds of all meshes (object space)
+    Vec3 boundsMin = {0, 0, 0};
+    Vec3 boundsMax = {0, 0, 0};
+    Vec3 boundsCenter = {0, 0, 0};
+    float boundsRadius = 0.0f;
+    
+    // Sorted by decreasing screenSize; models are owned by the ModelRegistry
+    std::vector<ModelLod> lods;
     
     void clear() {
         meshes.clear();
         directory.clear();
+        mapping.reset();
+        lods.clear();
+    }
+    
+    // Per-mesh and whole-model AABB + bounding sphere (sphere around the AABB center)
+    void computeBounds() {
+        bool any = false;
+        for (ModelMesh& mesh : meshes) {
+            uint32_t count = mesh.vertexCount();
+            if (count == 0) continue;
+            Vec3 lo = { 1e30f, 1e30f, 1e30f };
+            Vec3 hi = { -1e30f, -1e30f, -1e30f };
+            for (uint32_t i = 0; i < count; i++) {
+                Vec3 p = meshVertexPosition(mesh, i);
+                lo = { (std::min)(lo.x, p.x), (std::min)(lo.y, p.y), (std::min)(lo.z, p.z) };
+                hi = { (std::max)(hi.x, p.x), (std::max)(hi.y, p.y), (std::max)(hi.z, p.z) };
+            }
+            mesh.boundsMin = lo;
+            mesh.boundsMax = hi;
+            mesh.boundsCenter = v3_scale(v3_add(lo, hi), 0.5f);
+            float r2 = 0.0f;
+            for (uint32_t i = 0; i < count; i++) {
+                Vec3 d = v3_sub(meshVertexPosition(mesh, i), mesh.boundsCenter);
+                r2 = (std::max)(r2, v3_dot(d, d));
+            }
+            mesh.boundsRadius = std::sqrt(r2);
+
+            if (!any) {
+                boundsMin = lo;
+                boundsMax = hi;
+                any = true;
+            } else {
+                boundsMin = { (std::min)(boundsMin.x, lo.x), (std::min)(boundsMin.y, lo.y), (std::min)(boundsMin.z, lo.z) };
+                boundsMax = { (std::max)(boundsMax.x, hi.x), (std::max)(boundsMax.y, hi.y), (std::max)(boundsMax.z, hi.z) };
+            }
+        }
+        boundsCenter = v3_scale(v3_add(boundsMin, boundsMax), 0.5f);
+        boundsRadius = 0.0f;
+        for (const ModelMesh& mesh : meshes) {
+            if (mesh.vertexCount() == 0) continue;
+            float reach = v3_length(v3_sub(mesh.boundsCenter, boundsCenter)) + mesh.boundsRadius;
+            boundsRadius = (std::max)(boundsRadius, reach);
+        }
+    }
+    
+private:
+    static Vec3 meshVertexPosition(const ModelMesh& mesh, uint32_t i) {
+        if (mesh.bakedVertices) {
+            const Vertex& v = mesh.bakedVertices[i];
+            return { v.px, v.py, v.pz };
+        }
+        const ModelVertex& v = mesh.vertices[i];
+        return { v.px, v.py, v.pz };
     }
 };
 
+// Expand to the renderer's Vertex layout (constant white color)
+inline Vertex modelVertexToVertex(const ModelVertex& mv) {
+    Vertex v;
+    v.px = mv.px; v.py = mv.py; v.pz = mv.pz;
+    v.nx = mv.nx; v.ny = mv.ny; v.nz = mv.nz;
+    v.r = 1.0f; v.g = 1.0f; v.b = 1.0f; v.a = 1.0f;  // Default white
+    v.u = mv.u; v.v = mv.v;
+    v.tx = mv.tx; v.ty = mv.ty; v.tz = mv.tz;
+    v.bx = mv.bx; v.by = mv.by; v.bz = mv.bz;
+    return v;
+}
+
 // ==================== Model Loader ====================
 
 class ModelLoader {
@@ -3,11 +3,17 @@
 #define MODEL_REGISTRY_H
 
 #include "model.h"
+#include "mesh_cache.h"
 #include <unordered_map>
 #include <string>
+#include <vector>
+#include <utility>
+#include <algorithm>
 
 // ==================== Model Registry ====================
-// Manages all 3D models with key-based access
+// Manages all 3D models with key-based access. Models come from a mapped
+// .cubemesh when it is fresh; otherwise Assimp imports the source and the
+// result is baked for the next run.
 class ModelRegistry {
 public:
     ModelRegistry() = default;
@@ -24,7 +30,7 @@ public:
         
         // Load the model
         Model* model = new Model();
-        if (!ModelLoader::LoadXFile(filepath.c_str(), *model)) {
+        if (!loadModelFile(filepath, *model, m_useMeshCache)) {
             delete model;
             return false;
         }
@@ -34,6 +40,47 @@ public:
         return true;
     }
     
+    // Take ownership of a model loaded elsewhere (e.g. on an AssetLoader worker)
+    bool adoptModel(const std::string& key, const std::string& filepath, Model* model) {
+        if (!model || m_models.find(key) != m_models.end()) {
+            delete model;
+            return false;
+        }
+        m_models[key] = model;
+        m_filepaths[key] = filepath;
+        return true;
+    }
+    
+    // Touches no registry state, so it is safe to call from worker threads
+    static bool loadModelFile(const std::string& filepath, Model& outModel, bool useMeshCache) {
+        if (!useMeshCache || !MeshCache::load(filepath, outModel)) {
+            if (!ModelLoader::LoadXFile(filepath.c_str(), outModel)) return false;
+            if (useMeshCache) {
+                MeshCache::bake(filepath, outModel);  // Failure only costs the next cold start
+            }
+        }
+        outModel.computeBounds();
+        return true;
+    }
+    
+    // Attach lower-detail models (registered under their own keys) to 'key'.
+    // Missing LOD keys are skipped; the list is sorted by decreasing screen size.
+    bool setModelLods(const std::string& key, const std::vector<std::pair<std::string, float>>& lods) {
+        auto it = m_models.find(key);
+        if (it == m_models.end()) return false;
+        
+        Model* model = it->second;
+        model->lods.clear();
+        for (const auto& [lodKey, screenSize] : lods) {
+            auto lodIt = m_models.find(lodKey);
+            if (lodIt == m_models.end() || lodIt->second == model) continue;
+            model->lods.push_back({ lodIt->second, screenSize });
+        }
+        std::sort(model->lods.begin(), model->lods.end(),
+                  [](const ModelLod& a, const ModelLod& b) { return a.screenSize > b.screenSize; });
+        return true;
+    }
+    
     // Get model by key
     const Model* getModel(const std::string& key) const {
         auto it = m_models.find(key);
@@ -49,6 +96,13 @@ public:
     void unregisterModel(const std::string& key) {
         auto it = m_models.find(key);
         if (it != m_models.end()) {
+            // Drop LOD links to the model before it goes away
+            for (auto& pair : m_models) {
+                auto& lods = pair.second->lods;
+                lods.erase(std::remove_if(lods.begin(), lods.end(),
+                                          [&](const ModelLod& lod) { return lod.model == it->second; }),
+                           lods.end());
+            }
             delete it->second;
             m_models.erase(it);
             m_filepaths.erase(key);
@@ -82,7 +136,12 @@ public:
     // Stats
     size_t getModelCount() const { return m_models.size(); }
     
+    // Read and write .cubemesh caches (default on)
+    void setUseMeshCache(bool enabled) { m_useMeshCache = enabled; }
+    bool getUseMeshCache() const { return m_useMeshCache; }
+    
 private:
+    bool m_useMeshCache = true;
     std::unordered_map<std::string, Model*> m_models;
     std::unordered_map<std::string, std::string> m_filepaths;
 };
@@ -2,133 +2,226 @@
 #ifndef NORMAL_MAP_GEN_H
 #define NORMAL_MAP_GEN_H
 
+#include "math_simd.h"
+#include "job_system.h"
+#include "shader_cache.h"
 #include <vector>
 #include <cmath>
 #include <cstdint>
+#include <cstring>
+#include <algorithm>
+
+// ==================== Row Scheduling ====================
+// Generators fill whole rows, so any split by row is race-free. With a job
+// system the rows go out in chunks of about 64K texels; without one (or for
+// maps smaller than a chunk) they run on the calling thread.
+template <typename RowFunc>
+inline void generateNormalMapRows(int width, int height, JobSystem* jobs, RowFunc&& row) {
+    uint32_t grain = (uint32_t)(std::max)(1, 65536 / (std::max)(width, 1));
+    if (!jobs || (uint32_t)height <= grain) {
+        for (int y = 0; y < height; y++) row(y);
+        return;
+    }
+    jobs->parallelFor((uint32_t)height, grain, [&](uint32_t begin, uint32_t end) {
+        for (uint32_t y = begin; y < end; y++) row((int)y);
+    });
+}
+
+// [-1,1] to [0,255], truncating like the scalar generators always have
+inline uint8_t normalMapByte(float n) { return (uint8_t)((n * 0.5f + 0.5f) * 255.0f); }
+
+// Normalizes (nx[i], ny, 1) for 'count' texels into RGBA, four per step
+inline void normalMapRowFromGradients(const float* nx, float ny, int count, uint8_t* out) {
+    const Float4 half = f4_splat(0.5f);
+    const Float4 scale = f4_splat(255.0f);
+    const Float4 one = f4_splat(1.0f);
+    const Float4 vy = f4_splat(ny);
+    alignas(16) float r[4], g[4], b[4];
+    int x = 0;
+    for (; x + 4 <= count; x += 4) {
+        Float4 vx = f4_loadu(nx + x);
+        Float4 len = f4_sqrt(f4_add(f4_add(f4_mul(vx, vx), f4_mul(vy, vy)), one));
+        f4_store(r, f4_mul(f4_madd(f4_div(vx, len), half, half), scale));
+        f4_store(g, f4_mul(f4_madd(f4_div(vy, len), half, half), scale));
+        f4_store(b, f4_mul(f4_madd(f4_div(one, len), half, half), scale));
+        for (int i = 0; i < 4; i++) {
+            uint8_t* texel = out + (size_t)(x + i) * 4;
+            texel[0] = (uint8_t)r[i];
+            texel[1] = (uint8_t)g[i];
+            texel[2] = (uint8_t)b[i];
+            texel[3] = 255;
+        }
+    }
+    for (; x < count; x++) {
+        float len = std::sqrt(nx[x] * nx[x] + ny * ny + 1.0f);
+        uint8_t* texel = out + (size_t)x * 4;
+        texel[0] = normalMapByte(nx[x] / len);
+        texel[1] = normalMapByte(ny / len);
+        texel[2] = normalMapByte(1.0f / len);
+        texel[3] = 255;
+    }
+}
 
 // Generate a procedural normal map with a bumpy pattern
 // Returns RGBA data (RGB = normal, A = unused)
-inline std::vector<uint8_t> generateProceduralNormalMap(int width, int height, float bumpScale = 1.0f) {
-    std::vector<uint8_t> data(width * height * 4);
-    
+//
+// The normal is the gradient of the wave field sampled 0.01 ahead in u and
+// in v. Only the horizontal wave varies along u and only the vertical one
+// along v, so the x gradient is a function of the column and the y
+// gradient of the row: both come from one table each, and the height
+// itself drops out (which is why there is no bump scale: it never changed
+// the result). Matches the original per-texel evaluation to within one
+// step of 255.
+inline std::vector<uint8_t> generateProceduralNormalMap(int width, int height, JobSystem* jobs = nullptr) {
+    std::vector<uint8_t> data((size_t)width * height * 4);
+
+    // dHeight/dx and dHeight/dy, tangent space (perturbed from flat 0,0,1)
+    std::vector<float> columnNx(width);
+    std::vector<float> rowNy(height);
+    for (int x = 0; x < width; x++) {
+        float u = (float)x / width;
+        columnNx[x] = -(std::sin((u + 0.01f) * 20.0f * 3.14159f) * 0.3f) * 10.0f;
+    }
     for (int y = 0; y < height; y++) {
-        for (int x = 0; x < width; x++) {
-            int idx = (y * width + x) * 4;
-            
-            // Create a bumpy pattern using sine waves
-            float u = (float)x / width;
-            float v = (float)y / height;
-            
-            // Multiple frequency bumps for interesting surface detail
-            float bump = 0.0f;
-            bump += std::sin(u * 20.0f * 3.14159f) * 0.3f;  // Horizontal waves
-            bump += std::sin(v * 20.0f * 3.14159f) * 0.3f;  // Vertical waves
-            bump += std::sin((u + v) * 40.0f * 3.14159f) * 0.2f;  // Diagonal detail
-            bump += std::sin((u - v) * 40.0f * 3.14159f) * 0.2f;  // Opposite diagonal
-            bump *= bumpScale;
-            
-            // Calculate surface normal from height field
-            // Sample neighboring points to get gradient
-            float h_right = bump + std::sin((u + 0.01f) * 20.0f * 3.14159f) * 0.3f;
-            float h_up = bump + std::sin((v + 0.01f) * 20.0f * 3.14159f) * 0.3f;
-            
-            // Tangent space normal (perturbed from flat 0,0,1)
-            float nx = -(h_right - bump) * 10.0f;  // dHeight/dx
-            float ny = -(h_up - bump) * 10.0f;     // dHeight/dy
-            float nz = 1.0f;
-            
-            // Normalize
-            float len = std::sqrt(nx * nx + ny * ny + nz * nz);
-            if (len > 0.0001f) {
-                nx /= len;
-                ny /= len;
-                nz /= len;
-            }
-            
-            // Convert from [-1,1] to [0,255]
-            data[idx + 0] = (uint8_t)((nx * 0.5f + 0.5f) * 255.0f);  // R
-            data[idx + 1] = (uint8_t)((ny * 0.5f + 0.5f) * 255.0f);  // G
-            data[idx + 2] = (uint8_t)((nz * 0.5f + 0.5f) * 255.0f);  // B
-            data[idx + 3] = 255;  // A
-        }
+        float v = (float)y / height;
+        rowNy[y] = -(std::sin((v + 0.01f) * 20.0f * 3.14159f) * 0.3f) * 10.0f;
     }
-    
+
+    generateNormalMapRows(width, height, jobs, [&](int y) {
+        normalMapRowFromGradients(columnNx.data(), rowNy[y], width, data.data() + (size_t)y * width * 4);
+    });
     return data;
 }
 
 // Generate a simpler rivet/panel pattern (looks more mechanical)
-inline std::vector<uint8_t> generateRivetNormalMap(int width, int height) {
-    std::vector<uint8_t> data(width * height * 4);
-    
-    for (int y = 0; y < height; y++) {
-        for (int x = 0; x < width; x++) {
-            int idx = (y * width + x) * 4;
-            
-            float u = (float)x / width;
-            float v = (float)y / height;
-            
-            // Create rivet pattern (circular bumps in a grid)
-            float rivetSpacing = 8.0f;  // Rivets every 1/8th of texture
-            float rivetRadius = 0.03f;
-            
-            float cellX = std::fmod(u * rivetSpacing, 1.0f);
-            float cellY = std::fmod(v * rivetSpacing, 1.0f);
-            
-            // Distance from center of cell
-            float dx = cellX - 0.5f;
-            float dy = cellY - 0.5f;
-            float dist = std::sqrt(dx * dx + dy * dy);
-            
-            // Create circular bump
-            float bump = 0.0f;
-            if (dist < rivetRadius) {
-                // Spherical bump
-                float t = dist / rivetRadius;
-                bump = std::cos(t * 3.14159f * 0.5f) * 0.5f;
-            }
-            
-            // Add panel lines (horizontal grooves)
-            float panelLine = std::fmod(v * 4.0f, 1.0f);
-            if (panelLine > 0.48f && panelLine < 0.52f) {
-                bump -= 0.3f;  // Groove
-            }
-            
-            // Calculate normal from bump
-            float nx = (dist < rivetRadius) ? -dx / (rivetRadius * 2.0f) : 0.0f;
-            float ny = (dist < rivetRadius) ? -dy / (rivetRadius * 2.0f) : 0.0f;
+//
+// Cell offsets are per column and per row, so the inner loop only tests
+// four texels at a time against the rivet radius; the few inside a rivet
+// take the exact scalar path, the rest are flat. Output is bit-identical
+// to the per-texel version.
+inline std::vector<uint8_t> generateRivetNormalMap(int width, int height, JobSystem* jobs = nullptr) {
+    std::vector<uint8_t> data((size_t)width * height * 4);
+
+    const float rivetSpacing = 8.0f;  // Rivets every 1/8th of texture
+    const float rivetRadius = 0.03f;
+
+    // Distance from the centre of the cell along each axis
+    std::vector<float> columnDx(width);
+    for (int x = 0; x < width; x++) {
+        float u = (float)x / width;
+        columnDx[x] = std::fmod(u * rivetSpacing, 1.0f) - 0.5f;
+    }
+
+    generateNormalMapRows(width, height, jobs, [&](int y) {
+        float v = (float)y / height;
+        float dy = std::fmod(v * rivetSpacing, 1.0f) - 0.5f;
+
+        // Add panel lines (horizontal grooves)
+        float panelLine = std::fmod(v * 4.0f, 1.0f);
+        float groove = (panelLine > 0.48f && panelLine < 0.52f) ? -0.3f : 0.0f;
+
+        // Outside the rivets the normal is (0, 0, 1 - |groove|), normalized
+        float flatZ = 1.0f - std::abs(groove);
+        float flatLen = std::sqrt(flatZ * flatZ);
+        uint8_t flat[4] = { normalMapByte(0.0f), normalMapByte(0.0f),
+                            normalMapByte(flatLen > 0.0001f ? flatZ / flatLen : flatZ), 255 };
+
+        auto rivetTexel = [&](int x, float dist, uint8_t* texel) {
+            float dx = columnDx[x];
+            // Spherical bump
+            float t = dist / rivetRadius;
+            float bump = std::cos(t * 3.14159f * 0.5f) * 0.5f + groove;
+            float nx = -dx / (rivetRadius * 2.0f);
+            float ny = -dy / (rivetRadius * 2.0f);
             float nz = 1.0f - std::abs(bump);
-            
-            // Normalize
             float len = std::sqrt(nx * nx + ny * ny + nz * nz);
             if (len > 0.0001f) {
                 nx /= len;
                 ny /= len;
                 nz /= len;
             }
-            
-            // Convert from [-1,1] to [0,255]
-            data[idx + 0] = (uint8_t)((nx * 0.5f + 0.5f) * 255.0f);
-            data[idx + 1] = (uint8_t)((ny * 0.5f + 0.5f) * 255.0f);
-            data[idx + 2] = (uint8_t)((nz * 0.5f + 0.5f) * 255.0f);
-            data[idx + 3] = 255;
+            texel[0] = normalMapByte(nx);
+            texel[1] = normalMapByte(ny);
+            texel[2] = normalMapByte(nz);
+            texel[3] = 255;
+        };
+
+        uint8_t* row = data.data() + (size_t)y * width * 4;
+        const Float4 vdy2 = f4_splat(dy * dy);
+        const Float4 radius = f4_splat(rivetRadius);
+        alignas(16) float dist[4];
+        int x = 0;
+        for (; x + 4 <= width; x += 4) {
+            Float4 vdx = f4_loadu(columnDx.data() + x);
+            Float4 vdist = f4_sqrt(f4_add(f4_mul(vdx, vdx), vdy2));
+            int inside = f4_lessMask(vdist, radius);
+            if (inside) f4_store(dist, vdist);
+            for (int i = 0; i < 4; i++) {
+                uint8_t* texel = row + (size_t)(x + i) * 4;
+                if (inside & (1 << i)) {
+                    rivetTexel(x + i, dist[i], texel);
+                } else {
+                    std::memcpy(texel, flat, 4);
+                }
+            }
         }
-    }
-    
+        for (; x < width; x++) {
+            float dx = columnDx[x];
+            float d = std::sqrt(dx * dx + dy * dy);
+            if (d < rivetRadius) {
+                rivetTexel(x, d, row + (size_t)x * 4);
+            } else {
+                std::memcpy(row + (size_t)x * 4, flat, 4);
+            }
+        }
+    });
     return data;
 }
 
 // Generate a flat normal map (for testing - should look identical to no normal map)
 inline std::vector<uint8_t> generateFlatNormalMap(int width, int height) {
-    std::vector<uint8_t> data(width * height * 4);
-    
-    for (int i = 0; i < width * height; i++) {
-        data[i * 4 + 0] = 128;  // X = 0
-        data[i * 4 + 1] = 128;  // Y = 0
-        data[i * 4 + 2] = 255;  // Z = 1 (pointing up in tangent space)
-        data[i * 4 + 3] = 255;  // Alpha
+    std::vector<uint8_t> data((size_t)width * height * 4);
+
+    // X = 0, Y = 0, Z = 1 (pointing up in tangent space), alpha
+    const uint8_t texel[4] = { 128, 128, 255, 255 };
+    for (size_t i = 0; i < (size_t)width * height; i++) {
+        std::memcpy(&data[i * 4], texel, 4);
     }
-    
+
     return data;
 }
 
+// ==================== Normal Map Cache ====================
+// Generated maps are stored in the shader cache directory (shader_cache.h)
+// as raw RGBA, keyed by generator, version, size and parameters, so the
+// next launch reads them instead of generating them. Bump the version when
+// a generator's output changes.
+static const uint32_t NORMALMAP_GEN_VERSION = 1;
+
+inline uint64_t normalMapCacheKey(const char* generator, int width, int height, float param) {
+    uint32_t paramBits;
+    std::memcpy(&paramBits, &param, sizeof(paramBits));
+    return ShaderCacheKey().add(generator).add((uint64_t)NORMALMAP_GEN_VERSION)
+                           .add((uint64_t)width).add((uint64_t)height).add((uint64_t)paramBits).value();
+}
+
+template <typename Generate>
+inline std::vector<uint8_t> loadOrGenerateNormalMap(uint64_t key, int width, int height, Generate&& generate) {
+    std::vector<uint8_t> data;
+    if (ShaderCache::load(key, ".rgba", data) && data.size() == (size_t)width * height * 4) return data;
+    data = generate();
+    ShaderCache::store(key, ".rgba", data.data(), data.size());
+    return data;
+}
+
+inline std::vector<uint8_t> cachedProceduralNormalMap(int width, int height, JobSystem* jobs = nullptr) {
+    return loadOrGenerateNormalMap(normalMapCacheKey("procedural", width, height, 0.0f), width, height,
+                                   [&] { return generateProceduralNormalMap(width, height, jobs); });
+}
+
+inline std::vector<uint8_t> cachedRivetNormalMap(int width, int height, JobSystem* jobs = nullptr) {
+    return loadOrGenerateNormalMap(normalMapCacheKey("rivet", width, height, 0.0f), width, height,
+                                   [&] { return generateRivetNormalMap(width, height, jobs); });
+}
+
 #endif // NORMAL_MAP_GEN_H
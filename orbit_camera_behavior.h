@@ -43,6 +43,11 @@ public:
         updateCameraPosition();
     }
     
+    // Reads its own entity only; the camera pose is private state
+    BehaviorAccess getAccess() const override {
+        return { COMPONENT_TRANSFORM, 0, false, false, BehaviorPhase::Camera };
+    }
+    
     // Manual control methods
     void rotate(float deltaYaw, float deltaPitch) {
         m_yaw += deltaYaw;
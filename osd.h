@@ -3,9 +3,139 @@
 #define OSD_H
 
 #include "flight_dynamics.h"
-#include <string>
-#include <vector>
-#include <cstdio>
+#include "text_renderer.h"
+#include <cstdint>
+#include <cstring>
+
+// ==================== OSD Line Buffer ====================
+// Fixed storage for one frame of OSD text. Lines are NUL-terminated and
+// packed back to back in m_text; nothing is allocated after construction,
+// so the buffer can be refilled every frame. Text that doesn't fit is cut
+// off (the line still ends in NUL), and lines past MAX_LINES are dropped.
+class OSDLineBuffer {
+public:
+    static constexpr int MAX_LINES = 24;
+    static constexpr int MAX_TEXT = 1536;   // Bytes for all lines, NULs included
+
+    struct Line {
+        const char* text;
+        TextColor color;
+    };
+
+    OSDLineBuffer() { clear(); }
+    
+    // Copies point their lines into their own text
+    OSDLineBuffer(const OSDLineBuffer& other) { *this = other; }
+    OSDLineBuffer& operator=(const OSDLineBuffer& other) {
+        if (this == &other) return *this;
+        std::memcpy(m_text, other.m_text, sizeof(m_text));
+        for (int i = 0; i < other.m_lineCount; i++) {
+            m_lines[i].text = m_text + (other.m_lines[i].text - other.m_text);
+            m_lines[i].color = other.m_lines[i].color;
+        }
+        m_lineCount = other.m_lineCount;
+        m_length = other.m_length;
+        m_open = other.m_open;
+        return *this;
+    }
+
+    void clear() {
+        m_lineCount = 0;
+        m_length = 0;
+        m_open = false;
+    }
+
+    int size() const { return m_lineCount; }
+    const Line& operator[](int index) const { return m_lines[index]; }
+    const Line* begin() const { return m_lines; }
+    const Line* end() const { return m_lines + m_lineCount; }
+
+    // Start a line; append*() then adds to it until the next beginLine()
+    void beginLine(TextColor color = TextColor::Green()) {
+        int start = m_lineCount > 0 ? m_length + 1 : 0;   // Past the previous line's NUL
+        if (m_lineCount >= MAX_LINES || start >= MAX_TEXT) {
+            m_open = false;
+            return;
+        }
+        m_length = start;
+        m_lines[m_lineCount].text = m_text + m_length;
+        m_lines[m_lineCount].color = color;
+        m_lineCount++;
+        m_text[m_length] = '\0';
+        m_open = true;
+    }
+
+    void line(const char* text, TextColor color = TextColor::Green()) {
+        beginLine(color);
+        append(text);
+    }
+
+    void append(const char* text) {
+        while (*text) appendChar(*text++);
+    }
+
+    // Spaces up to 'column' (0-based) of the current line
+    void padTo(int column) {
+        if (!m_open) return;
+        int length = (int)(m_text + m_length - m_lines[m_lineCount - 1].text);
+        for (int i = length; i < column; i++) appendChar(' ');
+    }
+
+    // printf("%[+]<width>.<decimals>f", value) without the locale and
+    // varargs machinery; up to 3 decimals, exact halves round away from
+    // zero, and magnitudes >= 1e9 or NaN print as "---"
+    void appendFixed(float value, int width, int decimals, bool forceSign = false) {
+        char digits[24];
+        int count = 0;
+
+        bool negative = value < 0.0f;
+        float magnitude = negative ? -value : value;
+        if (!(magnitude < 1e9f)) {
+            appendPadded("---", 3, width);
+            return;
+        }
+
+        static constexpr uint32_t POW10[] = { 1, 10, 100, 1000 };
+        if (decimals < 0) decimals = 0;
+        if (decimals > 3) decimals = 3;
+        uint64_t fixed = (uint64_t)((double)magnitude * POW10[decimals] + 0.5);
+        if (fixed == 0) negative = false;   // printf would give "-0"; the OSD doesn't want it
+
+        // Digits come out least significant first
+        for (int i = 0; i < decimals; i++) {
+            digits[count++] = (char)('0' + fixed % 10);
+            fixed /= 10;
+        }
+        if (decimals > 0) digits[count++] = '.';
+        do {
+            digits[count++] = (char)('0' + fixed % 10);
+            fixed /= 10;
+        } while (fixed);
+        if (negative) digits[count++] = '-';
+        else if (forceSign) digits[count++] = '+';
+
+        for (int i = count; i < width; i++) appendChar(' ');
+        while (count > 0) appendChar(digits[--count]);
+    }
+
+private:
+    void appendChar(char c) {
+        if (!m_open || m_length + 1 >= MAX_TEXT) return;
+        m_text[m_length++] = c;
+        m_text[m_length] = '\0';
+    }
+
+    void appendPadded(const char* text, int length, int width) {
+        for (int i = length; i < width; i++) appendChar(' ');
+        append(text);
+    }
+
+    Line m_lines[MAX_LINES];
+    char m_text[MAX_TEXT];
+    int m_lineCount;
+    int m_length;       // Offset of the last line's NUL
+    bool m_open;        // The last beginLine() got a line
+};
 
 // ==================== OSD Display System ====================
 
@@ -25,13 +155,13 @@ public:
     void toggleDetailedMode() { m_detailedMode = !m_detailedMode; }
     bool isDetailedMode() const { return m_detailedMode; }
     
-    // Generate OSD text lines
-    std::vector<std::string> generateOSDLines(const AircraftState& state, const ControlInputs& controls) {
-        std::vector<std::string> lines;
-        
-        if (!m_enabled) return lines;
+    // Generate OSD text lines into a buffer owned by the OSD; the result
+    // stays valid until the next call
+    const OSDLineBuffer& generateOSDLines(const AircraftState& state, const ControlInputs& controls) {
+        OSDLineBuffer& out = m_lines;
+        out.clear();
         
-        char buffer[256];
+        if (!m_enabled) return out;
         
         // Convert speed to km/h and knots
         float speedKmh = state.speed * 3.6f;
@@ -51,83 +181,101 @@ public:
         
         if (m_detailedMode) {
             // ==================== DETAILED MODE ====================
-            lines.push_back("=== FLIGHT DATA ===");
+            out.line("=== FLIGHT DATA ===", TextColor::Cyan());
             
             // Airspeed
-            snprintf(buffer, sizeof(buffer), "AIRSPEED: %3.0f kt (%3.0f km/h)", speedKnots, speedKmh);
-            lines.push_back(buffer);
+            out.beginLine();
+            out.append("AIRSPEED: "); out.appendFixed(speedKnots, 3, 0);
+            out.append(" kt (");      out.appendFixed(speedKmh, 3, 0);
+            out.append(" km/h)");
             
             // Altitude
-            snprintf(buffer, sizeof(buffer), "ALTITUDE: %4.0f ft (%4.0f m)", altitudeFeet, state.position.y);
-            lines.push_back(buffer);
+            out.beginLine();
+            out.append("ALTITUDE: "); out.appendFixed(altitudeFeet, 4, 0);
+            out.append(" ft (");      out.appendFixed(state.position.y, 4, 0);
+            out.append(" m)");
             
             // Vertical speed
-            snprintf(buffer, sizeof(buffer), "V/S:      %+5.0f fpm", verticalSpeedFpm);
-            lines.push_back(buffer);
+            out.beginLine();
+            out.append("V/S:      "); out.appendFixed(verticalSpeedFpm, 5, 0, true);
+            out.append(" fpm");
             
             // Attitude
-            snprintf(buffer, sizeof(buffer), "PITCH:    %+6.1f deg", pitchDeg);
-            lines.push_back(buffer);
+            out.beginLine();
+            out.append("PITCH:    "); out.appendFixed(pitchDeg, 6, 1, true);
+            out.append(" deg");
             
-            snprintf(buffer, sizeof(buffer), "ROLL:     %+6.1f deg", rollDeg);
-            lines.push_back(buffer);
+            out.beginLine();
+            out.append("ROLL:     "); out.appendFixed(rollDeg, 6, 1, true);
+            out.append(" deg");
             
-            snprintf(buffer, sizeof(buffer), "HEADING:  %6.1f deg", normalizeHeading(yawDeg));
-            lines.push_back(buffer);
+            out.beginLine();
+            out.append("HEADING:  "); out.appendFixed(normalizeHeading(yawDeg), 6, 1);
+            out.append(" deg");
             
             // Throttle
-            snprintf(buffer, sizeof(buffer), "THROTTLE: %3.0f%%", controls.throttle * 100.0f);
-            lines.push_back(buffer);
+            out.beginLine();
+            out.append("THROTTLE: "); out.appendFixed(controls.throttle * 100.0f, 3, 0);
+            out.append("%");
             
             // Angular rates
-            lines.push_back("--- RATES ---");
-            snprintf(buffer, sizeof(buffer), "PITCH RATE: %+5.2f deg/s", state.pitchRate * 57.2958f);
-            lines.push_back(buffer);
+            out.line("--- RATES ---", TextColor::Cyan());
+            out.beginLine();
+            out.append("PITCH RATE: "); out.appendFixed(state.pitchRate * 57.2958f, 5, 2, true);
+            out.append(" deg/s");
             
-            snprintf(buffer, sizeof(buffer), "ROLL RATE:  %+5.2f deg/s", state.rollRate * 57.2958f);
-            lines.push_back(buffer);
+            out.beginLine();
+            out.append("ROLL RATE:  "); out.appendFixed(state.rollRate * 57.2958f, 5, 2, true);
+            out.append(" deg/s");
             
-            snprintf(buffer, sizeof(buffer), "YAW RATE:   %+5.2f deg/s", state.yawRate * 57.2958f);
-            lines.push_back(buffer);
+            out.beginLine();
+            out.append("YAW RATE:   "); out.appendFixed(state.yawRate * 57.2958f, 5, 2, true);
+            out.append(" deg/s");
             
             // Controls
-            lines.push_back("--- CONTROLS ---");
-            snprintf(buffer, sizeof(buffer), "ELEVATOR: %+5.2f", controls.elevator);
-            lines.push_back(buffer);
+            out.line("--- CONTROLS ---", TextColor::Cyan());
+            out.beginLine();
+            out.append("ELEVATOR: "); out.appendFixed(controls.elevator, 5, 2, true);
             
-            snprintf(buffer, sizeof(buffer), "AILERON:  %+5.2f", controls.aileron);
-            lines.push_back(buffer);
+            out.beginLine();
+            out.append("AILERON:  "); out.appendFixed(controls.aileron, 5, 2, true);
             
-            snprintf(buffer, sizeof(buffer), "RUDDER:   %+5.2f", controls.rudder);
-            lines.push_back(buffer);
+            out.beginLine();
+            out.append("RUDDER:   "); out.appendFixed(controls.rudder, 5, 2, true);
             
         } else {
             // ==================== SIMPLE MODE ====================
             
             // Compact HUD-style display
-            snprintf(buffer, sizeof(buffer), "SPD %3.0fkt  ALT %4.0fft  THR %3.0f%%", 
-                     speedKnots, altitudeFeet, controls.throttle * 100.0f);
-            lines.push_back(buffer);
+            out.beginLine();
+            out.append("SPD ");    out.appendFixed(speedKnots, 3, 0);
+            out.append("kt  ALT "); out.appendFixed(altitudeFeet, 4, 0);
+            out.append("ft  THR "); out.appendFixed(controls.throttle * 100.0f, 3, 0);
+            out.append("%");
             
-            snprintf(buffer, sizeof(buffer), "HDG %3.0f  PITCH %+4.0f  ROLL %+4.0f", 
-                     normalizeHeading(yawDeg), pitchDeg, rollDeg);
-            lines.push_back(buffer);
+            out.beginLine();
+            out.append("HDG ");      out.appendFixed(normalizeHeading(yawDeg), 3, 0);
+            out.append("  PITCH ");  out.appendFixed(pitchDeg, 4, 0, true);
+            out.append("  ROLL ");   out.appendFixed(rollDeg, 4, 0, true);
             
             if (verticalSpeedFpm > 100.0f) {
-                snprintf(buffer, sizeof(buffer), "CLIMBING %+.0f fpm", verticalSpeedFpm);
-                lines.push_back(buffer);
+                out.beginLine(TextColor::Green());
+                out.append("CLIMBING "); out.appendFixed(verticalSpeedFpm, 0, 0, true);
+                out.append(" fpm");
             } else if (verticalSpeedFpm < -100.0f) {
-                snprintf(buffer, sizeof(buffer), "DESCENDING %+.0f fpm", verticalSpeedFpm);
-                lines.push_back(buffer);
+                out.beginLine(TextColor::Yellow());
+                out.append("DESCENDING "); out.appendFixed(verticalSpeedFpm, 0, 0, true);
+                out.append(" fpm");
             }
         }
         
-        return lines;
+        return out;
     }
     
 private:
     bool m_enabled;
     bool m_detailedMode;
+    OSDLineBuffer m_lines;   // Reused every frame
     
     // Normalize heading to 0-360 range
     float normalizeHeading(float heading) const {
@@ -0,0 +1,308 @@
+// profiler.h - Scoped CPU zones, per-frame summaries and Chrome trace capture
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include "renderer.h"
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// ==================== Profile Events ====================
+struct ProfileEvent {
+    const char* name;       // String literal
+    uint64_t startNs;       // Profiler::nowNs() timebase
+    uint64_t durationNs;
+    uint32_t thread;        // Profiler thread index; GPU_THREAD for GPU zones
+    uint32_t depth;         // Zone nesting on that thread
+};
+
+// One zone name's total over a frame, across all threads
+struct ProfileZoneSummary {
+    const char* name;
+    double ms;
+    uint32_t calls;
+    uint32_t depth;         // Shallowest nesting seen
+    bool mainThread;        // Recorded on the thread that calls beginFrame()
+};
+
+struct ProfileFrameSummary {
+    static constexpr uint32_t MAX_ZONES = 24;   // Further names are left out
+
+    uint64_t frame = 0;
+    double frameMs = 0.0;    // beginFrame() to the next beginFrame()
+    uint32_t droppedEvents = 0;   // Past MAX_EVENTS_PER_FRAME
+    uint32_t zoneCount = 0;       // In order of first appearance
+    ProfileZoneSummary zones[MAX_ZONES];
+};
+
+// ==================== Profiler ====================
+// Zones finished on any thread are appended to the current frame under a
+// mutex (they are coarse: a handful per frame plus one per job batch).
+// beginFrame(), on the main thread, closes the frame, summarizes it for
+// the overlay and, while a capture is running, keeps its events for the
+// Chrome trace (chrome://tracing or https://ui.perfetto.dev).
+//
+// Frames are numbered by beginFrame() calls starting at 1, the same way
+// renderers number GpuFrameTiming::frame, so addGpuFrame() can place GPU
+// zones. They are drawn relative to the start of the CPU frame that
+// recorded them, not on a synchronized GPU clock.
+class Profiler {
+public:
+    static constexpr uint32_t GPU_THREAD = 0xFFFFu;           // Trace row for GPU zones
+    static constexpr uint32_t MAX_EVENTS_PER_FRAME = 65536;   // Beyond this, events are dropped
+    static constexpr uint32_t GPU_LATENCY_FRAMES = 6;         // Frames a capture waits for GPU results
+
+    static void setEnabled(bool enabled) { s_enabled.store(enabled, std::memory_order_relaxed); }
+    static bool isEnabled() { return s_enabled.load(std::memory_order_relaxed); }
+
+    static uint64_t nowNs() {
+        return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - s_epoch).count();
+    }
+
+    // Small per-thread index, in order of first use
+    static uint32_t threadIndex() {
+        thread_local uint32_t index = s_nextThread.fetch_add(1);
+        return index;
+    }
+
+    static uint32_t& threadDepth() {
+        thread_local uint32_t depth = 0;
+        return depth;
+    }
+
+    static void record(const char* name, uint64_t startNs, uint64_t endNs, uint32_t depth) {
+        ProfileEvent event = { name, startNs, endNs > startNs ? endNs - startNs : 0, threadIndex(), depth };
+        std::lock_guard<std::mutex> lock(s_mutex);
+        if (s_events.size() >= MAX_EVENTS_PER_FRAME) {
+            s_dropped++;
+            return;
+        }
+        s_events.push_back(event);
+    }
+
+    // Close the previous frame and start the next; main thread only
+    static void beginFrame() {
+        uint64_t now = nowNs();
+        uint32_t dropped;
+        {
+            std::lock_guard<std::mutex> lock(s_mutex);
+            s_frameEvents.swap(s_events);
+            s_events.clear();   // Keeps the capacity of the frame before last
+            dropped = s_dropped;
+            s_dropped = 0;
+        }
+
+        if (s_frame > 0) {
+            summarize(now);
+            s_summary.droppedEvents = dropped;
+            if (s_capturing && s_frame >= s_captureFirst && s_frame < s_captureFirst + s_captureFrames) {
+                s_capture.push_back({ "Frame", s_frameStart, now - s_frameStart, s_mainThread, 0 });
+                s_capture.insert(s_capture.end(), s_frameEvents.begin(), s_frameEvents.end());
+                s_captureFrameStarts.push_back(s_frameStart);
+            }
+        }
+
+        s_frame++;
+        s_frameStart = now;
+        if (s_capturing && s_frame >= s_captureFirst + s_captureFrames + GPU_LATENCY_FRAMES) {
+            stopCapture();
+        }
+    }
+
+    // Feed the renderer's newest GPU results (repeats are ignored)
+    static void addGpuFrame(const GpuFrameTiming& timing) {
+        if (timing.frame == 0 || timing.frame == s_lastGpu.frame) return;
+        s_lastGpu = timing;
+        if (!s_capturing || timing.frame < s_captureFirst) return;
+        uint64_t index = timing.frame - s_captureFirst;
+        if (index >= s_captureFrameStarts.size()) return;
+
+        uint64_t base = s_captureFrameStarts[index];
+        s_capture.push_back({ "GPU Frame", base, (uint64_t)(timing.frameMs * 1e6), GPU_THREAD, 0 });
+        for (uint32_t i = 0; i < timing.zoneCount; i++) {
+            const GpuZoneTiming& zone = timing.zones[i];
+            s_capture.push_back({ zone.name, base + (uint64_t)(zone.startMs * 1e6),
+                                  (uint64_t)(zone.durationMs * 1e6), GPU_THREAD, zone.depth + 1 });
+        }
+    }
+
+    static const ProfileFrameSummary& getLastFrame() { return s_summary; }
+    static const GpuFrameTiming& getLastGpuFrame() { return s_lastGpu; }
+
+    // Record the next 'frames' frames, then write them to 'path' as Chrome
+    // trace JSON. Enables the profiler.
+    static bool startCapture(const std::string& path, uint32_t frames) {
+        if (s_capturing) stopCapture();
+        if (frames == 0) return false;
+        s_capturePath = path;
+        s_captureFirst = s_frame + 1;
+        s_captureFrames = frames;
+        s_capture.clear();
+        s_captureFrameStarts.clear();
+        s_capturing = true;
+        setEnabled(true);
+        return true;
+    }
+
+    static bool isCapturing() { return s_capturing; }
+
+    // Write whatever the running capture holds (also called when it completes)
+    static bool stopCapture() {
+        if (!s_capturing) return true;
+        s_capturing = false;
+        bool ok = writeChromeTrace(s_capturePath, s_capture);
+        if (ok) {
+            std::printf("Profiler: wrote %zu frames (%zu events) to %s\n",
+                        s_captureFrameStarts.size(), s_capture.size(), s_capturePath.c_str());
+        }
+        s_capture.clear();
+        s_capture.shrink_to_fit();
+        s_captureFrameStarts.clear();
+        return ok;
+    }
+
+    static bool writeChromeTrace(const std::string& path, const std::vector<ProfileEvent>& events) {
+        FILE* file = std::fopen(path.c_str(), "w");
+        if (!file) {
+            std::fprintf(stderr, "Profiler: cannot write %s\n", path.c_str());
+            return false;
+        }
+
+        std::fputs("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n", file);
+        uint32_t threads = s_nextThread.load();
+        for (uint32_t t = 0; t < threads; t++) {
+            std::fprintf(file, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,"
+                               "\"args\":{\"name\":\"%s %u\"}},\n",
+                         t, t == s_mainThread ? "Main" : "Thread", t);
+        }
+        std::fprintf(file, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,"
+                           "\"args\":{\"name\":\"GPU\"}}", GPU_THREAD);
+        for (const ProfileEvent& e : events) {
+            std::fputs(",\n{\"name\":\"", file);
+            for (const char* c = e.name; *c; c++) {
+                if (*c == '"' || *c == '\\') std::fputc('\\', file);
+                std::fputc(*c, file);
+            }
+            std::fprintf(file, "\",\"cat\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%u,"
+                               "\"ts\":%.3f,\"dur\":%.3f}",
+                         e.thread == GPU_THREAD ? "gpu" : "cpu", e.thread,
+                         e.startNs / 1000.0, e.durationNs / 1000.0);
+        }
+        std::fputs("\n]}\n", file);
+
+        bool ok = !std::ferror(file);
+        ok = (std::fclose(file) == 0) && ok;
+        if (!ok) std::fprintf(stderr, "Profiler: write to %s failed\n", path.c_str());
+        return ok;
+    }
+
+private:
+    static void summarize(uint64_t now) {
+        ProfileFrameSummary& summary = s_summary;
+        summary.frame = s_frame;
+        summary.frameMs = (now - s_frameStart) / 1e6;
+        summary.zoneCount = 0;
+        for (const ProfileEvent& e : s_frameEvents) {
+            ProfileZoneSummary* zone = nullptr;
+            for (uint32_t i = 0; i < summary.zoneCount; i++) {
+                const char* name = summary.zones[i].name;
+                if (name == e.name || std::strcmp(name, e.name) == 0) {
+                    zone = &summary.zones[i];
+                    break;
+                }
+            }
+            if (!zone) {
+                if (summary.zoneCount >= ProfileFrameSummary::MAX_ZONES) continue;
+                zone = &summary.zones[summary.zoneCount++];
+                *zone = { e.name, 0.0, 0, e.depth, false };
+            }
+            zone->ms += e.durationNs / 1e6;
+            zone->calls++;
+            if (e.depth < zone->depth) zone->depth = e.depth;
+            if (e.thread == s_mainThread) zone->mainThread = true;
+        }
+    }
+
+    static std::atomic<bool> s_enabled;
+    static std::atomic<uint32_t> s_nextThread;
+    static const std::chrono::steady_clock::time_point s_epoch;
+    static const uint32_t s_mainThread;
+
+    static std::mutex s_mutex;
+    static std::vector<ProfileEvent> s_events;        // Current frame, guarded by s_mutex
+    static uint32_t s_dropped;
+
+    // Main thread only
+    static std::vector<ProfileEvent> s_frameEvents;   // Frame being summarized
+    static uint64_t s_frame;
+    static uint64_t s_frameStart;
+    static ProfileFrameSummary s_summary;
+    static GpuFrameTiming s_lastGpu;
+
+    static bool s_capturing;
+    static std::string s_capturePath;
+    static uint64_t s_captureFirst;
+    static uint32_t s_captureFrames;
+    static std::vector<ProfileEvent> s_capture;
+    static std::vector<uint64_t> s_captureFrameStarts;   // Per captured frame
+};
+
+inline std::atomic<bool> Profiler::s_enabled{true};
+inline std::atomic<uint32_t> Profiler::s_nextThread{0};
+inline const std::chrono::steady_clock::time_point Profiler::s_epoch = std::chrono::steady_clock::now();
+inline const uint32_t Profiler::s_mainThread = Profiler::threadIndex();   // Static init runs on the main thread
+inline std::mutex Profiler::s_mutex;
+inline std::vector<ProfileEvent> Profiler::s_events;
+inline uint32_t Profiler::s_dropped = 0;
+inline std::vector<ProfileEvent> Profiler::s_frameEvents;
+inline uint64_t Profiler::s_frame = 0;
+inline uint64_t Profiler::s_frameStart = 0;
+inline ProfileFrameSummary Profiler::s_summary;
+inline GpuFrameTiming Profiler::s_lastGpu;
+inline bool Profiler::s_capturing = false;
+inline std::string Profiler::s_capturePath;
+inline uint64_t Profiler::s_captureFirst = 0;
+inline uint32_t Profiler::s_captureFrames = 0;
+inline std::vector<ProfileEvent> Profiler::s_capture;
+inline std::vector<uint64_t> Profiler::s_captureFrameStarts;
+
+// ==================== Profile Zone ====================
+// Times its scope on the calling thread; no-op while the profiler is off
+class ProfileZone {
+public:
+    explicit ProfileZone(const char* name)
+        : m_name(Profiler::isEnabled() ? name : nullptr)
+        , m_depth(0)
+        , m_start(0)
+    {
+        if (!m_name) return;
+        m_depth = Profiler::threadDepth()++;
+        m_start = Profiler::nowNs();
+    }
+
+    ~ProfileZone() {
+        if (!m_name) return;
+        Profiler::threadDepth()--;
+        Profiler::record(m_name, m_start, Profiler::nowNs(), m_depth);
+    }
+
+    ProfileZone(const ProfileZone&) = delete;
+    ProfileZone& operator=(const ProfileZone&) = delete;
+
+private:
+    const char* m_name;
+    uint32_t m_depth;
+    uint64_t m_start;
+};
+
+#define PROFILE_CONCAT_INNER(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_INNER(a, b)
+#define PROFILE_ZONE(name) ProfileZone PROFILE_CONCAT(profileZone_, __LINE__)(name)
+
+#endif // PROFILER_H
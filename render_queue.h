@@ -0,0 +1,164 @@
+// render_queue.h - Sorted draw packets merged into instanced runs
+#ifndef RENDER_QUEUE_H
+#define RENDER_QUEUE_H
+
+#include "renderer.h"
+#include <cstdint>
+#include <cstring>
+#include <vector>
+#include <utility>
+
+// ==================== Render Queue ====================
+// Per frame: add() one packet per mesh to draw, sort(), then walk getRuns().
+// Packets are ordered by a 64-bit key and consecutive packets with the same
+// shader + mesh + texture become one run, i.e. one drawMeshInstanced call.
+//
+// Key layout (most significant first):
+//   [63:56] shader   [55:40] texture   [39:20] mesh   [19:0] depth
+//
+// Texture ranks above mesh because texture binds cost more than vertex buffer
+// binds. Depth sorts front to back within a run. Handles are truncated to
+// their field width, which only affects order: runs always compare the real
+// handles, so a collision costs an extra draw, never a wrong one.
+class RenderQueue {
+public:
+    struct Run {
+        uint32_t shaderHandle;
+        uint32_t meshHandle;
+        uint32_t textureHandle;
+        uint32_t firstInstance;   // Into getInstances()
+        uint32_t instanceCount;
+    };
+
+    struct Stats {
+        uint32_t packets;
+        uint32_t runs;              // Instanced draw calls
+        uint32_t textureChanges;
+        uint32_t meshChanges;
+    };
+
+    static uint64_t makeKey(uint32_t shader, uint32_t texture, uint32_t mesh, float depth) {
+        return ((uint64_t)(shader & 0xFFu) << 56) |
+               ((uint64_t)(texture & 0xFFFFu) << 40) |
+               ((uint64_t)(mesh & 0xFFFFFu) << 20) |
+               depthBits(depth);
+    }
+
+    void clear() {
+        m_packets.clear();
+        m_runs.clear();
+        m_instances.clear();
+    }
+
+    // 'depth' is the distance from the camera (smaller draws first)
+    void add(uint32_t shader, uint32_t mesh, uint32_t texture, float depth,
+             const Mat4& world, const Vec4& tint) {
+        Packet p;
+        p.key = makeKey(shader, texture, mesh, depth);
+        p.shaderHandle = shader;
+        p.meshHandle = mesh;
+        p.textureHandle = texture;
+        p.instance = { world, tint };
+        m_packets.push_back(p);
+    }
+
+    // Radix-sort the packets and build runs + the contiguous instance stream
+    void sort() {
+        uint32_t count = (uint32_t)m_packets.size();
+        m_order.resize(count);
+        for (uint32_t i = 0; i < count; i++) m_order[i] = { m_packets[i].key, i };
+        radixSort(m_order, m_scratch);
+
+        m_runs.clear();
+        m_instances.resize(count);
+        m_stats = {};
+        m_stats.packets = count;
+        for (uint32_t i = 0; i < count; i++) {
+            const Packet& p = m_packets[m_order[i].index];
+            m_instances[i] = p.instance;
+
+            if (!m_runs.empty()) {
+                Run& last = m_runs.back();
+                if (last.shaderHandle == p.shaderHandle && last.meshHandle == p.meshHandle &&
+                    last.textureHandle == p.textureHandle) {
+                    last.instanceCount++;
+                    continue;
+                }
+                if (last.textureHandle != p.textureHandle) m_stats.textureChanges++;
+                if (last.meshHandle != p.meshHandle) m_stats.meshChanges++;
+            }
+            m_runs.push_back({ p.shaderHandle, p.meshHandle, p.textureHandle, i, 1 });
+        }
+        m_stats.runs = (uint32_t)m_runs.size();
+    }
+
+    const std::vector<Run>& getRuns() const { return m_runs; }
+    const InstanceData* getInstances(const Run& run) const { return m_instances.data() + run.firstInstance; }
+    const Stats& getStats() const { return m_stats; }
+
+private:
+    struct Packet {
+        uint64_t key;
+        uint32_t shaderHandle;
+        uint32_t meshHandle;
+        uint32_t textureHandle;
+        InstanceData instance;
+    };
+
+    struct SortEntry {
+        uint64_t key;
+        uint32_t index;
+    };
+
+    // Non-negative floats order like their bit patterns; keep the top 20 bits
+    static uint64_t depthBits(float depth) {
+        if (!(depth > 0.0f)) return 0;  // Also catches NaN
+        uint32_t bits;
+        std::memcpy(&bits, &depth, sizeof(bits));
+        return (bits >> 11) & 0xFFFFFu;
+    }
+
+    // LSD radix sort, 8 bits per pass. Passes where every key has the same
+    // byte (typically the shader byte) are skipped.
+    static void radixSort(std::vector<SortEntry>& data, std::vector<SortEntry>& scratch) {
+        size_t n = data.size();
+        if (n < 2) return;
+        scratch.resize(n);
+
+        uint32_t histograms[8][256] = {};
+        for (const SortEntry& e : data) {
+            for (int pass = 0; pass < 8; pass++) {
+                histograms[pass][(e.key >> (pass * 8)) & 0xFF]++;
+            }
+        }
+
+        SortEntry* src = data.data();
+        SortEntry* dst = scratch.data();
+        for (int pass = 0; pass < 8; pass++) {
+            uint32_t* hist = histograms[pass];
+            if (hist[(src[0].key >> (pass * 8)) & 0xFF] == n) continue;
+
+            uint32_t offset = 0;
+            for (int b = 0; b < 256; b++) {
+                uint32_t c = hist[b];
+                hist[b] = offset;
+                offset += c;
+            }
+            for (size_t i = 0; i < n; i++) {
+                uint32_t b = (uint32_t)(src[i].key >> (pass * 8)) & 0xFF;
+                dst[hist[b]++] = src[i];
+            }
+            std::swap(src, dst);
+        }
+        if (src != data.data()) std::memcpy(data.data(), src, n * sizeof(SortEntry));
+    }
+
+    std::vector<Packet> m_packets;
+    std::vector<SortEntry> m_order;
+    std::vector<SortEntry> m_scratch;
+    std::vector<Run> m_runs;
+    std::vector<InstanceData> m_instances;
+    Stats m_stats = {};
+};
+
+#endif // RENDER_QUEUE_H
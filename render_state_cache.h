@@ -0,0 +1,83 @@
+// render_state_cache.h - Shadow copy of bound GPU state to filter redundant binds
+#ifndef RENDER_STATE_CACHE_H
+#define RENDER_STATE_CACHE_H
+
+#include "renderer.h"
+#include <cstdint>
+
+// ==================== Render State Cache ====================
+// Each backend keeps one of these next to its device context. Before a
+// bind, the backend asks set() whether the value differs from what the
+// slot last held; only then does it call the API. Values are whatever
+// identifies the binding in that API (GL object names, interface or GPU
+// virtual addresses, packed flags) widened to 64 bits.
+//
+// The shadow must be dropped with invalidate() whenever something outside
+// the cache touches the same state: resource creation that binds objects
+// on the side, another module issuing raw API calls, or (D3D12) a command
+// list reset. Backends also invalidate at beginFrame().
+class RenderStateCache {
+public:
+    static constexpr uint32_t MAX_UNITS = 8;   // Texture units / bind points per slot
+
+    RenderStateCache() { invalidate(); }
+
+    // True when 'value' differs from the shadow for (slot, unit), which
+    // then holds it; counts the bind as issued or skipped
+    bool set(RenderStateSlot slot, uint64_t value, uint32_t unit = 0) {
+        uint64_t& shadow = m_values[slot][unit];
+        if (shadow == value) {
+            m_frame.skipped[slot]++;
+            return false;
+        }
+        shadow = value;
+        m_frame.issued[slot]++;
+        return true;
+    }
+
+    // For state the caller compares itself (e.g. a whole constant block)
+    void count(RenderStateSlot slot, bool issued) {
+        if (issued) m_frame.issued[slot]++;
+        else m_frame.skipped[slot]++;
+    }
+
+    void countDraw(uint32_t indexCount, uint32_t instanceCount = 1) {
+        m_frame.drawCalls++;
+        m_frame.instances += instanceCount;
+        m_frame.triangles += (uint64_t)(indexCount / 3) * instanceCount;
+    }
+
+    // One indirect multi-draw, counted with its instances and triangles
+    // before GPU culling (the CPU never learns how many survive)
+    void countIndirectDraw(uint32_t instanceCount, uint64_t triangles) {
+        m_frame.drawCalls++;
+        m_frame.instances += instanceCount;
+        m_frame.triangles += triangles;
+    }
+
+    void invalidate(RenderStateSlot slot) {
+        for (uint32_t unit = 0; unit < MAX_UNITS; unit++) m_values[slot][unit] = UNKNOWN;
+    }
+
+    void invalidate() {
+        for (uint32_t slot = 0; slot < STATE_SLOT_COUNT; slot++) invalidate((RenderStateSlot)slot);
+    }
+
+    // Start counting a new frame; getStats() then reports the one just ended
+    void beginFrame() {
+        m_lastFrame = m_frame;
+        m_frame = RenderStateStats();
+        invalidate();
+    }
+
+    const RenderStateStats& getStats() const { return m_lastFrame; }
+
+private:
+    static constexpr uint64_t UNKNOWN = ~0ull;   // Never equal to a real binding
+
+    uint64_t m_values[STATE_SLOT_COUNT][MAX_UNITS];
+    RenderStateStats m_frame;
+    RenderStateStats m_lastFrame;
+};
+
+#endif // RENDER_STATE_CACHE_H
@@ -3,16 +3,137 @@
 #define RENDERER_H
 
 #include <cstdint>
+#include <cstring>
 #include "math_utils.h"
 
 // Forward declarations for platform types
 struct GLFWwindow;
+class JobSystem;
 
 // ==================== Instance Data ====================
+// Streamed verbatim into the per-instance vertex buffer (80 bytes, tightly packed)
 struct InstanceData {
     Mat4 worldMatrix;    // Per-instance world transform
     Vec4 colorTint;      // Per-instance color tint (r, g, b, intensity)
 };
+static_assert(sizeof(InstanceData) == 80, "InstanceData layout must match instance input layouts");
+
+// One drawMeshInstanced() call, for submitting many at once
+struct InstancedDraw {
+    uint32_t meshHandle;
+    uint32_t textureHandle;
+    const InstanceData* instances;
+    uint32_t instanceCount;
+};
+
+// ==================== Draw Constants ====================
+// Per-draw parameters of the default shader, uploaded as one block per draw
+// (std140 uniform block "DrawConstants" on OpenGL, cbuffer b0 on D3D).
+// Matrices are column-major like Mat4; D3D backends transpose on upload.
+// useTexture, textureLayer, instanced and packedVertex are overwritten by
+// each draw call from its texture handle, draw type and mesh format.
+struct DrawConstants {
+    Mat4  mvp;           // Full MVP for drawMesh, view-projection for drawMeshInstanced
+    Mat4  world;
+    Vec3  lightDir;
+    float useTexture;    // 0 = vertex color, 1 = 2D texture, 2 = layer of a texture array
+    float useNormalMap;
+    float instanced;
+    float packedVertex;
+    float textureLayer;  // Array layer sampled when useTexture = 2
+};
+static_assert(sizeof(DrawConstants) == 160, "DrawConstants layout must match the shader constant blocks");
+
+// Field of DrawConstants named by a default-shader uniform, or -1. Lets the
+// name-based setters write into the constant block on every backend.
+enum DrawConstantField {
+    DRAW_CONSTANT_MVP,
+    DRAW_CONSTANT_WORLD,
+    DRAW_CONSTANT_LIGHT_DIR,
+    DRAW_CONSTANT_USE_TEXTURE,
+    DRAW_CONSTANT_USE_NORMAL_MAP,
+    DRAW_CONSTANT_FIELD_COUNT
+};
+
+inline int findDrawConstantField(const char* name) {
+    static const char* const names[DRAW_CONSTANT_FIELD_COUNT] = {
+        "uMVP", "uWorld", "uLightDir", "uUseTexture", "uUseNormalMap"
+    };
+    for (int i = 0; i < DRAW_CONSTANT_FIELD_COUNT; i++) {
+        if (std::strcmp(name, names[i]) == 0) return i;
+    }
+    return -1;
+}
+
+inline void setDrawConstantMat4(DrawConstants& c, int field, const Mat4& m) {
+    if (field == DRAW_CONSTANT_MVP) c.mvp = m;
+    else if (field == DRAW_CONSTANT_WORLD) c.world = m;
+}
+
+inline void setDrawConstantVec3(DrawConstants& c, int field, const Vec3& v) {
+    if (field == DRAW_CONSTANT_LIGHT_DIR) c.lightDir = v;
+}
+
+inline void setDrawConstantInt(DrawConstants& c, int field, int value) {
+    if (field == DRAW_CONSTANT_USE_TEXTURE) c.useTexture = (float)value;
+    else if (field == DRAW_CONSTANT_USE_NORMAL_MAP) c.useNormalMap = (float)value;
+}
+
+// ==================== Render State Stats ====================
+// Binds issued vs. filtered as redundant by a backend's RenderStateCache
+// over one frame, per kind of state
+enum RenderStateSlot {
+    STATE_SHADER,        // Program, or shaders + root signature
+    STATE_PIPELINE,      // Input layout / PSO / primitive topology
+    STATE_VERTEX_INPUT,  // VAO, or vertex and index buffers
+    STATE_TEXTURE,       // One bind point per texture unit
+    STATE_CONSTANTS,     // DrawConstants uploads and constant buffer binds
+    STATE_RASTER,        // Depth test, culling
+    STATE_SLOT_COUNT
+};
+
+struct RenderStateStats {
+    uint32_t issued[STATE_SLOT_COUNT] = {};
+    uint32_t skipped[STATE_SLOT_COUNT] = {};
+    
+    // Draws submitted through the backend, counted next to the binds
+    uint32_t drawCalls = 0;
+    uint32_t instances = 0;     // 1 per non-instanced draw
+    uint64_t triangles = 0;     // Including every instance
+
+    uint32_t totalIssued() const {
+        uint32_t total = 0;
+        for (uint32_t n : issued) total += n;
+        return total;
+    }
+    uint32_t totalSkipped() const {
+        uint32_t total = 0;
+        for (uint32_t n : skipped) total += n;
+        return total;
+    }
+};
+
+// ==================== GPU Timing ====================
+static constexpr uint32_t MAX_GPU_ZONES = 16;   // Per frame; further zones are not timed
+
+struct GpuZoneTiming {
+    const char* name;
+    double startMs;      // From the frame's first timestamp
+    double durationMs;
+    uint32_t depth;      // Nesting level of beginGpuZone()
+};
+
+struct GpuFrameTiming {
+    uint64_t frame = 0;      // Renderer beginFrame() count it was recorded in; 0 = none yet
+    double frameMs = 0.0;    // beginFrame() to endFrame() on the GPU timeline
+    uint32_t zoneCount = 0;
+    GpuZoneTiming zones[MAX_GPU_ZONES];
+};
+
+// Resolved once per shader by getUniformHandle(); setting INVALID_UNIFORM
+// (no such uniform) is a no-op
+typedef int32_t UniformHandle;
+static constexpr UniformHandle INVALID_UNIFORM = -1;
 
 // ==================== Vertex Format ====================
 struct Vertex {
@@ -24,6 +145,71 @@ struct Vertex {
     float bx, by, bz;    // bitangent (for normal mapping)
 };
 
+// Compact 32-byte layout (vs 72 for Vertex). Normal and tangent are
+// octahedral-encoded; the bitangent is rebuilt as cross(N, T) * sign.
+struct PackedVertex {
+    float    px, py, pz;     // position
+    int16_t  normal[2];      // octahedral normal, snorm16
+    int16_t  tangent[4];     // octahedral tangent xy, bitangent sign (+/-32767), unused
+    uint16_t u, v;           // texture coordinates, half floats
+    uint8_t  r, g, b, a;     // color, unorm8
+};
+static_assert(sizeof(PackedVertex) == 32, "PackedVertex layout must match packed input layouts");
+
+inline PackedVertex packVertex(const Vertex& src) {
+    PackedVertex dst;
+    dst.px = src.px; dst.py = src.py; dst.pz = src.pz;
+
+    Vec3 n = v3_norm({src.nx, src.ny, src.nz});
+    Vec3 t = v3_norm({src.tx, src.ty, src.tz});
+    float ox, oy;
+    v3_octEncode(n, ox, oy);
+    dst.normal[0] = packSnorm16(ox);
+    dst.normal[1] = packSnorm16(oy);
+    v3_octEncode(t, ox, oy);
+    dst.tangent[0] = packSnorm16(ox);
+    dst.tangent[1] = packSnorm16(oy);
+    // Mirrored UVs flip the bitangent relative to cross(N, T)
+    float handedness = v3_dot(v3_cross(n, t), {src.bx, src.by, src.bz});
+    dst.tangent[2] = handedness < 0.0f ? -32767 : 32767;
+    dst.tangent[3] = 0;
+
+    dst.u = floatToHalf(src.u);
+    dst.v = floatToHalf(src.v);
+
+    auto unorm8 = [](float c) {
+        return (uint8_t)std::lround((std::max)(0.0f, (std::min)(1.0f, c)) * 255.0f);
+    };
+    dst.r = unorm8(src.r); dst.g = unorm8(src.g);
+    dst.b = unorm8(src.b); dst.a = unorm8(src.a);
+    return dst;
+}
+
+// 32-bit index input is stored as 16-bit when every vertex is addressable
+// with 16 bits; backends use this to pick the index format.
+inline bool indicesFit16(uint32_t vertexCount) { return vertexCount <= 65536u; }
+
+inline void narrowIndices(const uint32_t* src, uint32_t count, uint16_t* dst) {
+    for (uint32_t i = 0; i < count; i++) dst[i] = (uint16_t)src[i];
+}
+
+// ==================== Compressed Textures ====================
+enum class CompressedFormat {
+    BC1,  // DXT1: RGB + 1-bit alpha, 8 bytes per 4x4 block
+    BC2,  // DXT3: RGB + explicit 4-bit alpha, 16 bytes per block
+    BC3,  // DXT5: RGB + interpolated alpha, 16 bytes per block
+};
+
+// One mip level of block-compressed data, tightly packed block rows
+struct CompressedMip {
+    const uint8_t* data;
+    uint32_t size;       // Bytes in this level
+    uint32_t rowPitch;   // Bytes per row of 4x4 blocks
+    uint32_t rows;       // Rows of blocks
+    int width;           // Texel dimensions
+    int height;
+};
+
 // ==================== Renderer Interface ====================
 class IRenderer {
 public:
@@ -37,6 +223,24 @@ public:
     virtual void beginFrame() = 0;
     virtual void endFrame() = 0;
     virtual void setClearColor(float r, float g, float b, float a) = 0;
+    // Wait for vertical blank when presenting (on by default)
+    virtual void setVSync(bool enabled) = 0;
+    // Low-latency presentation (call before initialize): at most one frame
+    // queued for display, so input sampled after waitForFrameSlot() reaches
+    // the screen on the next refresh instead of several frames later
+    virtual void setLowLatency(bool enabled) = 0;
+    // Let presents that miss the refresh tear instead of waiting for the
+    // next one, which variable-refresh displays need in a window (call
+    // before initialize; ignored where unsupported)
+    virtual void setAllowTearing(bool enabled) = 0;
+    // Blocks until the swap chain can take another frame. Call before
+    // sampling the frame's input; returns at once outside low-latency mode.
+    virtual void waitForFrameSlot() = 0;
+    // Only one thread may use a renderer at a time. Before handing it to
+    // another thread, the current one calls makeCurrent(false); the new one
+    // then calls makeCurrent(true) before its first call. GL moves its
+    // context; D3D has nothing to move.
+    virtual void makeCurrent(bool current) = 0;
     
     // Viewport
     virtual void setViewport(int width, int height) = 0;
@@ -44,32 +248,99 @@ public:
     // Mesh creation (with texture coordinates)
     virtual uint32_t createMesh(const Vertex* vertices, uint32_t vertexCount,
                                const uint16_t* indices, uint32_t indexCount) = 0;
+    // 32-bit indices for meshes with more than 65536 vertices
+    virtual uint32_t createMesh(const Vertex* vertices, uint32_t vertexCount,
+                               const uint32_t* indices, uint32_t indexCount) = 0;
+    // Compact vertex format; see PackedVertex
+    virtual uint32_t createMesh(const PackedVertex* vertices, uint32_t vertexCount,
+                               const uint32_t* indices, uint32_t indexCount) = 0;
     virtual void destroyMesh(uint32_t meshHandle) = 0;
+    // False for unknown handles and, on backends that upload asynchronously
+    // (D3D12), until the mesh's upload has landed; drawing it before then
+    // draws nothing
+    virtual bool isMeshReady(uint32_t meshHandle) const = 0;
     
     // Texture support
     virtual uint32_t createTexture(const char* filepath) = 0;
     virtual uint32_t createTextureFromData(const uint8_t* data, int width, int height, int channels) = 0;
+    // Upload BC data as-is with its mip chain. Returns 0 if the format or
+    // dimensions are unsupported, in which case callers decode on the CPU.
+    virtual uint32_t createCompressedTexture(CompressedFormat format, const CompressedMip* mips, uint32_t mipCount) = 0;
     virtual void destroyTexture(uint32_t textureHandle) = 0;
+    // Replace a texture's image in place; the handle stays valid (used by
+    // TextureCache to swap a streamed mip tail for the full-resolution image)
+    virtual bool updateTexture(uint32_t textureHandle, const uint8_t* data, int width, int height, int channels) = 0;
     virtual void bindTextureToUnit(uint32_t textureHandle, int unit) = 0;  // Bind texture to specific unit
+    // Same-size RGBA8 images as the layers of one array texture, with a full
+    // mip chain generated on the GPU. Writes a handle per layer to
+    // 'layerHandles': a layer handle draws like any texture handle (the
+    // default shader samples it from "uTextureArray"), and draws using
+    // layers of one array keep the array bound. Returns the array's own
+    // handle, which destroyTexture() takes to free it with all its layers,
+    // or 0 on failure.
+    virtual uint32_t createTextureArray(const uint8_t* const* layers, uint32_t layerCount,
+                                        int width, int height, uint32_t* layerHandles) = 0;
     
     // Shader/material
     virtual uint32_t createShader(const char* vertexSource, const char* fragmentSource) = 0;
     virtual void destroyShader(uint32_t shaderHandle) = 0;
     virtual void useShader(uint32_t shaderHandle) = 0;
     
-    // Uniforms
+    // Uniforms by name (looked up on every call; fine for setup code)
     virtual void setUniformMat4(uint32_t shaderHandle, const char* name, const Mat4& matrix) = 0;
     virtual void setUniformVec3(uint32_t shaderHandle, const char* name, const Vec3& vec) = 0;
     virtual void setUniformInt(uint32_t shaderHandle, const char* name, int value) = 0;
     
+    // Uniforms by handle: resolve once after createShader, then set without
+    // any string work. Handles are only valid for the shader they came from.
+    virtual UniformHandle getUniformHandle(uint32_t shaderHandle, const char* name) = 0;
+    virtual void setUniformMat4(uint32_t shaderHandle, UniformHandle uniform, const Mat4& matrix) = 0;
+    virtual void setUniformVec3(uint32_t shaderHandle, UniformHandle uniform, const Vec3& vec) = 0;
+    virtual void setUniformInt(uint32_t shaderHandle, UniformHandle uniform, int value) = 0;
+    
+    // Replace the shader's whole per-draw block; each following draw uploads
+    // it with a single buffer write
+    virtual void setDrawConstants(uint32_t shaderHandle, const DrawConstants& constants) = 0;
+    
     // Drawing
     virtual void drawMesh(uint32_t meshHandle, uint32_t textureHandle = 0) = 0;
+    // One hardware-instanced draw for all instances. Expects DrawConstants::mvp
+    // ("uMVP") to hold the view-projection matrix; world/tint are streamed per instance.
     virtual void drawMeshInstanced(uint32_t meshHandle, uint32_t textureHandle,
                                    const InstanceData* instances, uint32_t instanceCount) = 0;
+    // Same as calling drawMeshInstanced() for each entry in order. Backends
+    // that can record commands on several threads (D3D12) spread the draws
+    // over 'jobs' when given one; the others record them here. Instance data
+    // must stay valid until the call returns.
+    virtual void drawInstancedBatch(const InstancedDraw* draws, uint32_t drawCount, JobSystem* jobs) = 0;
+    // GPU culling: draws the batch like drawInstancedBatch(), minus every
+    // instance whose mesh bounding sphere (taken at createMesh), moved by
+    // the instance's world matrix, is outside 'frustum'. A compute pass does
+    // the test and compaction, and the survivors are drawn with indirect
+    // multi-draws, so the CPU cost does not grow with the instance count
+    // beyond the copy. Backends without support (supportsGpuCulling() false)
+    // draw every instance.
+    virtual bool supportsGpuCulling() const = 0;
+    virtual void drawInstancedCulled(const InstancedDraw* draws, uint32_t drawCount, const Frustum& frustum) = 0;
     
     // State
     virtual void setDepthTest(bool enable) = 0;
     virtual void setCulling(bool enable) = 0;
+    
+    // Redundant-state filtering. Binds are skipped when the backend's shadow
+    // copy says they are already in place; call invalidateStateCache() after
+    // issuing raw API calls outside the renderer (e.g. the GL text renderer).
+    virtual void invalidateStateCache() = 0;
+    // Bind and draw counters for the last completed frame
+    virtual const RenderStateStats& getStateStats() const = 0;
+    
+    // GPU timing. A zone brackets the commands recorded between its begin and
+    // end with timestamp queries; zones nest. Names must outlive the frame
+    // (string literals). Results arrive a few frames late: getGpuTiming()
+    // holds the newest frame whose queries have resolved.
+    virtual void beginGpuZone(const char* name) = 0;
+    virtual void endGpuZone() = 0;
+    virtual const GpuFrameTiming& getGpuTiming() const = 0;
 };
 
 // ==================== Renderer Factory ====================
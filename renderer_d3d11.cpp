@@ -10,70 +10,73 @@
 #include <GLFW/glfw3native.h>
 
 #include "renderer.h"
+#include "render_state_cache.h"
+#include "gpu_timer.h"
+#include "geometry_pool.h"
+#include "shader_cache.h"
+#include "debug.h"
 
 #include <d3d11.h>
 #include <dxgi1_6.h>
 #include <d3dcompiler.h>
-#include <DirectXMath.h>
 #include <wrl/client.h>
 
 #include <cstdio>
 #include <string>
+#include <vector>
 #include <unordered_map>
 #include <cstring>
 
 #include "stb_image.h"
+#include "dds_loader.h"
 
 #pragma comment(lib, "d3d11.lib")
 #pragma comment(lib, "dxgi.lib")
 #pragma comment(lib, "d3dcompiler.lib")
 
 using Microsoft::WRL::ComPtr;
-using namespace DirectX;
 
 // ==================== D3D11 Texture ====================
+// A texture array is one entry plus one entry per layer sharing its SRV;
+// destroying the array removes the layer entries too
 struct D3D11Texture {
     ComPtr<ID3D11Texture2D> texture;
     ComPtr<ID3D11ShaderResourceView> srv;
     int width;
     int height;
+    bool isArray = false;                // Texture2DArray SRV, bound at t2
+    UINT layer = 0;
+    uint32_t arrayHandle = 0;            // Set on layer entries
+    std::vector<uint32_t> layerHandles;  // Set on the array entry
 };
 
 // ==================== D3D11 Mesh ====================
+// A range of a geometry pool block; the buffers are the block's
 struct D3D11Mesh {
     ComPtr<ID3D11Buffer> vertexBuffer;
     ComPtr<ID3D11Buffer> indexBuffer;
+    GeometryRange range;
     uint32_t indexCount;
+    DXGI_FORMAT indexFormat;  // R16_UINT or R32_UINT
+    UINT stride;              // sizeof(Vertex) or sizeof(PackedVertex)
+    bool packed;
 };
 
-// ==================== Constant Buffer Structure ====================
-struct CBData {
-    XMMATRIX mvp;       // transposed  — 64 bytes
-    XMMATRIX world;     // transposed  — 64 bytes
-    XMFLOAT3 lightDir;                // 12 bytes
-    float    useTexture;              //  4 bytes  (1.0 = textured, 0.0 = vertex colour)
-    float    useNormalMap;            //  4 bytes  (1.0 = use normal map, 0.0 = vertex normal)
-    XMFLOAT3 padding;                 // 12 bytes (alignment)
+struct D3D11GeometryBlock {
+    ComPtr<ID3D11Buffer> vertexBuffer;
+    ComPtr<ID3D11Buffer> indexBuffer;
 };
 
-// Helper to convert Mat4 to XMMATRIX
-static XMMATRIX Mat4ToXM(const Mat4& m) {
-    return XMMATRIX(
-        m.m[0], m.m[1], m.m[2], m.m[3],
-        m.m[4], m.m[5], m.m[6], m.m[7],
-        m.m[8], m.m[9], m.m[10], m.m[11],
-        m.m[12], m.m[13], m.m[14], m.m[15]
-    );
-}
-
 // ==================== D3D11 Shader ====================
 struct D3D11Shader {
     ComPtr<ID3D11VertexShader> vertexShader;
     ComPtr<ID3D11PixelShader> pixelShader;
     ComPtr<ID3D11InputLayout> inputLayout;
-    ComPtr<ID3D11Buffer> constantBuffer;
-    std::unordered_map<std::string, int> uniformOffsets; // Not used in simple impl
-    CBData cbData; // Store constant buffer data for batch update
+    ComPtr<ID3D11InputLayout> packedInputLayout;  // PackedVertex stream in slot 0
+    ComPtr<ID3D11Buffer> constantBuffer;   // cbuffer CB (b0): DrawConstants, matrices transposed
+    DrawConstants drawConstants;           // Uploaded in one Map per draw
+    DrawConstants uploadedConstants;       // What constantBuffer holds (as written, transposed)
+    bool hasUploadedConstants = false;
 };
 
 // ==================== D3D11 Renderer ====================
@@ -82,7 +85,7 @@ private:
     HWND m_hwnd;
     ComPtr<ID3D11Device> m_device;
     ComPtr<ID3D11DeviceContext> m_context;
-    ComPtr<IDXGISwapChain> m_swapChain;
+    ComPtr<IDXGISwapChain2> m_swapChain;
     ComPtr<ID3D11RenderTargetView> m_rtv;
     ComPtr<ID3D11Texture2D> m_depthTexture;
     ComPtr<ID3D11DepthStencilView> m_dsv;
@@ -91,8 +94,12 @@ private:
     ComPtr<ID3D11SamplerState> m_samplerState;
     
     std::unordered_map<uint32_t, D3D11Mesh> m_meshes;
+    GeometryPool m_geometryPool;                     // Sub-allocates every mesh
+    std::vector<D3D11GeometryBlock> m_geometryBlocks;   // Parallel to the pool's blocks
     std::unordered_map<uint32_t, D3D11Shader> m_shaders;
     std::unordered_map<uint32_t, D3D11Texture> m_textures;
+    uint32_t m_shaderCacheHits = 0;   // Stages loaded from ShaderCache
+    uint32_t m_shaderCompiles = 0;
     uint32_t m_nextMeshHandle;
     uint32_t m_nextShaderHandle;
     uint32_t m_nextTextureHandle;
@@ -102,20 +109,140 @@ private:
     int m_height;
     
     float m_clearColor[4];
-    
-    // Store view-projection for instanced rendering
-    XMMATRIX m_viewProj;
-    bool m_hasViewProj;
-    bool m_inInstancedDraw;
+    UINT m_syncInterval;   // Present() interval: 1 = vsync, 0 = immediate
+
+    // Low latency: the swap chain queues one frame and signals
+    // m_frameLatencyWaitable when it can take the next
+    bool m_lowLatency;
+    bool m_allowTearing;       // Requested
+    bool m_tearingSupported;   // DXGI_FEATURE_PRESENT_ALLOW_TEARING, and requested
+    UINT m_swapChainFlags;     // Repeated on ResizeBuffers()
+    HANDLE m_frameLatencyWaitable;
     
     // Store normal map binding for texture slot 1
     uint32_t m_boundNormalMap;
+    
+    // Dynamic per-instance vertex buffer (input slot 1), used as a ring:
+    // NO_OVERWRITE appends within a frame, DISCARD when it wraps.
+    static const UINT INITIAL_INSTANCE_CAPACITY = 1024;
+    ComPtr<ID3D11Buffer> m_instanceBuffer;
+    UINT m_instanceCapacity;  // In instances
+    UINT m_instanceCursor;    // Next free instance slot
+    
+    // Shadow of IA, shader, SRV, constant buffer and OM/RS bindings. Keys are
+    // interface pointers, which stay unique while bound (the context holds a
+    // reference). Depth/raster states are created once per setting.
+    RenderStateCache m_stateCache;
+    ComPtr<ID3D11DepthStencilState> m_depthStates[2];   // [enabled]
+    ComPtr<ID3D11RasterizerState>   m_rasterStates[2];  // [culling]
+    
+    // Timestamp queries, read back a few frames later. Each ring slot is
+    // bracketed by a disjoint query that supplies the tick frequency.
+    GpuTimerRing m_gpuTimer;
+    ComPtr<ID3D11Query> m_timestampQueries[GpuTimerRing::QUERY_COUNT];
+    ComPtr<ID3D11Query> m_disjointQueries[GpuTimerRing::FRAMES];
+    bool m_hasTimestampQueries = false;
 
     // Helper to get HWND from GLFWwindow
     HWND getHWND(GLFWwindow* window) {
         return glfwGetWin32Window(window);
     }
 
+    // Timing is optional: on failure the renderer runs without it
+    bool createTimestampQueries() {
+        D3D11_QUERY_DESC desc{};
+        desc.Query = D3D11_QUERY_TIMESTAMP;
+        for (ComPtr<ID3D11Query>& query : m_timestampQueries) {
+            if (FAILED(m_device->CreateQuery(&desc, query.GetAddressOf()))) return false;
+        }
+        desc.Query = D3D11_QUERY_TIMESTAMP_DISJOINT;
+        for (ComPtr<ID3D11Query>& query : m_disjointQueries) {
+            if (FAILED(m_device->CreateQuery(&desc, query.GetAddressOf()))) return false;
+        }
+        return true;
+    }
+
+    void writeTimestamp(uint32_t query) {
+        if (m_hasTimestampQueries && query != GpuTimerRing::NO_QUERY) {
+            m_context->End(m_timestampQueries[query].Get());
+        }
+    }
+
+    // Never flushes; a slot is ready once its disjoint query is
+    void resolveTimestamps() {
+        if (!m_hasTimestampQueries) return;
+        int slot;
+        while ((slot = m_gpuTimer.oldestPending()) >= 0) {
+            D3D11_QUERY_DATA_TIMESTAMP_DISJOINT disjoint{};
+            if (m_context->GetData(m_disjointQueries[slot].Get(), &disjoint, sizeof(disjoint),
+                                   D3D11_ASYNC_GETDATA_DONOTFLUSH) != S_OK) {
+                break;
+            }
+            if (disjoint.Disjoint) {
+                m_gpuTimer.discard((uint32_t)slot);
+                continue;
+            }
+            m_gpuTimer.resolve((uint32_t)slot, [this](uint32_t query) {
+                UINT64 ticks = 0;
+                m_context->GetData(m_timestampQueries[query].Get(), &ticks, sizeof(ticks),
+                                   D3D11_ASYNC_GETDATA_DONOTFLUSH);
+                return (uint64_t)ticks;
+            }, (double)disjoint.Frequency);
+        }
+    }
+
+    // Flip model, which the frame latency waitable object and tearing both
+    // need. The factory is the one that created the device.
+    bool createSwapChain() {
+        ComPtr<IDXGIDevice> dxgiDevice;
+        ComPtr<IDXGIAdapter> adapter;
+        ComPtr<IDXGIFactory2> factory;
+        if (FAILED(m_device.As(&dxgiDevice)) || FAILED(dxgiDevice->GetAdapter(adapter.GetAddressOf())) ||
+            FAILED(adapter->GetParent(IID_PPV_ARGS(&factory)))) {
+            std::fprintf(stderr, "D3D11: Failed to get the DXGI factory\n");
+            return false;
+        }
+
+        ComPtr<IDXGIFactory5> factory5;
+        BOOL tearing = FALSE;
+        if (m_allowTearing && SUCCEEDED(factory.As(&factory5)) &&
+            SUCCEEDED(factory5->CheckFeatureSupport(DXGI_FEATURE_PRESENT_ALLOW_TEARING, &tearing, sizeof(tearing)))) {
+            m_tearingSupported = tearing == TRUE;
+        }
+
+        m_swapChainFlags = 0;
+        if (m_lowLatency) m_swapChainFlags |= DXGI_SWAP_CHAIN_FLAG_FRAME_LATENCY_WAITABLE_OBJECT;
+        if (m_tearingSupported) m_swapChainFlags |= DXGI_SWAP_CHAIN_FLAG_ALLOW_TEARING;
+
+        DXGI_SWAP_CHAIN_DESC1 sd{};
+        sd.Width = m_width;
+        sd.Height = m_height;
+        sd.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
+        sd.SampleDesc.Count = 1;
+        sd.BufferUsage = DXGI_USAGE_RENDER_TARGET_OUTPUT;
+        sd.BufferCount = 2;
+        sd.SwapEffect = DXGI_SWAP_EFFECT_FLIP_DISCARD;
+        sd.Flags = m_swapChainFlags;
+
+        ComPtr<IDXGISwapChain1> sc1;
+        HRESULT hr = factory->CreateSwapChainForHwnd(m_device.Get(), m_hwnd, &sd, nullptr, nullptr,
+                                                     sc1.GetAddressOf());
+        if (FAILED(hr) || FAILED(sc1.As(&m_swapChain))) {
+            std::fprintf(stderr, "Failed to create D3D11 swap chain\n");
+            return false;
+        }
+        // GLFW handles fullscreen; DXGI's Alt+Enter would fight it
+        factory->MakeWindowAssociation(m_hwnd, DXGI_MWA_NO_ALT_ENTER);
+
+        if (m_lowLatency) {
+            m_swapChain->SetMaximumFrameLatency(1);
+            m_frameLatencyWaitable = m_swapChain->GetFrameLatencyWaitableObject();
+        }
+        std::printf("Present: %s, tearing %s\n", m_lowLatency ? "low latency (1 frame queued)" : "default queue",
+                    m_tearingSupported ? "allowed" : (m_allowTearing ? "not supported" : "off"));
+        return true;
+    }
+
     void createRTVAndDSV(UINT w, UINT h) {
         // Release old views
         m_rtv.Reset();
@@ -174,16 +301,227 @@ private:
         m_context->RSSetViewports(1, &vp);
     }
 
+    bool createInstanceBuffer(UINT capacity) {
+        D3D11_BUFFER_DESC desc{};
+        desc.Usage = D3D11_USAGE_DYNAMIC;
+        desc.ByteWidth = capacity * sizeof(InstanceData);
+        desc.BindFlags = D3D11_BIND_VERTEX_BUFFER;
+        desc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+
+        ComPtr<ID3D11Buffer> buffer;
+        HRESULT hr = m_device->CreateBuffer(&desc, nullptr, buffer.GetAddressOf());
+        if (FAILED(hr)) {
+            std::fprintf(stderr, "Failed to create instance buffer (%u instances)\n", capacity);
+            return false;
+        }
+        m_instanceBuffer = buffer;
+        m_instanceCapacity = capacity;
+        m_instanceCursor = 0;
+        return true;
+    }
+
+    // 32-bit input indices are narrowed when the mesh fits in 16 bits
+    uint32_t createMesh32(const void* vertices, uint32_t vertexCount, UINT stride, bool packed,
+                          const uint32_t* indices, uint32_t indexCount) {
+        if (indicesFit16(vertexCount)) {
+            std::vector<uint16_t> narrowed(indexCount);
+            narrowIndices(indices, indexCount, narrowed.data());
+            return createMeshBuffers(vertices, vertexCount, stride, packed,
+                                     narrowed.data(), indexCount, DXGI_FORMAT_R16_UINT);
+        }
+        return createMeshBuffers(vertices, vertexCount, stride, packed,
+                                 indices, indexCount, DXGI_FORMAT_R32_UINT);
+    }
+
+    // Copies into a range of a pool block, creating the block's buffers
+    // first if the pool had no room in one of this format
+    uint32_t createMeshBuffers(const void* vertices, uint32_t vertexCount, UINT stride, bool packed,
+                               const void* indices, uint32_t indexCount, DXGI_FORMAT indexFormat) {
+        if (vertexCount == 0 || indexCount == 0) return 0;
+        UINT indexSize = (indexFormat == DXGI_FORMAT_R32_UINT) ? sizeof(uint32_t) : sizeof(uint16_t);
+
+        bool newBlock = false;
+        D3D11Mesh mesh;
+        mesh.range = m_geometryPool.allocate(stride, indexSize, vertexCount, indexCount, newBlock);
+        if (!createGeometryBlock(mesh.range.block)) {
+            m_geometryPool.free(mesh.range);
+            return 0;
+        }
+        const D3D11GeometryBlock& block = m_geometryBlocks[mesh.range.block];
+        mesh.vertexBuffer = block.vertexBuffer;
+        mesh.indexBuffer = block.indexBuffer;
+        mesh.indexCount = indexCount;
+        mesh.indexFormat = indexFormat;
+        mesh.stride = stride;
+        mesh.packed = packed;
+
+        D3D11_BOX box{};
+        box.top = 0;
+        box.bottom = 1;
+        box.front = 0;
+        box.back = 1;
+        box.left = mesh.range.baseVertex * stride;
+        box.right = box.left + vertexCount * stride;
+        m_context->UpdateSubresource(block.vertexBuffer.Get(), 0, &box, vertices, 0, 0);
+
+        box.left = mesh.range.firstIndex * indexSize;
+        box.right = box.left + indexCount * indexSize;
+        m_context->UpdateSubresource(block.indexBuffer.Get(), 0, &box, indices, 0, 0);
+
+        uint32_t handle = m_nextMeshHandle++;
+        m_meshes[handle] = mesh;
+        return handle;
+    }
+
+    // Buffers of a pool block, created on its first mesh. A block whose
+    // creation failed is retried by the next mesh placed in it.
+    bool createGeometryBlock(uint32_t index) {
+        if (index >= m_geometryBlocks.size()) m_geometryBlocks.resize(index + 1);
+        D3D11GeometryBlock& block = m_geometryBlocks[index];
+        if (block.vertexBuffer && block.indexBuffer) return true;
+
+        const GeometryPool::Block& poolBlock = m_geometryPool.block(index);
+        D3D11_BUFFER_DESC vbDesc{};
+        vbDesc.Usage = D3D11_USAGE_DEFAULT;
+        vbDesc.ByteWidth = poolBlock.vertices.capacity() * poolBlock.vertexStride;
+        vbDesc.BindFlags = D3D11_BIND_VERTEX_BUFFER;
+        HRESULT hr = m_device->CreateBuffer(&vbDesc, nullptr, block.vertexBuffer.ReleaseAndGetAddressOf());
+        if (FAILED(hr)) {
+            std::fprintf(stderr, "Failed to create vertex buffer\n");
+            return false;
+        }
+
+        D3D11_BUFFER_DESC ibDesc{};
+        ibDesc.Usage = D3D11_USAGE_DEFAULT;
+        ibDesc.ByteWidth = poolBlock.indices.capacity() * poolBlock.indexSize;
+        ibDesc.BindFlags = D3D11_BIND_INDEX_BUFFER;
+        hr = m_device->CreateBuffer(&ibDesc, nullptr, block.indexBuffer.ReleaseAndGetAddressOf());
+        if (FAILED(hr)) {
+            std::fprintf(stderr, "Failed to create index buffer\n");
+            block.vertexBuffer.Reset();
+            return false;
+        }
+        return true;
+    }
+
+    // Bind the per-draw constant buffer and the diffuse/normal SRVs; every
+    // bind goes through m_stateCache
+    void bindDrawState(const D3D11Mesh& mesh, uint32_t textureHandle, bool instanced) {
+        const D3D11Texture* texture = findTexture(textureHandle);
+        bool layered = texture && texture->isArray;
+        auto shaderIt = m_shaders.find(m_currentShader);
+        if (shaderIt != m_shaders.end()) {
+            D3D11Shader& shader = shaderIt->second;
+            setInputLayout(mesh.packed ? shader.packedInputLayout.Get() : shader.inputLayout.Get());
+            
+            // The shader's constants plus this draw's flags (matrices
+            // transposed for HLSL), written in one go
+            DrawConstants constants = shader.drawConstants;
+            mat4_transposeBatch(&constants.mvp, &constants.mvp, 2);   // mvp, then world
+            constants.useTexture = layered ? 2.0f : ((textureHandle > 0) ? 1.0f : 0.0f);
+            constants.textureLayer = layered ? (float)texture->layer : 0.0f;
+            constants.instanced = instanced ? 1.0f : 0.0f;
+            constants.packedVertex = mesh.packed ? 1.0f : 0.0f;
+            
+            // Each shader has its own buffer, so an unchanged block needs no Map
+            bool changed = !shader.hasUploadedConstants ||
+                memcmp(&constants, &shader.uploadedConstants, sizeof(DrawConstants)) != 0;
+            m_stateCache.count(STATE_CONSTANTS, changed);
+            if (changed) {
+                D3D11_MAPPED_SUBRESOURCE ms{};
+                HRESULT hr = m_context->Map(shader.constantBuffer.Get(), 0, 
+                                            D3D11_MAP_WRITE_DISCARD, 0, &ms);
+                if (SUCCEEDED(hr)) {
+                    memcpy(ms.pData, &constants, sizeof(DrawConstants));
+                    m_context->Unmap(shader.constantBuffer.Get(), 0);
+                    shader.uploadedConstants = constants;
+                    shader.hasUploadedConstants = true;
+                }
+            }
+
+            if (m_stateCache.set(STATE_CONSTANTS, (uintptr_t)shader.constantBuffer.Get())) {
+                m_context->VSSetConstantBuffers(0, 1, shader.constantBuffer.GetAddressOf());
+                m_context->PSSetConstantBuffers(0, 1, shader.constantBuffer.GetAddressOf());
+            }
+        }
+
+        // Diffuse texture in slot 0 (unbound when missing), normal map in
+        // slot 1, array layers in slot 2. The diffuse slot not in use keeps
+        // its SRV, so draws of layers of one array bind nothing.
+        if (layered) {
+            setShaderResource(2, texture->srv.Get());
+        } else {
+            setShaderResource(0, texture ? texture->srv.Get() : nullptr);
+        }
+        setShaderResource(1, findSRV(m_boundNormalMap));
+    }
+
+    // ---- Cached binds ----
+    const D3D11Texture* findTexture(uint32_t textureHandle) const {
+        if (textureHandle == 0) return nullptr;
+        auto it = m_textures.find(textureHandle);
+        return it != m_textures.end() ? &it->second : nullptr;
+    }
+
+    ID3D11ShaderResourceView* findSRV(uint32_t textureHandle) const {
+        const D3D11Texture* texture = findTexture(textureHandle);
+        return texture ? texture->srv.Get() : nullptr;
+    }
+
+    void setShaderResource(UINT slot, ID3D11ShaderResourceView* srv) {
+        if (m_stateCache.set(STATE_TEXTURE, (uintptr_t)srv, slot)) {
+            m_context->PSSetShaderResources(slot, 1, &srv);
+        }
+    }
+
+    void setInputLayout(ID3D11InputLayout* layout) {
+        if (m_stateCache.set(STATE_PIPELINE, (uintptr_t)layout, 0)) {
+            m_context->IASetInputLayout(layout);
+        }
+    }
+
+    // Mesh stream in slot 0, instance stream in slot 1 (always bound at
+    // offset 0: it is part of the input layout, ignored when uInstanced = 0,
+    // and instanced draws pick their range with StartInstanceLocation), indices
+    void setMeshBuffers(const D3D11Mesh& mesh) {
+        bool changed = m_stateCache.set(STATE_VERTEX_INPUT, (uintptr_t)mesh.vertexBuffer.Get(), 0);
+        changed |= m_stateCache.set(STATE_VERTEX_INPUT, (uintptr_t)m_instanceBuffer.Get(), 1);
+        if (changed) {
+            ID3D11Buffer* vbs[2] = { mesh.vertexBuffer.Get(), m_instanceBuffer.Get() };
+            UINT strides[2] = { mesh.stride, sizeof(InstanceData) };
+            UINT offsets[2] = { 0, 0 };
+            m_context->IASetVertexBuffers(0, 2, vbs, strides, offsets);
+        }
+        if (m_stateCache.set(STATE_VERTEX_INPUT, (uintptr_t)mesh.indexBuffer.Get(), 2)) {
+            m_context->IASetIndexBuffer(mesh.indexBuffer.Get(), mesh.indexFormat, 0);
+        }
+        if (m_stateCache.set(STATE_PIPELINE, D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST, 1)) {
+            m_context->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+        }
+    }
+
+    // Bytecode comes from the shader cache when the same source, entry,
+    // target, flags and compiler version were compiled before
     bool compileShader(const char* src, const char* entry, const char* target, 
                       ComPtr<ID3DBlob>& outBlob) {
         UINT flags = D3DCOMPILE_ENABLE_STRICTNESS;
 #ifdef _DEBUG
         flags |= D3DCOMPILE_DEBUG | D3DCOMPILE_SKIP_OPTIMIZATION;
 #endif
+        uint64_t key = ShaderCacheKey().add(src).add(entry).add(target)
+                                       .add((uint64_t)flags).add((uint64_t)D3D_COMPILER_VERSION).value();
+        std::vector<uint8_t> cached;
+        if (ShaderCache::load(key, ".dxbc", cached) &&
+            SUCCEEDED(D3DCreateBlob(cached.size(), outBlob.ReleaseAndGetAddressOf()))) {
+            std::memcpy(outBlob->GetBufferPointer(), cached.data(), cached.size());
+            m_shaderCacheHits++;
+            return true;
+        }
+
         ComPtr<ID3DBlob> errorBlob;
         HRESULT hr = D3DCompile(src, std::strlen(src), nullptr, nullptr, nullptr,
                                entry, target, flags, 0,
-                               outBlob.GetAddressOf(), errorBlob.GetAddressOf());
+                               outBlob.ReleaseAndGetAddressOf(), errorBlob.GetAddressOf());
         if (FAILED(hr)) {
             if (errorBlob) {
                 std::fprintf(stderr, "Shader compile error: %s\n", 
@@ -191,6 +529,8 @@ private:
             }
             return false;
         }
+        m_shaderCompiles++;
+        ShaderCache::store(key, ".dxbc", outBlob->GetBufferPointer(), outBlob->GetBufferSize());
         return true;
     }
 
@@ -205,12 +545,15 @@ cbuffer CB : register(b0)
     float3   uLightDir;
     float    uUseTexture;
     float    uUseNormalMap;  // Flag for normal mapping
-    float3   padding;        // Padding for 16-byte alignment
+    float    uInstanced;     // 1 = world/tint from instance stream, uMVP = viewProj
+    float    uPackedVertex;  // 1 = octahedral aNrm.xy / aTangent.xy, bitangent sign in aTangent.z
+    float    uTextureLayer;  // Layer of gTexArray when uUseTexture = 2
 };
 
-Texture2D    gTex     : register(t0);
-Texture2D    gNormalMap : register(t1);  // Normal map texture
-SamplerState gSampler : register(s0);
+Texture2D      gTex       : register(t0);
+Texture2D      gNormalMap : register(t1);  // Normal map texture
+Texture2DArray gTexArray  : register(t2);  // Texture array layers
+SamplerState   gSampler   : register(s0);
 
 struct VSIn {
     float3 aPos      : POSITION;
@@ -219,6 +562,12 @@ struct VSIn {
     float2 aTexCoord : TEXCOORD0;
     float3 aTangent  : TANGENT;
     float3 aBitangent: BITANGENT;
+    // Per-instance stream (slot 1): column-major Mat4 columns + tint
+    float4 iWorld0   : INSTWORLD0;
+    float4 iWorld1   : INSTWORLD1;
+    float4 iWorld2   : INSTWORLD2;
+    float4 iWorld3   : INSTWORLD3;
+    float4 iTint     : INSTTINT;
 };
 
 struct VSOut {
@@ -227,21 +576,48 @@ struct VSOut {
     float4 col      : COLOR;
     float2 texCoord : TEXCOORD1;
     float3x3 TBN    : TEXCOORD2;  // TBN matrix (uses TEXCOORD2,3,4)
+    float4 tint     : TEXCOORD5;
 };
 
+float3 octDecode(float2 e)
+{
+    float3 n = float3(e, 1.0 - abs(e.x) - abs(e.y));
+    float t = saturate(-n.z);
+    n.xy += (n.xy >= 0.0) ? -t : t;
+    return normalize(n);
+}
+
 VSOut VSMain(VSIn v)
 {
     VSOut o;
-    o.pos = mul(float4(v.aPos, 1.0), uMVP);
+    float4x4 world = uWorld;
+    o.tint = float4(1.0, 1.0, 1.0, 1.0);
+    if (uInstanced > 0.5) {
+        // Rows of this matrix are the Mat4 columns, i.e. the same layout as uWorld
+        world = float4x4(v.iWorld0, v.iWorld1, v.iWorld2, v.iWorld3);
+        o.tint = v.iTint;
+        o.pos = mul(mul(float4(v.aPos, 1.0), world), uMVP);
+    } else {
+        o.pos = mul(float4(v.aPos, 1.0), uMVP);
+    }
+    
+    float3 nrm = v.aNrm;
+    float3 tan = v.aTangent;
+    float bSign = 1.0;
+    if (uPackedVertex > 0.5) {
+        nrm = octDecode(v.aNrm.xy);
+        tan = octDecode(v.aTangent.xy);
+        bSign = (v.aTangent.z < 0.0) ? -1.0 : 1.0;
+    }
     
     // Transform tangent space vectors to world space
-    float3 T = normalize(mul(float4(v.aTangent, 0.0), uWorld).xyz);
-    float3 B = normalize(mul(float4(v.aBitangent, 0.0), uWorld).xyz);
-    float3 N = normalize(mul(float4(v.aNrm, 0.0), uWorld).xyz);
+    float3 T = normalize(mul(float4(tan, 0.0), world).xyz);
+    float3 B = normalize(mul(float4(v.aBitangent, 0.0), world).xyz);
+    float3 N = normalize(mul(float4(nrm, 0.0), world).xyz);
     
     // Re-orthogonalize using Gram-Schmidt
     T = normalize(T - dot(T, N) * N);
-    B = normalize(cross(N, T));
+    B = normalize(cross(N, T)) * bSign;
     
     // Build TBN matrix
     o.TBN = float3x3(T, B, N);
@@ -271,27 +647,100 @@ float4 PSMain(VSOut i) : SV_Target
     float diff = 0.40 + ndl * 0.60;  // High ambient for bright scene
 
     // Base color
-    float4 baseColor = (uUseTexture > 0.5)
-                       ? gTex.Sample(gSampler, i.texCoord)
-                       : i.col;
+    float4 baseColor = i.col;
+    if (uUseTexture > 1.5) {
+        baseColor = gTexArray.Sample(gSampler, float3(i.texCoord, uTextureLayer));
+    } else if (uUseTexture > 0.5) {
+        baseColor = gTex.Sample(gSampler, i.texCoord);
+    }
 
-    return float4(baseColor.rgb * diff, baseColor.a);
+    return float4(baseColor.rgb * i.tint.rgb * diff, baseColor.a);
 }
 )";
     }
 
+    // Texture + SRV from raw pixels (3-channel data is expanded to RGBA),
+    // with the mip chain filled from the top level by GenerateMips
+    bool buildTextureFromData(const uint8_t* data, int width, int height, int channels,
+                              D3D11Texture& texture) {
+        texture.width = width;
+        texture.height = height;
+        
+        // Determine format
+        DXGI_FORMAT format = DXGI_FORMAT_R8G8B8A8_UNORM;
+        if (channels == 1) format = DXGI_FORMAT_R8_UNORM;
+        else if (channels == 3) format = DXGI_FORMAT_R8G8B8A8_UNORM; // D3D11 doesn't have RGB8, use RGBA8
+        else if (channels == 4) format = DXGI_FORMAT_R8G8B8A8_UNORM;
+        
+        // If 3 channels, need to convert to 4 channels
+        std::vector<uint8_t> rgba_data;
+        const uint8_t* upload_data = data;
+        if (channels == 3) {
+            rgba_data.resize(width * height * 4);
+            for (int i = 0; i < width * height; i++) {
+                rgba_data[i * 4 + 0] = data[i * 3 + 0];
+                rgba_data[i * 4 + 1] = data[i * 3 + 1];
+                rgba_data[i * 4 + 2] = data[i * 3 + 2];
+                rgba_data[i * 4 + 3] = 255;
+            }
+            upload_data = rgba_data.data();
+        }
+        
+        // Create texture; MipLevels = 0 is the full chain, and mip
+        // generation needs it renderable
+        D3D11_TEXTURE2D_DESC texDesc = {};
+        texDesc.Width = width;
+        texDesc.Height = height;
+        texDesc.MipLevels = 0;
+        texDesc.ArraySize = 1;
+        texDesc.Format = format;
+        texDesc.SampleDesc.Count = 1;
+        texDesc.Usage = D3D11_USAGE_DEFAULT;
+        texDesc.BindFlags = D3D11_BIND_SHADER_RESOURCE | D3D11_BIND_RENDER_TARGET;
+        texDesc.MiscFlags = D3D11_RESOURCE_MISC_GENERATE_MIPS;
+        
+        HRESULT hr = m_device->CreateTexture2D(&texDesc, nullptr, texture.texture.GetAddressOf());
+        if (FAILED(hr)) {
+            std::fprintf(stderr, "D3D11: Failed to create texture from data\n");
+            return false;
+        }
+        m_context->UpdateSubresource(texture.texture.Get(), 0, nullptr, upload_data,
+                                     width * (channels == 3 ? 4 : channels), 0);
+        
+        // Create SRV over every level
+        D3D11_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
+        srvDesc.Format = format;
+        srvDesc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURE2D;
+        srvDesc.Texture2D.MipLevels = (UINT)-1;
+        
+        hr = m_device->CreateShaderResourceView(texture.texture.Get(), &srvDesc, texture.srv.GetAddressOf());
+        if (FAILED(hr)) {
+            std::fprintf(stderr, "D3D11: Failed to create SRV for texture\n");
+            return false;
+        }
+        m_context->GenerateMips(texture.srv.Get());
+        return true;
+    }
+
 public:
     D3D11Renderer()
         : m_hwnd(nullptr)
+        , m_geometryPool(GEOMETRY_VERTEX_BLOCK_BYTES, GEOMETRY_INDEX_BLOCK_BYTES)
         , m_nextMeshHandle(1)
         , m_nextShaderHandle(1)
         , m_nextTextureHandle(1)
         , m_currentShader(0)
         , m_width(1280)
         , m_height(720)
-        , m_hasViewProj(false)
-        , m_inInstancedDraw(false)
+        , m_syncInterval(1)
+        , m_lowLatency(false)
+        , m_allowTearing(false)
+        , m_tearingSupported(false)
+        , m_swapChainFlags(0)
+        , m_frameLatencyWaitable(nullptr)
         , m_boundNormalMap(0)
+        , m_instanceCapacity(0)
+        , m_instanceCursor(0)
     {
         m_clearColor[0] = 0.0f;
         m_clearColor[1] = 0.0f;
@@ -313,18 +762,6 @@ public:
         // Get window size
         glfwGetFramebufferSize(window, &m_width, &m_height);
 
-        // Create swap chain description
-        DXGI_SWAP_CHAIN_DESC sd{};
-        sd.BufferCount = 2;
-        sd.BufferDesc.Width = m_width;
-        sd.BufferDesc.Height = m_height;
-        sd.BufferDesc.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
-        sd.BufferUsage = DXGI_USAGE_RENDER_TARGET_OUTPUT;
-        sd.OutputWindow = m_hwnd;
-        sd.SampleDesc.Count = 1;
-        sd.Windowed = TRUE;
-        sd.SwapEffect = DXGI_SWAP_EFFECT_DISCARD;
-
         UINT flags = 0;
 #ifdef _DEBUG
         flags |= D3D11_CREATE_DEVICE_DEBUG;
@@ -336,19 +773,21 @@ public:
             D3D_FEATURE_LEVEL_10_0 
         };
 
-        HRESULT hr = D3D11CreateDeviceAndSwapChain(
+        HRESULT hr = D3D11CreateDevice(
             nullptr, D3D_DRIVER_TYPE_HARDWARE, nullptr,
             flags,
             levels, (UINT)std::size(levels),
             D3D11_SDK_VERSION,
-            &sd,
-            m_swapChain.GetAddressOf(),
             m_device.GetAddressOf(),
             &featureLevel,
             m_context.GetAddressOf());
 
         if (FAILED(hr)) {
-            std::fprintf(stderr, "Failed to create D3D11 device and swap chain\n");
+            std::fprintf(stderr, "Failed to create D3D11 device\n");
+            return false;
+        }
+
+        if (!createSwapChain()) {
             return false;
         }
 
@@ -401,6 +840,15 @@ public:
         m_context->PSSetSamplers(0, 1, m_samplerState.GetAddressOf());
         std::printf("Feature Level: %x\n", featureLevel);
 
+        if (!createInstanceBuffer(INITIAL_INSTANCE_CAPACITY)) {
+            return false;
+        }
+
+        m_hasTimestampQueries = createTimestampQueries();
+        if (!m_hasTimestampQueries) {
+            std::fprintf(stderr, "D3D11: Timestamp queries unavailable, GPU timing disabled\n");
+        }
+
         return true;
     }
 
@@ -410,6 +858,8 @@ public:
             // ComPtr handles cleanup automatically
         }
         m_meshes.clear();
+        m_geometryBlocks.clear();
+        m_geometryPool.clear();
 
         // Clean up shaders
         for (auto& pair : m_shaders) {
@@ -417,12 +867,33 @@ public:
         }
         m_shaders.clear();
 
+        m_instanceBuffer.Reset();
+        for (int i = 0; i < 2; i++) {
+            m_depthStates[i].Reset();
+            m_rasterStates[i].Reset();
+        }
+        m_stateCache.invalidate();
+        for (ComPtr<ID3D11Query>& query : m_timestampQueries) query.Reset();
+        for (ComPtr<ID3D11Query>& query : m_disjointQueries) query.Reset();
+        m_hasTimestampQueries = false;
         m_context.Reset();
         m_device.Reset();
+        if (m_frameLatencyWaitable) {
+            CloseHandle(m_frameLatencyWaitable);
+            m_frameLatencyWaitable = nullptr;
+        }
         m_swapChain.Reset();
     }
 
     void beginFrame() override {
+        m_stateCache.beginFrame();
+        resolveTimestamps();
+        uint32_t frameStart = m_gpuTimer.beginFrame();
+        if (m_hasTimestampQueries) m_context->Begin(m_disjointQueries[m_gpuTimer.currentSlot()].Get());
+        writeTimestamp(frameStart);
+        // Flip-model presents unbind the back buffer
+        ID3D11RenderTargetView* rtvs[] = { m_rtv.Get() };
+        m_context->OMSetRenderTargets(1, rtvs, m_dsv.Get());
         m_context->ClearRenderTargetView(m_rtv.Get(), m_clearColor);
         m_context->ClearDepthStencilView(m_dsv.Get(), 
                                         D3D11_CLEAR_DEPTH | D3D11_CLEAR_STENCIL, 
@@ -430,7 +901,11 @@ public:
     }
 
     void endFrame() override {
-        m_swapChain->Present(1, 0);
+        writeTimestamp(m_gpuTimer.endFrame());
+        if (m_hasTimestampQueries) m_context->End(m_disjointQueries[m_gpuTimer.currentSlot()].Get());
+        // Tearing is only allowed without vsync
+        UINT presentFlags = (m_syncInterval == 0 && m_tearingSupported) ? DXGI_PRESENT_ALLOW_TEARING : 0;
+        m_swapChain->Present(m_syncInterval, presentFlags);
     }
 
     void setClearColor(float r, float g, float b, float a) override {
@@ -440,6 +915,20 @@ public:
         m_clearColor[3] = a;
     }
 
+    void setVSync(bool enabled) override {
+        m_syncInterval = enabled ? 1 : 0;
+    }
+
+    void setLowLatency(bool enabled) override { m_lowLatency = enabled; }
+    void setAllowTearing(bool enabled) override { m_allowTearing = enabled; }
+
+    void waitForFrameSlot() override {
+        if (m_frameLatencyWaitable) WaitForSingleObjectEx(m_frameLatencyWaitable, 1000, TRUE);
+    }
+
+    // The immediate context is only ever used by one thread at a time
+    void makeCurrent(bool current) override { (void)current; }
+
     void setViewport(int width, int height) override {
         m_width = width;
         m_height = height;
@@ -448,7 +937,7 @@ public:
         m_context->OMSetRenderTargets(0, nullptr, nullptr);
 
         // Resize swap chain
-        m_swapChain->ResizeBuffers(0, width, height, DXGI_FORMAT_UNKNOWN, 0);
+        m_swapChain->ResizeBuffers(0, width, height, DXGI_FORMAT_UNKNOWN, m_swapChainFlags);
 
         // Recreate render targets
         createRTVAndDSV(width, height);
@@ -456,51 +945,30 @@ public:
 
     uint32_t createMesh(const Vertex* vertices, uint32_t vertexCount,
                        const uint16_t* indices, uint32_t indexCount) override {
-        D3D11Mesh mesh;
-        mesh.indexCount = indexCount;
-
-        // Create vertex buffer
-        D3D11_BUFFER_DESC vbDesc{};
-        vbDesc.Usage = D3D11_USAGE_IMMUTABLE;
-        vbDesc.ByteWidth = vertexCount * sizeof(Vertex);
-        vbDesc.BindFlags = D3D11_BIND_VERTEX_BUFFER;
-
-        D3D11_SUBRESOURCE_DATA vbData{};
-        vbData.pSysMem = vertices;
-
-        HRESULT hr = m_device->CreateBuffer(&vbDesc, &vbData, mesh.vertexBuffer.GetAddressOf());
-        if (FAILED(hr)) {
-            std::fprintf(stderr, "Failed to create vertex buffer\n");
-            return 0;
-        }
-
-        // Create index buffer
-        D3D11_BUFFER_DESC ibDesc{};
-        ibDesc.Usage = D3D11_USAGE_IMMUTABLE;
-        ibDesc.ByteWidth = indexCount * sizeof(uint16_t);
-        ibDesc.BindFlags = D3D11_BIND_INDEX_BUFFER;
-
-        D3D11_SUBRESOURCE_DATA ibData{};
-        ibData.pSysMem = indices;
+        return createMeshBuffers(vertices, vertexCount, sizeof(Vertex), false,
+                                 indices, indexCount, DXGI_FORMAT_R16_UINT);
+    }
 
-        hr = m_device->CreateBuffer(&ibDesc, &ibData, mesh.indexBuffer.GetAddressOf());
-        if (FAILED(hr)) {
-            std::fprintf(stderr, "Failed to create index buffer\n");
-            return 0;
-        }
+    uint32_t createMesh(const Vertex* vertices, uint32_t vertexCount,
+                       const uint32_t* indices, uint32_t indexCount) override {
+        return createMesh32(vertices, vertexCount, sizeof(Vertex), false, indices, indexCount);
+    }
 
-        uint32_t handle = m_nextMeshHandle++;
-        m_meshes[handle] = mesh;
-        return handle;
+    uint32_t createMesh(const PackedVertex* vertices, uint32_t vertexCount,
+                       const uint32_t* indices, uint32_t indexCount) override {
+        return createMesh32(vertices, vertexCount, sizeof(PackedVertex), true, indices, indexCount);
     }
 
     void destroyMesh(uint32_t meshHandle) override {
         auto it = m_meshes.find(meshHandle);
         if (it != m_meshes.end()) {
+            m_geometryPool.free(it->second.range);
             m_meshes.erase(it);
         }
     }
 
+    bool isMeshReady(uint32_t meshHandle) const override { return m_meshes.count(meshHandle) != 0; }
+
     uint32_t createShader(const char* vertexSource, const char* fragmentSource) override {
         // Convert GLSL to HLSL (simplified - just use our known HLSL)
         std::string hlsl = glslToHLSL(vertexSource, fragmentSource);
@@ -549,6 +1017,12 @@ public:
             { "TEXCOORD",  0, DXGI_FORMAT_R32G32_FLOAT,       0, 40, D3D11_INPUT_PER_VERTEX_DATA, 0 },
             { "TANGENT",   0, DXGI_FORMAT_R32G32B32_FLOAT,    0, 48, D3D11_INPUT_PER_VERTEX_DATA, 0 },
             { "BITANGENT", 0, DXGI_FORMAT_R32G32B32_FLOAT,    0, 60, D3D11_INPUT_PER_VERTEX_DATA, 0 },
+            // Per-instance stream — must match InstanceData
+            { "INSTWORLD", 0, DXGI_FORMAT_R32G32B32A32_FLOAT, 1,  0, D3D11_INPUT_PER_INSTANCE_DATA, 1 },
+            { "INSTWORLD", 1, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, 16, D3D11_INPUT_PER_INSTANCE_DATA, 1 },
+            { "INSTWORLD", 2, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, 32, D3D11_INPUT_PER_INSTANCE_DATA, 1 },
+            { "INSTWORLD", 3, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, 48, D3D11_INPUT_PER_INSTANCE_DATA, 1 },
+            { "INSTTINT",  0, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, 64, D3D11_INPUT_PER_INSTANCE_DATA, 1 },
         };
 
         hr = m_device->CreateInputLayout(
@@ -562,10 +1036,37 @@ public:
             return 0;
         }
 
+        // PackedVertex: the shader decodes NORMAL.xy / TANGENT.xyz when uPackedVertex
+        // is set; BITANGENT aliases the tangent and is unused
+        D3D11_INPUT_ELEMENT_DESC packedLayout[] = {
+            { "POSITION",  0, DXGI_FORMAT_R32G32B32_FLOAT,    0,  0, D3D11_INPUT_PER_VERTEX_DATA, 0 },
+            { "NORMAL",    0, DXGI_FORMAT_R16G16_SNORM,       0, 12, D3D11_INPUT_PER_VERTEX_DATA, 0 },
+            { "TANGENT",   0, DXGI_FORMAT_R16G16B16A16_SNORM, 0, 16, D3D11_INPUT_PER_VERTEX_DATA, 0 },
+            { "BITANGENT", 0, DXGI_FORMAT_R16G16B16A16_SNORM, 0, 16, D3D11_INPUT_PER_VERTEX_DATA, 0 },
+            { "TEXCOORD",  0, DXGI_FORMAT_R16G16_FLOAT,       0, 24, D3D11_INPUT_PER_VERTEX_DATA, 0 },
+            { "COLOR",     0, DXGI_FORMAT_R8G8B8A8_UNORM,     0, 28, D3D11_INPUT_PER_VERTEX_DATA, 0 },
+            { "INSTWORLD", 0, DXGI_FORMAT_R32G32B32A32_FLOAT, 1,  0, D3D11_INPUT_PER_INSTANCE_DATA, 1 },
+            { "INSTWORLD", 1, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, 16, D3D11_INPUT_PER_INSTANCE_DATA, 1 },
+            { "INSTWORLD", 2, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, 32, D3D11_INPUT_PER_INSTANCE_DATA, 1 },
+            { "INSTWORLD", 3, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, 48, D3D11_INPUT_PER_INSTANCE_DATA, 1 },
+            { "INSTTINT",  0, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, 64, D3D11_INPUT_PER_INSTANCE_DATA, 1 },
+        };
+
+        hr = m_device->CreateInputLayout(
+            packedLayout,
+            (UINT)std::size(packedLayout),
+            vsBlob->GetBufferPointer(),
+            vsBlob->GetBufferSize(),
+            shader.packedInputLayout.GetAddressOf());
+        if (FAILED(hr)) {
+            std::fprintf(stderr, "Failed to create packed input layout\n");
+            return 0;
+        }
+
         // Create constant buffer
         D3D11_BUFFER_DESC cbDesc{};
         cbDesc.Usage = D3D11_USAGE_DYNAMIC;
-        cbDesc.ByteWidth = sizeof(CBData);
+        cbDesc.ByteWidth = sizeof(DrawConstants);
         cbDesc.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
         cbDesc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
 
@@ -578,11 +1079,13 @@ public:
         uint32_t handle = m_nextShaderHandle++;
         
         // Initialize constant buffer data
-        shader.cbData.mvp        = XMMatrixIdentity();
-        shader.cbData.world      = XMMatrixIdentity();
-        shader.cbData.lightDir   = XMFLOAT3(0.0f, -1.0f, 0.0f);
-        shader.cbData.useTexture = 0.0f;
+        shader.drawConstants = DrawConstants();
+        shader.drawConstants.mvp      = mat4_identity();
+        shader.drawConstants.world    = mat4_identity();
+        shader.drawConstants.lightDir = {0.0f, -1.0f, 0.0f};
         
+        std::printf("D3D11: Shader created (stages: %u cached / %u compiled)\n",
+                    m_shaderCacheHits, m_shaderCompiles);
         m_shaders[handle] = shader;
         return handle;
     }
@@ -600,66 +1103,72 @@ public:
             m_currentShader = shaderHandle;
             
             D3D11Shader& shader = it->second;
-            m_context->IASetInputLayout(shader.inputLayout.Get());
-            m_context->VSSetShader(shader.vertexShader.Get(), nullptr, 0);
-            m_context->PSSetShader(shader.pixelShader.Get(), nullptr, 0);
+            setInputLayout(shader.inputLayout.Get());
+            if (m_stateCache.set(STATE_SHADER, shaderHandle)) {
+                m_context->VSSetShader(shader.vertexShader.Get(), nullptr, 0);
+                m_context->PSSetShader(shader.pixelShader.Get(), nullptr, 0);
+            }
         }
     }
 
+    // Every uniform the default shader takes per draw lives in cbuffer CB
+    // (b0), so a handle is simply a DrawConstantField; samplers are fixed
+    // registers and have no handle
+    UniformHandle getUniformHandle(uint32_t shaderHandle, const char* name) override {
+        if (m_shaders.find(shaderHandle) == m_shaders.end()) return INVALID_UNIFORM;
+        return findDrawConstantField(name);
+    }
+
     void setUniformMat4(uint32_t shaderHandle, const char* name, const Mat4& matrix) override {
-        static bool debugOnce = true;
-        if (debugOnce) {
-            printf("D3D11 setUniformMat4: shader=%u, name=%s\n", shaderHandle, name);
-            debugOnce = false;
-        }
-        
-        auto it = m_shaders.find(shaderHandle);
-        if (it == m_shaders.end()) {
-            printf("D3D11 setUniformMat4: Shader %u NOT FOUND!\n", shaderHandle);
-            return;
-        }
+        setUniformMat4(shaderHandle, findDrawConstantField(name), matrix);
+    }
 
-        D3D11Shader& shader = it->second;
+    void setUniformVec3(uint32_t shaderHandle, const char* name, const Vec3& vec) override {
+        setUniformVec3(shaderHandle, findDrawConstantField(name), vec);
+    }
 
-        // Store the matrix for later batch update
-        // Convert column-major Mat4 to XMMATRIX and transpose
-        XMMATRIX xm = XMLoadFloat4x4((const XMFLOAT4X4*)matrix.m);
-        xm = XMMatrixTranspose(xm);
+    void setUniformInt(uint32_t shaderHandle, const char* name, int value) override {
+        setUniformInt(shaderHandle, findDrawConstantField(name), value);
+    }
 
-        if (strcmp(name, "uMVP") == 0) {
-            shader.cbData.mvp = xm;
-            
-            // Store view-projection for instanced rendering
-            // Only store when NOT in instanced draw to prevent overwriting
-            if (!m_inInstancedDraw) {
-                m_viewProj = xm;
-                m_hasViewProj = true;
-                
-                static bool once = true;
-                if (once) {
-                    printf("D3D11: Stored viewProj, inInstancedDraw=%d, hasViewProj=%d\n", 
-                           m_inInstancedDraw, m_hasViewProj);
-                    once = false;
-                }
-            }
-        } else if (strcmp(name, "uWorld") == 0) {
-            shader.cbData.world = xm;
-        }
+    void setUniformMat4(uint32_t shaderHandle, UniformHandle uniform, const Mat4& matrix) override {
+        auto it = m_shaders.find(shaderHandle);
+        if (it != m_shaders.end()) setDrawConstantMat4(it->second.drawConstants, uniform, matrix);
     }
 
-    void setUniformVec3(uint32_t shaderHandle, const char* name, const Vec3& vec) override {
+    void setUniformVec3(uint32_t shaderHandle, UniformHandle uniform, const Vec3& vec) override {
         auto it = m_shaders.find(shaderHandle);
-        if (it == m_shaders.end()) return;
+        if (it != m_shaders.end()) setDrawConstantVec3(it->second.drawConstants, uniform, vec);
+    }
 
-        D3D11Shader& shader = it->second;
+    void setUniformInt(uint32_t shaderHandle, UniformHandle uniform, int value) override {
+        auto it = m_shaders.find(shaderHandle);
+        if (it != m_shaders.end()) setDrawConstantInt(it->second.drawConstants, uniform, value);
+    }
 
-        // Store the vector for later batch update
-        if (strcmp(name, "uLightDir") == 0) {
-            shader.cbData.lightDir = XMFLOAT3(vec.x, vec.y, vec.z);
-        }
+    void setDrawConstants(uint32_t shaderHandle, const DrawConstants& constants) override {
+        auto it = m_shaders.find(shaderHandle);
+        if (it != m_shaders.end()) it->second.drawConstants = constants;
     }
 
     uint32_t createTexture(const char* filepath) override {
+        // DDS: upload the BC blocks directly, decode on the CPU only as a fallback
+        const char* ext = strrchr(filepath, '.');
+        if (ext && (strcmp(ext, ".dds") == 0 || strcmp(ext, ".DDS") == 0)) {
+            DDSImage image;
+            if (DDSLoader::LoadCompressed(filepath, image)) {
+                uint32_t handle = createCompressedTexture(image.format, image.mips.data(),
+                                                          (uint32_t)image.mips.size());
+                if (handle) return handle;
+            }
+            int w, h, ch;
+            unsigned char* pixels = DDSLoader::Load(filepath, &w, &h, &ch);
+            if (!pixels) return 0;
+            uint32_t handle = createTextureFromData(pixels, w, h, ch);
+            delete[] pixels;
+            return handle;
+        }
+        
         int width, height, channels;
         stbi_set_flip_vertically_on_load(false);
         unsigned char* data = stbi_load(filepath, &width, &height, &channels, 4);
@@ -672,41 +1181,9 @@ public:
         std::printf("Loaded texture: %s (%dx%d)\n", filepath, width, height);
 
         D3D11Texture texture;
-        texture.width = width;
-        texture.height = height;
-
-        D3D11_TEXTURE2D_DESC texDesc = {};
-        texDesc.Width = width;
-        texDesc.Height = height;
-        texDesc.MipLevels = 0;
-        texDesc.ArraySize = 1;
-        texDesc.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
-        texDesc.SampleDesc.Count = 1;
-        texDesc.Usage = D3D11_USAGE_DEFAULT;
-        texDesc.BindFlags = D3D11_BIND_SHADER_RESOURCE | D3D11_BIND_RENDER_TARGET;
-        texDesc.MiscFlags = D3D11_RESOURCE_MISC_GENERATE_MIPS;
-
-        HRESULT hr = m_device->CreateTexture2D(&texDesc, nullptr, &texture.texture);
-        if (FAILED(hr)) {
-            stbi_image_free(data);
-            return 0;
-        }
-
-        m_context->UpdateSubresource(texture.texture.Get(), 0, nullptr, data, width * 4, 0);
-
-        D3D11_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
-        srvDesc.Format = texDesc.Format;
-        srvDesc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURE2D;
-        srvDesc.Texture2D.MipLevels = -1;
-
-        hr = m_device->CreateShaderResourceView(texture.texture.Get(), &srvDesc, &texture.srv);
-        if (FAILED(hr)) {
-            stbi_image_free(data);
-            return 0;
-        }
-
-        m_context->GenerateMips(texture.srv.Get());
+        bool ok = buildTextureFromData(data, width, height, 4, texture);
         stbi_image_free(data);
+        if (!ok) return 0;
 
         uint32_t handle = m_nextTextureHandle++;
         m_textures[handle] = texture;
@@ -714,7 +1191,11 @@ public:
     }
 
     void destroyTexture(uint32_t textureHandle) override {
-        m_textures.erase(textureHandle);
+        auto it = m_textures.find(textureHandle);
+        if (it == m_textures.end()) return;
+        // Layers only drop their SRV reference; the array takes its layers along
+        for (uint32_t layer : it->second.layerHandles) m_textures.erase(layer);
+        m_textures.erase(it);
     }
     
     uint32_t createTextureFromData(const uint8_t* data, int width, int height, int channels) override {
@@ -723,71 +1204,82 @@ public:
             return 0;
         }
         
-        std::printf("D3D11: Creating texture from data (%dx%d, %d channels)\n", width, height, channels);
+        LOG_DEBUG("D3D11: Creating texture from data (%dx%d, %d channels)", width, height, channels);
         
         D3D11Texture texture;
-        texture.width = width;
-        texture.height = height;
+        if (!buildTextureFromData(data, width, height, channels, texture)) return 0;
         
-        // Determine format
-        DXGI_FORMAT format = DXGI_FORMAT_R8G8B8A8_UNORM;
-        if (channels == 1) format = DXGI_FORMAT_R8_UNORM;
-        else if (channels == 3) format = DXGI_FORMAT_R8G8B8A8_UNORM; // D3D11 doesn't have RGB8, use RGBA8
-        else if (channels == 4) format = DXGI_FORMAT_R8G8B8A8_UNORM;
+        uint32_t handle = m_nextTextureHandle++;
+        m_textures[handle] = texture;
+        LOG_DEBUG("D3D11: Texture created, handle=%u", handle);
+        return handle;
+    }
+    
+    uint32_t createCompressedTexture(CompressedFormat format, const CompressedMip* mips, uint32_t mipCount) override {
+        if (!mips || mipCount == 0) return 0;
+        // BC textures need a top level that is a whole number of 4x4 blocks
+        if ((mips[0].width % 4) != 0 || (mips[0].height % 4) != 0) return 0;
         
-        // If 3 channels, need to convert to 4 channels
-        std::vector<uint8_t> rgba_data;
-        const uint8_t* upload_data = data;
-        if (channels == 3) {
-            rgba_data.resize(width * height * 4);
-            for (int i = 0; i < width * height; i++) {
-                rgba_data[i * 4 + 0] = data[i * 3 + 0];
-                rgba_data[i * 4 + 1] = data[i * 3 + 1];
-                rgba_data[i * 4 + 2] = data[i * 3 + 2];
-                rgba_data[i * 4 + 3] = 255;
-            }
-            upload_data = rgba_data.data();
-        }
+        DXGI_FORMAT dxgiFormat = DXGI_FORMAT_BC1_UNORM;
+        if (format == CompressedFormat::BC2) dxgiFormat = DXGI_FORMAT_BC2_UNORM;
+        else if (format == CompressedFormat::BC3) dxgiFormat = DXGI_FORMAT_BC3_UNORM;
+        
+        D3D11Texture texture;
+        texture.width = mips[0].width;
+        texture.height = mips[0].height;
         
-        // Create texture
         D3D11_TEXTURE2D_DESC texDesc = {};
-        texDesc.Width = width;
-        texDesc.Height = height;
-        texDesc.MipLevels = 1;
+        texDesc.Width = mips[0].width;
+        texDesc.Height = mips[0].height;
+        texDesc.MipLevels = mipCount;
         texDesc.ArraySize = 1;
-        texDesc.Format = format;
+        texDesc.Format = dxgiFormat;
         texDesc.SampleDesc.Count = 1;
         texDesc.Usage = D3D11_USAGE_IMMUTABLE;
         texDesc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
         
-        D3D11_SUBRESOURCE_DATA initData = {};
-        initData.pSysMem = upload_data;
-        initData.SysMemPitch = width * (channels == 3 ? 4 : channels);
+        // One subresource per mip, pitch = one row of 4x4 blocks
+        std::vector<D3D11_SUBRESOURCE_DATA> initData(mipCount);
+        for (uint32_t level = 0; level < mipCount; level++) {
+            initData[level].pSysMem = mips[level].data;
+            initData[level].SysMemPitch = mips[level].rowPitch;
+            initData[level].SysMemSlicePitch = mips[level].size;
+        }
         
-        HRESULT hr = m_device->CreateTexture2D(&texDesc, &initData, texture.texture.GetAddressOf());
+        HRESULT hr = m_device->CreateTexture2D(&texDesc, initData.data(), texture.texture.GetAddressOf());
         if (FAILED(hr)) {
-            std::fprintf(stderr, "D3D11: Failed to create texture from data\n");
+            std::fprintf(stderr, "D3D11: Failed to create compressed texture\n");
             return 0;
         }
         
-        // Create SRV
         D3D11_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
-        srvDesc.Format = format;
+        srvDesc.Format = dxgiFormat;
         srvDesc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURE2D;
-        srvDesc.Texture2D.MipLevels = 1;
+        srvDesc.Texture2D.MipLevels = mipCount;
         
         hr = m_device->CreateShaderResourceView(texture.texture.Get(), &srvDesc, texture.srv.GetAddressOf());
         if (FAILED(hr)) {
-            std::fprintf(stderr, "D3D11: Failed to create SRV for texture\n");
+            std::fprintf(stderr, "D3D11: Failed to create SRV for compressed texture\n");
             return 0;
         }
         
         uint32_t handle = m_nextTextureHandle++;
         m_textures[handle] = texture;
-        std::printf("D3D11: Texture created successfully, handle=%u\n", handle);
         return handle;
     }
     
+    bool updateTexture(uint32_t textureHandle, const uint8_t* data, int width, int height, int channels) override {
+        auto it = m_textures.find(textureHandle);
+        if (it == m_textures.end() || !data || it->second.isArray) return false;
+        
+        // New resource under the same handle; the runtime keeps the old one
+        // alive until the GPU is done with it
+        D3D11Texture texture;
+        if (!buildTextureFromData(data, width, height, channels, texture)) return false;
+        it->second = texture;
+        return true;
+    }
+    
     void bindTextureToUnit(uint32_t textureHandle, int unit) override {
         // D3D11: Store for binding in draw calls
         if (unit == 1) {
@@ -795,165 +1287,197 @@ public:
         }
         // Diffuse texture (unit 0) is bound per-draw-call in drawMesh
     }
-
-    void setUniformInt(uint32_t shaderHandle, const char* name, int value) override {
-        auto it = m_shaders.find(shaderHandle);
-        if (it == m_shaders.end()) return;
-        if (strcmp(name, "uUseTexture") == 0)
-            it->second.cbData.useTexture = (float)value;
-        else if (strcmp(name, "uUseNormalMap") == 0)
-            it->second.cbData.useNormalMap = (float)value;
+    
+    // All layers go up with UpdateSubresource, then one GenerateMips fills
+    // every layer's chain
+    uint32_t createTextureArray(const uint8_t* const* layers, uint32_t layerCount,
+                                int width, int height, uint32_t* layerHandles) override {
+        if (!layers || !layerHandles || layerCount == 0 || width <= 0 || height <= 0) return 0;
+        if (layerCount > D3D11_REQ_TEXTURE2D_ARRAY_AXIS_DIMENSION) {
+            std::fprintf(stderr, "D3D11: createTextureArray - %u layers, at most %u supported\n",
+                         layerCount, (unsigned)D3D11_REQ_TEXTURE2D_ARRAY_AXIS_DIMENSION);
+            return 0;
+        }
+        
+        D3D11Texture texture;
+        texture.width = width;
+        texture.height = height;
+        texture.isArray = true;
+        
+        D3D11_TEXTURE2D_DESC texDesc = {};
+        texDesc.Width = width;
+        texDesc.Height = height;
+        texDesc.MipLevels = 0;
+        texDesc.ArraySize = layerCount;
+        texDesc.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
+        texDesc.SampleDesc.Count = 1;
+        texDesc.Usage = D3D11_USAGE_DEFAULT;
+        texDesc.BindFlags = D3D11_BIND_SHADER_RESOURCE | D3D11_BIND_RENDER_TARGET;
+        texDesc.MiscFlags = D3D11_RESOURCE_MISC_GENERATE_MIPS;
+        
+        HRESULT hr = m_device->CreateTexture2D(&texDesc, nullptr, texture.texture.GetAddressOf());
+        if (FAILED(hr)) {
+            std::fprintf(stderr, "D3D11: Failed to create texture array (%u x %dx%d)\n",
+                         layerCount, width, height);
+            return 0;
+        }
+        
+        // Subresources are numbered mip-major within each layer
+        D3D11_TEXTURE2D_DESC created;
+        texture.texture->GetDesc(&created);
+        for (uint32_t layer = 0; layer < layerCount; layer++) {
+            m_context->UpdateSubresource(texture.texture.Get(), D3D11CalcSubresource(0, layer, created.MipLevels),
+                                         nullptr, layers[layer], width * 4, 0);
+        }
+        
+        D3D11_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
+        srvDesc.Format = texDesc.Format;
+        srvDesc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURE2DARRAY;
+        srvDesc.Texture2DArray.MostDetailedMip = 0;
+        srvDesc.Texture2DArray.MipLevels = (UINT)-1;
+        srvDesc.Texture2DArray.FirstArraySlice = 0;
+        srvDesc.Texture2DArray.ArraySize = layerCount;
+        
+        hr = m_device->CreateShaderResourceView(texture.texture.Get(), &srvDesc, texture.srv.GetAddressOf());
+        if (FAILED(hr)) {
+            std::fprintf(stderr, "D3D11: Failed to create SRV for texture array\n");
+            return 0;
+        }
+        m_context->GenerateMips(texture.srv.Get());
+        
+        uint32_t handle = m_nextTextureHandle++;
+        for (uint32_t layer = 0; layer < layerCount; layer++) {
+            D3D11Texture view;
+            view.texture = texture.texture;
+            view.srv = texture.srv;
+            view.width = width;
+            view.height = height;
+            view.isArray = true;
+            view.layer = layer;
+            view.arrayHandle = handle;
+            layerHandles[layer] = m_nextTextureHandle++;
+            texture.layerHandles.push_back(layerHandles[layer]);
+            m_textures[layerHandles[layer]] = view;
+        }
+        m_textures[handle] = std::move(texture);
+        return handle;
     }
 
     void drawMesh(uint32_t meshHandle, uint32_t textureHandle = 0) override {
         auto meshIt = m_meshes.find(meshHandle);
         if (meshIt == m_meshes.end()) return;
 
-        // Update constant buffer
-        auto shaderIt = m_shaders.find(m_currentShader);
-        if (shaderIt != m_shaders.end()) {
-            D3D11Shader& shader = shaderIt->second;
-
-            // Propagate texture flag before uploading to GPU
-            shader.cbData.useTexture = (textureHandle > 0) ? 1.0f : 0.0f;
-            
-            D3D11_MAPPED_SUBRESOURCE ms{};
-            HRESULT hr = m_context->Map(shader.constantBuffer.Get(), 0, 
-                                        D3D11_MAP_WRITE_DISCARD, 0, &ms);
-            if (SUCCEEDED(hr)) {
-                CBData* cb = (CBData*)ms.pData;
-                *cb = shader.cbData;
-                m_context->Unmap(shader.constantBuffer.Get(), 0);
-            }
-
-            m_context->VSSetConstantBuffers(0, 1, shader.constantBuffer.GetAddressOf());
-            m_context->PSSetConstantBuffers(0, 1, shader.constantBuffer.GetAddressOf());
-        }
-
-        // Bind or unbind diffuse texture (slot 0)
-        if (textureHandle > 0) {
-            auto texIt = m_textures.find(textureHandle);
-            if (texIt != m_textures.end()) {
-                ID3D11ShaderResourceView* srv = texIt->second.srv.Get();
-                m_context->PSSetShaderResources(0, 1, &srv);
-            }
-        } else {
-            ID3D11ShaderResourceView* nullSRV = nullptr;
-            m_context->PSSetShaderResources(0, 1, &nullSRV);
-        }
-        
-        // Bind normal map to slot 1
-        if (m_boundNormalMap > 0) {
-            auto normalTexIt = m_textures.find(m_boundNormalMap);
-            if (normalTexIt != m_textures.end()) {
-                ID3D11ShaderResourceView* normalSrv = normalTexIt->second.srv.Get();
-                m_context->PSSetShaderResources(1, 1, &normalSrv);
-            }
-        } else {
-            ID3D11ShaderResourceView* nullSRV = nullptr;
-            m_context->PSSetShaderResources(1, 1, &nullSRV);
-        }
-
         D3D11Mesh& mesh = meshIt->second;
-        UINT stride = sizeof(Vertex);
-        UINT offset = 0;
-        m_context->IASetVertexBuffers(0, 1, mesh.vertexBuffer.GetAddressOf(), &stride, &offset);
-        m_context->IASetIndexBuffer(mesh.indexBuffer.Get(), DXGI_FORMAT_R16_UINT, 0);
-        m_context->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
-        m_context->DrawIndexed(mesh.indexCount, 0, 0);
+        bindDrawState(mesh, textureHandle, false);
+        setMeshBuffers(mesh);
+        m_context->DrawIndexed(mesh.indexCount, mesh.range.firstIndex, (INT)mesh.range.baseVertex);
+        m_stateCache.countDraw(mesh.indexCount);
     }
     
-    // Instanced drawing
+    // Instanced drawing: stream instances into slot 1, single DrawIndexedInstanced
     void drawMeshInstanced(uint32_t meshHandle, uint32_t textureHandle,
                           const InstanceData* instances, uint32_t instanceCount) override {
         if (instanceCount == 0 || !instances) return;
-        if (!m_hasViewProj) {
-            printf("D3D11: drawMeshInstanced called but no viewProj stored!\n");
-            return;
-        }
         
+        auto meshIt = m_meshes.find(meshHandle);
+        if (meshIt == m_meshes.end()) return;
         auto shaderIt = m_shaders.find(m_currentShader);
         if (shaderIt == m_shaders.end()) return;
         
-        static int debugCount = 0;
-        if (debugCount < 3) {
-            printf("D3D11 drawMeshInstanced: mesh=%u, tex=%u, count=%u\n", 
-                   meshHandle, textureHandle, instanceCount);
-            printf("  ViewProj stored: %d\n", m_hasViewProj ? 1 : 0);
-            debugCount++;
-        }
-        
-        // Set flag to prevent viewProj from being overwritten
-        m_inInstancedDraw = true;
-        
-        static bool printedTransform = false;
-        if (!printedTransform && instanceCount > 0) {
-            printf("D3D11: First instance transform:\n");
-            printf("  [%.2f %.2f %.2f %.2f]\n", 
-                   instances[0].worldMatrix.m[0], instances[0].worldMatrix.m[1],
-                   instances[0].worldMatrix.m[2], instances[0].worldMatrix.m[3]);
-            printf("  [%.2f %.2f %.2f %.2f]\n", 
-                   instances[0].worldMatrix.m[4], instances[0].worldMatrix.m[5],
-                   instances[0].worldMatrix.m[6], instances[0].worldMatrix.m[7]);
-            printf("  [%.2f %.2f %.2f %.2f]\n", 
-                   instances[0].worldMatrix.m[8], instances[0].worldMatrix.m[9],
-                   instances[0].worldMatrix.m[10], instances[0].worldMatrix.m[11]);
-            printf("  [%.2f %.2f %.2f %.2f]\n", 
-                   instances[0].worldMatrix.m[12], instances[0].worldMatrix.m[13],
-                   instances[0].worldMatrix.m[14], instances[0].worldMatrix.m[15]);
-            printedTransform = true;
-        }
-        
-        // Fallback implementation: draw one at a time using stored viewProj
-        for (uint32_t i = 0; i < instanceCount; i++) {
-            // World matrix from instance data needs to be transposed to match viewProj
-            XMMATRIX world = Mat4ToXM(instances[i].worldMatrix);
-            world = XMMatrixTranspose(world);
-            
-            // Both world and viewProj are transposed
-            // XMMatrixMultiply(A, B) computes A * B
-            // We have: world^T and viewProj^T
-            // We want: MVP = viewProj * world
-            // Since (AB)^T = B^T * A^T, we need: viewProj^T * world^T to get (world * viewProj)^T
-            // But we want (viewProj * world)^T, so we compute: world^T * viewProj^T
-            // Wait, that gives us (viewProj * world)^T which is what D3D expects!
-            XMMATRIX mvp = XMMatrixMultiply(m_viewProj, world);  // viewProj * world (both transposed)
-            
-            shaderIt->second.cbData.world = world;
-            shaderIt->second.cbData.mvp = mvp;
-            
-            drawMesh(meshHandle, textureHandle);
+        if (instanceCount > m_instanceCapacity) {
+            UINT newCapacity = m_instanceCapacity;
+            while (newCapacity < instanceCount) newCapacity *= 2;
+            if (!createInstanceBuffer(newCapacity)) return;
         }
         
-        m_inInstancedDraw = false;
+        // Append with NO_OVERWRITE while there is room, otherwise rename the buffer
+        D3D11_MAP mapType = D3D11_MAP_WRITE_NO_OVERWRITE;
+        if (m_instanceCursor == 0 || m_instanceCursor + instanceCount > m_instanceCapacity) {
+            mapType = D3D11_MAP_WRITE_DISCARD;
+            m_instanceCursor = 0;
+        }
+        
+        D3D11_MAPPED_SUBRESOURCE ms{};
+        HRESULT hr = m_context->Map(m_instanceBuffer.Get(), 0, mapType, 0, &ms);
+        if (FAILED(hr)) {
+            std::fprintf(stderr, "D3D11: Failed to map instance buffer\n");
+            return;
+        }
+        memcpy((InstanceData*)ms.pData + m_instanceCursor, instances,
+               instanceCount * sizeof(InstanceData));
+        m_context->Unmap(m_instanceBuffer.Get(), 0);
+        
+        UINT firstInstance = m_instanceCursor;
+        m_instanceCursor += instanceCount;
+        
+        // uMVP carries the view-projection; the shader applies the instance world
+        D3D11Mesh& mesh = meshIt->second;
+        bindDrawState(mesh, textureHandle, true);
+        
+        setMeshBuffers(mesh);
+        m_context->DrawIndexedInstanced(mesh.indexCount, instanceCount, mesh.range.firstIndex,
+                                        (INT)mesh.range.baseVertex, firstInstance);
+        m_stateCache.countDraw(mesh.indexCount, instanceCount);
     }
 
-    void setDepthTest(bool enable) override {
-        D3D11_DEPTH_STENCIL_DESC dsDesc{};
-        dsDesc.DepthEnable = enable ? TRUE : FALSE;
-        dsDesc.DepthWriteMask = D3D11_DEPTH_WRITE_MASK_ALL;
-        dsDesc.DepthFunc = D3D11_COMPARISON_LESS;
+    // One immediate context, so the batch is recorded on the calling thread
+    void drawInstancedBatch(const InstancedDraw* draws, uint32_t drawCount, JobSystem* jobs) override {
+        (void)jobs;
+        for (uint32_t i = 0; i < drawCount; i++) {
+            drawMeshInstanced(draws[i].meshHandle, draws[i].textureHandle,
+                              draws[i].instances, draws[i].instanceCount);
+        }
+    }
 
-        ComPtr<ID3D11DepthStencilState> dsState;
-        HRESULT hr = m_device->CreateDepthStencilState(&dsDesc, dsState.GetAddressOf());
-        if (SUCCEEDED(hr)) {
-            m_context->OMSetDepthStencilState(dsState.Get(), 0);
+    // No cull pass on this backend: every instance is drawn
+    bool supportsGpuCulling() const override { return false; }
+    void drawInstancedCulled(const InstancedDraw* draws, uint32_t drawCount, const Frustum& frustum) override {
+        (void)frustum;
+        drawInstancedBatch(draws, drawCount, nullptr);
+    }
+
+    void setDepthTest(bool enable) override {
+        if (!m_stateCache.set(STATE_RASTER, enable ? 1 : 0, 0)) return;
+        ComPtr<ID3D11DepthStencilState>& dsState = m_depthStates[enable ? 1 : 0];
+        if (!dsState) {
+            D3D11_DEPTH_STENCIL_DESC dsDesc{};
+            dsDesc.DepthEnable = enable ? TRUE : FALSE;
+            dsDesc.DepthWriteMask = D3D11_DEPTH_WRITE_MASK_ALL;
+            dsDesc.DepthFunc = D3D11_COMPARISON_LESS;
+            HRESULT hr = m_device->CreateDepthStencilState(&dsDesc, dsState.GetAddressOf());
+            if (FAILED(hr)) {
+                m_stateCache.invalidate(STATE_RASTER);
+                return;
+            }
         }
+        m_context->OMSetDepthStencilState(dsState.Get(), 0);
     }
 
     void setCulling(bool enable) override {
-        D3D11_RASTERIZER_DESC rsDesc{};
-        rsDesc.FillMode = D3D11_FILL_SOLID;
-        rsDesc.CullMode = enable ? D3D11_CULL_BACK : D3D11_CULL_NONE;
-        rsDesc.FrontCounterClockwise = TRUE;
-        rsDesc.DepthClipEnable = TRUE;
-
-        ComPtr<ID3D11RasterizerState> rsState;
-        HRESULT hr = m_device->CreateRasterizerState(&rsDesc, rsState.GetAddressOf());
-        if (SUCCEEDED(hr)) {
-            m_context->RSSetState(rsState.Get());
+        if (!m_stateCache.set(STATE_RASTER, enable ? 1 : 0, 1)) return;
+        ComPtr<ID3D11RasterizerState>& rsState = m_rasterStates[enable ? 1 : 0];
+        if (!rsState) {
+            D3D11_RASTERIZER_DESC rsDesc{};
+            rsDesc.FillMode = D3D11_FILL_SOLID;
+            rsDesc.CullMode = enable ? D3D11_CULL_BACK : D3D11_CULL_NONE;
+            rsDesc.FrontCounterClockwise = TRUE;
+            rsDesc.DepthClipEnable = TRUE;
+            HRESULT hr = m_device->CreateRasterizerState(&rsDesc, rsState.GetAddressOf());
+            if (FAILED(hr)) {
+                m_stateCache.invalidate(STATE_RASTER);
+                return;
+            }
         }
+        m_context->RSSetState(rsState.Get());
     }
+
+    void invalidateStateCache() override { m_stateCache.invalidate(); }
+
+    const RenderStateStats& getStateStats() const override { return m_stateCache.getStats(); }
+
+    void beginGpuZone(const char* name) override { writeTimestamp(m_gpuTimer.beginZone(name)); }
+    void endGpuZone() override { writeTimestamp(m_gpuTimer.endZone()); }
+    const GpuFrameTiming& getGpuTiming() const override { return m_gpuTimer.getLatest(); }
 };
 
 // ==================== Factory (Windows version) ====================
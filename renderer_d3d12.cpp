@@ -9,11 +9,17 @@
 #include <GLFW/glfw3native.h>
 
 #include "renderer.h"
+#include "render_state_cache.h"
+#include "gpu_timer.h"
+#include "job_system.h"
+#include "geometry_pool.h"
+#include "gpu_cull.h"
+#include "shader_cache.h"
+#include "debug.h"
 
 #include <d3d12.h>
 #include <dxgi1_6.h>
 #include <d3dcompiler.h>
-#include <DirectXMath.h>
 #include <wrl/client.h>
 
 #include <cstdio>
@@ -21,6 +27,8 @@
 #include <unordered_map>
 #include <cstring>
 #include <vector>
+#include <memory>
+#include <algorithm>
 
 #include "stb_image.h"
 #include "dds_loader.h"
@@ -30,17 +38,35 @@
 #pragma comment(lib, "d3dcompiler.lib")
 
 using Microsoft::WRL::ComPtr;
-using namespace DirectX;
 
 static const UINT FRAME_COUNT = 2;
-static const UINT MAX_TEXTURES = 64;  // Max textures we can have loaded
+static const UINT SRV_HEAP_SIZE = 4096;  // Shader-visible CBV/SRV heap: 0 = reserved, 1-2 = dummies, then textures
+static const UINT DUMMY_SRV_INDEX = 1;
+static const UINT DUMMY_ARRAY_SRV_INDEX = 2;             // The dummy again, viewed as a one-layer array
+static const UINT64 UPLOAD_PAGE_SIZE = 4 * 1024 * 1024;  // Per-frame upload page (grows by pages)
+static const UINT64 PASS_UPLOAD_PAGE_SIZE = 512 * 1024;   // Same, for worker pass recorders
+static const uint32_t MIN_DRAWS_PER_PASS = 32;            // Smaller batches are recorded inline
+static const UINT64 STAGING_RING_SIZE = 64 * 1024 * 1024; // Copy-queue staging ring
+static const UINT   UPLOAD_BATCH_COUNT = 4;               // Copy batches in flight
+static const UINT   CULL_GROUP_SIZE = 64;                 // Threads per cull dispatch group (CSCull)
+static const UINT   MIP_GROUP_SIZE = 8;                   // Threads per side of a mip dispatch group (CSMip)
 
 // ==================== D3D12 Texture ====================
+// A texture array is one entry plus one entry per layer sharing its
+// resource and SRV slot; destroying the array removes the layer entries too
 struct D3D12Texture {
     ComPtr<ID3D12Resource> resource;
     UINT srvDescriptorIndex;  // Index in descriptor heap
     int width;
     int height;
+    DXGI_FORMAT format = DXGI_FORMAT_R8G8B8A8_UNORM;
+    UINT mipLevels = 1;
+    UINT arraySize = 0;       // 0 = Texture2D, else layers of a Texture2DArray (bound at t2)
+    UINT layer = 0;
+    uint32_t arrayHandle = 0;            // Set on layer entries
+    std::vector<uint32_t> layerHandles;  // Set on the array entry
+    UINT64 uploadFence = 0;   // Copy-queue fence value that makes it ready
+    bool mipsPending = false; // Levels below the top not generated yet (generatePendingMips)
 };
 
 // ==================== Helper Functions ====================
@@ -78,6 +104,14 @@ inline D3D12_HEAP_PROPERTIES UploadHeapProps() {
     return props;
 }
 
+inline D3D12_HEAP_PROPERTIES ReadbackHeapProps() {
+    D3D12_HEAP_PROPERTIES props = {};
+    props.Type = D3D12_HEAP_TYPE_READBACK;
+    props.CreationNodeMask = 1;
+    props.VisibleNodeMask = 1;
+    return props;
+}
+
 inline D3D12_RESOURCE_DESC BufferDesc(UINT64 size) {
     D3D12_RESOURCE_DESC desc = {};
     desc.Dimension = D3D12_RESOURCE_DIMENSION_BUFFER;
@@ -91,6 +125,13 @@ inline D3D12_RESOURCE_DESC BufferDesc(UINT64 size) {
     return desc;
 }
 
+// Levels down to 1x1
+inline UINT FullMipCount(int width, int height) {
+    UINT levels = 1;
+    while (((width | height) >> levels) != 0) levels++;
+    return levels;
+}
+
 inline D3D12_RESOURCE_DESC Tex2DDesc(UINT width, UINT height, DXGI_FORMAT format) {
     D3D12_RESOURCE_DESC desc = {};
     desc.Dimension = D3D12_RESOURCE_DIMENSION_TEXTURE2D;
@@ -105,73 +146,685 @@ inline D3D12_RESOURCE_DESC Tex2DDesc(UINT width, UINT height, DXGI_FORMAT format
     return desc;
 }
 
+// ==================== Linear Upload Allocator ====================
+// Bump allocator over persistently mapped upload-heap pages. There is one per
+// frame in flight; reset() may only be called once that frame's fence has
+// completed. Pages are kept across resets, so steady state allocates nothing.
+class LinearUploadAllocator {
+public:
+    struct Allocation {
+        void* cpu;
+        D3D12_GPU_VIRTUAL_ADDRESS gpu;
+        ID3D12Resource* resource;   // Page, and offset into it, as a copy source
+        UINT64 offset;
+    };
+
+    bool initialize(ID3D12Device* device, UINT64 pageSize) {
+        m_device = device;
+        m_pageSize = pageSize;
+        reset();
+        return addPage(pageSize);
+    }
+
+    // Returns {nullptr, 0, ...} if a new page could not be created
+    Allocation allocate(UINT64 size, UINT64 alignment) {
+        UINT64 offset = (m_offset + alignment - 1) & ~(alignment - 1);
+        if (m_currentPage >= m_pages.size() || offset + size > m_pages[m_currentPage].size) {
+            // Move to the next page that fits, creating one if needed
+            m_currentPage++;
+            while (m_currentPage < m_pages.size() && m_pages[m_currentPage].size < size) {
+                m_currentPage++;
+            }
+            if (m_currentPage >= m_pages.size() && !addPage(size > m_pageSize ? size : m_pageSize)) {
+                return { nullptr, 0, nullptr, 0 };
+            }
+            offset = 0;
+        }
+
+        Page& page = m_pages[m_currentPage];
+        m_offset = offset + size;
+        m_usedBytes += size;
+        return { page.cpu + offset, page.gpu + offset, page.resource.Get(), offset };
+    }
+
+    void reset() {
+        m_currentPage = 0;
+        m_offset = 0;
+        m_usedBytes = 0;
+    }
+
+    void release() {
+        for (auto& page : m_pages) {
+            page.resource->Unmap(0, nullptr);
+        }
+        m_pages.clear();
+        reset();
+    }
+
+    UINT64 getUsedBytes() const { return m_usedBytes; }
+    size_t getPageCount() const { return m_pages.size(); }
+
+private:
+    struct Page {
+        ComPtr<ID3D12Resource> resource;
+        UINT8* cpu;
+        D3D12_GPU_VIRTUAL_ADDRESS gpu;
+        UINT64 size;
+    };
+
+    bool addPage(UINT64 size) {
+        Page page;
+        page.size = size;
+        D3D12_RESOURCE_DESC desc = BufferDesc(size);
+        D3D12_HEAP_PROPERTIES uploadProps = UploadHeapProps();
+        HRESULT hr = m_device->CreateCommittedResource(&uploadProps, D3D12_HEAP_FLAG_NONE,
+            &desc, D3D12_RESOURCE_STATE_GENERIC_READ, nullptr, IID_PPV_ARGS(&page.resource));
+        if (FAILED(hr)) {
+            std::fprintf(stderr, "D3D12: Failed to create upload page (%llu bytes)\n",
+                         (unsigned long long)size);
+            return false;
+        }
+
+        D3D12_RANGE readRange = {0, 0};  // CPU never reads
+        page.resource->Map(0, &readRange, reinterpret_cast<void**>(&page.cpu));
+        page.gpu = page.resource->GetGPUVirtualAddress();
+        m_pages.push_back(std::move(page));
+        return true;
+    }
+
+    ID3D12Device* m_device = nullptr;
+    std::vector<Page> m_pages;
+    size_t m_currentPage = 0;
+    UINT64 m_offset = 0;
+    UINT64 m_pageSize = 0;
+    UINT64 m_usedBytes = 0;
+};
+
+// ==================== Descriptor Allocator ====================
+// Free list of slots in a descriptor heap. Fresh slots are handed out in
+// order; released ones are reused first. The caller makes sure no submitted
+// frame still reads a slot before releasing it.
+class DescriptorAllocator {
+public:
+    static constexpr UINT INVALID = ~0u;
+
+    // Slots below 'firstFree' are never handed out
+    void initialize(UINT capacity, UINT firstFree) {
+        m_capacity = capacity;
+        m_next = firstFree;
+        m_free.clear();
+    }
+
+    UINT allocate() {
+        if (!m_free.empty()) {
+            UINT index = m_free.back();
+            m_free.pop_back();
+            return index;
+        }
+        return m_next < m_capacity ? m_next++ : INVALID;
+    }
+
+    void release(UINT index) { m_free.push_back(index); }
+
+    bool full() const { return m_free.empty() && m_next >= m_capacity; }
+    UINT capacity() const { return m_capacity; }
+
+private:
+    UINT m_capacity = 0;
+    UINT m_next = 0;
+    std::vector<UINT> m_free;
+};
+
+// ==================== Command Recorder ====================
+// A direct command list with an allocator and transient upload memory per
+// frame in flight, plus the shadow of what is bound on that list. A frame is
+// recorded into a sequence of these: the main one, one pass per worker for
+// each parallel batch, and a continuation after it; endFrame() submits them
+// in that order. Only one thread records into a recorder at a time.
+struct D3D12Recorder {
+    ComPtr<ID3D12GraphicsCommandList> list;
+    ComPtr<ID3D12CommandAllocator> allocators[FRAME_COUNT];
+    LinearUploadAllocator uploads[FRAME_COUNT];      // CB slices and instance streams
+    RenderStateCache stateCache;
+    DrawConstants lastConstants;                     // Block in the last CB slice on this list
+    D3D12_GPU_VIRTUAL_ADDRESS lastConstantsGpu = 0;
+    bool hasConstants = false;
+
+    bool initialize(ID3D12Device* device, UINT64 uploadPageSize) {
+        for (UINT i = 0; i < FRAME_COUNT; i++) {
+            if (FAILED(device->CreateCommandAllocator(D3D12_COMMAND_LIST_TYPE_DIRECT,
+                    IID_PPV_ARGS(&allocators[i])))) {
+                std::fprintf(stderr, "D3D12: Failed to create command allocator\n");
+                return false;
+            }
+            if (!uploads[i].initialize(device, uploadPageSize)) return false;
+        }
+        if (FAILED(device->CreateCommandList(0, D3D12_COMMAND_LIST_TYPE_DIRECT,
+                allocators[0].Get(), nullptr, IID_PPV_ARGS(&list)))) {
+            std::fprintf(stderr, "D3D12: Failed to create command list\n");
+            return false;
+        }
+        list->Close();
+        return true;
+    }
+
+    // Ready to record frame 'frameIndex'; its fence must have passed
+    void reset(UINT frameIndex) {
+        uploads[frameIndex].reset();
+        allocators[frameIndex]->Reset();
+        list->Reset(allocators[frameIndex].Get(), nullptr);
+        stateCache.invalidate();
+        hasConstants = false;
+    }
+
+    void release() {
+        for (UINT i = 0; i < FRAME_COUNT; i++) {
+            uploads[i].release();
+            allocators[i].Reset();
+        }
+        list.Reset();
+    }
+};
+
+inline void addStateStats(RenderStateStats& total, const RenderStateStats& stats) {
+    for (uint32_t slot = 0; slot < STATE_SLOT_COUNT; slot++) {
+        total.issued[slot] += stats.issued[slot];
+        total.skipped[slot] += stats.skipped[slot];
+    }
+    total.drawCalls += stats.drawCalls;
+    total.instances += stats.instances;
+    total.triangles += stats.triangles;
+}
+
+// ==================== Async Upload Queue ====================
+// Copy-queue uploads for textures and meshes. Source data is staged in a
+// persistently mapped ring buffer; copies are recorded into batches that are
+// submitted without waiting. Each batch signals the copy fence, and a resource
+// is "ready" once the CPU has observed its batch's fence value. Targets are
+// created in COMMON state: copy-queue writes decay back to COMMON and the
+// direct queue promotes them implicitly to the read state it needs.
+class D3D12UploadQueue {
+public:
+    struct Staging {
+        UINT8* cpu;
+        ID3D12Resource* resource;
+        UINT64 offset;
+    };
+
+    bool initialize(ID3D12Device* device, UINT64 ringSize) {
+        m_device = device;
+
+        D3D12_COMMAND_QUEUE_DESC queueDesc = {};
+        queueDesc.Type = D3D12_COMMAND_LIST_TYPE_COPY;
+        if (FAILED(m_device->CreateCommandQueue(&queueDesc, IID_PPV_ARGS(&m_queue)))) {
+            std::fprintf(stderr, "D3D12: Failed to create copy queue\n");
+            return false;
+        }
+
+        for (UINT i = 0; i < UPLOAD_BATCH_COUNT; i++) {
+            m_device->CreateCommandAllocator(D3D12_COMMAND_LIST_TYPE_COPY,
+                IID_PPV_ARGS(&m_batches[i].allocator));
+        }
+        m_device->CreateCommandList(0, D3D12_COMMAND_LIST_TYPE_COPY,
+            m_batches[0].allocator.Get(), nullptr, IID_PPV_ARGS(&m_commandList));
+        m_commandList->Close();
+
+        m_device->CreateFence(0, D3D12_FENCE_FLAG_NONE, IID_PPV_ARGS(&m_fence));
+        m_fenceEvent = CreateEvent(nullptr, FALSE, FALSE, nullptr);
+
+        D3D12_RESOURCE_DESC ringDesc = BufferDesc(ringSize);
+        D3D12_HEAP_PROPERTIES uploadProps = UploadHeapProps();
+        if (FAILED(m_device->CreateCommittedResource(&uploadProps, D3D12_HEAP_FLAG_NONE,
+                &ringDesc, D3D12_RESOURCE_STATE_GENERIC_READ, nullptr, IID_PPV_ARGS(&m_ring)))) {
+            std::fprintf(stderr, "D3D12: Failed to create staging ring\n");
+            return false;
+        }
+        D3D12_RANGE readRange = {0, 0};
+        m_ring->Map(0, &readRange, reinterpret_cast<void**>(&m_ringCpu));
+        m_ringSize = ringSize;
+        return true;
+    }
+
+    void shutdown() {
+        if (!m_queue) return;
+        waitIdle();
+        if (m_ring) m_ring->Unmap(0, nullptr);
+        m_ring.Reset();
+        m_commandList.Reset();
+        for (auto& b : m_batches) {
+            b.allocator.Reset();
+            b.tempBuffers.clear();
+        }
+        m_fence.Reset();
+        m_queue.Reset();
+        if (m_fenceEvent) {
+            CloseHandle(m_fenceEvent);
+            m_fenceEvent = nullptr;
+        }
+    }
+
+    // Staging memory for one copy. Large requests get a dedicated buffer that
+    // lives until the batch retires; everything else comes from the ring.
+    Staging allocateStaging(UINT64 size, UINT64 alignment) {
+        openBatch();
+        if (size > m_ringSize / 2) {
+            ComPtr<ID3D12Resource> temp;
+            D3D12_RESOURCE_DESC desc = BufferDesc(size);
+            D3D12_HEAP_PROPERTIES uploadProps = UploadHeapProps();
+            if (FAILED(m_device->CreateCommittedResource(&uploadProps, D3D12_HEAP_FLAG_NONE,
+                    &desc, D3D12_RESOURCE_STATE_GENERIC_READ, nullptr, IID_PPV_ARGS(&temp)))) {
+                return { nullptr, nullptr, 0 };
+            }
+            UINT8* cpu = nullptr;
+            D3D12_RANGE readRange = {0, 0};
+            temp->Map(0, &readRange, reinterpret_cast<void**>(&cpu));
+            Staging staging = { cpu, temp.Get(), 0 };
+            m_batches[m_openBatch].tempBuffers.push_back(temp);
+            m_openBytes += size;
+            return staging;
+        }
+
+        for (;;) {
+            if (m_ringUsed == 0) m_ringHead = 0;
+            UINT64 start = (m_ringHead + alignment - 1) & ~(alignment - 1);
+            UINT64 pad = start - m_ringHead;
+            if (start + size > m_ringSize) {
+                pad = m_ringSize - m_ringHead;  // Skip the tail end and wrap
+                start = 0;
+            }
+            if (m_ringUsed + pad + size <= m_ringSize) {
+                m_ringHead = start + size;
+                m_ringUsed += pad + size;
+                m_batches[m_openBatch].ringBytes += pad + size;
+                m_openBytes += size;
+                return { m_ringCpu + start, m_ring.Get(), start };
+            }
+            // Ring full: push out what we have and wait for the oldest batch
+            if (m_openBatch != NO_BATCH) submit();
+            if (!retireOldest(true)) return { nullptr, nullptr, 0 };
+            openBatch();
+        }
+    }
+
+    // Command list of the open batch (valid after allocateStaging)
+    ID3D12GraphicsCommandList* commandList() { return m_commandList.Get(); }
+
+    // Fence value the open batch will signal on submit
+    UINT64 pendingFenceValue() const { return m_nextFenceValue; }
+
+    // Submit the open batch without waiting. Returns its fence value (0 if empty).
+    UINT64 submit() {
+        if (m_openBatch == NO_BATCH) return 0;
+        Batch& batch = m_batches[m_openBatch];
+        m_commandList->Close();
+        ID3D12CommandList* lists[] = { m_commandList.Get() };
+        m_queue->ExecuteCommandLists(1, lists);
+        batch.fenceValue = m_nextFenceValue++;
+        m_queue->Signal(m_fence.Get(), batch.fenceValue);
+        m_inFlight[(m_inFlightHead + m_inFlightCount) % UPLOAD_BATCH_COUNT] = m_openBatch;
+        m_inFlightCount++;
+        m_openBatch = NO_BATCH;
+        m_openBytes = 0;
+        return batch.fenceValue;
+    }
+
+    // Submit once the open batch has grown past the threshold
+    void submitIfLarge(UINT64 thresholdBytes) {
+        if (m_openBytes >= thresholdBytes) submit();
+    }
+
+    bool isComplete(UINT64 fenceValue) const {
+        return fenceValue == 0 || m_fence->GetCompletedValue() >= fenceValue;
+    }
+
+    // Blocks until fenceValue is reached (submitting the open batch if needed)
+    void waitFor(UINT64 fenceValue) {
+        if (isComplete(fenceValue)) return;
+        if (m_openBatch != NO_BATCH && fenceValue >= m_nextFenceValue) submit();
+        m_fence->SetEventOnCompletion(fenceValue, m_fenceEvent);
+        WaitForSingleObject(m_fenceEvent, INFINITE);
+        retireCompleted();
+    }
+
+    void waitIdle() {
+        submit();
+        while (m_inFlightCount > 0) retireOldest(true);
+    }
+
+    // Recycle batches whose fence has passed (non-blocking)
+    void retireCompleted() {
+        while (m_inFlightCount > 0 && retireOldest(false)) {}
+    }
+
+    UINT getInFlightCount() const { return m_inFlightCount; }
+
+private:
+    static const UINT NO_BATCH = 0xFFFFFFFF;
+
+    struct Batch {
+        ComPtr<ID3D12CommandAllocator> allocator;
+        UINT64 fenceValue = 0;
+        UINT64 ringBytes = 0;   // Ring space to release when the batch retires
+        std::vector<ComPtr<ID3D12Resource>> tempBuffers;
+    };
+
+    void openBatch() {
+        if (m_openBatch != NO_BATCH) return;
+        retireCompleted();
+        if (m_inFlightCount == UPLOAD_BATCH_COUNT) retireOldest(true);
+
+        // Batches are used round-robin, so the next one is never still in flight here
+        UINT index = m_nextBatch;
+        Batch& batch = m_batches[index];
+        batch.allocator->Reset();
+        m_commandList->Reset(batch.allocator.Get(), nullptr);
+        batch.ringBytes = 0;
+        batch.tempBuffers.clear();
+        m_openBatch = index;
+        m_nextBatch = (index + 1) % UPLOAD_BATCH_COUNT;
+    }
+
+    bool retireOldest(bool wait) {
+        if (m_inFlightCount == 0) return false;
+        Batch& batch = m_batches[m_inFlight[m_inFlightHead]];
+        if (m_fence->GetCompletedValue() < batch.fenceValue) {
+            if (!wait) return false;
+            m_fence->SetEventOnCompletion(batch.fenceValue, m_fenceEvent);
+            WaitForSingleObject(m_fenceEvent, INFINITE);
+        }
+        m_ringUsed -= batch.ringBytes;
+        batch.ringBytes = 0;
+        batch.tempBuffers.clear();
+        m_inFlightHead = (m_inFlightHead + 1) % UPLOAD_BATCH_COUNT;
+        m_inFlightCount--;
+        return true;
+    }
+
+    ID3D12Device* m_device = nullptr;
+    ComPtr<ID3D12CommandQueue> m_queue;
+    ComPtr<ID3D12GraphicsCommandList> m_commandList;
+    ComPtr<ID3D12Fence> m_fence;
+    HANDLE m_fenceEvent = nullptr;
+    UINT64 m_nextFenceValue = 1;
+
+    Batch m_batches[UPLOAD_BATCH_COUNT];
+    UINT m_inFlight[UPLOAD_BATCH_COUNT] = {};  // FIFO of batch indices
+    UINT m_inFlightHead = 0;
+    UINT m_inFlightCount = 0;
+    UINT m_openBatch = NO_BATCH;
+    UINT m_nextBatch = 0;
+    UINT64 m_openBytes = 0;
+
+    ComPtr<ID3D12Resource> m_ring;
+    UINT8* m_ringCpu = nullptr;
+    UINT64 m_ringSize = 0;
+    UINT64 m_ringHead = 0;
+    UINT64 m_ringUsed = 0;
+};
+
+// 3-channel data is expanded into 'storage'; anything else is returned as-is
+static const uint8_t* ExpandToRGBA(const uint8_t* data, int width, int height, int channels,
+                                   std::vector<uint8_t>& storage) {
+    if (channels != 3) return data;
+    storage.resize((size_t)width * height * 4);
+    for (int i = 0; i < width * height; i++) {
+        storage[i * 4 + 0] = data[i * 3 + 0];
+        storage[i * 4 + 1] = data[i * 3 + 1];
+        storage[i * 4 + 2] = data[i * 3 + 2];
+        storage[i * 4 + 3] = 255;
+    }
+    return storage.data();
+}
+
 // ==================== D3D12 Mesh ====================
+// A range of a geometry pool block. The views cover the whole block, so
+// meshes sharing a block also share their IA bindings.
 struct D3D12Mesh {
-    ComPtr<ID3D12Resource> vertexBuffer;
-    ComPtr<ID3D12Resource> indexBuffer;
+    GeometryRange range;
     D3D12_VERTEX_BUFFER_VIEW vertexBufferView;
     D3D12_INDEX_BUFFER_VIEW indexBufferView;
     uint32_t indexCount;
+    bool packed = false;      // PackedVertex layout, drawn with the packed PSO
+    UINT64 uploadFence = 0;   // Copy-queue fence value that makes it ready
+    Vec4 bounds;              // Local bounding sphere, for GPU culling
 };
 
-// ==================== Constant Buffer ====================
-// lightDir and useTexture moved to root constants
-struct CBData {
-    XMMATRIX world;  // 64 bytes
-    // lightDir moved to root constant b2
-    // useTexture moved to root constant b3
+// Default-heap buffers in COMMON state. Buffers allow simultaneous access,
+// so the copy queue can fill a new range while the direct queue reads
+// others; a range is only handed out again after the GPU is done with it.
+struct D3D12GeometryBlock {
+    ComPtr<ID3D12Resource> vertexBuffer;
+    ComPtr<ID3D12Resource> indexBuffer;
 };
 
-// Helper to convert Mat4 to XMMATRIX
-static XMMATRIX Mat4ToXM(const Mat4& m) {
-    return XMMATRIX(
-        m.m[0], m.m[1], m.m[2], m.m[3],
-        m.m[4], m.m[5], m.m[6], m.m[7],
-        m.m[8], m.m[9], m.m[10], m.m[11],
-        m.m[12], m.m[13], m.m[14], m.m[15]
-    );
-}
+// ==================== D3D12 Cull Targets ====================
+// Outputs of the cull pass for one frame in flight, in COMMON state between
+// passes. Buffers that grow are kept in 'retired' until the frame's fence
+// passes, since lists recorded earlier in the frame may still use them.
+struct D3D12CullTargets {
+    ComPtr<ID3D12Resource> args;      // IndirectDrawArgs: UAV, then indirect arguments
+    ComPtr<ID3D12Resource> visible;   // Compacted InstanceData: UAV, then instance stream
+    UINT64 argsBytes = 0;
+    UINT64 visibleBytes = 0;
+    std::vector<ComPtr<ID3D12Resource>> retired;
+};
+
+// cbuffer CullConstants (b0) of CSCull
+struct D3D12CullConstants {
+    Vec4 planes[6];          // Frustum::planes
+    uint32_t instanceCount;
+    uint32_t padding[3];
+};
+
+// ==================== Pipeline Cache ====================
+// Driver-compiled PSOs kept across runs. They live in one
+// ID3D12PipelineLibrary, stored through ShaderCache under a key of the
+// adapter and its driver version, since no other driver can load them.
+// A PSO is looked up by a name derived from its inputs (pipelineKey()). On
+// a miss it is created and stored, and the library is written back at once,
+// so a process that never shuts down cleanly still warms the next start.
+// Without pipeline libraries (no ID3D12Device1, or the driver refuses) each
+// PSO's GetCachedBlob() is stored on its own and fed back via CachedPSO.
+class D3D12PipelineCache {
+public:
+    void initialize(ID3D12Device* device, IDXGIFactory4* factory) {
+        m_device = device;
+        m_hits = m_misses = 0;
+        m_dirty = false;
+
+        ShaderCacheKey key;
+        key.add("d3d12-pipelines");
+        ComPtr<IDXGIAdapter1> adapter;
+        DXGI_ADAPTER_DESC1 desc = {};
+        LARGE_INTEGER driverVersion = {};
+        if (factory && SUCCEEDED(factory->EnumAdapterByLuid(device->GetAdapterLuid(), IID_PPV_ARGS(&adapter)))) {
+            adapter->GetDesc1(&desc);
+            adapter->CheckInterfaceSupport(__uuidof(IDXGIDevice), &driverVersion);
+        }
+        key.add((uint64_t)desc.VendorId).add((uint64_t)desc.DeviceId).add((uint64_t)desc.SubSysId)
+           .add((uint64_t)desc.Revision).add((uint64_t)driverVersion.QuadPart);
+        m_adapterKey = key.value();
+
+        if (!ShaderCache::isEnabled() || FAILED(device->QueryInterface(IID_PPV_ARGS(&m_device1)))) return;
+        if (ShaderCache::load(m_adapterKey, ".psolib", m_libraryData)) {
+            // Refused after a driver update or on another GPU: start over
+            if (FAILED(m_device1->CreatePipelineLibrary(m_libraryData.data(), m_libraryData.size(),
+                                                        IID_PPV_ARGS(&m_library)))) {
+                m_libraryData.clear();
+            }
+        }
+        if (!m_library && FAILED(m_device1->CreatePipelineLibrary(nullptr, 0, IID_PPV_ARGS(&m_library)))) {
+            m_library.Reset();
+        }
+    }
+
+    HRESULT createGraphics(D3D12_GRAPHICS_PIPELINE_STATE_DESC& desc, uint64_t inputKey,
+                           ComPtr<ID3D12PipelineState>& out) {
+        return create(desc, inputKey, out,
+            [&](const wchar_t* name) {
+                return m_library->LoadGraphicsPipeline(name, &desc, IID_PPV_ARGS(out.ReleaseAndGetAddressOf()));
+            },
+            [&] { return m_device->CreateGraphicsPipelineState(&desc, IID_PPV_ARGS(out.ReleaseAndGetAddressOf())); });
+    }
+
+    HRESULT createCompute(D3D12_COMPUTE_PIPELINE_STATE_DESC& desc, uint64_t inputKey,
+                          ComPtr<ID3D12PipelineState>& out) {
+        return create(desc, inputKey, out,
+            [&](const wchar_t* name) {
+                return m_library->LoadComputePipeline(name, &desc, IID_PPV_ARGS(out.ReleaseAndGetAddressOf()));
+            },
+            [&] { return m_device->CreateComputePipelineState(&desc, IID_PPV_ARGS(out.ReleaseAndGetAddressOf())); });
+    }
+
+    // Writes the library back if PSOs were added since the last save
+    void save() {
+        if (!m_library || !m_dirty) return;
+        std::vector<uint8_t> data(m_library->GetSerializedSize());
+        if (!data.empty() && SUCCEEDED(m_library->Serialize(data.data(), data.size()))) {
+            ShaderCache::store(m_adapterKey, ".psolib", data.data(), data.size());
+        }
+        m_dirty = false;
+    }
+
+    void release() {
+        save();
+        m_library.Reset();
+        m_libraryData.clear();
+        m_device1.Reset();
+        m_device = nullptr;
+    }
+
+    uint32_t getHits() const { return m_hits; }
+    uint32_t getMisses() const { return m_misses; }
+
+    // Everything a graphics PSO is built from other than pointers; 'rootSignature'
+    // is the serialized root signature
+    static uint64_t pipelineKey(const D3D12_GRAPHICS_PIPELINE_STATE_DESC& desc, ID3DBlob* rootSignature) {
+        ShaderCacheKey key;
+        key.add(rootSignature->GetBufferPointer(), rootSignature->GetBufferSize());
+        key.add(desc.VS.pShaderBytecode, desc.VS.BytecodeLength);
+        key.add(desc.PS.pShaderBytecode, desc.PS.BytecodeLength);
+        for (UINT i = 0; i < desc.InputLayout.NumElements; i++) {
+            const D3D12_INPUT_ELEMENT_DESC& element = desc.InputLayout.pInputElementDescs[i];
+            key.add(element.SemanticName);
+            key.add(&element.SemanticIndex, sizeof(element) - offsetof(D3D12_INPUT_ELEMENT_DESC, SemanticIndex));
+        }
+        key.add(&desc.BlendState, sizeof(desc.BlendState));
+        key.add((uint64_t)desc.SampleMask);
+        key.add(&desc.RasterizerState, sizeof(desc.RasterizerState));
+        key.add(&desc.DepthStencilState, sizeof(desc.DepthStencilState));
+        key.add((uint64_t)desc.PrimitiveTopologyType).add((uint64_t)desc.NumRenderTargets);
+        key.add(desc.RTVFormats, sizeof(desc.RTVFormats));
+        key.add((uint64_t)desc.DSVFormat).add(&desc.SampleDesc, sizeof(desc.SampleDesc));
+        return key.value();
+    }
+
+    static uint64_t pipelineKey(const D3D12_COMPUTE_PIPELINE_STATE_DESC& desc, ID3DBlob* rootSignature) {
+        ShaderCacheKey key;
+        key.add(rootSignature->GetBufferPointer(), rootSignature->GetBufferSize());
+        key.add(desc.CS.pShaderBytecode, desc.CS.BytecodeLength);
+        return key.value();
+    }
+
+private:
+    template <typename Desc, typename LoadFn, typename CreateFn>
+    HRESULT create(Desc& desc, uint64_t inputKey, ComPtr<ID3D12PipelineState>& out,
+                   LoadFn&& load, CreateFn&& createNew) {
+        if (m_library) {
+            wchar_t name[24];
+            swprintf(name, 24, L"%016llx", (unsigned long long)inputKey);
+            if (SUCCEEDED(load(name))) {
+                m_hits++;
+                return S_OK;
+            }
+            HRESULT hr = createNew();
+            if (FAILED(hr)) return hr;
+            m_misses++;
+            if (SUCCEEDED(m_library->StorePipeline(name, out.Get()))) {
+                m_dirty = true;
+                save();
+            }
+            return hr;
+        }
+
+        uint64_t blobKey = ShaderCacheKey().add(m_adapterKey).add(inputKey).value();
+        std::vector<uint8_t> blob;
+        if (ShaderCache::load(blobKey, ".pso", blob)) {
+            desc.CachedPSO = { blob.data(), blob.size() };
+            HRESULT hr = createNew();
+            desc.CachedPSO = {};
+            if (SUCCEEDED(hr)) {
+                m_hits++;
+                return hr;
+            }
+            // Driver changed since the blob was stored: build from scratch
+        }
+        HRESULT hr = createNew();
+        if (FAILED(hr)) return hr;
+        m_misses++;
+        ComPtr<ID3DBlob> cached;
+        if (ShaderCache::isEnabled() && SUCCEEDED(out->GetCachedBlob(&cached))) {
+            ShaderCache::store(blobKey, ".pso", cached->GetBufferPointer(), cached->GetBufferSize());
+        }
+        return hr;
+    }
+
+    ID3D12Device* m_device = nullptr;
+    ComPtr<ID3D12Device1> m_device1;
+    ComPtr<ID3D12PipelineLibrary> m_library;
+    std::vector<uint8_t> m_libraryData;   // Backs m_library; must outlive it
+    uint64_t m_adapterKey = 0;
+    uint32_t m_hits = 0;
+    uint32_t m_misses = 0;
+    bool m_dirty = false;
+};
 
 // ==================== D3D12 Shader ====================
 struct D3D12Shader {
     ComPtr<ID3D12RootSignature> rootSignature;
     ComPtr<ID3D12PipelineState> pipelineState;
-    CBData cbData;
+    ComPtr<ID3D12PipelineState> pipelineStatePacked;  // Same shaders, PackedVertex input layout
+    DrawConstants drawConstants;                      // Copied to a fresh CB slice per draw
+    bool bindless = false;                            // Root layout: see createShader()
 };
 
 // ==================== HLSL Shader Source ====================
 static const char* g_hlslSrc = R"(
+// DrawConstants (renderer.h), one CB slice per draw
 cbuffer CB : register(b0)
 {
+    float4x4 uMVP;           // Full MVP, or view-projection when uInstanced is set
     float4x4 uWorld;
+    float3   uLightDir;
+    float    uUseTexture;
+    float    uUseNormalMap;
+    float    uInstanced;     // 1 = world/tint from the per-instance stream
+    float    uPackedVertex;  // 1 = octahedral aNrm.xy / aTangent.xy, bitangent sign in aTangent.z
+    float    uTextureLayer;  // Layer of ARRAY_MAP when uUseTexture = 2
 };
 
-// Root constants for MVP matrix (b1 register)
-cbuffer MVPConstants : register(b1)
+#ifdef BINDLESS
+// Every SRV in the heap, also viewed as arrays; each draw picks its three
+// by index (root constants)
+Texture2D      gTextures[]      : register(t0, space1);
+Texture2DArray gTextureArrays[] : register(t0, space2);
+cbuffer TextureIndices : register(b1)
 {
-    float4x4 uMVP;
+    uint uDiffuseIndex;
+    uint uNormalIndex;
+    uint uArrayIndex;
 };
-
-// Root constants for lightDir (b2 register)
-cbuffer LightDirConstant : register(b2)
-{
-    float3 uLightDir;
-};
-
-// Root constant for useTexture (b3 register)
-cbuffer UseTextureConstant : register(b3)
-{
-    float uUseTexture;
-};
-
-// Root constant for useNormalMap (b4 register)
-cbuffer UseNormalMapConstant : register(b4)
-{
-    float uUseNormalMap;
-};
-
-Texture2D    gTex        : register(t0);
-Texture2D    gNormalMap  : register(t1);  // Normal map
+#define DIFFUSE_MAP gTextures[uDiffuseIndex]
+#define NORMAL_MAP  gTextures[uNormalIndex]
+#define ARRAY_MAP   gTextureArrays[uArrayIndex]
+#else
+Texture2D      gTex        : register(t0);
+Texture2D      gNormalMap  : register(t1);  // Normal map
+Texture2DArray gTexArray   : register(t2);  // Texture array layers
+#define DIFFUSE_MAP gTex
+#define NORMAL_MAP  gNormalMap
+#define ARRAY_MAP   gTexArray
+#endif
 SamplerState gSampler    : register(s0);
 
 struct VSIn {
@@ -181,6 +834,12 @@ struct VSIn {
     float2 aTexCoord  : TEXCOORD0;
     float3 aTangent   : TANGENT;
     float3 aBitangent : BITANGENT;
+    // Per-instance stream (slot 1): column-major Mat4 columns + tint
+    float4 iWorld0    : INSTWORLD0;
+    float4 iWorld1    : INSTWORLD1;
+    float4 iWorld2    : INSTWORLD2;
+    float4 iWorld3    : INSTWORLD3;
+    float4 iTint      : INSTTINT;
 };
 
 struct VSOut {
@@ -189,21 +848,48 @@ struct VSOut {
     float4 col      : COLOR;
     float2 texCoord : TEXCOORD1;
     float3x3 TBN    : TEXCOORD2;  // TBN matrix (uses TEXCOORD2,3,4)
+    float4 tint     : TEXCOORD5;
 };
 
+float3 octDecode(float2 e)
+{
+    float3 n = float3(e, 1.0 - abs(e.x) - abs(e.y));
+    float t = saturate(-n.z);
+    n.xy += (n.xy >= 0.0) ? -t : t;
+    return normalize(n);
+}
+
 VSOut VSMain(VSIn v)
 {
     VSOut o;
-    o.pos = mul(float4(v.aPos, 1.0), uMVP);
+    float4x4 world = uWorld;
+    o.tint = float4(1.0, 1.0, 1.0, 1.0);
+    if (uInstanced > 0.5) {
+        // Rows of this matrix are the Mat4 columns, i.e. the same layout as uWorld
+        world = float4x4(v.iWorld0, v.iWorld1, v.iWorld2, v.iWorld3);
+        o.tint = v.iTint;
+        o.pos = mul(mul(float4(v.aPos, 1.0), world), uMVP);
+    } else {
+        o.pos = mul(float4(v.aPos, 1.0), uMVP);
+    }
+    
+    float3 nrm = v.aNrm;
+    float3 tan = v.aTangent;
+    float bSign = 1.0;
+    if (uPackedVertex > 0.5) {
+        nrm = octDecode(v.aNrm.xy);
+        tan = octDecode(v.aTangent.xy);
+        bSign = (v.aTangent.z < 0.0) ? -1.0 : 1.0;
+    }
     
     // Transform tangent space to world space
-    float3 T = normalize(mul(float4(v.aTangent, 0.0), uWorld).xyz);
-    float3 B = normalize(mul(float4(v.aBitangent, 0.0), uWorld).xyz);
-    float3 N = normalize(mul(float4(v.aNrm, 0.0), uWorld).xyz);
+    float3 T = normalize(mul(float4(tan, 0.0), world).xyz);
+    float3 B = normalize(mul(float4(v.aBitangent, 0.0), world).xyz);
+    float3 N = normalize(mul(float4(nrm, 0.0), world).xyz);
     
     // Re-orthogonalize using Gram-Schmidt
     T = normalize(T - dot(T, N) * N);
-    B = normalize(cross(N, T));
+    B = normalize(cross(N, T)) * bSign;
     
     // Build TBN matrix
     o.TBN = float3x3(T, B, N);
@@ -220,7 +906,7 @@ float4 PSMain(VSOut i) : SV_Target
     float3 N = i.nrmW;
     if (uUseNormalMap > 0.5) {
         // Sample normal map and convert from [0,1] to [-1,1]
-        float3 normalMapSample = gNormalMap.Sample(gSampler, i.texCoord).rgb;
+        float3 normalMapSample = NORMAL_MAP.Sample(gSampler, i.texCoord).rgb;
         float3 tangentNormal = normalize(normalMapSample * 2.0 - 1.0);
         
         // Transform to world space with orthogonalized TBN
@@ -238,11 +924,74 @@ float4 PSMain(VSOut i) : SV_Target
     
     // Choose base color: texture or vertex color
     float4 baseColor = i.col;
-    if (uUseTexture > 0.5) {
-        baseColor = gTex.Sample(gSampler, i.texCoord);
+    if (uUseTexture > 1.5) {
+        baseColor = ARRAY_MAP.Sample(gSampler, float3(i.texCoord, uTextureLayer));
+    } else if (uUseTexture > 0.5) {
+        baseColor = DIFFUSE_MAP.Sample(gSampler, i.texCoord);
     }
     
-    return float4(baseColor.rgb * diff, baseColor.a);
+    return float4(baseColor.rgb * i.tint.rgb * diff, baseColor.a);
+}
+)";
+
+// ==================== HLSL Mip Shader ====================
+// One thread per texel of the level being written, every layer at once: a
+// bilinear tap at the texel's centre in the level above averages its 2x2
+// footprint. The level above is bound as its own one-level view.
+static const char* g_hlslMipSrc = R"(
+Texture2DArray<float4>   gSrc    : register(t0);
+RWTexture2DArray<float4> gDst    : register(u0);
+SamplerState             gLinear : register(s0);
+
+[numthreads(8, 8, 1)]
+void CSMip(uint3 id : SV_DispatchThreadID)
+{
+    uint width, height, layers;
+    gDst.GetDimensions(width, height, layers);
+    if (id.x >= width || id.y >= height) return;
+    float2 uv = (float2(id.xy) + 0.5) / float2(width, height);
+    gDst[id] = gSrc.SampleLevel(gLinear, float3(uv, id.z), 0);
+}
+)";
+
+// ==================== HLSL Cull Shader ====================
+// One thread per instance of a GpuCullBatch (gpu_cull.h): tests the mesh
+// bounds moved by the instance's world matrix against the frustum and
+// appends survivors to their draw's range of the visible buffer
+static const char* g_hlslCullSrc = R"(
+cbuffer CullConstants : register(b0)
+{
+    float4 uPlanes[6];       // Frustum::planes, normals inward
+    uint   uInstanceCount;
+};
+
+struct Instance { float4 world0; float4 world1; float4 world2; float4 world3; float4 tint; };  // InstanceData, world by column
+
+StructuredBuffer<Instance>   gInstances : register(t0);
+StructuredBuffer<uint>       gDrawIds   : register(t1);
+StructuredBuffer<float4>     gBounds    : register(t2);
+RWByteAddressBuffer          gArgs      : register(u0);   // IndirectDrawArgs, 20 bytes each
+RWStructuredBuffer<Instance> gVisible   : register(u1);
+
+[numthreads(64, 1, 1)]
+void CSCull(uint3 id : SV_DispatchThreadID)
+{
+    uint i = id.x;
+    if (i >= uInstanceCount) return;
+
+    uint d = gDrawIds[i];
+    float4 b = gBounds[d];
+    Instance inst = gInstances[i];
+    float3 center = inst.world0.xyz * b.x + inst.world1.xyz * b.y + inst.world2.xyz * b.z + inst.world3.xyz;
+    float radius = b.w * sqrt(max(dot(inst.world0.xyz, inst.world0.xyz),
+                              max(dot(inst.world1.xyz, inst.world1.xyz), dot(inst.world2.xyz, inst.world2.xyz))));
+    [unroll] for (int p = 0; p < 6; p++) {
+        if (dot(uPlanes[p].xyz, center) + uPlanes[p].w < -radius) return;
+    }
+
+    uint slot;
+    gArgs.InterlockedAdd(d * 20 + 4, 1, slot);
+    gVisible[gArgs.Load(d * 20 + 16) + slot] = inst;
 }
 )";
 
@@ -256,17 +1005,24 @@ private:
     ComPtr<ID3D12DescriptorHeap>    m_rtvHeap;
     ComPtr<ID3D12DescriptorHeap>    m_dsvHeap;
     ComPtr<ID3D12DescriptorHeap>    m_cbvSrvHeap;  // CBV + SRV descriptors
+    DescriptorAllocator             m_srvAllocator;  // Texture slots in m_cbvSrvHeap
+    bool m_bindless = false;   // Textures indexed from one heap-wide table (resource binding tier 2+)
     ComPtr<ID3D12Resource>          m_renderTargets[FRAME_COUNT];
     ComPtr<ID3D12Resource>          m_depthStencil;
-    ComPtr<ID3D12CommandAllocator>  m_commandAllocators[FRAME_COUNT];
-    ComPtr<ID3D12GraphicsCommandList> m_commandList;
     
-    // Dedicated command list/allocator for uploads during initialization
-    ComPtr<ID3D12CommandAllocator> m_uploadAllocator;
-    ComPtr<ID3D12GraphicsCommandList> m_uploadCommandList;
-
-    ComPtr<ID3D12Resource> m_constantBuffers[FRAME_COUNT];  // One per frame!
-    UINT8* m_cbvDataBegin[FRAME_COUNT];                     // Mapped pointers
+    // Copy-queue uploads for textures and meshes (non-blocking)
+    D3D12UploadQueue m_uploadQueue;
+    D3D12Texture m_dummyTexture;  // 1x1 black, bound when a texture is missing or not yet ready
+
+    // Command recording. The first m_recordersUsed recorders were opened this
+    // frame, in submission order; m_rec is the one the renderer's thread is
+    // recording into. m_recorders[0] always exists and opens each frame.
+    std::vector<std::unique_ptr<D3D12Recorder>> m_recorders;
+    uint32_t m_recordersUsed = 0;
+    D3D12Recorder* m_rec = nullptr;
+    std::vector<ID3D12CommandList*> m_submitLists;   // Closed lists of this frame, in order
+    RenderStateStats m_frameStats;                   // Summed over the lists closed so far
+    RenderStateStats m_lastStats;
 
     ComPtr<ID3D12Fence> m_fence;
     UINT64 m_fenceValues[FRAME_COUNT];
@@ -279,29 +1035,73 @@ private:
     UINT m_frameIndex;
 
     std::unordered_map<uint32_t, D3D12Mesh>    m_meshes;
+    GeometryPool m_geometryPool;                       // Sub-allocates every mesh
+    std::vector<D3D12GeometryBlock> m_geometryBlocks;  // Parallel to the pool's blocks
+    // Ranges of destroyed meshes, returned to the pool once the direct queue
+    // passes the fence of the frame that destroyed them
+    struct RetiredRange {
+        GeometryRange range;
+        UINT64 fenceValue;
+    };
+    std::vector<RetiredRange> m_retiredRanges;
     std::unordered_map<uint32_t, D3D12Shader>  m_shaders;
     std::unordered_map<uint32_t, D3D12Texture> m_textures;
+    D3D12PipelineCache m_pipelineCache;
+    uint32_t m_shaderCacheHits = 0;   // Stages loaded from ShaderCache
+    uint32_t m_shaderCompiles = 0;
 
     uint32_t m_nextMeshHandle    = 1;
     uint32_t m_nextShaderHandle  = 1;
     uint32_t m_nextTextureHandle = 1;
     uint32_t m_currentShader     = 0;
-    UINT     m_nextSrvIndex      = 2;  // Start at 2 (0=CBV, 1=dummy texture)
 
     int m_width  = 1280;
     int m_height = 720;
     float m_clearColor[4] = {0,0,0,1};
+    UINT  m_syncInterval  = 1;   // Present() interval: 1 = vsync, 0 = immediate
+
+    // Low latency: the swap chain queues one frame and signals
+    // m_frameLatencyWaitable when it can take the next
+    bool   m_lowLatency       = false;
+    bool   m_allowTearing     = false;   // Requested
+    bool   m_tearingSupported = false;   // DXGI_FEATURE_PRESENT_ALLOW_TEARING, and requested
+    UINT   m_swapChainFlags   = 0;       // Repeated on ResizeBuffers()
+    HANDLE m_frameLatencyWaitable = nullptr;
     
-    // Store view-projection for instanced rendering
-    XMMATRIX m_viewProj;
-    bool m_hasViewProj = false;
-    bool m_inInstancedDraw = false;
-    bool m_skipCBUpdate = false;  // Skip CB update in drawMesh when we've already done it
     bool m_depthTestEnabled  = true;
     bool m_cullingEnabled    = false;
     
     // Store normal map binding
     uint32_t m_boundNormalMap = 0;
+    
+    // Timestamps: one query heap entry per GpuTimerRing index, resolved into
+    // a readback buffer at endFrame and read once that frame's fence passes
+    GpuTimerRing m_gpuTimer;
+    ComPtr<ID3D12QueryHeap> m_timestampHeap;
+    ComPtr<ID3D12Resource>  m_timestampReadback;
+    UINT64 m_timestampFrequency = 0;
+    UINT64 m_timestampFences[GpuTimerRing::FRAMES] = {};
+
+    // GPU culling: compute PSO over root CBV/SRV/UAV arguments, and a
+    // command signature for DrawIndexedInstanced argument buffers
+    ComPtr<ID3D12RootSignature>    m_cullRootSignature;
+    ComPtr<ID3D12PipelineState>    m_cullPipeline;
+    ComPtr<ID3D12CommandSignature> m_drawIndexedSignature;
+    D3D12CullTargets m_cullTargets[FRAME_COUNT];
+    GpuCullBatch m_cullBatch;
+    
+    // Mip generation: compute PSO over an SRV and a UAV table. Textures
+    // wait in m_pendingMips until their copy lands; the per-level views are
+    // heap slots that go back to m_srvAllocator once the frame's fence passes.
+    ComPtr<ID3D12RootSignature> m_mipRootSignature;
+    ComPtr<ID3D12PipelineState> m_mipPipeline;
+    std::vector<uint32_t> m_pendingMips;
+    struct RetiredDescriptor {
+        UINT index;
+        UINT64 fenceValue;
+    };
+    std::vector<RetiredDescriptor> m_retiredDescriptors;
+    
 
     // ==== Helpers ====
     HWND getHWND(GLFWwindow* w) { return glfwGetWin32Window(w); }
@@ -353,6 +1153,53 @@ private:
         }
     }
 
+    // Timing is optional: on failure the renderer runs without it
+    bool createTimestampQueries() {
+        D3D12_QUERY_HEAP_DESC heapDesc = {};
+        heapDesc.Type  = D3D12_QUERY_HEAP_TYPE_TIMESTAMP;
+        heapDesc.Count = GpuTimerRing::QUERY_COUNT;
+        if (FAILED(m_device->CreateQueryHeap(&heapDesc, IID_PPV_ARGS(&m_timestampHeap)))) return false;
+
+        D3D12_HEAP_PROPERTIES heapProps = ReadbackHeapProps();
+        D3D12_RESOURCE_DESC desc = BufferDesc(sizeof(UINT64) * GpuTimerRing::QUERY_COUNT);
+        if (FAILED(m_device->CreateCommittedResource(&heapProps, D3D12_HEAP_FLAG_NONE, &desc,
+                D3D12_RESOURCE_STATE_COPY_DEST, nullptr, IID_PPV_ARGS(&m_timestampReadback))) ||
+            FAILED(m_commandQueue->GetTimestampFrequency(&m_timestampFrequency))) {
+            m_timestampHeap.Reset();
+            m_timestampReadback.Reset();
+            return false;
+        }
+        return true;
+    }
+
+    void writeTimestamp(uint32_t query) {
+        if (m_timestampHeap && query != GpuTimerRing::NO_QUERY) {
+            m_rec->list->EndQuery(m_timestampHeap.Get(), D3D12_QUERY_TYPE_TIMESTAMP, query);
+        }
+    }
+
+    // Frames whose fence has passed have their ticks in the readback buffer
+    void resolveTimestamps() {
+        if (!m_timestampHeap) return;
+        int slot;
+        while ((slot = m_gpuTimer.oldestPending()) >= 0 &&
+               m_fence->GetCompletedValue() >= m_timestampFences[slot]) {
+            UINT64 first = GpuTimerRing::query((uint32_t)slot, 0);
+            D3D12_RANGE readRange = { (SIZE_T)(first * sizeof(UINT64)),
+                                      (SIZE_T)((first + m_gpuTimer.stampCount((uint32_t)slot)) * sizeof(UINT64)) };
+            void* mapped = nullptr;
+            if (FAILED(m_timestampReadback->Map(0, &readRange, &mapped))) {
+                m_gpuTimer.discard((uint32_t)slot);
+                continue;
+            }
+            const UINT64* ticks = (const UINT64*)mapped;
+            m_gpuTimer.resolve((uint32_t)slot, [ticks](uint32_t query) { return (uint64_t)ticks[query]; },
+                               (double)m_timestampFrequency);
+            D3D12_RANGE noWrites = { 0, 0 };
+            m_timestampReadback->Unmap(0, &noWrites);
+        }
+    }
+
     void moveToNextFrame() {
         const UINT64 currentFenceValue = m_currentFenceValue;
         m_commandQueue->Signal(m_fence.Get(), currentFenceValue);
@@ -360,37 +1207,713 @@ private:
 
         m_frameIndex = m_swapChain->GetCurrentBackBufferIndex();
 
-        if (m_fence->GetCompletedValue() < m_fenceValues[m_frameIndex]) {
-            m_fence->SetEventOnCompletion(m_fenceValues[m_frameIndex], m_fenceEvent);
-            WaitForSingleObject(m_fenceEvent, INFINITE);
+        if (m_fence->GetCompletedValue() < m_fenceValues[m_frameIndex]) {
+            m_fence->SetEventOnCompletion(m_fenceValues[m_frameIndex], m_fenceEvent);
+            WaitForSingleObject(m_fenceEvent, INFINITE);
+        }
+
+        m_fenceValues[m_frameIndex] = currentFenceValue;
+    }
+
+    // Create a COMMON-state default-heap RGBA8 texture and record its copy
+    // on the upload queue. Does not wait: tex.uploadFence tells when it is usable.
+    bool uploadTexture2D(D3D12Texture& tex, const uint8_t* rgba, int w, int h) {
+        return uploadTexture(tex, &rgba, 0, w, h);
+    }
+
+    // Same for a Texture2DArray of 'arraySize' layers (0 = plain Texture2D).
+    // Only each layer's top level is copied; with the mip pipeline the
+    // resource has a full chain, which generatePendingMips() fills once the
+    // copy has landed.
+    bool uploadTexture(D3D12Texture& tex, const uint8_t* const* layers, UINT arraySize, int w, int h) {
+        UINT layerCount = arraySize ? arraySize : 1;
+        tex.width     = w;
+        tex.height    = h;
+        tex.arraySize = arraySize;
+        tex.mipLevels = m_mipPipeline ? FullMipCount(w, h) : 1;
+        tex.mipsPending = tex.mipLevels > 1;
+
+        D3D12_RESOURCE_DESC texDesc = Tex2DDesc(w, h, DXGI_FORMAT_R8G8B8A8_UNORM);
+        texDesc.DepthOrArraySize = (UINT16)layerCount;
+        texDesc.MipLevels        = (UINT16)tex.mipLevels;
+        if (tex.mipsPending) texDesc.Flags = D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS;
+        D3D12_HEAP_PROPERTIES defaultProps = DefaultHeapProps();
+        HRESULT hr = m_device->CreateCommittedResource(&defaultProps, D3D12_HEAP_FLAG_NONE,
+            &texDesc, D3D12_RESOURCE_STATE_COMMON, nullptr, IID_PPV_ARGS(&tex.resource));
+        if (FAILED(hr)) {
+            std::fprintf(stderr, "D3D12: Failed to create texture %dx%d (%u layers)\n", w, h, layerCount);
+            return false;
+        }
+
+        // Row pitch must be 256-byte aligned, placement 512-byte aligned;
+        // subresources are numbered mip-major within each layer
+        std::vector<D3D12_PLACED_SUBRESOURCE_FOOTPRINT> footprints(layerCount);
+        UINT64 totalBytes = 0;
+        for (UINT layer = 0; layer < layerCount; layer++) {
+            UINT64 layerBytes = 0;
+            m_device->GetCopyableFootprints(&texDesc, layer * tex.mipLevels, 1, totalBytes,
+                                            &footprints[layer], nullptr, nullptr, &layerBytes);
+            totalBytes = (footprints[layer].Offset + layerBytes + D3D12_TEXTURE_DATA_PLACEMENT_ALIGNMENT - 1) &
+                         ~(UINT64)(D3D12_TEXTURE_DATA_PLACEMENT_ALIGNMENT - 1);
+        }
+
+        D3D12UploadQueue::Staging staging =
+            m_uploadQueue.allocateStaging(totalBytes, D3D12_TEXTURE_DATA_PLACEMENT_ALIGNMENT);
+        if (!staging.cpu) {
+            std::fprintf(stderr, "D3D12: Out of staging memory for texture %dx%d\n", w, h);
+            return false;
+        }
+
+        for (UINT layer = 0; layer < layerCount; layer++) {
+            D3D12_PLACED_SUBRESOURCE_FOOTPRINT& footprint = footprints[layer];
+            UINT rowPitch = footprint.Footprint.RowPitch;
+            for (int y = 0; y < h; y++) {
+                memcpy(staging.cpu + footprint.Offset + y * rowPitch,
+                       layers[layer] + (size_t)y * w * 4, (size_t)w * 4);
+            }
+            footprint.Offset += staging.offset;
+
+            D3D12_TEXTURE_COPY_LOCATION srcLoc = {};
+            srcLoc.pResource        = staging.resource;
+            srcLoc.Type             = D3D12_TEXTURE_COPY_TYPE_PLACED_FOOTPRINT;
+            srcLoc.PlacedFootprint  = footprint;
+
+            D3D12_TEXTURE_COPY_LOCATION dstLoc = {};
+            dstLoc.pResource = tex.resource.Get();
+            dstLoc.Type      = D3D12_TEXTURE_COPY_TYPE_SUBRESOURCE_INDEX;
+            dstLoc.SubresourceIndex = layer * tex.mipLevels;
+
+            m_uploadQueue.commandList()->CopyTextureRegion(&dstLoc, 0, 0, 0, &srcLoc, nullptr);
+        }
+        tex.uploadFence = m_uploadQueue.pendingFenceValue();
+        m_uploadQueue.submitIfLarge(STAGING_RING_SIZE / 4);
+        return true;
+    }
+
+    // Block-compressed texture with its full mip chain, uploaded as-is
+    bool uploadCompressedTexture(D3D12Texture& tex, DXGI_FORMAT format,
+                                 const CompressedMip* mips, uint32_t mipCount) {
+        tex.width     = mips[0].width;
+        tex.height    = mips[0].height;
+        tex.format    = format;
+        tex.mipLevels = mipCount;
+
+        D3D12_RESOURCE_DESC texDesc = Tex2DDesc(tex.width, tex.height, format);
+        texDesc.MipLevels = (UINT16)mipCount;
+        D3D12_HEAP_PROPERTIES defaultProps = DefaultHeapProps();
+        HRESULT hr = m_device->CreateCommittedResource(&defaultProps, D3D12_HEAP_FLAG_NONE,
+            &texDesc, D3D12_RESOURCE_STATE_COMMON, nullptr, IID_PPV_ARGS(&tex.resource));
+        if (FAILED(hr)) {
+            std::fprintf(stderr, "D3D12: Failed to create compressed texture %dx%d\n", tex.width, tex.height);
+            return false;
+        }
+
+        std::vector<D3D12_PLACED_SUBRESOURCE_FOOTPRINT> footprints(mipCount);
+        std::vector<UINT> numRows(mipCount);
+        std::vector<UINT64> rowSizes(mipCount);
+        UINT64 totalBytes = 0;
+        m_device->GetCopyableFootprints(&texDesc, 0, mipCount, 0, footprints.data(),
+                                        numRows.data(), rowSizes.data(), &totalBytes);
+
+        D3D12UploadQueue::Staging staging =
+            m_uploadQueue.allocateStaging(totalBytes, D3D12_TEXTURE_DATA_PLACEMENT_ALIGNMENT);
+        if (!staging.cpu) {
+            std::fprintf(stderr, "D3D12: Out of staging memory for texture %dx%d\n", tex.width, tex.height);
+            return false;
+        }
+
+        ID3D12GraphicsCommandList* copyList = m_uploadQueue.commandList();
+        for (uint32_t level = 0; level < mipCount; level++) {
+            // Rows here are rows of 4x4 blocks
+            D3D12_PLACED_SUBRESOURCE_FOOTPRINT& fp = footprints[level];
+            for (UINT row = 0; row < numRows[level]; row++) {
+                memcpy(staging.cpu + fp.Offset + row * fp.Footprint.RowPitch,
+                       mips[level].data + (size_t)row * mips[level].rowPitch, (size_t)rowSizes[level]);
+            }
+            fp.Offset += staging.offset;
+
+            D3D12_TEXTURE_COPY_LOCATION srcLoc = {};
+            srcLoc.pResource       = staging.resource;
+            srcLoc.Type            = D3D12_TEXTURE_COPY_TYPE_PLACED_FOOTPRINT;
+            srcLoc.PlacedFootprint = fp;
+
+            D3D12_TEXTURE_COPY_LOCATION dstLoc = {};
+            dstLoc.pResource        = tex.resource.Get();
+            dstLoc.Type             = D3D12_TEXTURE_COPY_TYPE_SUBRESOURCE_INDEX;
+            dstLoc.SubresourceIndex = level;
+
+            copyList->CopyTextureRegion(&dstLoc, 0, 0, 0, &srcLoc, nullptr);
+        }
+        tex.uploadFence = m_uploadQueue.pendingFenceValue();
+        m_uploadQueue.submitIfLarge(STAGING_RING_SIZE / 4);
+        return true;
+    }
+
+    bool createDefaultBuffer(UINT64 size, ComPtr<ID3D12Resource>& out,
+                             D3D12_RESOURCE_FLAGS flags = D3D12_RESOURCE_FLAG_NONE) {
+        D3D12_RESOURCE_DESC desc = BufferDesc(size);
+        desc.Flags = flags;
+        D3D12_HEAP_PROPERTIES defaultProps = DefaultHeapProps();
+        HRESULT hr = m_device->CreateCommittedResource(&defaultProps, D3D12_HEAP_FLAG_NONE,
+            &desc, D3D12_RESOURCE_STATE_COMMON, nullptr, IID_PPV_ARGS(out.ReleaseAndGetAddressOf()));
+        return SUCCEEDED(hr);
+    }
+
+    // Fills part of a default-heap buffer through the upload queue
+    bool uploadBufferRegion(ID3D12Resource* dst, UINT64 offset, const void* data, UINT size) {
+        D3D12UploadQueue::Staging staging = m_uploadQueue.allocateStaging(size, 16);
+        if (!staging.cpu) return false;
+        memcpy(staging.cpu, data, size);
+        m_uploadQueue.commandList()->CopyBufferRegion(dst, offset, staging.resource, staging.offset, size);
+        return true;
+    }
+
+    // arraySize 0 = Texture2D view, else a Texture2DArray view of that many layers
+    void createTextureSRV(ID3D12Resource* resource, UINT descriptorIndex,
+                          DXGI_FORMAT format = DXGI_FORMAT_R8G8B8A8_UNORM, UINT mipLevels = 1,
+                          UINT arraySize = 0) {
+        D3D12_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
+        srvDesc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
+        srvDesc.Format                  = format;
+        if (arraySize) {
+            srvDesc.ViewDimension            = D3D12_SRV_DIMENSION_TEXTURE2DARRAY;
+            srvDesc.Texture2DArray.MipLevels = mipLevels;
+            srvDesc.Texture2DArray.ArraySize = arraySize;
+        } else {
+            srvDesc.ViewDimension        = D3D12_SRV_DIMENSION_TEXTURE2D;
+            srvDesc.Texture2D.MipLevels  = mipLevels;
+        }
+        m_device->CreateShaderResourceView(resource, &srvDesc, heapCpuHandle(descriptorIndex));
+    }
+
+    D3D12_CPU_DESCRIPTOR_HANDLE heapCpuHandle(UINT descriptorIndex) const {
+        D3D12_CPU_DESCRIPTOR_HANDLE handle = m_cbvSrvHeap->GetCPUDescriptorHandleForHeapStart();
+        handle.ptr += descriptorIndex * m_cbvSrvDescriptorSize;
+        return handle;
+    }
+
+    D3D12_GPU_DESCRIPTOR_HANDLE heapGpuHandle(UINT descriptorIndex) const {
+        D3D12_GPU_DESCRIPTOR_HANDLE handle = m_cbvSrvHeap->GetGPUDescriptorHandleForHeapStart();
+        handle.ptr += descriptorIndex * m_cbvSrvDescriptorSize;
+        return handle;
+    }
+
+    // Takes an SRV slot; the caller checked m_srvAllocator.full() beforehand
+    uint32_t registerTexture(D3D12Texture&& tex) {
+        tex.srvDescriptorIndex = m_srvAllocator.allocate();
+        if (tex.srvDescriptorIndex == DescriptorAllocator::INVALID) return 0;
+        createTextureSRV(tex.resource.Get(), tex.srvDescriptorIndex, tex.format, tex.mipLevels, tex.arraySize);
+        uint32_t handle = m_nextTextureHandle++;
+        if (tex.mipsPending) m_pendingMips.push_back(handle);
+        m_textures[handle] = std::move(tex);
+        return handle;
+    }
+
+    // ---- Mip generation ----
+    // Fills the chains of textures whose top level has landed, on the
+    // frame's first list ahead of any draw
+    void generatePendingMips(D3D12Recorder& rec) {
+        if (m_pendingMips.empty()) return;
+        ID3D12GraphicsCommandList* list = rec.list.Get();
+        bool bound = false;
+        size_t kept = 0;
+        std::vector<UINT> views;
+        for (size_t i = 0; i < m_pendingMips.size(); i++) {
+            uint32_t handle = m_pendingMips[i];
+            auto it = m_textures.find(handle);
+            if (it == m_textures.end() || !it->second.mipsPending) continue;   // Destroyed
+            D3D12Texture& tex = it->second;
+            if (!m_uploadQueue.isComplete(tex.uploadFence)) {
+                m_pendingMips[kept++] = handle;
+                continue;
+            }
+
+            // An SRV of the level above and a UAV of the level written, per level
+            views.assign(2 * (tex.mipLevels - 1), DescriptorAllocator::INVALID);
+            bool allocated = true;
+            for (UINT& view : views) {
+                view = m_srvAllocator.allocate();
+                allocated &= view != DescriptorAllocator::INVALID;
+            }
+            if (!allocated) {
+                for (UINT view : views) {
+                    if (view != DescriptorAllocator::INVALID) m_srvAllocator.release(view);
+                }
+                m_pendingMips[kept++] = handle;   // Try again once slots free up
+                continue;
+            }
+
+            if (!bound) {
+                if (rec.stateCache.set(STATE_SHADER, (uintptr_t)m_cbvSrvHeap.Get(), 1)) {
+                    ID3D12DescriptorHeap* heaps[] = { m_cbvSrvHeap.Get() };
+                    list->SetDescriptorHeaps(1, heaps);
+                    rec.stateCache.invalidate(STATE_TEXTURE);
+                }
+                list->SetComputeRootSignature(m_mipRootSignature.Get());
+                list->SetPipelineState(m_mipPipeline.Get());
+                rec.stateCache.invalidate(STATE_PIPELINE);   // The first draw sets a graphics PSO again
+                bound = true;
+            }
+            recordMipChain(list, tex, views.data());
+            for (UINT view : views) m_retiredDescriptors.push_back({ view, m_currentFenceValue });
+
+            tex.mipsPending = false;
+            for (uint32_t layer : tex.layerHandles) {
+                auto layerIt = m_textures.find(layer);
+                if (layerIt != m_textures.end()) layerIt->second.mipsPending = false;
+            }
+        }
+        m_pendingMips.resize(kept);
+    }
+
+    // Level by level: the level above goes to NON_PIXEL_SHADER_RESOURCE and
+    // is sampled, the level itself is written as a UAV. The texture ends up
+    // back in COMMON, where draws promote it like any other texture.
+    void recordMipChain(ID3D12GraphicsCommandList* list, const D3D12Texture& tex, const UINT* views) {
+        ID3D12Resource* resource = tex.resource.Get();
+        UINT layers = tex.arraySize ? tex.arraySize : 1;
+        std::vector<D3D12_RESOURCE_BARRIER> barriers(layers);
+        auto levelToShaderResource = [&](UINT level) {
+            for (UINT layer = 0; layer < layers; layer++) {
+                barriers[layer] = TransitionBarrier(resource, D3D12_RESOURCE_STATE_UNORDERED_ACCESS,
+                                                    D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+                barriers[layer].Transition.Subresource = level + layer * tex.mipLevels;
+            }
+            list->ResourceBarrier(layers, barriers.data());
+        };
+
+        D3D12_RESOURCE_BARRIER all = TransitionBarrier(resource, D3D12_RESOURCE_STATE_COMMON,
+                                                       D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+        list->ResourceBarrier(1, &all);
+        for (UINT level = 1; level < tex.mipLevels; level++) {
+            levelToShaderResource(level - 1);
+
+            UINT srvIndex = views[2 * (level - 1)];
+            UINT uavIndex = views[2 * (level - 1) + 1];
+            D3D12_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
+            srvDesc.Shader4ComponentMapping          = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
+            srvDesc.Format                           = tex.format;
+            srvDesc.ViewDimension                    = D3D12_SRV_DIMENSION_TEXTURE2DARRAY;
+            srvDesc.Texture2DArray.MostDetailedMip   = level - 1;
+            srvDesc.Texture2DArray.MipLevels         = 1;
+            srvDesc.Texture2DArray.ArraySize         = layers;
+            m_device->CreateShaderResourceView(resource, &srvDesc, heapCpuHandle(srvIndex));
+
+            D3D12_UNORDERED_ACCESS_VIEW_DESC uavDesc = {};
+            uavDesc.Format                   = tex.format;
+            uavDesc.ViewDimension            = D3D12_UAV_DIMENSION_TEXTURE2DARRAY;
+            uavDesc.Texture2DArray.MipSlice  = level;
+            uavDesc.Texture2DArray.ArraySize = layers;
+            m_device->CreateUnorderedAccessView(resource, nullptr, &uavDesc, heapCpuHandle(uavIndex));
+
+            list->SetComputeRootDescriptorTable(0, heapGpuHandle(srvIndex));
+            list->SetComputeRootDescriptorTable(1, heapGpuHandle(uavIndex));
+            UINT w = (std::max)(1u, (UINT)tex.width >> level);
+            UINT h = (std::max)(1u, (UINT)tex.height >> level);
+            list->Dispatch((w + MIP_GROUP_SIZE - 1) / MIP_GROUP_SIZE, (h + MIP_GROUP_SIZE - 1) / MIP_GROUP_SIZE, layers);
+        }
+        levelToShaderResource(tex.mipLevels - 1);
+        all = TransitionBarrier(resource, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE,
+                                D3D12_RESOURCE_STATE_COMMON);
+        list->ResourceBarrier(1, &all);
+    }
+
+    void freeRetiredDescriptors(UINT64 completedFence) {
+        size_t kept = 0;
+        for (const RetiredDescriptor& retired : m_retiredDescriptors) {
+            if (retired.fenceValue <= completedFence) m_srvAllocator.release(retired.index);
+            else m_retiredDescriptors[kept++] = retired;
+        }
+        m_retiredDescriptors.resize(kept);
+    }
+
+    // Mip pass objects; without them RGBA textures keep a single level
+    bool createMipPipeline() {
+        ComPtr<ID3DBlob> csBlob;
+        if (!compileShader(g_hlslMipSrc, "CSMip", "cs_5_0", csBlob)) return false;
+
+        // [0] = SRV table (t0) of the level above, [1] = UAV table (u0) of the level written
+        D3D12_DESCRIPTOR_RANGE ranges[2] = {};
+        ranges[0].RangeType      = D3D12_DESCRIPTOR_RANGE_TYPE_SRV;
+        ranges[1].RangeType      = D3D12_DESCRIPTOR_RANGE_TYPE_UAV;
+        D3D12_ROOT_PARAMETER rootParams[2] = {};
+        for (int i = 0; i < 2; i++) {
+            ranges[i].NumDescriptors = 1;
+            rootParams[i].ParameterType = D3D12_ROOT_PARAMETER_TYPE_DESCRIPTOR_TABLE;
+            rootParams[i].DescriptorTable.NumDescriptorRanges = 1;
+            rootParams[i].DescriptorTable.pDescriptorRanges   = &ranges[i];
+            rootParams[i].ShaderVisibility = D3D12_SHADER_VISIBILITY_ALL;
+        }
+
+        D3D12_STATIC_SAMPLER_DESC sampler = {};
+        sampler.Filter         = D3D12_FILTER_MIN_MAG_MIP_LINEAR;
+        sampler.AddressU       = D3D12_TEXTURE_ADDRESS_MODE_CLAMP;
+        sampler.AddressV       = D3D12_TEXTURE_ADDRESS_MODE_CLAMP;
+        sampler.AddressW       = D3D12_TEXTURE_ADDRESS_MODE_CLAMP;
+        sampler.MaxLOD         = D3D12_FLOAT32_MAX;
+        sampler.ShaderRegister = 0;
+        sampler.ShaderVisibility = D3D12_SHADER_VISIBILITY_ALL;
+
+        D3D12_ROOT_SIGNATURE_DESC rsDesc = {};
+        rsDesc.NumParameters     = 2;
+        rsDesc.pParameters       = rootParams;
+        rsDesc.NumStaticSamplers = 1;
+        rsDesc.pStaticSamplers   = &sampler;
+
+        ComPtr<ID3DBlob> signature, error;
+        HRESULT hr = D3D12SerializeRootSignature(&rsDesc, D3D_ROOT_SIGNATURE_VERSION_1,
+                                                 &signature, &error);
+        if (FAILED(hr)) {
+            if (error) {
+                std::fprintf(stderr, "Mip root signature serialization failed: %s\n",
+                             (const char*)error->GetBufferPointer());
+            }
+            return false;
+        }
+        hr = m_device->CreateRootSignature(0, signature->GetBufferPointer(), signature->GetBufferSize(),
+                                           IID_PPV_ARGS(&m_mipRootSignature));
+        if (FAILED(hr)) return false;
+
+        D3D12_COMPUTE_PIPELINE_STATE_DESC psoDesc = {};
+        psoDesc.pRootSignature = m_mipRootSignature.Get();
+        psoDesc.CS = { csBlob->GetBufferPointer(), csBlob->GetBufferSize() };
+        hr = m_pipelineCache.createCompute(psoDesc, D3D12PipelineCache::pipelineKey(psoDesc, signature.Get()),
+                                           m_mipPipeline);
+        return SUCCEEDED(hr);
+    }
+
+    // ---- Recorders ----
+    // Grow the pool to 'count' recorders; pass recorders (all but the first)
+    // get smaller upload pages since each holds only part of a batch
+    bool ensureRecorders(size_t count) {
+        while (m_recorders.size() < count) {
+            std::unique_ptr<D3D12Recorder> rec(new D3D12Recorder());
+            UINT64 pageSize = m_recorders.empty() ? UPLOAD_PAGE_SIZE : PASS_UPLOAD_PAGE_SIZE;
+            if (!rec->initialize(m_device.Get(), pageSize)) return false;
+            m_recorders.push_back(std::move(rec));
+        }
+        return true;
+    }
+
+    // Next recorder of this frame, reset and targeting the back buffer.
+    // ensureRecorders() must already cover it.
+    D3D12Recorder& openRecorder() {
+        D3D12Recorder& rec = *m_recorders[m_recordersUsed++];
+        rec.reset(m_frameIndex);
+
+        D3D12_CPU_DESCRIPTOR_HANDLE rtvHandle = backBufferRtv();
+        D3D12_CPU_DESCRIPTOR_HANDLE dsvHandle = m_dsvHeap->GetCPUDescriptorHandleForHeapStart();
+        rec.list->OMSetRenderTargets(1, &rtvHandle, FALSE, &dsvHandle);
+
+        D3D12_VIEWPORT vp = { 0, 0, (float)m_width, (float)m_height, 0, 1 };
+        D3D12_RECT scissor = { 0, 0, (LONG)m_width, (LONG)m_height };
+        rec.list->RSSetViewports(1, &vp);
+        rec.list->RSSetScissorRects(1, &scissor);
+        return rec;
+    }
+
+    // Appends the list to this frame's submission and counts its binds
+    void closeRecorder(D3D12Recorder& rec) {
+        rec.list->Close();
+        m_submitLists.push_back(rec.list.Get());
+        rec.stateCache.beginFrame();
+        addStateStats(m_frameStats, rec.stateCache.getStats());
+    }
+
+    D3D12_CPU_DESCRIPTOR_HANDLE backBufferRtv() const {
+        D3D12_CPU_DESCRIPTOR_HANDLE rtvHandle = m_rtvHeap->GetCPUDescriptorHandleForHeapStart();
+        rtvHandle.ptr += m_frameIndex * m_rtvDescriptorSize;
+        return rtvHandle;
+    }
+
+    // Write the shader's DrawConstants plus this draw's flags into a fresh
+    // 256-byte slice of the recorder's upload memory (matrices transposed
+    // for HLSL) and bind it as the root CBV (b0). A block identical to the
+    // last one written on this list reuses that slice.
+    bool bindConstantBuffer(D3D12Recorder& rec, const D3D12Shader& shader, const D3D12Mesh& mesh,
+                            uint32_t textureHandle, bool instanced) {
+        const D3D12Texture* texture = findTexture(textureHandle);
+        bool layered = texture && texture->arraySize > 0;
+        DrawConstants constants = shader.drawConstants;
+        mat4_transposeBatch(&constants.mvp, &constants.mvp, 2);   // mvp, then world
+        constants.useTexture = layered ? 2.0f : ((textureHandle > 0) ? 1.0f : 0.0f);
+        constants.textureLayer = layered ? (float)texture->layer : 0.0f;
+        constants.instanced = instanced ? 1.0f : 0.0f;
+        constants.packedVertex = mesh.packed ? 1.0f : 0.0f;
+        
+        bool changed = !rec.hasConstants ||
+            memcmp(&constants, &rec.lastConstants, sizeof(DrawConstants)) != 0;
+        rec.stateCache.count(STATE_CONSTANTS, changed);
+        if (changed) {
+            LinearUploadAllocator::Allocation cb = rec.uploads[m_frameIndex].allocate(
+                CalcConstantBufferByteSize(sizeof(DrawConstants)),
+                D3D12_CONSTANT_BUFFER_DATA_PLACEMENT_ALIGNMENT);
+            if (!cb.cpu) return false;
+            memcpy(cb.cpu, &constants, sizeof(DrawConstants));
+            rec.lastConstants = constants;
+            rec.lastConstantsGpu = cb.gpu;
+            rec.hasConstants = true;
+        }
+        // Root arguments don't survive a root signature change, so this can
+        // rebind an old slice even when its contents were reused
+        if (rec.stateCache.set(STATE_CONSTANTS, rec.lastConstantsGpu)) {
+            rec.list->SetGraphicsRootConstantBufferView(0, rec.lastConstantsGpu);
+        }
+        return true;
+    }
+
+    // ---- Cached binds ----
+    void setPipelineState(D3D12Recorder& rec, ID3D12PipelineState* pso) {
+        if (rec.stateCache.set(STATE_PIPELINE, (uintptr_t)pso, 0)) rec.list->SetPipelineState(pso);
+    }
+
+    void setDescriptorTable(D3D12Recorder& rec, UINT rootParam, D3D12_GPU_DESCRIPTOR_HANDLE table) {
+        if (rec.stateCache.set(STATE_TEXTURE, table.ptr, rootParam)) {
+            rec.list->SetGraphicsRootDescriptorTable(rootParam, table);
+        }
+    }
+
+    // Mesh stream in slot 0; slot 1 is the instance stream (or the mesh VB
+    // again for plain draws, where uInstanced = 0 ignores it), then indices
+    void setMeshBuffers(D3D12Recorder& rec, const D3D12Mesh& mesh, const D3D12_VERTEX_BUFFER_VIEW& slot1) {
+        if (rec.stateCache.set(STATE_PIPELINE, D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST, 1)) {
+            rec.list->IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+        }
+        bool changed = rec.stateCache.set(STATE_VERTEX_INPUT, mesh.vertexBufferView.BufferLocation, 0);
+        changed |= rec.stateCache.set(STATE_VERTEX_INPUT, slot1.BufferLocation, 1);
+        if (changed) {
+            D3D12_VERTEX_BUFFER_VIEW vbViews[2] = { mesh.vertexBufferView, slot1 };
+            rec.list->IASetVertexBuffers(0, 2, vbViews);
+        }
+        if (rec.stateCache.set(STATE_VERTEX_INPUT, mesh.indexBufferView.BufferLocation, 2)) {
+            rec.list->IASetIndexBuffer(&mesh.indexBufferView);
+        }
+    }
+
+    // Root signature, descriptor heap and default PSO of a shader
+    void bindShader(D3D12Recorder& rec, const D3D12Shader& s) {
+        setPipelineState(rec, s.pipelineState.Get());
+        if (rec.stateCache.set(STATE_SHADER, (uintptr_t)s.rootSignature.Get(), 0)) {
+            rec.list->SetGraphicsRootSignature(s.rootSignature.Get());
+            // A new root signature leaves every root argument undefined
+            rec.stateCache.invalidate(STATE_CONSTANTS);
+            rec.stateCache.invalidate(STATE_TEXTURE);
+        }
+
+        if (rec.stateCache.set(STATE_SHADER, (uintptr_t)m_cbvSrvHeap.Get(), 1)) {
+            ID3D12DescriptorHeap* heaps[] = { m_cbvSrvHeap.Get() };
+            rec.list->SetDescriptorHeaps(1, heaps);
+            rec.stateCache.invalidate(STATE_TEXTURE);
+        }
+
+    }
+
+    // The PSO whose input layout matches the mesh
+    void bindVertexFormat(D3D12Recorder& rec, const D3D12Shader& shader, const D3D12Mesh& mesh) {
+        setPipelineState(rec, mesh.packed ? shader.pipelineStatePacked.Get() : shader.pipelineState.Get());
+    }
+
+    const D3D12Texture* findTexture(uint32_t textureHandle) const {
+        if (textureHandle == 0) return nullptr;
+        auto texIt = m_textures.find(textureHandle);
+        return texIt != m_textures.end() ? &texIt->second : nullptr;
+    }
+
+    // SRV slot of a texture, or the dummy while it is missing, uploading or
+    // waiting for its mips
+    UINT textureSrvIndex(const D3D12Texture* texture, UINT dummyIndex = DUMMY_SRV_INDEX) const {
+        if (!texture || !m_uploadQueue.isComplete(texture->uploadFence) || texture->mipsPending) {
+            return dummyIndex;
+        }
+        return texture->srvDescriptorIndex;
+    }
+
+    // Bindless shaders get the diffuse, normal map and texture array slots
+    // as three root constants (b1). Otherwise they are descriptor tables of
+    // one SRV each: diffuse in root param 1, normal map in root param 2,
+    // array in root param 3. A layer of an array goes to the array slot and
+    // leaves the dummy in the diffuse one (and the other way round), so
+    // draws of layers of one array bind nothing new.
+    void bindTextureTables(D3D12Recorder& rec, const D3D12Shader& shader, uint32_t textureHandle) {
+        const D3D12Texture* texture = findTexture(textureHandle);
+        bool layered = texture && texture->arraySize > 0;
+        UINT diffuseIndex = textureSrvIndex(layered ? nullptr : texture);
+        UINT normalIndex = textureSrvIndex(findTexture(m_boundNormalMap));
+        UINT arrayIndex = textureSrvIndex(layered ? texture : nullptr, DUMMY_ARRAY_SRV_INDEX);
+        if (shader.bindless) {
+            // The table spans the whole heap, so it is set once per list
+            setDescriptorTable(rec, 1, m_cbvSrvHeap->GetGPUDescriptorHandleForHeapStart());
+            bool changed = rec.stateCache.set(STATE_TEXTURE, ((uint64_t)normalIndex << 32) | diffuseIndex, 2);
+            changed |= rec.stateCache.set(STATE_TEXTURE, arrayIndex, 3);
+            if (changed) {
+                UINT indices[3] = { diffuseIndex, normalIndex, arrayIndex };
+                rec.list->SetGraphicsRoot32BitConstants(2, 3, indices, 0);
+            }
+            return;
+        }
+
+        setDescriptorTable(rec, 1, heapGpuHandle(diffuseIndex));
+        setDescriptorTable(rec, 2, heapGpuHandle(normalIndex));
+        setDescriptorTable(rec, 3, heapGpuHandle(arrayIndex));
+    }
+
+    // Instances are appended to the recorder's upload memory and drawn with
+    // a single DrawIndexedInstanced. Only reads renderer state, so workers
+    // can run this concurrently on their own recorders.
+    void recordInstanced(D3D12Recorder& rec, const D3D12Shader& shader, const InstancedDraw& draw) {
+        if (draw.instanceCount == 0 || !draw.instances) return;
+        auto meshIt = m_meshes.find(draw.meshHandle);
+        if (meshIt == m_meshes.end()) return;
+        if (!m_uploadQueue.isComplete(meshIt->second.uploadFence)) return;  // Still uploading
+        
+        UINT instanceBytes = draw.instanceCount * sizeof(InstanceData);
+        LinearUploadAllocator::Allocation inst = rec.uploads[m_frameIndex].allocate(instanceBytes, 16);
+        if (!inst.cpu) return;
+        memcpy(inst.cpu, draw.instances, instanceBytes);
+        
+        D3D12_VERTEX_BUFFER_VIEW instView = {};
+        instView.BufferLocation = inst.gpu;
+        instView.SizeInBytes    = instanceBytes;
+        instView.StrideInBytes  = sizeof(InstanceData);
+        
+        // uMVP carries the view-projection; the shader applies the instance world
+        const D3D12Mesh& mesh = meshIt->second;
+        if (!bindConstantBuffer(rec, shader, mesh, draw.textureHandle, true)) return;
+        bindVertexFormat(rec, shader, mesh);
+        
+        bindTextureTables(rec, shader, draw.textureHandle);
+        
+        setMeshBuffers(rec, mesh, instView);
+        rec.list->DrawIndexedInstanced(mesh.indexCount, draw.instanceCount, mesh.range.firstIndex,
+                                       (INT)mesh.range.baseVertex, 0);
+        rec.stateCache.countDraw(mesh.indexCount, draw.instanceCount);
+    }
+
+    // Cull pass objects; without them drawInstancedCulled() draws everything
+    bool createCullPipeline() {
+        ComPtr<ID3DBlob> csBlob;
+        if (!compileShader(g_hlslCullSrc, "CSCull", "cs_5_0", csBlob)) return false;
+
+        // [0] = CBV(b0) CullConstants, [1..3] = SRV(t0..t2) instances, draw
+        // ids, bounds, [4..5] = UAV(u0..u1) args, visible instances
+        D3D12_ROOT_PARAMETER rootParams[6] = {};
+        const D3D12_ROOT_PARAMETER_TYPE types[6] = {
+            D3D12_ROOT_PARAMETER_TYPE_CBV, D3D12_ROOT_PARAMETER_TYPE_SRV, D3D12_ROOT_PARAMETER_TYPE_SRV,
+            D3D12_ROOT_PARAMETER_TYPE_SRV, D3D12_ROOT_PARAMETER_TYPE_UAV, D3D12_ROOT_PARAMETER_TYPE_UAV };
+        const UINT registers[6] = { 0, 0, 1, 2, 0, 1 };
+        for (int i = 0; i < 6; i++) {
+            rootParams[i].ParameterType = types[i];
+            rootParams[i].Descriptor.ShaderRegister = registers[i];
+            rootParams[i].ShaderVisibility = D3D12_SHADER_VISIBILITY_ALL;
+        }
+
+        D3D12_ROOT_SIGNATURE_DESC rsDesc = {};
+        rsDesc.NumParameters = 6;
+        rsDesc.pParameters   = rootParams;
+
+        ComPtr<ID3DBlob> signature, error;
+        HRESULT hr = D3D12SerializeRootSignature(&rsDesc, D3D_ROOT_SIGNATURE_VERSION_1,
+                                                 &signature, &error);
+        if (FAILED(hr)) {
+            if (error) {
+                std::fprintf(stderr, "Cull root signature serialization failed: %s\n",
+                             (const char*)error->GetBufferPointer());
+            }
+            return false;
+        }
+        hr = m_device->CreateRootSignature(0, signature->GetBufferPointer(), signature->GetBufferSize(),
+                                           IID_PPV_ARGS(&m_cullRootSignature));
+        if (FAILED(hr)) return false;
+
+        D3D12_COMPUTE_PIPELINE_STATE_DESC psoDesc = {};
+        psoDesc.pRootSignature = m_cullRootSignature.Get();
+        psoDesc.CS = { csBlob->GetBufferPointer(), csBlob->GetBufferSize() };
+        hr = m_pipelineCache.createCompute(psoDesc, D3D12PipelineCache::pipelineKey(psoDesc, signature.Get()),
+                                           m_cullPipeline);
+        if (FAILED(hr)) return false;
+
+        // Argument buffers hold bare IndirectDrawArgs, so no root signature
+        D3D12_INDIRECT_ARGUMENT_DESC argDesc = {};
+        argDesc.Type = D3D12_INDIRECT_ARGUMENT_TYPE_DRAW_INDEXED;
+        D3D12_COMMAND_SIGNATURE_DESC sigDesc = {};
+        sigDesc.ByteStride       = sizeof(IndirectDrawArgs);
+        sigDesc.NumArgumentDescs = 1;
+        sigDesc.pArgumentDescs   = &argDesc;
+        hr = m_device->CreateCommandSignature(&sigDesc, nullptr, IID_PPV_ARGS(&m_drawIndexedSignature));
+        return SUCCEEDED(hr);
+    }
+
+    // Grows a frame's cull targets to hold a pass. Lists recorded earlier
+    // this frame may still use the old buffers, so they are retired.
+    bool ensureCullTargets(D3D12CullTargets& targets, UINT64 argsBytes, UINT64 visibleBytes) {
+        const D3D12_RESOURCE_FLAGS uav = D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS;
+        if (targets.argsBytes < argsBytes) {
+            UINT64 size = (std::max)(argsBytes, targets.argsBytes * 2);
+            if (targets.args) targets.retired.push_back(std::move(targets.args));
+            targets.argsBytes = 0;
+            if (!createDefaultBuffer(size, targets.args, uav)) return false;
+            targets.argsBytes = size;
+        }
+        if (targets.visibleBytes < visibleBytes) {
+            UINT64 size = (std::max)(visibleBytes, targets.visibleBytes * 2);
+            if (targets.visible) targets.retired.push_back(std::move(targets.visible));
+            targets.visibleBytes = 0;
+            if (!createDefaultBuffer(size, targets.visible, uav)) return false;
+            targets.visibleBytes = size;
         }
+        return true;
+    }
 
-        m_fenceValues[m_frameIndex] = currentFenceValue;
+    // Copies a cull pass input into this frame's upload memory
+    LinearUploadAllocator::Allocation uploadCullInput(D3D12Recorder& rec, const void* data,
+                                                      UINT64 size, UINT64 alignment) {
+        LinearUploadAllocator::Allocation a = rec.uploads[m_frameIndex].allocate(size, alignment);
+        if (a.cpu) memcpy(a.cpu, data, size);
+        return a;
     }
 
+    // Bytecode comes from the shader cache when the same source, entry,
+    // target, defines, flags and compiler version were compiled before
     bool compileShader(const char* src, const char* entry, const char* target,
-                       ComPtr<ID3DBlob>& out) {
+                       ComPtr<ID3DBlob>& out, const D3D_SHADER_MACRO* defines = nullptr) {
         UINT flags = D3DCOMPILE_ENABLE_STRICTNESS;
 #ifdef _DEBUG
         flags |= D3DCOMPILE_DEBUG | D3DCOMPILE_SKIP_OPTIMIZATION;
 #endif
+        ShaderCacheKey key;
+        key.add(src).add(entry).add(target).add((uint64_t)flags).add((uint64_t)D3D_COMPILER_VERSION);
+        for (const D3D_SHADER_MACRO* define = defines; define && define->Name; define++) {
+            key.add(define->Name).add(define->Definition);
+        }
+        std::vector<uint8_t> cached;
+        if (ShaderCache::load(key.value(), ".dxbc", cached) &&
+            SUCCEEDED(D3DCreateBlob(cached.size(), out.ReleaseAndGetAddressOf()))) {
+            memcpy(out->GetBufferPointer(), cached.data(), cached.size());
+            m_shaderCacheHits++;
+            return true;
+        }
+
         ComPtr<ID3DBlob> err;
-        HRESULT hr = D3DCompile(src, strlen(src), nullptr, nullptr, nullptr,
-                                entry, target, flags, 0, out.GetAddressOf(),
+        HRESULT hr = D3DCompile(src, strlen(src), nullptr, defines, nullptr,
+                                entry, target, flags, 0, out.ReleaseAndGetAddressOf(),
                                 err.GetAddressOf());
         if (FAILED(hr)) {
             if (err) std::fprintf(stderr, "Shader error: %s\n",
                                   (const char*)err->GetBufferPointer());
             return false;
         }
+        m_shaderCompiles++;
+        ShaderCache::store(key.value(), ".dxbc", out->GetBufferPointer(), out->GetBufferSize());
         return true;
     }
 
 public:
-    D3D12Renderer() : m_currentFenceValue(1), m_frameIndex(0) {
+    D3D12Renderer()
+        : m_currentFenceValue(1)
+        , m_frameIndex(0)
+        , m_geometryPool(GEOMETRY_VERTEX_BLOCK_BYTES, GEOMETRY_INDEX_BLOCK_BYTES) {
         for (UINT i = 0; i < FRAME_COUNT; i++) {
             m_fenceValues[i] = 0;
-            m_cbvDataBegin[i] = nullptr;
         }
     }
 
@@ -426,6 +1949,7 @@ public:
         // Swap chain
         ComPtr<IDXGIFactory4> factory;
         CreateDXGIFactory1(IID_PPV_ARGS(&factory));
+        m_pipelineCache.initialize(m_device.Get(), factory.Get());
 
         DXGI_SWAP_CHAIN_DESC1 scDesc = {};
         scDesc.Width       = m_width;
@@ -436,12 +1960,37 @@ public:
         scDesc.BufferCount = FRAME_COUNT;
         scDesc.SwapEffect  = DXGI_SWAP_EFFECT_FLIP_DISCARD;
 
+        ComPtr<IDXGIFactory5> factory5;
+        BOOL tearing = FALSE;
+        if (m_allowTearing && SUCCEEDED(factory.As(&factory5)) &&
+            SUCCEEDED(factory5->CheckFeatureSupport(DXGI_FEATURE_PRESENT_ALLOW_TEARING, &tearing, sizeof(tearing)))) {
+            m_tearingSupported = tearing == TRUE;
+        }
+        m_swapChainFlags = 0;
+        if (m_lowLatency) m_swapChainFlags |= DXGI_SWAP_CHAIN_FLAG_FRAME_LATENCY_WAITABLE_OBJECT;
+        if (m_tearingSupported) m_swapChainFlags |= DXGI_SWAP_CHAIN_FLAG_ALLOW_TEARING;
+        scDesc.Flags = m_swapChainFlags;
+
         ComPtr<IDXGISwapChain1> sc1;
-        factory->CreateSwapChainForHwnd(m_commandQueue.Get(), m_hwnd, &scDesc,
-                                       nullptr, nullptr, &sc1);
-        sc1.As(&m_swapChain);
+        hr = factory->CreateSwapChainForHwnd(m_commandQueue.Get(), m_hwnd, &scDesc,
+                                            nullptr, nullptr, &sc1);
+        if (FAILED(hr) || FAILED(sc1.As(&m_swapChain))) {
+            std::fprintf(stderr, "D3D12: Failed to create swap chain\n");
+            return false;
+        }
+        // GLFW handles fullscreen; DXGI's Alt+Enter would fight it
+        factory->MakeWindowAssociation(m_hwnd, DXGI_MWA_NO_ALT_ENTER);
         m_frameIndex = m_swapChain->GetCurrentBackBufferIndex();
 
+        // The fences still keep FRAME_COUNT frames of command allocators in
+        // flight; the waitable object limits how many wait for display
+        if (m_lowLatency) {
+            m_swapChain->SetMaximumFrameLatency(1);
+            m_frameLatencyWaitable = m_swapChain->GetFrameLatencyWaitableObject();
+        }
+        std::printf("Present: %s, tearing %s\n", m_lowLatency ? "low latency (1 frame queued)" : "default queue",
+                    m_tearingSupported ? "allowed" : (m_allowTearing ? "not supported" : "off"));
+
         // Descriptor heaps
         {
             D3D12_DESCRIPTOR_HEAP_DESC rtvDesc = {};
@@ -455,7 +2004,7 @@ public:
             m_device->CreateDescriptorHeap(&dsvDesc, IID_PPV_ARGS(&m_dsvHeap));
 
             D3D12_DESCRIPTOR_HEAP_DESC cbvSrvDesc = {};
-            cbvSrvDesc.NumDescriptors = 1 + MAX_TEXTURES;  // 1 CB + textures
+            cbvSrvDesc.NumDescriptors = SRV_HEAP_SIZE;
             cbvSrvDesc.Type  = D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV;
             cbvSrvDesc.Flags = D3D12_DESCRIPTOR_HEAP_FLAG_SHADER_VISIBLE;
             m_device->CreateDescriptorHeap(&cbvSrvDesc, IID_PPV_ARGS(&m_cbvSrvHeap));
@@ -463,146 +2012,64 @@ public:
             m_rtvDescriptorSize    = m_device->GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_RTV);
             m_dsvDescriptorSize    = m_device->GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_DSV);
             m_cbvSrvDescriptorSize = m_device->GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
+            m_srvAllocator.initialize(SRV_HEAP_SIZE, DUMMY_ARRAY_SRV_INDEX + 1);
         }
 
+        // Tier 1 caps a table at 128 SRVs, too few to index the whole heap
+        D3D12_FEATURE_DATA_D3D12_OPTIONS options = {};
+        m_bindless = SUCCEEDED(m_device->CheckFeatureSupport(D3D12_FEATURE_D3D12_OPTIONS,
+                                                             &options, sizeof(options))) &&
+                     options.ResourceBindingTier >= D3D12_RESOURCE_BINDING_TIER_2;
+
         createRenderTargets();
         createDepthStencil();
 
-        // Command allocators
-        for (UINT i = 0; i < FRAME_COUNT; i++) {
-            m_device->CreateCommandAllocator(D3D12_COMMAND_LIST_TYPE_DIRECT,
-                IID_PPV_ARGS(&m_commandAllocators[i]));
+        // Main recorder: command list, allocators and per-frame upload
+        // memory (CB slices + instance data). Constants are bound as root
+        // CBVs, so descriptor index 0 stays reserved. Pass recorders for
+        // parallel batches are created on first use.
+        if (!ensureRecorders(1)) {
+            return false;
         }
-
-        // Command list
-        m_device->CreateCommandList(0, D3D12_COMMAND_LIST_TYPE_DIRECT,
-            m_commandAllocators[m_frameIndex].Get(), nullptr,
-            IID_PPV_ARGS(&m_commandList));
-        m_commandList->Close();
+        m_rec = m_recorders[0].get();
         
-        // Create dedicated upload command list for init-time resource uploads
-        m_device->CreateCommandAllocator(D3D12_COMMAND_LIST_TYPE_DIRECT,
-            IID_PPV_ARGS(&m_uploadAllocator));
-        m_device->CreateCommandList(0, D3D12_COMMAND_LIST_TYPE_DIRECT,
-            m_uploadAllocator.Get(), nullptr,
-            IID_PPV_ARGS(&m_uploadCommandList));
-        m_uploadCommandList->Close();
-
-        // Constant buffers - one per frame for double buffering!
-        {
-            UINT cbSize = CalcConstantBufferByteSize(sizeof(CBData));
-            D3D12_RESOURCE_DESC cbDesc = BufferDesc(cbSize);
-            D3D12_HEAP_PROPERTIES uploadProps = UploadHeapProps();
-            
-            for (UINT i = 0; i < FRAME_COUNT; i++) {
-                m_device->CreateCommittedResource(&uploadProps, D3D12_HEAP_FLAG_NONE,
-                    &cbDesc, D3D12_RESOURCE_STATE_GENERIC_READ, nullptr,
-                    IID_PPV_ARGS(&m_constantBuffers[i]));
-
-                D3D12_RANGE readRange = {0, 0};
-                m_constantBuffers[i]->Map(0, &readRange, reinterpret_cast<void**>(&m_cbvDataBegin[i]));
-            }
-
-            // Create CBV at descriptor index 0 for frame 0's constant buffer
-            // (We'll update the root CBV descriptor each frame)
-            D3D12_CONSTANT_BUFFER_VIEW_DESC cbvDesc = {};
-            cbvDesc.BufferLocation = m_constantBuffers[0]->GetGPUVirtualAddress();
-            cbvDesc.SizeInBytes    = cbSize;
-
-            D3D12_CPU_DESCRIPTOR_HANDLE cbvHandle = m_cbvSrvHeap->GetCPUDescriptorHandleForHeapStart();
-            m_device->CreateConstantBufferView(&cbvDesc, cbvHandle);
+        // Copy queue + staging ring for resource uploads
+        if (!m_uploadQueue.initialize(m_device.Get(), STAGING_RING_SIZE)) {
+            return false;
         }
 
         // Fence
         m_device->CreateFence(0, D3D12_FENCE_FLAG_NONE, IID_PPV_ARGS(&m_fence));
         m_fenceEvent = CreateEvent(nullptr, FALSE, FALSE, nullptr);
 
+        if (!createTimestampQueries()) {
+            std::fprintf(stderr, "D3D12: Timestamp queries unavailable, GPU timing disabled\n");
+        }
+
         std::printf("Direct3D 12 Renderer initialized\n");
         
-        // Create 1x1 black dummy texture for when no texture is bound
-        // This occupies SRV index 1
+        // Create 1x1 black dummy texture for when no texture is bound (or a
+        // texture is still uploading), at its fixed SRV index
         {
-            unsigned char blackPixel[4] = {0, 0, 0, 255};  // Black, opaque
-            
-            D3D12_RESOURCE_DESC texDesc = Tex2DDesc(1, 1, DXGI_FORMAT_R8G8B8A8_UNORM);
-            D3D12_HEAP_PROPERTIES defaultProps = DefaultHeapProps();
-            ComPtr<ID3D12Resource> dummyTexture;
-            m_device->CreateCommittedResource(&defaultProps, D3D12_HEAP_FLAG_NONE,
-                &texDesc, D3D12_RESOURCE_STATE_COPY_DEST, nullptr,
-                IID_PPV_ARGS(&dummyTexture));
-
-            // Upload
-            D3D12_RESOURCE_DESC uploadDesc = BufferDesc(256);  // 256 bytes for alignment
-            D3D12_HEAP_PROPERTIES uploadProps = UploadHeapProps();
-            ComPtr<ID3D12Resource> uploadBuffer;
-            m_device->CreateCommittedResource(&uploadProps, D3D12_HEAP_FLAG_NONE,
-                &uploadDesc, D3D12_RESOURCE_STATE_GENERIC_READ, nullptr,
-                IID_PPV_ARGS(&uploadBuffer));
-
-            void* mapped;
-            uploadBuffer->Map(0, nullptr, &mapped);
-            memcpy(mapped, blackPixel, 4);
-            uploadBuffer->Unmap(0, nullptr);
-
-            // Copy via command list (use dedicated upload command list)
-            m_uploadAllocator->Reset();
-            m_uploadCommandList->Reset(m_uploadAllocator.Get(), nullptr);
-
-            D3D12_PLACED_SUBRESOURCE_FOOTPRINT footprint = {};
-            footprint.Footprint.Format   = DXGI_FORMAT_R8G8B8A8_UNORM;
-            footprint.Footprint.Width    = 1;
-            footprint.Footprint.Height   = 1;
-            footprint.Footprint.Depth    = 1;
-            footprint.Footprint.RowPitch = 256;
-
-            D3D12_TEXTURE_COPY_LOCATION srcLoc = {};
-            srcLoc.pResource = uploadBuffer.Get();
-            srcLoc.Type = D3D12_TEXTURE_COPY_TYPE_PLACED_FOOTPRINT;
-            srcLoc.PlacedFootprint = footprint;
-
-            D3D12_TEXTURE_COPY_LOCATION dstLoc = {};
-            dstLoc.pResource = dummyTexture.Get();
-            dstLoc.Type = D3D12_TEXTURE_COPY_TYPE_SUBRESOURCE_INDEX;
-            dstLoc.SubresourceIndex = 0;
-
-            m_uploadCommandList->CopyTextureRegion(&dstLoc, 0, 0, 0, &srcLoc, nullptr);
-
-            D3D12_RESOURCE_BARRIER barrier = TransitionBarrier(dummyTexture.Get(),
-                D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
-            m_uploadCommandList->ResourceBarrier(1, &barrier);
-
-            m_uploadCommandList->Close();
-            ID3D12CommandList* lists[] = { m_uploadCommandList.Get() };
-            m_commandQueue->ExecuteCommandLists(1, lists);
-            waitForGpu();
+            const uint8_t blackPixel[4] = {0, 0, 0, 255};  // Black, opaque
+            if (!uploadTexture2D(m_dummyTexture, blackPixel, 1, 1)) {
+                return false;
+            }
+            m_uploadQueue.waitFor(m_dummyTexture.uploadFence);
+            createTextureSRV(m_dummyTexture.resource.Get(), DUMMY_SRV_INDEX);
+            createTextureSRV(m_dummyTexture.resource.Get(), DUMMY_ARRAY_SRV_INDEX,
+                             DXGI_FORMAT_R8G8B8A8_UNORM, 1, 1);
+            std::printf("D3D12: %s texture binding, %u SRV slots\n",
+                        m_bindless ? "Bindless" : "Per-draw table", m_srvAllocator.capacity());
+        }
 
-            // Create SRV at index 1 (index 0 is CBV)
-            D3D12_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
-            srvDesc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
-            srvDesc.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
-            srvDesc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURE2D;
-            srvDesc.Texture2D.MipLevels = 1;
-
-            D3D12_CPU_DESCRIPTOR_HANDLE srvHandle = m_cbvSrvHeap->GetCPUDescriptorHandleForHeapStart();
-            srvHandle.ptr += 1 * m_cbvSrvDescriptorSize;  // Index 1
-            m_device->CreateShaderResourceView(dummyTexture.Get(), &srvDesc, srvHandle);
-            
-            // Also create dummy at index 2 for normal map slot
-            // Normal maps should have RGB(128,128,255) which is (0,0,1) in tangent space
-            D3D12_CPU_DESCRIPTOR_HANDLE srvHandle2 = m_cbvSrvHeap->GetCPUDescriptorHandleForHeapStart();
-            srvHandle2.ptr += 2 * m_cbvSrvDescriptorSize;  // Index 2
-            m_device->CreateShaderResourceView(dummyTexture.Get(), &srvDesc, srvHandle2);
-            
-            // Initialize staging slots (63, 64) with dummy descriptors
-            D3D12_CPU_DESCRIPTOR_HANDLE stagingDiffuse = m_cbvSrvHeap->GetCPUDescriptorHandleForHeapStart();
-            stagingDiffuse.ptr += (MAX_TEXTURES - 1) * m_cbvSrvDescriptorSize;  // Slot 63
-            m_device->CreateShaderResourceView(dummyTexture.Get(), &srvDesc, stagingDiffuse);
-            
-            D3D12_CPU_DESCRIPTOR_HANDLE stagingNormal = m_cbvSrvHeap->GetCPUDescriptorHandleForHeapStart();
-            stagingNormal.ptr += MAX_TEXTURES * m_cbvSrvDescriptorSize;  // Slot 64
-            m_device->CreateShaderResourceView(dummyTexture.Get(), &srvDesc, stagingNormal);
-            
-            std::printf("Created dummy textures at SRV indices 1, 2, 63 (staging diffuse), 64 (staging normal)\n");
+        if (!createCullPipeline()) {
+            std::fprintf(stderr, "D3D12: Cull pipeline unavailable, GPU culling disabled\n");
+            m_cullPipeline.Reset();
+        }
+        if (!createMipPipeline()) {
+            std::fprintf(stderr, "D3D12: Mip pipeline unavailable, textures get a single level\n");
+            m_mipPipeline.Reset();
         }
         
         return true;
@@ -611,17 +2078,30 @@ public:
     // ================================================================
     void shutdown() override {
         waitForGpu();
+        m_uploadQueue.shutdown();
 
         m_meshes.clear();
+        m_retiredRanges.clear();
+        m_geometryBlocks.clear();
+        m_geometryPool.clear();
         m_shaders.clear();
         m_textures.clear();
 
-        for (UINT i = 0; i < FRAME_COUNT; i++) {
-            if (m_constantBuffers[i]) {
-                m_constantBuffers[i]->Unmap(0, nullptr);
-                m_constantBuffers[i].Reset();
-            }
-        }
+        for (auto& targets : m_cullTargets) targets = D3D12CullTargets();
+        m_cullPipeline.Reset();
+        m_cullRootSignature.Reset();
+        m_drawIndexedSignature.Reset();
+        m_mipPipeline.Reset();
+        m_mipRootSignature.Reset();
+        m_pendingMips.clear();
+        m_retiredDescriptors.clear();
+        m_pipelineCache.release();
+
+        for (auto& rec : m_recorders) rec->release();
+        m_recorders.clear();
+        m_recordersUsed = 0;
+        m_rec = nullptr;
+        m_submitLists.clear();
         
         if (m_fenceEvent) {
             CloseHandle(m_fenceEvent);
@@ -629,15 +2109,18 @@ public:
         }
         
         m_fence.Reset();
-        m_uploadCommandList.Reset();
-        m_uploadAllocator.Reset();
-        m_commandList.Reset();
-        for (auto& ca : m_commandAllocators) ca.Reset();
+        m_timestampHeap.Reset();
+        m_timestampReadback.Reset();
+        m_dummyTexture.resource.Reset();
         m_depthStencil.Reset();
         for (auto& rt : m_renderTargets) rt.Reset();
         m_cbvSrvHeap.Reset();
         m_dsvHeap.Reset();
         m_rtvHeap.Reset();
+        if (m_frameLatencyWaitable) {
+            CloseHandle(m_frameLatencyWaitable);
+            m_frameLatencyWaitable = nullptr;
+        }
         m_swapChain.Reset();
         m_commandQueue.Reset();
         m_device.Reset();
@@ -651,42 +2134,60 @@ public:
             WaitForSingleObject(m_fenceEvent, INFINITE);
         }
         
-        m_commandAllocators[m_frameIndex]->Reset();
-        m_commandList->Reset(m_commandAllocators[m_frameIndex].Get(), nullptr);
+        // GPU is done with every recorder's allocator and upload memory for
+        // this frame index; each is reset when it is opened
+        m_uploadQueue.retireCompleted();
+        freeRetiredRanges(m_fence->GetCompletedValue());
+        freeRetiredDescriptors(m_fence->GetCompletedValue());
+        m_cullTargets[m_frameIndex].retired.clear();
+        m_recordersUsed = 0;
+        m_submitLists.clear();
+        m_rec = &openRecorder();
+        generatePendingMips(*m_rec);
+        resolveTimestamps();
+        writeTimestamp(m_gpuTimer.beginFrame());
 
         D3D12_RESOURCE_BARRIER barrier = TransitionBarrier(
             m_renderTargets[m_frameIndex].Get(),
             D3D12_RESOURCE_STATE_PRESENT,
             D3D12_RESOURCE_STATE_RENDER_TARGET);
-        m_commandList->ResourceBarrier(1, &barrier);
-
-        D3D12_CPU_DESCRIPTOR_HANDLE rtvHandle = m_rtvHeap->GetCPUDescriptorHandleForHeapStart();
-        rtvHandle.ptr += m_frameIndex * m_rtvDescriptorSize;
+        m_rec->list->ResourceBarrier(1, &barrier);
 
         D3D12_CPU_DESCRIPTOR_HANDLE dsvHandle = m_dsvHeap->GetCPUDescriptorHandleForHeapStart();
-
-        m_commandList->OMSetRenderTargets(1, &rtvHandle, FALSE, &dsvHandle);
-        m_commandList->ClearRenderTargetView(rtvHandle, m_clearColor, 0, nullptr);
-        m_commandList->ClearDepthStencilView(dsvHandle, D3D12_CLEAR_FLAG_DEPTH, 1.0f, 0, 0, nullptr);
-
-        D3D12_VIEWPORT vp = { 0, 0, (float)m_width, (float)m_height, 0, 1 };
-        D3D12_RECT scissor = { 0, 0, (LONG)m_width, (LONG)m_height };
-        m_commandList->RSSetViewports(1, &vp);
-        m_commandList->RSSetScissorRects(1, &scissor);
+        m_rec->list->ClearRenderTargetView(backBufferRtv(), m_clearColor, 0, nullptr);
+        m_rec->list->ClearDepthStencilView(dsvHandle, D3D12_CLEAR_FLAG_DEPTH, 1.0f, 0, 0, nullptr);
     }
 
     void endFrame() override {
+        // Kick any uploads recorded this frame; they become ready asynchronously
+        m_uploadQueue.submit();
+
         D3D12_RESOURCE_BARRIER barrier = TransitionBarrier(
             m_renderTargets[m_frameIndex].Get(),
             D3D12_RESOURCE_STATE_RENDER_TARGET,
             D3D12_RESOURCE_STATE_PRESENT);
-        m_commandList->ResourceBarrier(1, &barrier);
+        m_rec->list->ResourceBarrier(1, &barrier);
+
+        // moveToNextFrame() signals m_currentFenceValue after these lists
+        writeTimestamp(m_gpuTimer.endFrame());
+        if (m_timestampHeap) {
+            uint32_t slot = m_gpuTimer.currentSlot();
+            UINT first = GpuTimerRing::query(slot, 0);
+            m_rec->list->ResolveQueryData(m_timestampHeap.Get(), D3D12_QUERY_TYPE_TIMESTAMP,
+                                          first, m_gpuTimer.stampCount(slot),
+                                          m_timestampReadback.Get(), first * sizeof(UINT64));
+            m_timestampFences[slot] = m_currentFenceValue;
+        }
 
-        m_commandList->Close();
-        ID3D12CommandList* lists[] = { m_commandList.Get() };
-        m_commandQueue->ExecuteCommandLists(1, lists);
+        // Every list of the frame in recording order, in one submission
+        closeRecorder(*m_rec);
+        m_commandQueue->ExecuteCommandLists((UINT)m_submitLists.size(), m_submitLists.data());
+        m_lastStats = m_frameStats;
+        m_frameStats = RenderStateStats();
 
-        m_swapChain->Present(1, 0);
+        // Tearing is only allowed without vsync
+        UINT presentFlags = (m_syncInterval == 0 && m_tearingSupported) ? DXGI_PRESENT_ALLOW_TEARING : 0;
+        m_swapChain->Present(m_syncInterval, presentFlags);
         moveToNextFrame();
     }
 
@@ -695,12 +2196,23 @@ public:
         m_clearColor[2]=b; m_clearColor[3]=a;
     }
 
+    void setVSync(bool enabled) override { m_syncInterval = enabled ? 1 : 0; }
+    void setLowLatency(bool enabled) override { m_lowLatency = enabled; }
+    void setAllowTearing(bool enabled) override { m_allowTearing = enabled; }
+
+    void waitForFrameSlot() override {
+        if (m_frameLatencyWaitable) WaitForSingleObjectEx(m_frameLatencyWaitable, 1000, TRUE);
+    }
+    // Command lists are recorded by whichever thread owns the renderer (and
+    // the job threads it hands a batch to)
+    void makeCurrent(bool current) override { (void)current; }
+
     void setViewport(int w, int h) override {
         waitForGpu();
         m_width = w; m_height = h;
 
         for (auto& rt : m_renderTargets) rt.Reset();
-        m_swapChain->ResizeBuffers(FRAME_COUNT, w, h, DXGI_FORMAT_R8G8B8A8_UNORM, 0);
+        m_swapChain->ResizeBuffers(FRAME_COUNT, w, h, DXGI_FORMAT_R8G8B8A8_UNORM, m_swapChainFlags);
         m_frameIndex = m_swapChain->GetCurrentBackBufferIndex();
 
         createRenderTargets();
@@ -711,77 +2223,152 @@ public:
     // ================================================================
     uint32_t createMesh(const Vertex* verts, uint32_t vCount,
                         const uint16_t* idx, uint32_t iCount) override {
-        D3D12Mesh mesh;
-        mesh.indexCount = iCount;
-
-        UINT vbSize = vCount * sizeof(Vertex);
-        UINT ibSize = iCount * sizeof(uint16_t);
+        return createMeshBuffers(verts, vCount, sizeof(Vertex), false,
+                                 idx, iCount, DXGI_FORMAT_R16_UINT);
+    }
 
-        D3D12_RESOURCE_DESC vbDesc = BufferDesc(vbSize);
-        D3D12_RESOURCE_DESC ibDesc = BufferDesc(ibSize);
+    uint32_t createMesh(const Vertex* verts, uint32_t vCount,
+                        const uint32_t* idx, uint32_t iCount) override {
+        return createMesh32(verts, vCount, sizeof(Vertex), false, idx, iCount);
+    }
 
-        D3D12_HEAP_PROPERTIES uploadProps = UploadHeapProps();
+    uint32_t createMesh(const PackedVertex* verts, uint32_t vCount,
+                        const uint32_t* idx, uint32_t iCount) override {
+        return createMesh32(verts, vCount, sizeof(PackedVertex), true, idx, iCount);
+    }
 
-        m_device->CreateCommittedResource(&uploadProps, D3D12_HEAP_FLAG_NONE,
-            &vbDesc, D3D12_RESOURCE_STATE_GENERIC_READ, nullptr,
-            IID_PPV_ARGS(&mesh.vertexBuffer));
+    // 32-bit input indices are narrowed when the mesh fits in 16 bits
+    uint32_t createMesh32(const void* verts, uint32_t vCount, UINT stride, bool packed,
+                          const uint32_t* idx, uint32_t iCount) {
+        if (indicesFit16(vCount)) {
+            std::vector<uint16_t> narrowed(iCount);
+            narrowIndices(idx, iCount, narrowed.data());
+            return createMeshBuffers(verts, vCount, stride, packed,
+                                     narrowed.data(), iCount, DXGI_FORMAT_R16_UINT);
+        }
+        return createMeshBuffers(verts, vCount, stride, packed, idx, iCount, DXGI_FORMAT_R32_UINT);
+    }
 
-        m_device->CreateCommittedResource(&uploadProps, D3D12_HEAP_FLAG_NONE,
-            &ibDesc, D3D12_RESOURCE_STATE_GENERIC_READ, nullptr,
-            IID_PPV_ARGS(&mesh.indexBuffer));
+    // Copies into a range of a pool block, creating the block's buffers
+    // first if the pool had no room in one of this format
+    uint32_t createMeshBuffers(const void* verts, uint32_t vCount, UINT stride, bool packed,
+                               const void* idx, uint32_t iCount, DXGI_FORMAT indexFormat) {
+        if (vCount == 0 || iCount == 0) return 0;
+        UINT indexSize = (indexFormat == DXGI_FORMAT_R32_UINT) ? sizeof(uint32_t) : sizeof(uint16_t);
 
-        void* vbData; void* ibData;
-        mesh.vertexBuffer->Map(0, nullptr, &vbData);
-        mesh.indexBuffer->Map(0, nullptr, &ibData);
-        memcpy(vbData, verts, vbSize);
-        memcpy(ibData, idx, ibSize);
-        mesh.vertexBuffer->Unmap(0, nullptr);
-        mesh.indexBuffer->Unmap(0, nullptr);
+        bool newBlock = false;
+        D3D12Mesh mesh;
+        mesh.range = m_geometryPool.allocate(stride, indexSize, vCount, iCount, newBlock);
+        mesh.indexCount = iCount;
+        mesh.packed = packed;
+        mesh.bounds = computeMeshBounds(verts, vCount, stride);
+        if (!createGeometryBlock(mesh.range.block)) {
+            std::fprintf(stderr, "D3D12: Failed to create mesh buffers\n");
+            m_geometryPool.free(mesh.range);
+            return 0;
+        }
+        const D3D12GeometryBlock& block = m_geometryBlocks[mesh.range.block];
+        const GeometryPool::Block& poolBlock = m_geometryPool.block(mesh.range.block);
+
+        // Filled by the copy queue; COMMON state lets the direct queue
+        // promote the buffers to vertex/index buffer state on use
+        if (!uploadBufferRegion(block.vertexBuffer.Get(), (UINT64)mesh.range.baseVertex * stride,
+                                verts, vCount * stride) ||
+            !uploadBufferRegion(block.indexBuffer.Get(), (UINT64)mesh.range.firstIndex * indexSize,
+                                idx, iCount * indexSize)) {
+            std::fprintf(stderr, "D3D12: Out of staging memory for mesh\n");
+            m_geometryPool.free(mesh.range);
+            return 0;
+        }
+        mesh.uploadFence = m_uploadQueue.pendingFenceValue();
+        m_uploadQueue.submitIfLarge(STAGING_RING_SIZE / 4);
 
-        mesh.vertexBufferView.BufferLocation = mesh.vertexBuffer->GetGPUVirtualAddress();
-        mesh.vertexBufferView.SizeInBytes    = vbSize;
-        mesh.vertexBufferView.StrideInBytes  = sizeof(Vertex);
+        mesh.vertexBufferView.BufferLocation = block.vertexBuffer->GetGPUVirtualAddress();
+        mesh.vertexBufferView.SizeInBytes    = poolBlock.vertices.capacity() * stride;
+        mesh.vertexBufferView.StrideInBytes  = stride;
 
-        mesh.indexBufferView.BufferLocation = mesh.indexBuffer->GetGPUVirtualAddress();
-        mesh.indexBufferView.SizeInBytes    = ibSize;
-        mesh.indexBufferView.Format         = DXGI_FORMAT_R16_UINT;
+        mesh.indexBufferView.BufferLocation = block.indexBuffer->GetGPUVirtualAddress();
+        mesh.indexBufferView.SizeInBytes    = poolBlock.indices.capacity() * indexSize;
+        mesh.indexBufferView.Format         = indexFormat;
 
         uint32_t h = m_nextMeshHandle++;
         m_meshes[h] = std::move(mesh);
         return h;
     }
 
+    // Buffers of a pool block, created on its first mesh. A block whose
+    // creation failed is retried by the next mesh placed in it.
+    bool createGeometryBlock(uint32_t index) {
+        if (index >= m_geometryBlocks.size()) m_geometryBlocks.resize(index + 1);
+        D3D12GeometryBlock& block = m_geometryBlocks[index];
+        if (block.vertexBuffer && block.indexBuffer) return true;
+
+        const GeometryPool::Block& poolBlock = m_geometryPool.block(index);
+        if (!createDefaultBuffer((UINT64)poolBlock.vertices.capacity() * poolBlock.vertexStride, block.vertexBuffer) ||
+            !createDefaultBuffer((UINT64)poolBlock.indices.capacity() * poolBlock.indexSize, block.indexBuffer)) {
+            block.vertexBuffer.Reset();
+            block.indexBuffer.Reset();
+            return false;
+        }
+        return true;
+    }
+
+    // The GPU is idle before the range is freed, so the next mesh placed in
+    // it cannot overwrite data still being read
+    // Lists recorded this frame may still draw the mesh, so its range is
+    // freed later instead of waiting for the GPU. Copies into a reused range
+    // queue behind any still pending for the old mesh.
     void destroyMesh(uint32_t h) override {
         auto it = m_meshes.find(h);
         if (it != m_meshes.end()) {
-            waitForGpu();
+            m_retiredRanges.push_back({ it->second.range, m_currentFenceValue });
             m_meshes.erase(it);
         }
     }
 
+    bool isMeshReady(uint32_t h) const override {
+        auto it = m_meshes.find(h);
+        return it != m_meshes.end() && m_uploadQueue.isComplete(it->second.uploadFence);
+    }
+
+    void freeRetiredRanges(UINT64 completedFence) {
+        size_t kept = 0;
+        for (const RetiredRange& retired : m_retiredRanges) {
+            if (retired.fenceValue <= completedFence) m_geometryPool.free(retired.range);
+            else m_retiredRanges[kept++] = retired;
+        }
+        m_retiredRanges.resize(kept);
+    }
+
     // ================================================================
     uint32_t createShader(const char* /*vs*/, const char* /*fs*/) override {
         D3D12Shader shader;
 
+        // Unbounded arrays need shader model 5.1
+        shader.bindless = m_bindless;
+        const D3D_SHADER_MACRO bindlessDefines[] = { { "BINDLESS", "1" }, { nullptr, nullptr } };
+        const D3D_SHADER_MACRO* defines = shader.bindless ? bindlessDefines : nullptr;
         ComPtr<ID3DBlob> vsBlob, psBlob;
-        if (!compileShader(g_hlslSrc, "VSMain", "vs_5_0", vsBlob)) {
+        if (!compileShader(g_hlslSrc, "VSMain", shader.bindless ? "vs_5_1" : "vs_5_0", vsBlob, defines)) {
             std::fprintf(stderr, "Failed to compile vertex shader\n");
             return 0;
         }
-        if (!compileShader(g_hlslSrc, "PSMain", "ps_5_0", psBlob)) {
+        if (!compileShader(g_hlslSrc, "PSMain", shader.bindless ? "ps_5_1" : "ps_5_0", psBlob, defines)) {
             std::fprintf(stderr, "Failed to compile pixel shader\n");
             return 0;
         }
 
         // Root signature: 
-        // [0] = CBV(b0) for world matrix only (64 bytes)
+        // [0] = CBV(b0) for DrawConstants (160 bytes, one slice per draw)
+        // Per-draw table mode:
         // [1] = SRV descriptor table for diffuse texture (t0) - SINGLE descriptor
         // [2] = SRV descriptor table for normal map (t1) - SINGLE descriptor  
-        // [3] = Root constants for MVP matrix (16 floats)
-        // [4] = Root constants for lightDir (3 floats)
-        // [5] = Root constant for useTexture (1 float)
-        // [6] = Root constant for useNormalMap (1 float)
-        D3D12_ROOT_PARAMETER rootParams[7] = {};
+        // [3] = SRV descriptor table for the texture array (t2) - SINGLE descriptor
+        // Bindless mode:
+        // [1] = SRV table over the whole heap (t0, space1 and again as arrays
+        //       in space2), set once per list
+        // [2] = 3 root constants (b1): diffuse, normal map and array SRV indices
+        D3D12_ROOT_PARAMETER rootParams[4] = {};
         
         rootParams[0].ParameterType = D3D12_ROOT_PARAMETER_TYPE_CBV;
         rootParams[0].Descriptor.ShaderRegister = 0;
@@ -811,34 +2398,38 @@ public:
         rootParams[2].DescriptorTable.pDescriptorRanges   = &normalRange;
         rootParams[2].ShaderVisibility = D3D12_SHADER_VISIBILITY_PIXEL;
         
-        // Root constants for MVP matrix (16 floats)
-        rootParams[3].ParameterType = D3D12_ROOT_PARAMETER_TYPE_32BIT_CONSTANTS;
-        rootParams[3].Constants.ShaderRegister = 1;  // b1 register
-        rootParams[3].Constants.RegisterSpace = 0;
-        rootParams[3].Constants.Num32BitValues = 16;  // 4x4 matrix
-        rootParams[3].ShaderVisibility = D3D12_SHADER_VISIBILITY_VERTEX;
-        
-        // Root constants for lightDir (3 floats)
-        rootParams[4].ParameterType = D3D12_ROOT_PARAMETER_TYPE_32BIT_CONSTANTS;
-        rootParams[4].Constants.ShaderRegister = 2;  // b2 register
-        rootParams[4].Constants.RegisterSpace = 0;
-        rootParams[4].Constants.Num32BitValues = 3;  // float3
-        rootParams[4].ShaderVisibility = D3D12_SHADER_VISIBILITY_PIXEL;
+        // Texture array (t2) - separate table
+        D3D12_DESCRIPTOR_RANGE arrayRange = {};
+        arrayRange.RangeType          = D3D12_DESCRIPTOR_RANGE_TYPE_SRV;
+        arrayRange.NumDescriptors     = 1;  // Just the array
+        arrayRange.BaseShaderRegister = 2;  // t2
+        arrayRange.OffsetInDescriptorsFromTableStart = 0;
+
+        rootParams[3].ParameterType = D3D12_ROOT_PARAMETER_TYPE_DESCRIPTOR_TABLE;
+        rootParams[3].DescriptorTable.NumDescriptorRanges = 1;
+        rootParams[3].DescriptorTable.pDescriptorRanges   = &arrayRange;
+        rootParams[3].ShaderVisibility = D3D12_SHADER_VISIBILITY_PIXEL;
         
-        // Root constant for useTexture (1 float)
-        rootParams[5].ParameterType = D3D12_ROOT_PARAMETER_TYPE_32BIT_CONSTANTS;
-        rootParams[5].Constants.ShaderRegister = 3;  // b3 register
-        rootParams[5].Constants.RegisterSpace = 0;
-        rootParams[5].Constants.Num32BitValues = 1;  // 1 float
-        rootParams[5].ShaderVisibility = D3D12_SHADER_VISIBILITY_PIXEL;
-        
-        // Root constant for useNormalMap (1 float)
-        rootParams[6].ParameterType = D3D12_ROOT_PARAMETER_TYPE_32BIT_CONSTANTS;
-        rootParams[6].Constants.ShaderRegister = 4;  // b4 register
-        rootParams[6].Constants.RegisterSpace = 0;
-        rootParams[6].Constants.Num32BitValues = 1;  // 1 float
-        rootParams[6].ShaderVisibility = D3D12_SHADER_VISIBILITY_PIXEL;
+        // Both ranges start at the heap: the same descriptors, declared once
+        // as Texture2D and once as Texture2DArray
+        D3D12_DESCRIPTOR_RANGE heapRanges[2] = {};
+        if (shader.bindless) {
+            for (UINT i = 0; i < 2; i++) {
+                heapRanges[i].RangeType          = D3D12_DESCRIPTOR_RANGE_TYPE_SRV;
+                heapRanges[i].NumDescriptors     = UINT_MAX;  // Unbounded
+                heapRanges[i].BaseShaderRegister = 0;
+                heapRanges[i].RegisterSpace      = 1 + i;
+                heapRanges[i].OffsetInDescriptorsFromTableStart = 0;
+            }
+            rootParams[1].DescriptorTable.NumDescriptorRanges = 2;
+            rootParams[1].DescriptorTable.pDescriptorRanges   = heapRanges;
 
+            rootParams[2].ParameterType = D3D12_ROOT_PARAMETER_TYPE_32BIT_CONSTANTS;
+            rootParams[2].Constants.ShaderRegister = 1;  // b1
+            rootParams[2].Constants.RegisterSpace  = 0;
+            rootParams[2].Constants.Num32BitValues = 3;
+        }
+        
         D3D12_STATIC_SAMPLER_DESC sampler = {};
         sampler.Filter         = D3D12_FILTER_MIN_MAG_MIP_LINEAR;
         sampler.AddressU       = D3D12_TEXTURE_ADDRESS_MODE_WRAP;
@@ -849,7 +2440,7 @@ public:
         sampler.ShaderVisibility = D3D12_SHADER_VISIBILITY_PIXEL;
 
         D3D12_ROOT_SIGNATURE_DESC rsDesc = {};
-        rsDesc.NumParameters     = 7;  // CBV + diffuse table + normal table + MVP + lightDir + useTexture + useNormalMap
+        rsDesc.NumParameters     = shader.bindless ? 3 : 4;
         rsDesc.pParameters       = rootParams;
         rsDesc.NumStaticSamplers = 1;
         rsDesc.pStaticSamplers   = &sampler;
@@ -881,6 +2472,12 @@ public:
             { "TEXCOORD",  0, DXGI_FORMAT_R32G32_FLOAT,       0, 40, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
             { "TANGENT",   0, DXGI_FORMAT_R32G32B32_FLOAT,    0, 48, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
             { "BITANGENT", 0, DXGI_FORMAT_R32G32B32_FLOAT,    0, 60, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+            // Per-instance stream — must match InstanceData
+            { "INSTWORLD", 0, DXGI_FORMAT_R32G32B32A32_FLOAT, 1,  0, D3D12_INPUT_CLASSIFICATION_PER_INSTANCE_DATA, 1 },
+            { "INSTWORLD", 1, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, 16, D3D12_INPUT_CLASSIFICATION_PER_INSTANCE_DATA, 1 },
+            { "INSTWORLD", 2, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, 32, D3D12_INPUT_CLASSIFICATION_PER_INSTANCE_DATA, 1 },
+            { "INSTWORLD", 3, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, 48, D3D12_INPUT_CLASSIFICATION_PER_INSTANCE_DATA, 1 },
+            { "INSTTINT",  0, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, 64, D3D12_INPUT_CLASSIFICATION_PER_INSTANCE_DATA, 1 },
         };
 
         // PSO
@@ -904,103 +2501,131 @@ public:
         psoDesc.DSVFormat = DXGI_FORMAT_D32_FLOAT;
         psoDesc.SampleDesc.Count = 1;
 
-        hr = m_device->CreateGraphicsPipelineState(&psoDesc, IID_PPV_ARGS(&shader.pipelineState));
+        hr = m_pipelineCache.createGraphics(psoDesc, D3D12PipelineCache::pipelineKey(psoDesc, signature.Get()),
+                                            shader.pipelineState);
         if (FAILED(hr)) {
             std::fprintf(stderr, "CreateGraphicsPipelineState failed: 0x%08X\n", hr);
             return 0;
         }
+
+        // PackedVertex: the shader decodes NORMAL.xy / TANGENT.xyz when uPackedVertex
+        // is set; BITANGENT aliases the tangent and is unused
+        D3D12_INPUT_ELEMENT_DESC packedLayout[] = {
+            { "POSITION",  0, DXGI_FORMAT_R32G32B32_FLOAT,    0,  0, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+            { "NORMAL",    0, DXGI_FORMAT_R16G16_SNORM,       0, 12, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+            { "TANGENT",   0, DXGI_FORMAT_R16G16B16A16_SNORM, 0, 16, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+            { "BITANGENT", 0, DXGI_FORMAT_R16G16B16A16_SNORM, 0, 16, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+            { "TEXCOORD",  0, DXGI_FORMAT_R16G16_FLOAT,       0, 24, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+            { "COLOR",     0, DXGI_FORMAT_R8G8B8A8_UNORM,     0, 28, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+            { "INSTWORLD", 0, DXGI_FORMAT_R32G32B32A32_FLOAT, 1,  0, D3D12_INPUT_CLASSIFICATION_PER_INSTANCE_DATA, 1 },
+            { "INSTWORLD", 1, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, 16, D3D12_INPUT_CLASSIFICATION_PER_INSTANCE_DATA, 1 },
+            { "INSTWORLD", 2, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, 32, D3D12_INPUT_CLASSIFICATION_PER_INSTANCE_DATA, 1 },
+            { "INSTWORLD", 3, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, 48, D3D12_INPUT_CLASSIFICATION_PER_INSTANCE_DATA, 1 },
+            { "INSTTINT",  0, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, 64, D3D12_INPUT_CLASSIFICATION_PER_INSTANCE_DATA, 1 },
+        };
+        psoDesc.InputLayout = { packedLayout, (UINT)std::size(packedLayout) };
+
+        hr = m_pipelineCache.createGraphics(psoDesc, D3D12PipelineCache::pipelineKey(psoDesc, signature.Get()),
+                                            shader.pipelineStatePacked);
+        if (FAILED(hr)) {
+            std::fprintf(stderr, "CreateGraphicsPipelineState (packed) failed: 0x%08X\n", hr);
+            return 0;
+        }
         
-        std::printf("D3D12: Shader created successfully\n");
-        std::printf("D3D12: sizeof(CBData) = %zu bytes\n", sizeof(CBData));
-        std::printf("D3D12: offsetof(CBData, world) = %zu\n", offsetof(CBData, world));
-        std::printf("D3D12: (lightDir and useTexture moved to root constants)\n");
+        std::printf("D3D12: Shader created successfully (stages: %u cached / %u compiled, PSOs: %u cached / %u built)\n",
+                    m_shaderCacheHits, m_shaderCompiles, m_pipelineCache.getHits(), m_pipelineCache.getMisses());
+        std::printf("D3D12: sizeof(DrawConstants) = %zu bytes\n", sizeof(DrawConstants));
 
-        shader.cbData.world = XMMatrixIdentity();
+        shader.drawConstants = DrawConstants();
+        shader.drawConstants.mvp      = mat4_identity();
+        shader.drawConstants.world    = mat4_identity();
+        shader.drawConstants.lightDir = {0.0f, -1.0f, 0.0f};
 
         uint32_t h = m_nextShaderHandle++;
         m_shaders[h] = std::move(shader);
         return h;
     }
 
-    void destroyShader(uint32_t h) override { m_shaders.erase(h); }
+    void destroyShader(uint32_t h) override {
+        m_shaders.erase(h);
+        m_rec->stateCache.invalidate(STATE_SHADER);
+        m_rec->stateCache.invalidate(STATE_PIPELINE);
+    }
 
     void useShader(uint32_t h) override {
         auto it = m_shaders.find(h);
         if (it == m_shaders.end()) return;
         m_currentShader = h;
-        D3D12Shader& s = it->second;
-        m_commandList->SetPipelineState(s.pipelineState.Get());
-        m_commandList->SetGraphicsRootSignature(s.rootSignature.Get());
-
-        ID3D12DescriptorHeap* heaps[] = { m_cbvSrvHeap.Get() };
-        m_commandList->SetDescriptorHeaps(1, heaps);
+        bindShader(*m_rec, it->second);
     }
 
     // ================================================================
+    // All per-draw uniforms live in cbuffer CB (b0): a handle is a
+    // DrawConstantField, and samplers (fixed registers) have none
+    UniformHandle getUniformHandle(uint32_t h, const char* name) override {
+        if (m_shaders.find(h) == m_shaders.end()) return INVALID_UNIFORM;
+        return findDrawConstantField(name);
+    }
+
     void setUniformMat4(uint32_t h, const char* name, const Mat4& m) override {
-        static bool debugOnce = true;
-        if (debugOnce) {
-            printf("D3D12 setUniformMat4: shader=%u, name=%s\n", h, name);
-            debugOnce = false;
-        }
-        
-        auto it = m_shaders.find(h);
-        if (it == m_shaders.end()) {
-            printf("D3D12 setUniformMat4: Shader %u NOT FOUND!\n", h);
-            return;
-        }
-        XMMATRIX xm = XMMatrixTranspose(XMLoadFloat4x4((const XMFLOAT4X4*)m.m));
-        
-        if (strcmp(name, "uMVP") == 0) {
-            // MVP is now a root constant, not in the constant buffer
-            // Store for later use in drawMesh/drawMeshInstanced
-            if (!m_inInstancedDraw) {
-                m_viewProj = xm;
-                m_hasViewProj = true;
-                
-                static bool once = true;
-                if (once) {
-                    printf("D3D12: Stored viewProj for root constants, hasViewProj=%d\n", m_hasViewProj);
-                    once = false;
-                }
-            }
-        } else if (strcmp(name, "uWorld") == 0) {
-            it->second.cbData.world = xm;
-        }
+        setUniformMat4(h, findDrawConstantField(name), m);
     }
 
-    Vec3 m_lightDir = {0, -1, 0};  // Store for root constant pushing
-    float m_useNormalMap = 0.0f;    // Store for root constant pushing
-    
     void setUniformVec3(uint32_t h, const char* name, const Vec3& v) override {
-        if (strcmp(name, "uLightDir") == 0) {
-            m_lightDir = v;  // Store for later use in draw calls
-        }
+        setUniformVec3(h, findDrawConstantField(name), v);
     }
 
     void setUniformInt(uint32_t h, const char* name, int value) override {
-        // Root constants - store for use in draw calls
-        if (strcmp(name, "uUseNormalMap") == 0) {
-            m_useNormalMap = (float)value;
-        }
-        // useTexture is set per-draw-call, not stored globally
+        setUniformInt(h, findDrawConstantField(name), value);
+    }
+
+    void setUniformMat4(uint32_t h, UniformHandle uniform, const Mat4& m) override {
+        auto it = m_shaders.find(h);
+        if (it != m_shaders.end()) setDrawConstantMat4(it->second.drawConstants, uniform, m);
+    }
+
+    void setUniformVec3(uint32_t h, UniformHandle uniform, const Vec3& v) override {
+        auto it = m_shaders.find(h);
+        if (it != m_shaders.end()) setDrawConstantVec3(it->second.drawConstants, uniform, v);
+    }
+
+    void setUniformInt(uint32_t h, UniformHandle uniform, int value) override {
+        auto it = m_shaders.find(h);
+        if (it != m_shaders.end()) setDrawConstantInt(it->second.drawConstants, uniform, value);
+    }
+
+    void setDrawConstants(uint32_t h, const DrawConstants& constants) override {
+        auto it = m_shaders.find(h);
+        if (it != m_shaders.end()) it->second.drawConstants = constants;
     }
 
     // ================================================================
     uint32_t createTexture(const char* filepath) override {
-        if (m_nextSrvIndex >= (1 + MAX_TEXTURES)) {
-            std::fprintf(stderr, "Texture limit reached (%d)\n", MAX_TEXTURES);
+        if (m_srvAllocator.full()) {
+            std::fprintf(stderr, "Texture limit reached (%u)\n", m_srvAllocator.capacity());
             return 0;
         }
 
         int w, h, ch;
         unsigned char* data = nullptr;
+        bool fromDDS = false;
         
-        // Check if DDS
+        // Check if DDS: keep BC data compressed, CPU-decode only as a fallback
         const char* ext = strrchr(filepath, '.');
         if (ext && (strcmp(ext, ".dds") == 0 || strcmp(ext, ".DDS") == 0)) {
+            DDSImage image;
+            if (DDSLoader::LoadCompressed(filepath, image)) {
+                uint32_t handle = createCompressedTexture(image.format, image.mips.data(),
+                                                          (uint32_t)image.mips.size());
+                if (handle) {
+                    std::printf("Loaded DDS texture: %s %dx%d (BC%d, %zu mips)\n", filepath,
+                               image.width, image.height, (int)image.format + 1, image.mips.size());
+                    return handle;
+                }
+            }
             data = DDSLoader::Load(filepath, &w, &h, &ch);
             if (data) {
+                fromDDS = true;
                 std::printf("Loaded DDS texture: %s %dx%d (%d channels)\n", filepath, w, h, ch);
             }
         }
@@ -1021,107 +2646,34 @@ public:
             return 0;
         }
         
-        std::printf("D3D12: Creating texture %dx%d, SRV index %d\n", w, h, m_nextSrvIndex);
+        LOG_DEBUG("D3D12: Creating texture %dx%d", w, h);
 
         D3D12Texture tex;
-        tex.width  = w;
-        tex.height = h;
-        tex.srvDescriptorIndex = m_nextSrvIndex++;
-
-        // Create GPU resource
-        D3D12_RESOURCE_DESC texDesc = Tex2DDesc(w, h, DXGI_FORMAT_R8G8B8A8_UNORM);
-        D3D12_HEAP_PROPERTIES defaultProps = DefaultHeapProps();
-        m_device->CreateCommittedResource(&defaultProps, D3D12_HEAP_FLAG_NONE,
-            &texDesc, D3D12_RESOURCE_STATE_COPY_DEST, nullptr,
-            IID_PPV_ARGS(&tex.resource));
+        bool ok = uploadTexture2D(tex, data, w, h);
 
-        // D3D12 requires 256-byte aligned row pitch for texture uploads
-        UINT rowPitch = (w * 4 + 255) & ~255;  // Align to 256 bytes
-        UINT64 uploadSize = rowPitch * h;
-        
-        // Upload buffer with aligned size
-        D3D12_RESOURCE_DESC uploadDesc = BufferDesc(uploadSize);
-        D3D12_HEAP_PROPERTIES uploadProps = UploadHeapProps();
-        ComPtr<ID3D12Resource> uploadBuffer;
-        m_device->CreateCommittedResource(&uploadProps, D3D12_HEAP_FLAG_NONE,
-            &uploadDesc, D3D12_RESOURCE_STATE_GENERIC_READ, nullptr,
-            IID_PPV_ARGS(&uploadBuffer));
-
-        // Copy data to upload buffer with row padding
-        void* mapped;
-        uploadBuffer->Map(0, nullptr, &mapped);
-        unsigned char* dst = (unsigned char*)mapped;
-        for (int y = 0; y < h; y++) {
-            memcpy(dst + y * rowPitch, data + y * w * 4, w * 4);
-        }
-        uploadBuffer->Unmap(0, nullptr);
-        
-        if (ext && (strcmp(ext, ".dds") == 0 || strcmp(ext, ".DDS") == 0))
+        // Staging copy is done, the source pixels can go
+        if (fromDDS)
             delete[] data;
         else
             stbi_image_free(data);
 
-        // Copy to GPU texture via dedicated upload command list
-        // Wait for any previous upload to complete before resetting
-        if (m_currentFenceValue > 0) {
-            if (m_fence->GetCompletedValue() < m_currentFenceValue) {
-                m_fence->SetEventOnCompletion(m_currentFenceValue, m_fenceEvent);
-                WaitForSingleObject(m_fenceEvent, INFINITE);
-            }
-        }
-        m_uploadAllocator->Reset();
-        m_uploadCommandList->Reset(m_uploadAllocator.Get(), nullptr);
-
-        D3D12_PLACED_SUBRESOURCE_FOOTPRINT footprint = {};
-        footprint.Footprint.Format   = DXGI_FORMAT_R8G8B8A8_UNORM;
-        footprint.Footprint.Width    = w;
-        footprint.Footprint.Height   = h;
-        footprint.Footprint.Depth    = 1;
-        footprint.Footprint.RowPitch = rowPitch;  // Must be 256-byte aligned!
-
-        D3D12_TEXTURE_COPY_LOCATION srcLoc = {};
-        srcLoc.pResource        = uploadBuffer.Get();
-        srcLoc.Type             = D3D12_TEXTURE_COPY_TYPE_PLACED_FOOTPRINT;
-        srcLoc.PlacedFootprint  = footprint;
-
-        D3D12_TEXTURE_COPY_LOCATION dstLoc = {};
-        dstLoc.pResource = tex.resource.Get();
-        dstLoc.Type      = D3D12_TEXTURE_COPY_TYPE_SUBRESOURCE_INDEX;
-        dstLoc.SubresourceIndex = 0;
-
-        m_uploadCommandList->CopyTextureRegion(&dstLoc, 0, 0, 0, &srcLoc, nullptr);
-
-        D3D12_RESOURCE_BARRIER barrier = TransitionBarrier(tex.resource.Get(),
-            D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
-        m_uploadCommandList->ResourceBarrier(1, &barrier);
-
-        m_uploadCommandList->Close();
-        ID3D12CommandList* lists[] = { m_uploadCommandList.Get() };
-        m_commandQueue->ExecuteCommandLists(1, lists);
-        waitForGpu();
-
-        // Create SRV
-        D3D12_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
-        srvDesc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
-        srvDesc.Format                  = DXGI_FORMAT_R8G8B8A8_UNORM;
-        srvDesc.ViewDimension           = D3D12_SRV_DIMENSION_TEXTURE2D;
-        srvDesc.Texture2D.MipLevels     = 1;
-
-        D3D12_CPU_DESCRIPTOR_HANDLE srvHandle = m_cbvSrvHeap->GetCPUDescriptorHandleForHeapStart();
-        srvHandle.ptr += tex.srvDescriptorIndex * m_cbvSrvDescriptorSize;
-        m_device->CreateShaderResourceView(tex.resource.Get(), &srvDesc, srvHandle);
-
-        uint32_t handle = m_nextTextureHandle++;
-        m_textures[handle] = std::move(tex);
-        return handle;
+        if (!ok) return 0;
+        return registerTexture(std::move(tex));
     }
 
     void destroyTexture(uint32_t h) override {
         auto it = m_textures.find(h);
-        if (it != m_textures.end()) {
-            waitForGpu();
-            m_textures.erase(it);
+        if (it == m_textures.end()) return;
+        if (it->second.arrayHandle) {
+            m_textures.erase(it);   // A layer; the array owns the resource and SRV slot
+            return;
         }
+        m_uploadQueue.waitFor(it->second.uploadFence);
+        waitForGpu();
+        // Nothing in flight reads the slot any more
+        m_srvAllocator.release(it->second.srvDescriptorIndex);
+        for (uint32_t layer : it->second.layerHandles) m_textures.erase(layer);
+        m_textures.erase(it);
     }
     
     uint32_t createTextureFromData(const uint8_t* data, int width, int height, int channels) override {
@@ -1130,366 +2682,296 @@ public:
             return 0;
         }
         
-        if (m_nextSrvIndex >= (1 + MAX_TEXTURES)) {
+        if (m_srvAllocator.full()) {
             std::fprintf(stderr, "D3D12: Texture limit reached\n");
             return 0;
         }
         
-        std::printf("D3D12: Creating texture from data (%dx%d, %d channels)\n", width, height, channels);
+        LOG_DEBUG("D3D12: Creating texture from data (%dx%d, %d channels)", width, height, channels);
         
-        // Convert to RGBA if needed
         std::vector<uint8_t> rgba_data;
-        const uint8_t* upload_data = data;
-        int upload_channels = channels;
-        
-        if (channels == 3) {
-            rgba_data.resize(width * height * 4);
-            for (int i = 0; i < width * height; i++) {
-                rgba_data[i * 4 + 0] = data[i * 3 + 0];
-                rgba_data[i * 4 + 1] = data[i * 3 + 1];
-                rgba_data[i * 4 + 2] = data[i * 3 + 2];
-                rgba_data[i * 4 + 3] = 255;
-            }
-            upload_data = rgba_data.data();
-            upload_channels = 4;
-        }
+        const uint8_t* upload_data = ExpandToRGBA(data, width, height, channels, rgba_data);
         
         D3D12Texture tex;
-        tex.width = width;
-        tex.height = height;
-        tex.srvDescriptorIndex = m_nextSrvIndex++;
-        
-        // Create GPU resource
-        D3D12_RESOURCE_DESC texDesc = Tex2DDesc(width, height, DXGI_FORMAT_R8G8B8A8_UNORM);
-        D3D12_HEAP_PROPERTIES defaultProps = DefaultHeapProps();
-        m_device->CreateCommittedResource(&defaultProps, D3D12_HEAP_FLAG_NONE,
-            &texDesc, D3D12_RESOURCE_STATE_COPY_DEST, nullptr,
-            IID_PPV_ARGS(&tex.resource));
-        
-        // D3D12 requires 256-byte aligned row pitch
-        UINT rowPitch = (width * 4 + 255) & ~255;
-        UINT64 uploadSize = rowPitch * height;
+        if (!uploadTexture2D(tex, upload_data, width, height)) return 0;
         
-        // Upload buffer
-        D3D12_RESOURCE_DESC uploadDesc = BufferDesc(uploadSize);
-        D3D12_HEAP_PROPERTIES uploadProps = UploadHeapProps();
-        ComPtr<ID3D12Resource> uploadBuffer;
-        m_device->CreateCommittedResource(&uploadProps, D3D12_HEAP_FLAG_NONE,
-            &uploadDesc, D3D12_RESOURCE_STATE_GENERIC_READ, nullptr,
-            IID_PPV_ARGS(&uploadBuffer));
-        
-        // Copy data with row padding
-        void* mapped;
-        uploadBuffer->Map(0, nullptr, &mapped);
-        unsigned char* dst = (unsigned char*)mapped;
-        for (int y = 0; y < height; y++) {
-            memcpy(dst + y * rowPitch, upload_data + y * width * upload_channels, width * upload_channels);
-        }
-        uploadBuffer->Unmap(0, nullptr);
-        
-        // Upload via command list
-        if (m_currentFenceValue > 0) {
-            if (m_fence->GetCompletedValue() < m_currentFenceValue) {
-                m_fence->SetEventOnCompletion(m_currentFenceValue, m_fenceEvent);
-                WaitForSingleObject(m_fenceEvent, INFINITE);
-            }
+        uint32_t handle = registerTexture(std::move(tex));
+        LOG_DEBUG("D3D12: Texture created, handle=%u", handle);
+        return handle;
+    }
+    
+    uint32_t createCompressedTexture(CompressedFormat format, const CompressedMip* mips, uint32_t mipCount) override {
+        if (!mips || mipCount == 0) return 0;
+        // BC textures need a top level that is a whole number of 4x4 blocks
+        if ((mips[0].width % 4) != 0 || (mips[0].height % 4) != 0) return 0;
+        if (m_srvAllocator.full()) {
+            std::fprintf(stderr, "D3D12: Texture limit reached\n");
+            return 0;
         }
-        m_uploadAllocator->Reset();
-        m_uploadCommandList->Reset(m_uploadAllocator.Get(), nullptr);
-        
-        D3D12_PLACED_SUBRESOURCE_FOOTPRINT footprint = {};
-        footprint.Footprint.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
-        footprint.Footprint.Width = width;
-        footprint.Footprint.Height = height;
-        footprint.Footprint.Depth = 1;
-        footprint.Footprint.RowPitch = rowPitch;
         
-        D3D12_TEXTURE_COPY_LOCATION srcLoc = {};
-        srcLoc.pResource = uploadBuffer.Get();
-        srcLoc.Type = D3D12_TEXTURE_COPY_TYPE_PLACED_FOOTPRINT;
-        srcLoc.PlacedFootprint = footprint;
+        DXGI_FORMAT dxgiFormat = DXGI_FORMAT_BC1_UNORM;
+        if (format == CompressedFormat::BC2) dxgiFormat = DXGI_FORMAT_BC2_UNORM;
+        else if (format == CompressedFormat::BC3) dxgiFormat = DXGI_FORMAT_BC3_UNORM;
         
-        D3D12_TEXTURE_COPY_LOCATION dstLoc = {};
-        dstLoc.pResource = tex.resource.Get();
-        dstLoc.Type = D3D12_TEXTURE_COPY_TYPE_SUBRESOURCE_INDEX;
-        dstLoc.SubresourceIndex = 0;
+        D3D12Texture tex;
+        if (!uploadCompressedTexture(tex, dxgiFormat, mips, mipCount)) return 0;
+        return registerTexture(std::move(tex));
+    }
+    
+    bool updateTexture(uint32_t textureHandle, const uint8_t* data, int width, int height, int channels) override {
+        auto it = m_textures.find(textureHandle);
+        if (it == m_textures.end() || !data || it->second.arraySize > 0) return false;
         
-        m_uploadCommandList->CopyTextureRegion(&dstLoc, 0, 0, 0, &srcLoc, nullptr);
+        std::vector<uint8_t> rgba_data;
+        const uint8_t* upload_data = ExpandToRGBA(data, width, height, channels, rgba_data);
         
-        D3D12_RESOURCE_BARRIER barrier = TransitionBarrier(tex.resource.Get(),
-            D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
-        m_uploadCommandList->ResourceBarrier(1, &barrier);
+        D3D12Texture tex;
+        if (!uploadTexture2D(tex, upload_data, width, height)) return false;
         
-        m_uploadCommandList->Close();
-        ID3D12CommandList* lists[] = { m_uploadCommandList.Get() };
-        m_commandQueue->ExecuteCommandLists(1, lists);
+        // The SRV slot is rewritten in place, so no in-flight frame may still
+        // reference the old resource. Wait for the copy too, otherwise the
+        // texture would drop to the dummy SRV until the batch retires.
+        m_uploadQueue.waitFor(tex.uploadFence);
         waitForGpu();
         
-        // Create SRV
-        D3D12_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
-        srvDesc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
-        srvDesc.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
-        srvDesc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURE2D;
-        srvDesc.Texture2D.MipLevels = 1;
-        
-        D3D12_CPU_DESCRIPTOR_HANDLE srvHandle = m_cbvSrvHeap->GetCPUDescriptorHandleForHeapStart();
-        srvHandle.ptr += tex.srvDescriptorIndex * m_cbvSrvDescriptorSize;
-        m_device->CreateShaderResourceView(tex.resource.Get(), &srvDesc, srvHandle);
-        
-        uint32_t handle = m_nextTextureHandle++;
-        m_textures[handle] = std::move(tex);
-        std::printf("D3D12: Texture created successfully, handle=%u, SRV index=%d\n", 
-                   handle, tex.srvDescriptorIndex);
-        return handle;
+        tex.srvDescriptorIndex = it->second.srvDescriptorIndex;
+        createTextureSRV(tex.resource.Get(), tex.srvDescriptorIndex, tex.format, tex.mipLevels);
+        if (tex.mipsPending) m_pendingMips.push_back(textureHandle);
+        it->second = std::move(tex);
+        return true;
     }
     
     void bindTextureToUnit(uint32_t textureHandle, int unit) override {
         // D3D12: Store normal map handle for binding in descriptor table
         if (unit == 1) {
             m_boundNormalMap = textureHandle;
-            std::printf("D3D12: Normal map bound, handle=%u\n", textureHandle);
+            LOG_TRACE("D3D12: Normal map bound, handle=%u", textureHandle);
+        }
+    }
+    
+    // One copy per layer's top level on the upload queue; the mip pass
+    // fills every layer's chain at the start of the first frame after it lands
+    uint32_t createTextureArray(const uint8_t* const* layers, uint32_t layerCount,
+                                int width, int height, uint32_t* layerHandles) override {
+        if (!layers || !layerHandles || layerCount == 0 || width <= 0 || height <= 0) return 0;
+        if (layerCount > D3D12_REQ_TEXTURE2D_ARRAY_AXIS_DIMENSION) {
+            std::fprintf(stderr, "D3D12: createTextureArray - %u layers, at most %u supported\n",
+                         layerCount, (unsigned)D3D12_REQ_TEXTURE2D_ARRAY_AXIS_DIMENSION);
+            return 0;
+        }
+        if (m_srvAllocator.full()) {
+            std::fprintf(stderr, "D3D12: Texture limit reached\n");
+            return 0;
+        }
+        
+        D3D12Texture tex;
+        if (!uploadTexture(tex, layers, layerCount, width, height)) return 0;
+        uint32_t handle = registerTexture(std::move(tex));
+        if (!handle) return 0;
+        
+        D3D12Texture& array = m_textures[handle];
+        for (uint32_t layer = 0; layer < layerCount; layer++) {
+            D3D12Texture view;
+            view.resource           = array.resource;
+            view.srvDescriptorIndex = array.srvDescriptorIndex;
+            view.width              = width;
+            view.height             = height;
+            view.mipLevels          = array.mipLevels;
+            view.arraySize          = layerCount;
+            view.layer              = layer;
+            view.arrayHandle        = handle;
+            view.uploadFence        = array.uploadFence;
+            view.mipsPending        = array.mipsPending;
+            layerHandles[layer] = m_nextTextureHandle++;
+            array.layerHandles.push_back(layerHandles[layer]);
+            m_textures[layerHandles[layer]] = std::move(view);
         }
+        return handle;
     }
 
     // ================================================================
     void drawMesh(uint32_t meshHandle, uint32_t textureHandle = 0) override {
         auto meshIt = m_meshes.find(meshHandle);
         if (meshIt == m_meshes.end()) return;
+        if (!m_uploadQueue.isComplete(meshIt->second.uploadFence)) return;  // Still uploading
 
-        // Update CB for current frame (world, lightDir, useTexture)
+        // Each draw gets its own CB slice, so the GPU sees this draw's constants
         auto shIt = m_shaders.find(m_currentShader);
-        if (shIt != m_shaders.end() && !m_skipCBUpdate) {
-            D3D12Shader& sh = shIt->second;
-            // useTexture moved to root constant, no longer in CB
-            
-            memcpy(m_cbvDataBegin[m_frameIndex], &sh.cbData, sizeof(CBData));
-            
-            // Bind the current frame's constant buffer (b0)
-            m_commandList->SetGraphicsRootConstantBufferView(0,
-                m_constantBuffers[m_frameIndex]->GetGPUVirtualAddress());
-        } else if (shIt != m_shaders.end()) {
-            // Still need to bind the CB even if we skip the update
-            m_commandList->SetGraphicsRootConstantBufferView(0,
-                m_constantBuffers[m_frameIndex]->GetGPUVirtualAddress());
-        }
-        
-        // Push MVP matrix as root constants (root parameter 3, b1 register) - moved to slot 3
-        if (m_hasViewProj) {
-            XMFLOAT4X4 mvpData;
-            XMStoreFloat4x4(&mvpData, m_viewProj);
-            m_commandList->SetGraphicsRoot32BitConstants(3, 16, &mvpData, 0);
-        }
-        
-        // Push lightDir as root constants (root parameter 4, b2 register) - moved to slot 4
-        float lightDirData[3] = {m_lightDir.x, m_lightDir.y, m_lightDir.z};
-        m_commandList->SetGraphicsRoot32BitConstants(4, 3, lightDirData, 0);
-        
-        static int lightDebug = 0;
-        if (lightDebug < 3) {
-            std::printf("D3D12: Pushing lightDir=(%f, %f, %f)\n", 
-                       m_lightDir.x, m_lightDir.y, m_lightDir.z);
-            lightDebug++;
-        }
-        
-        // Push useTexture as root constant (root parameter 5, b3 register) - moved to slot 5
-        float useTextureValue = (textureHandle > 0) ? 1.0f : 0.0f;
-        m_commandList->SetGraphicsRoot32BitConstants(5, 1, &useTextureValue, 0);
-        
-        // Push useNormalMap as root constant (root parameter 6, b4 register) - moved to slot 6
-        m_commandList->SetGraphicsRoot32BitConstants(6, 1, &m_useNormalMap, 0);
+        if (shIt == m_shaders.end()) return;
+        D3D12Mesh& mesh = meshIt->second;
+        if (!bindConstantBuffer(*m_rec, shIt->second, mesh, textureHandle, false)) return;
+        bindVertexFormat(*m_rec, shIt->second, mesh);
 
-        // With separate descriptor tables, we can bind directly to each texture's SRV!
-        // No copying needed - just point to the actual SRV indices
-        
-        D3D12_GPU_DESCRIPTOR_HANDLE srvGpuBase = m_cbvSrvHeap->GetGPUDescriptorHandleForHeapStart();
-        
-        // Bind diffuse texture table (root parameter 1, t0)
-        if (textureHandle > 0) {
-            auto texIt = m_textures.find(textureHandle);
-            if (texIt != m_textures.end()) {
-                D3D12_GPU_DESCRIPTOR_HANDLE diffuseGpu = srvGpuBase;
-                diffuseGpu.ptr += texIt->second.srvDescriptorIndex * m_cbvSrvDescriptorSize;
-                m_commandList->SetGraphicsRootDescriptorTable(1, diffuseGpu);
-            } else {
-                // Bind dummy at slot 1
-                D3D12_GPU_DESCRIPTOR_HANDLE dummyGpu = srvGpuBase;
-                dummyGpu.ptr += 1 * m_cbvSrvDescriptorSize;
-                m_commandList->SetGraphicsRootDescriptorTable(1, dummyGpu);
-            }
-        } else {
-            // Bind dummy at slot 1
-            D3D12_GPU_DESCRIPTOR_HANDLE dummyGpu = srvGpuBase;
-            dummyGpu.ptr += 1 * m_cbvSrvDescriptorSize;
-            m_commandList->SetGraphicsRootDescriptorTable(1, dummyGpu);
-        }
-        
-        // Bind normal map table (root parameter 2, t1)
-        if (m_boundNormalMap > 0) {
-            auto normalTexIt = m_textures.find(m_boundNormalMap);
-            if (normalTexIt != m_textures.end()) {
-                D3D12_GPU_DESCRIPTOR_HANDLE normalGpu = srvGpuBase;
-                normalGpu.ptr += normalTexIt->second.srvDescriptorIndex * m_cbvSrvDescriptorSize;
-                m_commandList->SetGraphicsRootDescriptorTable(2, normalGpu);
-            } else {
-                // Bind dummy
-                D3D12_GPU_DESCRIPTOR_HANDLE dummyGpu = srvGpuBase;
-                dummyGpu.ptr += 1 * m_cbvSrvDescriptorSize;
-                m_commandList->SetGraphicsRootDescriptorTable(2, dummyGpu);
-            }
-        } else {
-            // Bind dummy
-            D3D12_GPU_DESCRIPTOR_HANDLE dummyGpu = srvGpuBase;
-            dummyGpu.ptr += 1 * m_cbvSrvDescriptorSize;
-            m_commandList->SetGraphicsRootDescriptorTable(2, dummyGpu);
-        }
+        // Points straight at the textures' own SRVs, nothing is copied
+        bindTextureTables(*m_rec, shIt->second, textureHandle);
 
-        D3D12Mesh& mesh = meshIt->second;
-        m_commandList->IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
-        m_commandList->IASetVertexBuffers(0, 1, &mesh.vertexBufferView);
-        m_commandList->IASetIndexBuffer(&mesh.indexBufferView);
-        m_commandList->DrawIndexedInstanced(mesh.indexCount, 1, 0, 0, 0);
+        // Slot 1 is part of the input layout; bind the mesh VB there too (ignored when uInstanced = 0)
+        setMeshBuffers(*m_rec, mesh, mesh.vertexBufferView);
+        m_rec->list->DrawIndexedInstanced(mesh.indexCount, 1, mesh.range.firstIndex,
+                                          (INT)mesh.range.baseVertex, 0);
+        m_rec->stateCache.countDraw(mesh.indexCount);
     }
     
-    // Instanced drawing
+    // Instanced drawing: instances are appended to this frame's upload-heap
+    // stream and drawn with a single DrawIndexedInstanced
     void drawMeshInstanced(uint32_t meshHandle, uint32_t textureHandle,
                           const InstanceData* instances, uint32_t instanceCount) override {
-        if (instanceCount == 0 || !instances) return;
-        if (!m_hasViewProj) {
-            printf("D3D12: drawMeshInstanced called but no viewProj stored!\n");
-            return;
-        }
-        
         auto shIt = m_shaders.find(m_currentShader);
         if (shIt == m_shaders.end()) return;
-        
-        static int debugCount = 0;
-        static int totalDraws = 0;
-        if (debugCount < 5) {
-            printf("D3D12 drawMeshInstanced: mesh=%u, tex=%u, count=%u, useTexture will be=%f\n", 
-                   meshHandle, textureHandle, instanceCount, (textureHandle > 0) ? 1.0f : 0.0f);
-            printf("  ViewProj stored: %d\n", m_hasViewProj ? 1 : 0);
-            debugCount++;
-        }
-        
-        // Set flag to prevent viewProj from being overwritten
-        m_inInstancedDraw = true;
-        
-        // Fallback implementation: draw one at a time using stored viewProj
-        // CRITICAL: D3D12 has one CB per frame, so we can't use drawMesh which shares the CB
-        // We must inline everything and hope the GPU reads CB values at draw time (it doesn't!)
-        
-        static bool printedOnce = false;
-        if (!printedOnce && instanceCount > 0) {
-            printf("D3D12 drawMeshInstanced DETAILED DEBUG:\n");
-            printf("  Mesh: %u, Texture: %u, InstanceCount: %u\n", meshHandle, textureHandle, instanceCount);
-            printf("  Frame index: %u\n", m_frameIndex);
-            printf("  CB address: %p\n", m_cbvDataBegin[m_frameIndex]);
-            printf("  First instance world[12]=%f (X position)\n", instances[0].worldMatrix.m[12]);
-            printf("  Last instance world[12]=%f (X position)\n", instances[instanceCount-1].worldMatrix.m[12]);
-            printedOnce = true;
+        InstancedDraw draw = { meshHandle, textureHandle, instances, instanceCount };
+        recordInstanced(*m_rec, shIt->second, draw);
+    }
+
+    // The batch is cut into contiguous passes, one per job thread plus the
+    // caller, each recorded on its own command list. The list recorded so
+    // far is closed first and a fresh one continues after the passes, so
+    // submission order is draw order and the GPU sees the same stream as a
+    // serial loop would produce.
+    void drawInstancedBatch(const InstancedDraw* draws, uint32_t drawCount, JobSystem* jobs) override {
+        auto shIt = m_shaders.find(m_currentShader);
+        if (shIt == m_shaders.end() || drawCount == 0) return;
+        const D3D12Shader& shader = shIt->second;
+
+        uint32_t passes = jobs ? (std::min)(jobs->getWorkerCount() + 1, drawCount / MIN_DRAWS_PER_PASS) : 0;
+        if (passes < 2 || !ensureRecorders(m_recordersUsed + passes + 1)) {
+            for (uint32_t i = 0; i < drawCount; i++) recordInstanced(*m_rec, shader, draws[i]);
+            return;
         }
-        
-        auto meshIt = m_meshes.find(meshHandle);
-        if (meshIt == m_meshes.end()) {
-            printf("D3D12: Mesh %u not found!\n", meshHandle);
-            m_inInstancedDraw = false;
+        uint32_t grain = (drawCount + passes - 1) / passes;
+        passes = (drawCount + grain - 1) / grain;
+
+        closeRecorder(*m_rec);
+        uint32_t firstPass = m_recordersUsed;
+        for (uint32_t p = 0; p < passes; p++) bindShader(openRecorder(), shader);
+
+        jobs->parallelFor(drawCount, grain, [&](uint32_t begin, uint32_t end) {
+            D3D12Recorder& rec = *m_recorders[firstPass + begin / grain];
+            for (uint32_t i = begin; i < end; i++) recordInstanced(rec, shader, draws[i]);
+        });
+
+        for (uint32_t p = 0; p < passes; p++) closeRecorder(*m_recorders[firstPass + p]);
+        m_rec = &openRecorder();
+        bindShader(*m_rec, shader);
+    }
+
+    bool supportsGpuCulling() const override { return m_cullPipeline != nullptr; }
+
+    // Cull pass into this frame's visible buffer on the current list, then
+    // one ExecuteIndirect per group of draws sharing a pool block and texture
+    void drawInstancedCulled(const InstancedDraw* draws, uint32_t drawCount, const Frustum& frustum) override {
+        if (!m_cullPipeline) {
+            drawInstancedBatch(draws, drawCount, nullptr);
             return;
         }
-        D3D12Mesh& mesh = meshIt->second;
-        
-        for (uint32_t i = 0; i < instanceCount; i++) {
-            // World matrix from instance data needs to be transposed to match viewProj
-            XMMATRIX world = Mat4ToXM(instances[i].worldMatrix);
-            world = XMMatrixTranspose(world);
-            
-            // Both world and viewProj are transposed
-            // Multiply in correct order: viewProj * world (both already transposed)
-            XMMATRIX mvp = XMMatrixMultiply(m_viewProj, world);
-            
-            // Update constant buffer with world matrix (b0)
-            shIt->second.cbData.world = world;
-            
-            memcpy(m_cbvDataBegin[m_frameIndex], &shIt->second.cbData, sizeof(CBData));
-            
-            // Bind CB (b0)
-            m_commandList->SetGraphicsRootConstantBufferView(0,
-                m_constantBuffers[m_frameIndex]->GetGPUVirtualAddress());
-            
-            // Push MVP as root constants (root parameter 3, b1) - updated from 2 to 3
-            XMFLOAT4X4 mvpData;
-            XMStoreFloat4x4(&mvpData, mvp);
-            m_commandList->SetGraphicsRoot32BitConstants(3, 16, &mvpData, 0);
-            
-            // Push lightDir as root constants (root parameter 4, b2) - updated from 3 to 4
-            float lightDirData[3] = {m_lightDir.x, m_lightDir.y, m_lightDir.z};
-            m_commandList->SetGraphicsRoot32BitConstants(4, 3, lightDirData, 0);
-            
-            // Push useTexture as root constant (root parameter 5, b3) - updated from 4 to 5
-            float useTextureValue = (textureHandle > 0) ? 1.0f : 0.0f;
-            m_commandList->SetGraphicsRoot32BitConstants(5, 1, &useTextureValue, 0);
-            
-            // Push useNormalMap as root constant (root parameter 6, b4) - updated from 5 to 6
-            m_commandList->SetGraphicsRoot32BitConstants(6, 1, &m_useNormalMap, 0);
-            
-            // Bind 2 separate descriptor tables - no copying!
-            D3D12_GPU_DESCRIPTOR_HANDLE srvGpuBase = m_cbvSrvHeap->GetGPUDescriptorHandleForHeapStart();
-            
-            // Bind diffuse (root parameter 1)
-            if (textureHandle > 0) {
-                auto texIt = m_textures.find(textureHandle);
-                if (texIt != m_textures.end()) {
-                    D3D12_GPU_DESCRIPTOR_HANDLE diffuseGpu = srvGpuBase;
-                    diffuseGpu.ptr += texIt->second.srvDescriptorIndex * m_cbvSrvDescriptorSize;
-                    m_commandList->SetGraphicsRootDescriptorTable(1, diffuseGpu);
-                } else {
-                    D3D12_GPU_DESCRIPTOR_HANDLE dummyGpu = srvGpuBase;
-                    dummyGpu.ptr += 1 * m_cbvSrvDescriptorSize;
-                    m_commandList->SetGraphicsRootDescriptorTable(1, dummyGpu);
-                }
-            } else {
-                D3D12_GPU_DESCRIPTOR_HANDLE dummyGpu = srvGpuBase;
-                dummyGpu.ptr += 1 * m_cbvSrvDescriptorSize;
-                m_commandList->SetGraphicsRootDescriptorTable(1, dummyGpu);
-            }
-            
-            // Bind normal map (root parameter 2)
-            if (m_boundNormalMap > 0) {
-                auto normalTexIt = m_textures.find(m_boundNormalMap);
-                if (normalTexIt != m_textures.end()) {
-                    D3D12_GPU_DESCRIPTOR_HANDLE normalGpu = srvGpuBase;
-                    normalGpu.ptr += normalTexIt->second.srvDescriptorIndex * m_cbvSrvDescriptorSize;
-                    m_commandList->SetGraphicsRootDescriptorTable(2, normalGpu);
-                } else {
-                    D3D12_GPU_DESCRIPTOR_HANDLE dummyGpu = srvGpuBase;
-                    dummyGpu.ptr += 1 * m_cbvSrvDescriptorSize;
-                    m_commandList->SetGraphicsRootDescriptorTable(2, dummyGpu);
-                }
-            } else {
-                D3D12_GPU_DESCRIPTOR_HANDLE dummyGpu = srvGpuBase;
-                dummyGpu.ptr += 1 * m_cbvSrvDescriptorSize;
-                m_commandList->SetGraphicsRootDescriptorTable(2, dummyGpu);
-            }
-            
-            // Draw this instance
-            m_commandList->IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
-            m_commandList->IASetVertexBuffers(0, 1, &mesh.vertexBufferView);
-            m_commandList->IASetIndexBuffer(&mesh.indexBufferView);
-            m_commandList->DrawIndexedInstanced(mesh.indexCount, 1, 0, 0, 0);
-            
-            totalDraws++;
+        auto shIt = m_shaders.find(m_currentShader);
+        if (shIt == m_shaders.end()) return;
+        const D3D12Shader& shader = shIt->second;
+
+        m_cullBatch.build(draws, drawCount, [this](uint32_t meshHandle, GpuCullBatch::MeshInfo& info) {
+            auto it = m_meshes.find(meshHandle);
+            if (it == m_meshes.end() || !m_uploadQueue.isComplete(it->second.uploadFence)) return false;
+            const D3D12Mesh& mesh = it->second;
+            info.indexCount = mesh.indexCount;
+            info.firstIndex = mesh.range.firstIndex;
+            info.baseVertex = (int32_t)mesh.range.baseVertex;
+            info.bounds = mesh.bounds;
+            info.groupKey = mesh.range.block;
+            return true;
+        });
+        uint32_t instanceCount = m_cullBatch.instanceCount();
+        if (instanceCount == 0) return;
+
+        const std::vector<IndirectDrawArgs>& args = m_cullBatch.getArgs();
+        UINT64 argsBytes = args.size() * sizeof(IndirectDrawArgs);
+        UINT64 instanceBytes = (UINT64)instanceCount * sizeof(InstanceData);
+        D3D12CullTargets& targets = m_cullTargets[m_frameIndex];
+        if (!ensureCullTargets(targets, argsBytes, instanceBytes)) {
+            std::fprintf(stderr, "D3D12: Failed to create cull buffers\n");
+            return;
         }
-        
-        static bool printedTotal = false;
-        if (totalDraws >= 800 && !printedTotal) {
-            printf("D3D12: Total draws = %d\n", totalDraws);
-            printedTotal = true;
+
+        // Pass inputs, and the initial args (zero instance counts) to copy
+        D3D12Recorder& rec = *m_rec;
+        D3D12CullConstants constants = {};
+        memcpy(constants.planes, frustum.planes, sizeof(constants.planes));
+        constants.instanceCount = instanceCount;
+        LinearUploadAllocator::Allocation cb = uploadCullInput(rec, &constants, sizeof(constants),
+                                                               D3D12_CONSTANT_BUFFER_DATA_PLACEMENT_ALIGNMENT);
+        LinearUploadAllocator::Allocation inst = uploadCullInput(rec, m_cullBatch.getInstances().data(),
+                                                                 instanceBytes, 16);
+        LinearUploadAllocator::Allocation ids = uploadCullInput(rec, m_cullBatch.getDrawIds().data(),
+                                                                instanceCount * sizeof(uint32_t), 16);
+        LinearUploadAllocator::Allocation bounds = uploadCullInput(rec, m_cullBatch.getBounds().data(),
+                                                                   args.size() * sizeof(Vec4), 16);
+        LinearUploadAllocator::Allocation initialArgs = uploadCullInput(rec, args.data(), argsBytes, 16);
+        if (!cb.cpu || !inst.cpu || !ids.cpu || !bounds.cpu || !initialArgs.cpu) return;
+
+        ID3D12GraphicsCommandList* list = rec.list.Get();
+        ID3D12Resource* argsBuffer = targets.args.Get();
+        ID3D12Resource* visibleBuffer = targets.visible.Get();
+        D3D12_RESOURCE_BARRIER barriers[2];
+        barriers[0] = TransitionBarrier(argsBuffer, D3D12_RESOURCE_STATE_COMMON, D3D12_RESOURCE_STATE_COPY_DEST);
+        list->ResourceBarrier(1, barriers);
+        list->CopyBufferRegion(argsBuffer, 0, initialArgs.resource, initialArgs.offset, argsBytes);
+
+        barriers[0] = TransitionBarrier(argsBuffer, D3D12_RESOURCE_STATE_COPY_DEST,
+                                        D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+        barriers[1] = TransitionBarrier(visibleBuffer, D3D12_RESOURCE_STATE_COMMON,
+                                        D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+        list->ResourceBarrier(2, barriers);
+
+        list->SetComputeRootSignature(m_cullRootSignature.Get());
+        list->SetPipelineState(m_cullPipeline.Get());
+        rec.stateCache.invalidate(STATE_PIPELINE);   // The graphics PSO is set again below
+        list->SetComputeRootConstantBufferView(0, cb.gpu);
+        list->SetComputeRootShaderResourceView(1, inst.gpu);
+        list->SetComputeRootShaderResourceView(2, ids.gpu);
+        list->SetComputeRootShaderResourceView(3, bounds.gpu);
+        list->SetComputeRootUnorderedAccessView(4, argsBuffer->GetGPUVirtualAddress());
+        list->SetComputeRootUnorderedAccessView(5, visibleBuffer->GetGPUVirtualAddress());
+        list->Dispatch((instanceCount + CULL_GROUP_SIZE - 1) / CULL_GROUP_SIZE, 1, 1);
+
+        barriers[0] = TransitionBarrier(argsBuffer, D3D12_RESOURCE_STATE_UNORDERED_ACCESS,
+                                        D3D12_RESOURCE_STATE_INDIRECT_ARGUMENT);
+        barriers[1] = TransitionBarrier(visibleBuffer, D3D12_RESOURCE_STATE_UNORDERED_ACCESS,
+                                        D3D12_RESOURCE_STATE_VERTEX_AND_CONSTANT_BUFFER);
+        list->ResourceBarrier(2, barriers);
+
+        D3D12_VERTEX_BUFFER_VIEW visibleView = {};
+        visibleView.BufferLocation = visibleBuffer->GetGPUVirtualAddress();
+        visibleView.SizeInBytes    = (UINT)instanceBytes;
+        visibleView.StrideInBytes  = sizeof(InstanceData);
+
+        for (const GpuCullBatch::Group& group : m_cullBatch.getGroups()) {
+            const D3D12Mesh& mesh = m_meshes.find(group.meshHandle)->second;
+            if (!bindConstantBuffer(rec, shader, mesh, group.textureHandle, true)) continue;
+            bindVertexFormat(rec, shader, mesh);
+            bindTextureTables(rec, shader, group.textureHandle);
+            setMeshBuffers(rec, mesh, visibleView);
+            list->ExecuteIndirect(m_drawIndexedSignature.Get(), group.drawCount, argsBuffer,
+                                  group.firstDraw * sizeof(IndirectDrawArgs), nullptr, 0);
+            rec.stateCache.countIndirectDraw(group.instances, group.triangles);
         }
-        
-        m_inInstancedDraw = false;
+
+        barriers[0] = TransitionBarrier(argsBuffer, D3D12_RESOURCE_STATE_INDIRECT_ARGUMENT,
+                                        D3D12_RESOURCE_STATE_COMMON);
+        barriers[1] = TransitionBarrier(visibleBuffer, D3D12_RESOURCE_STATE_VERTEX_AND_CONSTANT_BUFFER,
+                                        D3D12_RESOURCE_STATE_COMMON);
+        list->ResourceBarrier(2, barriers);
     }
 
+    // Baked into PSOs at createShader time, so not part of the state cache
     void setDepthTest(bool enable) override { m_depthTestEnabled = enable; }
     void setCulling(bool enable) override { m_cullingEnabled = enable; }
+
+    void invalidateStateCache() override { m_rec->stateCache.invalidate(); }
+
+    // Summed over every list of the last submitted frame
+    const RenderStateStats& getStateStats() const override { return m_lastStats; }
+
+    void beginGpuZone(const char* name) override { writeTimestamp(m_gpuTimer.beginZone(name)); }
+    void endGpuZone() override { writeTimestamp(m_gpuTimer.endZone()); }
+    const GpuFrameTiming& getGpuTiming() const override { return m_gpuTimer.getLatest(); }
 };
 
 // ==================== Factory ====================
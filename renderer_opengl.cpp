@@ -1,14 +1,42 @@
 // renderer_opengl.cpp - OpenGL implementation
 #include "renderer.h"
+#include "render_state_cache.h"
+#include "gpu_timer.h"
+#include "geometry_pool.h"
+#include "gpu_cull.h"
+#include "debug.h"
 #include <glad/glad.h>
 #include <GLFW/glfw3.h>
 #include <cstdio>
+#include <cstddef>
+#include <cstring>
 #include <string>
 #include <vector>
 #include <unordered_map>
 #include "stb_image.h"
+#include "dds_loader.h"
+
+// EXT_texture_compression_s3tc (not part of the core 3.3 headers)
+#ifndef GL_COMPRESSED_RGBA_S3TC_DXT1_EXT
+#define GL_COMPRESSED_RGBA_S3TC_DXT1_EXT 0x83F1
+#define GL_COMPRESSED_RGBA_S3TC_DXT3_EXT 0x83F2
+#define GL_COMPRESSED_RGBA_S3TC_DXT5_EXT 0x83F3
+#endif
 
 // ==================== OpenGL Default Shaders ====================
+// DrawConstants (renderer.h) as a std140 block, shared by both stages
+#define GLSL_DRAW_CONSTANTS \
+    "layout(std140) uniform DrawConstants {\n" \
+    "    mat4  uMVP;          // Full MVP, or view-projection when uInstanced is set\n" \
+    "    mat4  uWorld;\n" \
+    "    vec3  uLightDir;\n" \
+    "    float uUseTexture;\n" \
+    "    float uUseNormalMap;\n" \
+    "    float uInstanced;    // 1 = world/tint come from the instance buffer\n" \
+    "    float uPackedVertex; // 1 = PackedVertex: octahedral aNrm.xy / aTangent.xy, bitangent sign in aTangent.z\n" \
+    "    float uTextureLayer; // Layer of uTextureArray when uUseTexture = 2\n" \
+    "};\n"
+
 const char* OPENGL_VERTEX_SHADER = R"(
 #version 330 core
 layout(location=0) in vec3 aPos;
@@ -17,34 +45,61 @@ layout(location=2) in vec4 aCol;
 layout(location=3) in vec2 aTexCoord;
 layout(location=4) in vec3 aTangent;
 layout(location=5) in vec3 aBitangent;
-
-uniform mat4 uMVP;
-uniform mat4 uWorld;
-
+layout(location=6) in mat4 aInstWorld;   // Per-instance world matrix (locations 6-9)
+layout(location=10) in vec4 aInstTint;   // Per-instance color tint
+)" GLSL_DRAW_CONSTANTS R"(
 out vec3 vNrmW;
 out vec4 vCol;
 out vec2 vTexCoord;
 out mat3 vTBN;  // Tangent-Bitangent-Normal matrix for normal mapping
+out vec4 vTint;
+
+vec3 octDecode(vec2 e)
+{
+    vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+    float t = max(-n.z, 0.0);
+    n.x += (n.x >= 0.0) ? -t : t;
+    n.y += (n.y >= 0.0) ? -t : t;
+    return normalize(n);
+}
 
 void main()
 {
-    gl_Position = uMVP * vec4(aPos, 1.0);
+    mat4 world = uWorld;
+    vec4 tint = vec4(1.0);
+    if (uInstanced > 0.5) {
+        world = aInstWorld;
+        tint = aInstTint;
+        gl_Position = uMVP * (world * vec4(aPos, 1.0));
+    } else {
+        gl_Position = uMVP * vec4(aPos, 1.0);
+    }
+    
+    vec3 nrm = aNrm;
+    vec3 tan = aTangent;
+    float bSign = 1.0;
+    if (uPackedVertex > 0.5) {
+        nrm = octDecode(aNrm.xy);
+        tan = octDecode(aTangent.xy);
+        bSign = (aTangent.z < 0.0) ? -1.0 : 1.0;
+    }
     
     // Transform normal, tangent, bitangent to world space
-    vec3 T = normalize(vec3(uWorld * vec4(aTangent, 0.0)));
-    vec3 B = normalize(vec3(uWorld * vec4(aBitangent, 0.0)));
-    vec3 N = normalize(vec3(uWorld * vec4(aNrm, 0.0)));
+    vec3 T = normalize(vec3(world * vec4(tan, 0.0)));
+    vec3 B = normalize(vec3(world * vec4(aBitangent, 0.0)));
+    vec3 N = normalize(vec3(world * vec4(nrm, 0.0)));
     
     // Re-orthogonalize TBN using Gram-Schmidt process
     // This ensures T, B, N are perpendicular even if input data is slightly off
     T = normalize(T - dot(T, N) * N);  // Make T perpendicular to N
-    B = normalize(cross(N, T));         // Make B perpendicular to both
+    B = normalize(cross(N, T)) * bSign; // Make B perpendicular to both
     
     // Construct TBN matrix (transforms from tangent space to world space)
     vTBN = mat3(T, B, N);
     
     vNrmW = N;  // Keep original normal for non-normal-mapped surfaces
     vCol = aCol;
+    vTint = tint;
     vTexCoord = aTexCoord;
 }
 )";
@@ -55,12 +110,11 @@ in vec3 vNrmW;
 in vec4 vCol;
 in vec2 vTexCoord;
 in mat3 vTBN;
-
-uniform vec3 uLightDir;
-uniform int uUseTexture;
-uniform int uUseNormalMap;  // Flag for normal mapping
+in vec4 vTint;
+)" GLSL_DRAW_CONSTANTS R"(
 uniform sampler2D uTexture;
 uniform sampler2D uNormalMap;  // Normal map texture
+uniform sampler2DArray uTextureArray;  // Texture array layers (unit set by the renderer)
 
 out vec4 FragColor;
 
@@ -71,7 +125,7 @@ void main()
     
     // Get normal (either from normal map or vertex normal)
     vec3 N = vNrmW;
-    if (uUseNormalMap > 0) {
+    if (uUseNormalMap > 0.5) {
         // Sample normal map and convert from [0,1] to [-1,1]
         vec3 normalMapSample = texture(uNormalMap, vTexCoord).rgb;
         vec3 tangentNormal = normalize(normalMapSample * 2.0 - 1.0);
@@ -88,33 +142,104 @@ void main()
     
     // Base color (texture or vertex color)
     vec4 baseColor = vCol;
-    if (uUseTexture > 0) {
+    if (uUseTexture > 1.5) {
+        baseColor = texture(uTextureArray, vec3(vTexCoord, uTextureLayer));
+    } else if (uUseTexture > 0.5) {
         baseColor = texture(uTexture, vTexCoord);
     }
     
-    FragColor = vec4(baseColor.rgb * diff, baseColor.a);
+    FragColor = vec4(baseColor.rgb * vTint.rgb * diff, baseColor.a);
+}
+)";
+
+// ==================== GPU Cull Shader ====================
+// One invocation per instance of a GpuCullBatch (gpu_cull.h). Needs GL 4.3:
+// compute shaders, storage buffers and base instances in indirect commands.
+static const GLuint CULL_GROUP_SIZE = 64;
+static const char* OPENGL_CULL_SHADER = R"(
+#version 430 core
+layout(local_size_x = 64) in;
+
+struct Instance { vec4 world[4]; vec4 tint; };   // InstanceData, world by column
+struct DrawArgs { uint indexCount; uint instanceCount; uint firstIndex; int baseVertex; uint firstInstance; };
+
+layout(std430, binding = 0) readonly buffer Instances { Instance instances[]; };
+layout(std430, binding = 1) readonly buffer DrawIds { uint drawIds[]; };
+layout(std430, binding = 2) readonly buffer Bounds { vec4 bounds[]; };
+layout(std430, binding = 3) buffer Args { DrawArgs args[]; };
+layout(std430, binding = 4) writeonly buffer Visible { Instance visible[]; };
+
+uniform vec4 uPlanes[6];   // Frustum::planes, normals inward
+uniform uint uInstanceCount;
+
+void main()
+{
+    uint i = gl_GlobalInvocationID.x;
+    if (i >= uInstanceCount) return;
+
+    uint d = drawIds[i];
+    vec4 b = bounds[d];
+    vec4 c0 = instances[i].world[0], c1 = instances[i].world[1], c2 = instances[i].world[2];
+    vec3 center = c0.xyz * b.x + c1.xyz * b.y + c2.xyz * b.z + instances[i].world[3].xyz;
+    float radius = b.w * sqrt(max(dot(c0.xyz, c0.xyz), max(dot(c1.xyz, c1.xyz), dot(c2.xyz, c2.xyz))));
+    for (int p = 0; p < 6; p++) {
+        if (dot(uPlanes[p].xyz, center) + uPlanes[p].w < -radius) return;
+    }
+
+    uint slot = atomicAdd(args[d].instanceCount, 1u);
+    visible[args[d].firstInstance + slot] = instances[i];
 }
 )";
 
 // ==================== OpenGL Texture ====================
+// A texture array is one entry owning the GL object plus one entry per
+// layer sharing its id; destroying the array removes the layer entries too
 struct GLTexture {
     GLuint id;
     int width;
     int height;
+    GLenum target = GL_TEXTURE_2D;       // GL_TEXTURE_2D_ARRAY for arrays and their layers
+    uint32_t layer = 0;
+    uint32_t arrayHandle = 0;            // Set on layer entries
+    std::vector<uint32_t> layerHandles;  // Set on the array entry
 };
 
 // ==================== OpenGL Mesh ====================
+// A range of a geometry pool block, drawn with the block's VAO
 struct GLMesh {
+    GLuint vao;
+    GeometryRange range;
+    uint32_t indexCount;
+    GLenum indexType;    // GL_UNSIGNED_SHORT or GL_UNSIGNED_INT
+    bool packed;         // PackedVertex layout
+    Vec4 bounds;         // Local bounding sphere, for GPU culling
+
+    const void* indexOffset() const {
+        return (const void*)((size_t)range.firstIndex * (indexType == GL_UNSIGNED_INT ? 4 : 2));
+    }
+};
+
+// Buffers of one GeometryPool block; the VAO carries its vertex layout
+struct GLGeometryBlock {
     GLuint vao;
     GLuint vbo;
     GLuint ebo;
-    uint32_t indexCount;
 };
 
 // ==================== OpenGL Shader ====================
+// A resolved uniform: a DrawConstants field when the program declares the
+// block and the name is one of its members, else a plain uniform location
+struct GLUniform {
+    GLint location;
+    int   drawField;     // DrawConstantField, or -1
+};
+
 struct GLShader {
     GLuint program;
-    std::unordered_map<std::string, GLint> uniformLocations;
+    bool hasDrawConstants;                                   // Declares the DrawConstants block
+    DrawConstants drawConstants;                             // Uploaded on each draw
+    std::vector<GLUniform> uniforms;                         // Indexed by UniformHandle
+    std::unordered_map<std::string, UniformHandle> uniformHandles;  // Name lookups (setup only)
 };
 
 // ==================== OpenGL Renderer ====================
@@ -122,6 +247,8 @@ class OpenGLRenderer : public IRenderer {
 private:
     GLFWwindow* m_window;
     std::unordered_map<uint32_t, GLMesh> m_meshes;
+    GeometryPool m_geometryPool;
+    std::vector<GLGeometryBlock> m_geometryBlocks;   // Parallel to m_geometryPool's blocks
     std::unordered_map<uint32_t, GLShader> m_shaders;
     std::unordered_map<uint32_t, GLTexture> m_textures;
     uint32_t m_nextMeshHandle;
@@ -129,10 +256,51 @@ private:
     uint32_t m_nextTextureHandle;
     uint32_t m_currentShader;
     
-    // Store view-projection for instanced rendering
-    Mat4 m_viewProj;
-    bool m_hasViewProj;
-    bool m_inInstancedDraw;  // Flag to prevent overwriting viewProj during instanced draw
+    // DrawConstants block, bound at DRAW_CONSTANTS_BINDING for every program.
+    // Re-specified with the whole block on each draw whose constants differ
+    // from the last upload (one buffer write, no per-uniform calls).
+    static constexpr GLuint DRAW_CONSTANTS_BINDING = 0;
+    GLuint m_drawConstantsUBO;
+    DrawConstants m_uploadedConstants;
+    bool m_hasUploadedConstants;
+    
+    // Shared per-instance stream (InstanceData), attached to every mesh VAO
+    // at locations 6-10 with divisor 1. Re-specified (orphaned) on each
+    // instanced draw so the driver never stalls on an in-flight buffer.
+    GLuint m_instanceVBO;
+    uint32_t m_instanceCapacity;  // In instances
+    
+    bool m_hasS3TC;  // BC1-3 upload support (EXT_texture_compression_s3tc)
+    GLint m_maxArrayLayers;  // GL_MAX_ARRAY_TEXTURE_LAYERS (at least 256)
+    
+    // Unit of the default shader's "uTextureArray"; 2D textures stay on unit 0
+    static constexpr GLuint ARRAY_TEXTURE_UNIT = 2;
+    
+    // GPU culling (GL 4.3). Batch inputs are re-specified into the cull
+    // buffers per call; the visible instances are written into
+    // m_instanceVBO, where the mesh VAOs already read them.
+    enum CullBuffer { CULL_INSTANCES, CULL_DRAW_IDS, CULL_BOUNDS, CULL_ARGS, CULL_BUFFER_COUNT };
+    bool m_hasGpuCulling;
+    GLuint m_cullProgram;
+    GLint m_cullPlanesLoc;
+    GLint m_cullInstanceCountLoc;
+    GLuint m_cullBuffers[CULL_BUFFER_COUNT];
+    GpuCullBatch m_cullBatch;
+    
+    // Shadow of program, VAO, per-unit texture and enable-bit bindings.
+    // Draws leave their VAO and textures bound for the next draw to reuse.
+    RenderStateCache m_stateCache;
+    GLuint m_activeTextureUnit;  // Last glActiveTexture unit, NO_TEXTURE_UNIT if unknown
+    static constexpr GLuint NO_TEXTURE_UNIT = ~0u;
+    
+    // GL_TIMESTAMP queries (core since 3.3), one per GpuTimerRing index
+    GpuTimerRing m_gpuTimer;
+    GLuint m_timestampQueries[GpuTimerRing::QUERY_COUNT];
+    bool m_hasTimestampQueries;
+
+    // GL has no control over the swap queue: low latency finishes each
+    // frame after the swap instead, so the driver never runs ahead
+    bool m_lowLatency;
 
     GLuint compileShader(GLenum type, const char* src) {
         GLuint sh = glCreateShader(type);
@@ -153,10 +321,11 @@ private:
         return sh;
     }
 
-    GLuint linkProgram(GLuint vs, GLuint fs) {
+    // A compute program is linked from its one shader, passed as 'vs'
+    GLuint linkProgram(GLuint vs, GLuint fs = 0) {
         GLuint p = glCreateProgram();
         glAttachShader(p, vs);
-        glAttachShader(p, fs);
+        if (fs) glAttachShader(p, fs);
         glLinkProgram(p);
 
         GLint ok = 0;
@@ -176,12 +345,27 @@ private:
 public:
     OpenGLRenderer() 
         : m_window(nullptr)
+        , m_geometryPool(GEOMETRY_VERTEX_BLOCK_BYTES, GEOMETRY_INDEX_BLOCK_BYTES)
         , m_nextMeshHandle(1)
         , m_nextShaderHandle(1)
         , m_nextTextureHandle(1)
         , m_currentShader(0)
-        , m_hasViewProj(false)
-        , m_inInstancedDraw(false)
+        , m_drawConstantsUBO(0)
+        , m_uploadedConstants()
+        , m_hasUploadedConstants(false)
+        , m_instanceVBO(0)
+        , m_instanceCapacity(0)
+        , m_hasS3TC(false)
+        , m_maxArrayLayers(256)
+        , m_hasGpuCulling(false)
+        , m_cullProgram(0)
+        , m_cullPlanesLoc(-1)
+        , m_cullInstanceCountLoc(-1)
+        , m_cullBuffers()
+        , m_activeTextureUnit(NO_TEXTURE_UNIT)
+        , m_timestampQueries()
+        , m_hasTimestampQueries(false)
+        , m_lowLatency(false)
     {}
 
     virtual ~OpenGLRenderer() {
@@ -201,104 +385,150 @@ public:
         std::printf("OpenGL Version: %s\n", glGetString(GL_VERSION));
         std::printf("GLSL Version: %s\n", glGetString(GL_SHADING_LANGUAGE_VERSION));
 
+        GLint extCount = 0;
+        glGetIntegerv(GL_NUM_EXTENSIONS, &extCount);
+        for (GLint i = 0; i < extCount; i++) {
+            const char* ext = (const char*)glGetStringi(GL_EXTENSIONS, (GLuint)i);
+            if (ext && strcmp(ext, "GL_EXT_texture_compression_s3tc") == 0) m_hasS3TC = true;
+        }
+        std::printf("S3TC compressed textures: %s\n", m_hasS3TC ? "yes" : "no (CPU decode fallback)");
+        glGetIntegerv(GL_MAX_ARRAY_TEXTURE_LAYERS, &m_maxArrayLayers);
+
         // Set default state
         glEnable(GL_DEPTH_TEST);
         glDepthFunc(GL_LESS);
         glClearDepth(1.0);
 
+        // Instance stream must exist before any mesh VAO is created
+        m_instanceCapacity = INITIAL_INSTANCE_CAPACITY;
+        glGenBuffers(1, &m_instanceVBO);
+        glBindBuffer(GL_ARRAY_BUFFER, m_instanceVBO);
+        glBufferData(GL_ARRAY_BUFFER, m_instanceCapacity * sizeof(InstanceData), nullptr, GL_STREAM_DRAW);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+        glGenBuffers(1, &m_drawConstantsUBO);
+        glBindBuffer(GL_UNIFORM_BUFFER, m_drawConstantsUBO);
+        glBufferData(GL_UNIFORM_BUFFER, sizeof(DrawConstants), nullptr, GL_STREAM_DRAW);
+        glBindBuffer(GL_UNIFORM_BUFFER, 0);
+        glBindBufferBase(GL_UNIFORM_BUFFER, DRAW_CONSTANTS_BINDING, m_drawConstantsUBO);
+        m_hasUploadedConstants = false;
+
+        glGenQueries((GLsizei)GpuTimerRing::QUERY_COUNT, m_timestampQueries);
+        m_hasTimestampQueries = true;
+
+        m_hasGpuCulling = createCullProgram();
+        std::printf("GPU culling: %s\n", m_hasGpuCulling ? "yes" : "no (needs GL 4.3)");
+
         return true;
     }
 
     void shutdown() override {
-        // Clean up meshes
-        for (auto& pair : m_meshes) {
-            glDeleteVertexArrays(1, &pair.second.vao);
-            glDeleteBuffers(1, &pair.second.vbo);
-            glDeleteBuffers(1, &pair.second.ebo);
-        }
+        // Clean up meshes and the pool blocks holding them
         m_meshes.clear();
+        for (GLGeometryBlock& block : m_geometryBlocks) {
+            glDeleteVertexArrays(1, &block.vao);
+            glDeleteBuffers(1, &block.vbo);
+            glDeleteBuffers(1, &block.ebo);
+        }
+        m_geometryBlocks.clear();
+        m_geometryPool.clear();
 
         // Clean up shaders
         for (auto& pair : m_shaders) {
             glDeleteProgram(pair.second.program);
         }
         m_shaders.clear();
+        m_stateCache.invalidate();
+
+        if (m_drawConstantsUBO) {
+            glDeleteBuffers(1, &m_drawConstantsUBO);
+            m_drawConstantsUBO = 0;
+        }
+
+        if (m_instanceVBO) {
+            glDeleteBuffers(1, &m_instanceVBO);
+            m_instanceVBO = 0;
+            m_instanceCapacity = 0;
+        }
+
+        if (m_cullProgram) {
+            glDeleteProgram(m_cullProgram);
+            glDeleteBuffers(CULL_BUFFER_COUNT, m_cullBuffers);
+            m_cullProgram = 0;
+            m_hasGpuCulling = false;
+        }
+
+        if (m_hasTimestampQueries) {
+            glDeleteQueries((GLsizei)GpuTimerRing::QUERY_COUNT, m_timestampQueries);
+            m_hasTimestampQueries = false;
+        }
     }
 
     void beginFrame() override {
+        m_stateCache.beginFrame();
+        m_activeTextureUnit = NO_TEXTURE_UNIT;
+        resolveTimestamps();
+        writeTimestamp(m_gpuTimer.beginFrame());
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
     }
 
     void endFrame() override {
+        writeTimestamp(m_gpuTimer.endFrame());
         glfwSwapBuffers(m_window);
+        if (m_lowLatency) glFinish();
     }
 
     void setClearColor(float r, float g, float b, float a) override {
         glClearColor(r, g, b, a);
     }
 
+    void setVSync(bool enabled) override {
+        glfwSwapInterval(enabled ? 1 : 0);
+    }
+
+    void setLowLatency(bool enabled) override { m_lowLatency = enabled; }
+    // Swaps without vsync tear anyway
+    void setAllowTearing(bool enabled) override { (void)enabled; }
+    void waitForFrameSlot() override {}
+
+    void makeCurrent(bool current) override {
+        glfwMakeContextCurrent(current ? m_window : nullptr);
+    }
+
     void setViewport(int width, int height) override {
         glViewport(0, 0, width, height);
     }
 
     uint32_t createMesh(const Vertex* vertices, uint32_t vertexCount,
                        const uint16_t* indices, uint32_t indexCount) override {
-        GLMesh mesh;
-        mesh.indexCount = indexCount;
-
-        glGenVertexArrays(1, &mesh.vao);
-        glGenBuffers(1, &mesh.vbo);
-        glGenBuffers(1, &mesh.ebo);
-
-        glBindVertexArray(mesh.vao);
-
-        glBindBuffer(GL_ARRAY_BUFFER, mesh.vbo);
-        glBufferData(GL_ARRAY_BUFFER, vertexCount * sizeof(Vertex), vertices, GL_STATIC_DRAW);
-
-        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mesh.ebo);
-        glBufferData(GL_ELEMENT_ARRAY_BUFFER, indexCount * sizeof(uint16_t), indices, GL_STATIC_DRAW);
-
-        // Position (attribute 0)
-        glEnableVertexAttribArray(0);
-        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)0);
-
-        // Normal (attribute 1)
-        glEnableVertexAttribArray(1);
-        glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)(3 * sizeof(float)));
-
-        // Color (attribute 2)
-        glEnableVertexAttribArray(2);
-        glVertexAttribPointer(2, 4, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)(6 * sizeof(float)));
-
-        // TexCoord (attribute 3)
-        glEnableVertexAttribArray(3);
-        glVertexAttribPointer(3, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)(10 * sizeof(float)));
-
-        // Tangent (attribute 4) - for normal mapping
-        glEnableVertexAttribArray(4);
-        glVertexAttribPointer(4, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)(12 * sizeof(float)));
-
-        // Bitangent (attribute 5) - for normal mapping
-        glEnableVertexAttribArray(5);
-        glVertexAttribPointer(5, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)(15 * sizeof(float)));
+        return createMeshBuffers(vertices, vertexCount * sizeof(Vertex), false,
+                                 indices, indexCount, GL_UNSIGNED_SHORT);
+    }
 
-        glBindVertexArray(0);
+    uint32_t createMesh(const Vertex* vertices, uint32_t vertexCount,
+                       const uint32_t* indices, uint32_t indexCount) override {
+        return createMesh32(vertices, vertexCount * sizeof(Vertex), false,
+                            vertexCount, indices, indexCount);
+    }
 
-        uint32_t handle = m_nextMeshHandle++;
-        m_meshes[handle] = mesh;
-        return handle;
+    uint32_t createMesh(const PackedVertex* vertices, uint32_t vertexCount,
+                       const uint32_t* indices, uint32_t indexCount) override {
+        return createMesh32(vertices, vertexCount * sizeof(PackedVertex), true,
+                            vertexCount, indices, indexCount);
     }
 
     void destroyMesh(uint32_t meshHandle) override {
         auto it = m_meshes.find(meshHandle);
         if (it != m_meshes.end()) {
-            glDeleteVertexArrays(1, &it->second.vao);
-            glDeleteBuffers(1, &it->second.vbo);
-            glDeleteBuffers(1, &it->second.ebo);
+            // The block keeps its buffers; later uploads into the range are
+            // ordered after earlier draws by the driver
+            m_geometryPool.free(it->second.range);
             m_meshes.erase(it);
         }
     }
 
+    bool isMeshReady(uint32_t meshHandle) const override { return m_meshes.count(meshHandle) != 0; }
+
     uint32_t createShader(const char* vertexSource, const char* fragmentSource) override {
         GLuint vs = compileShader(GL_VERTEX_SHADER, vertexSource);
         GLuint fs = compileShader(GL_FRAGMENT_SHADER, fragmentSource);
@@ -316,6 +546,26 @@ public:
 
         GLShader shader;
         shader.program = program;
+        shader.hasDrawConstants = false;
+        shader.drawConstants = DrawConstants();
+        shader.drawConstants.mvp = mat4_identity();
+        shader.drawConstants.world = mat4_identity();
+        shader.drawConstants.lightDir = {0.0f, -1.0f, 0.0f};
+
+        GLuint blockIndex = glGetUniformBlockIndex(program, "DrawConstants");
+        if (blockIndex != GL_INVALID_INDEX) {
+            glUniformBlockBinding(program, blockIndex, DRAW_CONSTANTS_BINDING);
+            shader.hasDrawConstants = true;
+        }
+        
+        // Left at unit 0 it would alias uTexture with a different sampler
+        // type, which fails every draw
+        GLint arrayLocation = glGetUniformLocation(program, "uTextureArray");
+        if (arrayLocation >= 0) {
+            glUseProgram(program);
+            glUniform1i(arrayLocation, (GLint)ARRAY_TEXTURE_UNIT);
+            m_stateCache.invalidate(STATE_SHADER);
+        }
 
         uint32_t handle = m_nextShaderHandle++;
         m_shaders[handle] = shader;
@@ -327,67 +577,98 @@ public:
         if (it != m_shaders.end()) {
             glDeleteProgram(it->second.program);
             m_shaders.erase(it);
+            m_stateCache.invalidate(STATE_SHADER);
         }
     }
 
     void useShader(uint32_t shaderHandle) override {
         auto it = m_shaders.find(shaderHandle);
         if (it != m_shaders.end()) {
-            glUseProgram(it->second.program);
+            if (m_stateCache.set(STATE_SHADER, it->second.program)) glUseProgram(it->second.program);
             m_currentShader = shaderHandle;
         }
     }
 
-    void setUniformMat4(uint32_t shaderHandle, const char* name, const Mat4& matrix) override {
+    UniformHandle getUniformHandle(uint32_t shaderHandle, const char* name) override {
         auto it = m_shaders.find(shaderHandle);
-        if (it != m_shaders.end()) {
-            GLShader& shader = it->second;
-            
-            // Cache uniform location
-            auto locIt = shader.uniformLocations.find(name);
-            GLint loc;
-            if (locIt == shader.uniformLocations.end()) {
-                loc = glGetUniformLocation(shader.program, name);
-                shader.uniformLocations[name] = loc;
-            } else {
-                loc = locIt->second;
-            }
+        if (it == m_shaders.end()) return INVALID_UNIFORM;
+        GLShader& shader = it->second;
 
-            if (loc >= 0) {
-                glUniformMatrix4fv(loc, 1, GL_FALSE, matrix.m);
-                
-                // Store view-projection for instanced rendering
-                // Only store when setting the initial view-proj, not during instanced drawing
-                if (std::string(name) == "uMVP" && !m_inInstancedDraw) {
-                    m_viewProj = matrix;
-                    m_hasViewProj = true;
-                }
-            }
+        auto handleIt = shader.uniformHandles.find(name);
+        if (handleIt != shader.uniformHandles.end()) return handleIt->second;
+
+        GLUniform uniform;
+        uniform.drawField = shader.hasDrawConstants ? findDrawConstantField(name) : -1;
+        uniform.location = uniform.drawField < 0 ? glGetUniformLocation(shader.program, name) : -1;
+
+        UniformHandle handle = INVALID_UNIFORM;
+        if (uniform.drawField >= 0 || uniform.location >= 0) {
+            handle = (UniformHandle)shader.uniforms.size();
+            shader.uniforms.push_back(uniform);
         }
+        shader.uniformHandles[name] = handle;
+        return handle;
+    }
+
+    void setUniformMat4(uint32_t shaderHandle, const char* name, const Mat4& matrix) override {
+        setUniformMat4(shaderHandle, getUniformHandle(shaderHandle, name), matrix);
     }
 
     void setUniformVec3(uint32_t shaderHandle, const char* name, const Vec3& vec) override {
-        auto it = m_shaders.find(shaderHandle);
-        if (it != m_shaders.end()) {
-            GLShader& shader = it->second;
-            
-            // Cache uniform location
-            auto locIt = shader.uniformLocations.find(name);
-            GLint loc;
-            if (locIt == shader.uniformLocations.end()) {
-                loc = glGetUniformLocation(shader.program, name);
-                shader.uniformLocations[name] = loc;
-            } else {
-                loc = locIt->second;
-            }
+        setUniformVec3(shaderHandle, getUniformHandle(shaderHandle, name), vec);
+    }
 
-            if (loc >= 0) {
-                glUniform3f(loc, vec.x, vec.y, vec.z);
-            }
-        }
+    void setUniformInt(uint32_t shaderHandle, const char* name, int value) override {
+        setUniformInt(shaderHandle, getUniformHandle(shaderHandle, name), value);
+    }
+
+    void setUniformMat4(uint32_t shaderHandle, UniformHandle uniform, const Mat4& matrix) override {
+        GLShader* shader = findShader(shaderHandle);
+        if (!shader || uniform < 0 || uniform >= (UniformHandle)shader->uniforms.size()) return;
+        const GLUniform& u = shader->uniforms[uniform];
+        if (u.drawField >= 0) setDrawConstantMat4(shader->drawConstants, u.drawField, matrix);
+        else glUniformMatrix4fv(u.location, 1, GL_FALSE, matrix.m);
+    }
+
+    void setUniformVec3(uint32_t shaderHandle, UniformHandle uniform, const Vec3& vec) override {
+        GLShader* shader = findShader(shaderHandle);
+        if (!shader || uniform < 0 || uniform >= (UniformHandle)shader->uniforms.size()) return;
+        const GLUniform& u = shader->uniforms[uniform];
+        if (u.drawField >= 0) setDrawConstantVec3(shader->drawConstants, u.drawField, vec);
+        else glUniform3f(u.location, vec.x, vec.y, vec.z);
+    }
+
+    void setUniformInt(uint32_t shaderHandle, UniformHandle uniform, int value) override {
+        GLShader* shader = findShader(shaderHandle);
+        if (!shader || uniform < 0 || uniform >= (UniformHandle)shader->uniforms.size()) return;
+        const GLUniform& u = shader->uniforms[uniform];
+        if (u.drawField >= 0) setDrawConstantInt(shader->drawConstants, u.drawField, value);
+        else glUniform1i(u.location, value);
+    }
+
+    void setDrawConstants(uint32_t shaderHandle, const DrawConstants& constants) override {
+        GLShader* shader = findShader(shaderHandle);
+        if (shader) shader->drawConstants = constants;
     }
 
     uint32_t createTexture(const char* filepath) override {
+        // DDS: upload the BC blocks directly, decode on the CPU only as a fallback
+        const char* ext = strrchr(filepath, '.');
+        if (ext && (strcmp(ext, ".dds") == 0 || strcmp(ext, ".DDS") == 0)) {
+            DDSImage image;
+            if (DDSLoader::LoadCompressed(filepath, image)) {
+                uint32_t handle = createCompressedTexture(image.format, image.mips.data(),
+                                                          (uint32_t)image.mips.size());
+                if (handle) return handle;
+            }
+            int w, h, ch;
+            unsigned char* pixels = DDSLoader::Load(filepath, &w, &h, &ch);
+            if (!pixels) return 0;
+            uint32_t handle = createTextureFromData(pixels, w, h, ch);
+            delete[] pixels;
+            return handle;
+        }
+        
         // Load image using stb_image
         int width, height, channels;
         // DON'T flip - 3DS models expect textures in their native orientation
@@ -428,7 +709,7 @@ public:
         // Generate mipmaps
         glGenerateMipmap(GL_TEXTURE_2D);
         
-        glBindTexture(GL_TEXTURE_2D, 0);
+        unbindEditedTexture();
         
         // Free image data
         stbi_image_free(data);
@@ -444,7 +725,7 @@ public:
             return 0;
         }
         
-        std::printf("Creating texture from data (%dx%d, %d channels)\n", width, height, channels);
+        LOG_DEBUG("Creating texture from data (%dx%d, %d channels)", width, height, channels);
         
         // Create OpenGL texture
         GLTexture texture;
@@ -472,7 +753,7 @@ public:
         // Generate mipmaps
         glGenerateMipmap(GL_TEXTURE_2D);
         
-        glBindTexture(GL_TEXTURE_2D, 0);
+        unbindEditedTexture();
         
         // Store and return handle
         uint32_t handle = m_nextTextureHandle++;
@@ -480,12 +761,80 @@ public:
         return handle;
     }
 
+    uint32_t createCompressedTexture(CompressedFormat format, const CompressedMip* mips, uint32_t mipCount) override {
+        if (!m_hasS3TC || !mips || mipCount == 0) return 0;
+        
+        GLenum glFormat = GL_COMPRESSED_RGBA_S3TC_DXT1_EXT;
+        if (format == CompressedFormat::BC2) glFormat = GL_COMPRESSED_RGBA_S3TC_DXT3_EXT;
+        else if (format == CompressedFormat::BC3) glFormat = GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+        
+        while (glGetError() != GL_NO_ERROR) {}  // Only report errors from this upload
+        
+        GLTexture texture;
+        texture.width = mips[0].width;
+        texture.height = mips[0].height;
+        
+        glGenTextures(1, &texture.id);
+        glBindTexture(GL_TEXTURE_2D, texture.id);
+        
+        // Mips come from the file; compressed data can't be glGenerateMipmap'd
+        for (uint32_t level = 0; level < mipCount; level++) {
+            glCompressedTexImage2D(GL_TEXTURE_2D, (GLint)level, glFormat,
+                                   mips[level].width, mips[level].height, 0,
+                                   (GLsizei)mips[level].size, mips[level].data);
+        }
+        
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, 0);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, (GLint)mipCount - 1);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER,
+                        mipCount > 1 ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        
+        unbindEditedTexture();
+        
+        if (glGetError() != GL_NO_ERROR) {
+            glDeleteTextures(1, &texture.id);
+            return 0;
+        }
+        
+        uint32_t handle = m_nextTextureHandle++;
+        m_textures[handle] = texture;
+        return handle;
+    }
+
     void destroyTexture(uint32_t textureHandle) override {
         auto it = m_textures.find(textureHandle);
-        if (it != m_textures.end()) {
-            glDeleteTextures(1, &it->second.id);
-            m_textures.erase(it);
+        if (it == m_textures.end()) return;
+        if (it->second.arrayHandle) {
+            m_textures.erase(it);   // A layer; the array owns the storage
+            return;
         }
+        for (uint32_t layer : it->second.layerHandles) m_textures.erase(layer);
+        glDeleteTextures(1, &it->second.id);
+        m_textures.erase(it);
+        m_stateCache.invalidate(STATE_TEXTURE);  // Deleting a bound texture unbinds it
+    }
+
+    bool updateTexture(uint32_t textureHandle, const uint8_t* data, int width, int height, int channels) override {
+        auto it = m_textures.find(textureHandle);
+        if (it == m_textures.end() || !data || it->second.target != GL_TEXTURE_2D) return false;
+        
+        GLenum format = GL_RGB;
+        if (channels == 1) format = GL_RED;
+        else if (channels == 3) format = GL_RGB;
+        else if (channels == 4) format = GL_RGBA;
+        
+        // Respecify the same texture object so existing handles keep working
+        glBindTexture(GL_TEXTURE_2D, it->second.id);
+        glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, data);
+        glGenerateMipmap(GL_TEXTURE_2D);
+        unbindEditedTexture();
+        
+        it->second.width = width;
+        it->second.height = height;
+        return true;
     }
     
     void bindTextureToUnit(uint32_t textureHandle, int unit) override {
@@ -494,119 +843,478 @@ public:
             std::fprintf(stderr, "bindTextureToUnit: Invalid texture handle %u\n", textureHandle);
             return;
         }
+        if (unit < 0 || unit >= (int)RenderStateCache::MAX_UNITS) {
+            std::fprintf(stderr, "bindTextureToUnit: Unit %d out of range\n", unit);
+            return;
+        }
         
-        glActiveTexture(GL_TEXTURE0 + unit);
-        glBindTexture(GL_TEXTURE_2D, it->second.id);
+        bindTexture((GLuint)unit, it->second.id, it->second.target);
     }
-
-    void setUniformInt(uint32_t shaderHandle, const char* name, int value) override {
-        auto it = m_shaders.find(shaderHandle);
-        if (it != m_shaders.end()) {
-            GLShader& shader = it->second;
-            auto locIt = shader.uniformLocations.find(name);
-            GLint loc;
-            if (locIt == shader.uniformLocations.end()) {
-                loc = glGetUniformLocation(shader.program, name);
-                shader.uniformLocations[name] = loc;
-            } else {
-                loc = locIt->second;
-            }
-            if (loc >= 0) {
-                glUniform1i(loc, value);
-            }
+    
+    // One glTexImage3D for the storage and one glGenerateMipmap for every
+    // layer's chain
+    uint32_t createTextureArray(const uint8_t* const* layers, uint32_t layerCount,
+                                int width, int height, uint32_t* layerHandles) override {
+        if (!layers || !layerHandles || layerCount == 0 || width <= 0 || height <= 0) return 0;
+        if (layerCount > (uint32_t)m_maxArrayLayers) {
+            std::fprintf(stderr, "createTextureArray: %u layers, at most %d supported\n",
+                         layerCount, m_maxArrayLayers);
+            return 0;
+        }
+        
+        while (glGetError() != GL_NO_ERROR) {}  // Only report errors from this upload
+        
+        GLTexture texture;
+        texture.width = width;
+        texture.height = height;
+        texture.target = GL_TEXTURE_2D_ARRAY;
+        
+        glGenTextures(1, &texture.id);
+        glBindTexture(GL_TEXTURE_2D_ARRAY, texture.id);
+        glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_RGBA8, width, height, (GLsizei)layerCount, 0,
+                     GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+        for (uint32_t layer = 0; layer < layerCount; layer++) {
+            glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, 0, 0, (GLint)layer, width, height, 1,
+                            GL_RGBA, GL_UNSIGNED_BYTE, layers[layer]);
         }
+        
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_REPEAT);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_REPEAT);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glGenerateMipmap(GL_TEXTURE_2D_ARRAY);
+        
+        unbindEditedTexture(GL_TEXTURE_2D_ARRAY);
+        
+        if (glGetError() != GL_NO_ERROR) {
+            std::fprintf(stderr, "createTextureArray: upload of %u %dx%d layers failed\n",
+                         layerCount, width, height);
+            glDeleteTextures(1, &texture.id);
+            return 0;
+        }
+        
+        uint32_t handle = m_nextTextureHandle++;
+        for (uint32_t layer = 0; layer < layerCount; layer++) {
+            GLTexture view;
+            view.id = texture.id;
+            view.width = width;
+            view.height = height;
+            view.target = GL_TEXTURE_2D_ARRAY;
+            view.layer = layer;
+            view.arrayHandle = handle;
+            layerHandles[layer] = m_nextTextureHandle++;
+            texture.layerHandles.push_back(layerHandles[layer]);
+            m_textures[layerHandles[layer]] = view;
+        }
+        m_textures[handle] = std::move(texture);
+        return handle;
     }
 
     void drawMesh(uint32_t meshHandle, uint32_t textureHandle = 0) override {
-        // Bind texture if present
-        if (textureHandle > 0) {
-            auto texIt = m_textures.find(textureHandle);
-            if (texIt != m_textures.end()) {
-                glActiveTexture(GL_TEXTURE0);
-                glBindTexture(GL_TEXTURE_2D, texIt->second.id);
-            }
-        } else {
-            // Unbind texture
-            glActiveTexture(GL_TEXTURE0);
-            glBindTexture(GL_TEXTURE_2D, 0);
-        }
+        // Bind texture if present, else unbind unit 0
+        const GLTexture* texture = findTexture(textureHandle);
+        bindDrawTexture(texture);
         
         // Draw mesh
         auto it = m_meshes.find(meshHandle);
         if (it != m_meshes.end()) {
-            glBindVertexArray(it->second.vao);
-            glDrawElements(GL_TRIANGLES, it->second.indexCount, GL_UNSIGNED_SHORT, (void*)0);
-            glBindVertexArray(0);
+            const GLMesh& mesh = it->second;
+            uploadDrawConstants(textureHandle, texture, false, mesh.packed);
+            bindVertexArray(mesh.vao);
+            glDrawElementsBaseVertex(GL_TRIANGLES, mesh.indexCount, mesh.indexType,
+                                     mesh.indexOffset(), (GLint)mesh.range.baseVertex);
+            m_stateCache.countDraw(mesh.indexCount);
         }
     }
     
-    // Instanced drawing
+    // Instanced drawing: one glDrawElementsInstancedBaseVertex per batch.
+    // uMVP must hold the view-projection matrix when this is called.
     void drawMeshInstanced(uint32_t meshHandle, uint32_t textureHandle,
                           const InstanceData* instances, uint32_t instanceCount) override {
         if (instanceCount == 0 || !instances) return;
-        if (!m_hasViewProj) return;  // Need view-projection set first
         
-        static int debugCount = 0;
-        if (debugCount < 3) {
-            printf("GL drawMeshInstanced: mesh=%u, tex=%u, count=%u\n", 
-                   meshHandle, textureHandle, instanceCount);
-            printf("  ViewProj[0]=%f, Instance.world[0]=%f\n", 
-                   m_viewProj.m[0], instances[0].worldMatrix.m[0]);
-            debugCount++;
+        auto meshIt = m_meshes.find(meshHandle);
+        if (meshIt == m_meshes.end()) return;
+        
+        uploadInstances(instances, instanceCount);
+        const GLTexture* texture = findTexture(textureHandle);
+        uploadDrawConstants(textureHandle, texture, true, meshIt->second.packed);
+        bindDrawTexture(texture);
+        
+        const GLMesh& mesh = meshIt->second;
+        bindVertexArray(mesh.vao);
+        glDrawElementsInstancedBaseVertex(GL_TRIANGLES, mesh.indexCount, mesh.indexType, mesh.indexOffset(),
+                                          (GLsizei)instanceCount, (GLint)mesh.range.baseVertex);
+        m_stateCache.countDraw(mesh.indexCount, instanceCount);
+    }
+    
+    // One GL context, so the batch is recorded on the calling thread
+    void drawInstancedBatch(const InstancedDraw* draws, uint32_t drawCount, JobSystem* jobs) override {
+        (void)jobs;
+        for (uint32_t i = 0; i < drawCount; i++) {
+            drawMeshInstanced(draws[i].meshHandle, draws[i].textureHandle,
+                              draws[i].instances, draws[i].instanceCount);
         }
+    }
+    
+    bool supportsGpuCulling() const override { return m_hasGpuCulling; }
+    
+    // Cull pass into m_instanceVBO, then one glMultiDrawElementsIndirect per
+    // group of draws sharing a pool block and texture
+    void drawInstancedCulled(const InstancedDraw* draws, uint32_t drawCount, const Frustum& frustum) override {
+        if (!m_hasGpuCulling) {
+            drawInstancedBatch(draws, drawCount, nullptr);
+            return;
+        }
+        GLShader* shader = findShader(m_currentShader);
+        if (!shader) return;
         
-        // Set flag to prevent viewProj from being overwritten in setUniformMat4 calls
-        m_inInstancedDraw = true;
+        m_cullBatch.build(draws, drawCount, [this](uint32_t meshHandle, GpuCullBatch::MeshInfo& info) {
+            auto it = m_meshes.find(meshHandle);
+            if (it == m_meshes.end()) return false;
+            const GLMesh& mesh = it->second;
+            info.indexCount = mesh.indexCount;
+            info.firstIndex = mesh.range.firstIndex;
+            info.baseVertex = (int32_t)mesh.range.baseVertex;
+            info.bounds = mesh.bounds;
+            info.groupKey = mesh.range.block;
+            return true;
+        });
+        uint32_t instanceCount = m_cullBatch.instanceCount();
+        if (instanceCount == 0) return;
         
-        // Fallback implementation: draw one at a time
-        // Using stored view-projection from setUniformMat4
+        specifyCullBuffer(CULL_INSTANCES, m_cullBatch.getInstances());
+        specifyCullBuffer(CULL_DRAW_IDS, m_cullBatch.getDrawIds());
+        specifyCullBuffer(CULL_BOUNDS, m_cullBatch.getBounds());
+        specifyCullBuffer(CULL_ARGS, m_cullBatch.getArgs());
         
-        for (uint32_t i = 0; i < instanceCount; i++) {
-            // Compute MVP = ViewProj * WorldMatrix
-            Mat4 world = instances[i].worldMatrix;
-            Mat4 mvp = matrixMultiply(m_viewProj, world);
-            
-            setUniformMat4(m_currentShader, "uMVP", mvp);
-            setUniformMat4(m_currentShader, "uWorld", world);
-            setUniformInt(m_currentShader, "uUseTexture", textureHandle ? 1 : 0);
-            
-            drawMesh(meshHandle, textureHandle);
+        // Fresh instance storage for the compacted output
+        glBindBuffer(GL_ARRAY_BUFFER, m_instanceVBO);
+        while (m_instanceCapacity < instanceCount) m_instanceCapacity *= 2;
+        glBufferData(GL_ARRAY_BUFFER, m_instanceCapacity * sizeof(InstanceData), nullptr, GL_STREAM_DRAW);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+        
+        for (GLuint b = 0; b < CULL_BUFFER_COUNT; b++) {
+            glBindBufferBase(GL_SHADER_STORAGE_BUFFER, b, m_cullBuffers[b]);
         }
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, CULL_BUFFER_COUNT, m_instanceVBO);
+        
+        glUseProgram(m_cullProgram);
+        glUniform4fv(m_cullPlanesLoc, 6, &frustum.planes[0].x);
+        glUniform1ui(m_cullInstanceCountLoc, instanceCount);
+        glDispatchCompute((instanceCount + CULL_GROUP_SIZE - 1) / CULL_GROUP_SIZE, 1, 1);
+        // Indirect arguments and instance attributes are read after the writes land
+        glMemoryBarrier(GL_COMMAND_BARRIER_BIT | GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT);
         
-        m_inInstancedDraw = false;
+        glUseProgram(shader->program);
+        m_stateCache.invalidate(STATE_SHADER);
+        m_stateCache.set(STATE_SHADER, shader->program);
+        
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, m_cullBuffers[CULL_ARGS]);
+        for (const GpuCullBatch::Group& group : m_cullBatch.getGroups()) {
+            const GLMesh& mesh = m_meshes.find(group.meshHandle)->second;
+            const GLTexture* texture = findTexture(group.textureHandle);
+            uploadDrawConstants(group.textureHandle, texture, true, mesh.packed);
+            bindDrawTexture(texture);
+            bindVertexArray(mesh.vao);
+            glMultiDrawElementsIndirect(GL_TRIANGLES, mesh.indexType,
+                                        (const void*)(group.firstDraw * sizeof(IndirectDrawArgs)),
+                                        (GLsizei)group.drawCount, 0);
+            m_stateCache.countIndirectDraw(group.instances, group.triangles);
+        }
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
     }
     
+    void invalidateStateCache() override {
+        m_stateCache.invalidate();
+        m_activeTextureUnit = NO_TEXTURE_UNIT;
+    }
+    
+    const RenderStateStats& getStateStats() const override { return m_stateCache.getStats(); }
+    
+    void beginGpuZone(const char* name) override { writeTimestamp(m_gpuTimer.beginZone(name)); }
+    void endGpuZone() override { writeTimestamp(m_gpuTimer.endZone()); }
+    const GpuFrameTiming& getGpuTiming() const override { return m_gpuTimer.getLatest(); }
+    
 private:
-    // Matrix multiplication helper
-    Mat4 matrixMultiply(const Mat4& a, const Mat4& b) {
-        Mat4 result{};
-        for (int row = 0; row < 4; row++) {
-            for (int col = 0; col < 4; col++) {
-                result.m[col * 4 + row] = 0;
-                for (int k = 0; k < 4; k++) {
-                    result.m[col * 4 + row] += a.m[k * 4 + row] * b.m[col * 4 + k];
-                }
-            }
+    // ---- GPU timestamps ----
+    void writeTimestamp(uint32_t query) {
+        if (m_hasTimestampQueries && query != GpuTimerRing::NO_QUERY) {
+            glQueryCounter(m_timestampQueries[query], GL_TIMESTAMP);
         }
-        return result;
     }
 
-    void setDepthTest(bool enable) override {
-        if (enable) {
-            glEnable(GL_DEPTH_TEST);
+    // Queries complete in order, so a frame is ready once its end stamp is
+    void resolveTimestamps() {
+        if (!m_hasTimestampQueries) return;
+        int slot;
+        while ((slot = m_gpuTimer.oldestPending()) >= 0) {
+            GLint available = 0;
+            glGetQueryObjectiv(m_timestampQueries[GpuTimerRing::query((uint32_t)slot, 1)],
+                               GL_QUERY_RESULT_AVAILABLE, &available);
+            if (!available) break;
+            m_gpuTimer.resolve((uint32_t)slot, [this](uint32_t query) {
+                GLuint64 ns = 0;
+                glGetQueryObjectui64v(m_timestampQueries[query], GL_QUERY_RESULT, &ns);
+                return (uint64_t)ns;
+            }, 1e9);
+        }
+    }
+
+    // ---- Cached binds ----
+    void bindTexture(GLuint unit, GLuint id, GLenum target = GL_TEXTURE_2D) {
+        if (!m_stateCache.set(STATE_TEXTURE, id, unit)) return;
+        if (m_activeTextureUnit != unit) {
+            glActiveTexture(GL_TEXTURE0 + unit);
+            m_activeTextureUnit = unit;
+        }
+        glBindTexture(target, id);
+    }
+
+    // A draw's texture: 2D on unit 0 (unbound when missing), array layers on
+    // ARRAY_TEXTURE_UNIT. The other unit keeps its binding, since useTexture
+    // tells the shader which one to sample, so consecutive draws of layers
+    // of one array bind nothing.
+    void bindDrawTexture(const GLTexture* texture) {
+        if (texture && texture->target == GL_TEXTURE_2D_ARRAY) {
+            bindTexture(ARRAY_TEXTURE_UNIT, texture->id, GL_TEXTURE_2D_ARRAY);
         } else {
-            glDisable(GL_DEPTH_TEST);
+            bindTexture(0, texture ? texture->id : 0);
+        }
+    }
+
+    void bindVertexArray(GLuint vao) {
+        if (m_stateCache.set(STATE_VERTEX_INPUT, vao)) glBindVertexArray(vao);
+    }
+
+    void setCapability(GLenum cap, bool enable, uint32_t unit) {
+        if (!m_stateCache.set(STATE_RASTER, enable ? 1 : 0, unit)) return;
+        if (enable) glEnable(cap);
+        else glDisable(cap);
+    }
+
+    // Texture uploads bind on whichever unit is active; finish unbound and
+    // forget the cached texture bindings
+    void unbindEditedTexture(GLenum target = GL_TEXTURE_2D) {
+        glBindTexture(target, 0);
+        m_stateCache.invalidate(STATE_TEXTURE);
+    }
+
+    const GLTexture* findTexture(uint32_t textureHandle) const {
+        if (textureHandle == 0) return nullptr;
+        auto it = m_textures.find(textureHandle);
+        return it != m_textures.end() ? &it->second : nullptr;
+    }
+
+    GLShader* findShader(uint32_t shaderHandle) {
+        auto it = m_shaders.find(shaderHandle);
+        return it != m_shaders.end() ? &it->second : nullptr;
+    }
+
+    // The current shader's constants plus this draw's flags, in one write
+    void uploadDrawConstants(uint32_t textureHandle, const GLTexture* texture, bool instanced, bool packed) {
+        GLShader* shader = findShader(m_currentShader);
+        if (!shader || !shader->hasDrawConstants) return;
+
+        DrawConstants constants = shader->drawConstants;
+        bool layered = texture && texture->target == GL_TEXTURE_2D_ARRAY;
+        constants.useTexture = layered ? 2.0f : (textureHandle ? 1.0f : 0.0f);
+        constants.textureLayer = layered ? (float)texture->layer : 0.0f;
+        constants.instanced = instanced ? 1.0f : 0.0f;
+        constants.packedVertex = packed ? 1.0f : 0.0f;
+        bool changed = !m_hasUploadedConstants ||
+            std::memcmp(&constants, &m_uploadedConstants, sizeof(DrawConstants)) != 0;
+        m_stateCache.count(STATE_CONSTANTS, changed);
+        if (!changed) return;
+
+        glBindBuffer(GL_UNIFORM_BUFFER, m_drawConstantsUBO);
+        glBufferData(GL_UNIFORM_BUFFER, sizeof(DrawConstants), &constants, GL_STREAM_DRAW);
+        glBindBuffer(GL_UNIFORM_BUFFER, 0);
+        m_uploadedConstants = constants;
+        m_hasUploadedConstants = true;
+    }
+
+    // 32-bit input indices are narrowed when the mesh fits in 16 bits
+    uint32_t createMesh32(const void* vertexData, size_t vertexBytes, bool packed,
+                          uint32_t vertexCount, const uint32_t* indices, uint32_t indexCount) {
+        if (indicesFit16(vertexCount)) {
+            std::vector<uint16_t> narrowed(indexCount);
+            narrowIndices(indices, indexCount, narrowed.data());
+            return createMeshBuffers(vertexData, vertexBytes, packed,
+                                     narrowed.data(), indexCount, GL_UNSIGNED_SHORT);
         }
+        return createMeshBuffers(vertexData, vertexBytes, packed,
+                                 indices, indexCount, GL_UNSIGNED_INT);
+    }
+
+    // Copies into a range of a pool block, creating the block first if the
+    // pool had no room in one of this format
+    uint32_t createMeshBuffers(const void* vertexData, size_t vertexBytes, bool packed,
+                               const void* indices, uint32_t indexCount, GLenum indexType) {
+        size_t stride = packed ? sizeof(PackedVertex) : sizeof(Vertex);
+        size_t indexSize = (indexType == GL_UNSIGNED_INT) ? sizeof(uint32_t) : sizeof(uint16_t);
+        uint32_t vertexCount = (uint32_t)(vertexBytes / stride);
+        if (vertexCount == 0 || indexCount == 0) return 0;
+
+        bool newBlock = false;
+        GLMesh mesh;
+        mesh.range = m_geometryPool.allocate((uint32_t)stride, (uint32_t)indexSize,
+                                             vertexCount, indexCount, newBlock);
+        if (newBlock) createGeometryBlock(mesh.range.block, packed);
+        const GLGeometryBlock& block = m_geometryBlocks[mesh.range.block];
+        mesh.vao = block.vao;
+        mesh.indexCount = indexCount;
+        mesh.indexType = indexType;
+        mesh.packed = packed;
+        mesh.bounds = computeMeshBounds(vertexData, vertexCount, stride);
+
+        // The element buffer binding is VAO state, so go through the block's VAO
+        glBindVertexArray(block.vao);
+        glBindBuffer(GL_ARRAY_BUFFER, block.vbo);
+        glBufferSubData(GL_ARRAY_BUFFER, (GLintptr)(mesh.range.baseVertex * stride), vertexBytes, vertexData);
+        glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, (GLintptr)(mesh.range.firstIndex * indexSize),
+                        indexCount * indexSize, indices);
+        glBindVertexArray(0);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+        m_stateCache.invalidate(STATE_VERTEX_INPUT);
+
+        uint32_t handle = m_nextMeshHandle++;
+        m_meshes[handle] = mesh;
+        return handle;
+    }
+
+    // Storage for a new pool block and its VAO: mesh attributes at locations
+    // 0-5 from the block VBO, the shared instance stream at 6-10
+    void createGeometryBlock(uint32_t index, bool packed) {
+        const GeometryPool::Block& poolBlock = m_geometryPool.block(index);
+        GLGeometryBlock block;
+        glGenVertexArrays(1, &block.vao);
+        glGenBuffers(1, &block.vbo);
+        glGenBuffers(1, &block.ebo);
+
+        glBindVertexArray(block.vao);
+
+        glBindBuffer(GL_ARRAY_BUFFER, block.vbo);
+        glBufferData(GL_ARRAY_BUFFER, (GLsizeiptr)poolBlock.vertices.capacity() * poolBlock.vertexStride,
+                     nullptr, GL_STATIC_DRAW);
+
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, block.ebo);
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, (GLsizeiptr)poolBlock.indices.capacity() * poolBlock.indexSize,
+                     nullptr, GL_STATIC_DRAW);
+
+        if (packed) {
+            const GLsizei stride = sizeof(PackedVertex);
+            glEnableVertexAttribArray(0);
+            glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, stride, (void*)offsetof(PackedVertex, px));
+
+            // Octahedral normal (xy only; z reads as 0)
+            glEnableVertexAttribArray(1);
+            glVertexAttribPointer(1, 2, GL_SHORT, GL_TRUE, stride, (void*)offsetof(PackedVertex, normal));
+
+            glEnableVertexAttribArray(2);
+            glVertexAttribPointer(2, 4, GL_UNSIGNED_BYTE, GL_TRUE, stride, (void*)offsetof(PackedVertex, r));
+
+            glEnableVertexAttribArray(3);
+            glVertexAttribPointer(3, 2, GL_HALF_FLOAT, GL_FALSE, stride, (void*)offsetof(PackedVertex, u));
+
+            // Octahedral tangent + bitangent sign
+            glEnableVertexAttribArray(4);
+            glVertexAttribPointer(4, 3, GL_SHORT, GL_TRUE, stride, (void*)offsetof(PackedVertex, tangent));
+
+            // Bitangent is reconstructed in the shader
+            glDisableVertexAttribArray(5);
+        } else {
+            // Position (attribute 0)
+            glEnableVertexAttribArray(0);
+            glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)0);
+
+            // Normal (attribute 1)
+            glEnableVertexAttribArray(1);
+            glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)(3 * sizeof(float)));
+
+            // Color (attribute 2)
+            glEnableVertexAttribArray(2);
+            glVertexAttribPointer(2, 4, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)(6 * sizeof(float)));
+
+            // TexCoord (attribute 3)
+            glEnableVertexAttribArray(3);
+            glVertexAttribPointer(3, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)(10 * sizeof(float)));
+
+            // Tangent (attribute 4) - for normal mapping
+            glEnableVertexAttribArray(4);
+            glVertexAttribPointer(4, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)(12 * sizeof(float)));
+
+            // Bitangent (attribute 5) - for normal mapping
+            glEnableVertexAttribArray(5);
+            glVertexAttribPointer(5, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)(15 * sizeof(float)));
+        }
+
+        // Per-instance world matrix (attributes 6-9, one vec4 column each) and tint (10)
+        glBindBuffer(GL_ARRAY_BUFFER, m_instanceVBO);
+        for (GLuint col = 0; col < 4; col++) {
+            glEnableVertexAttribArray(6 + col);
+            glVertexAttribPointer(6 + col, 4, GL_FLOAT, GL_FALSE, sizeof(InstanceData),
+                                  (void*)(offsetof(InstanceData, worldMatrix) + col * 4 * sizeof(float)));
+            glVertexAttribDivisor(6 + col, 1);
+        }
+        glEnableVertexAttribArray(10);
+        glVertexAttribPointer(10, 4, GL_FLOAT, GL_FALSE, sizeof(InstanceData),
+                              (void*)offsetof(InstanceData, colorTint));
+        glVertexAttribDivisor(10, 1);
+
+        glBindVertexArray(0);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+        m_stateCache.invalidate(STATE_VERTEX_INPUT);
+
+        if (index >= m_geometryBlocks.size()) m_geometryBlocks.resize(index + 1);
+        m_geometryBlocks[index] = block;
+    }
+
+    // Compute program and buffers for drawInstancedCulled(); false without GL 4.3
+    bool createCullProgram() {
+        if (!GLAD_GL_VERSION_4_3) return false;
+        GLuint cs = compileShader(GL_COMPUTE_SHADER, OPENGL_CULL_SHADER);
+        if (!cs) return false;
+        m_cullProgram = linkProgram(cs);
+        glDeleteShader(cs);
+        if (!m_cullProgram) return false;
+
+        m_cullPlanesLoc = glGetUniformLocation(m_cullProgram, "uPlanes");
+        m_cullInstanceCountLoc = glGetUniformLocation(m_cullProgram, "uInstanceCount");
+        glGenBuffers(CULL_BUFFER_COUNT, m_cullBuffers);
+        return true;
+    }
+
+    // Orphans the buffer's storage and fills a fresh one
+    template <typename T>
+    void specifyCullBuffer(CullBuffer buffer, const std::vector<T>& data) {
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_cullBuffers[buffer]);
+        glBufferData(GL_SHADER_STORAGE_BUFFER, data.size() * sizeof(T), data.data(), GL_STREAM_DRAW);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+    }
+
+    static const uint32_t INITIAL_INSTANCE_CAPACITY = 1024;
+    
+    // Stream instance data into the shared instance VBO, growing it if needed
+    void uploadInstances(const InstanceData* instances, uint32_t instanceCount) {
+        glBindBuffer(GL_ARRAY_BUFFER, m_instanceVBO);
+        while (m_instanceCapacity < instanceCount) m_instanceCapacity *= 2;
+        // Orphan the previous storage, then fill the fresh allocation
+        glBufferData(GL_ARRAY_BUFFER, m_instanceCapacity * sizeof(InstanceData), nullptr, GL_STREAM_DRAW);
+        glBufferSubData(GL_ARRAY_BUFFER, 0, instanceCount * sizeof(InstanceData), instances);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+    }
+
+    void setDepthTest(bool enable) override {
+        setCapability(GL_DEPTH_TEST, enable, 0);
     }
 
     void setCulling(bool enable) override {
         if (enable) {
-            glEnable(GL_CULL_FACE);
             glCullFace(GL_BACK);
             glFrontFace(GL_CCW);
-        } else {
-            glDisable(GL_CULL_FACE);
         }
+        setCapability(GL_CULL_FACE, enable, 1);
     }
 };
 
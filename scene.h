@@ -15,9 +15,16 @@ struct SceneObject {
     Vec4 colorTint;          // Color tint (r, g, b, intensity)
     bool visible;            // Is object visible?
     
-    SceneObject();  // Constructor defined in app.cpp where mat4_identity is available
+    SceneObject();
 };
 
+inline SceneObject::SceneObject()
+    : model(nullptr)
+    , transform(mat4_identity())
+    , colorTint({1.0f, 1.0f, 1.0f, 1.0f})
+    , visible(true)
+{}
+
 // ==================== Render Batch ====================
 // Groups instances that share mesh + texture for efficient rendering
 struct RenderBatch {
@@ -62,7 +69,7 @@ private:
     
     struct BatchKeyHash {
         size_t operator()(const BatchKey& key) const {
-            return ((size_t)key.meshHandle << 32) | key.textureHandle;
+            return (size_t)(((uint64_t)key.meshHandle << 32) | key.textureHandle);
         }
     };
     
@@ -107,6 +114,7 @@ public:
     // Clear all objects
     void clear() {
         m_objects.clear();
+        m_batches.clear();
     }
     
     // Get object count
@@ -114,57 +122,65 @@ public:
         return m_objects.size();
     }
     
-    // Render scene with automatic batching
+    // Render scene with automatic batching: objects are grouped by
+    // mesh + texture and each group is submitted as one instanced draw.
+    // With a frustum, objects whose bounding sphere is outside it are skipped.
     void render(IRenderer* renderer, 
                 const std::unordered_map<const Model*, std::vector<uint32_t>>& modelMeshHandles,
-                const std::unordered_map<const Model*, std::vector<uint32_t>>& modelTextureHandles) {
+                const std::unordered_map<const Model*, std::vector<uint32_t>>& modelTextureHandles,
+                const Frustum* frustum = nullptr) {
         
         m_lastDrawCalls = 0;
         m_lastInstancesDrawn = 0;
         m_lastBatchCount = 0;
         
-        // For fallback rendering: draw each object completely
-        // (True instancing would batch differently, but fallback draws full models)
-        
-        static bool once = true;
-        if (once) {
-            printf("Scene::render - %zu objects to render\n", m_objects.size());
-            once = false;
+        // Keep batch storage between frames, only drop the instances
+        for (auto& pair : m_batches) {
+            pair.second.clear();
         }
         
         for (const auto& obj : m_objects) {
             if (!obj.visible || !obj.model) continue;
             
             const Model* model = obj.model;
+            if (frustum) {
+                Vec3 center;
+                float radius;
+                mat4_transformSphere(obj.transform, model->boundsCenter, model->boundsRadius, center, radius);
+                if (frustum->testSphere(center, radius) == FrustumTest::Outside) continue;
+            }
+            
             auto meshIt = modelMeshHandles.find(model);
             auto texIt = modelTextureHandles.find(model);
             
             if (meshIt == modelMeshHandles.end()) continue;
             
             const auto& meshes = meshIt->second;
-            const auto& textures = (texIt != modelTextureHandles.end()) 
-                                  ? texIt->second 
-                                  : std::vector<uint32_t>();
-            
-            // Create a single-instance array for this object
-            InstanceData instance;
-            instance.worldMatrix = obj.transform;
-            instance.colorTint = obj.colorTint;
+            const std::vector<uint32_t>* textures = (texIt != modelTextureHandles.end())
+                                                    ? &texIt->second : nullptr;
             
-            // Draw all meshes of this model with this instance transform
             for (size_t i = 0; i < meshes.size(); i++) {
-                uint32_t texHandle = (i < textures.size()) ? textures[i] : 0;
+                uint32_t texHandle = (textures && i < textures->size()) ? (*textures)[i] : 0;
                 
-                // Use instanced drawing with count=1 (fallback will draw once)
-                renderer->drawMeshInstanced(meshes[i], texHandle, &instance, 1);
-                
-                m_lastDrawCalls++;
+                RenderBatch& batch = m_batches[BatchKey{meshes[i], texHandle}];
+                batch.meshHandle = meshes[i];
+                batch.textureHandle = texHandle;
+                batch.addInstance(obj.transform, obj.colorTint);
             }
             
             m_lastInstancesDrawn++;
         }
         
-        m_lastBatchCount = m_lastDrawCalls;  // In fallback mode, one batch per draw call
+        for (const auto& pair : m_batches) {
+            const RenderBatch& batch = pair.second;
+            if (batch.instances.empty()) continue;
+            
+            renderer->drawMeshInstanced(batch.meshHandle, batch.textureHandle,
+                                        batch.instances.data(), (uint32_t)batch.instances.size());
+            m_lastDrawCalls++;
+        }
+        
+        m_lastBatchCount = m_lastDrawCalls;  // One instanced draw per batch
     }
     
    
@@ -197,7 +213,4 @@ public:
     }
 };
 
-// Note: mat4_identity() is defined in app.cpp
-// Declare it here if needed, or include the math utilities header
-
 #endif // SCENE_H
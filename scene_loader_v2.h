@@ -22,6 +22,14 @@ struct SceneConfigV2 {
     // Model registrations (key -> filepath)
     std::map<std::string, std::string> models;
     
+    // LOD chains (model key -> lower-detail levels). LODs given by path are
+    // also registered in 'models' under "<key>#lod<N>".
+    struct ModelLodConfig {
+        std::string modelKey;
+        float screenSize;    // Switch once the model covers less than this fraction of the viewport height
+    };
+    std::map<std::string, std::vector<ModelLodConfig>> modelLods;
+    
     // Camera settings (legacy single camera)
     std::string cameraType;  // "fps", "orbit", "chase"
     Vec3 cameraPosition;
@@ -37,6 +45,7 @@ struct SceneConfigV2 {
         Vec3 target;
         float fov;
         json behaviorParams;
+        json source;  // Object it was parsed from, compared on reload
     };
     std::vector<CameraConfig> cameras;
     
@@ -48,6 +57,7 @@ struct SceneConfigV2 {
         Vec3 rotation;
         Vec3 scale;
         bool visible;
+        std::string parent;  // Entity this one rides on; its transform is then relative to it
         bool controllable;  // Can user control this entity?
         std::string controllerType;  // "aircraft", "car", etc.
         
@@ -56,6 +66,7 @@ struct SceneConfigV2 {
         
         // Behavior parameters (optional)
         json behaviorParams;
+        json source;  // Object it was parsed from, compared on reload
     };
     std::vector<EntityConfig> entities;
     
@@ -79,6 +90,19 @@ struct SceneConfigV2 {
         float runwayLength;
         float runwayColor[4];
         std::string runwayTexturePath;
+        
+        // Streamed quadtree terrain (terrain.h); "size" is its half extent
+        struct TerrainConfig {
+            float tileSize = 2048.0f;        // Root quadtree node edge (metres)
+            uint32_t maxLevel = 5;           // Splits below a root tile
+            float lodDistance = 2.0f;        // Split nodes nearer than this many node sizes
+            float viewDistance = 20000.0f;   // Tiles further away are neither loaded nor drawn
+            float heightScale = 0.0f;        // Metres at full height; 0 = flat
+            uint32_t seed = 1;               // Procedural heights, when there are no heightmap tiles
+            std::string heightmapTiles;      // 16-bit grey image per root tile, "{x}"/"{z}" = tile index
+            std::string textureTiles;        // Colour image per root tile; empty = repeat texturePath
+        } terrain;
+        json source;  // Object it was parsed from, compared on reload
     } ground;
     
     // Background
@@ -111,11 +135,36 @@ public:
             outScene.name = j["name"].get<std::string>();
         }
         
-        // Parse model registry
+        // Parse model registry: "key": "path", or
+        // "key": { "path": "...", "lods": [ { "path" | "model": "...", "screenSize": 0.1 }, ... ] }
         if (j.contains("models") && j["models"].is_object()) {
-            for (auto& [key, path] : j["models"].items()) {
-                if (path.is_string()) {
-                    outScene.models[key] = path.get<std::string>();
+            for (auto& [key, value] : j["models"].items()) {
+                if (value.is_string()) {
+                    outScene.models[key] = value.get<std::string>();
+                    continue;
+                }
+                if (!value.is_object() || !value.contains("path") || !value["path"].is_string()) {
+                    continue;
+                }
+                outScene.models[key] = value["path"].get<std::string>();
+                
+                if (value.contains("lods") && value["lods"].is_array()) {
+                    int level = 1;
+                    for (auto& lodJson : value["lods"]) {
+                        if (!lodJson.is_object()) continue;
+                        SceneConfigV2::ModelLodConfig lod;
+                        lod.screenSize = lodJson.value("screenSize", 0.0f);
+                        if (lodJson.contains("model") && lodJson["model"].is_string()) {
+                            lod.modelKey = lodJson["model"].get<std::string>();
+                        } else if (lodJson.contains("path") && lodJson["path"].is_string()) {
+                            lod.modelKey = key + "#lod" + std::to_string(level);
+                            outScene.models[lod.modelKey] = lodJson["path"].get<std::string>();
+                        } else {
+                            continue;
+                        }
+                        outScene.modelLods[key].push_back(lod);
+                        level++;
+                    }
                 }
             }
         }
@@ -183,6 +232,7 @@ public:
                 if (camJson.contains("behaviorParams")) {
                     camConfig.behaviorParams = camJson["behaviorParams"];
                 }
+                camConfig.source = camJson;
                 
                 outScene.cameras.push_back(camConfig);
             }
@@ -231,6 +281,11 @@ public:
                     entity.visible = entityJson["visible"].get<bool>();
                 }
                 
+                // Parent (by name; may be declared later in the file)
+                if (entityJson.contains("parent") && entityJson["parent"].is_string()) {
+                    entity.parent = entityJson["parent"].get<std::string>();
+                }
+                
                 // Controllable
                 entity.controllable = false;
                 if (entityJson.contains("controllable") && entityJson["controllable"].is_boolean()) {
@@ -256,6 +311,7 @@ public:
                 if (entityJson.contains("behaviorParams") && entityJson["behaviorParams"].is_object()) {
                     entity.behaviorParams = entityJson["behaviorParams"];
                 }
+                entity.source = entityJson;
                 
                 outScene.entities.push_back(entity);
             }
@@ -294,6 +350,7 @@ public:
         // Parse ground
         if (j.contains("ground") && j["ground"].is_object()) {
             auto& gr = j["ground"];
+            outScene.ground.source = gr;
             outScene.ground.enabled = gr.value("enabled", true);
             outScene.ground.size = gr.value("size", 5000.0f);
             
@@ -327,6 +384,20 @@ public:
             if (gr.contains("runwayTexturePath") && gr["runwayTexturePath"].is_string()) {
                 outScene.ground.runwayTexturePath = gr["runwayTexturePath"].get<std::string>();
             }
+            
+            // Terrain streaming
+            if (gr.contains("terrain") && gr["terrain"].is_object()) {
+                auto& tr = gr["terrain"];
+                auto& terrain = outScene.ground.terrain;
+                terrain.tileSize = tr.value("tileSize", terrain.tileSize);
+                terrain.maxLevel = tr.value("maxLevel", terrain.maxLevel);
+                terrain.lodDistance = tr.value("lodDistance", terrain.lodDistance);
+                terrain.viewDistance = tr.value("viewDistance", terrain.viewDistance);
+                terrain.heightScale = tr.value("heightScale", terrain.heightScale);
+                terrain.seed = tr.value("seed", terrain.seed);
+                terrain.heightmapTiles = tr.value("heightmapTiles", std::string());
+                terrain.textureTiles = tr.value("textureTiles", std::string());
+            }
         }
         
         // Parse background
@@ -351,86 +422,119 @@ public:
             }
         }
         
+        // Link LOD chains
+        for (const auto& [key, lods] : scene.modelLods) {
+            std::vector<std::pair<std::string, float>> levels;
+            for (const auto& lod : lods) {
+                levels.push_back({lod.modelKey, lod.screenSize});
+            }
+            modelRegistry.setModelLods(key, levels);
+        }
+        
         // Create entities
         for (const auto& entityConfig : scene.entities) {
-            // Create entity
-            Entity* entity = entityRegistry.createEntity(entityConfig.name);
-            entity->setPosition(entityConfig.position);
-            entity->setRotation(entityConfig.rotation);
-            entity->setScale(entityConfig.scale);
-            entity->setVisible(entityConfig.visible);
-            
-            // Assign model
-            const Model* model = modelRegistry.getModel(entityConfig.modelKey);
-            if (model) {
-                entity->setModel(model);
-            } else {
-                printf("Warning: Model key '%s' not found for entity '%s'\n",
-                       entityConfig.modelKey.c_str(), entityConfig.name.c_str());
-            }
-            
-            // Attach behaviors
-            for (const std::string& behaviorName : entityConfig.behaviors) {
-                if (behaviorName == "FlightDynamics") {
-                    auto* behavior = entityRegistry.addBehavior<FlightDynamicsBehavior>(entity->getID());
-                    
-                    // Apply behavior parameters if specified
-                    if (entityConfig.behaviorParams.contains("userControlled") &&
-                        entityConfig.behaviorParams["userControlled"].is_boolean()) {
-                        behavior->setUserControlled(
-                            entityConfig.behaviorParams["userControlled"].get<bool>());
-                    }
-                    
-                } else if (behaviorName == "ChaseCamera") {
-                    auto* behavior = entityRegistry.addBehavior<ChaseCameraBehavior>(entity->getID());
-                    
-                    // Apply camera parameters
-                    if (entityConfig.behaviorParams.contains("cameraDistance") &&
-                        entityConfig.behaviorParams["cameraDistance"].is_number()) {
-                        behavior->setDistance(
-                            entityConfig.behaviorParams["cameraDistance"].get<float>());
-                    }
-                    if (entityConfig.behaviorParams.contains("cameraHeight") &&
-                        entityConfig.behaviorParams["cameraHeight"].is_number()) {
-                        behavior->setHeight(
-                            entityConfig.behaviorParams["cameraHeight"].get<float>());
-                    }
-                    
-                } else if (behaviorName == "OrbitCamera") {
-                    auto* behavior = entityRegistry.addBehavior<OrbitCameraBehavior>(entity->getID());
-                    
-                    // Apply orbit camera parameters
-                    if (entityConfig.behaviorParams.contains("orbitDistance") &&
-                        entityConfig.behaviorParams["orbitDistance"].is_number()) {
-                        behavior->setDistance(
-                            entityConfig.behaviorParams["orbitDistance"].get<float>());
-                    }
-                    if (entityConfig.behaviorParams.contains("orbitYaw") &&
-                        entityConfig.behaviorParams["orbitYaw"].is_number()) {
-                        behavior->setYaw(
-                            entityConfig.behaviorParams["orbitYaw"].get<float>());
-                    }
-                    if (entityConfig.behaviorParams.contains("orbitPitch") &&
-                        entityConfig.behaviorParams["orbitPitch"].is_number()) {
-                        behavior->setPitch(
-                            entityConfig.behaviorParams["orbitPitch"].get<float>());
-                    }
-                    if (entityConfig.behaviorParams.contains("autoRotate") &&
-                        entityConfig.behaviorParams["autoRotate"].is_boolean()) {
-                        behavior->setAutoRotate(
-                            entityConfig.behaviorParams["autoRotate"].get<bool>());
-                    }
-                    if (entityConfig.behaviorParams.contains("rotationSpeed") &&
-                        entityConfig.behaviorParams["rotationSpeed"].is_number()) {
-                        behavior->setRotationSpeed(
-                            entityConfig.behaviorParams["rotationSpeed"].get<float>());
-                    }
-                }
-            }
+            createEntity(entityConfig, modelRegistry, entityRegistry);
         }
         
+        // Attach children once every entity exists
+        attachParents(scene, entityRegistry);
+        
         return true;
     }
+    
+    // One entity with its model and behaviors; parents are left to attachParents()
+    static Entity* createEntity(const SceneConfigV2::EntityConfig& entityConfig,
+                                const ModelRegistry& modelRegistry,
+                                EntityRegistry& entityRegistry) {
+        // Create entity
+        Entity* entity = entityRegistry.createEntity(entityConfig.name);
+        entity->setPosition(entityConfig.position);
+        entity->setRotation(entityConfig.rotation);
+        entity->setScale(entityConfig.scale);
+        entity->setVisible(entityConfig.visible);
+        
+        // Assign model
+        const Model* model = modelRegistry.getModel(entityConfig.modelKey);
+        if (model) {
+            entity->setModel(model);
+        } else {
+            printf("Warning: Model key '%s' not found for entity '%s'\n",
+                   entityConfig.modelKey.c_str(), entityConfig.name.c_str());
+        }
+        
+        // Attach behaviors
+        for (const std::string& behaviorName : entityConfig.behaviors) {
+            if (behaviorName == "FlightDynamics") {
+                auto* behavior = entityRegistry.addBehavior<FlightDynamicsBehavior>(entity->getID());
+                
+                // Apply behavior parameters if specified
+                if (entityConfig.behaviorParams.contains("userControlled") &&
+                    entityConfig.behaviorParams["userControlled"].is_boolean()) {
+                    behavior->setUserControlled(
+                        entityConfig.behaviorParams["userControlled"].get<bool>());
+                }
+                
+            } else if (behaviorName == "ChaseCamera") {
+                auto* behavior = entityRegistry.addBehavior<ChaseCameraBehavior>(entity->getID());
+                
+                // Apply camera parameters
+                if (entityConfig.behaviorParams.contains("cameraDistance") &&
+                    entityConfig.behaviorParams["cameraDistance"].is_number()) {
+                    behavior->setDistance(
+                        entityConfig.behaviorParams["cameraDistance"].get<float>());
+                }
+                if (entityConfig.behaviorParams.contains("cameraHeight") &&
+                    entityConfig.behaviorParams["cameraHeight"].is_number()) {
+                    behavior->setHeight(
+                        entityConfig.behaviorParams["cameraHeight"].get<float>());
+                }
+                
+            } else if (behaviorName == "OrbitCamera") {
+                auto* behavior = entityRegistry.addBehavior<OrbitCameraBehavior>(entity->getID());
+                
+                // Apply orbit camera parameters
+                if (entityConfig.behaviorParams.contains("orbitDistance") &&
+                    entityConfig.behaviorParams["orbitDistance"].is_number()) {
+                    behavior->setDistance(
+                        entityConfig.behaviorParams["orbitDistance"].get<float>());
+                }
+                if (entityConfig.behaviorParams.contains("orbitYaw") &&
+                    entityConfig.behaviorParams["orbitYaw"].is_number()) {
+                    behavior->setYaw(
+                        entityConfig.behaviorParams["orbitYaw"].get<float>());
+                }
+                if (entityConfig.behaviorParams.contains("orbitPitch") &&
+                    entityConfig.behaviorParams["orbitPitch"].is_number()) {
+                    behavior->setPitch(
+                        entityConfig.behaviorParams["orbitPitch"].get<float>());
+                }
+                if (entityConfig.behaviorParams.contains("autoRotate") &&
+                    entityConfig.behaviorParams["autoRotate"].is_boolean()) {
+                    behavior->setAutoRotate(
+                        entityConfig.behaviorParams["autoRotate"].get<bool>());
+                }
+                if (entityConfig.behaviorParams.contains("rotationSpeed") &&
+                    entityConfig.behaviorParams["rotationSpeed"].is_number()) {
+                    behavior->setRotationSpeed(
+                        entityConfig.behaviorParams["rotationSpeed"].get<float>());
+                }
+            }
+        }
+        return entity;
+    }
+    
+    // Attach every entity with a parent to it, by name
+    static void attachParents(const SceneConfigV2& scene, EntityRegistry& entityRegistry) {
+        for (const auto& entityConfig : scene.entities) {
+            if (entityConfig.parent.empty()) continue;
+            Entity* entity = entityRegistry.findEntityByName(entityConfig.name);
+            Entity* parent = entityRegistry.findEntityByName(entityConfig.parent);
+            if (!entity || !parent || !entity->setParent(parent)) {
+                printf("Warning: Cannot attach entity '%s' to parent '%s'\n",
+                       entityConfig.name.c_str(), entityConfig.parent.c_str());
+            }
+        }
+    }
 };
 
 #endif // SCENE_LOADER_V2_H
@@ -6,9 +6,11 @@
 #include "model_registry.h"
 #include "camera_entity.h"
 #include "camera_behaviors.h"
+#include "flight_dynamics_behavior.h"
 #include "input_controller.h"
 #include <vector>
 #include <string>
+#include <algorithm>
 
 // ==================== Scene Manager ====================
 // Central manager for scene state, cameras, and controllable entities
@@ -20,6 +22,8 @@ public:
         , m_currentCameraIndex(0)
         , m_currentControllableIndex(0)
         , m_inputController(nullptr)
+        , m_playerID(0)
+        , m_playerResolved(false)
     {}
     
     ~SceneManager() {
@@ -37,6 +41,22 @@ public:
         }
     }
     
+    // Drop a camera about to be destroyed; if it was active, the next one takes over
+    void removeCamera(EntityID cameraID) {
+        auto it = std::find(m_cameraIDs.begin(), m_cameraIDs.end(), cameraID);
+        if (it == m_cameraIDs.end()) return;
+        size_t index = (size_t)(it - m_cameraIDs.begin());
+        m_cameraIDs.erase(it);
+        if (m_cameraIDs.empty()) {
+            m_currentCameraIndex = 0;
+        } else if (index < m_currentCameraIndex) {
+            m_currentCameraIndex--;
+        } else if (index == m_currentCameraIndex) {
+            m_currentCameraIndex %= m_cameraIDs.size();
+            setActiveCamera(m_currentCameraIndex);
+        }
+    }
+    
     void nextCamera() {
         if (m_cameraIDs.empty()) return;
         m_currentCameraIndex = (m_currentCameraIndex + 1) % m_cameraIDs.size();
@@ -56,12 +76,36 @@ public:
     
     // Controllable entity management
     void addControllable(EntityID entityID) {
+        invalidatePlayer();
         m_controllableIDs.push_back(entityID);
         if (m_controllableIDs.size() == 1) {
             setCurrentControllable(0);  // First controllable is current by default
         }
     }
     
+    // Drop an entity about to be destroyed; if it was current, input moves
+    // to the next controllable (or is detached when none is left)
+    void removeControllable(EntityID entityID) {
+        auto it = std::find(m_controllableIDs.begin(), m_controllableIDs.end(), entityID);
+        if (it == m_controllableIDs.end()) return;
+        invalidatePlayer();
+        size_t index = (size_t)(it - m_controllableIDs.begin());
+        m_controllableIDs.erase(it);
+        if (m_controllableIDs.empty()) {
+            m_currentControllableIndex = 0;
+            if (m_inputController) m_inputController->detach();
+        } else if (index < m_currentControllableIndex) {
+            m_currentControllableIndex--;
+        } else if (index == m_currentControllableIndex) {
+            m_currentControllableIndex %= m_controllableIDs.size();
+            setCurrentControllable(m_currentControllableIndex);
+        }
+    }
+    
+    bool isControllable(EntityID entityID) const {
+        return std::find(m_controllableIDs.begin(), m_controllableIDs.end(), entityID) != m_controllableIDs.end();
+    }
+    
     void nextControllable() {
         if (m_controllableIDs.empty()) return;
         m_currentControllableIndex = (m_currentControllableIndex + 1) % m_controllableIDs.size();
@@ -86,8 +130,37 @@ public:
         return m_controllableIDs[m_currentControllableIndex];
     }
     
+    // Player entity: the first entity with a user-controlled
+    // FlightDynamicsBehavior. Resolved from that behavior pool on first use
+    // and cached until invalidatePlayer() (scene, controllable or input changes).
+    Entity* getPlayerEntity() {
+        if (m_playerResolved) {
+            if (m_playerID == 0) return nullptr;
+            Entity* player = m_entityRegistry.getEntity(m_playerID);
+            if (player) return player;
+            // Destroyed since it was cached
+        }
+        
+        m_playerID = 0;
+        m_playerResolved = true;
+        for (Behavior* behavior : m_entityRegistry.getBehaviorPool<FlightDynamicsBehavior>()) {
+            auto* flight = static_cast<FlightDynamicsBehavior*>(behavior);
+            if (flight->isUserControlled() && flight->getEntity()) {
+                m_playerID = flight->getEntity()->getID();
+                return flight->getEntity();
+            }
+        }
+        return nullptr;
+    }
+    
+    void invalidatePlayer() {
+        m_playerID = 0;
+        m_playerResolved = false;
+    }
+    
     // Input controller
     void setInputController(InputController* controller) {
+        invalidatePlayer();
         delete m_inputController;
         m_inputController = controller;
         
@@ -107,6 +180,7 @@ public:
     const std::string& getSceneFilePath() const { return m_sceneFilePath; }
     
     void clear() {
+        invalidatePlayer();
         m_cameraIDs.clear();
         m_controllableIDs.clear();
         m_currentCameraIndex = 0;
@@ -143,6 +217,7 @@ private:
         EntityID newTargetID = m_controllableIDs[index];
         Entity* current = m_entityRegistry.getEntity(newTargetID);
         if (!current) return;
+        invalidatePlayer();
         
         // Reattach input controller
         if (m_inputController) {
@@ -200,6 +275,9 @@ private:
     
     InputController* m_inputController;
     std::string m_sceneFilePath;
+    
+    EntityID m_playerID;      // Valid while m_playerResolved; 0 = no player
+    bool m_playerResolved;
 };
 
 #endif // SCENE_MANAGER_H
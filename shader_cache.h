@@ -0,0 +1,148 @@
+// shader_cache.h - On-disk cache of compiled shaders and driver pipeline blobs
+#ifndef SHADER_CACHE_H
+#define SHADER_CACHE_H
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <filesystem>
+#include <system_error>
+
+// ==================== Cache Key ====================
+// 64-bit FNV-1a over everything that determines a blob. Strings are hashed
+// with their terminator, so ("ab", "c") and ("a", "bc") differ.
+class ShaderCacheKey {
+public:
+    ShaderCacheKey& add(const void* data, size_t size) {
+        const uint8_t* bytes = (const uint8_t*)data;
+        for (size_t i = 0; i < size; i++) {
+            m_hash ^= bytes[i];
+            m_hash *= 0x100000001b3ull;
+        }
+        return *this;
+    }
+    ShaderCacheKey& add(const char* text) { return add(text ? text : "", std::strlen(text ? text : "") + 1); }
+    ShaderCacheKey& add(uint64_t value) { return add(&value, sizeof(value)); }
+
+    uint64_t value() const { return m_hash; }
+
+private:
+    uint64_t m_hash = 0xcbf29ce484222325ull;
+};
+
+// ==================== Shader Cache File Format ====================
+// <directory>/<key as 16 hex digits><extension>:
+//
+//   ShaderCacheHeader
+//   payload[size]
+//
+// The header repeats the key and carries a hash of the payload, so a
+// truncated, corrupt or colliding file reads as a miss.
+static const char     SHADERCACHE_MAGIC[4] = { 'C', 'S', 'H', 'C' };
+static const uint32_t SHADERCACHE_VERSION  = 1;
+
+struct ShaderCacheHeader {
+    char     magic[4];
+    uint32_t version;
+    uint64_t key;
+    uint64_t size;
+    uint64_t payloadHash;
+};
+
+static_assert(sizeof(ShaderCacheHeader) == 32, "ShaderCacheHeader is part of the file format");
+
+// ==================== Shader Cache ====================
+// Keys are built by the backends: compiled bytecode from the source, entry
+// point, target, defines, flags and compiler version; driver pipeline blobs
+// additionally from the adapter and driver version, since only the driver
+// that produced them can load them. A miss (or a disabled cache) only costs
+// a compile.
+//
+// Files are written to a temporary name and renamed into place, so another
+// instance starting at the same time never reads half a file.
+class ShaderCache {
+public:
+    // Default on, under "shader_cache" in the working directory
+    static void setEnabled(bool enabled) { settings().enabled = enabled; }
+    static bool isEnabled() { return settings().enabled; }
+    static void setDirectory(const std::string& directory) { settings().directory = directory; }
+    static const std::string& getDirectory() { return settings().directory; }
+
+    static std::string filePath(uint64_t key, const char* extension) {
+        char name[32];
+        std::snprintf(name, sizeof(name), "%016llx", (unsigned long long)key);
+        return (std::filesystem::path(getDirectory()) / (std::string(name) + extension)).string();
+    }
+
+    static bool load(uint64_t key, const char* extension, std::vector<uint8_t>& out) {
+        if (!isEnabled()) return false;
+        std::string path = filePath(key, extension);
+        FILE* file = std::fopen(path.c_str(), "rb");
+        if (!file) return false;
+
+        ShaderCacheHeader header;
+        bool ok = std::fread(&header, sizeof(header), 1, file) == 1 &&
+                  std::memcmp(header.magic, SHADERCACHE_MAGIC, sizeof(header.magic)) == 0 &&
+                  header.version == SHADERCACHE_VERSION && header.key == key &&
+                  header.size > 0 && header.size < (1ull << 31);
+        if (ok) {
+            out.resize((size_t)header.size);
+            ok = std::fread(out.data(), 1, out.size(), file) == out.size() &&
+                 ShaderCacheKey().add(out.data(), out.size()).value() == header.payloadHash;
+        }
+        std::fclose(file);
+        if (!ok) {
+            std::fprintf(stderr, "ShaderCache: ignoring invalid %s\n", path.c_str());
+            out.clear();
+        }
+        return ok;
+    }
+
+    static bool store(uint64_t key, const char* extension, const void* data, size_t size) {
+        if (!isEnabled() || !data || size == 0) return false;
+        std::error_code ec;
+        std::filesystem::create_directories(getDirectory(), ec);
+
+        std::string path = filePath(key, extension);
+        std::string temp = path + ".tmp";
+        FILE* file = std::fopen(temp.c_str(), "wb");
+        if (!file) {
+            std::fprintf(stderr, "ShaderCache: cannot write %s\n", temp.c_str());
+            return false;
+        }
+        ShaderCacheHeader header = {};
+        std::memcpy(header.magic, SHADERCACHE_MAGIC, sizeof(header.magic));
+        header.version = SHADERCACHE_VERSION;
+        header.key = key;
+        header.size = size;
+        header.payloadHash = ShaderCacheKey().add(data, size).value();
+        bool ok = std::fwrite(&header, sizeof(header), 1, file) == 1 &&
+                  std::fwrite(data, 1, size, file) == size;
+        ok = (std::fclose(file) == 0) && ok;
+
+        if (ok) {
+            std::filesystem::rename(temp, path, ec);
+            ok = !ec;
+        }
+        if (!ok) {
+            std::filesystem::remove(temp, ec);
+            std::fprintf(stderr, "ShaderCache: failed to store %s\n", path.c_str());
+        }
+        return ok;
+    }
+
+private:
+    struct Settings {
+        bool enabled = true;
+        std::string directory = "shader_cache";
+    };
+
+    static Settings& settings() {
+        static Settings instance;
+        return instance;
+    }
+};
+
+#endif // SHADER_CACHE_H
@@ -0,0 +1,179 @@
+// sim_trace.h - Per-step entity state traces for headless runs
+#ifndef SIM_TRACE_H
+#define SIM_TRACE_H
+
+#include "entity_storage.h"
+#include "entity.h"
+#include <cctype>
+#include <cstdio>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+// ==================== Trace Formats ====================
+// CSV: one header line, then one row per entity per traced step:
+//   time,id,name,px,py,pz,pitch,yaw,roll,vx,vy,vz
+//
+// Binary (little-endian):
+//   SimTraceHeader
+//   name table: nameCount x { uint32_t id; uint32_t length; char name[length] }
+//   per traced step: SimTraceFrame, SimTraceRecord[entityCount]
+//
+// Rotations are Euler angles in radians; velocity is whatever the entity
+// stores (body frame for flight dynamics entities).
+static const char     SIMTRACE_MAGIC[8] = { 'C', 'U', 'B', 'E', 'T', 'R', 'A', 'C' };
+static const uint32_t SIMTRACE_VERSION  = 1;
+
+struct SimTraceHeader {
+    char     magic[8];
+    uint32_t version;
+    uint32_t recordSize;     // sizeof(SimTraceRecord)
+    uint32_t nameCount;      // Entities alive when the trace was opened
+    uint32_t reserved;
+    double   step;           // Simulation step in seconds
+};
+
+struct SimTraceFrame {
+    double   time;           // Simulated seconds since start
+    uint32_t entityCount;
+    uint32_t reserved;
+};
+
+struct SimTraceRecord {
+    uint32_t id;
+    float    position[3];
+    float    rotation[3];
+    float    velocity[3];
+};
+
+static_assert(sizeof(SimTraceHeader) == 32, "SimTraceHeader is part of the file format");
+static_assert(sizeof(SimTraceFrame) == 16, "SimTraceFrame is part of the file format");
+static_assert(sizeof(SimTraceRecord) == 40, "SimTraceRecord is part of the file format");
+
+// ==================== Sim Trace ====================
+class SimTrace {
+public:
+    enum class Format { CSV, Binary };
+
+    SimTrace() = default;
+    ~SimTrace() { close(); }
+    SimTrace(const SimTrace&) = delete;
+    SimTrace& operator=(const SimTrace&) = delete;
+
+    // ".csv" files get CSV, anything else the binary format
+    static Format formatForPath(const std::string& path) {
+        size_t dot = path.find_last_of('.');
+        std::string ext = dot == std::string::npos ? "" : path.substr(dot);
+        for (char& c : ext) c = (char)tolower((unsigned char)c);
+        return ext == ".csv" ? Format::CSV : Format::Binary;
+    }
+
+    // Entity names are written once, for the entities in 'storage' now
+    bool open(const std::string& path, Format format, const EntityStorage& storage, double step) {
+        close();
+        m_file = std::fopen(path.c_str(), format == Format::CSV ? "w" : "wb");
+        if (!m_file) {
+            std::fprintf(stderr, "SimTrace: cannot write %s\n", path.c_str());
+            return false;
+        }
+        m_format = format;
+        m_frames = 0;
+        m_path = path;
+
+        bool ok;
+        if (format == Format::CSV) {
+            ok = std::fputs("time,id,name,px,py,pz,pitch,yaw,roll,vx,vy,vz\n", m_file) >= 0;
+            m_names.clear();
+            for (uint32_t i = 0; i < storage.size(); i++) setName(storage.ids()[i], storage.entities()[i]);
+        } else {
+            SimTraceHeader header = {};
+            std::memcpy(header.magic, SIMTRACE_MAGIC, sizeof(header.magic));
+            header.version = SIMTRACE_VERSION;
+            header.recordSize = sizeof(SimTraceRecord);
+            header.nameCount = storage.size();
+            header.step = step;
+            ok = std::fwrite(&header, sizeof(header), 1, m_file) == 1;
+            for (uint32_t i = 0; ok && i < storage.size(); i++) {
+                const std::string& name = storage.entities()[i]->getName();
+                uint32_t entry[2] = { storage.ids()[i], (uint32_t)name.size() };
+                ok = std::fwrite(entry, sizeof(entry), 1, m_file) == 1 &&
+                     std::fwrite(name.data(), 1, name.size(), m_file) == name.size();
+            }
+        }
+        if (!ok) {
+            std::fprintf(stderr, "SimTrace: write to %s failed\n", path.c_str());
+            close();
+        }
+        return ok;
+    }
+
+    // Flushes; returns false if any write since open() failed
+    bool close() {
+        if (!m_file) return true;
+        bool ok = !std::ferror(m_file);
+        ok = (std::fclose(m_file) == 0) && ok;
+        m_file = nullptr;
+        if (!ok) std::fprintf(stderr, "SimTrace: write to %s failed\n", m_path.c_str());
+        return ok;
+    }
+
+    bool isOpen() const { return m_file != nullptr; }
+    uint64_t getFrameCount() const { return m_frames; }
+
+    // One sample of every active entity
+    void writeFrame(double time, const EntityStorage& storage) {
+        if (!m_file) return;
+        const uint8_t* flags = storage.flags();
+        const Vec3* pos = storage.positions();
+        const Vec3* rot = storage.rotations();
+        const Vec3* vel = storage.velocities();
+
+        if (m_format == Format::CSV) {
+            for (uint32_t i = 0; i < storage.size(); i++) {
+                if (!(flags[i] & EntityStorage::FLAG_ACTIVE)) continue;
+                EntityID id = storage.ids()[i];
+                if (id >= m_names.size() || m_names[id].empty()) setName(id, storage.entities()[i]);
+                std::fprintf(m_file, "%.6f,%u,%s,%.9g,%.9g,%.9g,%.9g,%.9g,%.9g,%.9g,%.9g,%.9g\n",
+                             time, id, m_names[id].c_str(),
+                             pos[i].x, pos[i].y, pos[i].z, rot[i].x, rot[i].y, rot[i].z,
+                             vel[i].x, vel[i].y, vel[i].z);
+            }
+        } else {
+            m_records.clear();
+            for (uint32_t i = 0; i < storage.size(); i++) {
+                if (!(flags[i] & EntityStorage::FLAG_ACTIVE)) continue;
+                m_records.push_back({ storage.ids()[i],
+                                      { pos[i].x, pos[i].y, pos[i].z },
+                                      { rot[i].x, rot[i].y, rot[i].z },
+                                      { vel[i].x, vel[i].y, vel[i].z } });
+            }
+            SimTraceFrame frame = { time, (uint32_t)m_records.size(), 0 };
+            std::fwrite(&frame, sizeof(frame), 1, m_file);
+            if (!m_records.empty()) {
+                std::fwrite(m_records.data(), sizeof(SimTraceRecord), m_records.size(), m_file);
+            }
+        }
+        m_frames++;
+    }
+
+private:
+    // CSV cells: commas and quotes in names would break the row
+    void setName(EntityID id, const Entity* entity) {
+        if (id >= m_names.size()) m_names.resize((size_t)id + 1);
+        std::string name = entity ? entity->getName() : std::string();
+        for (char& c : name) {
+            if (c == ',' || c == '"' || c == '\n') c = '_';
+        }
+        m_names[id] = name.empty() ? "-" : name;
+    }
+
+    FILE* m_file = nullptr;
+    Format m_format = Format::CSV;
+    uint64_t m_frames = 0;
+    std::string m_path;
+    std::vector<std::string> m_names;          // CSV: EntityID -> sanitized name
+    std::vector<SimTraceRecord> m_records;     // Binary: reused per frame
+};
+
+#endif // SIM_TRACE_H
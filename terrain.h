@@ -0,0 +1,672 @@
+// terrain.h - Quadtree terrain streamed in fixed-size chunks around the camera
+#ifndef TERRAIN_H
+#define TERRAIN_H
+
+#include "renderer.h"
+#include "asset_loader.h"
+#include "texture_cache.h"
+#include "scene_loader_v2.h"
+#include "debug.h"
+#include "stb_image.h"
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include <algorithm>
+
+static const uint32_t TERRAIN_CHUNK_QUADS = 32;                      // Grid quads along a chunk edge, at every level
+static const uint32_t TERRAIN_CHUNK_VERTS = TERRAIN_CHUNK_QUADS + 1;
+static const uint32_t TERRAIN_HEIGHT_SPAN = TERRAIN_CHUNK_VERTS + 2;  // Plus a border sample for normals
+static const uint32_t TERRAIN_MAX_LEVEL = 15;         // Quadtree depth limit (node keys, stitch nibbles)
+static const uint32_t TERRAIN_LOADS_IN_FLIGHT = 16;   // Chunk height jobs queued at once
+static const uint32_t TERRAIN_EVICT_FRAMES = 300;     // Chunks unused this long are dropped
+static const uint32_t TERRAIN_HEIGHT_TILE_CACHE = 32; // Decoded heightmap tiles kept
+static const float TERRAIN_TEXTURE_PERIOD = 1000.0f;  // Metres per repeat of the ground texture
+static const float TERRAIN_NOISE_WAVELENGTH = 4000.0f;  // Largest procedural feature (metres)
+static const float TERRAIN_FLAT_MARGIN = 300.0f;      // Blend from the flat runway area to full height
+
+// ==================== Terrain Height Source ====================
+// Height at any world (x, z); safe to call from loader workers. Heightmap
+// tiles are 16-bit greyscale images, one per root tile, whose edge pixels
+// lie on the tile edges (neighbours repeat their shared edge). They are
+// decoded on first use and the most recently used few dozen are kept.
+// Without heightmap tiles the height is fractal value noise. Either is
+// scaled by heightScale and flattened to 0 around the runway.
+class TerrainHeightSource {
+public:
+    void configure(const SceneConfigV2::GroundConfig& ground, float originX, float originZ, int tilesPerSide) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_pattern = ground.terrain.heightmapTiles;
+        m_tileSize = ground.terrain.tileSize;
+        m_heightScale = ground.terrain.heightScale;
+        m_seed = ground.terrain.seed;
+        m_originX = originX;
+        m_originZ = originZ;
+        m_tilesPerSide = tilesPerSide;
+        m_flatHalfX = ground.hasRunway ? ground.runwayWidth * 0.5f : 0.0f;
+        m_flatHalfZ = ground.hasRunway ? ground.runwayLength * 0.5f : 0.0f;
+        m_flatten = ground.hasRunway;
+        m_tiles.clear();
+        m_useCounter = 0;
+    }
+
+    // count x count samples starting at (x0, z0), 'spacing' apart, x fastest
+    void sampleGrid(float x0, float z0, float spacing, uint32_t count, float* out) {
+        if (m_heightScale == 0.0f) {
+            std::fill(out, out + count * count, 0.0f);
+            return;
+        }
+        std::shared_ptr<const HeightTile> tile;
+        int tileX = -1, tileZ = -1;
+        for (uint32_t j = 0; j < count; j++) {
+            float z = z0 + j * spacing;
+            for (uint32_t i = 0; i < count; i++) {
+                float x = x0 + i * spacing;
+                float h;
+                if (m_pattern.empty()) {
+                    h = fractalNoise(x, z);
+                } else {
+                    int tx, tz;
+                    float u, v;
+                    tileCoords(x, z, tx, tz, u, v);
+                    if (tx != tileX || tz != tileZ) {
+                        tile = getTile(tx, tz);
+                        tileX = tx;
+                        tileZ = tz;
+                    }
+                    h = tile ? tile->sample(u, v) : 0.0f;
+                }
+                out[j * count + i] = h * m_heightScale * flattenFactor(x, z);
+            }
+        }
+    }
+
+    size_t cachedTileCount() const {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_tiles.size();
+    }
+
+    // "{x}" and "{z}" in a tile pattern replaced by the tile's indices
+    static std::string tilePath(const std::string& pattern, int tx, int tz) {
+        std::string path = pattern;
+        size_t pos;
+        while ((pos = path.find("{x}")) != std::string::npos) path.replace(pos, 3, std::to_string(tx));
+        while ((pos = path.find("{z}")) != std::string::npos) path.replace(pos, 3, std::to_string(tz));
+        return path;
+    }
+
+private:
+    struct HeightTile {
+        int width = 0;
+        int height = 0;
+        std::vector<uint16_t> samples;
+
+        // Bilinear, u and v in [0, 1] across the tile
+        float sample(float u, float v) const {
+            float fx = u * (width - 1), fz = v * (height - 1);
+            int x0 = (std::min)((int)fx, width - 2), z0 = (std::min)((int)fz, height - 2);
+            float tx = fx - x0, tz = fz - z0;
+            const uint16_t* row0 = &samples[(size_t)z0 * width + x0];
+            const uint16_t* row1 = row0 + width;
+            float top = row0[0] + (row0[1] - (float)row0[0]) * tx;
+            float bottom = row1[0] + (row1[1] - (float)row1[0]) * tx;
+            return (top + (bottom - top) * tz) / 65535.0f;
+        }
+    };
+
+    struct CachedTile {
+        std::shared_ptr<const HeightTile> tile;   // Null when the file is missing or unreadable
+        uint64_t lastUse;
+    };
+
+    void tileCoords(float x, float z, int& tx, int& tz, float& u, float& v) const {
+        float gx = (x - m_originX) / m_tileSize, gz = (z - m_originZ) / m_tileSize;
+        tx = (std::max)(0, (std::min)((int)std::floor(gx), m_tilesPerSide - 1));
+        tz = (std::max)(0, (std::min)((int)std::floor(gz), m_tilesPerSide - 1));
+        u = (std::max)(0.0f, (std::min)(gx - tx, 1.0f));
+        v = (std::max)(0.0f, (std::min)(gz - tz, 1.0f));
+    }
+
+    // Decodes outside the lock, so workers loading different tiles overlap
+    std::shared_ptr<const HeightTile> getTile(int tx, int tz) {
+        uint64_t key = ((uint64_t)(uint32_t)tx << 32) | (uint32_t)tz;
+        std::string path;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            auto it = m_tiles.find(key);
+            if (it != m_tiles.end()) {
+                it->second.lastUse = ++m_useCounter;
+                return it->second.tile;
+            }
+            path = tilePath(m_pattern, tx, tz);
+        }
+
+        std::shared_ptr<HeightTile> tile;
+        int width, height, channels;
+        stbi_us* pixels = stbi_load_16(path.c_str(), &width, &height, &channels, 1);
+        if (pixels && width >= 2 && height >= 2) {
+            tile = std::make_shared<HeightTile>();
+            tile->width = width;
+            tile->height = height;
+            tile->samples.assign(pixels, pixels + (size_t)width * height);
+        } else {
+            LOG_WARNING("Terrain: No heightmap tile %s, using height 0", path.c_str());
+        }
+        if (pixels) stbi_image_free(pixels);
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto inserted = m_tiles.insert({ key, { tile, ++m_useCounter } });
+        if (!inserted.second) return inserted.first->second.tile;   // Another worker was faster
+        if (m_tiles.size() > TERRAIN_HEIGHT_TILE_CACHE) {
+            auto oldest = m_tiles.begin();
+            for (auto it = m_tiles.begin(); it != m_tiles.end(); ++it) {
+                if (it->second.lastUse < oldest->second.lastUse) oldest = it;
+            }
+            m_tiles.erase(oldest);   // Chunks still sampling it hold their own reference
+        }
+        return tile;
+    }
+
+    static float hashNoise(int32_t x, int32_t z, uint32_t seed) {
+        uint32_t h = (uint32_t)x * 374761393u + (uint32_t)z * 668265263u + seed * 2246822519u;
+        h = (h ^ (h >> 13)) * 1274126177u;
+        return (float)((h ^ (h >> 16)) & 0xffffff) / 16777215.0f;
+    }
+
+    float valueNoise(float x, float z, uint32_t seed) const {
+        float fx = std::floor(x), fz = std::floor(z);
+        int32_t ix = (int32_t)fx, iz = (int32_t)fz;
+        float tx = x - fx, tz = z - fz;
+        tx = tx * tx * (3.0f - 2.0f * tx);
+        tz = tz * tz * (3.0f - 2.0f * tz);
+        float a = hashNoise(ix, iz, seed), b = hashNoise(ix + 1, iz, seed);
+        float c = hashNoise(ix, iz + 1, seed), d = hashNoise(ix + 1, iz + 1, seed);
+        float top = a + (b - a) * tx, bottom = c + (d - c) * tx;
+        return top + (bottom - top) * tz;
+    }
+
+    // Six octaves, in [0, 1]
+    float fractalNoise(float x, float z) const {
+        float sum = 0.0f, norm = 0.0f, amplitude = 1.0f;
+        float frequency = 1.0f / TERRAIN_NOISE_WAVELENGTH;
+        for (uint32_t octave = 0; octave < 6; octave++) {
+            sum += amplitude * valueNoise(x * frequency, z * frequency, m_seed + octave);
+            norm += amplitude;
+            amplitude *= 0.5f;
+            frequency *= 2.0f;
+        }
+        return sum / norm;
+    }
+
+    // 0 on the runway, rising smoothly to 1 over TERRAIN_FLAT_MARGIN
+    float flattenFactor(float x, float z) const {
+        if (!m_flatten) return 1.0f;
+        float dx = (std::max)(std::fabs(x) - m_flatHalfX, 0.0f);
+        float dz = (std::max)(std::fabs(z) - m_flatHalfZ, 0.0f);
+        float t = (std::min)(std::sqrt(dx * dx + dz * dz) / TERRAIN_FLAT_MARGIN, 1.0f);
+        return t * t * (3.0f - 2.0f * t);
+    }
+
+    mutable std::mutex m_mutex;   // Guards m_tiles and m_useCounter
+    std::unordered_map<uint64_t, CachedTile> m_tiles;
+    uint64_t m_useCounter = 0;
+    std::string m_pattern;
+    float m_tileSize = 2048.0f;
+    float m_heightScale = 0.0f;
+    uint32_t m_seed = 1;
+    float m_originX = 0.0f;
+    float m_originZ = 0.0f;
+    int m_tilesPerSide = 1;
+    bool m_flatten = false;
+    float m_flatHalfX = 0.0f;
+    float m_flatHalfZ = 0.0f;
+};
+
+// ==================== Terrain ====================
+// A grid of root tiles covering the ground's extent, each the root of a
+// quadtree whose nodes are all drawn as TERRAIN_CHUNK_QUADS^2 grids, so a
+// node has four times the detail of its parent over the same area.
+//
+// Every frame update() walks the quadtrees of the tiles within view
+// distance: a node nearer the camera than lodDistance times its size is
+// split, but only once all four children are loaded and their meshes are
+// ready; until then the node itself is drawn and the missing children are
+// requested. Heights are sampled on the terrain's own loader threads;
+// meshes are built on the calling (render) thread. Chunks untouched for
+// TERRAIN_EVICT_FRAMES frames are dropped, root tiles included.
+//
+// Cracks between levels are stitched: along an edge whose neighbour is k
+// levels coarser, the in-between vertices are moved onto the neighbour's
+// edge (interpolated between the vertices both share). That makes a mesh
+// depend on its neighbours' levels, so a chunk whose stitching changes
+// gets a new mesh, and keeps drawing the old one until the new one is ready.
+class Terrain {
+public:
+    struct Stats {
+        uint32_t resident = 0;       // Chunks with heights
+        uint32_t loading = 0;
+        uint32_t drawn = 0;          // Last update()
+        uint32_t meshBuilds = 0;     // Last update()
+        uint64_t triangles = 0;      // Last update()
+        uint32_t heightTiles = 0;    // Decoded heightmap tiles
+    };
+
+    Terrain() : m_loader(2) {}
+    ~Terrain() { clear(); }
+
+    Terrain(const Terrain&) = delete;
+    Terrain& operator=(const Terrain&) = delete;
+
+    // 'texture' is drawn repeated where there are no texture tiles (0 = vertex
+    // colour only). The renderer and cache are used until clear().
+    void initialize(IRenderer* renderer, TextureCache* textures,
+                    const SceneConfigV2::GroundConfig& ground, uint32_t texture) {
+        clear();
+        const SceneConfigV2::GroundConfig::TerrainConfig& config = ground.terrain;
+        m_tileSize = (std::max)(config.tileSize, 1.0f);
+        m_tilesPerSide = (std::max)(1, (int)std::ceil(ground.size * 2.0f / m_tileSize));
+        m_originX = m_originZ = -0.5f * m_tilesPerSide * m_tileSize;
+        m_maxLevel = (std::min)(config.maxLevel, TERRAIN_MAX_LEVEL);
+        m_lodDistance = config.lodDistance;
+        m_viewDistance = config.viewDistance;
+        m_textureTiles = config.textureTiles;
+        m_texture = texture;
+        std::memcpy(m_color, ground.color, sizeof(m_color));
+        m_heights.configure(ground, m_originX, m_originZ, m_tilesPerSide);
+        buildIndices();
+        m_renderer = renderer;
+        m_textures = textures;
+
+        LOG_INFO("Terrain: %d x %d tiles of %.0fm, %u levels (finest grid %.1fm), %s heights",
+                 m_tilesPerSide, m_tilesPerSide, m_tileSize, m_maxLevel + 1,
+                 nodeSize(m_maxLevel) / TERRAIN_CHUNK_QUADS,
+                 config.heightScale == 0.0f ? "flat" : config.heightmapTiles.empty() ? "procedural" : "heightmap");
+    }
+
+    // Waits for loads in flight, then destroys every chunk mesh
+    void clear() {
+        m_loader.wait();
+        if (m_renderer) {
+            for (auto& pair : m_chunks) releaseChunk(pair.second);
+        }
+        m_chunks.clear();
+        m_leaves.clear();
+        m_leafKeys.clear();
+        m_visible.clear();
+        m_loading = 0;
+        m_renderer = nullptr;
+        m_textures = nullptr;
+    }
+
+    bool isActive() const { return m_renderer != nullptr; }
+
+    // Picks the chunks to draw for this camera, streaming as needed
+    void update(const Vec3& camera, const Frustum& frustum) {
+        if (!m_renderer) return;
+        m_loader.pump(TERRAIN_LOADS_IN_FLIGHT);
+        m_frame++;
+        m_stats.meshBuilds = 0;
+
+        m_leaves.clear();
+        int first[2], last[2];
+        float cam[2] = { camera.x - m_originX, camera.z - m_originZ };
+        for (int a = 0; a < 2; a++) {
+            first[a] = (std::max)(0, (int)std::floor((cam[a] - m_viewDistance) / m_tileSize));
+            last[a] = (std::min)(m_tilesPerSide - 1, (int)std::floor((cam[a] + m_viewDistance) / m_tileSize));
+        }
+        for (int tz = first[1]; tz <= last[1]; tz++) {
+            for (int tx = first[0]; tx <= last[0]; tx++) {
+                float dx = (std::max)({ m_originX + tx * m_tileSize - camera.x, 0.0f,
+                                        camera.x - (m_originX + (tx + 1) * m_tileSize) });
+                float dz = (std::max)({ m_originZ + tz * m_tileSize - camera.z, 0.0f,
+                                        camera.z - (m_originZ + (tz + 1) * m_tileSize) });
+                if (dx * dx + dz * dz > m_viewDistance * m_viewDistance) continue;
+                select(0, (uint32_t)tx, (uint32_t)tz, camera);
+            }
+        }
+
+        m_leafKeys.clear();
+        m_leafKeys.insert(m_leaves.begin(), m_leaves.end());
+        m_visible.clear();
+        m_stats.triangles = 0;
+        for (uint64_t key : m_leaves) {
+            Chunk& chunk = m_chunks[key];
+            uint32_t stitch = stitchMask(key);
+            if (stitch != chunk.stitch) {
+                // Superseded before it was ready: never drawn, so drop it
+                if (chunk.pendingMesh) m_renderer->destroyMesh(chunk.pendingMesh);
+                chunk.pendingMesh = buildMesh(key, chunk, stitch);
+                chunk.stitch = stitch;
+            }
+            if (chunk.pendingMesh && m_renderer->isMeshReady(chunk.pendingMesh)) {
+                if (chunk.mesh) m_renderer->destroyMesh(chunk.mesh);
+                chunk.mesh = chunk.pendingMesh;
+                chunk.pendingMesh = 0;
+            }
+
+            uint32_t level = keyLevel(key);
+            float size = nodeSize(level);
+            float half = size * 0.5f;
+            float heightHalf = (chunk.maxHeight - chunk.minHeight) * 0.5f;
+            Vec3 center = { m_originX + keyX(key) * size + half,
+                            chunk.minHeight + heightHalf,
+                            m_originZ + keyZ(key) * size + half };
+            float radius = std::sqrt(2.0f * half * half + heightHalf * heightHalf);
+            if (!chunk.mesh || frustum.testSphere(center, radius) == FrustumTest::Outside) continue;
+
+            m_visible.push_back({ chunk.mesh, chunkTexture(key) });
+            m_stats.triangles += TERRAIN_CHUNK_QUADS * TERRAIN_CHUNK_QUADS * 2;
+        }
+        m_stats.drawn = (uint32_t)m_visible.size();
+
+        if (m_frame % 60 == 0) evictUnused();
+    }
+
+    // The chunks picked by update(); expects the world-space constants the
+    // ground is drawn with (MVP = view-projection)
+    void draw() {
+        for (const VisibleChunk& chunk : m_visible) {
+            m_renderer->drawMesh(chunk.mesh, chunk.texture);
+            if (chunk.texture) m_textures->markUsed(chunk.texture);
+        }
+    }
+
+    Stats getStats() const {
+        Stats stats = m_stats;
+        for (const auto& pair : m_chunks) {
+            if (pair.second.loaded) stats.resident++;
+        }
+        stats.loading = m_loading;
+        stats.heightTiles = (uint32_t)m_heights.cachedTileCount();
+        return stats;
+    }
+
+    void printStats() const {
+        if (!isActive()) return;
+        Stats stats = getStats();
+        printf("\n=== Terrain Statistics ===\n");
+        printf("Resident Chunks:  %u (%u loading)\n", stats.resident, stats.loading);
+        printf("Drawn Chunks:     %u (%llu triangles)\n", stats.drawn, (unsigned long long)stats.triangles);
+        printf("Heightmap Tiles:  %u cached\n", stats.heightTiles);
+    }
+
+private:
+    struct Chunk {
+        bool loaded = false;
+        std::vector<float> heights;    // TERRAIN_HEIGHT_SPAN^2, x fastest, one-sample border
+        float minHeight = 0.0f;
+        float maxHeight = 0.0f;
+        uint32_t mesh = 0;             // Drawn
+        uint32_t pendingMesh = 0;      // Restitched, waiting for its upload
+        uint32_t stitch = ~0u;         // stitchMask() of the newest mesh
+        uint32_t texture = 0;          // Root chunks with texture tiles: the tile's texture
+        uint32_t lastUsedFrame = 0;
+    };
+
+    struct VisibleChunk {
+        uint32_t mesh;
+        uint32_t texture;
+    };
+
+    // Level in the top bits, then x and z in the level's grid
+    static uint64_t chunkKey(uint32_t level, uint32_t x, uint32_t z) {
+        return ((uint64_t)level << 56) | ((uint64_t)x << 28) | z;
+    }
+    static uint32_t keyLevel(uint64_t key) { return (uint32_t)(key >> 56); }
+    static uint32_t keyX(uint64_t key) { return (uint32_t)(key >> 28) & 0x0fffffff; }
+    static uint32_t keyZ(uint64_t key) { return (uint32_t)key & 0x0fffffff; }
+
+    float nodeSize(uint32_t level) const { return m_tileSize / (float)(1u << level); }
+    uint32_t levelCells(uint32_t level) const { return (uint32_t)m_tilesPerSide << level; }
+
+    // Draws the node, or its children once all four can be drawn. Returns
+    // false while the node itself cannot be drawn yet.
+    bool select(uint32_t level, uint32_t x, uint32_t z, const Vec3& camera) {
+        uint64_t key = chunkKey(level, x, z);
+        Chunk* chunk = touch(key);
+        if (!drawable(chunk)) {
+            if (!chunk) requestLoad(level, x, z);
+            return false;
+        }
+
+        float size = nodeSize(level);
+        if (level < m_maxLevel && distanceToNode(camera, key, *chunk) < m_lodDistance * size) {
+            bool childrenReady = true;
+            for (uint32_t c = 0; c < 4; c++) {
+                uint32_t cx = x * 2 + (c & 1), cz = z * 2 + (c >> 1);
+                Chunk* child = touch(chunkKey(level + 1, cx, cz));
+                if (!child) requestLoad(level + 1, cx, cz);
+                childrenReady &= drawable(child);
+            }
+            if (childrenReady) {
+                for (uint32_t c = 0; c < 4; c++) select(level + 1, x * 2 + (c & 1), z * 2 + (c >> 1), camera);
+                return true;
+            }
+        }
+        m_leaves.push_back(key);
+        return true;
+    }
+
+    Chunk* touch(uint64_t key) {
+        auto it = m_chunks.find(key);
+        if (it == m_chunks.end()) return nullptr;
+        it->second.lastUsedFrame = m_frame;
+        return &it->second;
+    }
+
+    // Loaded, and a mesh (the first is built on load) is on the GPU
+    bool drawable(const Chunk* chunk) const {
+        if (!chunk || !chunk->loaded) return false;
+        uint32_t mesh = chunk->mesh ? chunk->mesh : chunk->pendingMesh;
+        return mesh && m_renderer->isMeshReady(mesh);
+    }
+
+    float distanceToNode(const Vec3& camera, uint64_t key, const Chunk& chunk) const {
+        float size = nodeSize(keyLevel(key));
+        float x0 = m_originX + keyX(key) * size, z0 = m_originZ + keyZ(key) * size;
+        float dx = (std::max)({ x0 - camera.x, 0.0f, camera.x - (x0 + size) });
+        float dy = (std::max)({ chunk.minHeight - camera.y, 0.0f, camera.y - chunk.maxHeight });
+        float dz = (std::max)({ z0 - camera.z, 0.0f, camera.z - (z0 + size) });
+        return std::sqrt(dx * dx + dy * dy + dz * dz);
+    }
+
+    void requestLoad(uint32_t level, uint32_t x, uint32_t z) {
+        if (m_loading >= TERRAIN_LOADS_IN_FLIGHT) return;   // Asked again next frame
+        uint64_t key = chunkKey(level, x, z);
+        m_chunks[key].lastUsedFrame = m_frame;
+        m_loading++;
+
+        float spacing = nodeSize(level) / TERRAIN_CHUNK_QUADS;
+        float x0 = m_originX + x * nodeSize(level) - spacing;
+        float z0 = m_originZ + z * nodeSize(level) - spacing;
+        auto heights = std::make_shared<std::vector<float>>();
+        TerrainHeightSource* source = &m_heights;
+        m_loader.submit(
+            [source, heights, x0, z0, spacing] {
+                heights->resize(TERRAIN_HEIGHT_SPAN * TERRAIN_HEIGHT_SPAN);
+                source->sampleGrid(x0, z0, spacing, TERRAIN_HEIGHT_SPAN, heights->data());
+            },
+            [this, key, heights] { finishLoad(key, std::move(*heights)); });
+    }
+
+    // On the render thread, from m_loader.pump()
+    void finishLoad(uint64_t key, std::vector<float>&& heights) {
+        m_loading--;
+        Chunk& chunk = m_chunks[key];
+        chunk.heights = std::move(heights);
+        chunk.minHeight = chunk.maxHeight = chunk.heights[TERRAIN_HEIGHT_SPAN + 1];
+        for (uint32_t j = 1; j <= TERRAIN_CHUNK_VERTS; j++) {
+            for (uint32_t i = 1; i <= TERRAIN_CHUNK_VERTS; i++) {
+                float h = chunk.heights[j * TERRAIN_HEIGHT_SPAN + i];
+                chunk.minHeight = (std::min)(chunk.minHeight, h);
+                chunk.maxHeight = (std::max)(chunk.maxHeight, h);
+            }
+        }
+        chunk.loaded = true;
+
+        // Unstitched until it is first drawn as a leaf
+        chunk.stitch = 0;
+        chunk.pendingMesh = buildMesh(key, chunk, 0);
+
+        if (keyLevel(key) == 0 && !m_textureTiles.empty()) {
+            std::string path = TerrainHeightSource::tilePath(m_textureTiles, (int)keyX(key), (int)keyZ(key));
+            chunk.texture = m_textures->acquire(path.c_str());
+        }
+    }
+
+    // Four nibbles (-x, +x, -z, +z edges): how many levels coarser the
+    // chunk drawn across that edge is, 0 if it is as fine or finer
+    uint32_t stitchMask(uint64_t key) const {
+        static const int EDGE_DX[4] = { -1, 1, 0, 0 };
+        static const int EDGE_DZ[4] = { 0, 0, -1, 1 };
+        uint32_t level = keyLevel(key);
+        int64_t cells = levelCells(level);
+        uint32_t mask = 0;
+        for (uint32_t edge = 0; edge < 4; edge++) {
+            int64_t nx = (int64_t)keyX(key) + EDGE_DX[edge], nz = (int64_t)keyZ(key) + EDGE_DZ[edge];
+            if (nx < 0 || nz < 0 || nx >= cells || nz >= cells) continue;
+            if (m_leafKeys.count(chunkKey(level, (uint32_t)nx, (uint32_t)nz))) continue;
+            for (uint32_t coarser = 1; coarser <= level; coarser++) {
+                if (m_leafKeys.count(chunkKey(level - coarser, (uint32_t)(nx >> coarser), (uint32_t)(nz >> coarser)))) {
+                    mask |= coarser << (edge * 4);
+                    break;
+                }
+            }
+        }
+        return mask;
+    }
+
+    uint32_t buildMesh(uint64_t key, const Chunk& chunk, uint32_t stitch) {
+        const uint32_t N = TERRAIN_CHUNK_VERTS, S = TERRAIN_HEIGHT_SPAN;
+        uint32_t level = keyLevel(key);
+        float size = nodeSize(level);
+        float spacing = size / TERRAIN_CHUNK_QUADS;
+        float x0 = m_originX + keyX(key) * size, z0 = m_originZ + keyZ(key) * size;
+        float tileX0 = m_originX + (keyX(key) >> level) * m_tileSize;
+        float tileZ0 = m_originZ + (keyZ(key) >> level) * m_tileSize;
+        bool tileUVs = !m_textureTiles.empty();
+        const float* h = chunk.heights.data();
+
+        m_vertexScratch.resize(N * N);
+        for (uint32_t j = 0; j < N; j++) {
+            for (uint32_t i = 0; i < N; i++) {
+                const float* c = h + (j + 1) * S + (i + 1);
+                Vertex& v = m_vertexScratch[j * N + i];
+                v.px = x0 + i * spacing;
+                v.py = c[0];
+                v.pz = z0 + j * spacing;
+                Vec3 n = v3_norm({ (c[-1] - c[1]) / (2.0f * spacing), 1.0f, (c[-(int)S] - c[S]) / (2.0f * spacing) });
+                v.nx = n.x; v.ny = n.y; v.nz = n.z;
+                v.r = m_color[0]; v.g = m_color[1]; v.b = m_color[2]; v.a = m_color[3];
+                v.u = tileUVs ? (v.px - tileX0) / m_tileSize : v.px / TERRAIN_TEXTURE_PERIOD;
+                v.v = tileUVs ? (v.pz - tileZ0) / m_tileSize : v.pz / TERRAIN_TEXTURE_PERIOD;
+                v.tx = 1.0f; v.ty = 0.0f; v.tz = 0.0f;
+                v.bx = 0.0f; v.by = 0.0f; v.bz = 1.0f;
+            }
+        }
+
+        // Edge vertices between the coarser neighbour's vertices are moved
+        // onto its straight edge
+        for (uint32_t edge = 0; edge < 4; edge++) {
+            uint32_t coarser = (stitch >> (edge * 4)) & 0xf;
+            if (coarser == 0) continue;
+            uint32_t step = (std::min)(1u << coarser, TERRAIN_CHUNK_QUADS);
+            for (uint32_t k = 0; k < N; k++) {
+                uint32_t offset = k % step;
+                if (offset == 0) continue;
+                uint32_t a = k - offset, b = a + step;
+                float t = (float)offset / (float)step;
+                auto index = [edge](uint32_t along) {
+                    switch (edge) {
+                        case 0:  return along * N;                        // -x: i = 0
+                        case 1:  return along * N + (N - 1);              // +x
+                        case 2:  return along;                            // -z: j = 0
+                        default: return (N - 1) * N + along;              // +z
+                    }
+                };
+                float ha = h[(index(a) / N + 1) * S + (index(a) % N + 1)];
+                float hb = h[(index(b) / N + 1) * S + (index(b) % N + 1)];
+                m_vertexScratch[index(k)].py = ha + (hb - ha) * t;
+            }
+        }
+
+        m_stats.meshBuilds++;
+        return m_renderer->createMesh(m_vertexScratch.data(), N * N,
+                                      m_indices.data(), (uint32_t)m_indices.size());
+    }
+
+    // The same grid topology for every chunk
+    void buildIndices() {
+        const uint16_t N = (uint16_t)TERRAIN_CHUNK_VERTS;
+        m_indices.clear();
+        for (uint16_t j = 0; j < TERRAIN_CHUNK_QUADS; j++) {
+            for (uint16_t i = 0; i < TERRAIN_CHUNK_QUADS; i++) {
+                uint16_t v00 = j * N + i, v10 = v00 + 1, v01 = v00 + N, v11 = v01 + 1;
+                m_indices.insert(m_indices.end(), { v00, v01, v11, v00, v11, v10 });
+            }
+        }
+    }
+
+    uint32_t chunkTexture(uint64_t key) const {
+        if (!m_textureTiles.empty()) {
+            uint32_t level = keyLevel(key);
+            auto root = m_chunks.find(chunkKey(0, keyX(key) >> level, keyZ(key) >> level));
+            if (root != m_chunks.end() && root->second.texture) return root->second.texture;
+        }
+        return m_texture;
+    }
+
+    void releaseChunk(Chunk& chunk) {
+        if (chunk.mesh) m_renderer->destroyMesh(chunk.mesh);
+        if (chunk.pendingMesh) m_renderer->destroyMesh(chunk.pendingMesh);
+        if (chunk.texture) m_textures->release(chunk.texture);
+        chunk.mesh = chunk.pendingMesh = chunk.texture = 0;
+    }
+
+    void evictUnused() {
+        for (auto it = m_chunks.begin(); it != m_chunks.end();) {
+            Chunk& chunk = it->second;
+            if (chunk.loaded && m_frame - chunk.lastUsedFrame > TERRAIN_EVICT_FRAMES) {
+                releaseChunk(chunk);
+                it = m_chunks.erase(it);
+            } else {
+                ++it;
+            }
+        }
+    }
+
+    IRenderer* m_renderer = nullptr;
+    TextureCache* m_textures = nullptr;
+    TerrainHeightSource m_heights;
+    float m_tileSize = 2048.0f;
+    int m_tilesPerSide = 1;
+    float m_originX = 0.0f;
+    float m_originZ = 0.0f;
+    uint32_t m_maxLevel = 0;
+    float m_lodDistance = 2.0f;
+    float m_viewDistance = 20000.0f;
+    std::string m_textureTiles;
+    uint32_t m_texture = 0;
+    float m_color[4] = { 1.0f, 1.0f, 1.0f, 1.0f };
+
+    std::unordered_map<uint64_t, Chunk> m_chunks;
+    std::vector<uint64_t> m_leaves;            // Chunks update() picked, in walk order
+    std::unordered_set<uint64_t> m_leafKeys;   // Same, for neighbour lookups
+    std::vector<VisibleChunk> m_visible;       // Leaves in the frustum with a mesh
+    std::vector<Vertex> m_vertexScratch;
+    std::vector<uint16_t> m_indices;
+    uint32_t m_loading = 0;
+    uint32_t m_frame = 0;
+    Stats m_stats;
+
+    // Last member: destroyed first, so no job outlives what it points at
+    AssetLoader m_loader;
+};
+
+#endif // TERRAIN_H
@@ -1,15 +1,41 @@
 // text_renderer_gl.cpp - OpenGL text rendering implementation
 #include "text_renderer_gl.h"
 #include <glad/glad.h>
+#include <cstddef>
+#include <cstdio>
 #include <cstring>
 
+namespace {
+
+const uint64_t FENCE_TIMEOUT_NS = 1000000000ull;   // Per wait; a lost GPU shouldn't hang the app
+
+uint8_t toByte(float v) {
+    if (!(v > 0.0f)) return 0;
+    if (v >= 1.0f) return 255;
+    return (uint8_t)(v * 255.0f + 0.5f);
+}
+
+uint32_t packColor(const TextColor& c) {
+    return (uint32_t)toByte(c.r) | ((uint32_t)toByte(c.g) << 8) |
+           ((uint32_t)toByte(c.b) << 16) | ((uint32_t)toByte(c.a) << 24);
+}
+
+} // namespace
+
 GLTextRenderer::GLTextRenderer() 
     : m_vao(0)
     , m_vbo(0)
     , m_shader(0)
     , m_fontTexture(0)
+    , m_screenLocation(-1)
     , m_screenWidth(800)
     , m_screenHeight(600)
+    , m_persistent(false)
+    , m_mapped(nullptr)
+    , m_glyphs(nullptr)
+    , m_glyphCount(0)
+    , m_region(0)
+    , m_fences()
 {}
 
 GLTextRenderer::~GLTextRenderer() {
@@ -19,19 +45,28 @@ GLTextRenderer::~GLTextRenderer() {
 bool GLTextRenderer::initialize() {
     printf("GLTextRenderer::initialize() - starting...\n");
     
-    // Create simple shader for text rendering
+    // One instance per glyph; the four strip vertices pick the corners
     const char* vertexShader = R"(
         #version 330 core
-        layout(location = 0) in vec2 aPos;
-        layout(location = 1) in vec2 aTexCoord;
-        layout(location = 2) in vec4 aColor;
+        layout(location = 0) in vec2 aPos;      // Glyph top-left in pixels
+        layout(location = 1) in vec4 aColor;
+        layout(location = 2) in uvec2 aGlyph;   // Character code, scale * 256
+        
+        uniform vec2 uScreenSize;
         
         out vec2 vTexCoord;
         out vec4 vColor;
         
         void main() {
-            gl_Position = vec4(aPos, 0.0, 1.0);
-            vTexCoord = aTexCoord;
+            vec2 corner = vec2(float(gl_VertexID & 1), float(gl_VertexID >> 1));
+            vec2 size = vec2(12.0, 16.0) * (float(aGlyph.y) / 256.0);
+            vec2 pixel = aPos + corner * size;
+            gl_Position = vec4(pixel.x / uScreenSize.x * 2.0 - 1.0,
+                               1.0 - pixel.y / uScreenSize.y * 2.0, 0.0, 1.0);
+            
+            // Font texture is a 16x16 grid of characters
+            vec2 cell = vec2(float(aGlyph.x % 16u), float(aGlyph.x / 16u));
+            vTexCoord = (cell + corner) / 16.0;
             vColor = aColor;
         }
     )";
@@ -69,27 +104,38 @@ bool GLTextRenderer::initialize() {
     glDeleteShader(vs);
     glDeleteShader(fs);
     
+    GLint linked = 0;
+    glGetProgramiv(m_shader, GL_LINK_STATUS, &linked);
+    if (!linked) {
+        char log[512];
+        glGetProgramInfoLog(m_shader, sizeof(log), nullptr, log);
+        fprintf(stderr, "GLTextRenderer: shader link failed: %s\n", log);
+        shutdown();
+        return false;
+    }
+    m_screenLocation = glGetUniformLocation(m_shader, "uScreenSize");
+    
     printf("GLTextRenderer::initialize() - shader program: %u\n", m_shader);
     
-    // Create VAO/VBO for text quads
+    // VAO over the glyph ring; attribute offsets are set per pass in endText()
     glGenVertexArrays(1, &m_vao);
-    glGenBuffers(1, &m_vbo);
-    
-    printf("GLTextRenderer::initialize() - VAO: %u, VBO: %u\n", m_vao, m_vbo);
-    
     glBindVertexArray(m_vao);
-    glBindBuffer(GL_ARRAY_BUFFER, m_vbo);
-    
-    // Vertex format: pos(2) + texcoord(2) + color(4) = 8 floats
-    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)0);
+    if (!createRingBuffer()) {
+        glBindVertexArray(0);
+        shutdown();
+        return false;
+    }
     glEnableVertexAttribArray(0);
-    glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(2 * sizeof(float)));
     glEnableVertexAttribArray(1);
-    glVertexAttribPointer(2, 4, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(4 * sizeof(float)));
     glEnableVertexAttribArray(2);
-    
+    glVertexAttribDivisor(0, 1);
+    glVertexAttribDivisor(1, 1);
+    glVertexAttribDivisor(2, 1);
     glBindVertexArray(0);
     
+    printf("GLTextRenderer::initialize() - VAO: %u, VBO: %u (%s ring, %u glyphs x %u)\n",
+           m_vao, m_vbo, m_persistent ? "persistent" : "mapped", MAX_GLYPHS, RING_FRAMES);
+    
     // Create simple bitmap font texture
     createBitmapFont();
     
@@ -100,36 +146,107 @@ bool GLTextRenderer::initialize() {
 }
 
 void GLTextRenderer::shutdown() {
+    if (m_persistent && m_vbo) {
+        glBindBuffer(GL_ARRAY_BUFFER, m_vbo);
+        glUnmapBuffer(GL_ARRAY_BUFFER);
+    } else if (m_glyphs && m_vbo) {
+        glBindBuffer(GL_ARRAY_BUFFER, m_vbo);   // Pass left open
+        glUnmapBuffer(GL_ARRAY_BUFFER);
+    }
+    for (GLsync& fence : m_fences) {
+        if (fence) glDeleteSync(fence);
+        fence = nullptr;
+    }
+    
     if (m_vao) glDeleteVertexArrays(1, &m_vao);
     if (m_vbo) glDeleteBuffers(1, &m_vbo);
     if (m_shader) glDeleteProgram(m_shader);
     if (m_fontTexture) glDeleteTextures(1, &m_fontTexture);
     
     m_vao = m_vbo = m_shader = m_fontTexture = 0;
+    m_persistent = false;
+    m_mapped = m_glyphs = nullptr;
+    m_glyphCount = 0;
+}
+
+bool GLTextRenderer::createRingBuffer() {
+    const GLsizeiptr size = (GLsizeiptr)(sizeof(GlyphInstance) * MAX_GLYPHS * RING_FRAMES);
+    glGenBuffers(1, &m_vbo);
+    glBindBuffer(GL_ARRAY_BUFFER, m_vbo);
+    
+    if (GLAD_GL_VERSION_4_4 || GLAD_GL_ARB_buffer_storage) {
+        // Coherent, so plain stores are visible to the GPU without flushes
+        const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+        glBufferStorage(GL_ARRAY_BUFFER, size, nullptr, flags);
+        m_mapped = (GlyphInstance*)glMapBufferRange(GL_ARRAY_BUFFER, 0, size, flags);
+        if (m_mapped) {
+            m_persistent = true;
+            return true;
+        }
+        // Storage is immutable now; start over with a plain buffer
+        fprintf(stderr, "GLTextRenderer: persistent map failed, using per-pass maps\n");
+        glDeleteBuffers(1, &m_vbo);
+        glGenBuffers(1, &m_vbo);
+        glBindBuffer(GL_ARRAY_BUFFER, m_vbo);
+        while (glGetError() != GL_NO_ERROR) {}
+    }
+    
+    glBufferData(GL_ARRAY_BUFFER, size, nullptr, GL_STREAM_DRAW);
+    if (glGetError() != GL_NO_ERROR) {
+        fprintf(stderr, "GLTextRenderer: cannot allocate %lld byte glyph buffer\n", (long long)size);
+        return false;
+    }
+    return true;
+}
+
+void GLTextRenderer::waitForRegion(uint32_t region) {
+    GLsync& fence = m_fences[region];
+    if (!fence) return;
+    GLenum result = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, FENCE_TIMEOUT_NS);
+    if (result == GL_TIMEOUT_EXPIRED || result == GL_WAIT_FAILED) {
+        fprintf(stderr, "GLTextRenderer: glyph fence wait %s\n",
+                result == GL_WAIT_FAILED ? "failed" : "timed out");
+    }
+    glDeleteSync(fence);
+    fence = nullptr;
 }
 
 void GLTextRenderer::beginText(int screenWidth, int screenHeight) {
     m_screenWidth = screenWidth;
     m_screenHeight = screenHeight;
-    m_vertices.clear();
-    printf("GLTextRenderer::beginText() - screen: %dx%d\n", screenWidth, screenHeight);
+    m_glyphCount = 0;
+    if (!m_vbo || m_glyphs) return;   // Not initialized, or already inside a pass
+    
+    // Next region; the GPU finished with it RING_FRAMES passes ago in
+    // the normal case, so the wait returns at once
+    m_region = (m_region + 1) % RING_FRAMES;
+    waitForRegion(m_region);
+    
+    if (m_persistent) {
+        m_glyphs = m_mapped + (size_t)m_region * MAX_GLYPHS;
+    } else {
+        glBindBuffer(GL_ARRAY_BUFFER, m_vbo);
+        m_mapped = (GlyphInstance*)glMapBufferRange(
+            GL_ARRAY_BUFFER, (GLintptr)(sizeof(GlyphInstance) * MAX_GLYPHS * m_region),
+            (GLsizeiptr)(sizeof(GlyphInstance) * MAX_GLYPHS),
+            GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+        m_glyphs = m_mapped;
+    }
 }
 
 void GLTextRenderer::renderText(const char* text, TextPosition position, TextColor color, float scale) {
-    if (!text) return;
-    
-    printf("GLTextRenderer::renderText() - text: '%s', pos: (%.2f, %.2f)\n", text, position.x, position.y);
+    if (!text || !m_glyphs) return;
     
     float charWidth = 12.0f * scale;
     float charHeight = 16.0f * scale;
     
-    // Convert normalized position to NDC (-1 to 1)
-    float startX = position.x * 2.0f - 1.0f;
-    float startY = 1.0f - position.y * 2.0f;  // Flip Y (top = 1)
+    // Normalized position to pixels; the shader does the NDC conversion
+    float startX = position.x * m_screenWidth;
+    float startY = position.y * m_screenHeight;
     
-    // Convert pixel size to NDC
-    float ndcCharWidth = (charWidth / m_screenWidth) * 2.0f;
-    float ndcCharHeight = (charHeight / m_screenHeight) * 2.0f;
+    float scaleFixed = scale * 256.0f + 0.5f;
+    uint16_t packedScale = scaleFixed <= 0.0f ? 0 : scaleFixed >= 65535.0f ? 65535 : (uint16_t)scaleFixed;
+    uint32_t packedColor = packColor(color);
     
     float x = startX;
     float y = startY;
@@ -137,48 +254,43 @@ void GLTextRenderer::renderText(const char* text, TextPosition position, TextCol
     for (const char* c = text; *c; c++) {
         if (*c == '\n') {
             x = startX;
-            y -= ndcCharHeight;
+            y += charHeight;
             continue;
         }
         
-        unsigned char ch = (unsigned char)*c;
-        
-        // Calculate texture coordinates for this character
-        // Our font texture is 16x16 grid of characters
-        int charX = ch % 16;
-        int charY = ch / 16;
-        
-        float u0 = charX / 16.0f;
-        float v0 = charY / 16.0f;
-        float u1 = (charX + 1) / 16.0f;
-        float v1 = (charY + 1) / 16.0f;
-        
-        // Create quad for this character (2 triangles = 6 vertices)
-        addVertex(x, y, u0, v0, color);
-        addVertex(x + ndcCharWidth, y, u1, v0, color);
-        addVertex(x, y - ndcCharHeight, u0, v1, color);
-        
-        addVertex(x + ndcCharWidth, y, u1, v0, color);
-        addVertex(x + ndcCharWidth, y - ndcCharHeight, u1, v1, color);
-        addVertex(x, y - ndcCharHeight, u0, v1, color);
+        // Spaces are blank cells in the font; skip the instance
+        if (*c != ' ') {
+            if (m_glyphCount >= MAX_GLYPHS) return;
+            GlyphInstance& glyph = m_glyphs[m_glyphCount++];
+            glyph.x = x;
+            glyph.y = y;
+            glyph.color = packedColor;
+            glyph.glyph = (uint16_t)(unsigned char)*c;
+            glyph.scale = packedScale;
+        }
         
-        x += ndcCharWidth;
+        x += charWidth;
     }
 }
 
 void GLTextRenderer::endText() {
-    if (m_vertices.empty()) {
-        printf("GLTextRenderer::endText() - no vertices to render\n");
-        return;
-    }
-    
-    printf("GLTextRenderer::endText() - rendering %zu vertices (%zu triangles)\n", 
-           m_vertices.size() / 8, (m_vertices.size() / 8) / 3);
+    if (!m_glyphs) return;
     
-    // Upload vertices
     glBindBuffer(GL_ARRAY_BUFFER, m_vbo);
-    glBufferData(GL_ARRAY_BUFFER, m_vertices.size() * sizeof(float), 
-                 m_vertices.data(), GL_DYNAMIC_DRAW);
+    if (!m_persistent) {
+        m_mapped = nullptr;
+        if (!glUnmapBuffer(GL_ARRAY_BUFFER)) m_glyphCount = 0;   // Contents lost; skip the pass
+    }
+    m_glyphs = nullptr;
+    if (m_glyphCount == 0) return;
+    
+    // GL 3.3 has no base instance, so point the attributes at this region
+    const char* base = (const char*)(sizeof(GlyphInstance) * MAX_GLYPHS * m_region);
+    const GLsizei stride = (GLsizei)sizeof(GlyphInstance);
+    glBindVertexArray(m_vao);
+    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, stride, base + offsetof(GlyphInstance, x));
+    glVertexAttribPointer(1, 4, GL_UNSIGNED_BYTE, GL_TRUE, stride, base + offsetof(GlyphInstance, color));
+    glVertexAttribIPointer(2, 2, GL_UNSIGNED_SHORT, stride, base + offsetof(GlyphInstance, glyph));
     
     // Render text
     glEnable(GL_BLEND);
@@ -186,28 +298,17 @@ void GLTextRenderer::endText() {
     glDisable(GL_DEPTH_TEST);
     
     glUseProgram(m_shader);
-    glBindVertexArray(m_vao);
+    glUniform2f(m_screenLocation, (float)m_screenWidth, (float)m_screenHeight);
+    glActiveTexture(GL_TEXTURE0);
     glBindTexture(GL_TEXTURE_2D, m_fontTexture);
     
-    glDrawArrays(GL_TRIANGLES, 0, (GLsizei)(m_vertices.size() / 8));
+    glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, (GLsizei)m_glyphCount);
+    m_fences[m_region] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
     
     glBindVertexArray(0);
     glUseProgram(0);
     glEnable(GL_DEPTH_TEST);
     glDisable(GL_BLEND);
-    
-    printf("GLTextRenderer::endText() - done\n");
-}
-
-void GLTextRenderer::addVertex(float x, float y, float u, float v, const TextColor& color) {
-    m_vertices.push_back(x);
-    m_vertices.push_back(y);
-    m_vertices.push_back(u);
-    m_vertices.push_back(v);
-    m_vertices.push_back(color.r);
-    m_vertices.push_back(color.g);
-    m_vertices.push_back(color.b);
-    m_vertices.push_back(color.a);
 }
 
 void GLTextRenderer::createBitmapFont() {
@@ -3,16 +3,37 @@
 #define TEXT_RENDERER_GL_H
 
 #include "text_renderer.h"
-#include <vector>
+#include <cstdint>
 
 // Forward declare OpenGL types
 typedef unsigned int GLuint;
 typedef int GLsizei;
+typedef struct __GLsync* GLsync;
+
+// One glyph as the vertex shader reads it; the quad's corners come from
+// gl_VertexID, so this is the only per-glyph data sent to the GPU
+struct GlyphInstance {
+    float x, y;          // Top-left corner in pixels from the top-left of the screen
+    uint32_t color;      // RGBA8, red in the low byte
+    uint16_t glyph;      // Character code (cell in the 16x16 font atlas)
+    uint16_t scale;      // Size multiplier in 1/256 units (12x16 px at 256)
+};
+static_assert(sizeof(GlyphInstance) == 16, "GlyphInstance layout is shared with the vertex shader");
 
 // Simple bitmap font renderer for OpenGL
 // Requires OpenGL 3.3+ (implementation in text_renderer_gl.cpp)
+//
+// Glyphs are written straight into a ring of RING_FRAMES regions in one
+// vertex buffer, a region per beginText()/endText() pass, each guarded by
+// a fence so the CPU never overwrites glyphs the GPU may still read. With
+// GL 4.4 / ARB_buffer_storage the buffer is mapped persistently once;
+// otherwise each pass maps its region unsynchronized (the fences do the
+// syncing) and unmaps it in endText().
 class GLTextRenderer : public ITextRenderer {
 public:
+    static constexpr uint32_t MAX_GLYPHS = 4096;   // Per pass; extra glyphs are dropped
+    static constexpr uint32_t RING_FRAMES = 3;
+
     GLTextRenderer();
     ~GLTextRenderer() override;
     
@@ -27,12 +48,19 @@ private:
     GLuint m_vbo;
     GLuint m_shader;
     GLuint m_fontTexture;
+    int m_screenLocation;
     int m_screenWidth;
     int m_screenHeight;
-    std::vector<float> m_vertices;
+
+    bool m_persistent;                  // Buffer storage mapped for the renderer's lifetime
+    GlyphInstance* m_mapped;            // Whole ring (persistent) or the current region
+    GlyphInstance* m_glyphs;            // Current region, null outside a pass
+    uint32_t m_glyphCount;
+    uint32_t m_region;
+    GLsync m_fences[RING_FRAMES];
     
-    void addVertex(float x, float y, float u, float v, const TextColor& color);
+    bool createRingBuffer();
+    void waitForRegion(uint32_t region);
     void createBitmapFont();
 };
-
 #endif // TEXT_RENDERER_GL_H
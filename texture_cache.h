@@ -1,84 +1,372 @@
-// texture_cache.h - Texture caching system to avoid duplicate loads
+// texture_cache.h - Texture residency manager (shared, refcounted, VRAM-budgeted)
 #ifndef TEXTURE_CACHE_H
 #define TEXTURE_CACHE_H
 
 #include "renderer.h"
+#include "debug.h"
+#include "profiler.h"
+#include "dds_loader.h"
+#include "stb_image.h"
 #include <string>
+#include <vector>
+#include <deque>
 #include <unordered_map>
+#include <map>
+#include <algorithm>
+#include <utility>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <cstring>
 
 // ==================== Texture Cache ====================
+// Textures are shared by normalized path and refcounted (acquire/release).
+// Resident bytes are tracked against a VRAM budget: when over budget,
+// unreferenced textures are evicted least-recently-used first, then idle
+// referenced textures are demoted to their mip tail.
+//
+// In MipTailFirst mode acquire() returns immediately with a tiny placeholder;
+// a worker thread decodes the image and update() uploads the mip tail, then
+// the full-resolution image once the budget allows. Renderer calls only ever
+// happen on the thread calling acquire()/update().
+//
+// With packing on, insertDecodedGroup() puts same-size RGBA images into
+// layers of one texture array, so draws of meshes sharing it keep one
+// texture bound. Each layer is an entry of its own (shared, refcounted and
+// evicted per path); the array goes once its last layer does.
 class TextureCache {
+public:
+    enum class StreamMode {
+        Immediate,     // Decode and upload inside acquire()
+        MipTailFirst,  // Placeholder now, mip tail then full resolution from update()
+    };
+
+    static const int MIP_TAIL_SIZE = 64;                  // Largest dimension of the mip tail
+    static const uint32_t MAX_UPLOADS_PER_FRAME = 2;      // Streamed uploads per update()
+    static const uint64_t IDLE_FRAMES_BEFORE_DEMOTE = 120; // Referenced textures only
+    static const uint32_t MAX_ARRAY_LAYERS = 256;         // GL_MAX_ARRAY_TEXTURE_LAYERS minimum
+
+    // CPU half of a texture load, produced by decodeFile() on any thread and
+    // uploaded by insertDecoded() on the render thread
+    struct DecodedImage {
+        std::string path;
+        bool ok = false;
+        bool compressed = false;      // BC blocks in 'dds', otherwise RGBA8 in 'pixels'
+        DDSImage dds;
+        std::vector<uint8_t> pixels;
+        int width = 0;
+        int height = 0;
+        std::vector<uint8_t> tail;    // RGBA mip tail
+        int tailWidth = 0;
+        int tailHeight = 0;
+    };
+
 private:
+    enum class Residency { Placeholder, Tail, Full };
+
+    struct Entry {
+        std::string path;
+        uint32_t refCount = 0;
+        uint64_t lastUsedFrame = 0;
+        uint64_t residentBytes = 0;
+        Residency residency = Residency::Placeholder;
+        bool decodePending = false;
+        bool stale = false;          // Invalidated; destroyed with its last reference
+        int width = 0;               // Full resolution (0 until decoded)
+        int height = 0;
+        int tailWidth = 0;
+        int tailHeight = 0;
+        std::vector<uint8_t> tail;   // RGBA mip tail, kept for cheap demotion
+        uint32_t arrayHandle = 0;    // Texture array holding this layer (packed entries)
+    };
+
+    // A packed array's storage is charged here, not to its layer entries,
+    // since it is only freed when the last layer goes
+    struct ArrayRecord {
+        uint32_t liveLayers = 0;
+        uint64_t residentBytes = 0;
+    };
+
+    struct DecodeResult {
+        uint32_t handle;
+        bool ok;
+        int width;
+        int height;
+        std::vector<uint8_t> pixels;  // RGBA
+    };
+
     IRenderer* m_renderer;
     std::unordered_map<std::string, uint32_t> m_pathToHandle;
-    
+    std::unordered_map<uint32_t, Entry> m_entries;
+    std::unordered_map<uint32_t, ArrayRecord> m_arrayLayers;  // By array handle
+    bool m_packing;
+
+    // Residency
+    StreamMode m_mode;
+    uint64_t m_budgetBytes;    // 0 = unlimited
+    uint64_t m_residentBytes;
+    uint64_t m_frame;
+
+    // Background decode worker
+    std::thread m_worker;
+    std::mutex m_mutex;
+    std::condition_variable m_cv;
+    std::deque<std::pair<uint32_t, std::string>> m_decodeRequests;
+    std::deque<DecodeResult> m_decodeResults;
+    bool m_stopWorker;
+
     // Statistics
     uint32_t m_totalRequests;
     uint32_t m_cacheHits;
     uint32_t m_cacheMisses;
-    
+    uint32_t m_evictions;
+    uint32_t m_demotions;
+    uint32_t m_promotions;
+
 public:
-    TextureCache() 
+    TextureCache()
         : m_renderer(nullptr)
+        , m_packing(false)
+        , m_mode(StreamMode::Immediate)
+        , m_budgetBytes(0)
+        , m_residentBytes(0)
+        , m_frame(0)
+        , m_stopWorker(false)
         , m_totalRequests(0)
         , m_cacheHits(0)
         , m_cacheMisses(0)
+        , m_evictions(0)
+        , m_demotions(0)
+        , m_promotions(0)
     {}
-    
+
+    // Does not touch the renderer (it may already be gone); call clear() first
+    ~TextureCache() {
+        stopWorker();
+    }
+
+    TextureCache(const TextureCache&) = delete;
+    TextureCache& operator=(const TextureCache&) = delete;
+
     void setRenderer(IRenderer* renderer) {
         m_renderer = renderer;
     }
-    
-    // Get or load texture - main API
-    uint32_t getOrLoad(const char* path) {
+
+    void setStreamMode(StreamMode mode) { m_mode = mode; }
+    StreamMode getStreamMode() const { return m_mode; }
+
+    // Pack the images given to insertDecodedGroup() into texture arrays
+    void setPacking(bool enabled) { m_packing = enabled; }
+    bool getPacking() const { return m_packing; }
+
+    // VRAM budget in bytes (0 = unlimited). Enforced on the next update().
+    void setBudget(uint64_t bytes) { m_budgetBytes = bytes; }
+    uint64_t getBudget() const { return m_budgetBytes; }
+
+    // Get or load texture and take a reference - main API
+    uint32_t acquire(const char* path) {
         if (!m_renderer) {
             LOG_ERROR("TextureCache: No renderer set!");
             return 0;
         }
-        
+
         if (!path || path[0] == '\0') {
             LOG_WARNING("TextureCache: Empty path provided");
             return 0;
         }
-        
+
         m_totalRequests++;
-        
+
         // Normalize path (convert to lowercase for case-insensitive comparison)
         std::string normalizedPath = normalizePath(path);
-        
+
         // Check if already loaded
         auto it = m_pathToHandle.find(normalizedPath);
         if (it != m_pathToHandle.end()) {
             m_cacheHits++;
-            LOG_TRACE("TextureCache: Cache HIT for %s (handle %u)", path, it->second);
+            Entry& entry = m_entries[it->second];
+            entry.refCount++;
+            entry.lastUsedFrame = m_frame;
+            LOG_TRACE("TextureCache: Cache HIT for %s (handle %u, refs %u)", path, it->second, entry.refCount);
             return it->second;
         }
-        
+
         // Not in cache - load it
         m_cacheMisses++;
         LOG_DEBUG("TextureCache: Cache MISS for %s, loading...", path);
-        
-        uint32_t handle = m_renderer->createTexture(path);
+
+        // Block-compressed DDS goes up as-is in both modes (it is small and
+        // carries its own mips); everything else is decoded to RGBA8
+        uint32_t handle = loadCompressed(path);
+        if (handle == 0) {
+            handle = (m_mode == StreamMode::MipTailFirst)
+                     ? loadStreamed(path)
+                     : loadImmediate(path);
+        }
         if (handle == 0) {
             LOG_WARNING("TextureCache: Failed to load texture: %s", path);
             return 0;
         }
-        
+
         // Add to cache
         m_pathToHandle[normalizedPath] = handle;
-        LOG_DEBUG("TextureCache: Cached %s as handle %u (%zu textures cached)", 
+        LOG_DEBUG("TextureCache: Cached %s as handle %u (%zu textures cached)",
                  path, handle, m_pathToHandle.size());
-        
+
         return handle;
     }
-    
+
+    // Thread-safe decode without renderer calls (used by the asset loader's workers)
+    static DecodedImage decodeFile(const std::string& path) {
+        DecodedImage image;
+        image.path = path;
+        if (isDDSPath(path.c_str()) && DDSLoader::LoadCompressed(path.c_str(), image.dds)) {
+            image.compressed = true;
+            image.width = image.dds.width;
+            image.height = image.dds.height;
+            image.ok = true;
+            return image;
+        }
+        image.ok = decodeRGBA(path.c_str(), image.pixels, image.width, image.height);
+        if (image.ok) {
+            buildMipTail(image.pixels.data(), image.width, image.height,
+                         image.tail, image.tailWidth, image.tailHeight);
+        }
+        return image;
+    }
+
+    // Upload a decoded image as a resident, unreferenced entry so the next
+    // acquire() of its path is a hit. Returns the handle (0 on failure);
+    // paths already cached are left untouched.
+    uint32_t insertDecoded(DecodedImage&& image) {
+        if (!m_renderer || !image.ok) return 0;
+        std::string normalizedPath = normalizePath(image.path.c_str());
+        auto it = m_pathToHandle.find(normalizedPath);
+        if (it != m_pathToHandle.end()) return it->second;
+
+        uint32_t handle = 0;
+        if (image.compressed) {
+            handle = uploadCompressed(image.path.c_str(), image.dds);
+            // No BC support in this renderer: decode on this thread instead
+            if (handle == 0) handle = loadImmediate(image.path.c_str());
+        } else {
+            Entry entry;
+            entry.path = image.path;
+            entry.width = image.width;
+            entry.height = image.height;
+            entry.tail = std::move(image.tail);
+            entry.tailWidth = image.tailWidth;
+            entry.tailHeight = image.tailHeight;
+            handle = uploadRGBA(image.pixels.data(), std::move(entry));
+        }
+        if (handle == 0) {
+            LOG_WARNING("TextureCache: Failed to upload preloaded texture: %s", image.path.c_str());
+            return 0;
+        }
+        m_entries[handle].refCount = 0;
+        m_pathToHandle[normalizedPath] = handle;
+        return handle;
+    }
+
+    // insertDecoded() for images usually drawn together (one model's
+    // textures). With packing on, uncompressed images of the same size go
+    // into one texture array, a layer per path; the rest, and everything
+    // when packing is off or the array can't be created, are inserted one
+    // by one. Packed layers are never demoted, like compressed textures.
+    void insertDecodedGroup(std::vector<DecodedImage>&& images) {
+        if (!m_renderer) return;
+
+        std::map<std::pair<int, int>, std::vector<DecodedImage*>> bySize;
+        for (DecodedImage& image : images) {
+            if (!image.ok) continue;
+            bool cached = m_pathToHandle.count(normalizePath(image.path.c_str())) > 0;
+            if (m_packing && !image.compressed && !cached) {
+                bySize[{ image.width, image.height }].push_back(&image);
+            } else {
+                insertDecoded(std::move(image));
+            }
+        }
+
+        for (auto& [size, group] : bySize) {
+            for (size_t first = 0; first < group.size(); first += MAX_ARRAY_LAYERS) {
+                size_t count = std::min(group.size() - first, (size_t)MAX_ARRAY_LAYERS);
+                if (count < 2 || !insertArray(&group[first], (uint32_t)count)) {
+                    for (size_t i = first; i < first + count; i++) insertDecoded(std::move(*group[i]));
+                }
+            }
+        }
+    }
+
+    // Kept for existing callers; takes a reference like acquire()
+    uint32_t getOrLoad(const char* path) {
+        return acquire(path);
+    }
+
+    // Drop a reference. Unreferenced textures stay resident (a later acquire
+    // is a hit) until the budget needs their memory.
+    void release(uint32_t handle) {
+        auto it = m_entries.find(handle);
+        if (it == m_entries.end()) {
+            LOG_WARNING("TextureCache: release of unknown handle %u", handle);
+            return;
+        }
+        if (it->second.refCount > 0) it->second.refCount--;
+        if (it->second.refCount == 0 && it->second.stale) evict(handle);
+    }
+
+    // The file behind 'path' changed: forget the cached copy so the next
+    // acquire() (or insertDecoded()) loads it again. Handles already held
+    // keep the old texture until their holders release them.
+    void invalidate(const char* path) {
+        if (!path) return;
+        auto it = m_pathToHandle.find(normalizePath(path));
+        if (it == m_pathToHandle.end()) return;
+        uint32_t handle = it->second;
+        m_pathToHandle.erase(it);
+        Entry& entry = m_entries[handle];
+        if (entry.refCount == 0) {
+            evict(handle);
+        } else {
+            entry.stale = true;
+        }
+    }
+
+    // Mark a texture as drawn this frame (drives LRU eviction and promotion)
+    void markUsed(uint32_t handle) {
+        auto it = m_entries.find(handle);
+        if (it != m_entries.end()) it->second.lastUsedFrame = m_frame;
+    }
+
+    // Once per frame on the render thread: apply finished decodes, request
+    // full resolution for hot textures and enforce the budget
+    void update() {
+        m_frame++;
+        if (!m_renderer) return;
+        PROFILE_ZONE("Texture Uploads");
+
+        uint32_t uploads = 0;
+        while (uploads < MAX_UPLOADS_PER_FRAME) {
+            DecodeResult result;
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                if (m_decodeResults.empty()) break;
+                result = std::move(m_decodeResults.front());
+                m_decodeResults.pop_front();
+            }
+            if (applyDecode(result)) uploads++;
+        }
+
+        requestPromotions();
+        makeRoom(0, 0);
+    }
+
     // Check if texture is already loaded
     bool isLoaded(const char* path) const {
         if (!path) return false;
         std::string normalizedPath = normalizePath(path);
         return m_pathToHandle.find(normalizedPath) != m_pathToHandle.end();
     }
-    
+
     // Get handle without loading (returns 0 if not cached)
     uint32_t getHandle(const char* path) const {
         if (!path) return 0;
@@ -86,16 +374,31 @@ public:
         auto it = m_pathToHandle.find(normalizedPath);
         return (it != m_pathToHandle.end()) ? it->second : 0;
     }
-    
-    // Clear cache (doesn't destroy textures in renderer)
+
+    // Destroy every cached texture in the renderer and reset the cache
     void clear() {
         LOG_INFO("TextureCache: Clearing cache (%zu textures)", m_pathToHandle.size());
+        stopWorker();
+        if (m_renderer) {
+            for (const auto& [handle, entry] : m_entries) {
+                m_renderer->destroyTexture(handle);
+            }
+            for (const auto& [arrayHandle, record] : m_arrayLayers) {
+                m_renderer->destroyTexture(arrayHandle);
+            }
+        }
+        m_entries.clear();
+        m_arrayLayers.clear();
         m_pathToHandle.clear();
+        m_residentBytes = 0;
         m_totalRequests = 0;
         m_cacheHits = 0;
         m_cacheMisses = 0;
+        m_evictions = 0;
+        m_demotions = 0;
+        m_promotions = 0;
     }
-    
+
     // Get cache statistics
     struct Stats {
         uint32_t totalRequests;
@@ -103,20 +406,35 @@ public:
         uint32_t cacheMisses;
         uint32_t uniqueTextures;
         float hitRate;
+        uint64_t residentBytes;
+        uint64_t budgetBytes;
+        uint32_t fullResident;
+        uint32_t evictions;
+        uint32_t demotions;
+        uint32_t promotions;
     };
-    
+
     Stats getStats() const {
         Stats stats;
         stats.totalRequests = m_totalRequests;
         stats.cacheHits = m_cacheHits;
         stats.cacheMisses = m_cacheMisses;
         stats.uniqueTextures = (uint32_t)m_pathToHandle.size();
-        stats.hitRate = (m_totalRequests > 0) 
-                        ? (float)m_cacheHits / (float)m_totalRequests * 100.0f 
+        stats.hitRate = (m_totalRequests > 0)
+                        ? (float)m_cacheHits / (float)m_totalRequests * 100.0f
                         : 0.0f;
+        stats.residentBytes = m_residentBytes;
+        stats.budgetBytes = m_budgetBytes;
+        stats.fullResident = 0;
+        for (const auto& [handle, entry] : m_entries) {
+            if (entry.residency == Residency::Full) stats.fullResident++;
+        }
+        stats.evictions = m_evictions;
+        stats.demotions = m_demotions;
+        stats.promotions = m_promotions;
         return stats;
     }
-    
+
     void printStats() const {
         Stats stats = getStats();
         printf("\n=== Texture Cache Statistics ===\n");
@@ -125,20 +443,412 @@ public:
         printf("Cache Misses:     %u\n", stats.cacheMisses);
         printf("Unique Textures:  %u\n", stats.uniqueTextures);
         printf("Hit Rate:         %.1f%%\n", stats.hitRate);
-        
+
         if (stats.totalRequests > 0) {
             float savings = (float)stats.cacheHits / (float)stats.totalRequests * 100.0f;
-            printf("Memory Saved:     ~%.1f%% (avoided reloading %u textures)\n", 
+            printf("Memory Saved:     ~%.1f%% (avoided reloading %u textures)\n",
                    savings, stats.cacheHits);
         }
+        printf("Resident:         %.1f MB", stats.residentBytes / (1024.0 * 1024.0));
+        if (stats.budgetBytes > 0) {
+            printf(" / %.1f MB budget", stats.budgetBytes / (1024.0 * 1024.0));
+        }
+        printf(" (%u at full res)\n", stats.fullResident);
+        printf("Evict/Demote/Promote: %u / %u / %u\n",
+               stats.evictions, stats.demotions, stats.promotions);
         printf("================================\n\n");
     }
-    
+
 private:
+    // Approximate VRAM for an RGBA8 texture with a full mip chain
+    static uint64_t textureBytes(int width, int height) {
+        return (uint64_t)width * (uint64_t)height * 4 * 4 / 3;
+    }
+
+    static bool isDDSPath(const char* path) {
+        const char* ext = strrchr(path, '.');
+        return ext && (strcmp(ext, ".dds") == 0 || strcmp(ext, ".DDS") == 0);
+    }
+
+    // Returns 0 if the file isn't BC1-3 DDS or the renderer can't take it
+    uint32_t loadCompressed(const char* path) {
+        if (!isDDSPath(path)) return 0;
+
+        DDSImage image;
+        if (!DDSLoader::LoadCompressed(path, image)) return 0;
+        return uploadCompressed(path, image);
+    }
+
+    uint32_t uploadCompressed(const char* path, const DDSImage& image) {
+        uint64_t bytes = 0;
+        for (const CompressedMip& mip : image.mips) bytes += mip.size;
+        makeRoom(bytes, 0);
+
+        uint32_t handle = m_renderer->createCompressedTexture(image.format, image.mips.data(),
+                                                              (uint32_t)image.mips.size());
+        if (handle == 0) return 0;
+
+        // No RGBA tail: compressed textures are never demoted, only evicted
+        Entry entry;
+        entry.path = path;
+        entry.width = entry.tailWidth = image.width;
+        entry.height = entry.tailHeight = image.height;
+        entry.residency = Residency::Full;
+        entry.residentBytes = bytes;
+        return addEntry(handle, std::move(entry));
+    }
+
+    uint32_t loadImmediate(const char* path) {
+        std::vector<uint8_t> pixels;
+        int width = 0, height = 0;
+        if (!decodeRGBA(path, pixels, width, height)) return 0;
+
+        Entry entry;
+        entry.path = path;
+        entry.width = width;
+        entry.height = height;
+        buildMipTail(pixels.data(), width, height, entry.tail, entry.tailWidth, entry.tailHeight);
+        return uploadRGBA(pixels.data(), std::move(entry));
+    }
+
+    // 'entry' carries path, size and mip tail
+    uint32_t uploadRGBA(const uint8_t* pixels, Entry&& entry) {
+        // Full resolution if it fits, otherwise start at the mip tail and let
+        // update() promote it when memory frees up
+        uint64_t fullBytes = textureBytes(entry.width, entry.height);
+        bool full = makeRoom(fullBytes, 0) || !hasTail(entry);
+        uint32_t handle = full
+            ? m_renderer->createTextureFromData(pixels, entry.width, entry.height, 4)
+            : m_renderer->createTextureFromData(entry.tail.data(), entry.tailWidth, entry.tailHeight, 4);
+        if (handle == 0) return 0;
+
+        entry.residency = full ? Residency::Full : Residency::Tail;
+        entry.residentBytes = full ? fullBytes : textureBytes(entry.tailWidth, entry.tailHeight);
+        return addEntry(handle, std::move(entry));
+    }
+
+    // Same-size decoded RGBA images as the layers of one new array; false
+    // (nothing inserted) if the renderer can't create it
+    bool insertArray(DecodedImage* const* images, uint32_t count) {
+        int width = images[0]->width;
+        int height = images[0]->height;
+        makeRoom(textureBytes(width, height) * count, 0);
+
+        std::vector<const uint8_t*> layers(count);
+        for (uint32_t i = 0; i < count; i++) layers[i] = images[i]->pixels.data();
+        std::vector<uint32_t> layerHandles(count);
+        uint32_t arrayHandle = m_renderer->createTextureArray(layers.data(), count, width, height,
+                                                              layerHandles.data());
+        if (arrayHandle == 0) return false;
+
+        for (uint32_t i = 0; i < count; i++) {
+            Entry entry;
+            entry.path = images[i]->path;
+            entry.width = entry.tailWidth = width;
+            entry.height = entry.tailHeight = height;
+            entry.residency = Residency::Full;
+            entry.arrayHandle = arrayHandle;
+            addEntry(layerHandles[i], std::move(entry));
+            m_entries[layerHandles[i]].refCount = 0;
+            m_pathToHandle[normalizePath(images[i]->path.c_str())] = layerHandles[i];
+        }
+        ArrayRecord& record = m_arrayLayers[arrayHandle];
+        record.liveLayers = count;
+        record.residentBytes = textureBytes(width, height) * count;
+        m_residentBytes += record.residentBytes;
+        LOG_DEBUG("TextureCache: Packed %u %dx%d textures into array %u", count, width, height, arrayHandle);
+        return true;
+    }
+
+    uint32_t loadStreamed(const char* path) {
+        // Mid-grey placeholder until the worker has decoded the image
+        static const uint8_t placeholder[4 * 4 * 4] = {
+            128,128,128,255, 128,128,128,255, 128,128,128,255, 128,128,128,255,
+            128,128,128,255, 128,128,128,255, 128,128,128,255, 128,128,128,255,
+            128,128,128,255, 128,128,128,255, 128,128,128,255, 128,128,128,255,
+            128,128,128,255, 128,128,128,255, 128,128,128,255, 128,128,128,255,
+        };
+        uint32_t handle = m_renderer->createTextureFromData(placeholder, 4, 4, 4);
+        if (handle == 0) return 0;
+
+        Entry entry;
+        entry.path = path;
+        entry.residency = Residency::Placeholder;
+        entry.residentBytes = textureBytes(4, 4);
+        addEntry(handle, std::move(entry));
+        requestDecode(handle);
+        return handle;
+    }
+
+    uint32_t addEntry(uint32_t handle, Entry&& entry) {
+        entry.refCount = 1;
+        entry.lastUsedFrame = m_frame;
+        m_residentBytes += entry.residentBytes;
+        m_entries[handle] = std::move(entry);
+        return handle;
+    }
+
+    // Swap the texture's contents and keep the resident byte count in sync
+    bool setResidency(uint32_t handle, Entry& entry, Residency residency, const uint8_t* pixels) {
+        int w = (residency == Residency::Full) ? entry.width : entry.tailWidth;
+        int h = (residency == Residency::Full) ? entry.height : entry.tailHeight;
+        if (!m_renderer->updateTexture(handle, pixels, w, h, 4)) return false;
+        m_residentBytes -= entry.residentBytes;
+        entry.residentBytes = textureBytes(w, h);
+        m_residentBytes += entry.residentBytes;
+        entry.residency = residency;
+        return true;
+    }
+
+    // Returns true if a texture upload was issued
+    bool applyDecode(DecodeResult& result) {
+        auto it = m_entries.find(result.handle);
+        if (it == m_entries.end()) return false;  // Evicted while decoding
+        Entry& entry = it->second;
+        entry.decodePending = false;
+
+        if (!result.ok) {
+            LOG_WARNING("TextureCache: Streaming decode failed: %s", entry.path.c_str());
+            return false;
+        }
+
+        entry.width = result.width;
+        entry.height = result.height;
+        if (entry.tail.empty()) {
+            buildMipTail(result.pixels.data(), result.width, result.height,
+                         entry.tail, entry.tailWidth, entry.tailHeight);
+        }
+
+        uint64_t fullBytes = textureBytes(entry.width, entry.height);
+        uint64_t extra = (fullBytes > entry.residentBytes) ? fullBytes - entry.residentBytes : 0;
+        if (makeRoom(extra, result.handle)) {
+            if (setResidency(result.handle, entry, Residency::Full, result.pixels.data())) {
+                m_promotions++;
+                return true;
+            }
+        }
+        // No room for full resolution yet: at least replace the placeholder
+        if (entry.residency == Residency::Placeholder) {
+            if (!hasTail(entry)) {
+                return setResidency(result.handle, entry, Residency::Full, result.pixels.data());
+            }
+            return setResidency(result.handle, entry, Residency::Tail, entry.tail.data());
+        }
+        return false;
+    }
+
+    // Re-decode full resolution for referenced textures drawn last frame that
+    // are still at their mip tail, when the budget can hold them
+    void requestPromotions() {
+        uint32_t requested = 0;
+        for (auto& [handle, entry] : m_entries) {
+            if (requested >= MAX_UPLOADS_PER_FRAME) break;
+            if (entry.residency != Residency::Tail || entry.decodePending) continue;
+            if (entry.refCount == 0 || m_frame - entry.lastUsedFrame > 1) continue;
+
+            uint64_t extra = textureBytes(entry.width, entry.height) - entry.residentBytes;
+            if (m_budgetBytes > 0 && m_residentBytes + extra > m_budgetBytes + reclaimableBytes(handle)) continue;
+            requestDecode(handle);
+            requested++;
+        }
+    }
+
+    // Small textures are their own mip tail and are never demoted
+    static bool hasTail(const Entry& entry) {
+        return entry.tailWidth < entry.width || entry.tailHeight < entry.height;
+    }
+
+    bool isIdle(const Entry& entry) const {
+        return m_frame - entry.lastUsedFrame > IDLE_FRAMES_BEFORE_DEMOTE;
+    }
+
+    // Bytes makeRoom() could free without touching 'keep'
+    uint64_t reclaimableBytes(uint32_t keep) const {
+        uint64_t bytes = 0;
+        for (const auto& [handle, entry] : m_entries) {
+            if (handle == keep) continue;
+            if (entry.refCount == 0) {
+                bytes += entry.residentBytes;
+            } else if (entry.residency == Residency::Full && hasTail(entry) && isIdle(entry)) {
+                bytes += entry.residentBytes - textureBytes(entry.tailWidth, entry.tailHeight);
+            }
+        }
+        return bytes;
+    }
+
+    // Evict/demote until 'extraBytes' more fit in the budget. Unreferenced
+    // textures go first (LRU), then idle referenced ones drop to their tail.
+    bool makeRoom(uint64_t extraBytes, uint32_t keep) {
+        if (m_budgetBytes == 0) return true;
+        while (m_residentBytes + extraBytes > m_budgetBytes) {
+            uint32_t victim = 0;
+            uint64_t oldest = UINT64_MAX;
+            for (const auto& [handle, entry] : m_entries) {
+                if (handle != keep && entry.refCount == 0 && entry.lastUsedFrame < oldest) {
+                    victim = handle;
+                    oldest = entry.lastUsedFrame;
+                }
+            }
+            if (victim) {
+                evict(victim);
+                continue;
+            }
+
+            for (const auto& [handle, entry] : m_entries) {
+                if (handle != keep && entry.residency == Residency::Full && hasTail(entry) &&
+                    isIdle(entry) && entry.lastUsedFrame < oldest) {
+                    victim = handle;
+                    oldest = entry.lastUsedFrame;
+                }
+            }
+            if (!victim) return false;
+
+            Entry& entry = m_entries[victim];
+            if (!setResidency(victim, entry, Residency::Tail, entry.tail.data())) return false;
+            m_demotions++;
+            LOG_DEBUG("TextureCache: Demoted %s to %dx%d mip tail", entry.path.c_str(),
+                      entry.tailWidth, entry.tailHeight);
+        }
+        return true;
+    }
+
+    void evict(uint32_t handle) {
+        auto it = m_entries.find(handle);
+        if (it == m_entries.end()) return;
+        LOG_DEBUG("TextureCache: Evicting %s (%.1f KB)", it->second.path.c_str(),
+                  it->second.residentBytes / 1024.0);
+        m_renderer->destroyTexture(handle);
+        m_residentBytes -= it->second.residentBytes;
+        if (it->second.arrayHandle) releaseArrayLayer(it->second.arrayHandle);
+        if (!it->second.stale) m_pathToHandle.erase(normalizePath(it->second.path.c_str()));
+        m_entries.erase(it);
+        m_evictions++;
+    }
+
+    // An array's storage stays until its last layer entry is evicted
+    void releaseArrayLayer(uint32_t arrayHandle) {
+        auto it = m_arrayLayers.find(arrayHandle);
+        if (it == m_arrayLayers.end() || --it->second.liveLayers > 0) return;
+        m_renderer->destroyTexture(arrayHandle);
+        m_residentBytes -= it->second.residentBytes;
+        m_arrayLayers.erase(it);
+    }
+
+    // ---------------- Background decode ----------------
+    void requestDecode(uint32_t handle) {
+        Entry& entry = m_entries[handle];
+        entry.decodePending = true;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if (!m_worker.joinable()) {
+                m_stopWorker = false;
+                m_worker = std::thread(&TextureCache::workerLoop, this);
+            }
+            m_decodeRequests.emplace_back(handle, entry.path);
+        }
+        m_cv.notify_one();
+    }
+
+    void workerLoop() {
+        for (;;) {
+            std::pair<uint32_t, std::string> request;
+            {
+                std::unique_lock<std::mutex> lock(m_mutex);
+                m_cv.wait(lock, [this] { return m_stopWorker || !m_decodeRequests.empty(); });
+                if (m_stopWorker) return;
+                request = std::move(m_decodeRequests.front());
+                m_decodeRequests.pop_front();
+            }
+
+            PROFILE_ZONE("Texture Decode");
+            DecodeResult result;
+            result.handle = request.first;
+            result.width = 0;
+            result.height = 0;
+            result.ok = decodeRGBA(request.second.c_str(), result.pixels, result.width, result.height);
+
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_decodeResults.push_back(std::move(result));
+        }
+    }
+
+    void stopWorker() {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_stopWorker = true;
+        }
+        m_cv.notify_all();
+        if (m_worker.joinable()) m_worker.join();
+        m_decodeRequests.clear();
+        m_decodeResults.clear();
+        for (auto& [handle, entry] : m_entries) entry.decodePending = false;
+    }
+
+    // Thread-safe decode to tightly packed RGBA8 (DDS or anything stb_image reads)
+    static bool decodeRGBA(const char* path, std::vector<uint8_t>& out, int& width, int& height) {
+        int channels = 0;
+        const char* ext = strrchr(path, '.');
+        if (ext && (strcmp(ext, ".dds") == 0 || strcmp(ext, ".DDS") == 0)) {
+            unsigned char* data = DDSLoader::Load(path, &width, &height, &channels);
+            if (data) {
+                bool ok = (channels == 3 || channels == 4);
+                if (ok) {
+                    size_t count = (size_t)width * height;
+                    out.resize(count * 4);
+                    for (size_t i = 0; i < count; i++) {
+                        out[i * 4 + 0] = data[i * channels + 0];
+                        out[i * 4 + 1] = data[i * channels + 1];
+                        out[i * 4 + 2] = data[i * channels + 2];
+                        out[i * 4 + 3] = (channels == 4) ? data[i * 4 + 3] : 255;
+                    }
+                }
+                delete[] data;
+                return ok;
+            }
+        }
+
+        unsigned char* data = stbi_load(path, &width, &height, &channels, 4);
+        if (!data) return false;
+        out.assign(data, data + (size_t)width * height * 4);
+        stbi_image_free(data);
+        return true;
+    }
+
+    // Box-filter down until the largest side is <= MIP_TAIL_SIZE
+    static void buildMipTail(const uint8_t* src, int width, int height,
+                             std::vector<uint8_t>& out, int& outWidth, int& outHeight) {
+        std::vector<uint8_t> level(src, src + (size_t)width * height * 4);
+        int w = width, h = height;
+        while (w > MIP_TAIL_SIZE || h > MIP_TAIL_SIZE) {
+            int nw = (w > 1) ? w / 2 : 1;
+            int nh = (h > 1) ? h / 2 : 1;
+            std::vector<uint8_t> next((size_t)nw * nh * 4);
+            for (int y = 0; y < nh; y++) {
+                int y0 = (h > 1) ? y * 2 : 0;
+                int y1 = (h > 1) ? y0 + 1 : 0;
+                for (int x = 0; x < nw; x++) {
+                    int x0 = (w > 1) ? x * 2 : 0;
+                    int x1 = (w > 1) ? x0 + 1 : 0;
+                    for (int c = 0; c < 4; c++) {
+                        int sum = level[((size_t)y0 * w + x0) * 4 + c] + level[((size_t)y0 * w + x1) * 4 + c] +
+                                  level[((size_t)y1 * w + x0) * 4 + c] + level[((size_t)y1 * w + x1) * 4 + c];
+                        next[((size_t)y * nw + x) * 4 + c] = (uint8_t)((sum + 2) / 4);
+                    }
+                }
+            }
+            level.swap(next);
+            w = nw;
+            h = nh;
+        }
+        out.swap(level);
+        outWidth = w;
+        outHeight = h;
+    }
+
     // Normalize path for consistent lookups (lowercase, forward slashes)
     static std::string normalizePath(const char* path) {
         std::string normalized = path;
-        
+
         // Convert to lowercase for case-insensitive comparison
         for (char& c : normalized) {
             if (c >= 'A' && c <= 'Z') {
@@ -149,7 +859,7 @@ private:
                 c = '/';
             }
         }
-        
+
         return normalized;
     }
 };